@@ -0,0 +1,129 @@
+/*
+ * Copyright (c) 2015 by Zuse Institute Berlin
+ *
+ * Licensed under the BSD License, see LICENSE file for details.
+ *
+ */
+
+#ifndef CPP_INCLUDE_FUSE_FUSE_INODE_TABLE_H_
+#define CPP_INCLUDE_FUSE_FUSE_INODE_TABLE_H_
+
+#include <stdint.h>
+
+#include <boost/thread/mutex.hpp>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace xtreemfs {
+
+/** Maps the inode numbers (node ids) of the Fuse low-level API to paths.
+ *
+ * The kernel references a file by the inode number returned by a lookup
+ * until it "forgets" all lookups of it. Inode numbers are assigned by this
+ * table and never reused. Hard links to the same XtreemFS file get different
+ * inode numbers, so the kernel never merges the attributes of their paths.
+ * Instead, the XtreemFS file ids of hard links are recorded, so that the
+ * attributes cached for the other links can be invalidated after a change.
+ *
+ * All methods are thread-safe.
+ */
+class FuseInodeTable {
+ public:
+  /** Inode number of the volume root "/" (FUSE_ROOT_ID). It is never
+   *  forgotten. */
+  static const uint64_t kRootInode = 1;
+
+  FuseInodeTable();
+
+  /** Returns the inode number of "path" and increments its lookup count.
+   *
+   *  A new inode number is assigned if "path" is not known yet. */
+  uint64_t Lookup(const std::string& path);
+
+  /** Decrements the lookup count of "inode" by "count" and removes the inode
+   *  once it reached zero. */
+  void Forget(uint64_t inode, uint64_t count);
+
+  /** Stores the path of "inode" in "path".
+   *
+   * @return false if "inode" is unknown or its path was removed. "path" is set
+   *         to the last known path of a removed inode nevertheless.
+   */
+  bool GetPath(uint64_t inode, std::string* path);
+
+  /** Updates the paths of "path" and all paths below it to "new_path".
+   *
+   *  An inode previously known as "new_path" is removed, see Remove(). */
+  void Rename(const std::string& path, const std::string& new_path);
+
+  /** Detaches the inode of "path" from it after it was unlinked.
+   *
+   *  The inode stays valid until it is forgotten, but GetPath() fails for it.
+   *  A new file at "path" gets a new inode number. */
+  void Remove(const std::string& path);
+
+  /** Stores the inode number of "path" in "inode".
+   *
+   * @return false if "path" is unknown.
+   */
+  bool GetInode(const std::string& path, uint64_t* inode);
+
+  /** Records that "inode" is a hard link of the XtreemFS file "file_id". */
+  void SetFileId(uint64_t inode, uint64_t file_id);
+
+  /** Stores the other known inodes of the XtreemFS file of "inode" in
+   *  "links", including removed ones which were not forgotten yet.
+   *
+   *  "links" stays empty if no file id was recorded for "inode". */
+  void GetHardLinks(uint64_t inode, std::vector<uint64_t>* links);
+
+  /** Returns the number of known inodes, including the root. */
+  size_t Size();
+
+ private:
+  struct Entry {
+    Entry() : lookup_count(0), removed(false), file_id(0) {}
+
+    std::string path;
+    uint64_t lookup_count;
+    bool removed;
+    /** XtreemFS file id if the inode is a hard link, 0 otherwise. */
+    uint64_t file_id;
+  };
+
+  typedef std::map<uint64_t, Entry> InodeMap;
+  typedef std::map<std::string, uint64_t> PathMap;
+  /** Maps XtreemFS file ids to the inodes of their hard links. */
+  typedef std::multimap<uint64_t, uint64_t> FileIdMap;
+
+  /** Removes the mapping of "path", see Remove().
+   *
+   * @remark Requires a lock on mutex_.
+   */
+  void RemoveUnmutexed(const std::string& path);
+
+  /** Removes "inode" from the hard links of "file_id".
+   *
+   * @remark Requires a lock on mutex_.
+   */
+  void RemoveHardLinkUnmutexed(uint64_t file_id, uint64_t inode);
+
+  /** Protects all members below. */
+  boost::mutex mutex_;
+
+  uint64_t next_inode_;
+
+  InodeMap inodes_;
+
+  /** Paths of all inodes which were not removed. It's ordered to find all
+   *  paths below a directory with a range lookup. */
+  PathMap paths_;
+
+  /** Inodes for which a file id was recorded with SetFileId(). */
+  FileIdMap hard_links_;
+};
+
+}  // namespace xtreemfs
+
+#endif  // CPP_INCLUDE_FUSE_FUSE_INODE_TABLE_H_
@@ -0,0 +1,204 @@
+/*
+ * Copyright (c) 2015 by Zuse Institute Berlin
+ *
+ * Licensed under the BSD License, see LICENSE file for details.
+ *
+ */
+
+#ifndef CPP_INCLUDE_FUSE_FUSE_LOWLEVEL_ADAPTER_H_
+#define CPP_INCLUDE_FUSE_FUSE_LOWLEVEL_ADAPTER_H_
+
+#include <sys/types.h>
+#define FUSE_USE_VERSION 26
+#include <fuse.h>
+#include <fuse_lowlevel.h>
+
+#include <boost/thread/tss.hpp>
+#include <string>
+
+#include "fuse/fuse_inode_table.h"
+
+namespace xtreemfs {
+class FuseAdapter;
+class FuseOptions;
+
+/** Makes the context of a low-level request available to GetFuseContext()
+ *  and CheckIfOperationInterrupted() while the calling thread executes it.
+ *
+ * fuse_get_context() and fuse_interrupted() only work for the high-level Fuse
+ * API, so the FuseAdapter asks the request set by this class instead.
+ */
+class FuseLowLevelRequest {
+ public:
+  explicit FuseLowLevelRequest(fuse_req_t req);
+
+  ~FuseLowLevelRequest();
+
+  /** Returns the request executed by the calling thread or NULL. */
+  static FuseLowLevelRequest* current();
+
+  fuse_req_t req() const {
+    return req_;
+  }
+
+  struct fuse_context* context() {
+    return &context_;
+  }
+
+ private:
+  fuse_req_t req_;
+
+  struct fuse_context context_;
+
+  /** Request of the calling thread. Not owned, it's never deleted. */
+  static boost::thread_specific_ptr<FuseLowLevelRequest> current_;
+};
+
+/** Executes the operations of the Fuse low-level API.
+ *
+ * The kernel identifies files by the inode numbers of a FuseInodeTable which
+ * are resolved to paths for the path based operations of the FuseAdapter.
+ *
+ * Unlike the high-level API, the kernel is told how long it may cache a
+ * looked up entry and its attributes. Both timeouts are the TTL of the
+ * metadata cache (--metadata-cache-ttl-s), so the kernel does not ask again
+ * while libxtreemfs would answer from its cache anyway. Attributes of xctl
+ * files are never cached by the kernel as they may change without the kernel
+ * noticing.
+ *
+ * Hard links of a file have different inode numbers, so a change through one
+ * link is not seen by the kernel for the others. Their attributes are cached
+ * nevertheless and invalidated with fuse_lowlevel_notify_inval_inode() after
+ * every local change. Without a channel to send notifications (see
+ * SetChannel()), the attributes of hard links are not cached.
+ */
+class FuseLowLevelAdapter {
+ public:
+  FuseLowLevelAdapter(FuseAdapter* fuse_adapter, FuseOptions* options);
+
+  /** Sets the channel of the mounted session which is used to notify the
+   *  kernel of changed hard links. Must be called before the session loop
+   *  starts. */
+  void SetChannel(struct fuse_chan* channel);
+
+  // Fuse low-level operations as called by the placeholder functions in
+  // fuse_lowlevel_operations.h.
+  void lookup(fuse_req_t req, fuse_ino_t parent, const char *name);
+  void forget(fuse_req_t req, fuse_ino_t ino, unsigned long nlookup);
+  void getattr(fuse_req_t req, fuse_ino_t ino, struct fuse_file_info *fi);
+
+  /** Executes chmod, chown, truncate and utimens as requested by "to_set". */
+  void setattr(fuse_req_t req, fuse_ino_t ino, struct stat *attr, int to_set,
+               struct fuse_file_info *fi);
+
+  void readlink(fuse_req_t req, fuse_ino_t ino);
+  void mknod(fuse_req_t req, fuse_ino_t parent, const char *name, mode_t mode,
+             dev_t rdev);
+  void mkdir(fuse_req_t req, fuse_ino_t parent, const char *name,
+             mode_t mode);
+  void unlink(fuse_req_t req, fuse_ino_t parent, const char *name);
+  void rmdir(fuse_req_t req, fuse_ino_t parent, const char *name);
+  void symlink(fuse_req_t req, const char *link, fuse_ino_t parent,
+               const char *name);
+  void rename(fuse_req_t req, fuse_ino_t parent, const char *name,
+              fuse_ino_t newparent, const char *newname);
+  void link(fuse_req_t req, fuse_ino_t ino, fuse_ino_t newparent,
+            const char *newname);
+  void open(fuse_req_t req, fuse_ino_t ino, struct fuse_file_info *fi);
+  void read(fuse_req_t req, fuse_ino_t ino, size_t size, off_t off,
+            struct fuse_file_info *fi);
+  void write(fuse_req_t req, fuse_ino_t ino, const char *buf, size_t size,
+             off_t off, struct fuse_file_info *fi);
+  void flush(fuse_req_t req, fuse_ino_t ino, struct fuse_file_info *fi);
+  void release(fuse_req_t req, fuse_ino_t ino, struct fuse_file_info *fi);
+  void fsync(fuse_req_t req, fuse_ino_t ino, int datasync,
+             struct fuse_file_info *fi);
+  void opendir(fuse_req_t req, fuse_ino_t ino, struct fuse_file_info *fi);
+
+  /** Fills at most "size" bytes with directory entries starting at "off".
+   *
+   *  The FuseAdapter lists the directory with one MRC request which also
+   *  stores the attributes of all entries in the metadata cache. The following
+   *  lookups of the kernel are therefore answered without MRC requests. */
+  void readdir(fuse_req_t req, fuse_ino_t ino, size_t size, off_t off,
+               struct fuse_file_info *fi);
+
+  void releasedir(fuse_req_t req, fuse_ino_t ino, struct fuse_file_info *fi);
+  void statfs(fuse_req_t req, fuse_ino_t ino);
+  void setxattr(fuse_req_t req, fuse_ino_t ino, const char *name,
+                const char *value, size_t size, int flags);
+  void getxattr(fuse_req_t req, fuse_ino_t ino, const char *name,
+                size_t size);
+  void listxattr(fuse_req_t req, fuse_ino_t ino, size_t size);
+  void removexattr(fuse_req_t req, fuse_ino_t ino, const char *name);
+  void access(fuse_req_t req, fuse_ino_t ino, int mask);
+  void create(fuse_req_t req, fuse_ino_t parent, const char *name,
+              mode_t mode, struct fuse_file_info *fi);
+  void getlk(fuse_req_t req, fuse_ino_t ino, struct fuse_file_info *fi,
+             struct flock *lock);
+  void setlk(fuse_req_t req, fuse_ino_t ino, struct fuse_file_info *fi,
+             struct flock *lock, int sleep);
+
+ private:
+  /** Stores the path of "ino" in "path". Replies ENOENT and returns false if
+   *  the inode is unknown or was removed. */
+  bool GetPath(fuse_req_t req, fuse_ino_t ino, std::string* path);
+
+  /** Stores the path of "name" in the directory "parent" in "path". Replies
+   *  ENOENT and returns false if the parent is unknown. */
+  bool GetChildPath(fuse_req_t req,
+                    fuse_ino_t parent,
+                    const char *name,
+                    std::string* path);
+
+  /** Returns the last known path of "ino" which may have been removed
+   *  meanwhile. Used by operations on open files. */
+  std::string GetOpenFilePath(fuse_ino_t ino);
+
+  /** Retrieves the attributes of "path", looks it up in the inode table and
+   *  fills "entry".
+   *
+   * @return 0 or a negative errno.
+   */
+  int LookupEntry(const std::string& path, struct fuse_entry_param* entry);
+
+  /** Looks up "path" and replies the entry or the error. */
+  void ReplyEntry(fuse_req_t req, const std::string& path);
+
+  /** Retrieves the attributes of "path" with the inode "ino" and replies them
+   *  or the error. */
+  void ReplyAttr(fuse_req_t req, fuse_ino_t ino, const std::string& path);
+
+  /** Returns how long the kernel may cache the attributes "stat" of "path". */
+  double GetAttrTimeout(const std::string& path, const struct stat& stat);
+
+  /** Records "ino" as hard link if "stat" has more than one link. */
+  void TrackHardLink(fuse_ino_t ino, const struct stat& stat);
+
+  /** Invalidates the attributes which the kernel cached for the other hard
+   *  links of "ino" after the file was changed through "ino". */
+  void InvalidateHardLinks(fuse_ino_t ino);
+
+  /** Invalidates the attributes of the other hard links of "path", if it is
+   *  known. */
+  void InvalidateHardLinks(const std::string& path);
+
+  /** Returns how long the kernel may cache the entry "path". */
+  double GetEntryTimeout(const std::string& path);
+
+  /** Executes the path based operations. Not owned by this object. */
+  FuseAdapter* fuse_adapter_;
+
+  FuseInodeTable inode_table_;
+
+  /** Timeout in seconds of entries and attributes cached by the kernel. */
+  double timeout_s_;
+
+  /** Channel to send invalidation notifications to the kernel. Not owned by
+   *  this object. NULL if the attributes of hard links are not cached. */
+  struct fuse_chan* channel_;
+};
+
+}  // namespace xtreemfs
+
+#endif  // CPP_INCLUDE_FUSE_FUSE_LOWLEVEL_ADAPTER_H_
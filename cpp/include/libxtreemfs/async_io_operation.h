@@ -0,0 +1,157 @@
+/*
+ * Copyright (c) 2015 by Zuse Institute Berlin
+ *
+ * Licensed under the BSD License, see LICENSE file for details.
+ *
+ */
+
+#ifndef CPP_INCLUDE_LIBXTREEMFS_ASYNC_IO_OPERATION_H_
+#define CPP_INCLUDE_LIBXTREEMFS_ASYNC_IO_OPERATION_H_
+
+#include <stdint.h>
+
+#include <boost/function.hpp>
+#include <boost/scoped_ptr.hpp>
+#include <boost/thread/mutex.hpp>
+#include <vector>
+
+#include "libxtreemfs/file_handle.h"
+#include "rpc/callback_interface.h"
+#include "util/annotations.h"
+#include "util/synchronized_queue.h"
+#include "xtreemfs/OSD.pb.h"
+
+namespace xtreemfs {
+
+class FileHandleImplementation;
+class XtreemFSException;
+
+/** Tasks of asynchronous reads and writes which must not be executed by the
+ *  thread which receives the responses, e.g. because they block. */
+typedef util::SynchronizedQueue<boost::function0<void> > AsyncIOTaskQueue;
+
+/** State of a FileHandle::ReadAsync() or WriteAsync() call.
+ *
+ * The FileHandle splits the call into one request per object and sends all of
+ * them without waiting. Their responses are passed to the thread of the
+ * AsyncIOTaskQueue which copies the data and file sizes. An object whose
+ * request failed is read or written again with the synchronous Read() or
+ * Write() of the FileHandle, which takes care of the retries, redirects and
+ * XCap and view renewals. After the last object, the IOCompletedCallback is
+ * executed and the operation deletes itself.
+ */
+class AsyncIOOperation
+    : public rpc::CallbackInterface<pbrpc::ObjectData>,
+      public rpc::CallbackInterface<pbrpc::OSDWriteResponse> {
+ public:
+  /** "buffer" is written to the file if "is_write" is true, otherwise it is
+   *  filled with the data read from the file. */
+  AsyncIOOperation(FileHandleImplementation* file_handle,
+                   bool is_write,
+                   char* buffer,
+                   size_t count,
+                   int64_t offset,
+                   const FileHandle::IOCompletedCallback& completed,
+                   AsyncIOTaskQueue* task_queue);
+
+  /** Adds the object request of "size" bytes at "data" within the buffer and
+   *  returns the context which has to be passed with its request. */
+  void* AddObject(char* data, int size) LOCKS_EXCLUDED(mutex_);
+
+  /** The request of "context" could not be sent, it will be executed
+   *  synchronously. */
+  void ObjectNotSent(void* context) LOCKS_EXCLUDED(mutex_);
+
+  /** Has to be called after all object requests were sent. */
+  void SendingFinished() LOCKS_EXCLUDED(mutex_);
+
+  /** Sending the requests failed with "error". Called instead of
+   *  SendingFinished(). */
+  void SendingFailed(const XtreemFSException& error) LOCKS_EXCLUDED(mutex_);
+
+  /** Executes the whole operation synchronously instead of sending object
+   *  requests, e.g. if the data has to go through the object cache. */
+  void ExecuteSynchronously();
+
+  /** Executes the tasks of "task_queue" until the thread is interrupted. */
+  static void ProcessTasks(AsyncIOTaskQueue& task_queue);
+
+ private:
+  /** Part of the buffer which is read or written by one object request. */
+  struct ObjectPart {
+    char* data;
+    int size;
+  };
+
+  /** Response of a read request, passes it to HandleReadResponse(). */
+  virtual void CallFinished(pbrpc::ObjectData* response_message,
+                            char* data,
+                            uint32_t data_length,
+                            pbrpc::RPCHeader::ErrorResponse* error,
+                            void* context);
+
+  /** Response of a write request, passes it to HandleWriteResponse(). */
+  virtual void CallFinished(pbrpc::OSDWriteResponse* response_message,
+                            char* data,
+                            uint32_t data_length,
+                            pbrpc::RPCHeader::ErrorResponse* error,
+                            void* context);
+
+  void HandleReadResponse(pbrpc::ObjectData* response_message,
+                          char* data,
+                          uint32_t data_length,
+                          pbrpc::RPCHeader::ErrorResponse* error,
+                          void* context);
+
+  void HandleWriteResponse(pbrpc::OSDWriteResponse* response_message,
+                           char* data,
+                           uint32_t data_length,
+                           pbrpc::RPCHeader::ErrorResponse* error,
+                           void* context);
+
+  /** Reads or writes the part of "context" with the synchronous Read() or
+   *  Write() of the FileHandle. */
+  void ExecuteObjectSynchronously(void* context);
+
+  /** Adds the "bytes" of a finished object. Completes the operation after
+   *  the last one. */
+  void ObjectFinished(int bytes) LOCKS_EXCLUDED(mutex_);
+
+  /** Remembers the first error of the operation. */
+  void SetError(const XtreemFSException& error) LOCKS_EXCLUDED(mutex_);
+
+  /** Executes completed_ and deletes this object. */
+  void Complete();
+
+  FileHandleImplementation* file_handle_;
+
+  const bool is_write_;
+
+  char* buffer_;
+
+  const size_t count_;
+
+  const int64_t offset_;
+
+  FileHandle::IOCompletedCallback completed_;
+
+  AsyncIOTaskQueue* task_queue_;
+
+  boost::mutex mutex_;
+
+  std::vector<ObjectPart> parts_ GUARDED_BY(mutex_);
+
+  /** Number of objects which did not finish yet plus one until
+   *  SendingFinished() was called. */
+  int pending_ GUARDED_BY(mutex_);
+
+  /** Sum of the bytes read or written so far. */
+  int bytes_ GUARDED_BY(mutex_);
+
+  /** First error of an object or NULL. */
+  boost::scoped_ptr<XtreemFSException> error_ GUARDED_BY(mutex_);
+};
+
+}  // namespace xtreemfs
+
+#endif  // CPP_INCLUDE_LIBXTREEMFS_ASYNC_IO_OPERATION_H_
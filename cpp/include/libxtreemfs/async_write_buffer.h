@@ -0,0 +1,126 @@
+/*
+ * Copyright (c) 2011 by Michael Berlin, Zuse Institute Berlin
+ *
+ * Licensed under the BSD License, see LICENSE file for details.
+ *
+ */
+
+#ifndef CPP_INCLUDE_LIBXTREEMFS_ASYNC_WRITE_BUFFER_H_
+#define CPP_INCLUDE_LIBXTREEMFS_ASYNC_WRITE_BUFFER_H_
+
+#include <boost/date_time/posix_time/posix_time_types.hpp>
+#include <boost/function.hpp>
+#include <boost/shared_ptr.hpp>
+#include <string>
+
+namespace xtreemfs {
+
+namespace pbrpc {
+class writeRequest;
+}  // namespace pbrpc
+
+class FileHandleImplementation;
+class XCapHandler;
+
+/** Data of the caller which is written without copying it.
+ *
+ * All AsyncWriteBuffers of one FileHandle::WriteZeroCopy() call share this
+ * object. Once the last of them was deleted, the data is no longer used and
+ * "released" is executed.
+ */
+class BorrowedWriteData {
+ public:
+  explicit BorrowedWriteData(const boost::function0<void>& released)
+      : released_(released) {}
+
+  ~BorrowedWriteData() {
+    released_();
+  }
+
+ private:
+  boost::function0<void> released_;
+};
+
+struct AsyncWriteBuffer {
+  /** Possible states of this object. */
+  enum State {
+    PENDING,
+    FAILED,
+    SUCCEEDED
+  };
+
+  /**
+   * @remark Ownership of write_request is transferred to this object.
+   *         "data" is copied unless "borrowed_data" is set. Then "data"
+   *         belongs to the caller and is referenced until this object gets
+   *         deleted.
+   */
+  AsyncWriteBuffer(xtreemfs::pbrpc::writeRequest* write_request,
+                   const char* data,
+                   size_t data_length,
+                   FileHandleImplementation* file_handle,
+                   XCapHandler* xcap_handler,
+                   const boost::shared_ptr<BorrowedWriteData>& borrowed_data
+                       = boost::shared_ptr<BorrowedWriteData>());
+
+  /**
+   * @remark Ownership of write_request is transferred to this object.
+   *         "data" is copied unless "borrowed_data" is set.
+   */
+  AsyncWriteBuffer(xtreemfs::pbrpc::writeRequest* write_request,
+                   const char* data,
+                   size_t data_length,
+                   FileHandleImplementation* file_handle,
+                   XCapHandler* xcap_handler,
+                   const std::string& osd_uuid,
+                   const boost::shared_ptr<BorrowedWriteData>& borrowed_data
+                       = boost::shared_ptr<BorrowedWriteData>());
+
+  ~AsyncWriteBuffer();
+
+  /** Additional information of the write request. */
+  xtreemfs::pbrpc::writeRequest* write_request;
+
+  /** Actual payload of the write request. */
+  const char* data;
+
+  /** Set if "data" was not copied and belongs to the caller. */
+  boost::shared_ptr<BorrowedWriteData> borrowed_data;
+
+  /** Length of the payload. */
+  size_t data_length;
+
+  /** FileHandle which did receive the Write() command. */
+  FileHandleImplementation* file_handle;
+
+  /** XCapHandler, used to update the XCap in case of retries. */
+  XCapHandler* xcap_handler_;
+
+  /** Set to false if the member "osd_uuid" is used instead of the FileInfo's
+   *  osd_uuid_iterator in order to determine the OSD to be used. */
+  bool use_uuid_iterator;
+
+  /** UUID of the OSD which was used for the last retry or if use_uuid_iterator
+   *  is false, this variable is initialized to the OSD to be used. */
+  std::string osd_uuid;
+
+  /** Resolved UUID */
+  std::string service_address;
+
+  /** Current state of the object. */
+  State state_;
+
+  /** Retry count.*/
+  int retry_count_;
+
+  /** Time when the request was sent */
+  boost::posix_time::ptime request_sent_time;
+
+ private:
+  /** Points "data" to a copy of "data" or, if borrowed, to "data" itself. */
+  void SetData(const char* data);
+};
+
+}  // namespace xtreemfs
+
+#endif  // CPP_INCLUDE_LIBXTREEMFS_ASYNC_WRITE_BUFFER_H_
@@ -0,0 +1,139 @@
+/*
+ * Copyright (c) 2015 by Zuse Institute Berlin
+ *
+ * Licensed under the BSD License, see LICENSE file for details.
+ *
+ */
+
+#ifndef CPP_INCLUDE_LIBXTREEMFS_ASYNC_WRITE_COMBINER_H_
+#define CPP_INCLUDE_LIBXTREEMFS_ASYNC_WRITE_COMBINER_H_
+
+#include <stdint.h>
+
+#include <boost/date_time/posix_time/posix_time_types.hpp>
+#include <boost/thread/mutex.hpp>
+#include <string>
+
+namespace xtreemfs {
+
+namespace pbrpc {
+class writeRequest;
+}  // namespace pbrpc
+
+struct AsyncWriteBuffer;
+class AsyncWriteHandler;
+class FileHandleImplementation;
+class XCapHandler;
+
+/** Merges small asynchronous writes to the same object before they are passed
+ *  to the AsyncWriteHandler.
+ *
+ * One write is kept pending. A following write of the same FileHandle which
+ * overlaps or adjoins it in the same object is merged into it, as long as the
+ * merged write does not exceed "max_request_size". Otherwise, the pending
+ * write is sent and the new one becomes pending. A pending write is also sent
+ * once it reached "max_request_size" and by Flush() or FlushIfOlderThan().
+ *
+ * The pending write is sent while the internal mutex is held, so writes are
+ * passed to the AsyncWriteHandler in the order they were issued.
+ */
+class AsyncWriteCombiner {
+ public:
+  AsyncWriteCombiner(AsyncWriteHandler* async_write_handler,
+                     size_t max_request_size);
+
+  ~AsyncWriteCombiner();
+
+  /** Writes "data" asynchronously and merges it with the pending write if
+   *  possible.
+   *
+   *  If "osd_uuid" is empty, the OSD is chosen by the UUIDIterator of the
+   *  AsyncWriteHandler, see AsyncWriteBuffer.
+   *
+   * @remark Ownership of "write_request" is transferred to this object. "data"
+   *         is copied.
+   *
+   * @throws XtreemFSException if sending a write failed.
+   */
+  void Write(pbrpc::writeRequest* write_request,
+             const char* data,
+             size_t data_length,
+             FileHandleImplementation* file_handle,
+             XCapHandler* xcap_handler,
+             const std::string& osd_uuid);
+
+  /** Sends the pending write, if any.
+   *
+   * @throws XtreemFSException if sending the write failed.
+   */
+  void Flush();
+
+  /** Sends the pending write if it became pending before "deadline", a point
+   *  in time of util::MonotonicTime().
+   *
+   * @throws XtreemFSException if sending the write failed.
+   */
+  void FlushIfOlderThan(const boost::posix_time::ptime& deadline);
+
+  /** Returns the file size including the pending write or 0 if there is none.
+   */
+  int64_t GetPendingFileSize();
+
+ private:
+  /** Returns true if the write can be merged with the pending write. */
+  bool CanMerge(const pbrpc::writeRequest& write_request,
+                size_t data_length,
+                FileHandleImplementation* file_handle) const;
+
+  /** Copies "data" into the pending write which covers the union of both
+   *  ranges afterwards. */
+  void Merge(const pbrpc::writeRequest& write_request,
+             const char* data,
+             size_t data_length);
+
+  /** Sends the pending write.
+   *
+   * @remark Requires a lock on mutex_.
+   */
+  void FlushHelper();
+
+  /** Passes "write_buffer" to the AsyncWriteHandler. If that fails, the
+   *  asynchronous writes of its FileHandle are marked as failed.
+   *
+   * @remark Ownership of "write_buffer" is transferred.
+   */
+  void Send(AsyncWriteBuffer* write_buffer);
+
+  AsyncWriteHandler* async_write_handler_;
+
+  const size_t max_request_size_;
+
+  /** Protects all members below. */
+  boost::mutex mutex_;
+
+  /** Request of the pending write, NULL if there is none. Its offset is the
+   *  start of "data_". */
+  pbrpc::writeRequest* write_request_;
+
+  /** Data of the pending write. */
+  char* data_;
+
+  /** Length of "data_". */
+  size_t data_length_;
+
+  /** Allocated size of "data_". */
+  size_t capacity_;
+
+  FileHandleImplementation* file_handle_;
+
+  XCapHandler* xcap_handler_;
+
+  std::string osd_uuid_;
+
+  /** util::MonotonicTime() when the pending write became pending. */
+  boost::posix_time::ptime pending_since_;
+};
+
+}  // namespace xtreemfs
+
+#endif  // CPP_INCLUDE_LIBXTREEMFS_ASYNC_WRITE_COMBINER_H_
@@ -0,0 +1,338 @@
+/*
+ * Copyright (c) 2011-2012 by Michael Berlin, Zuse Institute Berlin
+ *
+ * Licensed under the BSD License, see LICENSE file for details.
+ *
+ */
+
+#ifndef CPP_INCLUDE_LIBXTREEMFS_CLIENT_IMPLEMENTATION_H_
+#define CPP_INCLUDE_LIBXTREEMFS_CLIENT_IMPLEMENTATION_H_
+
+#include <boost/scoped_ptr.hpp>
+#include <boost/thread/mutex.hpp>
+#include <gtest/gtest_prod.h>
+#include <list>
+#include <string>
+
+#include "libxtreemfs/client.h"
+#include "libxtreemfs/uuid_cache.h"
+#include "libxtreemfs/simple_uuid_iterator.h"
+#include "libxtreemfs/typedefs.h"
+#include "libxtreemfs/uuid_resolver.h"
+#include "util/synchronized_queue.h"
+#include "libxtreemfs/async_io_operation.h"
+#include "libxtreemfs/async_write_handler.h"
+#include "libxtreemfs/periodic_task_scheduler.h"
+#include "libxtreemfs/uuid_scorer.h"
+#include "rpc/server_statistics.h"
+#include "rpc/callback_interface.h"
+
+#include "xtreemfs/DIR.pb.h"
+
+namespace boost {
+class thread;
+}  // namespace boost
+
+namespace xtreemfs {
+
+class Options;
+class UUIDIterator;
+class Vivaldi;
+class Volume;
+class VolumeImplementation;
+
+namespace pbrpc {
+class DIRServiceClient;
+class OSDServiceClient;
+}  // namespace pbrpc
+
+namespace rpc {
+class Client;
+class SSLOptions;
+class ClientTestFastLingerTimeout_LingerTests_Test;  // see FRIEND_TEST @bottom.
+class ClientTestFastLingerTimeoutConnectTimeout_LingerTests_Test;
+}  // namespace rpc
+
+/** Resolves UUIDs with the DIR service and caches the results.
+ *
+ * Concurrent lookups of an unknown UUID send only one request to the DIR.
+ * Mappings are refreshed asynchronously before their TTL expires, so only
+ * UUIDs which were never looked up before block the caller.
+ */
+class DIRUUIDResolver
+    : public UUIDResolver,
+      public rpc::CallbackInterface<pbrpc::AddressMappingSet> {
+ public:
+  DIRUUIDResolver(
+      SimpleUUIDIterator& dir_uuid_iterator,
+      const pbrpc::UserCredentials& user_credentials,
+      const Options& options);
+
+  void Initialize(rpc::Client* network_client);
+
+  virtual void UUIDToAddress(const std::string& uuid, std::string* address);
+  virtual void UUIDToAddressWithOptions(const std::string& uuid,
+                                        std::string* address,
+                                        const RPCOptions& options);
+  virtual void PrefetchUUIDs(const std::vector<std::string>& uuids);
+  virtual void VolumeNameToMRCUUID(const std::string& volume_name,
+                                   std::string* uuid);
+  virtual void VolumeNameToMRCUUID(const std::string& volume_name,
+                                   SimpleUUIDIterator* uuid_iterator);
+  virtual std::vector<std::string> VolumeNameToMRCUUIDs(const std::string& volume_name);
+
+ private:
+  SimpleUUIDIterator& dir_uuid_iterator_;
+  /** The auth_type of this object will always be set to AUTH_NONE. */
+
+  // TODO(mberlin): change this when the DIR service supports real auth.
+  pbrpc::Auth dir_service_auth_;
+
+  /** These credentials will be used for messages to the DIR service. */
+  const pbrpc::UserCredentials dir_service_user_credentials_;
+
+  /** A DIRServiceClient is a wrapper for a RPC Client. */
+  boost::scoped_ptr<pbrpc::DIRServiceClient> dir_service_client_;
+
+  /** Caches service UUIDs -> (address, port, TTL). */
+  UUIDCache uuid_cache_;
+
+  /** Options class which contains the log_level string and logfile path. */
+  const Options& options_;
+
+  pbrpc::ServiceSet* GetServicesByName(const std::string& volume_name);
+
+  /** Stores the mapping of "uuid" for a local network or the default one of
+   *  "mappings" in the cache and returns its address.
+   *
+   * @throws AddressToUUIDNotFoundException
+   * @throws UnknownAddressSchemeException
+   */
+  std::string UpdateCache(const std::string& uuid,
+                          const pbrpc::AddressMappingSet& mappings);
+
+  /** Sends an asynchronous request to resolve "uuid". The caller must have
+   *  been told to resolve or refresh "uuid" by UUIDCache::Lookup(). */
+  void ResolveAsync(const std::string& uuid);
+
+  /** Implements callback for an async xtreemfs_address_mappings_get request.
+   *  "context" is the resolved UUID. */
+  virtual void CallFinished(pbrpc::AddressMappingSet* response_message,
+                            char* data,
+                            uint32_t data_length,
+                            pbrpc::RPCHeader::ErrorResponse* error,
+                            void* context);
+};
+
+/**
+ * Default Implementation of the XtreemFS C++ client interfaces.
+ */
+class ClientImplementation : public Client {
+ public:
+  ClientImplementation(
+      const ServiceAddresses& dir_service_addresses,
+      const pbrpc::UserCredentials& user_credentials,
+      const rpc::SSLOptions* ssl_options,
+      const Options& options);
+  virtual ~ClientImplementation();
+
+  virtual void Start();
+  virtual void Shutdown();
+
+  virtual Volume* OpenVolume(
+      const std::string& volume_name,
+      const rpc::SSLOptions* ssl_options,
+      const Options& options);
+  virtual void CloseVolume(xtreemfs::Volume* volume);
+
+  virtual void CreateVolume(
+      const ServiceAddresses& mrc_address,
+      const pbrpc::Auth& auth,
+      const pbrpc::UserCredentials& user_credentials,
+      const std::string& volume_name,
+      int mode,
+      const std::string& owner_username,
+      const std::string& owner_groupname,
+      const pbrpc::AccessControlPolicyType& access_policy_type,
+      long volume_quota,
+      const pbrpc::StripingPolicyType& default_striping_policy_type,
+      int default_stripe_size,
+      int default_stripe_width,
+      const std::list<pbrpc::KeyValuePair*>& volume_attributes);
+
+  virtual void CreateVolume(
+      const ServiceAddresses& mrc_address,
+      const xtreemfs::pbrpc::Auth& auth,
+      const xtreemfs::pbrpc::UserCredentials& user_credentials,
+      const std::string& volume_name,
+      int mode,
+      const std::string& owner_username,
+      const std::string& owner_groupname,
+      const xtreemfs::pbrpc::AccessControlPolicyType& access_policy_type,
+      long quota,
+      const xtreemfs::pbrpc::StripingPolicyType& default_striping_policy_type,
+      int default_stripe_size,
+      int default_stripe_width,
+      const std::map<std::string, std::string>& volume_attributes);
+
+  virtual void CreateVolume(
+      const xtreemfs::pbrpc::Auth& auth,
+      const xtreemfs::pbrpc::UserCredentials& user_credentials,
+      const std::string& volume_name,
+      int mode,
+      const std::string& owner_username,
+      const std::string& owner_groupname,
+      const xtreemfs::pbrpc::AccessControlPolicyType& access_policy_type,
+      long volume_quota,
+      const xtreemfs::pbrpc::StripingPolicyType& default_striping_policy_type,
+      int default_stripe_size,
+      int default_stripe_width,
+      const std::map<std::string, std::string>& volume_attributes);
+
+  virtual void DeleteVolume(
+      const ServiceAddresses& mrc_address,
+      const pbrpc::Auth& auth,
+      const pbrpc::UserCredentials& user_credentials,
+      const std::string& volume_name);
+
+  virtual void DeleteVolume(
+      const xtreemfs::pbrpc::Auth& auth,
+      const xtreemfs::pbrpc::UserCredentials& user_credentials,
+      const std::string& volume_name);
+
+  virtual pbrpc::Volumes* ListVolumes(
+      const ServiceAddresses& mrc_addresses,
+      const pbrpc::Auth& auth);
+
+  virtual std::vector<std::string> ListVolumeNames();
+
+  virtual UUIDResolver* GetUUIDResolver();
+
+  virtual std::string UUIDToAddress(const std::string& uuid);
+
+  virtual void GetServerScores(std::map<std::string, rpc::ServerScore>* scores);
+
+  /** Returns a ServiceSet with all services of the given type.
+   *
+   * @param serviceType Type of the Service
+   *
+   * @throws IOException
+   * @throws PosixErrorException
+   *
+   * @remark Ownership of the return value is transferred to the caller. */
+  pbrpc::ServiceSet* GetServicesByType(const xtreemfs::pbrpc::ServiceType service_type);
+
+  /** Returns a ServiceSet with all services of the given name
+   *
+   * @param string Name of the Service
+   *
+   * @throws IOException
+   * @throws PosixErrorException
+   *
+   * @remark Ownership of the return value is transferred to the caller. */
+  pbrpc::ServiceSet* GetServicesByName(const std::string service_name);
+
+  const pbrpc::VivaldiCoordinates& GetVivaldiCoordinates() const;
+
+  util::SynchronizedQueue<AsyncWriteHandler::CallbackEntry>& GetAsyncWriteCallbackQueue();
+
+  /** Returns the queue whose tasks complete FileHandle::ReadAsync() and
+   *  WriteAsync() calls. */
+  AsyncIOTaskQueue& GetAsyncIOTaskQueue();
+
+  /** Returns the RPC Client which all volumes share if
+   *  Options::shared_rpc_runtime is set, NULL otherwise.
+   *
+   * @remark Ownership is NOT transferred to the caller. */
+  rpc::Client* shared_network_client();
+
+  /** Returns the scheduler which runs the periodic tasks of all volumes if
+   *  Options::shared_rpc_runtime is set, NULL otherwise.
+   *
+   * @remark Ownership is NOT transferred to the caller. */
+  PeriodicTaskScheduler* periodic_task_scheduler();
+
+  /** Returns the response times and error rates which all RPC Clients of this
+   *  Client and its volumes measured per server address.
+   *
+   * @remark Ownership is NOT transferred to the caller. */
+  rpc::ServerStatistics* server_statistics();
+
+  /** Returns the scorer which looks up UUIDs in server_statistics().
+   *
+   * @remark Ownership is NOT transferred to the caller. */
+  UUIDScorer* uuid_scorer();
+
+ private:
+  /** Writes the metrics to Options::metrics_dump_file (periodic task). */
+  void WriteMetricsDumpFile();
+
+  /** True if Shutdown() was executed. */
+  bool was_shutdown_;
+
+  /** Auth of type AUTH_NONE which is required for most operations which do not
+   *  check the authentication data (except Create, Delete, ListVolume(s)). */
+  xtreemfs::pbrpc::Auth auth_bogus_;
+
+  /** The auth_type of this object will always be set to AUTH_NONE. */
+  // TODO(mberlin): change this when the DIR service supports real auth.
+  xtreemfs::pbrpc::Auth dir_service_auth_;
+
+  /** These credentials will be used for messages to the DIR service. */
+  xtreemfs::pbrpc::UserCredentials dir_service_user_credentials_;
+
+  /** Options class which contains the log_level string and logfile path. */
+  const xtreemfs::Options& options_;
+
+  std::list<VolumeImplementation*> list_open_volumes_;
+  boost::mutex list_open_volumes_mutex_;
+
+  const rpc::SSLOptions* dir_service_ssl_options_;
+
+  /** The RPC Client processes requests from a queue and executes callbacks in
+   * its thread. */
+  boost::scoped_ptr<rpc::Client> network_client_;
+  boost::scoped_ptr<boost::thread> network_client_thread_;
+
+  /** A DIRServiceClient is a wrapper for a RPC Client. */
+  boost::scoped_ptr<pbrpc::DIRServiceClient> dir_service_client_;
+
+
+  SimpleUUIDIterator dir_uuid_iterator_;
+  DIRUUIDResolver uuid_resolver_;
+
+  /** Fed by network_client_ and the RPC Clients of all volumes. */
+  rpc::ServerStatistics server_statistics_;
+  ServerStatisticsUUIDScorer uuid_scorer_;
+
+  /** Random, non-persistent UUID to distinguish locks of different clients. */
+  std::string client_uuid_;
+
+  /** Vivaldi thread, periodically updates vivaldi-coordinates. */
+  boost::scoped_ptr<boost::thread> vivaldi_thread_;
+  boost::scoped_ptr<Vivaldi> vivaldi_;
+  boost::scoped_ptr<pbrpc::OSDServiceClient> osd_service_client_;
+
+  /** Thread that handles the callbacks for asynchronous writes. */
+  boost::scoped_ptr<boost::thread> async_write_callback_thread_;
+  /** Holds the Callbacks enqueued be CallFinished() (producer). They are
+   *  processed by ProcessCallbacks(consumer), running in its own thread. */
+  util::SynchronizedQueue<AsyncWriteHandler::CallbackEntry> async_write_callback_queue_;
+
+  /** Thread which executes the tasks of async_io_task_queue_. */
+  boost::scoped_ptr<boost::thread> async_io_thread_;
+  /** Responses of ReadAsync() and WriteAsync() requests and their retries,
+   *  processed by AsyncIOOperation::ProcessTasks(). */
+  AsyncIOTaskQueue async_io_task_queue_;
+
+  /** Runs the periodic tasks of all volumes if Options::shared_rpc_runtime is
+   *  set and writes the Options::metrics_dump_file. */
+  PeriodicTaskScheduler periodic_task_scheduler_;
+
+  FRIEND_TEST(rpc::ClientTestFastLingerTimeout, LingerTests);
+  FRIEND_TEST(rpc::ClientTestFastLingerTimeoutConnectTimeout, LingerTests);
+};
+
+}  // namespace xtreemfs
+
+#endif  // CPP_INCLUDE_LIBXTREEMFS_CLIENT_IMPLEMENTATION_H_
@@ -0,0 +1,830 @@
+/*
+ * Copyright (c) 2011 by Michael Berlin,
+ *               2015 by Robert Bärhold
+ *                    Zuse Institute Berlin
+ *
+ * Licensed under the BSD License, see LICENSE file for details.
+ *
+ */
+
+#ifndef CPP_INCLUDE_LIBXTREEMFS_FILE_HANDLE_IMPLEMENTATION_H_
+#define CPP_INCLUDE_LIBXTREEMFS_FILE_HANDLE_IMPLEMENTATION_H_
+
+#include <stdint.h>
+
+#include <boost/date_time/posix_time/posix_time_types.hpp>
+#include <boost/function.hpp>
+#include <boost/thread/condition.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/scoped_ptr.hpp>
+#include <boost/shared_ptr.hpp>
+#include <gtest/gtest_prod.h>
+#include <list>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "pbrpc/RPC.pb.h"
+#include "rpc/callback_interface.h"
+#include "xtreemfs/GlobalTypes.pb.h"
+#include "xtreemfs/MRC.pb.h"
+#include "xtreemfs/OSD.pb.h"
+#include "libxtreemfs/client_implementation.h"
+#include "libxtreemfs/file_handle.h"
+#include "libxtreemfs/interrupt.h"
+#include "libxtreemfs/osd_offsets.h"
+#include "libxtreemfs/stripe_translator.h"
+#include "libxtreemfs/xcap_handler.h"
+#include "libxtreemfs/xtreemfs_exception.h"
+
+namespace xtreemfs {
+
+namespace rpc {
+class Client;
+class SyncCallbackBase;
+}  // namespace rpc
+
+namespace pbrpc {
+class FileCredentials;
+class Lock;
+class MRCServiceClient;
+class OSDServiceClient;
+class readRequest;
+class writeRequest;
+}  // namespace pbrpc
+
+namespace util {
+class ReedSolomon;
+}  // namespace util
+
+class AsyncIOOperation;
+class BorrowedWriteData;
+class FileInfo;
+class Options;
+class ReplicaSelector;
+class UUIDContainer;
+class UUIDIterator;
+class UUIDResolver;
+class Volume;
+class XCapManager;
+class VoucherManager;
+class VoucherManagerCallback;
+
+class VoucherManager : public rpc::CallbackInterface<xtreemfs::pbrpc::OSDFinalizeVouchersResponse> {
+ public:
+  VoucherManager(FileInfo* file_info, XCapManager* xcap_manager,
+                 pbrpc::MRCServiceClient* mrc_service_client,
+                 pbrpc::OSDServiceClient* osd_service_client_,
+                 UUIDResolver* uuid_resolver, UUIDIterator* mrc_uuid_iterator,
+                 UUIDIterator* osd_uuid_iterator,
+                 const Options& volume_options,
+                 const pbrpc::Auth& auth_bogus,
+                 const pbrpc::UserCredentials& user_credentials_bogus);
+
+  /** Handles the overall process of the finalize and clear voucher protocol. */
+  void finalizeAndClear();
+ private:
+  /** Sends out the finalize voucher request in an asynchronous manner to all relevant OSDs. */
+  void finalizeVoucher(xtreemfs::pbrpc::xtreemfs_finalize_vouchersRequest* finalizeVouchersRequest,
+                       VoucherManagerCallback* callback);
+
+  /** Sends out the clear voucher request to the MRC containing all OSD responses. */
+  void clearVoucher(xtreemfs::pbrpc::xtreemfs_clear_vouchersRequest* clearVouchersRequest);
+
+  /** Checks the consistency of all finalize OSD responses and returns true on equality. */
+  bool checkResponseConsistency();
+
+  /** Deletes every object in the osdFinalizeVoucherResponseVector_ and clears it. */
+  void cleanupOSDResponses();
+
+  /** Implements callback for the finalize voucher requests from the OSDs,
+   * saving all responses in the osdFinalizeVoucherResponseVector_. */
+  virtual void CallFinished(xtreemfs::pbrpc::OSDFinalizeVouchersResponse* response_message,
+                            char* data,
+                            uint32_t data_length,
+                            pbrpc::RPCHeader::ErrorResponse* error,
+                            void* context);
+
+  /** Use this mutex guarantee a single call of finalize and clear. */
+  boost::mutex mutex_;
+
+  /** Used to wait on the condition. */
+  boost::mutex cond_mutex_;
+
+  /** Used to wait for finalize voucher respones of used OSDs. */
+  boost::condition osd_finalize_pending_cond;
+
+  /** number of osds, we expect a reponse of. */
+  int osdCount;
+
+  /** Used to save current finalize voucher responses from the OSDs. */
+  std::vector<xtreemfs::pbrpc::OSDFinalizeVouchersResponse*> osdFinalizeVoucherResponseVector_;
+
+
+  /** Multiple FileHandle may refer to the same File and therefore unique file
+   * properties (e.g. Path, FileId, XlocSet) are stored in a FileInfo object. */
+  FileInfo* file_info_;
+
+  /** Pointer to the XCapManager instance of the file handle. */
+  XCapManager* xcap_manager_;
+
+  /** Pointer to object owned by VolumeImplemention */
+  pbrpc::MRCServiceClient* mrc_service_client_;
+
+  /** Pointer to object owned by VolumeImplemention */
+  pbrpc::OSDServiceClient* osd_service_client_;
+
+  /** Pointer to object owned by VolumeImplemention. Used for reads whose
+   *  data is received directly into the caller's buffer. */
+  rpc::Client* network_client_;
+
+  /** UUID resolver*/
+  UUIDResolver* uuid_resolver_;
+
+  /** UUIDIterator of the MRC. */
+  UUIDIterator* mrc_uuid_iterator_;
+
+  /** UUIDIterator which contains the UUIDs of all replicas. */
+  UUIDIterator* osd_uuid_iterator_;
+
+  /** Volume options used in the requests. */
+  const Options& volume_options_;
+
+  /** Auth needed for ServiceClients. Always set to AUTH_NONE by Volume. */
+  const pbrpc::Auth& auth_bogus_;
+
+  /** For same reason needed as auth_bogus_. Always set to user "xtreemfs". */
+  const pbrpc::UserCredentials& user_credentials_bogus_;
+};
+
+class VoucherManagerCallback : public rpc::CallbackInterface<xtreemfs::pbrpc::OSDFinalizeVouchersResponse> {
+ public:
+  VoucherManagerCallback(VoucherManager* voucherManager,
+                         const int tryNo,
+                         const int osdCount);
+
+  /** Unregisters the VoucherManager that created the Callback.
+   * If there are finalize voucher requests in flight, the Callback
+   * will be kept in memory until every response has arrived.
+   * Otherwise the Callback will destroy itself. */
+  void unregisterManager();
+
+ private:
+  /** Implements callback for the finalize voucher requests from the OSDs.
+   * Redirects every response to the registered VoucherManager CallFinished.
+   * If no VoucherManager is registered the responses are discarded/freed.
+   * If no VoucherManager is registered and every finalize voucher response
+   * has arrived, the VoucherManagerCallback destroys itself. */
+  virtual void CallFinished(xtreemfs::pbrpc::OSDFinalizeVouchersResponse* response_message,
+                            char* data,
+                            uint32_t data_length,
+                            pbrpc::RPCHeader::ErrorResponse* error,
+                            void* context);
+
+  /** Use this mutex to guard changes/checks to voucherManager_. */
+  boost::mutex mutex_;
+
+  /** The VoucherManager that created this Callback.
+   * Or NULL if it has been unregistered. */
+  rpc::CallbackInterface<xtreemfs::pbrpc::OSDFinalizeVouchersResponse>* voucherManager_;
+  /** The number of the try on which this callback was created. */
+  const int tryNo_;
+  /** The number of OSDs and respective number of requests sent for this try. */
+  const int osdCount_;
+  /** The number of responses for this try. */
+  int respCount_;
+};
+
+class XCapManager :
+    public rpc::CallbackInterface<xtreemfs::pbrpc::XCap>,
+    public XCapHandler {
+ public:
+  XCapManager(
+      const xtreemfs::pbrpc::XCap& xcap,
+      pbrpc::MRCServiceClient* mrc_service_client,
+      UUIDResolver* uuid_resolver,
+      UUIDIterator* mrc_uuid_iterator,
+      const pbrpc::Auth& auth_bogus,
+      const pbrpc::UserCredentials& user_credentials_bogus);
+
+  /** Renew xcap_ asynchronously. */
+  void RenewXCapAsync(const RPCOptions& options);
+
+  /** Renew xcap_ asynchronously. Add writeback, in case of an error */
+  void RenewXCapAsync(const RPCOptions& options, const bool increaseVoucher,
+                      PosixErrorException* writeback);
+
+  /** Blocks until the callback has completed (if an XCapRenewal is pending). */
+  void WaitForPendingXCapRenewal();
+
+  /** Marks a renewal as pending and copies the XCap to renew into "xcap".
+   *  Used by the MRCRequestBatcher which renews the XCaps of many files with
+   *  one request. XCapRenewalFinished() has to be called afterwards.
+   *
+   * @return false if a renewal is already pending.
+   */
+  bool StartXCapRenewal(xtreemfs::pbrpc::XCap* xcap);
+
+  /** Stores "new_xcap" if it's newer and ends the pending renewal. "error" is
+   *  logged if set. If both are NULL, the renewal is ended without changes. */
+  void XCapRenewalFinished(const xtreemfs::pbrpc::XCap* new_xcap,
+                           const pbrpc::RPCHeader::ErrorResponse* error);
+
+  /** XCapHandler: Get current capability.*/
+  virtual void GetXCap(xtreemfs::pbrpc::XCap* xcap);
+
+  /** Update the capability with the provided one. */
+  void SetXCap(const xtreemfs::pbrpc::XCap& xcap);
+
+  /** Get the file id from the capability. */
+  uint64_t GetFileId();
+
+  /** Returns the list of old expire times. */
+  std::list< ::google::protobuf::uint64>& GetOldExpireTimes();
+
+  /** Acquires the mutex related to list of old expire times. */
+  void acquireOldExpireTimesMutex();
+
+  /** Releases the mutex related to list of old expire times. */
+  void releaseOldExpireTimesMutex();
+
+ private:
+  /** Implements callback for an async xtreemfs_renew_capability request. */
+  virtual void CallFinished(xtreemfs::pbrpc::XCap* new_xcap,
+                            char* data,
+                            uint32_t data_length,
+                            pbrpc::RPCHeader::ErrorResponse* error,
+                            void* context);
+
+  /** Any modification to the object must obtain a lock first. */
+  boost::mutex mutex_;
+
+  /** Capabilitiy for the file, used to authorize against services */
+  xtreemfs::pbrpc::XCap xcap_;
+
+  /** True if there is an outstanding xcap_renew callback. */
+  bool xcap_renewal_pending_;
+
+  /** Used to wait for pending XCap renewal callbacks. */
+  boost::condition xcap_renewal_pending_cond_;
+
+  /** Used to keep track of possible writebacks of errros, occured at the renewal. */
+  std::list<PosixErrorException*> xcap_renewal_error_writebacks_;
+
+  /** Any modification on the xcap_renewal_error_writebacks_ list have to obtain this lock first. */
+  boost::mutex xcap_renewal_error_writebacks_mutex_;
+
+  /** Used to keep track of old expire times to finalize voucher requests. **/
+  std::list< ::google::protobuf::uint64> old_expire_times_;
+
+  /** Use this to protect old_expire_times. */
+  boost::mutex old_expire_times_mutex_;
+
+  /** UUIDIterator of the MRC. */
+  pbrpc::MRCServiceClient* mrc_service_client_;
+  UUIDResolver* uuid_resolver_;
+  UUIDIterator* mrc_uuid_iterator_;
+
+  /** Auth needed for ServiceClients. Always set to AUTH_NONE by Volume. */
+  const pbrpc::Auth auth_bogus_;
+
+  /** For same reason needed as auth_bogus_. Always set to user "xtreemfs". */
+  const pbrpc::UserCredentials user_credentials_bogus_;
+};
+
+/** Default implementation of the FileHandle Interface. */
+class FileHandleImplementation
+    : public FileHandle,
+      public XCapHandler,
+      public rpc::CallbackInterface<pbrpc::timestampResponse> {
+ public:
+  FileHandleImplementation(
+      ClientImplementation* client,
+      const std::string& client_uuid,
+      FileInfo* file_info,
+      const pbrpc::XCap& xcap,
+      UUIDIterator* mrc_uuid_iterator,
+      UUIDIterator* osd_uuid_iterator,
+      UUIDResolver* uuid_resolver,
+      pbrpc::MRCServiceClient* mrc_service_client,
+      pbrpc::OSDServiceClient* osd_service_client,
+      rpc::Client* network_client,
+      const std::map<pbrpc::StripingPolicyType,
+                     StripeTranslator*>& stripe_translators,
+      bool async_writes_enabled,
+      const Options& options,
+      const pbrpc::Auth& auth_bogus,
+      const pbrpc::UserCredentials& user_credentials_bogus);
+
+  virtual ~FileHandleImplementation();
+
+  virtual int Read(char *buf, size_t count, int64_t offset);
+
+  virtual int Write(const char *buf, size_t count, int64_t offset);
+
+  virtual int ReadV(const struct iovec* iov, int iovcnt, int64_t offset);
+
+  virtual int WriteV(const struct iovec* iov, int iovcnt, int64_t offset);
+
+  virtual int WriteZeroCopy(const char *buf,
+                            size_t count,
+                            int64_t offset,
+                            const BufferReleasedCallback& buffer_released);
+
+  virtual void ReadAsync(char *buf,
+                         size_t count,
+                         int64_t offset,
+                         const IOCompletedCallback& completed);
+
+  virtual void WriteAsync(const char *buf,
+                          size_t count,
+                          int64_t offset,
+                          const IOCompletedCallback& completed);
+
+  /** Remembers the file size of a successful write for the next file size
+   *  update towards the MRC and discards the objects which were read ahead,
+   *  as they may have been fetched before the write arrived at the OSD.
+   *
+   * @remark Ownership of "write_response" is transferred. */
+  void RegisterWriteResponse(pbrpc::OSDWriteResponse* write_response);
+
+  /** Sets the checksum of "object_data" to the CRC32C checksum of the
+   *  "length" bytes at "data" if object checksums are enabled. */
+  void SetObjectChecksum(const char* data,
+                         size_t length,
+                         pbrpc::ObjectData* object_data);
+
+  /** Returns false if the read "data" of "object_data" is corrupted, see
+   *  IsObjectDataValid(). */
+  bool VerifyObjectData(const pbrpc::ObjectData& object_data,
+                        const char* data,
+                        size_t length);
+
+  virtual void Flush();
+
+  virtual void Truncate(
+      const pbrpc::UserCredentials& user_credentials,
+      int64_t new_file_size);
+
+  /** Used by Truncate() and Volume->OpenFile() to truncate the file to
+   *  "new_file_size" on the OSD and update the file size at the MRC.
+   *
+   * @throws AddressToUUIDNotFoundException
+   * @throws IOException
+   * @throws PosixErrorException
+   * @throws UnknownAddressSchemeException
+   **/
+  void TruncatePhaseTwoAndThree(int64_t new_file_size);
+
+  virtual void GetAttr(
+      const pbrpc::UserCredentials& user_credentials,
+      pbrpc::Stat* stat);
+
+  virtual xtreemfs::pbrpc::Lock* AcquireLock(
+      int process_id,
+      uint64_t offset,
+      uint64_t length,
+      bool exclusive,
+      bool wait_for_lock);
+
+  virtual xtreemfs::pbrpc::Lock* CheckLock(
+      int process_id,
+      uint64_t offset,
+      uint64_t length,
+      bool exclusive);
+
+  virtual void ReleaseLock(
+      int process_id,
+      uint64_t offset,
+      uint64_t length,
+      bool exclusive);
+
+  /** Also used by FileInfo object to free active locks. */
+  void ReleaseLock(const pbrpc::Lock& lock);
+
+  virtual void ReleaseLockOfProcess(int process_id);
+
+  virtual void PingReplica(const std::string& osd_uuid);
+
+  virtual void Close();
+
+  /** Returns the StripingPolicy object for a given type (e.g. Raid0).
+   *
+   *  @remark Ownership is NOT transferred to the caller.
+   */
+  const StripeTranslator* GetStripeTranslator(
+      pbrpc::StripingPolicyType type);
+
+  /** Sets async_writes_failed_ to true. */
+  void MarkAsyncWritesAsFailed();
+  /** Thread-safe check if async_writes_failed_ */
+  bool DidAsyncWritesFail();
+  /** Thread-safe check and throw if async_writes_failed_ */
+  void ThrowIfAsyncWritesFailed();
+
+  /** Sends pending file size updates synchronous (needed for flush/close).
+   *
+   * @throws AddressToUUIDNotFoundException
+   * @throws IOException
+   * @throws PosixErrorException
+   * @throws UnknownAddressSchemeException
+   */
+  void WriteBackFileSize(const pbrpc::OSDWriteResponse& owr,
+                         bool close_file);
+
+  /** Sends osd_write_response_for_async_write_back_ asynchronously. */
+  void WriteBackFileSizeAsync(const RPCOptions& options);
+
+  /** Fills "rq" with osd_write_response_for_async_write_back_ and the XCap,
+   *  e.g. to be sent as part of a batch by the MRCRequestBatcher. */
+  void GetFileSizeUpdateRequest(pbrpc::xtreemfs_update_file_sizeRequest* rq);
+
+  /** Reports the result of the asynchronous file size update to the FileInfo
+   *  which deletes this temporary FileHandle. */
+  void FileSizeUpdateFinished(bool success);
+
+  /** Overwrites the current osd_write_response_ with "owr". */
+  void set_osd_write_response_for_async_write_back(
+      const pbrpc::OSDWriteResponse& owr);
+
+  /** Wait for all asyncronous operations to finish */
+  void WaitForAsyncOperations();
+
+  /** Execute period tasks */
+  void ExecutePeriodTasks(const RPCOptions& options);
+  
+  /** XCapHandler: Get current capability. */
+  virtual void GetXCap(xtreemfs::pbrpc::XCap* xcap);
+
+  /** @remark Ownership is NOT transferred to the caller. */
+  XCapManager* xcap_manager() {
+    return &xcap_manager_;
+  }
+
+ private:
+  /**
+   * Execute the operation and check on invalid view exceptions.
+   * If the operation was executed with an outdated, the view
+   * will be renewed and the operation retried.
+   */
+  template<typename T>
+  T ExecuteViewCheckedOperation(boost::function<T()> operation);
+
+  /** Renew the xLocSet synchronously. */
+  void RenewXLocSet();
+
+  /** Implements callback for an async xtreemfs_update_file_size request. */
+  virtual void CallFinished(
+      pbrpc::timestampResponse* response_message,
+      char* data,
+      uint32_t data_length,
+      pbrpc::RPCHeader::ErrorResponse* error,
+      void* context);
+
+  /** Same as Flush(), takes special actions if called by Close(). */
+  void Flush(bool close_file);
+
+  /** Actual implementation of Flush(). */
+  void DoFlush(bool close_file);
+
+  /** Actual implementation of Read() and ReadV(). */
+  int DoRead(
+      const struct iovec* iov,
+      int iovcnt,
+      int64_t offset);
+
+  /** Read data from the OSD. Objects owned by the caller. */
+  int ReadFromOSD(
+      UUIDIterator* uuid_iterator,
+      const pbrpc::FileCredentials& file_credentials,
+      int object_no,
+      char* buffer,
+      int offset_in_object,
+      int bytes_to_read);
+
+  /** Reads "operation" from the replicas "osd_uuids" of a read-only file in
+   *  the order chosen by "replica_selector" and feeds the measured latency
+   *  back. The read is hedged if the selector provides a hedge delay. Falls
+   *  back to ReadFromOSD() with "uuid_iterator", which iterates over
+   *  "osd_uuids", if no replica answered. */
+  int ReadFromReplicas(
+      ReplicaSelector* replica_selector,
+      UUIDIterator* uuid_iterator,
+      const std::vector<std::string>& osd_uuids,
+      const pbrpc::FileCredentials& file_credentials,
+      const ReadOperation& operation);
+
+  /** Sends the read of "operation" to "osd_uuids"[0] and, if it did not
+   *  succeed until "hedge_deadline", also to "osd_uuids"[1]. Returns the
+   *  number of bytes read or -1 if no read succeeded. "winner_uuid" is set to
+   *  the OSD which answered first. */
+  int HedgedReadFromOSDs(
+      const std::vector<std::string>& osd_uuids,
+      const pbrpc::FileCredentials& file_credentials,
+      const ReadOperation& operation,
+      const boost::posix_time::ptime& hedge_deadline,
+      std::string* winner_uuid);
+
+  /** Reads all "operations" with up to volume_options_.max_parallel_reads
+   *  requests in flight. Objects whose request failed are read again with
+   *  ReadFromOSD() which takes care of retries and XCap renewals.
+   *
+   *  "uuid_iterators" contains the UUIDIterator of each operation,
+   *  "received_per_operation" receives the number of bytes read by each
+   *  operation and has to have the size of "operations". */
+  int ReadFromOSDsInParallel(
+      const std::vector<UUIDIterator*>& uuid_iterators,
+      const pbrpc::FileCredentials& file_credentials,
+      const std::vector<ReadOperation>& operations,
+      std::vector<int>* received_per_operation);
+
+  /** Reads all "operations" in parallel if enabled, from the replicas
+   *  ordered by "replica_selector" (see ReadFromReplicas()) if it is not
+   *  NULL, or from the OSDs of "uuid_iterators" otherwise. Returns the sum of
+   *  the bytes read and sets "received_per_operation" to the bytes read by
+   *  each operation. */
+  int ReadFromOSDs(
+      const std::vector<UUIDIterator*>& uuid_iterators,
+      ReplicaSelector* replica_selector,
+      UUIDIterator* replica_uuid_iterator,
+      const std::vector<std::string>& replica_uuids,
+      const pbrpc::FileCredentials& file_credentials,
+      const std::vector<ReadOperation>& operations,
+      std::vector<int>* received_per_operation);
+
+  /** Sends the read request of "operation" once without waiting for the
+   *  response. Returns NULL if the OSD UUID could not be resolved.
+   *
+   * @remark Ownership of the return value is transferred to the caller. */
+  rpc::SyncCallbackBase* SendReadRequest(
+      UUIDIterator* uuid_iterator,
+      const pbrpc::FileCredentials& file_credentials,
+      const ReadOperation& operation);
+
+  /** Sends "request" to "osd_address" without waiting for the response. The
+   *  data of the response is received directly into "buffer" unless it is
+   *  NULL.
+   *
+   * @remark Ownership of the return value is transferred to the caller.
+   *         "buffer" has to stay valid until the response was received. */
+  rpc::SyncCallbackBase* SendReadRequestToBuffer(
+      const std::string& osd_address,
+      const pbrpc::readRequest* request,
+      char* buffer);
+
+  /** Like SendReadRequestToBuffer(), but the response is passed to
+   *  "callback" with "context". */
+  void SendReadRequestToBuffer(
+      const std::string& osd_address,
+      const pbrpc::readRequest* request,
+      char* buffer,
+      rpc::CallbackInterface<pbrpc::ObjectData>* callback,
+      void* context);
+
+  /** Sends a read request for every object of "operation" without waiting
+   *  for the responses. Returns false if the read cannot be split into
+   *  object requests, e.g. because it has to go through the object cache.
+   *
+   * @throws XtreemFSException */
+  bool SendReadRequestsAsync(AsyncIOOperation* operation,
+                             char* buf,
+                             size_t count,
+                             int64_t offset);
+
+  /** Sends a write request for every object of "operation" without waiting
+   *  for the responses. Returns false if the write cannot be split into
+   *  object requests, e.g. because asynchronous writes are enabled.
+   *
+   * @throws XtreemFSException */
+  bool SendWriteRequestsAsync(AsyncIOOperation* operation,
+                              const char* buf,
+                              size_t count,
+                              int64_t offset);
+
+  /** Sends a read request for the complete object "object_no" without
+   *  waiting for the response. Used as ReadAheadSendFunction.
+   *
+   * @remark Ownership of the return value is transferred to the caller. */
+  rpc::SyncCallbackBase* SendReadAheadRequest(
+      const pbrpc::FileCredentials& file_credentials,
+      boost::shared_ptr<UUIDContainer> osd_uuid_container,
+      int object_no);
+
+  /** Copies the data of a successful read "response" into "buffer" unless it
+   *  was received there directly, fills the zero padding and frees the
+   *  response buffers. Returns the number of bytes written to "buffer". */
+  int CopyReadResponse(rpc::SyncCallbackBase* response, char* buffer);
+
+  /** Returns false if the data of a successful read "response" is
+   *  corrupted, see VerifyObjectData(). */
+  bool IsReadResponseValid(rpc::SyncCallbackBase* response);
+
+  /** Actual implementation of Write(), WriteV() and WriteZeroCopy(). The
+   *  data of asynchronous writes is copied unless "borrowed_data" is set. */
+  int DoWrite(
+      const struct iovec* iov,
+      int iovcnt,
+      int64_t offset,
+      const boost::shared_ptr<BorrowedWriteData>& borrowed_data);
+
+  /** Write data to the OSD. Objects owned by the caller. */
+  void WriteToOSD(
+      UUIDIterator* uuid_iterator,
+      const pbrpc::FileCredentials& file_credentials,
+      int object_no,
+      int offset_in_object,
+      const char* buffer,
+      int bytes_to_write);
+
+  /** Like WriteToOSD(), but returns the response of the OSD instead of
+   *  registering it for the next file size update.
+   *
+   * @remark Ownership of the return value is transferred to the caller. */
+  pbrpc::OSDWriteResponse* ExecuteWriteRequest(
+      UUIDIterator* uuid_iterator,
+      const pbrpc::FileCredentials& file_credentials,
+      int object_no,
+      int offset_in_object,
+      const char* buffer,
+      int bytes_to_write);
+
+  /** Reads "operations" of an erasure coded file. Objects which cannot be
+   *  read from their OSD are reconstructed from the rest of their stripe. */
+  int ReadErasureCoded(const pbrpc::FileCredentials& file_credentials,
+                       const std::vector<ReadOperation>& operations);
+
+  /** Writes "operations" of an erasure coded file stripe by stripe and
+   *  updates the parity objects of every written stripe. */
+  void WriteErasureCoded(const pbrpc::FileCredentials& file_credentials,
+                         const std::vector<WriteOperation>& operations);
+
+  /** Writes the operations "first" to "last" (exclusive), which all belong to
+   *  stripe "stripe_number", and updates the parity objects of the stripe.
+   *
+   * The parity is updated with the difference between the old and new
+   * content of the written ranges. Only if the old parity is not available,
+   * or without operations, it is recomputed from all data objects. The
+   * parity objects are as long as the longest data object of the stripe.
+   * "failed_osds" is passed to ReadFragment().
+   *
+   * @remark The caller has to hold a FileInfo::StripeUpdateLock. */
+  void WriteStripe(const pbrpc::FileCredentials& file_credentials,
+                   const util::ReedSolomon& code,
+                   size_t stripe_number,
+                   std::vector<WriteOperation>::const_iterator first,
+                   std::vector<WriteOperation>::const_iterator last,
+                   std::vector<bool>* failed_osds);
+
+  /** Reads the data objects of stripe "stripe_number" with needed[i] == true
+   *  into their slots of "stripe", which has room for all data and parity
+   *  objects, and sets their "lengths". The stripe is filled with zeros
+   *  behind the data. Objects which cannot be read, e.g. because their OSD is
+   *  in "failed_osds" already, are reconstructed from the other objects of
+   *  the stripe.
+   *
+   * @throws IOException  If less than width objects are available. */
+  void ReadStripe(const pbrpc::FileCredentials& file_credentials,
+                  const util::ReedSolomon& code,
+                  size_t stripe_number,
+                  const std::vector<bool>& needed,
+                  char* stripe,
+                  std::vector<int>* lengths,
+                  std::vector<bool>* failed_osds);
+
+  /** Reads "length" bytes at "offset" of object "object_no" from the OSD
+   *  "osd_offset" of the first replica. Returns the number of read bytes or
+   *  -1 if the OSD did not deliver the object.
+   *
+   * "failed_osds" is indexed by OSD offset and lives as long as the read or
+   * write request. A failed OSD is added to it and not asked again, so its
+   * other objects are reconstructed without waiting for the timeout again. */
+  int ReadFragment(const pbrpc::FileCredentials& file_credentials,
+                   size_t osd_offset,
+                   size_t object_no,
+                   int offset,
+                   int length,
+                   char* buffer,
+                   std::vector<bool>* failed_osds);
+
+  /** Reads the complete object "object_no" into "buffer" which has the size
+   *  of an object. Used as ObjectReaderFunction of the file's ObjectCache. */
+  int ReadObjectFromOSD(int object_no, char* buffer);
+
+  /** Writes the first "bytes_to_write" bytes of object "object_no". Used as
+   *  ObjectWriterFunction of the file's ObjectCache. */
+  void WriteObjectToOSD(int object_no,
+                        const char* buffer,
+                        int bytes_to_write);
+
+  /** Returns the OSD offsets of "object_no" in every replica of "xlocs". */
+  OSDOffsets GetOSDOffsetsOfObject(
+      const pbrpc::XLocSet& xlocs,
+      int object_no,
+      int object_size);
+
+  /** Acutal implementation of TruncatePhaseTwoAndThree(). */
+  void DoTruncatePhaseTwoAndThree(int64_t new_file_size);
+
+  /** Truncates the parity objects of an erasure coded file which is
+   *  truncated to "new_file_size": the parity of removed stripes is deleted
+   *  and the parity of the new last stripe is cut to its longest data
+   *  object. */
+  void TruncateParity(const pbrpc::FileCredentials& file_credentials,
+                      int64_t new_file_size);
+
+  /** Actual implementation of AcquireLock(). */
+  xtreemfs::pbrpc::Lock* DoAcquireLock(
+      int process_id,
+      uint64_t offset,
+      uint64_t length,
+      bool exclusive,
+      bool wait_for_lock);
+
+  /** Actual implementation of CheckLock(). */
+  xtreemfs::pbrpc::Lock* DoCheckLock(
+      int process_id,
+      uint64_t offset,
+      uint64_t length,
+      bool exclusive);
+
+  /** Actual implementation of ReleaseLock(). */
+  void DoReleaseLock(const pbrpc::Lock& lock);
+
+  /** Actual implementation of PingReplica(). */
+  void DoPingReplica(const std::string& osd_uuid);
+
+  /** Any modification to the object must obtain a lock first. */
+  boost::mutex mutex_;
+
+  /** Reference to Client which did open this volume. */
+  ClientImplementation* client_;
+
+  /** UUID of the Client (needed to distinguish Locks of different clients). */
+  const std::string& client_uuid_;
+
+  /** UUIDIterator of the MRC. */
+  UUIDIterator* mrc_uuid_iterator_;
+
+  /** UUIDIterator which contains the UUIDs of all replicas. */
+  UUIDIterator* osd_uuid_iterator_;
+
+  /** Needed to resolve UUIDs. */
+  UUIDResolver* uuid_resolver_;
+
+  /** Multiple FileHandle may refer to the same File and therefore unique file
+   * properties (e.g. Path, FileId, XlocSet) are stored in a FileInfo object. */
+  FileInfo* file_info_;
+
+  // TODO(mberlin): Add flags member.
+
+  /** Contains a file size update which has to be written back (or NULL). */
+  boost::scoped_ptr<pbrpc::OSDWriteResponse>
+      osd_write_response_for_async_write_back_;
+
+  /** Pointer to object owned by VolumeImplemention */
+  pbrpc::MRCServiceClient* mrc_service_client_;
+
+  /** Pointer to object owned by VolumeImplemention */
+  pbrpc::OSDServiceClient* osd_service_client_;
+
+  /** Pointer to object owned by VolumeImplemention. Used for reads whose
+   *  data is received directly into the caller's buffer. */
+  rpc::Client* network_client_;
+
+  const std::map<pbrpc::StripingPolicyType,
+                 StripeTranslator*>& stripe_translators_;
+
+  /** Set to true if async writes (max requests > 0, no O_SYNC) are enabled. */
+  const bool async_writes_enabled_;
+
+  /** Set to true if an async write of this file_handle failed. If true, this
+   *  file_handle is broken and no further writes/reads/truncates are possible.
+   */
+  bool async_writes_failed_;
+
+  const Options& volume_options_;
+
+  /** Auth needed for ServiceClients. Always set to AUTH_NONE by Volume. */
+  const pbrpc::Auth& auth_bogus_;
+
+  /** For same reason needed as auth_bogus_. Always set to user "xtreemfs". */
+  const pbrpc::UserCredentials& user_credentials_bogus_;
+
+  XCapManager xcap_manager_;
+
+  FRIEND_TEST(VolumeImplementationTestFastPeriodicFileSizeUpdate,
+              WorkingPendingFileSizeUpdates);
+  FRIEND_TEST(VolumeImplementationTest, FileSizeUpdateAfterFlush);
+  FRIEND_TEST(VolumeImplementationTestFastPeriodicFileSizeUpdate,
+              FileSizeUpdateAfterFlushWaitsForPendingUpdates);
+  FRIEND_TEST(VolumeImplementationTestFastPeriodicXCapRenewal,
+              WorkingXCapRenewal);
+  FRIEND_TEST(VolumeImplementationTest, FilesLockingReleaseNonExistantLock);
+  FRIEND_TEST(VolumeImplementationTest, FilesLockingReleaseExistantLock);
+  FRIEND_TEST(VolumeImplementationTest, FilesLockingLastCloseReleasesAllLocks);
+  FRIEND_TEST(VolumeImplementationTest, FilesLockingReleaseLockOfProcess);
+};
+
+}  // namespace xtreemfs
+
+#endif  // CPP_INCLUDE_LIBXTREEMFS_FILE_HANDLE_IMPLEMENTATION_H_
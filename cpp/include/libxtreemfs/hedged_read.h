@@ -0,0 +1,109 @@
+/*
+ * Copyright (c) 2015 by Zuse Institute Berlin
+ *
+ * Licensed under the BSD License, see LICENSE file for details.
+ *
+ */
+
+#ifndef CPP_INCLUDE_LIBXTREEMFS_HEDGED_READ_H_
+#define CPP_INCLUDE_LIBXTREEMFS_HEDGED_READ_H_
+
+#include <boost/date_time/posix_time/posix_time_types.hpp>
+#include <boost/thread/condition_variable.hpp>
+#include <boost/thread/mutex.hpp>
+#include <string>
+
+#include "rpc/client_request_callback_interface.h"
+#include "util/annotations.h"
+
+namespace xtreemfs {
+
+namespace pbrpc {
+class Auth;
+class readRequest;
+class UserCredentials;
+}  // namespace pbrpc
+
+namespace rpc {
+class Client;
+}  // namespace rpc
+
+/** Sends the same read request to up to kMaxTargets replicas and returns the
+ *  first successful response.
+ *
+ *  Every request receives its data into its own buffer, so the reads which
+ *  lost the race may still be in flight when the caller returns. Therefore a
+ *  HedgedRead is reference counted: it deletes itself once the caller called
+ *  Release() and all requests have completed.
+ */
+class HedgedRead : public rpc::ClientRequestCallbackInterface {
+ public:
+  static const int kMaxTargets = 2;
+
+  HedgedRead();
+
+  /** Sends "request" to "osd_address". "osd_uuid" is only used to report the
+   *  target which answered first. */
+  void Send(rpc::Client* network_client,
+            const std::string& osd_uuid,
+            const std::string& osd_address,
+            const pbrpc::readRequest& request,
+            const pbrpc::Auth& auth,
+            const pbrpc::UserCredentials& user_credentials)
+      LOCKS_EXCLUDED(mutex_);
+
+  /** Waits until a read succeeded, all sent reads failed or "deadline", a
+   *  point in time of util::MonotonicTime(), has passed. Returns false if
+   *  "deadline" has passed. */
+  bool WaitUntil(const boost::posix_time::ptime& deadline)
+      LOCKS_EXCLUDED(mutex_);
+
+  /** Waits until a read succeeded or all sent reads failed. */
+  void Wait() LOCKS_EXCLUDED(mutex_);
+
+  /** Copies the data of the successful read into "buffer" and returns the
+   *  number of bytes read. Returns -1 if all reads failed or, if
+   *  "verify_checksum" is true, the read data is corrupted.
+   *
+   *  Must not be called before Wait() or a successful WaitUntil(). */
+  int CopyResponse(char* buffer, bool verify_checksum) LOCKS_EXCLUDED(mutex_);
+
+  /** Returns the UUID of the OSD which answered first or an empty string. */
+  std::string winner_uuid() LOCKS_EXCLUDED(mutex_);
+
+  /** Gives up the caller's reference. Reads in flight are discarded. */
+  void Release() LOCKS_EXCLUDED(mutex_);
+
+  /** Implements rpc::ClientRequestCallbackInterface. */
+  virtual void RequestCompleted(rpc::ClientRequest* request)
+      LOCKS_EXCLUDED(mutex_);
+
+ private:
+  /** Use Release() instead. */
+  virtual ~HedgedRead();
+
+  /** True if a read succeeded or all sent reads failed. */
+  bool IsFinished() EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+
+  /** Deletes "request" together with its response buffers. */
+  static void DeleteRequest(rpc::ClientRequest* request);
+
+  boost::mutex mutex_;
+  boost::condition_variable finished_;
+
+  /** UUIDs of the targets, their addresses are the request contexts. */
+  std::string targets_[kMaxTargets] GUARDED_BY(mutex_);
+  int sent_ GUARDED_BY(mutex_);
+  int failed_ GUARDED_BY(mutex_);
+
+  /** The request which succeeded first, owned by this object. */
+  rpc::ClientRequest* winner_ GUARDED_BY(mutex_);
+  std::string winner_uuid_ GUARDED_BY(mutex_);
+
+  /** Number of requests in flight plus one for the caller. */
+  int references_ GUARDED_BY(mutex_);
+};
+
+}  // namespace xtreemfs
+
+#endif  // CPP_INCLUDE_LIBXTREEMFS_HEDGED_READ_H_
@@ -0,0 +1,56 @@
+/*
+ * Copyright (c) 2011 by Michael Berlin, Zuse Institute Berlin
+ *
+ * Licensed under the BSD License, see LICENSE file for details.
+ *
+ */
+
+#ifndef CPP_INCLUDE_LIBXTREEMFS_METADATA_CACHE_ENTRY_H_
+#define CPP_INCLUDE_LIBXTREEMFS_METADATA_CACHE_ENTRY_H_
+
+#include <stdint.h>
+
+#include <string>
+#include <vector>
+
+namespace xtreemfs {
+
+namespace pbrpc {
+class DirectoryEntries;
+class Stat;
+class listxattrResponse;
+}
+
+class MetadataCacheEntry {
+ public:
+  MetadataCacheEntry();
+  ~MetadataCacheEntry();
+
+  std::string path;
+
+  xtreemfs::pbrpc::DirectoryEntries* dir_entries;
+  uint64_t dir_entries_timeout_s;
+
+  /** Sorted names of all entries of the directory "path". Only set if the
+   *  directory was listed completely, so a name missing here does not
+   *  exist. */
+  std::vector<std::string>* dir_names;
+  uint64_t dir_names_timeout_s;
+
+  xtreemfs::pbrpc::Stat* stat;
+  uint64_t stat_timeout_s;
+
+  xtreemfs::pbrpc::listxattrResponse* xattrs;
+  uint64_t xattrs_timeout_s;
+
+  /** If in the future and "stat" is NULL, "path" did not exist when it was
+   *  looked up the last time (negative entry). */
+  uint64_t nonexistent_timeout_s;
+
+  /** Always the maximum of all timeouts. */
+  uint64_t timeout_s;
+};
+
+}  // namespace xtreemfs
+
+#endif  // CPP_INCLUDE_LIBXTREEMFS_METADATA_CACHE_ENTRY_H_
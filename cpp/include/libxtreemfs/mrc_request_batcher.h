@@ -0,0 +1,134 @@
+/*
+ * Copyright (c) 2015 by Zuse Institute Berlin
+ *
+ * Licensed under the BSD License, see LICENSE file for details.
+ *
+ */
+
+#ifndef CPP_INCLUDE_LIBXTREEMFS_MRC_REQUEST_BATCHER_H_
+#define CPP_INCLUDE_LIBXTREEMFS_MRC_REQUEST_BATCHER_H_
+
+#include <stdint.h>
+
+#include <boost/thread/mutex.hpp>
+#include <vector>
+
+#include "pbrpc/RPC.pb.h"
+#include "rpc/callback_interface.h"
+#include "xtreemfs/MRC.pb.h"
+
+namespace xtreemfs {
+
+namespace pbrpc {
+class MRCServiceClient;
+}  // namespace pbrpc
+
+class FileHandleImplementation;
+class RPCOptions;
+class UUIDIterator;
+class UUIDResolver;
+class XCapManager;
+
+/** Sends the periodic XCap renewals and file size updates of all open files
+ *  of a volume with few MRC requests.
+ *
+ * Up to "max_batch_size" XCaps are renewed by one xtreemfs_renew_capabilities
+ * request and up to "max_batch_size" file sizes are updated by one
+ * xtreemfs_update_file_sizes request. If the MRC does not implement these
+ * operations, batching_supported() returns false and the volume falls back to
+ * one request per file.
+ *
+ * The XCapManager of every XCap which was not renewed receives the error of
+ * the batch or the error which the MRC returned for this XCap, e.g.
+ * POSIX_ERROR_ENOSPC if its voucher could not be renewed. Failed file size
+ * updates are logged once per batch. Files whose XCap was not renewed are
+ * renewed again in the next period, rejected file sizes stay dirty and are
+ * sent again.
+ */
+class MRCRequestBatcher
+    : public rpc::CallbackInterface<
+          pbrpc::xtreemfs_renew_capabilitiesResponse>,
+      public rpc::CallbackInterface<
+          pbrpc::xtreemfs_update_file_sizesResponse> {
+ public:
+  /** XCap renewals collected from the open files of a volume. The i-th XCap of
+   *  "request" belongs to the i-th XCapManager. */
+  struct XCapRenewals {
+    std::vector<XCapManager*> xcap_managers;
+    pbrpc::xtreemfs_renew_capabilitiesRequest request;
+  };
+
+  /** File size updates collected from the open files of a volume. The i-th
+   *  update of "request" belongs to the i-th temporary FileHandle. */
+  struct FileSizeUpdates {
+    std::vector<FileHandleImplementation*> file_handles;
+    pbrpc::xtreemfs_update_file_sizesRequest request;
+  };
+
+  MRCRequestBatcher(pbrpc::MRCServiceClient* mrc_service_client,
+                    UUIDResolver* uuid_resolver,
+                    UUIDIterator* mrc_uuid_iterator,
+                    const pbrpc::Auth& auth_bogus,
+                    const pbrpc::UserCredentials& user_credentials_bogus,
+                    int max_batch_size);
+
+  /** False once the MRC rejected a batched operation as unknown. */
+  bool batching_supported();
+
+  /** Sends the renewals of "renewals" asynchronously. Every XCapManager must
+   *  have been prepared by XCapManager::StartXCapRenewal(). */
+  void SendXCapRenewals(const XCapRenewals& renewals,
+                        const RPCOptions& options);
+
+  /** Sends the updates of "updates" asynchronously. */
+  void SendFileSizeUpdates(const FileSizeUpdates& updates,
+                           const RPCOptions& options);
+
+ private:
+  /** Implements the callback of an xtreemfs_renew_capabilities request.
+   *  "context" is the std::vector<XCapManager*> of the batch. */
+  virtual void CallFinished(
+      pbrpc::xtreemfs_renew_capabilitiesResponse* response_message,
+      char* data,
+      uint32_t data_length,
+      pbrpc::RPCHeader::ErrorResponse* error,
+      void* context);
+
+  /** Implements the callback of an xtreemfs_update_file_sizes request.
+   *  "context" is the std::vector<FileHandleImplementation*> of the batch. */
+  virtual void CallFinished(
+      pbrpc::xtreemfs_update_file_sizesResponse* response_message,
+      char* data,
+      uint32_t data_length,
+      pbrpc::RPCHeader::ErrorResponse* error,
+      void* context);
+
+  /** Logs the failure of a batch and disables batching if "error" says that
+   *  the MRC does not know the operation. */
+  void HandleBatchError(const char* operation,
+                        const pbrpc::RPCHeader::ErrorResponse& error);
+
+  /** Returns the address of the current MRC. */
+  void GetMRCAddress(const RPCOptions& options, std::string* mrc_address);
+
+  pbrpc::MRCServiceClient* mrc_service_client_;
+  UUIDResolver* uuid_resolver_;
+  UUIDIterator* mrc_uuid_iterator_;
+
+  /** Auth needed for ServiceClients. Always set to AUTH_NONE by Volume. */
+  const pbrpc::Auth auth_bogus_;
+
+  /** For same reason needed as auth_bogus_. Always set to user "xtreemfs". */
+  const pbrpc::UserCredentials user_credentials_bogus_;
+
+  const int max_batch_size_;
+
+  /** Protects batching_supported_. */
+  boost::mutex mutex_;
+
+  bool batching_supported_;
+};
+
+}  // namespace xtreemfs
+
+#endif  // CPP_INCLUDE_LIBXTREEMFS_MRC_REQUEST_BATCHER_H_
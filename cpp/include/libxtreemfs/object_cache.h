@@ -0,0 +1,265 @@
+/*
+ * Copyright (c) 2013 by Felix Hupfeld.
+ *
+ * Licensed under the BSD License, see LICENSE file for details.
+ *
+ */
+
+#ifndef CPP_INCLUDE_LIBXTREEMFS_OBJECT_CACHE_H_
+#define CPP_INCLUDE_LIBXTREEMFS_OBJECT_CACHE_H_
+
+#include <stdint.h>
+
+#include <boost/scoped_array.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/thread/condition_variable.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/function.hpp>
+#include <map>
+
+#include "util/annotations.h"
+
+namespace xtreemfs {
+
+/** These are injected functions that provide object read and write
+  * functionality for complete objects. */
+typedef boost::function<int (int object_no, char* data)>
+    ObjectReaderFunction;
+typedef boost::function<void (int object_no, const char* data, int size)>
+    ObjectWriterFunction;
+
+/** Memory budget which is shared by the ObjectCaches of all files of a
+ *  volume. */
+class ObjectCacheBudget {
+ public:
+  explicit ObjectCacheBudget(int64_t max_bytes);
+
+  /** Reserves "bytes" if they do not exceed the budget. Returns false
+   *  otherwise. */
+  bool TryReserve(int bytes) LOCKS_EXCLUDED(mutex_);
+
+  /** Reserves "bytes" even if they exceed the budget. */
+  void Reserve(int bytes) LOCKS_EXCLUDED(mutex_);
+
+  /** Returns "bytes" which were reserved before. */
+  void Release(int bytes) LOCKS_EXCLUDED(mutex_);
+
+  int64_t used_bytes() LOCKS_EXCLUDED(mutex_);
+
+  int64_t max_bytes() const;
+
+ private:
+  /** Protects used_bytes_. */
+  boost::mutex mutex_;
+  int64_t used_bytes_ GUARDED_BY(mutex_);
+  const int64_t max_bytes_;
+};
+
+/** A cached object.
+ *
+ *  The reader and writer functions are called without holding mutex_: the
+ *  object is marked as loading or flushing instead, and concurrent loads or
+ *  flushes of the same object wait for it. Accesses to other objects are not
+ *  blocked by the I/O.
+ */
+class CachedObject {
+ public:
+  /** Create the object in ReadPending state. */
+  CachedObject(int object_no, int object_size);
+  ~CachedObject();
+
+  /** Free memory without flushing to storage. */
+  void Drop() LOCKS_EXCLUDED(mutex_);
+
+  /** Sets the data of the object to the "size" bytes fetched from the OSD,
+   *  unless it already has data or is being loaded. */
+  void Fill(const char* data, int size) LOCKS_EXCLUDED(mutex_);
+
+  int Read(int offset_in_object,
+           char* buffer,
+           int bytes_to_read,
+           const ObjectReaderFunction& reader)
+      LOCKS_EXCLUDED(mutex_);
+
+  void Write(int offset_in_object,
+             const char* buffer,
+             int bytes_to_write,
+             const ObjectReaderFunction& reader)
+      LOCKS_EXCLUDED(mutex_);
+
+  void Flush(const ObjectWriterFunction& writer)
+      LOCKS_EXCLUDED(mutex_);
+
+  /** Changes the size of the object without marking it dirty. Growing the
+   *  object fills the gap with zeros. Has no effect if no data was fetched,
+   *  data which is being loaded is changed once it arrived. */
+  void Truncate(int new_object_size)
+      LOCKS_EXCLUDED(mutex_);
+
+  uint64_t last_access()
+      LOCKS_EXCLUDED(mutex_);
+
+  bool is_dirty()
+      LOCKS_EXCLUDED(mutex_);
+
+  bool has_data()
+      LOCKS_EXCLUDED(mutex_);
+
+  /** True if the object has data of the full object size. */
+  bool is_complete()
+      LOCKS_EXCLUDED(mutex_);
+
+  /** Size of the object's data, -1 if no data was fetched yet. */
+  int actual_size()
+      LOCKS_EXCLUDED(mutex_);
+
+ private:
+  /** Caller must hold mutex_ */
+  void DropLocked() EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+
+  void TruncateLocked(int new_object_size) EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+
+  /** Fetches the object with "reader" if it has no data yet. Temporarily
+   *  releases "lock" while reading. */
+  void ReadInternal(const ObjectReaderFunction& reader,
+                    boost::mutex::scoped_lock* lock)
+     EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+
+  /** Mutex that protects all non const data member. */
+  boost::mutex mutex_;
+  /** Signaled when a load or flush finished. */
+  boost::condition_variable io_finished_;
+
+  const int object_no_;
+  const int object_size_;
+  /** Our buffer, always object_size_ large. */
+  boost::scoped_array<char> data_ GUARDED_BY(mutex_);
+  /** The last object has fewer bytes than object_size_. If data has not been
+      fetched from the OSD yet, actual_size is -1.
+  */
+  int actual_size_ GUARDED_BY(mutex_);
+  /** Data is dirty and must be written back. */
+  bool is_dirty_ GUARDED_BY(mutex_);
+  /** Timestamp of last access, for LRU expunge policy. */
+  uint64_t last_access_ GUARDED_BY(mutex_);
+  /** The reader function is fetching the object. */
+  bool loading_ GUARDED_BY(mutex_);
+  /** The writer function is writing back the object. */
+  bool flushing_ GUARDED_BY(mutex_);
+  /** Size set by Truncate() during the load, -1 if none. */
+  int size_after_load_ GUARDED_BY(mutex_);
+};
+
+/** Write-back cache for the objects of one file.
+ *
+ *  The cache is not locked while objects are read or written back, so
+ *  operations on different objects run concurrently. Objects are evicted in
+ *  LRU order if either max_objects is reached or the shared budget is
+ *  exhausted. If no object can be evicted, because all are in use, the new
+ *  object is only kept for the current operation: it is written back and
+ *  removed afterwards.
+ */
+class ObjectCache {
+ public:
+  /** @remark Ownership of "budget" is not transferred, it may be NULL. */
+  ObjectCache(size_t max_objects, int object_size, ObjectCacheBudget* budget);
+  ~ObjectCache();
+
+  /** Read within a specific object */
+  int Read(int object_no, int offset_in_object,
+           char* buffer, int bytes_to_read,
+           const ObjectReaderFunction& reader,
+           const ObjectWriterFunction& writer)
+      LOCKS_EXCLUDED(mutex_);
+
+  /** Write within a specific object */
+  void Write(int object_no, int offset_in_object,
+             const char* buffer, int bytes_to_write,
+             const ObjectReaderFunction& reader,
+             const ObjectWriterFunction& writer)
+      LOCKS_EXCLUDED(mutex_);
+
+  /** Inserts the clean object "object_no" whose "size" bytes were fetched
+   *  from the OSD, unless the object is cached already. */
+  void Insert(int object_no, const char* data, int size,
+              const ObjectWriterFunction& writer)
+      LOCKS_EXCLUDED(mutex_);
+
+  /** Returns true if object "object_no" is cached. */
+  bool Contains(int object_no) LOCKS_EXCLUDED(mutex_);
+
+  /** Writes back all dirty objects. */
+  void Flush(const ObjectWriterFunction& writer)
+      LOCKS_EXCLUDED(mutex_);
+
+  /** Adapts the cached objects to a file size of "new_size". Objects beyond
+   *  the new size are dropped, dirty data included. */
+  void Truncate(int64_t new_size)
+      LOCKS_EXCLUDED(mutex_);
+
+  /** Returns the file size as seen by the dirty objects, i.e. the end of the
+   *  last dirty object, or 0 if no object is dirty. */
+  int64_t GetDirtyFileSize() LOCKS_EXCLUDED(mutex_);
+
+  int object_size() const;
+
+ private:
+  struct CacheEntry {
+    /** Copies are held by the operations which use the object. */
+    boost::shared_ptr<CachedObject> object;
+    /** The object did not fit into the cache and is removed after the
+     *  current operation. It is not charged to the budget. */
+    bool transient;
+  };
+
+  /** Map of object number to cached object. */
+  typedef std::map<int64_t, CacheEntry> Cache;
+
+  /** Returns the object "object_no", inserting it if it is not cached yet.
+   *  May write back other objects to make room for it. */
+  boost::shared_ptr<CachedObject> AcquireObject(
+      int object_no,
+      const ObjectWriterFunction& writer)
+      LOCKS_EXCLUDED(mutex_);
+
+  /** Removes a transient object "object_no" after an operation, once no
+   *  other operation uses it. */
+  void FinishOperation(int object_no,
+                       const boost::shared_ptr<CachedObject>& object,
+                       const ObjectWriterFunction& writer)
+      LOCKS_EXCLUDED(mutex_);
+
+  /** Evicts objects until another one fits into the cache. Returns false if
+   *  this was not possible because all objects are in use. */
+  bool MakeRoom(const ObjectWriterFunction& writer) LOCKS_EXCLUDED(mutex_);
+
+  /** Reserves room for one object. Returns false if the cache is full. */
+  bool TryReserve() EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+
+  /** Returns the least recently used object which is not in use or
+   *  cache_.end(). */
+  Cache::iterator FindEvictableObject() EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+
+  /** True if "it" still refers to "object" and no operation uses it. */
+  bool IsUnused(Cache::iterator it,
+                const boost::shared_ptr<CachedObject>& object)
+      EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+
+  /** Removes the object at "it" without writing it back. */
+  void EraseObject(Cache::iterator it) EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+
+  /** Protects all non-const members of this class. */
+  boost::mutex mutex_;
+  Cache cache_ GUARDED_BY(mutex_);
+  /** Number of objects in cache_ which are not transient. */
+  size_t reserved_objects_ GUARDED_BY(mutex_);
+  /** Maximum number of objects to cache. */
+  const size_t max_objects_;
+  const int object_size_;
+  /** Shared memory budget, may be NULL. */
+  ObjectCacheBudget* budget_;
+};
+
+}  // namespace xtreemfs
+
+#endif  // CPP_INCLUDE_LIBXTREEMFS_OBJECT_CACHE_H_
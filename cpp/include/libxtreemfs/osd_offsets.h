@@ -0,0 +1,71 @@
+/*
+ * Copyright (c) 2015 by Zuse Institute Berlin
+ *
+ * Licensed under the BSD License, see LICENSE file for details.
+ *
+ */
+
+#ifndef CPP_INCLUDE_LIBXTREEMFS_OSD_OFFSETS_H_
+#define CPP_INCLUDE_LIBXTREEMFS_OSD_OFFSETS_H_
+
+#include <cassert>
+#include <cstddef>
+#include <vector>
+
+namespace xtreemfs {
+
+/** The OSD offsets of an object, i.e. the index of the OSD which stores the
+ *  object, one per replica.
+ *
+ *  The offsets of up to kInlineCapacity replicas are stored in the object
+ *  itself, so translating a request into operations and copying them does not
+ *  allocate memory. Only files with more replicas use a heap allocated
+ *  overflow buffer.
+ */
+class OSDOffsets {
+ public:
+  static const size_t kInlineCapacity = 4;
+
+  OSDOffsets() : size_(0), inline_offsets_() {}
+
+  void push_back(size_t offset) {
+    if (size_ < kInlineCapacity) {
+      inline_offsets_[size_] = offset;
+    } else {
+      overflow_offsets_.push_back(offset);
+    }
+    size_++;
+  }
+
+  size_t operator[](size_t replica) const {
+    assert(replica < size_);
+    return replica < kInlineCapacity
+        ? inline_offsets_[replica]
+        : overflow_offsets_[replica - kInlineCapacity];
+  }
+
+  size_t size() const {
+    return size_;
+  }
+
+  bool empty() const {
+    return size_ == 0;
+  }
+
+  void clear() {
+    size_ = 0;
+    overflow_offsets_.clear();
+  }
+
+ private:
+  size_t size_;
+
+  size_t inline_offsets_[kInlineCapacity];
+
+  /** Offsets of the replicas behind the first kInlineCapacity ones. */
+  std::vector<size_t> overflow_offsets_;
+};
+
+}  // namespace xtreemfs
+
+#endif  // CPP_INCLUDE_LIBXTREEMFS_OSD_OFFSETS_H_
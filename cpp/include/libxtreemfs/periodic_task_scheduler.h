@@ -0,0 +1,92 @@
+/*
+ * Copyright (c) 2015 by Zuse Institute Berlin
+ *
+ * Licensed under the BSD License, see LICENSE file for details.
+ *
+ */
+
+#ifndef CPP_INCLUDE_LIBXTREEMFS_PERIODIC_TASK_SCHEDULER_H_
+#define CPP_INCLUDE_LIBXTREEMFS_PERIODIC_TASK_SCHEDULER_H_
+
+#include <stdint.h>
+
+#include <boost/date_time/posix_time/posix_time_types.hpp>
+#include <boost/function.hpp>
+#include <boost/scoped_ptr.hpp>
+#include <boost/thread/condition_variable.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/thread.hpp>
+#include <map>
+
+namespace xtreemfs {
+
+/** Runs periodic tasks of several volumes in one thread.
+ *
+ * Every task is run again "interval" after its previous run finished. The
+ * thread sleeps until the next task is due, so idle tasks cost no wakeups
+ * besides their own.
+ *
+ * Tasks must not block for long as they delay all other tasks.
+ */
+class PeriodicTaskScheduler {
+ public:
+  typedef boost::function0<void> Task;
+
+  PeriodicTaskScheduler();
+
+  /** Calls Stop(). */
+  ~PeriodicTaskScheduler();
+
+  /** Starts the thread which runs the tasks. */
+  void Start();
+
+  /** Stops the thread. Tasks scheduled afterwards are never run. */
+  void Stop();
+
+  /** Runs "task" every "interval", the first time after one "interval".
+   *
+   * @return Id of the task, to be passed to Cancel().
+   */
+  uint64_t Schedule(const Task& task,
+                    const boost::posix_time::time_duration& interval);
+
+  /** Removes the task "id". If it's running right now, waits until it has
+   *  finished. Must not be called by a task. */
+  void Cancel(uint64_t id);
+
+ private:
+  struct ScheduledTask {
+    Task task;
+    boost::posix_time::time_duration interval;
+    /** Point in time of util::MonotonicTime() at which the task runs next. */
+    boost::posix_time::ptime next_run;
+  };
+
+  typedef std::map<uint64_t, ScheduledTask> TaskMap;
+
+  /** Loop of thread_. */
+  void Run();
+
+  /** Protects all members. */
+  boost::mutex mutex_;
+
+  /** Signaled when tasks were added or removed, a task did finish or the
+   *  scheduler was stopped. */
+  boost::condition_variable changed_;
+
+  TaskMap tasks_;
+
+  /** Id of the next scheduled task, ids start at 1. */
+  uint64_t next_id_;
+
+  /** Id of the task which is currently run or 0. */
+  uint64_t running_task_;
+
+  bool stopped_;
+
+  boost::scoped_ptr<boost::thread> thread_;
+};
+
+}  // namespace xtreemfs
+
+#endif  // CPP_INCLUDE_LIBXTREEMFS_PERIODIC_TASK_SCHEDULER_H_
@@ -0,0 +1,127 @@
+/*
+ * Copyright (c) 2015 by Zuse Institute Berlin
+ *
+ * Licensed under the BSD License, see LICENSE file for details.
+ *
+ */
+
+#ifndef CPP_INCLUDE_LIBXTREEMFS_READ_AHEAD_HANDLER_H_
+#define CPP_INCLUDE_LIBXTREEMFS_READ_AHEAD_HANDLER_H_
+
+#include <boost/function.hpp>
+#include <boost/thread/mutex.hpp>
+#include <list>
+#include <map>
+#include <set>
+
+#include "util/annotations.h"
+
+namespace xtreemfs {
+
+namespace rpc {
+class SyncCallbackBase;
+}  // namespace rpc
+
+/** Sends a read request for the complete object "object_no" without waiting
+ *  for the response. Returns NULL if the request could not be sent.
+ *
+ * @remark Ownership of the return value is transferred to the caller. */
+typedef boost::function<rpc::SyncCallbackBase* (int object_no)>
+    ReadAheadSendFunction;
+
+/** Detects sequential reads of a file and prefetches the following objects.
+ *
+ *  The read-ahead window starts with kInitialWindow objects. It is doubled
+ *  every time a read has to wait for a prefetched object, i.e. the OSDs did not
+ *  keep up with the reader, and halved if prefetched objects were discarded
+ *  because the file was read at a different position. At most max_window
+ *  objects are prefetched.
+ */
+class ReadAheadHandler {
+ public:
+  static const int kInitialWindow = 2;
+
+  /** If "verify_checksums" is true, corrupted objects are not returned by
+   *  Read(), see IsObjectDataValid(). */
+  ReadAheadHandler(int object_size, int max_window, bool verify_checksums);
+
+  /** Waits for all requests in flight. */
+  ~ReadAheadHandler();
+
+  /** Has to be called before the objects "first_object" to "last_object" are
+   *  read. Sends read-ahead requests with "send" if the access is sequential.
+   */
+  void NotifyRead(int first_object,
+                  int last_object,
+                  const ReadAheadSendFunction& send)
+      LOCKS_EXCLUDED(mutex_);
+
+  /** Copies "bytes_to_read" bytes at "offset_in_object" of the prefetched
+   *  object "object_no" into "buffer" and returns the number of copied bytes.
+   *  Returns -1 if the object was not prefetched (successfully) or is
+   *  corrupted. */
+  int Read(int object_no,
+           int offset_in_object,
+           char* buffer,
+           int bytes_to_read)
+      LOCKS_EXCLUDED(mutex_);
+
+  /** Discards all prefetched objects, e.g. because the file was modified. */
+  void Clear() LOCKS_EXCLUDED(mutex_);
+
+  int window() LOCKS_EXCLUDED(mutex_);
+
+ private:
+  struct PrefetchedObject {
+    PrefetchedObject() : response(NULL), was_read(false) {}
+
+    rpc::SyncCallbackBase* response;
+    /** True if the object was (partly) returned by Read(). */
+    bool was_read;
+  };
+
+  typedef std::map<int, PrefetchedObject> PrefetchedObjects;
+
+  /** Moves the prefetched objects in front of "object_no" to discarded_.
+   *  Returns true if at least one of them was never read. */
+  bool DiscardObjectsBefore(int object_no) EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+
+  /** Frees discarded requests which are finished. */
+  void FreeFinishedDiscardedRequests() EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+
+  /** Protects all non-const members. */
+  boost::mutex mutex_;
+
+  const int object_size_;
+
+  const int max_window_;
+
+  const bool verify_checksums_;
+
+  /** Current number of objects to read ahead. */
+  int window_ GUARDED_BY(mutex_);
+
+  /** Last object of the previous read, -1 if nothing was read yet. */
+  int last_read_object_ GUARDED_BY(mutex_);
+
+  /** Next object which will be prefetched. */
+  int next_prefetch_object_ GUARDED_BY(mutex_);
+
+  /** Number of the first object which was shorter than object_size_, i.e.
+   *  the last object of the file. -1 if unknown. */
+  int last_object_of_file_ GUARDED_BY(mutex_);
+
+  /** Objects whose read-ahead request was sent. */
+  PrefetchedObjects prefetched_ GUARDED_BY(mutex_);
+
+  /** Requests which are no longer needed but may still be in flight. */
+  std::list<rpc::SyncCallbackBase*> discarded_ GUARDED_BY(mutex_);
+
+  /** Requests whose response Read() waits for without holding mutex_. They
+   *  are not freed before the wait returned. */
+  std::multiset<rpc::SyncCallbackBase*> waited_for_ GUARDED_BY(mutex_);
+};
+
+}  // namespace xtreemfs
+
+#endif  // CPP_INCLUDE_LIBXTREEMFS_READ_AHEAD_HANDLER_H_
@@ -0,0 +1,132 @@
+/*
+ * Copyright (c) 2015 by Zuse Institute Berlin
+ *
+ * Licensed under the BSD License, see LICENSE file for details.
+ *
+ */
+
+#ifndef CPP_INCLUDE_LIBXTREEMFS_READDIR_PREFETCHER_H_
+#define CPP_INCLUDE_LIBXTREEMFS_READDIR_PREFETCHER_H_
+
+#include <stdint.h>
+
+#include <boost/function.hpp>
+#include <boost/thread/mutex.hpp>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "util/annotations.h"
+
+namespace xtreemfs {
+
+namespace pbrpc {
+class DirectoryEntries;
+}  // namespace pbrpc
+
+namespace rpc {
+class SyncCallbackBase;
+}  // namespace rpc
+
+/** Keeps the readdir requests for the next chunks of directory listings in
+ *  flight.
+ *
+ * A directory which is listed in chunks of Options::readdir_chunk_size (e.g.
+ * by the Fuse adapter) would otherwise cost one MRC round trip after another.
+ * Once a complete chunk was received, Prefetch() sends the requests for the
+ * following "depth" chunks, so the next ReadDir() usually finds its chunk
+ * already received.
+ *
+ * Listings are identified by a key which has to contain the user and groups
+ * as the MRC checks the permissions of the requesting user. Prefetched chunks
+ * are only used for the continuation of a listing: Reset() is called when a
+ * listing starts at offset 0, so it sees the current directory contents.
+ */
+class ReadDirPrefetcher {
+ public:
+  /** Sends the readdir request for "limit" entries from "offset" on.
+   *  Arguments: offset, limit. */
+  typedef boost::function2<rpc::SyncCallbackBase*, uint64_t, uint32_t>
+      SendFunction;
+
+  /** At most kMaxListings listings have chunks in flight, the least recently
+   *  used one is discarded first. */
+  static const size_t kMaxListings = 16;
+
+  explicit ReadDirPrefetcher(int depth);
+
+  /** Waits for and discards all chunks in flight. */
+  ~ReadDirPrefetcher();
+
+  /** Returns true if Prefetch() sends any requests. */
+  bool enabled() const {
+    return depth_ > 0;
+  }
+
+  /** Discards the chunks of the listing "key". */
+  void Reset(const std::string& key) LOCKS_EXCLUDED(mutex_);
+
+  /** Returns the chunk of "limit" entries from "offset" on of the listing
+   *  "key" and waits for its response if necessary.
+   *
+   * Returns NULL if the chunk was not prefetched or its request failed. The
+   * caller has to send the request itself then. All other chunks of the
+   * listing before "offset" are discarded.
+   *
+   * @remark Ownership of the return value is transferred to the caller. */
+  pbrpc::DirectoryEntries* Take(const std::string& key,
+                                uint64_t offset,
+                                uint32_t limit) LOCKS_EXCLUDED(mutex_);
+
+  /** Sends the requests for the chunks of "chunk_size" entries from
+   *  "offset" on, until "depth" chunks of "key" are in flight. */
+  void Prefetch(const std::string& key,
+                uint64_t offset,
+                uint32_t chunk_size,
+                const SendFunction& send) LOCKS_EXCLUDED(mutex_);
+
+  /** Discards the chunks of all listings. */
+  void Clear() LOCKS_EXCLUDED(mutex_);
+
+ private:
+  /** A chunk in flight. */
+  struct Chunk {
+    uint32_t limit;
+    rpc::SyncCallbackBase* callback;
+  };
+
+  /** Chunks in flight by offset. */
+  typedef std::map<uint64_t, Chunk> ChunkMap;
+
+  struct Listing {
+    Listing() : last_use(0) {}
+
+    ChunkMap chunks;
+    uint64_t last_use;
+  };
+
+  typedef std::map<std::string, Listing> ListingMap;
+
+  /** Waits for the responses of "callbacks" and deletes them. */
+  static void Discard(const std::vector<rpc::SyncCallbackBase*>& callbacks);
+
+  /** Appends the callbacks of "chunks" to "callbacks". */
+  static void CollectCallbacks(
+      const ChunkMap& chunks,
+      std::vector<rpc::SyncCallbackBase*>* callbacks);
+
+  /** Maximum number of chunks in flight per listing. */
+  const int depth_;
+
+  boost::mutex mutex_;
+
+  ListingMap listings_ GUARDED_BY(mutex_);
+
+  /** Increased by every access, used to find the least recently used
+   *  listing. */
+  uint64_t use_counter_ GUARDED_BY(mutex_);
+};
+
+}  // namespace xtreemfs
+
+#endif  // CPP_INCLUDE_LIBXTREEMFS_READDIR_PREFETCHER_H_
@@ -0,0 +1,132 @@
+/*
+ * Copyright (c) 2015 by Zuse Institute Berlin
+ *
+ * Licensed under the BSD License, see LICENSE file for details.
+ *
+ */
+
+#ifndef CPP_INCLUDE_LIBXTREEMFS_REPLICA_SELECTOR_H_
+#define CPP_INCLUDE_LIBXTREEMFS_REPLICA_SELECTOR_H_
+
+#include <stdint.h>
+
+#include <boost/date_time/posix_time/posix_time_types.hpp>
+#include <boost/thread/mutex.hpp>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "util/annotations.h"
+
+namespace xtreemfs {
+
+namespace pbrpc {
+class XLocSet;
+}  // namespace pbrpc
+
+class UUIDScorer;
+
+/** Chooses the replica from which an object of a read-only replicated file is
+ *  read and decides when a read is hedged, i.e. sent to a second replica.
+ *
+ *  The selector measures the read latency of every OSD (as exponentially
+ *  weighted moving average). If balancing is enabled, reads are distributed
+ *  round-robin among all replicas whose average latency is at most
+ *  kBalancingTolerance times the one of the fastest replica. Replicas without
+ *  a recent measurement are always included, so every replica is probed
+ *  from time to time. Without balancing, the order of the XLocSet is kept,
+ *  i.e. the order chosen by the replica selection policy of the MRC (which
+ *  may be based on the Vivaldi coordinates of the client).
+ *
+ *  Replicas whose OSD the UUIDScorer reports as degraded, e.g. because many
+ *  requests to it time out, are only chosen if all replicas are degraded.
+ *
+ *  If hedging is enabled, GetHedgeDelay() returns the given percentile of the
+ *  recent read latencies of the volume.
+ */
+class ReplicaSelector {
+ public:
+  /** Replicas at most this factor slower than the fastest one share reads. */
+  static const double kBalancingTolerance;
+  /** Weight of a new latency sample in the moving average. */
+  static const double kSmoothingFactor;
+  /** Measurements older than this are considered outdated. */
+  static const int kMeasurementMaxAgeS = 30;
+  /** Number of recent read latencies used to compute the hedge delay. */
+  static const int kRecentLatencies = 256;
+  /** Minimum number of recent read latencies before reads are hedged. */
+  static const int kMinHedgeSamples = 16;
+
+  /** "hedge_percentile" is the percentile (1-99) of the recent read latencies
+   *  after which a read is hedged (0 disables hedging). "scorer" may be NULL,
+   *  its ownership is NOT transferred. */
+  ReplicaSelector(bool balance_reads, int hedge_percentile, UUIDScorer* scorer);
+
+  /** True if every replica of "xlocs" can serve every read, i.e. the file has
+   *  multiple replicas which are read-only. */
+  static bool HasInterchangeableReplicas(
+      const xtreemfs::pbrpc::XLocSet& xlocs);
+
+  /** True if reads of "xlocs" should be directed by the selector, i.e. the
+   *  file has multiple unstriped replicas which are read-only. */
+  static bool IsApplicable(const xtreemfs::pbrpc::XLocSet& xlocs);
+
+  /** True if balancing or hedging is enabled. */
+  bool enabled() const {
+    return balance_reads_ || hedge_percentile_ > 0;
+  }
+
+  /** Stores the head OSD UUIDs of all replicas of "xlocs" in "osd_uuids" in
+   *  the order in which they should be tried. */
+  void OrderReplicas(const xtreemfs::pbrpc::XLocSet& xlocs,
+                     std::vector<std::string>* osd_uuids)
+      LOCKS_EXCLUDED(mutex_);
+
+  /** Records that "osd_uuid" answered a read after "latency". */
+  void RecordLatency(const std::string& osd_uuid,
+                     const boost::posix_time::time_duration& latency)
+      LOCKS_EXCLUDED(mutex_);
+
+  /** Records that a read from "osd_uuid" failed. Demotes the OSD until it
+   *  is probed again after kMeasurementMaxAgeS. */
+  void RecordFailure(const std::string& osd_uuid) LOCKS_EXCLUDED(mutex_);
+
+  /** Returns true and sets "delay" if reads should be hedged after "delay". */
+  bool GetHedgeDelay(boost::posix_time::time_duration* delay)
+      LOCKS_EXCLUDED(mutex_);
+
+ private:
+  struct OSDLatency {
+    double average_us;
+    /** Point in time of util::MonotonicTime() of the last measurement. */
+    boost::posix_time::ptime last_update;
+  };
+
+  typedef std::map<std::string, OSDLatency> OSDLatencies;
+
+  /** Returns the average latency of "osd_uuid" or -1 if it was not measured
+   *  recently. */
+  double GetAverageLatency(const std::string& osd_uuid,
+                           const boost::posix_time::ptime& now)
+      EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+
+  const bool balance_reads_;
+  const int hedge_percentile_;
+
+  UUIDScorer* scorer_;
+
+  boost::mutex mutex_;
+
+  OSDLatencies osd_latencies_ GUARDED_BY(mutex_);
+
+  /** Ring buffer of the last kRecentLatencies read latencies in us. */
+  std::vector<int64_t> recent_latencies_us_ GUARDED_BY(mutex_);
+  size_t next_recent_latency_ GUARDED_BY(mutex_);
+
+  /** Counter for the round-robin choice among similarly fast replicas. */
+  uint64_t next_choice_ GUARDED_BY(mutex_);
+};
+
+}  // namespace xtreemfs
+
+#endif  // CPP_INCLUDE_LIBXTREEMFS_REPLICA_SELECTOR_H_
@@ -0,0 +1,173 @@
+/*
+ * Copyright (c) 2011 by Michael Berlin, Zuse Institute Berlin
+ *
+ * Licensed under the BSD License, see LICENSE file for details.
+ *
+ */
+
+#ifndef CPP_INCLUDE_LIBXTREEMFS_STRIPE_TRANSLATOR_H_
+#define CPP_INCLUDE_LIBXTREEMFS_STRIPE_TRANSLATOR_H_
+
+#include <stdint.h>
+
+#include <vector>
+
+#include "libxtreemfs/file_handle.h"  // struct iovec
+#include "libxtreemfs/osd_offsets.h"
+#include "xtreemfs/GlobalTypes.pb.h"
+
+namespace xtreemfs {
+
+class ReadOperation {
+ public:
+  typedef OSDOffsets OSDOffsetContainer;
+
+  ReadOperation(size_t _obj_number, const OSDOffsetContainer& _osd_offsets,
+                size_t _req_size, size_t _req_offset,
+                char *_data)
+      : obj_number(_obj_number), osd_offsets(_osd_offsets),
+        req_size(_req_size), req_offset(_req_offset),
+        data(_data) {
+  };
+
+  size_t obj_number;
+  OSDOffsetContainer osd_offsets;
+  size_t req_size;
+  size_t req_offset;
+  char *data;
+};
+
+class WriteOperation {
+ public:
+  typedef OSDOffsets OSDOffsetContainer;
+
+  WriteOperation(size_t _obj_number, const OSDOffsetContainer& _osd_offsets,
+                 size_t _req_size, size_t _req_offset,
+                 const char *_data)
+      : obj_number(_obj_number), osd_offsets(_osd_offsets),
+        req_size(_req_size), req_offset(_req_offset),
+        data(_data) {
+  };
+
+  size_t obj_number;
+  OSDOffsetContainer osd_offsets;
+  size_t req_size;
+  size_t req_offset;
+  const char *data;
+};
+
+/** Maps requests to the parts of the objects they access.
+ *
+ *  Translating does not allocate memory apart from growing "operations", so
+ *  callers which translate many requests should reuse the vector.
+ */
+class StripeTranslator {
+ public:
+  /** The striping policies of all replicas. */
+  typedef std::vector<const xtreemfs::pbrpc::StripingPolicy*> PolicyContainer;
+
+  virtual ~StripeTranslator() {}
+  virtual void TranslateWriteRequest(
+      const char *buf,
+      size_t size,
+      int64_t offset,
+      const PolicyContainer& policies,
+      std::vector<WriteOperation>* operations) const = 0;
+
+  virtual void TranslateReadRequest(
+      char *buf,
+      size_t size,
+      int64_t offset,
+      const PolicyContainer& policies,
+      std::vector<ReadOperation>* operations) const = 0;
+
+  /** Translates a write of the "iovcnt" buffers of the scatter list "iov",
+   *  which are written one after another from "offset" on. The part of an
+   *  object which lies in different buffers results in one operation per
+   *  buffer. */
+  void TranslateWriteRequestV(
+      const struct iovec* iov,
+      int iovcnt,
+      int64_t offset,
+      const PolicyContainer& policies,
+      std::vector<WriteOperation>* operations) const;
+
+  /** Translates a read into the scatter list "iov", see above. */
+  void TranslateReadRequestV(
+      const struct iovec* iov,
+      int iovcnt,
+      int64_t offset,
+      const PolicyContainer& policies,
+      std::vector<ReadOperation>* operations) const;
+};
+
+class StripeTranslatorRaid0 : public StripeTranslator {
+ public:
+
+  virtual void TranslateWriteRequest(
+      const char *buf,
+      size_t size,
+      int64_t offset,
+      const PolicyContainer& policies,
+      std::vector<WriteOperation>* operations) const;
+
+  virtual void TranslateReadRequest(
+      char *buf,
+      size_t size,
+      int64_t offset,
+      const PolicyContainer& policies,
+      std::vector<ReadOperation>* operations) const;
+};
+
+/** Reed-Solomon erasure coded striping (STRIPING_POLICY_ERASURECODE).
+ *
+ *  The objects of the file are distributed round-robin over the first "width"
+ *  OSDs of the replica like with RAID0. Every "width" consecutive objects form
+ *  a stripe whose "parity_width" parity objects are stored on the remaining
+ *  OSDs. They use the number of the first object of the stripe as object
+ *  number and are as long as the longest data object of the stripe, i.e. the
+ *  first one. Bytes behind the end of a data object count as zeros. Writes
+ *  only change the parity in the written range. A truncate cuts the parity
+ *  of the new last stripe to that length and removes the parity of the
+ *  stripes behind it, so no parity of removed data is left over.
+ *
+ *  The translation only covers the data objects. The parity is maintained by
+ *  FileHandleImplementation, which also reconstructs the objects of
+ *  unavailable OSDs from any "width" objects of the stripe.
+ */
+class StripeTranslatorErasureCode : public StripeTranslator {
+ public:
+  virtual void TranslateWriteRequest(
+      const char *buf,
+      size_t size,
+      int64_t offset,
+      const PolicyContainer& policies,
+      std::vector<WriteOperation>* operations) const;
+
+  virtual void TranslateReadRequest(
+      char *buf,
+      size_t size,
+      int64_t offset,
+      const PolicyContainer& policies,
+      std::vector<ReadOperation>* operations) const;
+
+  /** Returns the number of the stripe of object "obj_number". */
+  static size_t GetStripeNumber(const xtreemfs::pbrpc::StripingPolicy& policy,
+                                size_t obj_number);
+
+  /** Returns the number of the first data object of "stripe_number", which
+   *  is also the object number of its parity objects. */
+  static size_t GetFirstObjectOfStripe(
+      const xtreemfs::pbrpc::StripingPolicy& policy,
+      size_t stripe_number);
+
+  /** Returns the offset of the OSD which stores parity object
+   *  "parity_index" of every stripe. */
+  static size_t GetParityOSDOffset(
+      const xtreemfs::pbrpc::StripingPolicy& policy,
+      int parity_index);
+};
+
+}  // namespace xtreemfs
+
+#endif  // CPP_INCLUDE_LIBXTREEMFS_STRIPE_TRANSLATOR_H_
@@ -0,0 +1,110 @@
+/*
+ * Copyright (c) 2015 by Zuse Institute Berlin
+ *
+ * Licensed under the BSD License, see LICENSE file for details.
+ *
+ */
+
+#ifndef CPP_INCLUDE_LIBXTREEMFS_USER_CREDENTIALS_CACHE_H_
+#define CPP_INCLUDE_LIBXTREEMFS_USER_CREDENTIALS_CACHE_H_
+
+#ifndef WIN32
+
+#include <stdint.h>
+#include <sys/types.h>
+#include <time.h>
+
+#include <boost/thread/mutex.hpp>
+#include <list>
+#include <map>
+
+#include "pbrpc/RPC.pb.h"
+#include "util/annotations.h"
+
+namespace xtreemfs {
+
+/** Caches the UserCredentials generated for a process.
+ *
+ * Generating the credentials of a request resolves the user and group names
+ * (possibly through NSS/LDAP) and reads the supplementary groups of the
+ * process from /proc. The supplementary groups belong to the process, so the
+ * entries are keyed by uid, gid, pid and the start time of the process,
+ * which tells a reused pid apart. Entries expire after a TTL, so changed
+ * name mappings are noticed eventually. If the cache is full, the oldest
+ * entry is evicted.
+ */
+class UserCredentialsCache {
+ public:
+  /** A "max_entries" or "ttl_s" of 0 disables the cache. */
+  UserCredentialsCache(size_t max_entries, uint64_t ttl_s);
+
+  /** Returns false if Get() and Put() do nothing. */
+  bool enabled() const {
+    return max_entries_ > 0 && ttl_s_ > 0;
+  }
+
+  /** Copies the credentials cached for the process "pid" of "uid" and "gid"
+   *  into "user_credentials" and returns true, unless they are unknown or
+   *  expired.
+   *
+   * "start_time" is the result of GetProcessStartTime(pid). The caller reads
+   * it once and passes it to Get() and a following Put(). */
+  bool Get(uid_t uid,
+           gid_t gid,
+           pid_t pid,
+           uint64_t start_time,
+           xtreemfs::pbrpc::UserCredentials* user_credentials)
+      LOCKS_EXCLUDED(mutex_);
+
+  /** Caches "user_credentials" for the process "pid" of "uid" and "gid" which
+   *  was started at "start_time". */
+  void Put(uid_t uid,
+           gid_t gid,
+           pid_t pid,
+           uint64_t start_time,
+           const xtreemfs::pbrpc::UserCredentials& user_credentials)
+      LOCKS_EXCLUDED(mutex_);
+
+  /** Returns the number of cached entries, including expired ones. */
+  size_t Size() LOCKS_EXCLUDED(mutex_);
+
+  /** Returns the start time of the process "pid" since boot in clock ticks,
+   *  or 0 if it is unknown. */
+  static uint64_t GetProcessStartTime(pid_t pid);
+
+ private:
+  struct Key {
+    uid_t uid;
+    gid_t gid;
+    pid_t pid;
+    uint64_t start_time;
+
+    bool operator<(const Key& other) const;
+  };
+
+  struct Entry {
+    xtreemfs::pbrpc::UserCredentials user_credentials;
+    time_t timeout_s;
+    /** Position in the eviction order. */
+    std::list<Key>::iterator age;
+  };
+
+  typedef std::map<Key, Entry> EntryMap;
+
+  const size_t max_entries_;
+
+  const uint64_t ttl_s_;
+
+  boost::mutex mutex_;
+
+  EntryMap entries_ GUARDED_BY(mutex_);
+
+  /** Keys of entries_, the least recently stored first. */
+  std::list<Key> eviction_order_ GUARDED_BY(mutex_);
+};
+
+}  // namespace xtreemfs
+
+#endif  // !WIN32
+
+#endif  // CPP_INCLUDE_LIBXTREEMFS_USER_CREDENTIALS_CACHE_H_
@@ -0,0 +1,89 @@
+/*
+ * Copyright (c) 2009-2011 by Patrick Schaefer, Zuse Institute Berlin
+ *
+ * Licensed under the BSD License, see LICENSE file for details.
+ *
+ */
+#ifndef CPP_INCLUDE_LIBXTREEMFS_UUID_CACHE_H_
+#define CPP_INCLUDE_LIBXTREEMFS_UUID_CACHE_H_
+
+#include <stdint.h>
+
+#include <boost/thread/condition_variable.hpp>
+#include <boost/thread/mutex.hpp>
+
+#include <map>
+#include <set>
+#include <string>
+
+namespace xtreemfs {
+
+/** Caches the addresses of service UUIDs until their TTL expires.
+ *
+ * Lookup() lets only one thread resolve a missing UUID while other threads
+ * wait for its result ("single-flight"), and it asks one caller to refresh a
+ * mapping once three quarters of its TTL have passed. Until the refresh
+ * arrives, the old address is still returned, also if the refresh failed.
+ */
+class UUIDCache {
+ public:
+  /** Results of Lookup(). */
+  enum LookupResult {
+    /** "address" was set. */
+    kHit,
+    /** "address" was set, but the caller has to refresh the mapping and
+     *  call update() or AbortResolution() afterwards. */
+    kRefresh,
+    /** The UUID is unknown, the caller has to resolve it and call update() or
+     *  AbortResolution() afterwards. */
+    kResolve,
+    /** The UUID is unknown and resolved by another caller. Only returned if
+     *  Lookup() was told not to wait. */
+    kPending
+  };
+
+  /** Seconds after a failed refresh until Lookup() asks for the next one. */
+  static const int kRefreshRetryDelayS = 10;
+
+  void update(const std::string& uuid, const std::string& address,
+      const uint32_t port, const time_t timeout);
+
+  std::string get(const std::string& uuid);
+
+  /** Looks up the address of "uuid" and decides who resolves it if needed.
+   *
+   *  If "uuid" is unknown and already resolved by another caller, this waits
+   *  for the result if "wait" is true and returns kPending otherwise.
+   */
+  LookupResult Lookup(const std::string& uuid,
+                      bool wait,
+                      std::string* address);
+
+  /** Ends a resolution or refresh of "uuid" which failed. Waiting callers are
+   *  woken up and one of them resolves "uuid" again. A failed refresh is
+   *  retried after kRefreshRetryDelayS at the earliest. */
+  void AbortResolution(const std::string& uuid);
+
+ private:
+  struct UUIDMapping {
+    std::string uuid;
+    std::string address;
+    uint32_t port;
+    time_t timeout;
+    /** Time after which Lookup() asks for a refresh. */
+    time_t refresh_time;
+  };
+
+  std::map<std::string, UUIDMapping > cache_;
+  boost::mutex mutex_;
+
+  /** UUIDs which are currently resolved or refreshed. */
+  std::set<std::string> resolving_;
+
+  /** Notified when a resolution ended. */
+  boost::condition_variable resolution_finished_;
+};
+
+}  // namespace xtreemfs
+
+#endif  // CPP_INCLUDE_LIBXTREEMFS_UUID_CACHE_H_
@@ -0,0 +1,46 @@
+/*
+ * Copyright (c) 2015 by Zuse Institute Berlin
+ *
+ * Licensed under the BSD License, see LICENSE file for details.
+ *
+ */
+
+#ifndef CPP_INCLUDE_LIBXTREEMFS_UUID_SCORER_H_
+#define CPP_INCLUDE_LIBXTREEMFS_UUID_SCORER_H_
+
+#include <string>
+
+#include "rpc/server_statistics.h"
+
+namespace xtreemfs {
+
+class UUIDResolver;
+
+/** Provides the measured latency and error rate of the service behind an
+ *  UUID. */
+class UUIDScorer {
+ public:
+  virtual ~UUIDScorer() {}
+
+  /** Returns false if nothing is known about "uuid". */
+  virtual bool GetScore(const std::string& uuid, rpc::ServerScore* score) = 0;
+};
+
+/** Looks up the scores of UUIDs in the rpc::ServerStatistics of their
+ *  addresses. */
+class ServerStatisticsUUIDScorer : public UUIDScorer {
+ public:
+  /** @remark Ownership of the parameters is not transferred. */
+  ServerStatisticsUUIDScorer(UUIDResolver* uuid_resolver,
+                             rpc::ServerStatistics* server_statistics);
+
+  virtual bool GetScore(const std::string& uuid, rpc::ServerScore* score);
+
+ private:
+  UUIDResolver* uuid_resolver_;
+  rpc::ServerStatistics* server_statistics_;
+};
+
+}  // namespace xtreemfs
+
+#endif  // CPP_INCLUDE_LIBXTREEMFS_UUID_SCORER_H_
@@ -0,0 +1,69 @@
+/*
+ * Copyright (c) 2015 by Zuse Institute Berlin
+ *
+ * Licensed under the BSD License, see LICENSE file for details.
+ *
+ */
+
+#ifndef CPP_INCLUDE_RPC_BUFFER_POOL_H_
+#define CPP_INCLUDE_RPC_BUFFER_POOL_H_
+
+#include <stddef.h>
+
+#include <vector>
+
+namespace xtreemfs {
+namespace rpc {
+
+/** Pool of reusable buffers which are grouped into size classes.
+ *
+ * The size classes are the powers of two between "min_buffer_size" and
+ * "max_buffer_size". A requested size is rounded up to its class, so every
+ * buffer of a class can be handed out for every size of the class. Buffers
+ * larger than "max_buffer_size" are not pooled.
+ *
+ * Up to "max_free_buffers" unused buffers are kept per class, all further
+ * released buffers are freed.
+ *
+ * @remark This class is not thread-safe. The Client uses one pool per io
+ *         thread which is only accessed in the context of its io_service.
+ */
+class BufferPool {
+ public:
+  BufferPool(size_t min_buffer_size,
+             size_t max_buffer_size,
+             size_t max_free_buffers);
+
+  ~BufferPool();
+
+  /** Returns a buffer of at least "size" bytes.
+   *
+   * @remarks Ownership is transferred to the caller. The buffer has to be
+   *          returned with Release() and the same "size".
+   */
+  char* Acquire(size_t size);
+
+  /** Returns "buffer" which was acquired with "size" to the pool. */
+  void Release(char* buffer, size_t size);
+
+  /** Number of unused buffers in the pool. */
+  size_t free_buffers() const;
+
+ private:
+  /** Returns the index of the size class of "size", -1 if it's not pooled. */
+  int SizeClass(size_t size) const;
+
+  /** Size of the buffers of the smallest class. */
+  size_t min_buffer_size_;
+  /** Size of the buffers of the largest class. */
+  size_t max_buffer_size_;
+  const size_t max_free_buffers_;
+
+  /** Unused buffers per size class. */
+  std::vector<std::vector<char*> > free_buffers_;
+};
+
+}  // namespace rpc
+}  // namespace xtreemfs
+
+#endif  // CPP_INCLUDE_RPC_BUFFER_POOL_H_
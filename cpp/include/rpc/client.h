@@ -0,0 +1,272 @@
+/*
+ * Copyright (c) 2009-2010 by Bjoern Kolbeck, Zuse Institute Berlin
+ *                    2012 by Michael Berlin, Zuse Institute Berlin
+ *
+ * Licensed under the BSD License, see LICENSE file for details.
+ *
+ */
+
+#ifndef CPP_INCLUDE_RPC_CLIENT_H_
+#define CPP_INCLUDE_RPC_CLIENT_H_
+
+#include <stdint.h>
+
+#include <boost/asio.hpp>
+#include <boost/bind.hpp>
+#include <boost/function.hpp>
+#include <boost/system/error_code.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/version.hpp>
+#include <gtest/gtest_prod.h>
+#include <queue>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "rpc/client_connection.h"
+#include "rpc/buffer_pool.h"
+#include "rpc/client_request.h"
+#include "rpc/server_statistics.h"
+#include "rpc/ssl_options.h"
+#include "rpc/timeout_wheel.h"
+
+#ifdef HAS_OPENSSL
+#include <boost/asio/ssl.hpp>
+#endif  // HAS_OPENSSL
+
+#if (BOOST_VERSION / 100000 > 1) || (BOOST_VERSION / 100 % 1000 > 35)
+#include <boost/functional/hash.hpp>
+#include <boost/unordered_map.hpp>
+#else
+#include <map>
+#endif
+
+namespace xtreemfs {
+namespace rpc {
+
+/** Connections are identified by the server address and the number of the
+ *  connection to this server. */
+typedef std::pair<std::string, int> connection_key;
+
+// Boost introduced unordered_map in version 1.36 but we need to support
+// older versions for Debian 5.
+// TODO(bjko): Remove this typedef when support for Debian 5 is dropped.
+#if (BOOST_VERSION / 100000 > 1) || (BOOST_VERSION / 100 % 1000 > 35)
+typedef boost::unordered_map<connection_key, ClientConnection*> connection_map;
+typedef boost::unordered_map<std::string, std::vector<uint32_t> >
+    server_load_map;
+#else
+typedef std::map<connection_key, ClientConnection*> connection_map;
+typedef std::map<std::string, std::vector<uint32_t> > server_load_map;
+#endif
+
+/** Sends requests to the XtreemFS services and receives their responses.
+ *
+ * The client runs "io_threads" boost::asio io_services, each in its own thread.
+ * Up to "max_connections_per_server" TCP connections are opened to every
+ * server and a request is sent over the connection which has the fewest
+ * requests in flight. The connections of a server are spread across the io
+ * threads.
+ */
+class Client {
+ public:
+  Client(int32_t connect_timeout_s,
+         int32_t request_timeout_s,
+         int32_t max_con_linger,
+         const SSLOptions* options,
+         int io_threads = 1,
+         int max_connections_per_server = 1);
+
+  virtual ~Client();
+
+  /** Runs the io threads and does not return before shutdown() was called.
+   *
+   * The first io thread runs in the context of the caller, the others are
+   * started and joined by this function. */
+  void run();
+
+  void shutdown();
+
+  /** Records the response time and errors of every request in
+   *  "server_statistics". Has to be set before the first request is sent.
+   *
+   * @remarks Ownership of "server_statistics" is not transferred.
+   */
+  void set_server_statistics(ServerStatistics* server_statistics) {
+    server_statistics_ = server_statistics;
+  }
+
+  /** Sends the request asynchronously and executes "callback" when the
+   *  response was received or the request failed.
+   *
+   *  The request times out after "timeout_s" seconds, or after the Client's
+   *  request timeout if "timeout_s" is 0.
+   *
+   *  If "response_data_buffer" is not NULL and the response data is not
+   *  larger than "response_data_buffer_size", the data is received directly
+   *  into it and passed to the callback instead of a copy. The callback must
+   *  not delete[] it then.
+   *
+   * @remarks Ownership of "response_data_buffer" is not transferred. It has
+   *          to stay valid until "callback" was executed. */
+  void sendRequest(const std::string& address,
+                   int32_t interface_id,
+                   int32_t proc_id,
+                   const xtreemfs::pbrpc::UserCredentials& userCreds,
+                   const xtreemfs::pbrpc::Auth& auth,
+                   const google::protobuf::Message* message,
+                   const char* data,
+                   int data_length,
+                   google::protobuf::Message* response_message,
+                   void* context,
+                   ClientRequestCallbackInterface *callback,
+                   int32_t timeout_s = 0,
+                   char* response_data_buffer = NULL,
+                   uint32_t response_data_buffer_size = 0);
+
+ private:
+  /** Interval in which timed out requests and idle connections are checked,
+   *  i.e. the resolution of the request timeouts. */
+  static const int kTimeoutTickMs = 1000;
+  /** Number of slots of the TimeoutWheel of an io thread. */
+  static const int kTimeoutWheelSlots = 64;
+  /** Smallest and largest size class of the pooled receive buffers. Headers
+   *  and messages of responses are usually much smaller than 64 kB. */
+  static const int kMinReceiveBufferSize = 256;
+  static const int kMaxReceiveBufferSize = 64 * 1024;
+  /** Number of unused receive buffers which are kept per size class. */
+  static const int kMaxFreeReceiveBuffers = 32;
+
+  /** State of one io thread.
+   *
+   * @remark All members except "requests", "server_loads" and "stopped" have
+   *         to be accessed in the context of "service" and therefore do not
+   *         require further synchronization.
+   */
+  struct IOThread {
+    IOThread()
+        : timeouts(boost::posix_time::milliseconds(kTimeoutTickMs),
+                   kTimeoutWheelSlots),
+          receive_buffers(kMinReceiveBufferSize,
+                          kMaxReceiveBufferSize,
+                          kMaxFreeReceiveBuffers),
+          stopped(false),
+          stopped_ioservice_only(false),
+          rq_timeout_timer(service) {}
+
+    boost::asio::io_service service;
+    /** Connections which are processed by this io thread. */
+    connection_map connections;
+    /** Contains all pending requests of this io thread's connections which
+     *  are uniquely identified by their call id.
+     *
+     *  Requests to this table are added when sending them and removed by the
+     *  handleTimeout() function and the callback processing.
+     */
+    request_map request_table;
+    /** Deadlines of the requests in request_table. */
+    TimeoutWheel timeouts;
+    /** Buffers for the headers and messages of received responses. */
+    BufferPool receive_buffers;
+    /** Guards "requests", "server_loads" and "stopped". Every io thread has
+     *  its own lock, so requests to different servers do not contend. */
+    boost::mutex requests_mutex;
+    /** Queue where the requests of this io thread queue up before the required
+     *  ClientConnection is available.
+     *
+     *  Once a ClientRequest was removed from this queue, it will be added to
+     *  the request_table and the queue ClientConnection::requests_.
+     */
+    std::queue<ClientRequest*> requests;
+    /** Number of requests in flight for every connection of the servers
+     *  whose address hash maps to this io thread, see GetServerLoads(). The
+     *  counters are incremented and decremented atomically.
+     *
+     *  @remark The vectors are never resized, so the ClientRequests may point
+     *          to their counters.
+     */
+    server_load_map server_loads;
+    /** True when the RPC client was stopped and no new requests are accepted.
+     */
+    bool stopped;
+    /** True when the io_service of this thread was stopped. */
+    bool stopped_ioservice_only;
+    boost::asio::deadline_timer rq_timeout_timer;
+  };
+
+  /** Returns the counters of the requests in flight of every connection to
+   *  "address" whose hash is "address_hash". */
+  std::vector<uint32_t>* GetServerLoads(const std::string& address,
+                                        size_t address_hash);
+
+  /** Helper function which aborts a ClientRequest with "error".
+   *
+   * @remarks    Ownership of "request" is not transferred.
+   */
+  void AbortClientRequest(ClientRequest* request, const std::string& error);
+
+  /** Runs the io_service of "io_thread" and cleans up its state afterwards. */
+  void RunIOThread(IOThread* io_thread);
+
+  void handleTimeout(IOThread* io_thread,
+                     const boost::system::error_code& error);
+
+  void sendInternalRequest(IOThread* io_thread);
+
+  void ShutdownHandler(IOThread* io_thread);
+
+  FILE* create_and_open_temporary_ssl_file(std::string* filename_template,
+                                           const char* mode);
+
+#ifdef HAS_OPENSSL
+  boost::asio::ssl::context_base::method  string_to_ssl_method(
+      std::string method_string,
+      boost::asio::ssl::context_base::method default_method);
+#endif  // HAS_OPENSSL
+
+  /** Owned by this object, never empty. */
+  std::vector<IOThread*> io_threads_;
+  const int max_connections_per_server_;
+  /** Guards stopped_. */
+  boost::mutex stopped_mutex_;
+  /** True when shutdown() was called. */
+  bool stopped_;
+  uint32_t callid_counter_;
+  int32_t rq_timeout_s_;
+  /** Statistics of the servers, may be NULL. */
+  ServerStatistics* server_statistics_;
+  int32_t connect_timeout_s_;
+  int32_t max_con_linger_;
+
+#ifdef HAS_OPENSSL
+  std::string get_pem_password_callback() const;
+  std::string get_pkcs12_password_callback() const;
+  
+  // For previous Boost versions the callback is not a member function (see below).
+#if (BOOST_VERSION > 104601)
+  bool verify_certificate_callback(bool preverfied,
+                                   boost::asio::ssl::verify_context& context) const;
+#endif
+
+  bool use_gridssl_;
+  const SSLOptions* ssl_options;
+  char* pemFileName;
+  char* certFileName;
+  char* trustedCAsFileName;
+  boost::asio::ssl::context* ssl_context_;
+#endif  // HAS_OPENSSL
+
+  FRIEND_TEST(ClientTest, ConnectionsPerServer);
+  FRIEND_TEST(ClientTestFastLingerTimeout, LingerTests);
+  FRIEND_TEST(ClientTestFastLingerTimeoutConnectTimeout, LingerTests);
+};
+
+// For newer Boost versions the callback is a member function (see above).
+#if (BOOST_VERSION < 104700)
+int verify_certificate_callback(int preverify_ok, X509_STORE_CTX *ctx);
+#endif  // BOOST_VERSION < 104700
+
+}  // namespace rpc
+}  // namespace xtreemfs
+
+#endif  // CPP_INCLUDE_RPC_CLIENT_H_
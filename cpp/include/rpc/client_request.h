@@ -0,0 +1,297 @@
+/*
+ * Copyright (c) 2009-2010 by Bjoern Kolbeck, Zuse Institute Berlin
+ *                    2012 by Michael Berlin, Zuse Institute Berlin
+ *
+ * Licensed under the BSD License, see LICENSE file for details.
+ *
+ */
+
+#ifndef CPP_INCLUDE_RPC_CLIENT_REQUEST_H_
+#define CPP_INCLUDE_RPC_CLIENT_REQUEST_H_
+
+#include <boost/date_time/posix_time/posix_time_types.hpp>
+#include <stdint.h>
+#include <list>
+#include <string>
+
+#include "include/Common.pb.h"
+#include "pbrpc/RPC.pb.h"
+
+namespace xtreemfs {
+namespace rpc {
+
+class ClientConnection;
+class ClientRequest;
+class ClientRequestCallbackInterface;
+class RecordMarker;
+class ServerStatistics;
+class TimeoutWheel;
+
+class ClientRequest {
+ public:
+  static const int ERR_NOERR = 0;
+
+  ClientRequest(const std::string& address,
+                const uint32_t call_id,
+                const uint32_t interface_id,
+                const uint32_t proc_id,
+                const xtreemfs::pbrpc::UserCredentials& userCreds,
+                const xtreemfs::pbrpc::Auth& auth,
+                const google::protobuf::Message* request_message,
+                const char* request_data,
+                const int data_length,
+                google::protobuf::Message* response_message,
+                void *context,
+                ClientRequestCallbackInterface* callback);
+
+  virtual ~ClientRequest();
+
+  void ExecuteCallback();
+
+  /** Stamps the request with the time it was sent. The request times out
+   *  after its own timeout or, if it has none, after "default_timeout_s". */
+  void RequestSent(int32_t default_timeout_s);
+
+  /** Used by Client::handleTimeout() to find the respective ClientConnection.
+   *
+   * @remarks This object does not have the ownership of "client_connection_",
+   *          so it does not get transferred.
+   */
+  ClientConnection* client_connection() {
+    return client_connection_;
+  }
+
+  /**
+   * @remarks Ownership is not transferred. Instead, it's assumed that this
+   *          ClientRequests exists as long as "client_connection".
+   */
+  void set_client_connection(ClientConnection* client_connection) {
+    client_connection_ = client_connection;
+  }
+
+  /** Number of the connection to the server which will send this request. */
+  int connection_number() const {
+    return connection_number_;
+  }
+
+  /** Assigns the request to the connection "connection_number" whose number of
+   *  requests in flight is "pending_requests". The counter is decremented
+   *  atomically once the callback was executed.
+   *
+   * @remarks Ownership of "pending_requests" is not transferred.
+   */
+  void set_connection(int connection_number, uint32_t* pending_requests) {
+    connection_number_ = connection_number;
+    pending_requests_ = pending_requests;
+  }
+
+  /** Response times and errors of this request will be recorded in
+   *  "server_statistics" once the callback is executed.
+   *
+   * @remarks Ownership of "server_statistics" is not transferred.
+   */
+  void set_server_statistics(ServerStatistics* server_statistics) {
+    server_statistics_ = server_statistics;
+  }
+
+  void set_rq_data(const char* rq_data) {
+    this->rq_data_ = rq_data;
+  }
+
+  const char* rq_data() const {
+    return rq_data_;
+  }
+
+  void set_rq_hdr_msg(char* rq_hdr_msg) {
+    this->rq_hdr_msg_ = rq_hdr_msg;
+  }
+
+  char* rq_hdr_msg() const {
+    return rq_hdr_msg_;
+  }
+
+  void set_request_marker(RecordMarker* request_marker) {
+    this->request_marker_ = request_marker;
+  }
+
+  RecordMarker* request_marker() const {
+    return request_marker_;
+  }
+
+  void set_resp_data(char* resp_data) {
+    this->resp_data_ = resp_data;
+  }
+
+  char* resp_data() const {
+    return resp_data_;
+  }
+
+  void clear_resp_data() {
+    // The buffer registered by the caller is not owned by this object.
+    if (resp_data_ != resp_data_buffer_) {
+      delete[] resp_data_;
+    }
+    resp_data_ = NULL;
+    resp_data_len_ = 0;
+  }
+
+  /** Registers a buffer of "buffer_size" bytes into which the response data
+   *  is received directly, if it fits. Then resp_data() points to "buffer".
+   *
+   * @remarks Ownership of "buffer" is not transferred. It has to stay valid
+   *          until the callback of this request was executed.
+   */
+  void set_resp_data_buffer(char* buffer, uint32_t buffer_size) {
+    resp_data_buffer_ = buffer;
+    resp_data_buffer_size_ = buffer_size;
+  }
+
+  char* resp_data_buffer() const {
+    return resp_data_buffer_;
+  }
+
+  uint32_t resp_data_buffer_size() const {
+    return resp_data_buffer_size_;
+  }
+
+  void set_resp_header(xtreemfs::pbrpc::RPCHeader* resp_header) {
+    this->resp_header_ = resp_header;
+  }
+
+  xtreemfs::pbrpc::RPCHeader* resp_header() const {
+    return resp_header_;
+  }
+
+  void set_address(std::string address) {
+    this->address_ = address_;
+  }
+
+  std::string address() const {
+    return address_;
+  }
+
+  uint32_t call_id() const {
+    return call_id_;
+  }
+
+  uint32_t interface_id() const {
+    return interface_id_;
+  }
+
+  uint32_t proc_id() const {
+    return proc_id_;
+  }
+
+  /** Time of RequestSent() on the clock of util::MonotonicTime(). */
+  boost::posix_time::ptime time_sent() const {
+    return time_sent_;
+  }
+
+  /** Time on the clock of util::MonotonicTime() when the request times out. */
+  boost::posix_time::ptime deadline() const {
+    return deadline_;
+  }
+
+  /** Request specific timeout, 0 if the Client's timeout is used. */
+  int32_t timeout_s() const {
+    return timeout_s_;
+  }
+
+  void set_timeout_s(int32_t timeout_s) {
+    timeout_s_ = timeout_s;
+  }
+
+  google::protobuf::Message* resp_message() const {
+    return resp_message_;
+  }
+
+  void clear_resp_message() {
+    delete resp_message_;
+    resp_message_ = NULL;
+  }
+
+  void set_error(xtreemfs::pbrpc::RPCHeader::ErrorResponse* error) {
+    if (!error_) {
+      // Process first error only.
+      this->error_ = error;
+    } else {
+      delete error;
+    }
+  }
+
+  void clear_error() {
+    delete error_;
+    error_ = NULL;
+  }
+
+  xtreemfs::pbrpc::RPCHeader::ErrorResponse* error() const {
+    return error_;
+  }
+
+  void* context() const {
+    return context_;
+  }
+
+  void set_resp_data_len(uint32_t resp_data_len_) {
+    this->resp_data_len_ = resp_data_len_;
+  }
+
+  uint32_t resp_data_len() const {
+    return resp_data_len_;
+  }
+
+ private:
+  /** Pointer to the ClientConnection which is responsible for this object. */
+  ClientConnection* client_connection_;
+
+  /** ID of the request to match received responses to sent requests. */
+  const uint32_t call_id_;
+  /** Type of interface (service) which will be contacted. */
+  const uint32_t interface_id_;
+  /** Number of the operation which will be executed. */
+  const uint32_t proc_id_;
+  void *context_;
+  ClientRequestCallbackInterface *callback_;
+  std::string address_;
+  /** Connection of the server which is used for this request. */
+  int connection_number_;
+  /** Requests in flight of the connection, may be NULL. */
+  uint32_t* pending_requests_;
+  /** Statistics of the server, may be NULL. */
+  ServerStatistics* server_statistics_;
+  boost::posix_time::ptime time_sent_;
+  /** Request specific timeout in seconds, 0 if not set. */
+  int32_t timeout_s_;
+  boost::posix_time::ptime deadline_;
+  bool callback_executed_;
+
+  /** Slot of the TimeoutWheel which contains this request, -1 if none. */
+  int timeout_slot_;
+  /** Position of this request in its slot of the TimeoutWheel. */
+  std::list<ClientRequest*>::iterator timeout_entry_;
+
+  /** Internal buffers (will be deleted with the object). */
+  RecordMarker *request_marker_;
+  char *rq_hdr_msg_;
+
+  /** Buffers which are passed to the callback. */
+  xtreemfs::pbrpc::RPCHeader::ErrorResponse *error_;
+  const char *rq_data_;
+  xtreemfs::pbrpc::RPCHeader *resp_header_;
+  google::protobuf::Message *resp_message_;
+  char *resp_data_;
+  uint32_t resp_data_len_;
+  /** Buffer of the caller for the response data, may be NULL. */
+  char *resp_data_buffer_;
+  uint32_t resp_data_buffer_size_;
+
+  void deleteInternalBuffers();
+
+  friend class TimeoutWheel;
+};
+
+}  // namespace rpc
+}  // namespace xtreemfs
+
+#endif  // CPP_INCLUDE_RPC_CLIENT_REQUEST_H_
+
@@ -0,0 +1,80 @@
+/*
+ * Copyright (c) 2015 by Zuse Institute Berlin
+ *
+ * Licensed under the BSD License, see LICENSE file for details.
+ *
+ */
+
+#ifndef CPP_INCLUDE_RPC_RPC_METRICS_H_
+#define CPP_INCLUDE_RPC_RPC_METRICS_H_
+
+#include <stdint.h>
+
+#include <boost/atomic.hpp>
+#include <boost/date_time/posix_time/posix_time_types.hpp>
+#include <string>
+
+#include "util/metrics.h"
+
+namespace google {
+namespace protobuf {
+class ServiceDescriptor;
+}  // namespace protobuf
+}  // namespace google
+
+namespace xtreemfs {
+namespace rpc {
+
+/** Latency histograms of all RPCs by interface and procedure, registered in
+ *  the util::MetricsRegistry as "rpc_<service>_<method>_latency_us", and
+ *  error counters per interface ("rpc_<service>_errors"). POSIX errors and
+ *  redirects are regular responses and not counted as errors.
+ *
+ *  The interface ids and method names are taken from the protobuf service
+ *  descriptors. The
+ *  histograms are looked up once and cached in a lock-free table.
+ */
+class RPCMetrics {
+ public:
+  /** Procedures with a larger id share one histogram per interface. */
+  static const int kMaxProcId = 127;
+
+  static RPCMetrics* instance();
+
+  /** Records a request which completed after "latency". "failed" is true if
+   *  it timed out, the connection failed or the server reported an error. */
+  void RecordRequest(uint32_t interface_id,
+                     uint32_t proc_id,
+                     const boost::posix_time::time_duration& latency,
+                     bool failed);
+
+ private:
+  enum Interface { kDIR, kMRC, kOSD, kOther, kInterfaces };
+
+  RPCMetrics();
+
+  static void CreateInstance();
+
+  /** Returns the protobuf service of "interface" or NULL for kOther. */
+  static const google::protobuf::ServiceDescriptor* GetService(
+      Interface interface);
+
+  Interface GetInterface(uint32_t interface_id) const;
+
+  /** Registers the histogram of "proc_id" of "interface". */
+  util::Histogram* CreateLatencyHistogram(Interface interface,
+                                          uint32_t proc_id);
+
+  static RPCMetrics* instance_;
+
+  /** Interface id of each Interface, taken from the service descriptors. */
+  uint32_t interface_ids_[kInterfaces];
+
+  boost::atomic<util::Histogram*> latencies_[kInterfaces][kMaxProcId + 2];
+  util::Counter* errors_[kInterfaces];
+};
+
+}  // namespace rpc
+}  // namespace xtreemfs
+
+#endif  // CPP_INCLUDE_RPC_RPC_METRICS_H_
@@ -0,0 +1,100 @@
+/*
+ * Copyright (c) 2015 by Zuse Institute Berlin
+ *
+ * Licensed under the BSD License, see LICENSE file for details.
+ *
+ */
+
+#ifndef CPP_INCLUDE_RPC_SERVER_STATISTICS_H_
+#define CPP_INCLUDE_RPC_SERVER_STATISTICS_H_
+
+#include <stdint.h>
+
+#include <boost/date_time/posix_time/posix_time_types.hpp>
+#include <boost/thread/mutex.hpp>
+#include <map>
+#include <string>
+
+#include "util/annotations.h"
+
+namespace xtreemfs {
+namespace rpc {
+
+/** Latency and error rate of a server as measured by its clients. */
+struct ServerScore {
+  ServerScore()
+      : average_latency_us(0), error_rate(0), requests(0), errors(0),
+        degraded(false) {}
+
+  /** Exponentially weighted moving average of the response times. */
+  double average_latency_us;
+  /** Exponentially weighted moving average of the failed requests (0-1). */
+  double error_rate;
+  uint64_t requests;
+  uint64_t errors;
+  /** Point in time of util::MonotonicTime() of the last recorded request. */
+  boost::posix_time::ptime last_request;
+  /** True if the server is so slow or unreliable that other servers should be
+   *  preferred. */
+  bool degraded;
+};
+
+/** Collects the response times and errors of all requests of one or more
+ *  rpc::Clients per server address.
+ *
+ *  A request counts as failed if it could not be sent or timed out or if the
+ *  connection was lost (error type IO_ERROR). Errors reported by the server
+ *  itself, e.g. ENOENT or redirects, are regular responses.
+ *
+ *  A server is degraded if more than kDegradedErrorRate of its recent
+ *  requests failed or if its average latency exceeds kDegradedLatencyFraction
+ *  of the request timeout. A degraded server is therefore recognized well
+ *  before all of its requests time out. As a degraded server is usually not
+ *  used anymore, it is no longer reported as degraded kProbationS seconds
+ *  after its last request, so it gets a chance to recover.
+ */
+class ServerStatistics {
+ public:
+  /** Weight of a new sample in the moving averages. */
+  static const double kSmoothingFactor;
+  static const double kDegradedErrorRate;
+  static const double kDegradedLatencyFraction;
+  /** Minimum number of requests before a server is considered degraded. */
+  static const int kMinRequests = 4;
+  static const int kProbationS = 30;
+
+  explicit ServerStatistics(int request_timeout_s);
+
+  /** Records that a request to "address" completed after "latency". */
+  void RecordRequest(const std::string& address,
+                     const boost::posix_time::time_duration& latency,
+                     bool failed)
+      LOCKS_EXCLUDED(mutex_);
+
+  /** Returns false if no request was sent to "address" yet. */
+  bool GetScore(const std::string& address, ServerScore* score)
+      LOCKS_EXCLUDED(mutex_);
+
+  /** Returns the scores of all servers by their address. */
+  void GetScores(std::map<std::string, ServerScore>* scores)
+      LOCKS_EXCLUDED(mutex_);
+
+ private:
+  typedef std::map<std::string, ServerScore> ScoreMap;
+
+  /** Sets score->degraded. */
+  void UpdateDegraded(const boost::posix_time::ptime& now,
+                      ServerScore* score) const;
+
+  /** Average latency from which on a server is degraded. */
+  const double degraded_latency_us_;
+
+  boost::mutex mutex_;
+
+  ScoreMap scores_ GUARDED_BY(mutex_);
+};
+
+}  // namespace rpc
+}  // namespace xtreemfs
+
+#endif  // CPP_INCLUDE_RPC_SERVER_STATISTICS_H_
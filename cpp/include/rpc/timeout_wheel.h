@@ -0,0 +1,88 @@
+/*
+ * Copyright (c) 2015 by Zuse Institute Berlin
+ *
+ * Licensed under the BSD License, see LICENSE file for details.
+ *
+ */
+
+#ifndef CPP_INCLUDE_RPC_TIMEOUT_WHEEL_H_
+#define CPP_INCLUDE_RPC_TIMEOUT_WHEEL_H_
+
+#include <stdint.h>
+
+#include <boost/date_time/posix_time/posix_time_types.hpp>
+#include <list>
+#include <vector>
+
+namespace xtreemfs {
+namespace rpc {
+
+class ClientRequest;
+
+/** Hashed timing wheel which keeps track of the deadlines of the requests in
+ *  flight.
+ *
+ * Time is divided into ticks of "tick" length. A request is stored in the slot
+ * of the tick in which its deadline lies, modulo the number of slots. Adding
+ * and removing a request takes constant time, and Expire() only looks at the
+ * slots of the ticks which passed since its last call.
+ *
+ * Deadlines are rounded up to the end of their tick, i.e. a request expires
+ * at most one tick late. All times are taken from util::MonotonicTime(), so
+ * changes of the system time neither expire requests early nor late.
+ *
+ * @remark This class is not thread-safe. The Client uses one wheel per io
+ *         thread which is only accessed in the context of its io_service.
+ */
+class TimeoutWheel {
+ public:
+  TimeoutWheel(const boost::posix_time::time_duration& tick, int slots);
+
+  /** Adds "request" which times out at request->deadline().
+   *
+   * @remarks Ownership of "request" is not transferred. The request must be
+   *          removed with Cancel() or Expire() before it gets deleted.
+   */
+  void Schedule(ClientRequest* request);
+
+  /** Removes "request" if it was scheduled. */
+  void Cancel(ClientRequest* request);
+
+  /** Removes all requests whose deadline lies in a tick before the tick of
+   *  "now" and appends them to "expired". */
+  void Expire(const boost::posix_time::ptime& now,
+              std::vector<ClientRequest*>* expired);
+
+  /** Removes all requests. */
+  void Clear();
+
+  /** Number of scheduled requests. */
+  size_t size() const;
+
+  const boost::posix_time::time_duration& tick() const {
+    return tick_;
+  }
+
+ private:
+  typedef std::list<ClientRequest*> Slot;
+
+  /** Returns the number of the tick in which "time" lies. */
+  int64_t ToTick(const boost::posix_time::ptime& time) const;
+
+  const boost::posix_time::time_duration tick_;
+
+  /** Ticks are counted from this point in time. */
+  const boost::posix_time::ptime epoch_;
+
+  std::vector<Slot> slots_;
+
+  /** First tick which was not expired yet. */
+  int64_t next_tick_;
+
+  size_t size_;
+};
+
+}  // namespace rpc
+}  // namespace xtreemfs
+
+#endif  // CPP_INCLUDE_RPC_TIMEOUT_WHEEL_H_
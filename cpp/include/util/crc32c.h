@@ -0,0 +1,38 @@
+/*
+ * Copyright (c) 2015 by Zuse Institute Berlin
+ *
+ * Licensed under the BSD License, see LICENSE file for details.
+ *
+ */
+
+#ifndef CPP_INCLUDE_UTIL_CRC32C_H_
+#define CPP_INCLUDE_UTIL_CRC32C_H_
+
+#include <stdint.h>
+
+#include <cstddef>
+
+namespace xtreemfs {
+namespace util {
+
+/** Computes the CRC32C (Castagnoli) checksum of "length" bytes at "data".
+ *
+ * "crc" is the checksum of the preceding data (0 at the beginning), so data
+ * can be checksummed in pieces: CRC32C(CRC32C(0, a, n), a + n, m) equals
+ * CRC32C(0, a, n + m).
+ *
+ * Uses the crc32 instruction of SSE 4.2 if the CPU supports it and the
+ * portable implementation otherwise.
+ */
+uint32_t CRC32C(uint32_t crc, const char* data, size_t length);
+
+/** Table based implementation of CRC32C() which runs on every CPU. */
+uint32_t CRC32CPortable(uint32_t crc, const char* data, size_t length);
+
+/** Returns true if CRC32C() uses the crc32 instruction of the CPU. */
+bool CRC32CIsHardwareAccelerated();
+
+}  // namespace util
+}  // namespace xtreemfs
+
+#endif  // CPP_INCLUDE_UTIL_CRC32C_H_
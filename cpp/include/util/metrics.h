@@ -0,0 +1,180 @@
+/*
+ * Copyright (c) 2015 by Zuse Institute Berlin
+ *
+ * Licensed under the BSD License, see LICENSE file for details.
+ *
+ */
+
+#ifndef CPP_INCLUDE_UTIL_METRICS_H_
+#define CPP_INCLUDE_UTIL_METRICS_H_
+
+#include <stdint.h>
+
+#include <boost/atomic.hpp>
+#include <boost/date_time/posix_time/posix_time_types.hpp>
+#include <boost/thread/mutex.hpp>
+#include <map>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "util/annotations.h"
+
+namespace xtreemfs {
+namespace util {
+
+/** Counter which is updated concurrently by many threads.
+ *
+ *  Every thread adds to one of kShards slots (assigned round-robin on its
+ *  first update), each in its own cache line, so threads do not contend for
+ *  the same cache line.
+ *  Reading the value sums up all slots. Add() may also be called with negative
+ *  values to track levels like the number of bytes in flight.
+ */
+class Counter {
+ public:
+  static const int kShards = 16;
+
+  Counter();
+
+  void Add(int64_t delta);
+
+  void Increment() {
+    Add(1);
+  }
+
+  int64_t Value() const;
+
+ private:
+  /** Padded to the size of a cache line. */
+  struct Shard {
+    boost::atomic<int64_t> value;
+    char padding[64 - sizeof(boost::atomic<int64_t>)];
+  };
+
+  Shard shards_[kShards];
+};
+
+/** Copy of the state of a Histogram. */
+struct HistogramSnapshot {
+  HistogramSnapshot() : count(0), sum(0), max(0) {}
+
+  /** Returns an estimate of the value at "percentile" (0-100) or 0 if no
+   *  value was recorded. */
+  int64_t ValueAtPercentile(double percentile) const;
+
+  uint64_t count;
+  int64_t sum;
+  int64_t max;
+  std::vector<uint64_t> buckets;
+};
+
+/** Histogram of non-negative values, usually latencies in us.
+ *
+ *  Like in a HDR histogram, the bucket width doubles with every power of two,
+ *  which is split into kSubBuckets buckets, so the estimated percentiles
+ *  are off by at most 1 / kSubBuckets of the value. Values of 2^kMaxValueBits
+ *  and more are counted in the last bucket. Record() is lock-free.
+ */
+class Histogram {
+ public:
+  static const int kSubBucketBits = 3;
+  static const int kSubBuckets = 1 << kSubBucketBits;
+  static const int kMaxValueBits = 36;
+  static const int kBuckets =
+      (kMaxValueBits - kSubBucketBits + 1) * kSubBuckets;
+
+  Histogram();
+
+  void Record(int64_t value);
+
+  void GetSnapshot(HistogramSnapshot* snapshot) const;
+
+  /** Returns the index of the bucket which counts "value". */
+  static int GetBucket(int64_t value);
+
+  /** Returns the smallest value which is counted in "bucket". */
+  static int64_t GetBucketLowerBound(int bucket);
+
+ private:
+  boost::atomic<uint64_t> buckets_[kBuckets];
+  boost::atomic<int64_t> sum_;
+  boost::atomic<int64_t> max_;
+};
+
+/** Records the time between its construction and destruction in us, measured
+ *  with MonotonicTime(). */
+class ScopedLatencyTimer {
+ public:
+  explicit ScopedLatencyTimer(Histogram* histogram);
+
+  ~ScopedLatencyTimer();
+
+ private:
+  Histogram* histogram_;
+  boost::posix_time::ptime start_;
+};
+
+/** Records the time until the end of the current scope in the histogram
+ *  "name" which is looked up only once per call site. */
+#define SCOPED_LATENCY_TIMER(name) \
+  static xtreemfs::util::Histogram* const scoped_latency_histogram = \
+      xtreemfs::util::MetricsRegistry::instance()->GetHistogram(name); \
+  xtreemfs::util::ScopedLatencyTimer scoped_latency_timer( \
+      scoped_latency_histogram)
+
+/** Process wide registry of named counters, gauges and histograms.
+ *
+ *  Metrics are created on first use and never deleted, so callers look them
+ *  up once and keep the pointer. Names follow the Prometheus conventions
+ *  ([a-z_]+, with the unit as suffix) and are prefixed with "xtreemfs_" when
+ *  written in the Prometheus text format.
+ */
+class MetricsRegistry {
+ public:
+  /** Returns the registry of this process. */
+  static MetricsRegistry* instance();
+
+  /** Returns the counter "name" which only increases. */
+  Counter* GetCounter(const std::string& name) LOCKS_EXCLUDED(mutex_);
+
+  /** Returns the counter "name" which may also decrease. */
+  Counter* GetGauge(const std::string& name) LOCKS_EXCLUDED(mutex_);
+
+  Histogram* GetHistogram(const std::string& name) LOCKS_EXCLUDED(mutex_);
+
+  /** Returns the values of all counters and gauges. */
+  void GetCounterValues(std::map<std::string, int64_t>* values)
+      LOCKS_EXCLUDED(mutex_);
+
+  /** Returns the snapshots of all histograms with at least one value. */
+  void GetHistogramSnapshots(
+      std::map<std::string, HistogramSnapshot>* snapshots)
+      LOCKS_EXCLUDED(mutex_);
+
+  /** Writes all metrics in the Prometheus text format. Histograms are written
+   *  as summaries with the 50th, 90th, 99th and 99.9th percentile. */
+  void WriteText(std::ostream* out) LOCKS_EXCLUDED(mutex_);
+
+  /** Writes WriteText() to "path". The file is replaced atomically, so a
+   *  reader never sees a partially written file. Returns false on errors. */
+  bool WriteTextFile(const std::string& path) LOCKS_EXCLUDED(mutex_);
+
+ private:
+  MetricsRegistry() {}
+
+  static void CreateInstance();
+
+  static MetricsRegistry* instance_;
+
+  boost::mutex mutex_;
+
+  std::map<std::string, Counter*> counters_ GUARDED_BY(mutex_);
+  std::map<std::string, Counter*> gauges_ GUARDED_BY(mutex_);
+  std::map<std::string, Histogram*> histograms_ GUARDED_BY(mutex_);
+};
+
+}  // namespace util
+}  // namespace xtreemfs
+
+#endif  // CPP_INCLUDE_UTIL_METRICS_H_
@@ -0,0 +1,29 @@
+/*
+ * Copyright (c) 2015 by Zuse Institute Berlin
+ *
+ * Licensed under the BSD License, see LICENSE file for details.
+ *
+ */
+
+#ifndef CPP_INCLUDE_UTIL_MONOTONIC_CLOCK_H_
+#define CPP_INCLUDE_UTIL_MONOTONIC_CLOCK_H_
+
+#include <boost/date_time/posix_time/posix_time_types.hpp>
+
+namespace xtreemfs {
+namespace util {
+
+/** Returns the current time of a clock which does not jump if the system time
+ *  is changed, e.g. by NTP or at the start of daylight saving time.
+ *
+ * The returned time points are only meaningful relative to each other, so
+ * they may be used for deadlines and durations, but not as wall-clock time.
+ * Falls back to the UTC wall-clock time on platforms without a monotonic
+ * clock.
+ */
+boost::posix_time::ptime MonotonicTime();
+
+}  // namespace util
+}  // namespace xtreemfs
+
+#endif  // CPP_INCLUDE_UTIL_MONOTONIC_CLOCK_H_
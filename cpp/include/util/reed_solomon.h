@@ -0,0 +1,104 @@
+/*
+ * Copyright (c) 2015 by Zuse Institute Berlin
+ *
+ * Licensed under the BSD License, see LICENSE file for details.
+ *
+ */
+
+#ifndef CPP_INCLUDE_UTIL_REED_SOLOMON_H_
+#define CPP_INCLUDE_UTIL_REED_SOLOMON_H_
+
+#include <stdint.h>
+
+#include <cstddef>
+#include <vector>
+
+namespace xtreemfs {
+namespace util {
+
+/** Multiplies the "length" bytes at "source" with "factor" in GF(2^8) and
+ *  stores the products at "destination" or, if "accumulate" is true, adds
+ *  (xors) them to it.
+ *
+ *  Uses the shuffle instructions of AVX2 or SSSE3 if the CPU supports them
+ *  and 256 byte lookup tables otherwise.
+ */
+void GaloisMultiplyRegion(uint8_t factor,
+                          const char* source,
+                          char* destination,
+                          size_t length,
+                          bool accumulate);
+
+/** Table based implementation of GaloisMultiplyRegion() which runs on every
+ *  CPU. */
+void GaloisMultiplyRegionPortable(uint8_t factor,
+                                  const char* source,
+                                  char* destination,
+                                  size_t length,
+                                  bool accumulate);
+
+/** Returns the name of the instruction set used by GaloisMultiplyRegion(). */
+const char* GaloisMultiplyRegionImplementation();
+
+/** Systematic Reed-Solomon erasure code over GF(2^8) with "data_fragments"
+ *  data and "parity_fragments" parity fragments of equal length.
+ *
+ *  The parity is computed with a Cauchy matrix, so the data can be
+ *  reconstructed from any "data_fragments" of the fragments.
+ */
+class ReedSolomon {
+ public:
+  /** At most 256 fragments are supported in total. */
+  ReedSolomon(int data_fragments, int parity_fragments);
+
+  /** Computes the "parity_fragments" parity fragments of the
+   *  "data_fragments" data fragments "data". All fragments are "length"
+   *  bytes long. */
+  void Encode(const char* const* data, char* const* parity, size_t length)
+      const;
+
+  /** Updates the "parity_fragments" parity fragments "parity" after the
+   *  data fragment "data_fragment" changed. "delta" is the xor of its old and
+   *  new content. All buffers are "length" bytes long and may be ranges of
+   *  the fragments at the same offset. */
+  void Update(int data_fragment,
+              const char* delta,
+              char* const* parity,
+              size_t length) const;
+
+  /** Reconstructs the fragments with available[i] == false from the other
+   *  ones. "fragments" contains the data fragments followed by the parity
+   *  fragments, i.e. data_fragments + parity_fragments buffers of "length"
+   *  bytes.
+   *
+   *  Returns false, and does not modify "fragments", if less than
+   *  data_fragments fragments are available. */
+  bool Reconstruct(char* const* fragments,
+                   const std::vector<bool>& available,
+                   size_t length) const;
+
+  int data_fragments() const {
+    return data_fragments_;
+  }
+
+  int parity_fragments() const {
+    return parity_fragments_;
+  }
+
+ private:
+  /** Returns the coefficient of data fragment "column" in fragment "row". */
+  uint8_t Coefficient(int row, int column) const;
+
+  const int data_fragments_;
+
+  const int parity_fragments_;
+
+  /** Coefficients of the data fragments in the parity fragments, row by
+   *  row. */
+  std::vector<uint8_t> parity_matrix_;
+};
+
+}  // namespace util
+}  // namespace xtreemfs
+
+#endif  // CPP_INCLUDE_UTIL_REED_SOLOMON_H_
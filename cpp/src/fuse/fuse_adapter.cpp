@@ -23,6 +23,7 @@
 #include <string>
 
 #include "fuse/cached_directory_entries.h"
+#include "fuse/fuse_lowlevel_adapter.h"
 #include "fuse/fuse_options.h"
 #include "libxtreemfs/client.h"
 #include "libxtreemfs/file_handle.h"
@@ -59,13 +60,27 @@ using namespace xtreemfs::util;
 
 namespace xtreemfs {
 
+struct fuse_context* GetFuseContext() {
+  FuseLowLevelRequest* request = FuseLowLevelRequest::current();
+  return request != NULL ? request->context() : fuse_get_context();
+}
+
 int CheckIfOperationInterrupted() {
+  FuseLowLevelRequest* request = FuseLowLevelRequest::current();
+  if (request != NULL) {
+    return fuse_req_interrupted(request->req());
+  }
   // TODO(mberlin): Test for other plattforms that it's safe to call this.
   return fuse_interrupted();
 }
 
 FuseAdapter::FuseAdapter(FuseOptions* options) :
-    options_(options),  volume_(NULL), xctl_("/.xctl$$$") {
+    options_(options),
+    user_credentials_cache_(
+        max(0, options->user_credentials_cache_size),
+        max(0, options->user_credentials_cache_ttl_s)),
+    volume_(NULL),
+    xctl_("/.xctl$$$") {
 }
 
 FuseAdapter::~FuseAdapter() {}
@@ -306,9 +321,13 @@ void FuseAdapter::Start(std::list<char*>* required_fuse_options) {
   // Unfortunately Fuse does also cache the stat entries of hard links and
   // therefore returns incorrect results if hard links are "chained".
   // In consequence, we have to disable the Fuse stat cache at all.
-  required_fuse_options->push_back(strdup("-oattr_timeout=0"));
-  required_fuse_options->push_back(
-      strdup("-ouse_ino,readdir_ino"));
+  // The low-level API does not know these options, the FuseLowLevelAdapter
+  // sets the timeouts per entry instead and invalidates hard links.
+  if (!options_->use_fuse_lowlevel) {
+    required_fuse_options->push_back(strdup("-oattr_timeout=0"));
+    required_fuse_options->push_back(
+        strdup("-ouse_ino,readdir_ino"));
+  }
   #ifndef __sun
   if (!options_->enable_atime) {
     required_fuse_options->push_back(strdup("-onoatime"));
@@ -349,6 +368,16 @@ void FuseAdapter::GenerateUserCredentials(
     gid_t gid,
     pid_t pid,
     xtreemfs::pbrpc::UserCredentials* user_credentials) {
+  // Reading /proc/<pid>/stat is the main cost of a cache hit, so the start
+  // time is only read once for Get() and Put().
+  const uint64_t start_time = user_credentials_cache_.enabled()
+      ? UserCredentialsCache::GetProcessStartTime(pid)
+      : 0;
+  if (user_credentials_cache_.Get(
+          uid, gid, pid, start_time, user_credentials)) {
+    return;
+  }
+
   user_credentials->set_username(system_user_mapping_.UIDToUsername(uid));
 
   list<string> groupnames;
@@ -357,6 +386,8 @@ void FuseAdapter::GenerateUserCredentials(
        it != groupnames.end(); ++it) {
     user_credentials->add_groups(*it);
   }
+
+  user_credentials_cache_.Put(uid, gid, pid, start_time, *user_credentials);
 }
 
 void FuseAdapter::SetInterruptQueryFunction() const {
@@ -459,7 +490,7 @@ int FuseAdapter::ConvertXtreemFSErrnoToFuse(
 
 int FuseAdapter::statfs(const char *path, struct statvfs *statv) {
   UserCredentials user_credentials;
-  GenerateUserCredentials(fuse_get_context(), &user_credentials);
+  GenerateUserCredentials(GetFuseContext(), &user_credentials);
 
   try {
     boost::scoped_ptr<StatVFS> stat_vfs(
@@ -520,7 +551,7 @@ int FuseAdapter::getattr(const char *path, struct stat *statbuf) {
   if (!xctl_.checkXctlFile(path_str)) {
     Stat stat;
     UserCredentials user_credentials;
-    GenerateUserCredentials(fuse_get_context(), &user_credentials);
+    GenerateUserCredentials(GetFuseContext(), &user_credentials);
 
     try {
       volume_->GetAttr(user_credentials, path_str, &stat);
@@ -537,7 +568,7 @@ int FuseAdapter::getattr(const char *path, struct stat *statbuf) {
     ConvertXtreemFSStatToFuse(stat, statbuf);
     return 0;
   } else {
-    fuse_context* ctx = fuse_get_context();
+    fuse_context* ctx = GetFuseContext();
     return xctl_.getattr(ctx->uid, ctx->gid, path_str, statbuf);
   }
 }
@@ -560,7 +591,7 @@ int FuseAdapter::getxattr(
   }
 
   UserCredentials user_credentials;
-  GenerateUserCredentials(fuse_get_context(), &user_credentials);
+  GenerateUserCredentials(GetFuseContext(), &user_credentials);
 
   try {
     if (size == 0) {
@@ -608,7 +639,7 @@ int FuseAdapter::opendir(const char *path, struct fuse_file_info *fi) {
   // No default POSIX permissions: Check if it's allowed to enter the dir.
   if (!options_->use_fuse_permission_checks) {
     UserCredentials user_credentials;
-    GenerateUserCredentials(fuse_get_context(), &user_credentials);
+    GenerateUserCredentials(GetFuseContext(), &user_credentials);
 
     // TODO(mberlin): Wait for change of access method and check for X_OK.
     try {
@@ -689,7 +720,7 @@ int FuseAdapter::readdir(const char *path, void *buf, fuse_fill_dir_t filler,
   // Fetch entries from MRC.
   if (dir_entries == NULL) {
     UserCredentials user_credentials;
-    GenerateUserCredentials(fuse_get_context(), &user_credentials);
+    GenerateUserCredentials(GetFuseContext(), &user_credentials);
 
     try {
       // libxtreemfs itself may have cached the readdir response, too.
@@ -789,7 +820,7 @@ int FuseAdapter::utime(const char *path, struct utimbuf *ubuf) {
   Stat stat;
   InitializeStat(&stat);
   UserCredentials user_credentials;
-  GenerateUserCredentials(fuse_get_context(), &user_credentials);
+  GenerateUserCredentials(GetFuseContext(), &user_credentials);
 
   // Convert seconds to nanoseconds.
   if (ubuf != NULL) {
@@ -822,7 +853,7 @@ int FuseAdapter::utimens(const char *path, const struct timespec tv[2]) {
   Stat stat;
   InitializeStat(&stat);
   UserCredentials user_credentials;
-  GenerateUserCredentials(fuse_get_context(), &user_credentials);
+  GenerateUserCredentials(GetFuseContext(), &user_credentials);
 
   // Convert seconds to nanoseconds.
   if (tv != NULL) {
@@ -857,7 +888,7 @@ int FuseAdapter::utimens(const char *path, const struct timespec tv[2]) {
 int FuseAdapter::access(const char *path, int mask) {
   if (!options_->use_fuse_permission_checks) {
     UserCredentials user_credentials;
-    GenerateUserCredentials(fuse_get_context(), &user_credentials);
+    GenerateUserCredentials(GetFuseContext(), &user_credentials);
 
     try {
       volume_->Access(user_credentials,
@@ -893,7 +924,7 @@ int FuseAdapter::create(const char *path, mode_t mode,
   const string path_str(path);
   if (!xctl_.checkXctlFile(path_str)) {
     UserCredentials user_credentials;
-    GenerateUserCredentials(fuse_get_context(), &user_credentials);
+    GenerateUserCredentials(GetFuseContext(), &user_credentials);
 
     try {
       // Open FileHandle and register it in fuse_file_info.
@@ -915,7 +946,7 @@ int FuseAdapter::create(const char *path, mode_t mode,
       return -1 * EIO;
     }
   } else {
-    fuse_context* ctx = fuse_get_context();
+    fuse_context* ctx = GetFuseContext();
     return xctl_.create(ctx->uid, ctx->gid, path_str);
   }
 
@@ -926,7 +957,7 @@ int FuseAdapter::mknod(const char *path, mode_t mode, dev_t device) {
   const string path_str(path);
   if (!xctl_.checkXctlFile(path_str)) {
     UserCredentials user_credentials;
-    GenerateUserCredentials(fuse_get_context(), &user_credentials);
+    GenerateUserCredentials(GetFuseContext(), &user_credentials);
 
     try {
       // Open a temporary filehandle with O_CREAT and close it again.
@@ -947,7 +978,7 @@ int FuseAdapter::mknod(const char *path, mode_t mode, dev_t device) {
       return -1 * EIO;
     }
   } else {
-    fuse_context* ctx = fuse_get_context();
+    fuse_context* ctx = GetFuseContext();
     return xctl_.create(ctx->uid, ctx->gid, path_str);
   }
 
@@ -956,7 +987,7 @@ int FuseAdapter::mknod(const char *path, mode_t mode, dev_t device) {
 
 int FuseAdapter::mkdir(const char *path, mode_t mode) {
   UserCredentials user_credentials;
-  GenerateUserCredentials(fuse_get_context(), &user_credentials);
+  GenerateUserCredentials(GetFuseContext(), &user_credentials);
 
   try {
     volume_->MakeDirectory(user_credentials, string(path), mode);
@@ -988,7 +1019,7 @@ int FuseAdapter::open(const char *path, struct fuse_file_info *fi) {
   }
 
   UserCredentials user_credentials;
-  GenerateUserCredentials(fuse_get_context(), &user_credentials);
+  GenerateUserCredentials(GetFuseContext(), &user_credentials);
 
   try {
     // Open FileHandle and register it in fuse_file_info.
@@ -1014,7 +1045,7 @@ int FuseAdapter::open(const char *path, struct fuse_file_info *fi) {
 
 int FuseAdapter::truncate(const char *path, off_t new_file_size) {
   UserCredentials user_credentials;
-  GenerateUserCredentials(fuse_get_context(), &user_credentials);
+  GenerateUserCredentials(GetFuseContext(), &user_credentials);
 
   try {
     volume_->Truncate(user_credentials, string(path), new_file_size);
@@ -1037,7 +1068,7 @@ int FuseAdapter::ftruncate(const char *path,
   const string path_str(path);
   if (!xctl_.checkXctlFile(path_str)) {
     UserCredentials user_credentials;
-    GenerateUserCredentials(fuse_get_context(), &user_credentials);
+    GenerateUserCredentials(GetFuseContext(), &user_credentials);
 
     try {
       FileHandle* file_handle = reinterpret_cast<FileHandle*>(fi->fh);
@@ -1090,7 +1121,7 @@ int FuseAdapter::write(
 
     return result;
   } else {
-    fuse_context* ctx = fuse_get_context();
+    fuse_context* ctx = GetFuseContext();
     UserCredentials user_credentials;
     GenerateUserCredentials(ctx, &user_credentials);
 
@@ -1152,7 +1183,7 @@ int FuseAdapter::read(const char *path, char *buf, size_t size, off_t offset,
       return -1 * EIO;
     }
   } else {
-    fuse_context* ctx = fuse_get_context();
+    fuse_context* ctx = GetFuseContext();
     UserCredentials user_credentials;
     GenerateUserCredentials(ctx, &user_credentials);
 
@@ -1167,7 +1198,7 @@ int FuseAdapter::unlink(const char *path) {
 
   if (!xctl_.checkXctlFile(path_str)) {
     UserCredentials user_credentials;
-    GenerateUserCredentials(fuse_get_context(), &user_credentials);
+    GenerateUserCredentials(GetFuseContext(), &user_credentials);
 
     try {
       volume_->Unlink(user_credentials, path);
@@ -1183,7 +1214,7 @@ int FuseAdapter::unlink(const char *path) {
 
     return 0;
   } else {
-    fuse_context* ctx = fuse_get_context();
+    fuse_context* ctx = GetFuseContext();
     return xctl_.unlink(ctx->uid, ctx->gid, path_str);
   }
 }
@@ -1194,7 +1225,7 @@ int FuseAdapter::fgetattr(
   if (!xctl_.checkXctlFile(path_str)) {
     Stat stat;
     UserCredentials user_credentials;
-    GenerateUserCredentials(fuse_get_context(), &user_credentials);
+    GenerateUserCredentials(GetFuseContext(), &user_credentials);
 
     try {
       FileHandle* file_handle = reinterpret_cast<FileHandle*>(fi->fh);
@@ -1218,7 +1249,7 @@ int FuseAdapter::fgetattr(
     ConvertXtreemFSStatToFuse(stat, statbuf);
     return 0;
   } else {
-    fuse_context* ctx = fuse_get_context();
+    fuse_context* ctx = GetFuseContext();
     return xctl_.getattr(ctx->uid, ctx->gid, path_str, statbuf);
   }
 }
@@ -1236,7 +1267,7 @@ int FuseAdapter::release(const char *path, struct fuse_file_info *fi) {
 
     // Ensure POSIX semantics and release all locks of the filehandle's process.
     try {
-      file_handle->ReleaseLockOfProcess(fuse_get_context()->pid);
+      file_handle->ReleaseLockOfProcess(GetFuseContext()->pid);
     } catch(const XtreemFSException& e) {
       // We dont care if errors occurred.
     }
@@ -1262,7 +1293,7 @@ int FuseAdapter::release(const char *path, struct fuse_file_info *fi) {
 
 int FuseAdapter::readlink(const char *path, char *buf, size_t size) {
   UserCredentials user_credentials;
-  GenerateUserCredentials(fuse_get_context(), &user_credentials);
+  GenerateUserCredentials(GetFuseContext(), &user_credentials);
 
   try {
     string target_path = "";
@@ -1286,7 +1317,7 @@ int FuseAdapter::readlink(const char *path, char *buf, size_t size) {
 
 int FuseAdapter::rmdir(const char *path) {
   UserCredentials user_credentials;
-  GenerateUserCredentials(fuse_get_context(), &user_credentials);
+  GenerateUserCredentials(GetFuseContext(), &user_credentials);
 
   try {
     volume_->DeleteDirectory(user_credentials, string(path));
@@ -1305,7 +1336,7 @@ int FuseAdapter::rmdir(const char *path) {
 
 int FuseAdapter::symlink(const char *path, const char *link) {
   UserCredentials user_credentials;
-  GenerateUserCredentials(fuse_get_context(), &user_credentials);
+  GenerateUserCredentials(GetFuseContext(), &user_credentials);
 
   try {
     volume_->Symlink(user_credentials, string(path), string(link));
@@ -1324,7 +1355,7 @@ int FuseAdapter::symlink(const char *path, const char *link) {
 
 int FuseAdapter::rename(const char *path, const char *newpath) {
   UserCredentials user_credentials;
-  GenerateUserCredentials(fuse_get_context(), &user_credentials);
+  GenerateUserCredentials(GetFuseContext(), &user_credentials);
 
   try {
     volume_->Rename(user_credentials, string(path), string(newpath));
@@ -1343,7 +1374,7 @@ int FuseAdapter::rename(const char *path, const char *newpath) {
 
 int FuseAdapter::link(const char *path, const char *newpath) {
   UserCredentials user_credentials;
-  GenerateUserCredentials(fuse_get_context(), &user_credentials);
+  GenerateUserCredentials(GetFuseContext(), &user_credentials);
 
   try {
     volume_->Link(user_credentials, string(path), string(newpath));
@@ -1362,7 +1393,7 @@ int FuseAdapter::link(const char *path, const char *newpath) {
 
 int FuseAdapter::chmod(const char *path, mode_t mode) {
   UserCredentials user_credentials;
-  GenerateUserCredentials(fuse_get_context(), &user_credentials);
+  GenerateUserCredentials(GetFuseContext(), &user_credentials);
 
   Stat stat;
   InitializeStat(&stat);
@@ -1386,7 +1417,7 @@ int FuseAdapter::chmod(const char *path, mode_t mode) {
 
 int FuseAdapter::chown(const char *path, uid_t uid, gid_t gid) {
   UserCredentials user_credentials;
-  GenerateUserCredentials(fuse_get_context(), &user_credentials);
+  GenerateUserCredentials(GetFuseContext(), &user_credentials);
 
   Setattrs to_set = static_cast<Setattrs>(0);
   if (uid != static_cast<uid_t>(-1)) {
@@ -1440,7 +1471,7 @@ int FuseAdapter::setxattr(
   }
 
   UserCredentials user_credentials;
-  GenerateUserCredentials(fuse_get_context(), &user_credentials);
+  GenerateUserCredentials(GetFuseContext(), &user_credentials);
 
   // Ignore system attributes to avoid warnings while copying files (e.g. on OS X)
   if (string(name) == string("xtreemfs.file_id") ||
@@ -1481,7 +1512,7 @@ int FuseAdapter::setxattr(
 
 int FuseAdapter::listxattr(const char *path, char *list, size_t size) {
   UserCredentials user_credentials;
-  GenerateUserCredentials(fuse_get_context(), &user_credentials);
+  GenerateUserCredentials(GetFuseContext(), &user_credentials);
 
   try {
     boost::scoped_ptr<listxattrResponse> xattrs(
@@ -1531,7 +1562,7 @@ int FuseAdapter::removexattr(const char *path, const char *name) {
   }
 
   UserCredentials user_credentials;
-  GenerateUserCredentials(fuse_get_context(), &user_credentials);
+  GenerateUserCredentials(GetFuseContext(), &user_credentials);
 
   try {
     volume_->RemoveXAttr(user_credentials, path, string(name));
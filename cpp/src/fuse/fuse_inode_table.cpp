@@ -0,0 +1,178 @@
+/*
+ * Copyright (c) 2015 by Zuse Institute Berlin
+ *
+ * Licensed under the BSD License, see LICENSE file for details.
+ *
+ */
+
+#include "fuse/fuse_inode_table.h"
+
+#include <vector>
+
+using namespace std;
+
+namespace xtreemfs {
+
+const uint64_t FuseInodeTable::kRootInode;
+
+FuseInodeTable::FuseInodeTable() : next_inode_(kRootInode + 1) {
+  Entry& root = inodes_[kRootInode];
+  root.path = "/";
+  root.lookup_count = 1;
+  paths_["/"] = kRootInode;
+}
+
+uint64_t FuseInodeTable::Lookup(const std::string& path) {
+  boost::mutex::scoped_lock lock(mutex_);
+
+  PathMap::iterator path_it = paths_.find(path);
+  if (path_it != paths_.end()) {
+    ++inodes_[path_it->second].lookup_count;
+    return path_it->second;
+  }
+
+  const uint64_t inode = next_inode_++;
+  Entry& entry = inodes_[inode];
+  entry.path = path;
+  entry.lookup_count = 1;
+  paths_[path] = inode;
+  return inode;
+}
+
+void FuseInodeTable::Forget(uint64_t inode, uint64_t count) {
+  if (inode == kRootInode) {
+    return;
+  }
+
+  boost::mutex::scoped_lock lock(mutex_);
+  InodeMap::iterator it = inodes_.find(inode);
+  if (it == inodes_.end()) {
+    return;
+  }
+  if (it->second.lookup_count > count) {
+    it->second.lookup_count -= count;
+    return;
+  }
+
+  if (!it->second.removed) {
+    paths_.erase(it->second.path);
+  }
+  if (it->second.file_id != 0) {
+    RemoveHardLinkUnmutexed(it->second.file_id, inode);
+  }
+  inodes_.erase(it);
+}
+
+bool FuseInodeTable::GetPath(uint64_t inode, std::string* path) {
+  boost::mutex::scoped_lock lock(mutex_);
+  InodeMap::const_iterator it = inodes_.find(inode);
+  if (it == inodes_.end()) {
+    return false;
+  }
+  *path = it->second.path;
+  return !it->second.removed;
+}
+
+void FuseInodeTable::Rename(const std::string& path,
+                            const std::string& new_path) {
+  boost::mutex::scoped_lock lock(mutex_);
+  if (path == new_path) {
+    return;
+  }
+
+  RemoveUnmutexed(new_path);
+
+  // Collect the renamed entries first as the new paths may sort in between.
+  vector<pair<string, uint64_t> > renamed;
+  PathMap::iterator it = paths_.find(path);
+  if (it != paths_.end()) {
+    renamed.push_back(make_pair(new_path, it->second));
+    paths_.erase(it);
+  }
+  const string prefix = path == "/" ? path : path + "/";
+  it = paths_.lower_bound(prefix);
+  while (it != paths_.end() &&
+         it->first.compare(0, prefix.length(), prefix) == 0) {
+    renamed.push_back(make_pair(
+        new_path + "/" + it->first.substr(prefix.length()), it->second));
+    paths_.erase(it++);
+  }
+
+  for (size_t i = 0; i < renamed.size(); ++i) {
+    inodes_[renamed[i].second].path = renamed[i].first;
+    paths_[renamed[i].first] = renamed[i].second;
+  }
+}
+
+void FuseInodeTable::Remove(const std::string& path) {
+  boost::mutex::scoped_lock lock(mutex_);
+  RemoveUnmutexed(path);
+}
+
+bool FuseInodeTable::GetInode(const std::string& path, uint64_t* inode) {
+  boost::mutex::scoped_lock lock(mutex_);
+  PathMap::const_iterator it = paths_.find(path);
+  if (it == paths_.end()) {
+    return false;
+  }
+  *inode = it->second;
+  return true;
+}
+
+void FuseInodeTable::SetFileId(uint64_t inode, uint64_t file_id) {
+  boost::mutex::scoped_lock lock(mutex_);
+  InodeMap::iterator it = inodes_.find(inode);
+  if (it == inodes_.end() || it->second.file_id == file_id) {
+    return;
+  }
+  if (it->second.file_id != 0) {
+    RemoveHardLinkUnmutexed(it->second.file_id, inode);
+  }
+  it->second.file_id = file_id;
+  hard_links_.insert(make_pair(file_id, inode));
+}
+
+void FuseInodeTable::GetHardLinks(uint64_t inode,
+                                  std::vector<uint64_t>* links) {
+  boost::mutex::scoped_lock lock(mutex_);
+  InodeMap::const_iterator it = inodes_.find(inode);
+  if (it == inodes_.end() || it->second.file_id == 0) {
+    return;
+  }
+  pair<FileIdMap::const_iterator, FileIdMap::const_iterator> range
+      = hard_links_.equal_range(it->second.file_id);
+  for (FileIdMap::const_iterator link = range.first;
+       link != range.second; ++link) {
+    if (link->second != inode) {
+      links->push_back(link->second);
+    }
+  }
+}
+
+size_t FuseInodeTable::Size() {
+  boost::mutex::scoped_lock lock(mutex_);
+  return inodes_.size();
+}
+
+void FuseInodeTable::RemoveUnmutexed(const std::string& path) {
+  PathMap::iterator it = paths_.find(path);
+  if (it == paths_.end() || it->second == kRootInode) {
+    return;
+  }
+  inodes_[it->second].removed = true;
+  paths_.erase(it);
+}
+
+void FuseInodeTable::RemoveHardLinkUnmutexed(uint64_t file_id,
+                                             uint64_t inode) {
+  pair<FileIdMap::iterator, FileIdMap::iterator> range
+      = hard_links_.equal_range(file_id);
+  for (FileIdMap::iterator it = range.first; it != range.second; ++it) {
+    if (it->second == inode) {
+      hard_links_.erase(it);
+      return;
+    }
+  }
+}
+
+}  // namespace xtreemfs
@@ -0,0 +1,827 @@
+/*
+ * Copyright (c) 2015 by Zuse Institute Berlin
+ *
+ * Licensed under the BSD License, see LICENSE file for details.
+ *
+ */
+
+#include "fuse/fuse_lowlevel_adapter.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <sys/stat.h>
+#include <sys/statvfs.h>
+
+#include <boost/scoped_array.hpp>
+#include <cstring>
+#include <ctime>
+#include <string>
+#include <vector>
+
+#include "fuse/fuse_adapter.h"
+#include "fuse/fuse_options.h"
+#include "libxtreemfs/helper.h"
+
+using namespace std;
+
+namespace xtreemfs {
+
+namespace {
+
+/** The FuseLowLevelRequest lives on the stack, don't delete it. */
+void KeepRequest(FuseLowLevelRequest* request) {}
+
+/** Stores the access ("atime" = true) or modification time of "stat" in
+ *  "time". */
+void GetTimespec(const struct stat& stat, bool atime, struct timespec* time) {
+#ifdef __linux
+  *time = atime ? stat.st_atim : stat.st_mtim;
+#elif __APPLE__
+  *time = atime ? stat.st_atimespec : stat.st_mtimespec;
+#else
+  time->tv_sec = atime ? stat.st_atime : stat.st_mtime;
+  time->tv_nsec = 0;
+#endif
+}
+
+/** Buffer of a low-level readdir request which is filled by the filler
+ *  function of the high-level API. */
+struct DirectoryBuffer {
+  fuse_req_t req;
+  char* buffer;
+  size_t size;
+  size_t used;
+};
+
+int FillDirectoryBuffer(void* buf,
+                        const char* name,
+                        const struct stat* stbuf,
+                        off_t off) {
+  DirectoryBuffer* directory_buffer = reinterpret_cast<DirectoryBuffer*>(buf);
+
+  // fuse_add_direntry() only uses st_ino and st_mode, but requires them.
+  struct stat empty_stat;
+  if (stbuf == NULL) {
+    memset(&empty_stat, 0, sizeof(empty_stat));
+    stbuf = &empty_stat;
+  }
+
+  const size_t entry_size = fuse_add_direntry(directory_buffer->req,
+                                              NULL,
+                                              0,
+                                              name,
+                                              NULL,
+                                              0);
+  if (directory_buffer->used + entry_size > directory_buffer->size) {
+    // Buffer is full.
+    return 1;
+  }
+  fuse_add_direntry(directory_buffer->req,
+                    directory_buffer->buffer + directory_buffer->used,
+                    directory_buffer->size - directory_buffer->used,
+                    name,
+                    stbuf,
+                    off);
+  directory_buffer->used += entry_size;
+  return 0;
+}
+
+}  // anonymous namespace
+
+boost::thread_specific_ptr<FuseLowLevelRequest>
+    FuseLowLevelRequest::current_(&KeepRequest);
+
+FuseLowLevelRequest::FuseLowLevelRequest(fuse_req_t req) : req_(req) {
+  memset(&context_, 0, sizeof(context_));
+  const struct fuse_ctx* ctx = fuse_req_ctx(req);
+  context_.uid = ctx->uid;
+  context_.gid = ctx->gid;
+  context_.pid = ctx->pid;
+  context_.private_data = fuse_req_userdata(req);
+#if FUSE_MAJOR_VERSION > 2 || (FUSE_MAJOR_VERSION == 2 && FUSE_MINOR_VERSION >= 8)  // NOLINT
+  context_.umask = ctx->umask;
+#endif
+
+  current_.reset(this);
+}
+
+FuseLowLevelRequest::~FuseLowLevelRequest() {
+  current_.reset(NULL);
+}
+
+FuseLowLevelRequest* FuseLowLevelRequest::current() {
+  return current_.get();
+}
+
+FuseLowLevelAdapter::FuseLowLevelAdapter(FuseAdapter* fuse_adapter,
+                                         FuseOptions* options)
+    : fuse_adapter_(fuse_adapter),
+      timeout_s_(options->metadata_cache_size > 0
+                     ? static_cast<double>(options->metadata_cache_ttl_s)
+                     : 0.0),
+      channel_(NULL) {
+}
+
+void FuseLowLevelAdapter::SetChannel(struct fuse_chan* channel) {
+#if FUSE_MAJOR_VERSION > 2 || (FUSE_MAJOR_VERSION == 2 && FUSE_MINOR_VERSION >= 8)  // NOLINT
+  channel_ = channel;
+#endif
+}
+
+void FuseLowLevelAdapter::lookup(fuse_req_t req,
+                                 fuse_ino_t parent,
+                                 const char *name) {
+  string path;
+  if (!GetChildPath(req, parent, name, &path)) {
+    return;
+  }
+  FuseLowLevelRequest request(req);
+  ReplyEntry(req, path);
+}
+
+void FuseLowLevelAdapter::forget(fuse_req_t req,
+                                 fuse_ino_t ino,
+                                 unsigned long nlookup) {
+  inode_table_.Forget(ino, nlookup);
+  fuse_reply_none(req);
+}
+
+void FuseLowLevelAdapter::getattr(fuse_req_t req,
+                                  fuse_ino_t ino,
+                                  struct fuse_file_info *fi) {
+  string path;
+  if (!GetPath(req, ino, &path)) {
+    return;
+  }
+  FuseLowLevelRequest request(req);
+  ReplyAttr(req, ino, path);
+}
+
+void FuseLowLevelAdapter::setattr(fuse_req_t req,
+                                  fuse_ino_t ino,
+                                  struct stat *attr,
+                                  int to_set,
+                                  struct fuse_file_info *fi) {
+  string path;
+  if (fi != NULL) {
+    // ftruncate() also works on unlinked files.
+    path = GetOpenFilePath(ino);
+  } else if (!GetPath(req, ino, &path)) {
+    return;
+  }
+  FuseLowLevelRequest request(req);
+
+  int result = 0;
+  if (to_set & FUSE_SET_ATTR_MODE) {
+    result = fuse_adapter_->chmod(path.c_str(), attr->st_mode);
+  }
+  if (result == 0 && (to_set & (FUSE_SET_ATTR_UID | FUSE_SET_ATTR_GID))) {
+    result = fuse_adapter_->chown(
+        path.c_str(),
+        (to_set & FUSE_SET_ATTR_UID) ? attr->st_uid : static_cast<uid_t>(-1),
+        (to_set & FUSE_SET_ATTR_GID) ? attr->st_gid : static_cast<gid_t>(-1));
+  }
+  if (result == 0 && (to_set & FUSE_SET_ATTR_SIZE)) {
+    if (fi != NULL) {
+      result = fuse_adapter_->ftruncate(path.c_str(), attr->st_size, fi);
+    } else {
+      result = fuse_adapter_->truncate(path.c_str(), attr->st_size);
+    }
+  }
+  int set_times = to_set & (FUSE_SET_ATTR_ATIME | FUSE_SET_ATTR_MTIME);
+#ifdef FUSE_SET_ATTR_ATIME_NOW
+  set_times |= to_set & (FUSE_SET_ATTR_ATIME_NOW | FUSE_SET_ATTR_MTIME_NOW);
+#endif
+  if (result == 0 && set_times != 0) {
+    // FuseAdapter::utimens() always sets both times, so the unchanged one is
+    // taken from the current attributes.
+    struct stat current_stat;
+    memset(&current_stat, 0, sizeof(current_stat));
+    if ((to_set & FUSE_SET_ATTR_ATIME) == 0 ||
+        (to_set & FUSE_SET_ATTR_MTIME) == 0) {
+      result = fuse_adapter_->getattr(path.c_str(), &current_stat);
+    }
+    struct timespec times[2];
+    GetTimespec((to_set & FUSE_SET_ATTR_ATIME) ? *attr : current_stat,
+                true,
+                &times[0]);
+    GetTimespec((to_set & FUSE_SET_ATTR_MTIME) ? *attr : current_stat,
+                false,
+                &times[1]);
+#ifdef FUSE_SET_ATTR_ATIME_NOW
+    struct timespec now;
+    now.tv_sec = time(NULL);
+    now.tv_nsec = 0;
+    if (to_set & FUSE_SET_ATTR_ATIME_NOW) {
+      times[0] = now;
+    }
+    if (to_set & FUSE_SET_ATTR_MTIME_NOW) {
+      times[1] = now;
+    }
+#endif
+    if (result == 0) {
+      result = fuse_adapter_->utimens(path.c_str(), times);
+    }
+  }
+  // Some attributes may have changed even if a later one failed.
+  InvalidateHardLinks(ino);
+
+  if (result != 0) {
+    fuse_reply_err(req, -result);
+    return;
+  }
+  ReplyAttr(req, ino, path);
+}
+
+void FuseLowLevelAdapter::readlink(fuse_req_t req, fuse_ino_t ino) {
+  string path;
+  if (!GetPath(req, ino, &path)) {
+    return;
+  }
+  FuseLowLevelRequest request(req);
+
+  char link[PATH_MAX + 1];
+  const int result = fuse_adapter_->readlink(path.c_str(), link, sizeof(link));
+  if (result != 0) {
+    fuse_reply_err(req, -result);
+    return;
+  }
+  fuse_reply_readlink(req, link);
+}
+
+void FuseLowLevelAdapter::mknod(fuse_req_t req,
+                                fuse_ino_t parent,
+                                const char *name,
+                                mode_t mode,
+                                dev_t rdev) {
+  string path;
+  if (!GetChildPath(req, parent, name, &path)) {
+    return;
+  }
+  FuseLowLevelRequest request(req);
+
+  const int result = fuse_adapter_->mknod(path.c_str(), mode, rdev);
+  if (result != 0) {
+    fuse_reply_err(req, -result);
+    return;
+  }
+  ReplyEntry(req, path);
+}
+
+void FuseLowLevelAdapter::mkdir(fuse_req_t req,
+                                fuse_ino_t parent,
+                                const char *name,
+                                mode_t mode) {
+  string path;
+  if (!GetChildPath(req, parent, name, &path)) {
+    return;
+  }
+  FuseLowLevelRequest request(req);
+
+  const int result = fuse_adapter_->mkdir(path.c_str(), mode);
+  if (result != 0) {
+    fuse_reply_err(req, -result);
+    return;
+  }
+  ReplyEntry(req, path);
+}
+
+void FuseLowLevelAdapter::unlink(fuse_req_t req,
+                                 fuse_ino_t parent,
+                                 const char *name) {
+  string path;
+  if (!GetChildPath(req, parent, name, &path)) {
+    return;
+  }
+  FuseLowLevelRequest request(req);
+
+  const int result = fuse_adapter_->unlink(path.c_str());
+  if (result == 0) {
+    // The other links lost a link.
+    InvalidateHardLinks(path);
+    inode_table_.Remove(path);
+  }
+  fuse_reply_err(req, -result);
+}
+
+void FuseLowLevelAdapter::rmdir(fuse_req_t req,
+                                fuse_ino_t parent,
+                                const char *name) {
+  string path;
+  if (!GetChildPath(req, parent, name, &path)) {
+    return;
+  }
+  FuseLowLevelRequest request(req);
+
+  const int result = fuse_adapter_->rmdir(path.c_str());
+  if (result == 0) {
+    inode_table_.Remove(path);
+  }
+  fuse_reply_err(req, -result);
+}
+
+void FuseLowLevelAdapter::symlink(fuse_req_t req,
+                                  const char *link,
+                                  fuse_ino_t parent,
+                                  const char *name) {
+  string path;
+  if (!GetChildPath(req, parent, name, &path)) {
+    return;
+  }
+  FuseLowLevelRequest request(req);
+
+  const int result = fuse_adapter_->symlink(link, path.c_str());
+  if (result != 0) {
+    fuse_reply_err(req, -result);
+    return;
+  }
+  ReplyEntry(req, path);
+}
+
+void FuseLowLevelAdapter::rename(fuse_req_t req,
+                                 fuse_ino_t parent,
+                                 const char *name,
+                                 fuse_ino_t newparent,
+                                 const char *newname) {
+  string path;
+  string new_path;
+  if (!GetChildPath(req, parent, name, &path) ||
+      !GetChildPath(req, newparent, newname, &new_path)) {
+    return;
+  }
+  FuseLowLevelRequest request(req);
+
+  const int result = fuse_adapter_->rename(path.c_str(), new_path.c_str());
+  if (result == 0) {
+    // The other links of a replaced file lost a link.
+    InvalidateHardLinks(new_path);
+    inode_table_.Rename(path, new_path);
+  }
+  fuse_reply_err(req, -result);
+}
+
+void FuseLowLevelAdapter::link(fuse_req_t req,
+                               fuse_ino_t ino,
+                               fuse_ino_t newparent,
+                               const char *newname) {
+  string path;
+  string new_path;
+  if (!GetPath(req, ino, &path) ||
+      !GetChildPath(req, newparent, newname, &new_path)) {
+    return;
+  }
+  FuseLowLevelRequest request(req);
+
+  int result = fuse_adapter_->link(path.c_str(), new_path.c_str());
+  if (result != 0) {
+    fuse_reply_err(req, -result);
+    return;
+  }
+
+  struct fuse_entry_param entry;
+  result = LookupEntry(new_path, &entry);
+  if (result != 0) {
+    fuse_reply_err(req, -result);
+    return;
+  }
+  // The link count of "ino" and of all its previous links changed.
+  TrackHardLink(ino, entry.attr);
+  InvalidateHardLinks(entry.ino);
+  if (fuse_reply_entry(req, &entry) != 0) {
+    inode_table_.Forget(entry.ino, 1);
+  }
+}
+
+void FuseLowLevelAdapter::open(fuse_req_t req,
+                               fuse_ino_t ino,
+                               struct fuse_file_info *fi) {
+  string path;
+  if (!GetPath(req, ino, &path)) {
+    return;
+  }
+  FuseLowLevelRequest request(req);
+
+  const int result = fuse_adapter_->open(path.c_str(), fi);
+  if (result != 0) {
+    fuse_reply_err(req, -result);
+    return;
+  }
+  if (fuse_reply_open(req, fi) != 0) {
+    // The request was interrupted, the kernel won't release the file.
+    fuse_adapter_->release(path.c_str(), fi);
+  }
+}
+
+void FuseLowLevelAdapter::read(fuse_req_t req,
+                               fuse_ino_t ino,
+                               size_t size,
+                               off_t off,
+                               struct fuse_file_info *fi) {
+  const string path = GetOpenFilePath(ino);
+  FuseLowLevelRequest request(req);
+
+  boost::scoped_array<char> buffer(new char[size]);
+  const int result = fuse_adapter_->read(path.c_str(),
+                                         buffer.get(),
+                                         size,
+                                         off,
+                                         fi);
+  if (result < 0) {
+    fuse_reply_err(req, -result);
+    return;
+  }
+  fuse_reply_buf(req, buffer.get(), result);
+}
+
+void FuseLowLevelAdapter::write(fuse_req_t req,
+                                fuse_ino_t ino,
+                                const char *buf,
+                                size_t size,
+                                off_t off,
+                                struct fuse_file_info *fi) {
+  const string path = GetOpenFilePath(ino);
+  FuseLowLevelRequest request(req);
+
+  const int result = fuse_adapter_->write(path.c_str(), buf, size, off, fi);
+  if (result < 0) {
+    fuse_reply_err(req, -result);
+    return;
+  }
+  InvalidateHardLinks(ino);
+  fuse_reply_write(req, result);
+}
+
+void FuseLowLevelAdapter::flush(fuse_req_t req,
+                                fuse_ino_t ino,
+                                struct fuse_file_info *fi) {
+  const string path = GetOpenFilePath(ino);
+  FuseLowLevelRequest request(req);
+
+  fuse_reply_err(req, -fuse_adapter_->flush(path.c_str(), fi));
+}
+
+void FuseLowLevelAdapter::release(fuse_req_t req,
+                                  fuse_ino_t ino,
+                                  struct fuse_file_info *fi) {
+  const string path = GetOpenFilePath(ino);
+  FuseLowLevelRequest request(req);
+
+  fuse_reply_err(req, -fuse_adapter_->release(path.c_str(), fi));
+}
+
+void FuseLowLevelAdapter::fsync(fuse_req_t req,
+                                fuse_ino_t ino,
+                                int datasync,
+                                struct fuse_file_info *fi) {
+  const string path = GetOpenFilePath(ino);
+  FuseLowLevelRequest request(req);
+
+  // Like the high-level fsync, a flush writes back all data.
+  fuse_reply_err(req, -fuse_adapter_->flush(path.c_str(), fi));
+}
+
+void FuseLowLevelAdapter::opendir(fuse_req_t req,
+                                  fuse_ino_t ino,
+                                  struct fuse_file_info *fi) {
+  string path;
+  if (!GetPath(req, ino, &path)) {
+    return;
+  }
+  FuseLowLevelRequest request(req);
+
+  const int result = fuse_adapter_->opendir(path.c_str(), fi);
+  if (result != 0) {
+    fuse_reply_err(req, -result);
+    return;
+  }
+  if (fuse_reply_open(req, fi) != 0) {
+    fuse_adapter_->releasedir(path.c_str(), fi);
+  }
+}
+
+void FuseLowLevelAdapter::readdir(fuse_req_t req,
+                                  fuse_ino_t ino,
+                                  size_t size,
+                                  off_t off,
+                                  struct fuse_file_info *fi) {
+  const string path = GetOpenFilePath(ino);
+  FuseLowLevelRequest request(req);
+
+  boost::scoped_array<char> buffer(new char[size]);
+  DirectoryBuffer directory_buffer;
+  directory_buffer.req = req;
+  directory_buffer.buffer = buffer.get();
+  directory_buffer.size = size;
+  directory_buffer.used = 0;
+
+  const int result = fuse_adapter_->readdir(path.c_str(),
+                                            &directory_buffer,
+                                            &FillDirectoryBuffer,
+                                            off,
+                                            fi);
+  if (result != 0) {
+    fuse_reply_err(req, -result);
+    return;
+  }
+  fuse_reply_buf(req, buffer.get(), directory_buffer.used);
+}
+
+void FuseLowLevelAdapter::releasedir(fuse_req_t req,
+                                     fuse_ino_t ino,
+                                     struct fuse_file_info *fi) {
+  const string path = GetOpenFilePath(ino);
+  FuseLowLevelRequest request(req);
+
+  fuse_reply_err(req, -fuse_adapter_->releasedir(path.c_str(), fi));
+}
+
+void FuseLowLevelAdapter::statfs(fuse_req_t req, fuse_ino_t ino) {
+  FuseLowLevelRequest request(req);
+
+  struct statvfs statv;
+  memset(&statv, 0, sizeof(statv));
+  const int result = fuse_adapter_->statfs("/", &statv);
+  if (result != 0) {
+    fuse_reply_err(req, -result);
+    return;
+  }
+  fuse_reply_statfs(req, &statv);
+}
+
+void FuseLowLevelAdapter::setxattr(fuse_req_t req,
+                                   fuse_ino_t ino,
+                                   const char *name,
+                                   const char *value,
+                                   size_t size,
+                                   int flags) {
+  string path;
+  if (!GetPath(req, ino, &path)) {
+    return;
+  }
+  FuseLowLevelRequest request(req);
+
+  fuse_reply_err(
+      req, -fuse_adapter_->setxattr(path.c_str(), name, value, size, flags));
+}
+
+void FuseLowLevelAdapter::getxattr(fuse_req_t req,
+                                   fuse_ino_t ino,
+                                   const char *name,
+                                   size_t size) {
+  string path;
+  if (!GetPath(req, ino, &path)) {
+    return;
+  }
+  FuseLowLevelRequest request(req);
+
+  if (size == 0) {
+    // Only the size of the value was requested.
+    const int result = fuse_adapter_->getxattr(path.c_str(), name, NULL, 0);
+    if (result < 0) {
+      fuse_reply_err(req, -result);
+    } else {
+      fuse_reply_xattr(req, result);
+    }
+    return;
+  }
+
+  boost::scoped_array<char> value(new char[size]);
+  const int result = fuse_adapter_->getxattr(path.c_str(),
+                                             name,
+                                             value.get(),
+                                             size);
+  if (result < 0) {
+    fuse_reply_err(req, -result);
+    return;
+  }
+  fuse_reply_buf(req, value.get(), result);
+}
+
+void FuseLowLevelAdapter::listxattr(fuse_req_t req,
+                                    fuse_ino_t ino,
+                                    size_t size) {
+  string path;
+  if (!GetPath(req, ino, &path)) {
+    return;
+  }
+  FuseLowLevelRequest request(req);
+
+  if (size == 0) {
+    const int result = fuse_adapter_->listxattr(path.c_str(), NULL, 0);
+    if (result < 0) {
+      fuse_reply_err(req, -result);
+    } else {
+      fuse_reply_xattr(req, result);
+    }
+    return;
+  }
+
+  boost::scoped_array<char> list(new char[size]);
+  const int result = fuse_adapter_->listxattr(path.c_str(), list.get(), size);
+  if (result < 0) {
+    fuse_reply_err(req, -result);
+    return;
+  }
+  fuse_reply_buf(req, list.get(), result);
+}
+
+void FuseLowLevelAdapter::removexattr(fuse_req_t req,
+                                      fuse_ino_t ino,
+                                      const char *name) {
+  string path;
+  if (!GetPath(req, ino, &path)) {
+    return;
+  }
+  FuseLowLevelRequest request(req);
+
+  fuse_reply_err(req, -fuse_adapter_->removexattr(path.c_str(), name));
+}
+
+void FuseLowLevelAdapter::access(fuse_req_t req, fuse_ino_t ino, int mask) {
+  string path;
+  if (!GetPath(req, ino, &path)) {
+    return;
+  }
+  FuseLowLevelRequest request(req);
+
+  fuse_reply_err(req, -fuse_adapter_->access(path.c_str(), mask));
+}
+
+void FuseLowLevelAdapter::create(fuse_req_t req,
+                                 fuse_ino_t parent,
+                                 const char *name,
+                                 mode_t mode,
+                                 struct fuse_file_info *fi) {
+  string path;
+  if (!GetChildPath(req, parent, name, &path)) {
+    return;
+  }
+  FuseLowLevelRequest request(req);
+
+  int result = fuse_adapter_->create(path.c_str(), mode, fi);
+  if (result != 0) {
+    fuse_reply_err(req, -result);
+    return;
+  }
+
+  struct fuse_entry_param entry;
+  result = LookupEntry(path, &entry);
+  if (result != 0) {
+    fuse_adapter_->release(path.c_str(), fi);
+    fuse_reply_err(req, -result);
+    return;
+  }
+  if (fuse_reply_create(req, &entry, fi) != 0) {
+    // The request was interrupted, the kernel does not know the inode.
+    inode_table_.Forget(entry.ino, 1);
+    fuse_adapter_->release(path.c_str(), fi);
+  }
+}
+
+void FuseLowLevelAdapter::getlk(fuse_req_t req,
+                                fuse_ino_t ino,
+                                struct fuse_file_info *fi,
+                                struct flock *lock) {
+  const string path = GetOpenFilePath(ino);
+  FuseLowLevelRequest request(req);
+
+  const int result = fuse_adapter_->lock(path.c_str(), fi, F_GETLK, lock);
+  if (result != 0) {
+    fuse_reply_err(req, -result);
+    return;
+  }
+  fuse_reply_lock(req, lock);
+}
+
+void FuseLowLevelAdapter::setlk(fuse_req_t req,
+                                fuse_ino_t ino,
+                                struct fuse_file_info *fi,
+                                struct flock *lock,
+                                int sleep) {
+  const string path = GetOpenFilePath(ino);
+  FuseLowLevelRequest request(req);
+
+  fuse_reply_err(req, -fuse_adapter_->lock(path.c_str(),
+                                           fi,
+                                           sleep ? F_SETLKW : F_SETLK,
+                                           lock));
+}
+
+bool FuseLowLevelAdapter::GetPath(fuse_req_t req,
+                                  fuse_ino_t ino,
+                                  std::string* path) {
+  if (!inode_table_.GetPath(ino, path)) {
+    fuse_reply_err(req, ENOENT);
+    return false;
+  }
+  return true;
+}
+
+bool FuseLowLevelAdapter::GetChildPath(fuse_req_t req,
+                                       fuse_ino_t parent,
+                                       const char *name,
+                                       std::string* path) {
+  string parent_path;
+  if (!GetPath(req, parent, &parent_path)) {
+    return false;
+  }
+  *path = ConcatenatePath(parent_path, name);
+  return true;
+}
+
+std::string FuseLowLevelAdapter::GetOpenFilePath(fuse_ino_t ino) {
+  string path;
+  inode_table_.GetPath(ino, &path);
+  return path;
+}
+
+int FuseLowLevelAdapter::LookupEntry(const std::string& path,
+                                     struct fuse_entry_param* entry) {
+  memset(entry, 0, sizeof(*entry));
+  const int result = fuse_adapter_->getattr(path.c_str(), &entry->attr);
+  if (result != 0) {
+    return result;
+  }
+  entry->ino = inode_table_.Lookup(path);
+  TrackHardLink(entry->ino, entry->attr);
+  entry->generation = 0;
+  entry->attr_timeout = GetAttrTimeout(path, entry->attr);
+  entry->entry_timeout = GetEntryTimeout(path);
+  return 0;
+}
+
+void FuseLowLevelAdapter::ReplyEntry(fuse_req_t req, const std::string& path) {
+  struct fuse_entry_param entry;
+  const int result = LookupEntry(path, &entry);
+  if (result != 0) {
+    fuse_reply_err(req, -result);
+    return;
+  }
+  if (fuse_reply_entry(req, &entry) != 0) {
+    // The request was interrupted, the kernel did not count the lookup.
+    inode_table_.Forget(entry.ino, 1);
+  }
+}
+
+void FuseLowLevelAdapter::ReplyAttr(fuse_req_t req,
+                                    fuse_ino_t ino,
+                                    const std::string& path) {
+  struct stat attr;
+  memset(&attr, 0, sizeof(attr));
+  const int result = fuse_adapter_->getattr(path.c_str(), &attr);
+  if (result != 0) {
+    fuse_reply_err(req, -result);
+    return;
+  }
+  TrackHardLink(ino, attr);
+  fuse_reply_attr(req, &attr, GetAttrTimeout(path, attr));
+}
+
+double FuseLowLevelAdapter::GetAttrTimeout(const std::string& path,
+                                           const struct stat& stat) {
+  // The kernel does not see changes of the attributes through other hard
+  // links. Unless it can be told about them, their attributes are not cached.
+  if ((!S_ISDIR(stat.st_mode) && stat.st_nlink > 1 && channel_ == NULL) ||
+      fuse_adapter_->IsXctlFile(path)) {
+    return 0.0;
+  }
+  return timeout_s_;
+}
+
+void FuseLowLevelAdapter::TrackHardLink(fuse_ino_t ino,
+                                        const struct stat& stat) {
+  if (channel_ != NULL && !S_ISDIR(stat.st_mode) && stat.st_nlink > 1) {
+    // st_ino is the XtreemFS file id.
+    inode_table_.SetFileId(ino, stat.st_ino);
+  }
+}
+
+void FuseLowLevelAdapter::InvalidateHardLinks(fuse_ino_t ino) {
+  if (channel_ == NULL) {
+    return;
+  }
+  vector<uint64_t> links;
+  inode_table_.GetHardLinks(ino, &links);
+#if FUSE_MAJOR_VERSION > 2 || (FUSE_MAJOR_VERSION == 2 && FUSE_MINOR_VERSION >= 8)  // NOLINT
+  for (size_t i = 0; i < links.size(); ++i) {
+    // A negative offset invalidates the attributes only, which does not
+    // block on locks held by the current request. The kernel may have
+    // forgotten the inode meanwhile, so errors are ignored.
+    fuse_lowlevel_notify_inval_inode(channel_, links[i], -1, 0);
+  }
+#endif
+}
+
+void FuseLowLevelAdapter::InvalidateHardLinks(const std::string& path) {
+  uint64_t ino = 0;
+  if (channel_ != NULL && inode_table_.GetInode(path, &ino)) {
+    InvalidateHardLinks(ino);
+  }
+}
+
+double FuseLowLevelAdapter::GetEntryTimeout(const std::string& path) {
+  return fuse_adapter_->IsXctlFile(path) ? 0.0 : timeout_s_;
+}
+
+}  // namespace xtreemfs
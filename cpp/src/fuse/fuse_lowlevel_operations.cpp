@@ -0,0 +1,392 @@
+/*
+ * Copyright (c) 2015 by Zuse Institute Berlin
+ *
+ * Licensed under the BSD License, see LICENSE file for details.
+ *
+ */
+
+#include "fuse/fuse_lowlevel_operations.h"
+
+#include <cstring>
+
+#include "fuse/fuse_lowlevel_adapter.h"
+#include "fuse/fuse_operations.h"
+#include "util/logging.h"
+#include "util/metrics.h"
+
+using namespace std;
+using namespace xtreemfs::util;
+
+xtreemfs::FuseLowLevelAdapter* fuse_lowlevel_adapter = NULL;
+
+void xtreemfs_fuse_ll_fill_operations(struct fuse_lowlevel_ops *ops) {
+  memset(ops, 0, sizeof(*ops));
+  ops->init = xtreemfs_fuse_ll_init;
+  ops->destroy = xtreemfs_fuse_ll_destroy;
+  ops->lookup = xtreemfs_fuse_ll_lookup;
+  ops->forget = xtreemfs_fuse_ll_forget;
+  ops->getattr = xtreemfs_fuse_ll_getattr;
+  ops->setattr = xtreemfs_fuse_ll_setattr;
+  ops->readlink = xtreemfs_fuse_ll_readlink;
+  ops->mknod = xtreemfs_fuse_ll_mknod;
+  ops->mkdir = xtreemfs_fuse_ll_mkdir;
+  ops->unlink = xtreemfs_fuse_ll_unlink;
+  ops->rmdir = xtreemfs_fuse_ll_rmdir;
+  ops->symlink = xtreemfs_fuse_ll_symlink;
+  ops->rename = xtreemfs_fuse_ll_rename;
+  ops->link = xtreemfs_fuse_ll_link;
+  ops->open = xtreemfs_fuse_ll_open;
+  ops->read = xtreemfs_fuse_ll_read;
+  ops->write = xtreemfs_fuse_ll_write;
+  ops->flush = xtreemfs_fuse_ll_flush;
+  ops->release = xtreemfs_fuse_ll_release;
+  ops->fsync = xtreemfs_fuse_ll_fsync;
+  ops->opendir = xtreemfs_fuse_ll_opendir;
+  ops->readdir = xtreemfs_fuse_ll_readdir;
+  ops->releasedir = xtreemfs_fuse_ll_releasedir;
+  ops->fsyncdir = xtreemfs_fuse_ll_fsyncdir;
+  ops->statfs = xtreemfs_fuse_ll_statfs;
+  ops->setxattr = xtreemfs_fuse_ll_setxattr;
+  ops->getxattr = xtreemfs_fuse_ll_getxattr;
+  ops->listxattr = xtreemfs_fuse_ll_listxattr;
+  ops->removexattr = xtreemfs_fuse_ll_removexattr;
+  ops->access = xtreemfs_fuse_ll_access;
+  ops->create = xtreemfs_fuse_ll_create;
+  ops->getlk = xtreemfs_fuse_ll_getlk;
+  ops->setlk = xtreemfs_fuse_ll_setlk;
+}
+
+void xtreemfs_fuse_ll_init(void *userdata, struct fuse_conn_info *conn) {
+  if (Logging::log->loggingActive(LEVEL_DEBUG)) {
+    Logging::log->getLog(LEVEL_DEBUG) << "xtreemfs_fuse_ll_init " << endl;
+  }
+  xtreemfs_fuse_set_connection_parameters(conn);
+}
+
+void xtreemfs_fuse_ll_destroy(void *userdata) {
+  if (Logging::log->loggingActive(LEVEL_DEBUG)) {
+    Logging::log->getLog(LEVEL_DEBUG) << "xtreemfs_fuse_ll_destroy " << endl;
+  }
+}
+
+void xtreemfs_fuse_ll_lookup(fuse_req_t req, fuse_ino_t parent,
+                             const char *name) {
+  SCOPED_LATENCY_TIMER("fuse_lookup_latency_us");
+  if (Logging::log->loggingActive(LEVEL_DEBUG)) {
+    Logging::log->getLog(LEVEL_DEBUG) << "xtreemfs_fuse_ll_lookup " << name
+        << " in " << parent << endl;
+  }
+  fuse_lowlevel_adapter->lookup(req, parent, name);
+}
+
+void xtreemfs_fuse_ll_forget(fuse_req_t req, fuse_ino_t ino,
+                             unsigned long nlookup) {  // NOLINT
+  if (Logging::log->loggingActive(LEVEL_DEBUG)) {
+  SCOPED_LATENCY_TIMER("fuse_forget_latency_us");
+    Logging::log->getLog(LEVEL_DEBUG) << "xtreemfs_fuse_ll_forget " << ino
+        << " " << nlookup << endl;
+  }
+  fuse_lowlevel_adapter->forget(req, ino, nlookup);
+}
+
+void xtreemfs_fuse_ll_getattr(fuse_req_t req, fuse_ino_t ino,
+                              struct fuse_file_info *fi) {
+  SCOPED_LATENCY_TIMER("fuse_getattr_latency_us");
+  if (Logging::log->loggingActive(LEVEL_DEBUG)) {
+    Logging::log->getLog(LEVEL_DEBUG) << "xtreemfs_fuse_ll_getattr " << ino
+        << endl;
+  }
+  fuse_lowlevel_adapter->getattr(req, ino, fi);
+}
+
+void xtreemfs_fuse_ll_setattr(fuse_req_t req, fuse_ino_t ino,
+                              struct stat *attr, int to_set,
+                              struct fuse_file_info *fi) {
+  SCOPED_LATENCY_TIMER("fuse_setattr_latency_us");
+  if (Logging::log->loggingActive(LEVEL_DEBUG)) {
+    Logging::log->getLog(LEVEL_DEBUG) << "xtreemfs_fuse_ll_setattr " << ino
+        << " " << to_set << endl;
+  }
+  fuse_lowlevel_adapter->setattr(req, ino, attr, to_set, fi);
+}
+
+void xtreemfs_fuse_ll_readlink(fuse_req_t req, fuse_ino_t ino) {
+  SCOPED_LATENCY_TIMER("fuse_readlink_latency_us");
+  if (Logging::log->loggingActive(LEVEL_DEBUG)) {
+    Logging::log->getLog(LEVEL_DEBUG) << "xtreemfs_fuse_ll_readlink " << ino
+        << endl;
+  }
+  fuse_lowlevel_adapter->readlink(req, ino);
+}
+
+void xtreemfs_fuse_ll_mknod(fuse_req_t req, fuse_ino_t parent,
+                            const char *name, mode_t mode, dev_t rdev) {
+  SCOPED_LATENCY_TIMER("fuse_mknod_latency_us");
+  if (Logging::log->loggingActive(LEVEL_DEBUG)) {
+    Logging::log->getLog(LEVEL_DEBUG) << "xtreemfs_fuse_ll_mknod " << name
+        << " in " << parent << endl;
+  }
+  fuse_lowlevel_adapter->mknod(req, parent, name, mode, rdev);
+}
+
+void xtreemfs_fuse_ll_mkdir(fuse_req_t req, fuse_ino_t parent,
+                            const char *name, mode_t mode) {
+  SCOPED_LATENCY_TIMER("fuse_mkdir_latency_us");
+  if (Logging::log->loggingActive(LEVEL_DEBUG)) {
+    Logging::log->getLog(LEVEL_DEBUG) << "xtreemfs_fuse_ll_mkdir " << name
+        << " in " << parent << endl;
+  }
+  fuse_lowlevel_adapter->mkdir(req, parent, name, mode);
+}
+
+void xtreemfs_fuse_ll_unlink(fuse_req_t req, fuse_ino_t parent,
+                             const char *name) {
+  SCOPED_LATENCY_TIMER("fuse_unlink_latency_us");
+  if (Logging::log->loggingActive(LEVEL_DEBUG)) {
+    Logging::log->getLog(LEVEL_DEBUG) << "xtreemfs_fuse_ll_unlink " << name
+        << " in " << parent << endl;
+  }
+  fuse_lowlevel_adapter->unlink(req, parent, name);
+}
+
+void xtreemfs_fuse_ll_rmdir(fuse_req_t req, fuse_ino_t parent,
+                            const char *name) {
+  SCOPED_LATENCY_TIMER("fuse_rmdir_latency_us");
+  if (Logging::log->loggingActive(LEVEL_DEBUG)) {
+    Logging::log->getLog(LEVEL_DEBUG) << "xtreemfs_fuse_ll_rmdir " << name
+        << " in " << parent << endl;
+  }
+  fuse_lowlevel_adapter->rmdir(req, parent, name);
+}
+
+void xtreemfs_fuse_ll_symlink(fuse_req_t req, const char *link,
+                              fuse_ino_t parent, const char *name) {
+  SCOPED_LATENCY_TIMER("fuse_symlink_latency_us");
+  if (Logging::log->loggingActive(LEVEL_DEBUG)) {
+    Logging::log->getLog(LEVEL_DEBUG) << "xtreemfs_fuse_ll_symlink " << name
+        << " in " << parent << " to " << link << endl;
+  }
+  fuse_lowlevel_adapter->symlink(req, link, parent, name);
+}
+
+void xtreemfs_fuse_ll_rename(fuse_req_t req, fuse_ino_t parent,
+                             const char *name, fuse_ino_t newparent,
+                             const char *newname) {
+  SCOPED_LATENCY_TIMER("fuse_rename_latency_us");
+  if (Logging::log->loggingActive(LEVEL_DEBUG)) {
+    Logging::log->getLog(LEVEL_DEBUG) << "xtreemfs_fuse_ll_rename " << name
+        << " in " << parent << " to " << newname << " in " << newparent
+        << endl;
+  }
+  fuse_lowlevel_adapter->rename(req, parent, name, newparent, newname);
+}
+
+void xtreemfs_fuse_ll_link(fuse_req_t req, fuse_ino_t ino,
+                           fuse_ino_t newparent, const char *newname) {
+  SCOPED_LATENCY_TIMER("fuse_link_latency_us");
+  if (Logging::log->loggingActive(LEVEL_DEBUG)) {
+    Logging::log->getLog(LEVEL_DEBUG) << "xtreemfs_fuse_ll_link " << ino
+        << " to " << newname << " in " << newparent << endl;
+  }
+  fuse_lowlevel_adapter->link(req, ino, newparent, newname);
+}
+
+void xtreemfs_fuse_ll_open(fuse_req_t req, fuse_ino_t ino,
+                           struct fuse_file_info *fi) {
+  SCOPED_LATENCY_TIMER("fuse_open_latency_us");
+  if (Logging::log->loggingActive(LEVEL_DEBUG)) {
+    Logging::log->getLog(LEVEL_DEBUG) << "xtreemfs_fuse_ll_open " << ino
+        << endl;
+  }
+  fuse_lowlevel_adapter->open(req, ino, fi);
+}
+
+void xtreemfs_fuse_ll_read(fuse_req_t req, fuse_ino_t ino, size_t size,
+                           off_t off, struct fuse_file_info *fi) {
+  SCOPED_LATENCY_TIMER("fuse_read_latency_us");
+  if (Logging::log->loggingActive(LEVEL_DEBUG)) {
+    Logging::log->getLog(LEVEL_DEBUG) << "xtreemfs_fuse_ll_read " << ino
+        << " s: " << size << " o: " << off << endl;
+  }
+  fuse_lowlevel_adapter->read(req, ino, size, off, fi);
+}
+
+void xtreemfs_fuse_ll_write(fuse_req_t req, fuse_ino_t ino, const char *buf,
+                            size_t size, off_t off,
+                            struct fuse_file_info *fi) {
+  SCOPED_LATENCY_TIMER("fuse_write_latency_us");
+  if (Logging::log->loggingActive(LEVEL_DEBUG)) {
+    Logging::log->getLog(LEVEL_DEBUG) << "xtreemfs_fuse_ll_write " << ino
+        << " s: " << size << " o: " << off << endl;
+  }
+  fuse_lowlevel_adapter->write(req, ino, buf, size, off, fi);
+}
+
+void xtreemfs_fuse_ll_flush(fuse_req_t req, fuse_ino_t ino,
+                            struct fuse_file_info *fi) {
+  SCOPED_LATENCY_TIMER("fuse_flush_latency_us");
+  if (Logging::log->loggingActive(LEVEL_DEBUG)) {
+    Logging::log->getLog(LEVEL_DEBUG) << "xtreemfs_fuse_ll_flush " << ino
+        << endl;
+  }
+  fuse_lowlevel_adapter->flush(req, ino, fi);
+}
+
+void xtreemfs_fuse_ll_release(fuse_req_t req, fuse_ino_t ino,
+                              struct fuse_file_info *fi) {
+  SCOPED_LATENCY_TIMER("fuse_release_latency_us");
+  if (Logging::log->loggingActive(LEVEL_DEBUG)) {
+    Logging::log->getLog(LEVEL_DEBUG) << "xtreemfs_fuse_ll_release " << ino
+        << endl;
+  }
+  fuse_lowlevel_adapter->release(req, ino, fi);
+}
+
+void xtreemfs_fuse_ll_fsync(fuse_req_t req, fuse_ino_t ino, int datasync,
+                            struct fuse_file_info *fi) {
+  SCOPED_LATENCY_TIMER("fuse_fsync_latency_us");
+  if (Logging::log->loggingActive(LEVEL_DEBUG)) {
+    Logging::log->getLog(LEVEL_DEBUG) << "xtreemfs_fuse_ll_fsync " << ino
+        << endl;
+  }
+  fuse_lowlevel_adapter->fsync(req, ino, datasync, fi);
+}
+
+void xtreemfs_fuse_ll_opendir(fuse_req_t req, fuse_ino_t ino,
+                              struct fuse_file_info *fi) {
+  SCOPED_LATENCY_TIMER("fuse_opendir_latency_us");
+  if (Logging::log->loggingActive(LEVEL_DEBUG)) {
+    Logging::log->getLog(LEVEL_DEBUG) << "xtreemfs_fuse_ll_opendir " << ino
+        << endl;
+  }
+  fuse_lowlevel_adapter->opendir(req, ino, fi);
+}
+
+void xtreemfs_fuse_ll_readdir(fuse_req_t req, fuse_ino_t ino, size_t size,
+                              off_t off, struct fuse_file_info *fi) {
+  SCOPED_LATENCY_TIMER("fuse_readdir_latency_us");
+  if (Logging::log->loggingActive(LEVEL_DEBUG)) {
+    Logging::log->getLog(LEVEL_DEBUG) << "xtreemfs_fuse_ll_readdir " << ino
+        << " s: " << size << " o: " << off << endl;
+  }
+  fuse_lowlevel_adapter->readdir(req, ino, size, off, fi);
+}
+
+void xtreemfs_fuse_ll_releasedir(fuse_req_t req, fuse_ino_t ino,
+                                 struct fuse_file_info *fi) {
+  SCOPED_LATENCY_TIMER("fuse_releasedir_latency_us");
+  if (Logging::log->loggingActive(LEVEL_DEBUG)) {
+    Logging::log->getLog(LEVEL_DEBUG) << "xtreemfs_fuse_ll_releasedir " << ino
+        << endl;
+  }
+  fuse_lowlevel_adapter->releasedir(req, ino, fi);
+}
+
+void xtreemfs_fuse_ll_fsyncdir(fuse_req_t req, fuse_ino_t ino, int datasync,
+                               struct fuse_file_info *fi) {
+  SCOPED_LATENCY_TIMER("fuse_fsyncdir_latency_us");
+  if (Logging::log->loggingActive(LEVEL_DEBUG)) {
+    Logging::log->getLog(LEVEL_DEBUG) << "xtreemfs_fuse_ll_fsyncdir " << ino
+        << endl;
+  }
+  // Like fsync, but for directories - not required for XtreemFS.
+  fuse_reply_err(req, 0);
+}
+
+void xtreemfs_fuse_ll_statfs(fuse_req_t req, fuse_ino_t ino) {
+  SCOPED_LATENCY_TIMER("fuse_statfs_latency_us");
+  if (Logging::log->loggingActive(LEVEL_DEBUG)) {
+    Logging::log->getLog(LEVEL_DEBUG) << "xtreemfs_fuse_ll_statfs " << ino
+        << endl;
+  }
+  fuse_lowlevel_adapter->statfs(req, ino);
+}
+
+void xtreemfs_fuse_ll_setxattr(
+    fuse_req_t req, fuse_ino_t ino, const char *name,
+    const char *value, size_t size, int flags
+#ifdef __APPLE__
+    , uint32_t position
+#endif
+    ) {
+  SCOPED_LATENCY_TIMER("fuse_setxattr_latency_us");
+  if (Logging::log->loggingActive(LEVEL_DEBUG)) {
+    Logging::log->getLog(LEVEL_DEBUG) << "xtreemfs_fuse_ll_setxattr " << ino
+        << " " << name << endl;
+  }
+  fuse_lowlevel_adapter->setxattr(req, ino, name, value, size, flags);
+}
+
+void xtreemfs_fuse_ll_getxattr(
+    fuse_req_t req, fuse_ino_t ino, const char *name, size_t size
+#ifdef __APPLE__
+    , uint32_t position
+#endif
+    ) {
+  SCOPED_LATENCY_TIMER("fuse_getxattr_latency_us");
+  if (Logging::log->loggingActive(LEVEL_DEBUG)) {
+    Logging::log->getLog(LEVEL_DEBUG) << "xtreemfs_fuse_ll_getxattr " << ino
+        << " " << name << " " << size << endl;
+  }
+  fuse_lowlevel_adapter->getxattr(req, ino, name, size);
+}
+
+void xtreemfs_fuse_ll_listxattr(fuse_req_t req, fuse_ino_t ino, size_t size) {
+  SCOPED_LATENCY_TIMER("fuse_listxattr_latency_us");
+  if (Logging::log->loggingActive(LEVEL_DEBUG)) {
+    Logging::log->getLog(LEVEL_DEBUG) << "xtreemfs_fuse_ll_listxattr " << ino
+        << " " << size << endl;
+  }
+  fuse_lowlevel_adapter->listxattr(req, ino, size);
+}
+
+void xtreemfs_fuse_ll_removexattr(fuse_req_t req, fuse_ino_t ino,
+                                  const char *name) {
+  SCOPED_LATENCY_TIMER("fuse_removexattr_latency_us");
+  if (Logging::log->loggingActive(LEVEL_DEBUG)) {
+    Logging::log->getLog(LEVEL_DEBUG) << "xtreemfs_fuse_ll_removexattr " << ino
+        << " " << name << endl;
+  }
+  fuse_lowlevel_adapter->removexattr(req, ino, name);
+}
+
+void xtreemfs_fuse_ll_access(fuse_req_t req, fuse_ino_t ino, int mask) {
+  SCOPED_LATENCY_TIMER("fuse_access_latency_us");
+  if (Logging::log->loggingActive(LEVEL_DEBUG)) {
+    Logging::log->getLog(LEVEL_DEBUG) << "xtreemfs_fuse_ll_access " << ino
+        << endl;
+  }
+  fuse_lowlevel_adapter->access(req, ino, mask);
+}
+
+void xtreemfs_fuse_ll_create(fuse_req_t req, fuse_ino_t parent,
+                             const char *name, mode_t mode,
+                             struct fuse_file_info *fi) {
+  SCOPED_LATENCY_TIMER("fuse_create_latency_us");
+  if (Logging::log->loggingActive(LEVEL_DEBUG)) {
+    Logging::log->getLog(LEVEL_DEBUG) << "xtreemfs_fuse_ll_create " << name
+        << " in " << parent << endl;
+  }
+  fuse_lowlevel_adapter->create(req, parent, name, mode, fi);
+}
+
+void xtreemfs_fuse_ll_getlk(fuse_req_t req, fuse_ino_t ino,
+                            struct fuse_file_info *fi, struct flock *lock) {
+  SCOPED_LATENCY_TIMER("fuse_getlk_latency_us");
+  if (Logging::log->loggingActive(LEVEL_DEBUG)) {
+    Logging::log->getLog(LEVEL_DEBUG) << "xtreemfs_fuse_ll_getlk " << ino
+        << endl;
+  }
+  fuse_lowlevel_adapter->getlk(req, ino, fi, lock);
+}
+
+void xtreemfs_fuse_ll_setlk(fuse_req_t req, fuse_ino_t ino,
+                            struct fuse_file_info *fi, struct flock *lock,
+                            int sleep) {
+  SCOPED_LATENCY_TIMER("fuse_setlk_latency_us");
+  if (Logging::log->loggingActive(LEVEL_DEBUG)) {
+    Logging::log->getLog(LEVEL_DEBUG) << "xtreemfs_fuse_ll_setlk " << ino
+        << " sleep: " << sleep << endl;
+  }
+  fuse_lowlevel_adapter->setlk(req, ino, fi, lock, sleep);
+}
@@ -9,6 +9,7 @@
 
 #include "fuse/fuse_adapter.h"
 #include "util/logging.h"
+#include "util/metrics.h"
 
 using namespace std;
 using namespace xtreemfs::util;
@@ -16,6 +17,7 @@ using namespace xtreemfs::util;
 xtreemfs::FuseAdapter* fuse_adapter = NULL;
 
 int xtreemfs_fuse_getattr(const char *path, struct stat *statbuf) {
+  SCOPED_LATENCY_TIMER("fuse_getattr_latency_us");
   if (Logging::log->loggingActive(LEVEL_DEBUG)) {
      Logging::log->getLog(LEVEL_DEBUG) << "getattr on path " << path << endl;
   }
@@ -23,6 +25,7 @@ int xtreemfs_fuse_getattr(const char *path, struct stat *statbuf) {
 }
 
 int xtreemfs_fuse_readlink(const char *path, char *link, size_t size) {
+  SCOPED_LATENCY_TIMER("fuse_readlink_latency_us");
   if (Logging::log->loggingActive(LEVEL_DEBUG)) {
      Logging::log->getLog(LEVEL_DEBUG)
          << "xtreemfs_fuse_readlink on path " << path << endl;
@@ -31,6 +34,7 @@ int xtreemfs_fuse_readlink(const char *path, char *link, size_t size) {
 }
 
 int xtreemfs_fuse_mknod(const char *path, mode_t mode, dev_t dev) {
+  SCOPED_LATENCY_TIMER("fuse_mknod_latency_us");
   if (Logging::log->loggingActive(LEVEL_DEBUG)) {
      Logging::log->getLog(LEVEL_DEBUG) << "xtreemfs_fuse_mknod on path "
          << path << endl;
@@ -39,6 +43,7 @@ int xtreemfs_fuse_mknod(const char *path, mode_t mode, dev_t dev) {
 }
 
 int xtreemfs_fuse_mkdir(const char *path, mode_t mode) {
+  SCOPED_LATENCY_TIMER("fuse_mkdir_latency_us");
   if (Logging::log->loggingActive(LEVEL_DEBUG)) {
      Logging::log->getLog(LEVEL_DEBUG) << "xtreemfs_fuse_mkdir on path "
          << path << endl;
@@ -47,6 +52,7 @@ int xtreemfs_fuse_mkdir(const char *path, mode_t mode) {
 }
 
 int xtreemfs_fuse_unlink(const char *path) {
+  SCOPED_LATENCY_TIMER("fuse_unlink_latency_us");
   if (Logging::log->loggingActive(LEVEL_DEBUG)) {
      Logging::log->getLog(LEVEL_DEBUG) << "xtreemfs_fuse_unlink " << path
          << endl;
@@ -55,6 +61,7 @@ int xtreemfs_fuse_unlink(const char *path) {
 }
 
 int xtreemfs_fuse_rmdir(const char *path) {
+  SCOPED_LATENCY_TIMER("fuse_rmdir_latency_us");
   if (Logging::log->loggingActive(LEVEL_DEBUG)) {
     Logging::log->getLog(LEVEL_DEBUG) << "xtreemfs_fuse_rmdir on path " << path
         << endl;
@@ -63,6 +70,7 @@ int xtreemfs_fuse_rmdir(const char *path) {
 }
 
 int xtreemfs_fuse_symlink(const char *path, const char *link) {
+  SCOPED_LATENCY_TIMER("fuse_symlink_latency_us");
   if (Logging::log->loggingActive(LEVEL_DEBUG)) {
     Logging::log->getLog(LEVEL_DEBUG) << "xtreemfs_fuse_symlink on path "
         << path << endl;
@@ -71,6 +79,7 @@ int xtreemfs_fuse_symlink(const char *path, const char *link) {
 }
 
 int xtreemfs_fuse_rename(const char *path, const char *newpath) {
+  SCOPED_LATENCY_TIMER("fuse_rename_latency_us");
   if (Logging::log->loggingActive(LEVEL_DEBUG)) {
     Logging::log->getLog(LEVEL_DEBUG)
         << "xtreemfs_fuse_rename on path " << path << " to " << newpath <<
@@ -80,6 +89,7 @@ int xtreemfs_fuse_rename(const char *path, const char *newpath) {
 }
 
 int xtreemfs_fuse_link(const char *path, const char *newpath) {
+  SCOPED_LATENCY_TIMER("fuse_link_latency_us");
   if (Logging::log->loggingActive(LEVEL_DEBUG)) {
     Logging::log->getLog(LEVEL_DEBUG)
         << "xtreemfs_fuse_link on path " << path << " " << newpath << endl;
@@ -88,6 +98,7 @@ int xtreemfs_fuse_link(const char *path, const char *newpath) {
 }
 
 int xtreemfs_fuse_chmod(const char *path, mode_t mode) {
+  SCOPED_LATENCY_TIMER("fuse_chmod_latency_us");
   if (Logging::log->loggingActive(LEVEL_DEBUG)) {
     Logging::log->getLog(LEVEL_DEBUG)  << "xtreemfs_fuse_chmod on path " << path
         << endl;
@@ -99,6 +110,7 @@ int xtreemfs_fuse_lock(const char* path,
                        struct fuse_file_info *fi,
                        int cmd,
                        struct flock* flock_) {
+  SCOPED_LATENCY_TIMER("fuse_lock_latency_us");
   if (Logging::log->loggingActive(LEVEL_DEBUG)) {
     string log_command;
     switch(cmd) {
@@ -139,6 +151,7 @@ int xtreemfs_fuse_lock(const char* path,
 }
 
 int xtreemfs_fuse_chown(const char *path, uid_t uid, gid_t gid) {
+  SCOPED_LATENCY_TIMER("fuse_chown_latency_us");
   if (Logging::log->loggingActive(LEVEL_DEBUG)) {
     Logging::log->getLog(LEVEL_DEBUG)  << "xtreemfs_fuse_chown on path " << path
         << endl;
@@ -147,6 +160,7 @@ int xtreemfs_fuse_chown(const char *path, uid_t uid, gid_t gid) {
 }
 
 int xtreemfs_fuse_truncate(const char *path, off_t new_file_size) {
+  SCOPED_LATENCY_TIMER("fuse_truncate_latency_us");
   if (Logging::log->loggingActive(LEVEL_DEBUG)) {
     Logging::log->getLog(LEVEL_DEBUG)
         << "xtreemfs_fuse_truncate on path " << path
@@ -156,6 +170,7 @@ int xtreemfs_fuse_truncate(const char *path, off_t new_file_size) {
 }
 
 int xtreemfs_fuse_utime(const char *path, struct utimbuf *ubuf) {
+  SCOPED_LATENCY_TIMER("fuse_utime_latency_us");
   if (Logging::log->loggingActive(LEVEL_DEBUG)) {
     Logging::log->getLog(LEVEL_DEBUG)  << "xtreemfs_fuse_utime on path " << path
         << endl;
@@ -164,6 +179,7 @@ int xtreemfs_fuse_utime(const char *path, struct utimbuf *ubuf) {
 }
 
 int xtreemfs_fuse_utimens(const char *path, const struct timespec tv[2]) {
+  SCOPED_LATENCY_TIMER("fuse_utimens_latency_us");
   if (Logging::log->loggingActive(LEVEL_DEBUG)) {
     Logging::log->getLog(LEVEL_DEBUG) << "xtreemfs_fuse_utimens on path "
         << path << endl;
@@ -172,6 +188,7 @@ int xtreemfs_fuse_utimens(const char *path, const struct timespec tv[2]) {
 }
 
 int xtreemfs_fuse_open(const char *path, struct fuse_file_info *fi) {
+  SCOPED_LATENCY_TIMER("fuse_open_latency_us");
   if (Logging::log->loggingActive(LEVEL_DEBUG)) {
      Logging::log->getLog(LEVEL_DEBUG)  << "xtreemfs_fuse_open on path " << path
          << endl;
@@ -180,6 +197,7 @@ int xtreemfs_fuse_open(const char *path, struct fuse_file_info *fi) {
 }
 
 int xtreemfs_fuse_release(const char *path, struct fuse_file_info *fi) {
+  SCOPED_LATENCY_TIMER("fuse_release_latency_us");
   if (Logging::log->loggingActive(LEVEL_DEBUG)) {
      Logging::log->getLog(LEVEL_DEBUG)  << "xtreemfs_fuse_release " << path
          << endl;
@@ -191,6 +209,7 @@ int xtreemfs_fuse_release(const char *path, struct fuse_file_info *fi) {
 int xtreemfs_fuse_read(
     const char *path, char *buf,
     size_t size, off_t offset, struct fuse_file_info *fi) {
+  SCOPED_LATENCY_TIMER("fuse_read_latency_us");
   if (Logging::log->loggingActive(LEVEL_DEBUG)) {
     Logging::log->getLog(LEVEL_DEBUG) << "xtreemfs_fuse_read " << path
         << " s:" << size <<  " o:" << offset << endl;
@@ -205,6 +224,7 @@ int xtreemfs_fuse_read(
 
 int xtreemfs_fuse_write(const char *path, const char *buf, size_t size,
     off_t offset, struct fuse_file_info *fi) {
+  SCOPED_LATENCY_TIMER("fuse_write_latency_us");
   if (Logging::log->loggingActive(LEVEL_DEBUG)) {
     Logging::log->getLog(LEVEL_DEBUG)  << "xtreemfs_fuse_write " << path
         << " s: " << size <<  " o:" << offset << endl;
@@ -218,6 +238,7 @@ int xtreemfs_fuse_write(const char *path, const char *buf, size_t size,
 }
 
 int xtreemfs_fuse_statfs(const char *path, struct statvfs *statv) {
+  SCOPED_LATENCY_TIMER("fuse_statfs_latency_us");
   if (Logging::log->loggingActive(LEVEL_DEBUG)) {
     Logging::log->getLog(LEVEL_DEBUG)  << "xtreemfs_fuse_statfs " << path
         << endl;
@@ -235,6 +256,7 @@ int xtreemfs_fuse_statfs(const char *path, struct statvfs *statv) {
  * to the close() of the user.
  */
 int xtreemfs_fuse_flush(const char *path, struct fuse_file_info *fi) {
+  SCOPED_LATENCY_TIMER("fuse_flush_latency_us");
   if (Logging::log->loggingActive(LEVEL_DEBUG)) {
     Logging::log->getLog(LEVEL_DEBUG)  << "xtreemfs_fuse_flush " << path
         << endl;
@@ -244,6 +266,7 @@ int xtreemfs_fuse_flush(const char *path, struct fuse_file_info *fi) {
 
 int xtreemfs_fuse_fsync(const char *path, int datasync,
     struct fuse_file_info *fi) {
+  SCOPED_LATENCY_TIMER("fuse_fsync_latency_us");
   if (Logging::log->loggingActive(LEVEL_DEBUG)) {
     Logging::log->getLog(LEVEL_DEBUG)  << "xtreemfs_fuse_fsync " << path
         << endl;
@@ -261,6 +284,7 @@ int xtreemfs_fuse_setxattr(
     , uint32_t position
 #endif
     ) {
+  SCOPED_LATENCY_TIMER("fuse_setxattr_latency_us");
   if (Logging::log->loggingActive(LEVEL_DEBUG)) {
      Logging::log->getLog(LEVEL_DEBUG)
          << "xtreemfs_fuse_setxattr " << " " << path << " " << name << endl;
@@ -274,6 +298,7 @@ int xtreemfs_fuse_getxattr(
     , uint32_t position
 #endif
     ) {
+  SCOPED_LATENCY_TIMER("fuse_getxattr_latency_us");
   if (Logging::log->loggingActive(LEVEL_DEBUG)) {
     Logging::log->getLog(LEVEL_DEBUG)
         << "xtreemfs_fuse_getxattr " << " " << path << " " << name << " "
@@ -283,6 +308,7 @@ int xtreemfs_fuse_getxattr(
 }
 
 int xtreemfs_fuse_listxattr(const char *path, char *list, size_t size) {
+  SCOPED_LATENCY_TIMER("fuse_listxattr_latency_us");
   if (Logging::log->loggingActive(LEVEL_DEBUG)) {
      Logging::log->getLog(LEVEL_DEBUG)
          << "xtreemfs_fuse_listxattr " << path << " " << size << endl;
@@ -291,6 +317,7 @@ int xtreemfs_fuse_listxattr(const char *path, char *list, size_t size) {
 }
 
 int xtreemfs_fuse_removexattr(const char *path, const char *name) {
+  SCOPED_LATENCY_TIMER("fuse_removexattr_latency_us");
   if (Logging::log->loggingActive(LEVEL_DEBUG)) {
      Logging::log->getLog(LEVEL_DEBUG)
          << "xtreemfs_fuse_removexattr " << " " << path << " " << name << endl;
@@ -299,6 +326,7 @@ int xtreemfs_fuse_removexattr(const char *path, const char *name) {
 }
 
 int xtreemfs_fuse_opendir(const char *path, struct fuse_file_info *fi) {
+  SCOPED_LATENCY_TIMER("fuse_opendir_latency_us");
   if (Logging::log->loggingActive(LEVEL_DEBUG)) {
     Logging::log->getLog(LEVEL_DEBUG)  << "xtreemfs_fuse_opendir " << path
         << endl;
@@ -309,6 +337,7 @@ int xtreemfs_fuse_opendir(const char *path, struct fuse_file_info *fi) {
 int xtreemfs_fuse_readdir(
     const char *path, void *buf,
     fuse_fill_dir_t filler, off_t offset, struct fuse_file_info *fi) {
+  SCOPED_LATENCY_TIMER("fuse_readdir_latency_us");
   if (Logging::log->loggingActive(LEVEL_DEBUG)) {
     Logging::log->getLog(LEVEL_DEBUG)  << "xtreemfs_fuse_readdir " << path
         << endl;
@@ -317,6 +346,7 @@ int xtreemfs_fuse_readdir(
 }
 
 int xtreemfs_fuse_releasedir(const char *path, struct fuse_file_info *fi) {
+  SCOPED_LATENCY_TIMER("fuse_releasedir_latency_us");
   if (Logging::log->loggingActive(LEVEL_DEBUG) && path != NULL) {
     Logging::log->getLog(LEVEL_DEBUG)  << "xtreemfs_fuse_releasedir " << path
         << endl;
@@ -326,6 +356,7 @@ int xtreemfs_fuse_releasedir(const char *path, struct fuse_file_info *fi) {
 
 int xtreemfs_fuse_fsyncdir(
     const char *path, int datasync, struct fuse_file_info *fi) {
+  SCOPED_LATENCY_TIMER("fuse_fsyncdir_latency_us");
   if (Logging::log->loggingActive(LEVEL_DEBUG)) {
     Logging::log->getLog(LEVEL_DEBUG)  << "xtreemfs_fuse_fsyncdir " << path
         << endl;
@@ -340,6 +371,13 @@ void *xtreemfs_fuse_init(struct fuse_conn_info *conn) {
     Logging::log->getLog(LEVEL_DEBUG)  << "xtreemfs_fuse_init " << endl;
   }
 
+  xtreemfs_fuse_set_connection_parameters(conn);
+
+  struct fuse_context* context = fuse_get_context();
+  return context->private_data;
+}
+
+void xtreemfs_fuse_set_connection_parameters(struct fuse_conn_info *conn) {
   // http://sourceforge.net/apps/mediawiki/fuse/index.php?title=Fuse_file_info
   // TODO(mberlin): Check for valid parameters.
   conn->async_read = 5;
@@ -354,9 +392,6 @@ void *xtreemfs_fuse_init(struct fuse_conn_info *conn) {
     = FUSE_CAP_ASYNC_READ | FUSE_CAP_BIG_WRITES
       | FUSE_CAP_ATOMIC_O_TRUNC | FUSE_CAP_POSIX_LOCKS;
 #endif
-
-  struct fuse_context* context = fuse_get_context();
-  return context->private_data;
 }
 
 void xtreemfs_fuse_destroy(void *userdata) {
@@ -373,6 +408,7 @@ void xtreemfs_fuse_destroy(void *userdata) {
  * on the result of the getattr, if the user is allowed to access the directory.
  */
 int xtreemfs_fuse_access(const char *path, int mask) {
+  SCOPED_LATENCY_TIMER("fuse_access_latency_us");
   if (Logging::log->loggingActive(LEVEL_DEBUG)) {
     Logging::log->getLog(LEVEL_DEBUG)  << "xtreemfs_fuse_access " << path
         << endl;
@@ -382,6 +418,7 @@ int xtreemfs_fuse_access(const char *path, int mask) {
 
 int xtreemfs_fuse_create(const char *path, mode_t mode,
     struct fuse_file_info *fi) {
+  SCOPED_LATENCY_TIMER("fuse_create_latency_us");
   if (Logging::log->loggingActive(LEVEL_DEBUG)) {
      Logging::log->getLog(LEVEL_DEBUG)  << "create on path " << path << endl;
   }
@@ -390,6 +427,7 @@ int xtreemfs_fuse_create(const char *path, mode_t mode,
 
 int xtreemfs_fuse_ftruncate(
     const char *path, off_t new_file_size, struct fuse_file_info *fi) {
+  SCOPED_LATENCY_TIMER("fuse_ftruncate_latency_us");
   if (Logging::log->loggingActive(LEVEL_DEBUG)) {
     Logging::log->getLog(LEVEL_DEBUG)
         << "xtreemfs_fuse_ftruncate on path " << path
@@ -400,6 +438,7 @@ int xtreemfs_fuse_ftruncate(
 
 int xtreemfs_fuse_fgetattr(
     const char *path, struct stat *statbuf, struct fuse_file_info *fi) {
+  SCOPED_LATENCY_TIMER("fuse_fgetattr_latency_us");
   if (Logging::log->loggingActive(LEVEL_DEBUG)) {
      Logging::log->getLog(LEVEL_DEBUG)  << "fgetattr on path " << path << endl;
   }
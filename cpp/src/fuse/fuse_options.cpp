@@ -62,8 +62,11 @@ FuseOptions::FuseOptions() : Options(), fuse_descriptions_("Fuse Options") {
   enable_xattrs = false;
 #endif  // __APPLE__
   foreground = false;
+  use_fuse_lowlevel = false;
   use_fuse_permission_checks = true;
   fuse_permission_checks_explicitly_disabled = false;
+  user_credentials_cache_size = 1024;
+  user_credentials_cache_ttl_s = 60;
 
   fuse_descriptions_.add_options()
     ("foreground,f", po::value(&foreground)->zero_tokens(),
@@ -75,7 +78,21 @@ FuseOptions::FuseOptions() : Options(), fuse_descriptions_("Fuse Options") {
     ("no-default-permissions",
         po::value(&fuse_permission_checks_explicitly_disabled)->zero_tokens(),
         "Do not pass -o default_permissions to Fuse (disables local Fuse"
-        " permissions checks).");
+        " permissions checks).")
+    ("fuse-lowlevel",
+        po::value(&use_fuse_lowlevel)->zero_tokens(),
+        "Use the inode based low-level Fuse API. The kernel caches entries and"
+        " attributes for --metadata-cache-ttl-s seconds.")
+    ("user-credentials-cache-size",
+        po::value(&user_credentials_cache_size)
+          ->default_value(user_credentials_cache_size),
+        "Number of processes whose user and group names are cached."
+        "\n(Set to 0 to disable the cache.)")
+    ("user-credentials-cache-ttl-s",
+        po::value(&user_credentials_cache_ttl_s)
+          ->default_value(user_credentials_cache_ttl_s),
+        "Time to live after which cached user and group names of a process"
+        " will expire.");
   po::options_description fuse_options_information(
       "ACL and extended attributes Support:\n"
       "  -o xtreemfs_acl Enable the correct evaluation of XtreemFS ACLs.\n"
@@ -25,6 +25,8 @@
 #include "util/logging.h"
 
 #include "fuse/fuse_adapter.h"
+#include "fuse/fuse_lowlevel_adapter.h"
+#include "fuse/fuse_lowlevel_operations.h"
 #include "fuse/fuse_operations.h"
 #include "fuse/fuse_options.h"
 #include "libxtreemfs/xtreemfs_exception.h"
@@ -122,6 +124,7 @@ int main(int argc, char **argv) {
   // Setup fuse and pass client and volume objects.
   struct fuse_chan* fuse_channel = NULL;
   struct fuse* fuse_ = NULL;
+  struct fuse_session* fuse_session = NULL;
   char* mount_point = NULL;
   // Fill in operations.
   struct fuse_operations xtreemfs_fuse_ops = {0};
@@ -219,20 +222,36 @@ int main(int argc, char **argv) {
     return errno;
   }
   // Create Fuse filesystem.
-  fuse_ = fuse_new(
-      fuse_channel,
-      &fuse_args,
-      &xtreemfs_fuse_ops,
-      sizeof(xtreemfs_fuse_ops),
-      NULL);
+  if (options.use_fuse_lowlevel) {
+    fuse_lowlevel_adapter
+        = new xtreemfs::FuseLowLevelAdapter(fuse_adapter, &options);
+    struct fuse_lowlevel_ops xtreemfs_fuse_ll_ops;
+    xtreemfs_fuse_ll_fill_operations(&xtreemfs_fuse_ll_ops);
+    fuse_session = fuse_lowlevel_new(&fuse_args,
+                                     &xtreemfs_fuse_ll_ops,
+                                     sizeof(xtreemfs_fuse_ll_ops),
+                                     NULL);
+    if (fuse_session != NULL) {
+      fuse_session_add_chan(fuse_session, fuse_channel);
+      fuse_lowlevel_adapter->SetChannel(fuse_channel);
+    }
+  } else {
+    fuse_ = fuse_new(
+        fuse_channel,
+        &fuse_args,
+        &xtreemfs_fuse_ops,
+        sizeof(xtreemfs_fuse_ops),
+        NULL);
+  }
   fuse_opt_free_args(&fuse_args);
-  if (fuse_ == NULL) {
+  if (fuse_ == NULL && fuse_session == NULL) {
     // Avoid "Transport endpoint is not connected" in case fuse_new failed.
     fuse_unmount(mount_point, fuse_channel);
     for (int i = 0; i < fuse_opts.size(); i++) {
       free(fuse_opts[i]);
     }
     free(mount_point);
+    delete fuse_lowlevel_adapter;
     // Stop FuseAdapter.
     fuse_adapter->Stop();
     delete fuse_adapter;
@@ -264,16 +283,29 @@ int main(int argc, char **argv) {
   }
 
   // Run fuse.
-  fuse_set_signal_handlers(fuse_get_session(fuse_));
-  fuse_adapter->SetInterruptQueryFunction();
-  fuse_loop_mt(fuse_);
-  // Cleanup
-  fuse_teardown(fuse_, mount_point);
+  if (fuse_session != NULL) {
+    fuse_set_signal_handlers(fuse_session);
+    fuse_adapter->SetInterruptQueryFunction();
+    fuse_session_loop_mt(fuse_session);
+    // Cleanup (what fuse_teardown() does for the high-level API).
+    fuse_remove_signal_handlers(fuse_session);
+    fuse_session_remove_chan(fuse_channel);
+    fuse_session_destroy(fuse_session);
+    fuse_unmount(mount_point, fuse_channel);
+    free(mount_point);
+  } else {
+    fuse_set_signal_handlers(fuse_get_session(fuse_));
+    fuse_adapter->SetInterruptQueryFunction();
+    fuse_loop_mt(fuse_);
+    // Cleanup
+    fuse_teardown(fuse_, mount_point);
+  }
   for (int i = 0; i < fuse_opts.size(); i++) {
     free(fuse_opts[i]);
   }
 
   // Stop FuseAdapter.
+  delete fuse_lowlevel_adapter;
   fuse_adapter->Stop();
   delete fuse_adapter;
 
@@ -9,6 +9,7 @@
 #include <stdarg.h>
 #include <stdint.h>
 #include <fcntl.h>
+#include <sys/uio.h>
 
 #include "ld_preload/passthrough.h"
 #include "ld_preload/preload.h"
@@ -146,6 +147,72 @@ ssize_t write(int fd, const void* buf, size_t nbyte) {
   }
 }
 
+ssize_t readv(int fd, const struct iovec* iov, int iovcnt) {
+  initialize_passthrough_if_necessary();
+  xprintf(" readv(%d)\n", fd);
+
+  if (overlay_initialized() && is_xtreemfs_fd(fd)) {
+    return xtreemfs_readv(fd, iov, iovcnt);
+  } else {
+    return ((funcptr_readv)libc_readv)(fd, iov, iovcnt);
+  }
+}
+
+ssize_t writev(int fd, const struct iovec* iov, int iovcnt) {
+  initialize_passthrough_if_necessary();
+  xprintf(" writev(%d)\n", fd);
+
+  if (overlay_initialized() && is_xtreemfs_fd(fd)) {
+    return xtreemfs_writev(fd, iov, iovcnt);
+  } else {
+    return ((funcptr_writev)libc_writev)(fd, iov, iovcnt);
+  }
+}
+
+ssize_t preadv(int fd, const struct iovec* iov, int iovcnt, off_t offset) {
+  initialize_passthrough_if_necessary();
+  xprintf(" preadv(%d)\n", fd);
+
+  if (overlay_initialized() && is_xtreemfs_fd(fd)) {
+    return xtreemfs_preadv(fd, iov, iovcnt, offset);
+  } else {
+    return ((funcptr_preadv)libc_preadv)(fd, iov, iovcnt, offset);
+  }
+}
+
+ssize_t preadv64(int fd, const struct iovec* iov, int iovcnt, __off64_t offset) {
+  initialize_passthrough_if_necessary();
+  xprintf(" preadv64(%d)\n", fd);
+
+  if (overlay_initialized() && is_xtreemfs_fd(fd)) {
+    return xtreemfs_preadv(fd, iov, iovcnt, offset);
+  } else {
+    return ((funcptr_preadv64)libc_preadv64)(fd, iov, iovcnt, offset);
+  }
+}
+
+ssize_t pwritev(int fd, const struct iovec* iov, int iovcnt, off_t offset) {
+  initialize_passthrough_if_necessary();
+  xprintf(" pwritev(%d)\n", fd);
+
+  if (overlay_initialized() && is_xtreemfs_fd(fd)) {
+    return xtreemfs_pwritev(fd, iov, iovcnt, offset);
+  } else {
+    return ((funcptr_pwritev)libc_pwritev)(fd, iov, iovcnt, offset);
+  }
+}
+
+ssize_t pwritev64(int fd, const struct iovec* iov, int iovcnt, __off64_t offset) {
+  initialize_passthrough_if_necessary();
+  xprintf(" pwritev64(%d)\n", fd);
+
+  if (overlay_initialized() && is_xtreemfs_fd(fd)) {
+    return xtreemfs_pwritev(fd, iov, iovcnt, offset);
+  } else {
+    return ((funcptr_pwritev64)libc_pwritev64)(fd, iov, iovcnt, offset);
+  }
+}
+
 int dup(int oldfd) {
   initialize_passthrough_if_necessary();
   xprintf(" dup(%d)\n", oldfd);
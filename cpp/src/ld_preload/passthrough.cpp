@@ -19,6 +19,12 @@ void* libc_read;
 void* libc_write;
 void* libc_pread;
 void* libc_pwrite;
+void* libc_readv;
+void* libc_writev;
+void* libc_preadv;
+void* libc_pwritev;
+void* libc_preadv64;
+void* libc_pwritev64;
 void* libc_dup;
 void* libc_dup2;
 void* libc_lseek;
@@ -58,6 +64,12 @@ static void initialize_passthrough() {
   libc_write = dlsym(libc, "write");
   libc_pread = dlsym(libc, "pread");
   libc_pwrite = dlsym(libc, "pwrite");
+  libc_readv = dlsym(libc, "readv");
+  libc_writev = dlsym(libc, "writev");
+  libc_preadv = dlsym(libc, "preadv");
+  libc_pwritev = dlsym(libc, "pwritev");
+  libc_preadv64 = dlsym(libc, "preadv64");
+  libc_pwritev64 = dlsym(libc, "pwritev64");
   libc_dup = dlsym(libc, "dup");
   libc_dup2 = dlsym(libc, "dup2");
   libc_lseek = dlsym(libc, "lseek");
@@ -155,6 +155,34 @@ uint64_t xtreemfs_write(int fd, const void* buf, uint64_t nbyte) {
   return written;
 }
 
+uint64_t xtreemfs_preadv(int fd, const struct iovec* iov, int iovcnt, uint64_t offset) {
+  xprintf(" readv xtreemfs(%d)\n", fd);
+  OpenFile handle = env->open_file_table_.Get(fd);
+  return handle.fh_->ReadV(iov, iovcnt, offset);
+}
+
+uint64_t xtreemfs_readv(int fd, const struct iovec* iov, int iovcnt) {
+  xprintf(" readv xtreemfs(%d)\n", fd);
+  OpenFile handle = env->open_file_table_.Get(fd);
+  int read = handle.fh_->ReadV(iov, iovcnt, handle.offset_);
+  env->open_file_table_.SetOffset(fd, handle.offset_ + read);
+  return read;
+}
+
+uint64_t xtreemfs_pwritev(int fd, const struct iovec* iov, int iovcnt, uint64_t offset) {
+  xprintf(" writev xtreemfs(%d)\n", fd);
+  OpenFile handle = env->open_file_table_.Get(fd);
+  return handle.fh_->WriteV(iov, iovcnt, offset);
+}
+
+uint64_t xtreemfs_writev(int fd, const struct iovec* iov, int iovcnt) {
+  xprintf(" writev xtreemfs(%d)\n", fd);
+  OpenFile handle = env->open_file_table_.Get(fd);
+  int written = handle.fh_->WriteV(iov, iovcnt, handle.offset_);
+  env->open_file_table_.SetOffset(fd, handle.offset_ + written);
+  return written;
+}
+
 int xtreemfs_dup2(int oldfd, int newfd) {
   xprintf(" dup2 xtreemfs(%d, %d)\n", oldfd, newfd);
   OpenFile handle = env->open_file_table_.Get(oldfd);
@@ -0,0 +1,246 @@
+/*
+ * Copyright (c) 2015 by Zuse Institute Berlin
+ *
+ * Licensed under the BSD License, see LICENSE file for details.
+ *
+ */
+
+#include "libxtreemfs/async_io_operation.h"
+
+#include <boost/bind.hpp>
+#include <boost/thread/thread.hpp>
+#include <cstring>
+
+#include "libxtreemfs/file_handle_implementation.h"
+#include "libxtreemfs/xtreemfs_exception.h"
+#include "util/logging.h"
+
+using namespace std;
+using namespace xtreemfs::pbrpc;
+using namespace xtreemfs::util;
+
+namespace xtreemfs {
+
+namespace {
+
+/** The context of an object request is its index in parts_. */
+void* IndexToContext(size_t index) {
+  return reinterpret_cast<void*>(index);
+}
+
+size_t ContextToIndex(void* context) {
+  return reinterpret_cast<size_t>(context);
+}
+
+}  // anonymous namespace
+
+AsyncIOOperation::AsyncIOOperation(
+    FileHandleImplementation* file_handle,
+    bool is_write,
+    char* buffer,
+    size_t count,
+    int64_t offset,
+    const FileHandle::IOCompletedCallback& completed,
+    AsyncIOTaskQueue* task_queue)
+    : file_handle_(file_handle),
+      is_write_(is_write),
+      buffer_(buffer),
+      count_(count),
+      offset_(offset),
+      completed_(completed),
+      task_queue_(task_queue),
+      pending_(1),
+      bytes_(0) {
+}
+
+void* AsyncIOOperation::AddObject(char* data, int size) {
+  boost::mutex::scoped_lock lock(mutex_);
+  ObjectPart part;
+  part.data = data;
+  part.size = size;
+  parts_.push_back(part);
+  pending_++;
+  return IndexToContext(parts_.size() - 1);
+}
+
+void AsyncIOOperation::ObjectNotSent(void* context) {
+  task_queue_->Enqueue(boost::bind(
+      &AsyncIOOperation::ExecuteObjectSynchronously, this, context));
+}
+
+void AsyncIOOperation::SendingFinished() {
+  ObjectFinished(0);
+}
+
+void AsyncIOOperation::SendingFailed(const XtreemFSException& error) {
+  SetError(error);
+  ObjectFinished(0);
+}
+
+void AsyncIOOperation::ExecuteSynchronously() {
+  ObjectNotSent(AddObject(buffer_, count_));
+  SendingFinished();
+}
+
+void AsyncIOOperation::ProcessTasks(AsyncIOTaskQueue& task_queue) {
+  while (!(boost::this_thread::interruption_requested() &&
+           boost::this_thread::interruption_enabled())) {
+    boost::function0<void> task = task_queue.Dequeue();
+    try {
+      task();
+    } catch (const exception& e) {
+      Logging::log->getLog(LEVEL_ERROR)
+          << "AsyncIOOperation::ProcessTasks(): caught unhandled exception: "
+          << e.what() << endl;
+    }
+  }
+}
+
+void AsyncIOOperation::CallFinished(ObjectData* response_message,
+                                    char* data,
+                                    uint32_t data_length,
+                                    RPCHeader::ErrorResponse* error,
+                                    void* context) {
+  task_queue_->Enqueue(boost::bind(&AsyncIOOperation::HandleReadResponse,
+                                   this,
+                                   response_message,
+                                   data,
+                                   data_length,
+                                   error,
+                                   context));
+}
+
+void AsyncIOOperation::CallFinished(OSDWriteResponse* response_message,
+                                    char* data,
+                                    uint32_t data_length,
+                                    RPCHeader::ErrorResponse* error,
+                                    void* context) {
+  task_queue_->Enqueue(boost::bind(&AsyncIOOperation::HandleWriteResponse,
+                                   this,
+                                   response_message,
+                                   data,
+                                   data_length,
+                                   error,
+                                   context));
+}
+
+void AsyncIOOperation::HandleReadResponse(ObjectData* response_message,
+                                          char* data,
+                                          uint32_t data_length,
+                                          RPCHeader::ErrorResponse* error,
+                                          void* context) {
+  ObjectPart part;
+  {
+    boost::mutex::scoped_lock lock(mutex_);
+    part = parts_[ContextToIndex(context)];
+  }
+
+  int bytes = -1;
+  if (error == NULL && response_message != NULL &&
+      static_cast<int>(data_length + response_message->zero_padding())
+          <= part.size &&
+      file_handle_->VerifyObjectData(*response_message, data, data_length)) {
+    if (data != part.data) {
+      memcpy(part.data, data, data_length);
+    }
+    // If zero_padding() > 0, the gap has to be filled with zeroes.
+    memset(part.data + data_length, 0, response_message->zero_padding());
+    bytes = data_length + response_message->zero_padding();
+  }
+
+  // The data was either received into the buffer or copied.
+  if (data != part.data) {
+    delete[] data;
+  }
+  delete response_message;
+  delete error;
+
+  if (bytes >= 0) {
+    ObjectFinished(bytes);
+  } else {
+    // Let Read() handle the retries, redirects and XCap renewals.
+    ExecuteObjectSynchronously(context);
+  }
+}
+
+void AsyncIOOperation::HandleWriteResponse(OSDWriteResponse* response_message,
+                                           char* data,
+                                           uint32_t data_length,
+                                           RPCHeader::ErrorResponse* error,
+                                           void* context) {
+  delete[] data;
+  if (error == NULL && response_message != NULL) {
+    // Takes ownership of the response.
+    file_handle_->RegisterWriteResponse(response_message);
+    boost::mutex::scoped_lock lock(mutex_);
+    const int bytes = parts_[ContextToIndex(context)].size;
+    lock.unlock();
+    ObjectFinished(bytes);
+  } else {
+    delete response_message;
+    delete error;
+    // Let Write() handle the retries, redirects and XCap renewals.
+    ExecuteObjectSynchronously(context);
+  }
+}
+
+void AsyncIOOperation::ExecuteObjectSynchronously(void* context) {
+  ObjectPart part;
+  {
+    boost::mutex::scoped_lock lock(mutex_);
+    part = parts_[ContextToIndex(context)];
+  }
+
+  int bytes = 0;
+  try {
+    const int64_t offset = offset_ + (part.data - buffer_);
+    if (is_write_) {
+      bytes = file_handle_->Write(part.data, part.size, offset);
+    } else {
+      bytes = file_handle_->Read(part.data, part.size, offset);
+    }
+  } catch (const XtreemFSException& e) {
+    SetError(e);
+  }
+  ObjectFinished(bytes);
+}
+
+void AsyncIOOperation::ObjectFinished(int bytes) {
+  boost::mutex::scoped_lock lock(mutex_);
+  bytes_ += bytes;
+  if (--pending_ > 0) {
+    return;
+  }
+  lock.unlock();
+
+  // All responses were received, so nobody else references this object.
+  // Completing on the task thread keeps the callback off the thread which
+  // sent the requests.
+  task_queue_->Enqueue(boost::bind(&AsyncIOOperation::Complete, this));
+}
+
+void AsyncIOOperation::SetError(const XtreemFSException& error) {
+  boost::mutex::scoped_lock lock(mutex_);
+  if (error_.get() != NULL) {
+    return;
+  }
+  const PosixErrorException* posix_error =
+      dynamic_cast<const PosixErrorException*>(&error);
+  if (posix_error != NULL) {
+    error_.reset(new PosixErrorException(*posix_error));
+  } else {
+    error_.reset(new XtreemFSException(error.what()));
+  }
+}
+
+void AsyncIOOperation::Complete() {
+  try {
+    completed_(bytes_, error_.get());
+  } catch (...) {
+    delete this;
+    throw;
+  }
+  delete this;
+}
+
+}  // namespace xtreemfs
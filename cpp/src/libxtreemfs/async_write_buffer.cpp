@@ -10,6 +10,7 @@
 #include <cassert>
 #include <cstring>
 
+#include "libxtreemfs/file_handle_implementation.h"
 #include "xtreemfs/OSD.pb.h"
 
 namespace xtreemfs {
@@ -18,8 +19,11 @@ AsyncWriteBuffer::AsyncWriteBuffer(xtreemfs::pbrpc::writeRequest* write_request,
                                    const char* data,
                                    size_t data_length,
                                    FileHandleImplementation* file_handle,
-                                   XCapHandler* xcap_handler)
+                                   XCapHandler* xcap_handler,
+                                   const boost::shared_ptr<BorrowedWriteData>&
+                                       borrowed_data)
     : write_request(write_request),
+      borrowed_data(borrowed_data),
       data_length(data_length),
       file_handle(file_handle),
       xcap_handler_(xcap_handler),
@@ -27,8 +31,7 @@ AsyncWriteBuffer::AsyncWriteBuffer(xtreemfs::pbrpc::writeRequest* write_request,
       state_(PENDING),
       retry_count_(0) {
   assert(write_request && data && file_handle);
-  this->data = new char[data_length];
-  memcpy(this->data, data, data_length);
+  SetData(data);
 }
 
 AsyncWriteBuffer::AsyncWriteBuffer(xtreemfs::pbrpc::writeRequest* write_request,
@@ -36,8 +39,11 @@ AsyncWriteBuffer::AsyncWriteBuffer(xtreemfs::pbrpc::writeRequest* write_request,
                                    size_t data_length,
                                    FileHandleImplementation* file_handle,
                                    XCapHandler* xcap_handler,
-                                   const std::string& osd_uuid)
+                                   const std::string& osd_uuid,
+                                   const boost::shared_ptr<BorrowedWriteData>&
+                                       borrowed_data)
     : write_request(write_request),
+      borrowed_data(borrowed_data),
       data_length(data_length),
       file_handle(file_handle),
       xcap_handler_(xcap_handler),
@@ -46,13 +52,27 @@ AsyncWriteBuffer::AsyncWriteBuffer(xtreemfs::pbrpc::writeRequest* write_request,
       state_(PENDING),
       retry_count_(0) {
   assert(write_request && data && file_handle);
-  this->data = new char[data_length];
-  memcpy(this->data, data, data_length);
+  SetData(data);
 }
 
 AsyncWriteBuffer::~AsyncWriteBuffer() {
   delete write_request;
-  delete[] data;
+  if (!borrowed_data) {
+    delete[] data;
+  }
+}
+
+void AsyncWriteBuffer::SetData(const char* data) {
+  if (borrowed_data) {
+    this->data = data;
+  } else {
+    char* copy = new char[data_length];
+    memcpy(copy, data, data_length);
+    this->data = copy;
+  }
+  file_handle->SetObjectChecksum(this->data,
+                                 data_length,
+                                 write_request->mutable_object_data());
 }
 
 }  // namespace xtreemfs
@@ -0,0 +1,231 @@
+/*
+ * Copyright (c) 2015 by Zuse Institute Berlin
+ *
+ * Licensed under the BSD License, see LICENSE file for details.
+ *
+ */
+
+#include "libxtreemfs/async_write_combiner.h"
+
+#include <boost/bind.hpp>
+#include <boost/checked_delete.hpp>
+#include <boost/shared_ptr.hpp>
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+
+#include "libxtreemfs/async_write_buffer.h"
+#include "libxtreemfs/async_write_handler.h"
+#include "libxtreemfs/file_handle_implementation.h"
+#include "libxtreemfs/xtreemfs_exception.h"
+#include "util/logging.h"
+#include "util/monotonic_clock.h"
+#include "xtreemfs/OSD.pb.h"
+
+using namespace std;
+using namespace xtreemfs::pbrpc;
+using namespace xtreemfs::util;
+
+namespace xtreemfs {
+
+namespace {
+
+AsyncWriteBuffer* NewAsyncWriteBuffer(
+    writeRequest* write_request,
+    const char* data,
+    size_t data_length,
+    FileHandleImplementation* file_handle,
+    XCapHandler* xcap_handler,
+    const string& osd_uuid,
+    const boost::shared_ptr<BorrowedWriteData>& borrowed_data) {
+  if (osd_uuid.empty()) {
+    return new AsyncWriteBuffer(write_request,
+                                data,
+                                data_length,
+                                file_handle,
+                                xcap_handler,
+                                borrowed_data);
+  } else {
+    return new AsyncWriteBuffer(write_request,
+                                data,
+                                data_length,
+                                file_handle,
+                                xcap_handler,
+                                osd_uuid,
+                                borrowed_data);
+  }
+}
+
+}  // anonymous namespace
+
+AsyncWriteCombiner::AsyncWriteCombiner(AsyncWriteHandler* async_write_handler,
+                                       size_t max_request_size)
+    : async_write_handler_(async_write_handler),
+      max_request_size_(max_request_size),
+      write_request_(NULL),
+      data_(NULL),
+      data_length_(0),
+      capacity_(0),
+      file_handle_(NULL),
+      xcap_handler_(NULL) {
+}
+
+AsyncWriteCombiner::~AsyncWriteCombiner() {
+  // All writes were flushed when the last FileHandle was closed.
+  assert(write_request_ == NULL);
+  delete write_request_;
+  delete[] data_;
+}
+
+void AsyncWriteCombiner::Write(writeRequest* write_request,
+                               const char* data,
+                               size_t data_length,
+                               FileHandleImplementation* file_handle,
+                               XCapHandler* xcap_handler,
+                               const string& osd_uuid) {
+  boost::mutex::scoped_lock lock(mutex_);
+
+  if (write_request_ != NULL) {
+    if (CanMerge(*write_request, data_length, file_handle)) {
+      Merge(*write_request, data, data_length);
+      delete write_request;
+      // A complete object does not get any larger.
+      if (data_length_ == max_request_size_) {
+        FlushHelper();
+      }
+      return;
+    }
+    FlushHelper();
+  }
+
+  if (data_length >= max_request_size_) {
+    // Nothing can be merged into this write.
+    Send(NewAsyncWriteBuffer(write_request,
+                             data,
+                             data_length,
+                             file_handle,
+                             xcap_handler,
+                             osd_uuid,
+                             boost::shared_ptr<BorrowedWriteData>()));
+    return;
+  }
+
+  write_request_ = write_request;
+  data_ = new char[data_length];
+  memcpy(data_, data, data_length);
+  data_length_ = data_length;
+  capacity_ = data_length;
+  file_handle_ = file_handle;
+  xcap_handler_ = xcap_handler;
+  osd_uuid_ = osd_uuid;
+  pending_since_ = util::MonotonicTime();
+}
+
+void AsyncWriteCombiner::Flush() {
+  boost::mutex::scoped_lock lock(mutex_);
+  if (write_request_ != NULL) {
+    FlushHelper();
+  }
+}
+
+void AsyncWriteCombiner::FlushIfOlderThan(
+    const boost::posix_time::ptime& deadline) {
+  boost::mutex::scoped_lock lock(mutex_);
+  if (write_request_ != NULL && pending_since_ < deadline) {
+    FlushHelper();
+  }
+}
+
+int64_t AsyncWriteCombiner::GetPendingFileSize() {
+  boost::mutex::scoped_lock lock(mutex_);
+  if (write_request_ == NULL) {
+    return 0;
+  }
+  const int64_t object_size = static_cast<int64_t>(
+      write_request_->file_credentials().xlocs().replicas(0)
+          .striping_policy().stripe_size()) * 1024;
+  return object_size * write_request_->object_number()
+      + write_request_->offset() + data_length_;
+}
+
+bool AsyncWriteCombiner::CanMerge(const writeRequest& write_request,
+                                  size_t data_length,
+                                  FileHandleImplementation* file_handle) const {
+  if (file_handle != file_handle_ ||
+      write_request.object_number() != write_request_->object_number()) {
+    return false;
+  }
+
+  // The ranges have to overlap or adjoin.
+  const size_t start = write_request_->offset();
+  const size_t end = start + data_length_;
+  const size_t new_start = write_request.offset();
+  const size_t new_end = new_start + data_length;
+  if (new_start > end || new_end < start) {
+    return false;
+  }
+  return max(end, new_end) - min(start, new_start) <= max_request_size_;
+}
+
+void AsyncWriteCombiner::Merge(const writeRequest& write_request,
+                               const char* data,
+                               size_t data_length) {
+  const size_t start = write_request_->offset();
+  const size_t new_start = write_request.offset();
+  const size_t merged_start = min(start, new_start);
+  const size_t merged_length =
+      max(start + data_length_, new_start + data_length) - merged_start;
+
+  if (merged_start < start || merged_length > capacity_) {
+    // Grow exponentially to copy sequentially written data only a few times.
+    const size_t capacity = min(max_request_size_,
+                                max(merged_length, 2 * capacity_));
+    char* merged_data = new char[capacity];
+    memcpy(merged_data + (start - merged_start), data_, data_length_);
+    delete[] data_;
+    data_ = merged_data;
+    capacity_ = capacity;
+  }
+  // The new data overwrites the older one.
+  memcpy(data_ + (new_start - merged_start), data, data_length);
+
+  write_request_->set_offset(merged_start);
+  data_length_ = merged_length;
+}
+
+void AsyncWriteCombiner::FlushHelper() {
+  // The AsyncWriteBuffer takes over data_ and deletes it when done.
+  boost::shared_ptr<BorrowedWriteData> owned_data(new BorrowedWriteData(
+      boost::bind(boost::checked_array_deleter<char>(), data_)));
+  AsyncWriteBuffer* write_buffer = NewAsyncWriteBuffer(write_request_,
+                                                       data_,
+                                                       data_length_,
+                                                       file_handle_,
+                                                       xcap_handler_,
+                                                       osd_uuid_,
+                                                       owned_data);
+  write_request_ = NULL;
+  data_ = NULL;
+  data_length_ = 0;
+  capacity_ = 0;
+
+  Send(write_buffer);
+}
+
+void AsyncWriteCombiner::Send(AsyncWriteBuffer* write_buffer) {
+  FileHandleImplementation* file_handle = write_buffer->file_handle;
+  try {
+    async_write_handler_->Write(write_buffer);
+  } catch (const XtreemFSException& e) {
+    // The write is lost, let the next operations of the FileHandle fail.
+    if (Logging::log->loggingActive(LEVEL_ERROR)) {
+      Logging::log->getLog(LEVEL_ERROR)
+          << "Failed to send a combined asynchronous write: " << e.what()
+          << endl;
+    }
+    file_handle->MarkAsyncWritesAsFailed();
+    throw;
+  }
+}
+
+}  // namespace xtreemfs
@@ -17,12 +17,15 @@
 #include "libxtreemfs/file_handle_implementation.h"
 #include "libxtreemfs/file_info.h"
 #include "libxtreemfs/interrupt.h"
+#include "libxtreemfs/read_ahead_handler.h"
 #include "libxtreemfs/uuid_iterator.h"
 #include "libxtreemfs/uuid_resolver.h"
 #include "libxtreemfs/xtreemfs_exception.h"
 #include "pbrpc/RPC.pb.h"
 #include "util/error_log.h"
 #include "util/logging.h"
+#include "util/metrics.h"
+#include "util/monotonic_clock.h"
 #include "util/synchronized_queue.h"
 #include "xtreemfs/OSDServiceClient.h"
 
@@ -32,6 +35,15 @@ using namespace xtreemfs::pbrpc;
 
 namespace xtreemfs {
 
+namespace {
+
+Counter* const bytes_in_flight_gauge =
+    MetricsRegistry::instance()->GetGauge("async_write_bytes_in_flight");
+Histogram* const blocked_histogram =
+    MetricsRegistry::instance()->GetHistogram("async_write_blocked_us");
+
+}  // anonymous namespace
+
 AsyncWriteHandler::AsyncWriteHandler(
     FileInfo* file_info,
     UUIDIterator* uuid_iterator,
@@ -110,24 +122,34 @@ void AsyncWriteHandler::Write(AsyncWriteBuffer* write_buffer) {
   assert(write_buffer);
 
   if (write_buffer->data_length > static_cast<size_t>(max_writeahead_)) {
+    const size_t data_length = write_buffer->data_length;
+    delete write_buffer;
     throw XtreemFSException("The maximum allowed writeahead size: "
         + boost::lexical_cast<string>(max_writeahead_)
         + " is smaller than the size of this write request: "
-        + boost::lexical_cast<string>(write_buffer->data_length));
+        + boost::lexical_cast<string>(data_length));
   }
 
   // Append to list of writes in flight.
   {
     boost::mutex::scoped_lock lock(mutex_);
 
+    boost::posix_time::ptime blocked_since;
     while ((state_ != FINALLY_FAILED) && (writing_paused_ ||
            (pending_bytes_ + write_buffer->data_length) >
                 static_cast<size_t>(max_writeahead_) ||
             writes_in_flight_.size() == max_requests_)) {
+      if (blocked_since.is_not_a_date_time()) {
+        blocked_since = util::MonotonicTime();
+      }
       // TODO(mberlin): Allow interruption and set the write status of the
       //                FileHandle of the interrupted write to an error state.
       pending_bytes_were_decreased_.wait(lock);
     }
+    if (!blocked_since.is_not_a_date_time()) {
+      blocked_histogram->Record(
+          (util::MonotonicTime() - blocked_since).total_microseconds());
+    }
     assert(writes_in_flight_.size() <= static_cast<size_t>(max_requests_));
 
     // NOTE: the following is done here to reach all threads that started
@@ -136,6 +158,7 @@ void AsyncWriteHandler::Write(AsyncWriteBuffer* write_buffer) {
       string error =
           "Tried to asynchronously write to a finally failed write handler.";
       Logging::log->getLog(LEVEL_ERROR) << error << endl;
+      delete write_buffer;
       throw PosixErrorException(POSIX_ERROR_EIO, error);
     }
 
@@ -305,6 +328,13 @@ void AsyncWriteHandler::HandleCallback(
     uint32_t data_length,
     xtreemfs::pbrpc::RPCHeader::ErrorResponse* error,
     void* context) {
+  // Objects which were read ahead while the write was in flight may be
+  // outdated now.
+  ReadAheadHandler* read_ahead_handler = file_info_->read_ahead_handler();
+  if (read_ahead_handler != NULL) {
+    read_ahead_handler->Clear();
+  }
+
   boost::mutex::scoped_lock lock(mutex_);
 
   bool delete_response_message = true;
@@ -553,6 +583,7 @@ void AsyncWriteHandler::IncreasePendingBytesHelper(
   assert(write_buffer && lock && lock->owns_lock());
 
   pending_bytes_ += write_buffer->data_length;
+  bytes_in_flight_gauge->Add(write_buffer->data_length);
   writes_in_flight_.push_back(write_buffer);
   assert(writes_in_flight_.size() <= static_cast<size_t>(max_requests_));
 
@@ -566,6 +597,7 @@ void AsyncWriteHandler::DecreasePendingBytesHelper(
   assert(write_buffer && lock && lock->owns_lock());
 
   pending_bytes_ -= write_buffer->data_length;
+  bytes_in_flight_gauge->Add(-static_cast<int64_t>(write_buffer->data_length));
 
   if (delete_buffer) {
     // the buffer is deleted
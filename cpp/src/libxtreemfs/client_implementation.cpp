@@ -25,6 +25,7 @@
 #include "libxtreemfs/xtreemfs_exception.h"
 #include "util/logging.h"
 #include "util/error_log.h"
+#include "util/metrics.h"
 #include "xtreemfs/DIRServiceClient.h"
 #include "xtreemfs/MRCServiceClient.h"
 #include "xtreemfs/OSDServiceClient.h"
@@ -62,42 +63,76 @@ void DIRUUIDResolver::UUIDToAddressWithOptions(const std::string& uuid,
   assert(!uuid.empty());
 
   // Try to search in cache.
-  *address = uuid_cache_.get(uuid);
-  if (!address->empty()) {
-    return;  // Cache-Hit.
+  switch (uuid_cache_.Lookup(uuid, true, address)) {
+    case UUIDCache::kHit:
+      return;  // Cache-Hit.
+    case UUIDCache::kRefresh:
+      // Use the cached address until the refresh arrives.
+      ResolveAsync(uuid);
+      return;
+    default:
+      break;
   }
 
-  addressMappingGetRequest rq = addressMappingGetRequest();
-  rq.set_uuid(uuid);
+  // Cache miss, other threads wait until this thread resolved the UUID.
+  try {
+    addressMappingGetRequest rq = addressMappingGetRequest();
+    rq.set_uuid(uuid);
+
+    boost::scoped_ptr<rpc::SyncCallbackBase> response(
+        ExecuteSyncRequest(
+            boost::bind(
+                &xtreemfs::pbrpc::DIRServiceClient::
+                    xtreemfs_address_mappings_get_sync,
+                dir_service_client_.get(),
+                _1,
+                boost::cref(dir_service_auth_),
+                boost::cref(dir_service_user_credentials_),
+                &rq),
+            &dir_uuid_iterator_,
+            NULL,
+            options,
+            true));
+
+    try {
+      *address = UpdateCache(
+          uuid, *static_cast<AddressMappingSet*>(response->response()));
+    } catch (const XtreemFSException&) {
+      response->DeleteBuffers();
+      throw;
+    }
+    response->DeleteBuffers();
+  } catch (...) {
+    uuid_cache_.AbortResolution(uuid);
+    throw;
+  }
+}
 
-  boost::scoped_ptr<rpc::SyncCallbackBase> response(
-      ExecuteSyncRequest(
-          boost::bind(
-              &xtreemfs::pbrpc::DIRServiceClient::
-                  xtreemfs_address_mappings_get_sync,
-              dir_service_client_.get(),
-              _1,
-              boost::cref(dir_service_auth_),
-              boost::cref(dir_service_user_credentials_),
-              &rq),
-          &dir_uuid_iterator_,
-          NULL,
-          options,
-          true));
+void DIRUUIDResolver::PrefetchUUIDs(const std::vector<std::string>& uuids) {
+  for (size_t i = 0; i < uuids.size(); ++i) {
+    string address;
+    UUIDCache::LookupResult result = uuid_cache_.Lookup(uuids[i],
+                                                        false,
+                                                        &address);
+    if (result == UUIDCache::kResolve || result == UUIDCache::kRefresh) {
+      ResolveAsync(uuids[i]);
+    }
+  }
+}
 
+std::string DIRUUIDResolver::UpdateCache(
+    const std::string& uuid,
+    const xtreemfs::pbrpc::AddressMappingSet& mappings) {
   boost::unordered_set<string> local_networks = GetNetworks();
-  AddressMappingSet* set = static_cast<AddressMappingSet*>(
-      response->response());
   AddressMapping found_address_mapping;
-  for (int i = 0; i < set->mappings_size(); i++) {
-    const AddressMapping& am = set->mappings(i);
+  for (int i = 0; i < mappings.mappings_size(); i++) {
+    const AddressMapping& am = mappings.mappings(i);
     if (am.protocol() != PBRPCURL::GetSchemePBRPC()
         && am.protocol() != PBRPCURL::GetSchemePBRPCS()
         && am.protocol() != PBRPCURL::GetSchemePBRPCG()
         && am.protocol() != PBRPCURL::GetSchemePBRPCU()) {
       Logging::log->getLog(LEVEL_ERROR)
           << "Unknown scheme: " << am.protocol() << endl;
-      response->DeleteBuffers();
       throw UnknownAddressSchemeException("Unknown scheme: " + am.protocol());
     }
 
@@ -115,26 +150,74 @@ void DIRUUIDResolver::UUIDToAddressWithOptions(const std::string& uuid,
     }
   }
 
-  if (found_address_mapping.IsInitialized()) {
-    uuid_cache_.update(uuid,
-                       found_address_mapping.address(),
-                       found_address_mapping.port(),
-                       found_address_mapping.ttl_s());
+  if (!found_address_mapping.IsInitialized()) {
+    Logging::log->getLog(LEVEL_ERROR)
+        << "Service not found for UUID: " << uuid << endl;
+    throw AddressToUUIDNotFoundException(uuid);
+  }
+
+  uuid_cache_.update(uuid,
+                     found_address_mapping.address(),
+                     found_address_mapping.port(),
+                     found_address_mapping.ttl_s());
+
+  ostringstream s;
+  s << found_address_mapping.address() << ":" << found_address_mapping.port();
+
+  if (Logging::log->loggingActive(LEVEL_DEBUG)) {
+    Logging::log->getLog(LEVEL_DEBUG)
+        << "Service found for UUID: " << s.str() << endl;
+  }
+  return s.str();
+}
+
+void DIRUUIDResolver::ResolveAsync(const std::string& uuid) {
+  string dir_address;
+  try {
+    dir_uuid_iterator_.GetUUID(&dir_address);
+  } catch (const XtreemFSException&) {
+    uuid_cache_.AbortResolution(uuid);
+    return;
+  }
 
-    ostringstream s;
-    s << found_address_mapping.address() << ":" << found_address_mapping.port();
+  addressMappingGetRequest rq = addressMappingGetRequest();
+  rq.set_uuid(uuid);
+  // The request is serialized immediately, only the UUID has to outlive it.
+  dir_service_client_->xtreemfs_address_mappings_get(
+      dir_address,
+      dir_service_auth_,
+      dir_service_user_credentials_,
+      &rq,
+      this,
+      new string(uuid));
+}
 
+void DIRUUIDResolver::CallFinished(
+    xtreemfs::pbrpc::AddressMappingSet* response_message,
+    char* data,
+    uint32_t data_length,
+    xtreemfs::pbrpc::RPCHeader::ErrorResponse* error,
+    void* context) {
+  boost::scoped_ptr<string> uuid(static_cast<string*>(context));
+  boost::scoped_ptr<AddressMappingSet> response(response_message);
+  boost::scoped_ptr<RPCHeader::ErrorResponse> error_response(error);
+  delete[] data;
+
+  if (error != NULL) {
+    // The refresh is retried after a delay or once the mapping expired.
     if (Logging::log->loggingActive(LEVEL_DEBUG)) {
       Logging::log->getLog(LEVEL_DEBUG)
-          << "Service found for UUID: " << s.str() << endl;
+          << "Failed to resolve the UUID " << *uuid << " asynchronously: "
+          << error->error_message() << endl;
     }
-    response->DeleteBuffers();
-    *address = s.str();
-  } else {
-    Logging::log->getLog(LEVEL_ERROR)
-        << "Service not found for UUID: " << uuid << endl;
-    response->DeleteBuffers();
-    throw AddressToUUIDNotFoundException(uuid);
+    uuid_cache_.AbortResolution(*uuid);
+    return;
+  }
+
+  try {
+    UpdateCache(*uuid, *response);
+  } catch (const XtreemFSException&) {
+    uuid_cache_.AbortResolution(*uuid);
   }
 }
 
@@ -307,7 +390,9 @@ ClientImplementation::ClientImplementation(
       dir_uuid_iterator_(dir_service_addresses),
       uuid_resolver_(dir_uuid_iterator_,
                      user_credentials,
-                     options) {
+                     options),
+      server_statistics_(options.request_timeout_s),
+      uuid_scorer_(&uuid_resolver_, &server_statistics_) {
 
   // Set bogus auth object.
   auth_bogus_.set_auth_type(AUTH_NONE);
@@ -364,7 +449,10 @@ void ClientImplementation::Start() {
       options_.connect_timeout_s,
       options_.request_timeout_s,
       options_.linger_timeout_s,
-      dir_service_ssl_options_));
+      dir_service_ssl_options_,
+      options_.rpc_io_threads,
+      options_.max_connections_per_server));
+  network_client_->set_server_statistics(&server_statistics_);
 
   network_client_thread_.reset(
       new boost::thread(boost::bind(&xtreemfs::rpc::Client::run,
@@ -390,6 +478,26 @@ void ClientImplementation::Start() {
   async_write_callback_thread_.reset(
       new boost::thread(&xtreemfs::AsyncWriteHandler::ProcessCallbacks, 
                         boost::ref(async_write_callback_queue_)));
+  async_io_thread_.reset(
+      new boost::thread(&xtreemfs::AsyncIOOperation::ProcessTasks,
+                        boost::ref(async_io_task_queue_)));
+
+  if (options_.shared_rpc_runtime || !options_.metrics_dump_file.empty()) {
+    periodic_task_scheduler_.Start();
+  }
+  if (!options_.metrics_dump_file.empty()) {
+    periodic_task_scheduler_.Schedule(
+        boost::bind(&ClientImplementation::WriteMetricsDumpFile, this),
+        boost::posix_time::seconds(options_.metrics_dump_interval_s));
+  }
+}
+
+void ClientImplementation::WriteMetricsDumpFile() {
+  if (!util::MetricsRegistry::instance()->WriteTextFile(
+          options_.metrics_dump_file)) {
+    Logging::log->getLog(LEVEL_WARN) << "Failed to write the metrics to: "
+        << options_.metrics_dump_file << endl;
+  }
 }
 
 void ClientImplementation::Shutdown() {
@@ -406,10 +514,19 @@ void ClientImplementation::Shutdown() {
       it = list_open_volumes_.erase(it);
     }
 
+    periodic_task_scheduler_.Stop();
+    if (!options_.metrics_dump_file.empty()) {
+      WriteMetricsDumpFile();
+    }
+
     if (async_write_callback_thread_->joinable()) {
       async_write_callback_thread_->interrupt();
       async_write_callback_thread_->join();
     }
+    if (async_io_thread_->joinable()) {
+      async_io_thread_->interrupt();
+      async_io_thread_->join();
+    }
 
     // Stop vivaldi thread if running
     if (vivaldi_thread_.get() && vivaldi_thread_->joinable()) {
@@ -756,6 +873,27 @@ std::string ClientImplementation::UUIDToAddress(const std::string& uuid) {
   return result;
 }
 
+rpc::Client* ClientImplementation::shared_network_client() {
+  return options_.shared_rpc_runtime ? network_client_.get() : NULL;
+}
+
+PeriodicTaskScheduler* ClientImplementation::periodic_task_scheduler() {
+  return options_.shared_rpc_runtime ? &periodic_task_scheduler_ : NULL;
+}
+
+rpc::ServerStatistics* ClientImplementation::server_statistics() {
+  return &server_statistics_;
+}
+
+UUIDScorer* ClientImplementation::uuid_scorer() {
+  return &uuid_scorer_;
+}
+
+void ClientImplementation::GetServerScores(
+    std::map<std::string, rpc::ServerScore>* scores) {
+  server_statistics_.GetScores(scores);
+}
+
 const VivaldiCoordinates& ClientImplementation::GetVivaldiCoordinates() const {
   return vivaldi_->GetVivaldiCoordinates();
 }
@@ -764,4 +902,8 @@ util::SynchronizedQueue<AsyncWriteHandler::CallbackEntry>& ClientImplementation:
   return async_write_callback_queue_;
 }
 
+AsyncIOTaskQueue& ClientImplementation::GetAsyncIOTaskQueue() {
+  return async_io_task_queue_;
+}
+
 }  // namespace xtreemfs
@@ -31,6 +31,7 @@
 #include "rpc/sync_callback.h"
 #include "util/error_log.h"
 #include "util/logging.h"
+#include "util/metrics.h"
 
 using std::endl;
 using std::string;
@@ -39,6 +40,17 @@ using namespace xtreemfs::pbrpc;
 
 namespace xtreemfs {
 
+namespace {
+
+/** Requests which were sent again after a redirect. */
+Counter* const redirects_counter =
+    MetricsRegistry::instance()->GetCounter("sync_request_redirects");
+/** Requests which were sent again after an error, e.g. a timeout. */
+Counter* const retries_counter =
+    MetricsRegistry::instance()->GetCounter("sync_request_retries");
+
+}  // anonymous namespace
+
 /** Helper function which delays the execution and logs an error.
  *
  * The delay ensures the server won't be flooded.
@@ -189,6 +201,7 @@ rpc::SyncCallbackBase* ExecuteSyncRequest(
       if (err.error_type() == REDIRECT) {
         retry = true;
         redirects_in_a_row++;
+        redirects_counter->Increment();
 
         assert(err.has_redirect_to_server_uuid());
         uuid_iterator->SetCurrentUUID(err.redirect_to_server_uuid());
@@ -311,6 +324,9 @@ rpc::SyncCallbackBase* ExecuteSyncRequest(
           (attempt < options.max_retries() || options.max_retries() == 0 ||
            // or this last retry should be delayed.
            (attempt == options.max_retries() && options.delay_last_attempt()))) {  // NOLINT
+        if (err.error_type() != REDIRECT) {
+          retries_counter->Increment();
+        }
         if (delayRetry) {
           DelayNextRetry(options, request_sent_time, delay_error, level, response);  // NOLINT
         }else{
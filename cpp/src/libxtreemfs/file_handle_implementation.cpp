@@ -9,27 +9,41 @@
 #include "libxtreemfs/file_handle_implementation.h"
 
 #include <boost/bind.hpp>
+#include <boost/date_time/posix_time/posix_time.hpp>
+#include <boost/scoped_array.hpp>
 #include <map>
 #include <memory>
 #include <string>
 #include <vector>
 
+#include "libxtreemfs/async_io_operation.h"
 #include "libxtreemfs/async_write_buffer.h"
+#include "libxtreemfs/async_write_combiner.h"
 #include "libxtreemfs/execute_sync_request.h"
 #include "libxtreemfs/file_info.h"
+#include "libxtreemfs/hedged_read.h"
 #include "libxtreemfs/helper.h"
+#include "libxtreemfs/object_cache.h"
 #include "libxtreemfs/options.h"
+#include "libxtreemfs/read_ahead_handler.h"
+#include "libxtreemfs/replica_selector.h"
 #include "libxtreemfs/stripe_translator.h"
 #include "libxtreemfs/container_uuid_iterator.h"
 #include "libxtreemfs/simple_uuid_iterator.h"
 #include "libxtreemfs/uuid_resolver.h"
 #include "libxtreemfs/volume.h"
+#include "rpc/client.h"
+#include "rpc/sync_callback.h"
 #include "libxtreemfs/xtreemfs_exception.h"
+#include "util/crc32c.h"
 #include "util/error_log.h"
+#include "util/reed_solomon.h"
 #include "util/logging.h"
+#include "util/monotonic_clock.h"
 #include "xtreemfs/MRCServiceClient.h"
 #include "xtreemfs/OSD.pb.h"
 #include "xtreemfs/OSDServiceClient.h"
+#include "xtreemfs/OSDServiceConstants.h"
 
 using namespace std;
 using namespace xtreemfs::pbrpc;
@@ -56,6 +70,7 @@ FileHandleImplementation::FileHandleImplementation(
     UUIDResolver* uuid_resolver,
     xtreemfs::pbrpc::MRCServiceClient* mrc_service_client,
     xtreemfs::pbrpc::OSDServiceClient* osd_service_client,
+    rpc::Client* network_client,
     const std::map<xtreemfs::pbrpc::StripingPolicyType,
                    StripeTranslator*>& stripe_translators,
     bool async_writes_enabled,
@@ -71,6 +86,7 @@ FileHandleImplementation::FileHandleImplementation(
       osd_write_response_for_async_write_back_(NULL),
       mrc_service_client_(mrc_service_client),
       osd_service_client_(osd_service_client),
+      network_client_(network_client),
       stripe_translators_(stripe_translators),
       async_writes_enabled_(async_writes_enabled),
       async_writes_failed_(false),
@@ -137,15 +153,24 @@ T FileHandleImplementation::ExecuteViewCheckedOperation(
 }
 
 int FileHandleImplementation::Read(char *buf, size_t count, int64_t offset) {
+  struct iovec iov;
+  iov.iov_base = buf;
+  iov.iov_len = count;
+  return ReadV(&iov, 1, offset);
+}
+
+int FileHandleImplementation::ReadV(const struct iovec* iov,
+                                    int iovcnt,
+                                    int64_t offset) {
   boost::function<int()> operation(
       boost::bind(&FileHandleImplementation::DoRead, this,
-                  buf, count, offset));
+                  iov, iovcnt, offset));
   return ExecuteViewCheckedOperation(operation);
 }
 
 int FileHandleImplementation::DoRead(
-    char *buf,
-    size_t count,
+    const struct iovec* iov,
+    int iovcnt,
     int64_t offset) {
 
   if (async_writes_enabled_) {
@@ -187,35 +212,479 @@ int FileHandleImplementation::DoRead(
 
   // Map offset to corresponding OSDs.
   std::vector<ReadOperation> operations;
-  translator->TranslateReadRequest(buf, count, offset, striping_policies,
-                                   &operations);
+  translator->TranslateReadRequestV(iov, iovcnt, offset, striping_policies,
+                                    &operations);
 
-  boost::scoped_ptr<ContainerUUIDIterator> temp_uuid_iterator_for_striping;
+  // Erasure coded objects may have to be reconstructed from their stripe,
+  // which neither the object cache nor the read ahead handler can do.
+  if ((*striping_policies.begin())->type() == STRIPING_POLICY_ERASURECODE) {
+    return ReadErasureCoded(file_credentials, operations);
+  }
 
-  // Read all objects.
+  // Reads of read-only replicated files try the replicas in the order chosen
+  // by the ReplicaSelector.
+  ReplicaSelector* replica_selector = file_info_->replica_selector();
+  std::vector<std::string> replica_uuids;
+  SimpleUUIDIterator replica_uuid_iterator;
+  if (replica_selector != NULL && ReplicaSelector::IsApplicable(xlocs)) {
+    replica_selector->OrderReplicas(xlocs, &replica_uuids);
+    for (size_t i = 0; i < replica_uuids.size(); i++) {
+      replica_uuid_iterator.AddUUID(replica_uuids[i]);
+    }
+    replica_uuid_iterator.set_scorer(file_info_->uuid_scorer());
+  } else {
+    replica_selector = NULL;
+  }
+  // The OSDs of read-only replicas are interchangeable, degraded ones are
+  // skipped.
+  UUIDScorer* striped_uuid_scorer =
+      ReplicaSelector::HasInterchangeableReplicas(xlocs)
+          ? file_info_->uuid_scorer() : NULL;
+
+  // Differ between striping and the rest (replication, no replication).
+  // Striped objects are read through their own UUID iterator which is derived
+  // from the OSD offsets of the object.
+  std::vector<boost::shared_ptr<ContainerUUIDIterator> >
+      temp_uuid_iterators_for_striping;
+  std::vector<UUIDIterator*> uuid_iterators;
+  uuid_iterators.reserve(operations.size());
   for (size_t j = 0; j < operations.size(); j++) {
-    // Differ between striping and the rest (replication, no replication).
-    UUIDIterator* uuid_iterator;
     if (xlocs.replicas(0).osd_uuids_size() > 1) {
       // Replica is striped. Get a UUID iterator from OSD offsets
-      temp_uuid_iterator_for_striping.reset(
-          new ContainerUUIDIterator(osd_uuid_container,
-                                    operations[j].osd_offsets));
-      uuid_iterator = temp_uuid_iterator_for_striping.get();
+      temp_uuid_iterators_for_striping.push_back(
+          boost::shared_ptr<ContainerUUIDIterator>(
+              new ContainerUUIDIterator(osd_uuid_container,
+                                        operations[j].osd_offsets)));
+      temp_uuid_iterators_for_striping.back()->set_scorer(striped_uuid_scorer);
+      uuid_iterators.push_back(temp_uuid_iterators_for_striping.back().get());
+    } else if (replica_selector != NULL) {
+      uuid_iterators.push_back(&replica_uuid_iterator);
+    } else {
+      uuid_iterators.push_back(osd_uuid_iterator_);
+    }
+  }
+
+  // Serve the read from the object cache, if enabled.
+  ObjectCache* object_cache = file_info_->object_cache();
+  if (object_cache != NULL) {
+    ObjectReaderFunction reader(boost::bind(
+        &FileHandleImplementation::ReadObjectFromOSD, this, _1, _2));
+    ObjectWriterFunction writer(boost::bind(
+        &FileHandleImplementation::WriteObjectToOSD, this, _1, _2, _3));
+    const int object_size = object_cache->object_size();
+    const size_t batch_size =
+        static_cast<size_t>(max(1, volume_options_.max_parallel_reads));
+    boost::scoped_array<char> fetched_data;
+    std::vector<ReadOperation> fetch_operations;
+    std::vector<UUIDIterator*> fetch_uuid_iterators;
+    std::vector<int> fetched_sizes;
+    size_t served = 0;
+    while (served < operations.size()) {
+      // Objects which are not cached are fetched like uncached reads, i.e.
+      // in parallel and from the selected replicas, a batch at a time.
+      size_t end = served;
+      fetch_operations.clear();
+      fetch_uuid_iterators.clear();
+      for (; end < operations.size() &&
+             fetch_operations.size() < batch_size; end++) {
+        const size_t object_no = operations[end].obj_number;
+        if (object_cache->Contains(object_no) ||
+            (!fetch_operations.empty() &&
+             fetch_operations.back().obj_number == object_no)) {
+          continue;
+        }
+        if (fetched_data.get() == NULL) {
+          fetched_data.reset(new char[batch_size * object_size]);
+        }
+        fetch_operations.push_back(ReadOperation(
+            object_no,
+            operations[end].osd_offsets,
+            object_size,
+            0,
+            &fetched_data[fetch_operations.size() * object_size]));
+        fetch_uuid_iterators.push_back(uuid_iterators[end]);
+      }
+      ReadFromOSDs(fetch_uuid_iterators,
+                   replica_selector,
+                   &replica_uuid_iterator,
+                   replica_uuids,
+                   file_credentials,
+                   fetch_operations,
+                   &fetched_sizes);
+      for (size_t k = 0; k < fetch_operations.size(); k++) {
+        object_cache->Insert(fetch_operations[k].obj_number,
+                             fetch_operations[k].data,
+                             fetched_sizes[k],
+                             writer);
+      }
+
+      // Objects evicted meanwhile are read again by the cache.
+      for (; served < end; served++) {
+        received_data += object_cache->Read(operations[served].obj_number,
+                                            operations[served].req_offset,
+                                            operations[served].data,
+                                            operations[served].req_size,
+                                            reader,
+                                            writer);
+      }
+    }
+    return received_data;
+  }
+
+  // Take objects which were read ahead and read ahead the following ones.
+  ReadAheadHandler* read_ahead_handler = file_info_->read_ahead_handler();
+  if (read_ahead_handler != NULL && !operations.empty()) {
+    read_ahead_handler->NotifyRead(
+        operations.front().obj_number,
+        operations.back().obj_number,
+        boost::bind(&FileHandleImplementation::SendReadAheadRequest,
+                    this,
+                    boost::cref(file_credentials),
+                    osd_uuid_container,
+                    _1));
+
+    std::vector<ReadOperation> remaining_operations;
+    std::vector<UUIDIterator*> remaining_uuid_iterators;
+    for (size_t j = 0; j < operations.size(); j++) {
+      const int read_ahead_data = read_ahead_handler->Read(
+          operations[j].obj_number,
+          operations[j].req_offset,
+          operations[j].data,
+          operations[j].req_size);
+      if (read_ahead_data >= 0) {
+        received_data += read_ahead_data;
+      } else {
+        remaining_operations.push_back(operations[j]);
+        remaining_uuid_iterators.push_back(uuid_iterators[j]);
+      }
+    }
+    operations.swap(remaining_operations);
+    uuid_iterators.swap(remaining_uuid_iterators);
+  }
+
+  // Read all objects.
+  std::vector<int> received_per_operation;
+  received_data += ReadFromOSDs(uuid_iterators,
+                                replica_selector,
+                                &replica_uuid_iterator,
+                                replica_uuids,
+                                file_credentials,
+                                operations,
+                                &received_per_operation);
+  return received_data;
+}
+
+int FileHandleImplementation::ReadFromOSDs(
+    const std::vector<UUIDIterator*>& uuid_iterators,
+    ReplicaSelector* replica_selector,
+    UUIDIterator* replica_uuid_iterator,
+    const std::vector<std::string>& replica_uuids,
+    const FileCredentials& file_credentials,
+    const std::vector<ReadOperation>& operations,
+    std::vector<int>* received_per_operation) {
+  received_per_operation->assign(operations.size(), 0);
+  if (operations.size() > 1 && volume_options_.max_parallel_reads > 1) {
+    return ReadFromOSDsInParallel(uuid_iterators,
+                                  file_credentials,
+                                  operations,
+                                  received_per_operation);
+  }
+
+  int received_data = 0;
+  for (size_t j = 0; j < operations.size(); j++) {
+    if (replica_selector != NULL) {
+      (*received_per_operation)[j] = ReadFromReplicas(replica_selector,
+                                                      replica_uuid_iterator,
+                                                      replica_uuids,
+                                                      file_credentials,
+                                                      operations[j]);
     } else {
-      // TODO(mberlin): Enhance UUIDIterator to read from different replicas.
-      uuid_iterator = osd_uuid_iterator_;
+      (*received_per_operation)[j] =
+          ReadFromOSD(uuid_iterators[j], file_credentials,
+          operations[j].obj_number, operations[j].data,
+          operations[j].req_offset, operations[j].req_size);
+    }
+    received_data += (*received_per_operation)[j];
+  }
+  return received_data;
+}
+
+int FileHandleImplementation::ReadFromReplicas(
+    ReplicaSelector* replica_selector,
+    UUIDIterator* uuid_iterator,
+    const std::vector<std::string>& osd_uuids,
+    const FileCredentials& file_credentials,
+    const ReadOperation& operation) {
+  const boost::posix_time::ptime start = util::MonotonicTime();
+
+  boost::posix_time::time_duration hedge_delay;
+  if (osd_uuids.size() > 1 && replica_selector->GetHedgeDelay(&hedge_delay)) {
+    string winner_uuid;
+    const int received_data = HedgedReadFromOSDs(osd_uuids,
+                                                 file_credentials,
+                                                 operation,
+                                                 start + hedge_delay,
+                                                 &winner_uuid);
+    const boost::posix_time::time_duration latency =
+        util::MonotonicTime() - start;
+    if (received_data >= 0) {
+      replica_selector->RecordLatency(winner_uuid, latency);
+      if (winner_uuid != osd_uuids[0]) {
+        // The first replica took at least as long.
+        replica_selector->RecordLatency(osd_uuids[0], latency);
+      }
+      return received_data;
+    }
+    replica_selector->RecordFailure(osd_uuids[0]);
+  }
+
+  // Let ReadFromOSD() handle the retries, redirects and XCap renewals.
+  string first_uuid, last_uuid;
+  uuid_iterator->GetUUID(&first_uuid);
+  const int received_data = ReadFromOSD(uuid_iterator, file_credentials,
+                                        operation.obj_number, operation.data,
+                                        operation.req_offset,
+                                        operation.req_size);
+  uuid_iterator->GetUUID(&last_uuid);
+  if (last_uuid != first_uuid) {
+    replica_selector->RecordFailure(first_uuid);
+  }
+  replica_selector->RecordLatency(
+      last_uuid,
+      util::MonotonicTime() - start);
+  return received_data;
+}
+
+int FileHandleImplementation::HedgedReadFromOSDs(
+    const std::vector<std::string>& osd_uuids,
+    const FileCredentials& file_credentials,
+    const ReadOperation& operation,
+    const boost::posix_time::ptime& hedge_deadline,
+    std::string* winner_uuid) {
+  const RPCOptions options(volume_options_.max_read_tries,
+                           volume_options_.retry_delay_s,
+                           false,
+                           volume_options_.was_interrupted_function);
+  string osd_address;
+  try {
+    uuid_resolver_->UUIDToAddressWithOptions(osd_uuids[0],
+                                             &osd_address,
+                                             options);
+  } catch (const XtreemFSException&) {
+    // ReadFromOSD() will try again and report the error.
+    return -1;
+  }
+
+  readRequest rq;
+  rq.set_file_id(file_credentials.xcap().file_id());
+  rq.mutable_file_credentials()->CopyFrom(file_credentials);
+  rq.set_object_number(operation.obj_number);
+  rq.set_object_version(0);
+  rq.set_offset(operation.req_offset);
+  rq.set_length(operation.req_size);
+
+  // Both reads receive their data into own buffers as the one which loses
+  // the race may still be in flight when this function returns.
+  HedgedRead* hedged_read = new HedgedRead();
+  hedged_read->Send(network_client_, osd_uuids[0], osd_address, rq,
+                    auth_bogus_, user_credentials_bogus_);
+  if (!hedged_read->WaitUntil(hedge_deadline)) {
+    try {
+      uuid_resolver_->UUIDToAddressWithOptions(osd_uuids[1],
+                                               &osd_address,
+                                               options);
+      if (Logging::log->loggingActive(LEVEL_DEBUG)) {
+        Logging::log->getLog(LEVEL_DEBUG)
+            << "Hedging the read of object " << operation.obj_number
+            << " from OSD " << osd_uuids[0] << " with OSD " << osd_uuids[1]
+            << endl;
+      }
+      hedged_read->Send(network_client_, osd_uuids[1], osd_address, rq,
+                        auth_bogus_, user_credentials_bogus_);
+    } catch (const XtreemFSException&) {
+      // Wait for the first read only.
     }
+  }
+  hedged_read->Wait();
 
-    received_data +=
-        ReadFromOSD(uuid_iterator, file_credentials, operations[j].obj_number,
-        operations[j].data, operations[j].req_offset,
-        operations[j].req_size);
+  const int received_data = hedged_read->CopyResponse(
+      operation.data, volume_options_.enable_object_checksums);
+  *winner_uuid = hedged_read->winner_uuid();
+  hedged_read->Release();
+  return received_data;
+}
+
+int FileHandleImplementation::ReadFromOSDsInParallel(
+    const std::vector<UUIDIterator*>& uuid_iterators,
+    const FileCredentials& file_credentials,
+    const std::vector<ReadOperation>& operations,
+    std::vector<int>* received_per_operation) {
+  const size_t max_parallel_reads =
+      static_cast<size_t>(volume_options_.max_parallel_reads);
+  // Responses of the requests in flight, indexed like "operations".
+  std::vector<rpc::SyncCallbackBase*> responses(operations.size(), NULL);
+  size_t next_to_send = 0;
+  int received_data = 0;
+
+  try {
+    for (size_t j = 0; j < operations.size(); j++) {
+      // Keep up to max_parallel_reads requests in flight.
+      while (next_to_send < operations.size() &&
+             next_to_send < j + max_parallel_reads) {
+        responses[next_to_send] = SendReadRequest(
+            uuid_iterators[next_to_send],
+            file_credentials,
+            operations[next_to_send]);
+        next_to_send++;
+      }
+
+      if (responses[j] != NULL && !responses[j]->HasFailed() &&
+          IsReadResponseValid(responses[j])) {
+        (*received_per_operation)[j] =
+            CopyReadResponse(responses[j], operations[j].data);
+        delete responses[j];
+        responses[j] = NULL;
+      } else {
+        if (responses[j] != NULL) {
+          responses[j]->DeleteBuffers();
+          delete responses[j];
+          responses[j] = NULL;
+        }
+        // Let ReadFromOSD() handle the retries, redirects and XCap renewals.
+        (*received_per_operation)[j] =
+            ReadFromOSD(uuid_iterators[j], file_credentials,
+            operations[j].obj_number, operations[j].data,
+            operations[j].req_offset, operations[j].req_size);
+      }
+      received_data += (*received_per_operation)[j];
+    }
+  } catch (...) {
+    // Wait for the requests in flight - otherwise accesses to deleted memory
+    // may occur - and free them.
+    for (size_t j = 0; j < next_to_send; j++) {
+      if (responses[j] != NULL) {
+        responses[j]->HasFailed();
+        responses[j]->DeleteBuffers();
+        delete responses[j];
+      }
+    }
+    throw;
   }
 
   return received_data;
 }
 
+rpc::SyncCallbackBase* FileHandleImplementation::SendReadRequest(
+    UUIDIterator* uuid_iterator,
+    const FileCredentials& file_credentials,
+    const ReadOperation& operation) {
+  string osd_uuid, osd_address;
+  uuid_iterator->GetUUID(&osd_uuid);
+  try {
+    uuid_resolver_->UUIDToAddressWithOptions(
+        osd_uuid,
+        &osd_address,
+        RPCOptions(volume_options_.max_read_tries,
+                   volume_options_.retry_delay_s,
+                   false,
+                   volume_options_.was_interrupted_function));
+  } catch (const XtreemFSException&) {
+    // ReadFromOSD() will try again and report the error.
+    return NULL;
+  }
+
+  readRequest rq;
+  rq.set_file_id(file_credentials.xcap().file_id());
+  rq.mutable_file_credentials()->CopyFrom(file_credentials);
+  rq.set_object_number(operation.obj_number);
+  rq.set_object_version(0);
+  rq.set_offset(operation.req_offset);
+  rq.set_length(operation.req_size);
+
+  // The request is serialized when sent, so "rq" may go out of scope.
+  return SendReadRequestToBuffer(osd_address, &rq, operation.data);
+}
+
+rpc::SyncCallbackBase* FileHandleImplementation::SendReadRequestToBuffer(
+    const std::string& osd_address,
+    const readRequest* request,
+    char* buffer) {
+  // Same as OSDServiceClient::read_sync(), except for the buffer.
+  rpc::SyncCallback<ObjectData>* sync_cb =
+      new rpc::SyncCallback<ObjectData>();
+  network_client_->sendRequest(osd_address,
+                               INTERFACE_ID_OSD,
+                               PROC_ID_READ,
+                               user_credentials_bogus_,
+                               auth_bogus_,
+                               request,
+                               NULL,
+                               0,
+                               new ObjectData(),
+                               NULL,
+                               sync_cb,
+                               0,
+                               buffer,
+                               request->length());
+  return sync_cb;
+}
+
+void FileHandleImplementation::SendReadRequestToBuffer(
+    const std::string& osd_address,
+    const readRequest* request,
+    char* buffer,
+    rpc::CallbackInterface<ObjectData>* callback,
+    void* context) {
+  network_client_->sendRequest(osd_address,
+                               INTERFACE_ID_OSD,
+                               PROC_ID_READ,
+                               user_credentials_bogus_,
+                               auth_bogus_,
+                               request,
+                               NULL,
+                               0,
+                               new ObjectData(),
+                               context,
+                               callback,
+                               0,
+                               buffer,
+                               request->length());
+}
+
+rpc::SyncCallbackBase* FileHandleImplementation::SendReadAheadRequest(
+    const FileCredentials& file_credentials,
+    boost::shared_ptr<UUIDContainer> osd_uuid_container,
+    int object_no) {
+  const XLocSet& xlocs = file_credentials.xlocs();
+  const int object_size =
+      xlocs.replicas(0).striping_policy().stripe_size() * 1024;
+  ReadOperation operation(object_no,
+                          GetOSDOffsetsOfObject(xlocs, object_no, object_size),
+                          object_size,
+                          0,
+                          NULL);
+
+  if (xlocs.replicas(0).osd_uuids_size() > 1) {
+    // Replica is striped. Get a UUID iterator from OSD offsets.
+    ContainerUUIDIterator uuid_iterator(osd_uuid_container,
+                                        operation.osd_offsets);
+    if (ReplicaSelector::HasInterchangeableReplicas(xlocs)) {
+      uuid_iterator.set_scorer(file_info_->uuid_scorer());
+    }
+    return SendReadRequest(&uuid_iterator, file_credentials, operation);
+  } else if (file_info_->replica_selector() != NULL &&
+             ReplicaSelector::IsApplicable(xlocs)) {
+    // Spread the read-ahead across the replicas, too.
+    std::vector<std::string> replica_uuids;
+    file_info_->replica_selector()->OrderReplicas(xlocs, &replica_uuids);
+    SimpleUUIDIterator uuid_iterator;
+    uuid_iterator.AddUUID(replica_uuids[0]);
+    return SendReadRequest(&uuid_iterator, file_credentials, operation);
+  } else {
+    return SendReadRequest(osd_uuid_iterator_, file_credentials, operation);
+  }
+}
+
 int FileHandleImplementation::ReadFromOSD(
     UUIDIterator* uuid_iterator,
     const FileCredentials& file_credentials,
@@ -229,29 +698,64 @@ int FileHandleImplementation::ReadFromOSD(
   rq.set_offset(offset_in_object);
   rq.set_length(bytes_to_read);
 
-  boost::scoped_ptr<rpc::SyncCallbackBase> response(
-      ExecuteSyncRequest(
-          boost::bind(&xtreemfs::pbrpc::OSDServiceClient::read_sync,
-                      osd_service_client_,
-                      _1,
-                      boost::cref(auth_bogus_),
-                      boost::cref(user_credentials_bogus_),
-                      &rq),
-          uuid_iterator,
-          uuid_resolver_,
-          RPCOptions(volume_options_.max_read_tries,
-                     volume_options_.retry_delay_s,
-                     false,
-                     volume_options_.was_interrupted_function),
-          false,
-          &xcap_manager_,
-          rq.mutable_file_credentials()->mutable_xcap()));
+  // Corrupted data is read again from the next replica, each replica once.
+  const int max_attempts = max(1, file_credentials.xlocs().replicas_size());
+  for (int attempt = 1; ; ++attempt) {
+    boost::scoped_ptr<rpc::SyncCallbackBase> response(
+        ExecuteSyncRequest(
+            boost::bind(&FileHandleImplementation::SendReadRequestToBuffer,
+                        this,
+                        _1,
+                        &rq,
+                        buffer),
+            uuid_iterator,
+            uuid_resolver_,
+            RPCOptions(volume_options_.max_read_tries,
+                       volume_options_.retry_delay_s,
+                       false,
+                       volume_options_.was_interrupted_function),
+            false,
+            &xcap_manager_,
+            rq.mutable_file_credentials()->mutable_xcap()));
+    if (IsReadResponseValid(response.get())) {
+      return CopyReadResponse(response.get(), buffer);
+    }
+    response->DeleteBuffers();
+
+    string osd_uuid;
+    uuid_iterator->GetUUID(&osd_uuid);
+    string error = "The data of object " + boost::lexical_cast<string>(
+        object_no) + " of file " + rq.file_id() + " read from OSD " +
+        osd_uuid + " is corrupted.";
+    if (attempt >= max_attempts) {
+      Logging::log->getLog(LEVEL_ERROR) << error << endl;
+      ErrorLog::error_log->AppendError(error);
+      throw IOException(error);
+    }
+    Logging::log->getLog(LEVEL_WARN) << error << " Reading it from the next"
+        " replica." << endl;
+    uuid_iterator->MarkUUIDAsFailed(osd_uuid);
+  }
+}
 
+bool FileHandleImplementation::IsReadResponseValid(
+    rpc::SyncCallbackBase* response) {
+  return VerifyObjectData(
+      *static_cast<xtreemfs::pbrpc::ObjectData*>(response->response()),
+      response->data(),
+      response->data_length());
+}
+
+int FileHandleImplementation::CopyReadResponse(
+    rpc::SyncCallbackBase* response,
+    char* buffer) {
   xtreemfs::pbrpc::ObjectData* data =
       static_cast<xtreemfs::pbrpc::ObjectData*>(response->response());
   // Insert data into read-buffer
   int data_length = response->data_length();
-  memcpy(buffer, response->data(), data_length);
+  if (response->data() != buffer) {
+    memcpy(buffer, response->data(), data_length);
+  }
   // If zero_padding() > 0, the gap has to be filled with zeroes.
   memset(buffer + data_length, 0, data->zero_padding());
 
@@ -262,16 +766,44 @@ int FileHandleImplementation::ReadFromOSD(
 
 int FileHandleImplementation::Write(const char *buf, size_t count,
                                     int64_t offset) {
+  struct iovec iov;
+  iov.iov_base = const_cast<char*>(buf);
+  iov.iov_len = count;
+  return WriteV(&iov, 1, offset);
+}
+
+int FileHandleImplementation::WriteV(const struct iovec* iov,
+                                     int iovcnt,
+                                     int64_t offset) {
   boost::function<int()> operation(
       boost::bind(&FileHandleImplementation::DoWrite, this,
-                  buf, count, offset));
+                  iov, iovcnt, offset,
+                  boost::shared_ptr<BorrowedWriteData>()));
   return ExecuteViewCheckedOperation(operation);
 }
 
-int FileHandleImplementation::DoWrite(
+int FileHandleImplementation::WriteZeroCopy(
     const char *buf,
     size_t count,
-    int64_t offset) {
+    int64_t offset,
+    const BufferReleasedCallback& buffer_released) {
+  // Every AsyncWriteBuffer which references "buf" holds a reference, too.
+  boost::shared_ptr<BorrowedWriteData> borrowed_data(
+      new BorrowedWriteData(buffer_released));
+  struct iovec iov;
+  iov.iov_base = const_cast<char*>(buf);
+  iov.iov_len = count;
+  boost::function<int()> operation(
+      boost::bind(&FileHandleImplementation::DoWrite, this,
+                  &iov, 1, offset, borrowed_data));
+  return ExecuteViewCheckedOperation(operation);
+}
+
+int FileHandleImplementation::DoWrite(
+    const struct iovec* iov,
+    int iovcnt,
+    int64_t offset,
+    const boost::shared_ptr<BorrowedWriteData>& borrowed_data) {
   if (async_writes_enabled_) {
     ThrowIfAsyncWritesFailed();
   }
@@ -306,12 +838,37 @@ int FileHandleImplementation::DoWrite(
 
   // Map offset to corresponding OSDs.
   std::vector<WriteOperation> operations;
-  translator->TranslateWriteRequest(buf, count, offset, striping_policies,
-                                   &operations);
-
-  if (async_writes_enabled_) {
+  translator->TranslateWriteRequestV(iov, iovcnt, offset, striping_policies,
+                                     &operations);
+
+  ObjectCache* object_cache = file_info_->object_cache();
+  if ((*striping_policies.begin())->type() == STRIPING_POLICY_ERASURECODE) {
+    // The parity has to be updated together with the data.
+    WriteErasureCoded(file_credentials, operations);
+  } else if (object_cache != NULL) {
+    // Write into the object cache, dirty objects are written back by Flush().
+    ObjectReaderFunction reader(boost::bind(
+        &FileHandleImplementation::ReadObjectFromOSD, this, _1, _2));
+    ObjectWriterFunction writer(boost::bind(
+        &FileHandleImplementation::WriteObjectToOSD, this, _1, _2, _3));
+    for (size_t j = 0; j < operations.size(); j++) {
+      object_cache->Write(operations[j].obj_number,
+                          operations[j].req_offset,
+                          operations[j].data,
+                          operations[j].req_size,
+                          reader,
+                          writer);
+    }
+  } else if (async_writes_enabled_) {
     string osd_uuid = "";
     writeRequest* write_request = NULL;
+    // Borrowed data is not copied, so it cannot be combined with other writes.
+    // Send the pending combined write first to keep the order of writes.
+    AsyncWriteCombiner* combiner = file_info_->async_write_combiner();
+    if (combiner != NULL && borrowed_data.get() != NULL) {
+      combiner->Flush();
+      combiner = NULL;
+    }
     // Write all objects.
     for (size_t j = 0; j < operations.size(); j++) {
       write_request = new writeRequest();
@@ -323,31 +880,50 @@ int FileHandleImplementation::DoWrite(
       write_request->set_offset(operations[j].req_offset);
       write_request->set_lease_timeout(0);
 
+      // The checksum is set by the AsyncWriteBuffer once the data is final.
       ObjectData* data = write_request->mutable_object_data();
       data->set_checksum(0);
       data->set_invalid_checksum_on_osd(false);
       data->set_zero_padding(0);
 
-      // Create new WriteBuffer and differ between striping and the rest (
-      // (replication = use UUIDIterator, no replication = set specific UUID).
-      AsyncWriteBuffer* write_buffer;
+      // Differ between striping and the rest (replication = use UUIDIterator,
+      // no replication = set specific UUID).
       if (xlocs.replicas(0).osd_uuids_size() > 1) {
         // Replica is striped. Pick UUID from xlocset.
+        osd_uuid = GetOSDUUIDFromXlocSet(xlocs,
+                                         0,  // Use first and only replica.
+                                         operations[j].osd_offsets[0]);
+      }
+
+      if (combiner != NULL) {
+        // The combiner copies the data and sends it with the next writes.
+        combiner->Write(write_request,
+                        operations[j].data,
+                        operations[j].req_size,
+                        this,
+                        &xcap_manager_,
+                        osd_uuid);
+        continue;
+      }
+
+      // Create new WriteBuffer.
+      AsyncWriteBuffer* write_buffer;
+      if (!osd_uuid.empty()) {
         write_buffer = new AsyncWriteBuffer(
             write_request,
             operations[j].data,
             operations[j].req_size,
             this,
             &xcap_manager_,
-            GetOSDUUIDFromXlocSet(xlocs,
-                                  0,  // Use first and only replica.
-                                  operations[j].osd_offsets[0]));
+            osd_uuid,
+            borrowed_data);
       } else {
         write_buffer = new AsyncWriteBuffer(write_request,
                                             operations[j].data,
                                             operations[j].req_size,
                                             this,
-                                            &xcap_manager_);
+                                            &xcap_manager_,
+                                            borrowed_data);
       }
 
       file_info_->AsyncWrite(write_buffer);
@@ -375,12 +951,37 @@ int FileHandleImplementation::DoWrite(
         uuid_iterator = osd_uuid_iterator_;
       }
 
+      // The parts of an object which lie in different buffers of a scatter
+      // list are gathered and written with one request.
+      const char* data = operations[j].data;
+      size_t size = operations[j].req_size;
+      std::vector<char> gathered_data;
+      size_t last = j;
+      while (last + 1 < operations.size() &&
+             operations[last + 1].obj_number == operations[j].obj_number) {
+        last++;
+      }
+      if (last > j) {
+        for (size_t k = j; k <= last; k++) {
+          gathered_data.insert(gathered_data.end(),
+                               operations[k].data,
+                               operations[k].data + operations[k].req_size);
+        }
+        data = &gathered_data[0];
+        size = gathered_data.size();
+      }
+
       WriteToOSD(uuid_iterator, file_credentials,
                   operations[j].obj_number, operations[j].req_offset,
-                  operations[j].data, operations[j].req_size);
+                  data, size);
+      j = last;
     }
   }
 
+  size_t count = 0;
+  for (int i = 0; i < iovcnt; i++) {
+    count += iov[i].iov_len;
+  }
   return count;
 }
 
@@ -389,6 +990,20 @@ void FileHandleImplementation::WriteToOSD(
     const FileCredentials& file_credentials,
     int object_no, int offset_in_object, const char* buffer,
     int bytes_to_write) {
+  RegisterWriteResponse(ExecuteWriteRequest(uuid_iterator,
+                                            file_credentials,
+                                            object_no,
+                                            offset_in_object,
+                                            buffer,
+                                            bytes_to_write));
+}
+
+xtreemfs::pbrpc::OSDWriteResponse*
+FileHandleImplementation::ExecuteWriteRequest(
+    UUIDIterator* uuid_iterator,
+    const FileCredentials& file_credentials,
+    int object_no, int offset_in_object, const char* buffer,
+    int bytes_to_write) {
   writeRequest write_request;
   write_request.mutable_file_credentials()->CopyFrom(file_credentials);
   write_request.set_file_id(file_credentials.xcap().file_id());
@@ -398,7 +1013,7 @@ void FileHandleImplementation::WriteToOSD(
   write_request.set_lease_timeout(0);
 
   ObjectData *data = write_request.mutable_object_data();
-  data->set_checksum(0);
+  SetObjectChecksum(buffer, bytes_to_write, data);
   data->set_invalid_checksum_on_osd(false);
   data->set_zero_padding(0);
 
@@ -423,8 +1038,20 @@ void FileHandleImplementation::WriteToOSD(
           &xcap_manager_,
           write_request.mutable_file_credentials()->mutable_xcap()));
 
-  xtreemfs::pbrpc::OSDWriteResponse* write_response =
-      static_cast<xtreemfs::pbrpc::OSDWriteResponse*>(response->response());
+  // Do not delete the response because ownership is transferred.
+  delete [] response->data();
+  delete response->error();
+  return static_cast<xtreemfs::pbrpc::OSDWriteResponse*>(response->response());
+}
+
+void FileHandleImplementation::RegisterWriteResponse(
+    xtreemfs::pbrpc::OSDWriteResponse* write_response) {
+  // Prefetches sent while the write was in flight may return the old data.
+  ReadAheadHandler* read_ahead_handler = file_info_->read_ahead_handler();
+  if (read_ahead_handler != NULL) {
+    read_ahead_handler->Clear();
+  }
+
   // If the filesize has changed, remember OSDWriteResponse for later file
   // size update towards the MRC (executed by
   // VolumeImplementation::PeriodicFileSizeUpdate).
@@ -433,14 +1060,680 @@ void FileHandleImplementation::WriteToOSD(
     xcap_manager_.GetXCap(&xcap);
     if (file_info_->TryToUpdateOSDWriteResponse(write_response, xcap)) {
       // Do not delete "write_response" because ownership was transferred.
-      delete [] response->data();
-      delete response->error();
+      return;
+    }
+  }
+  delete write_response;
+}
+
+int FileHandleImplementation::ReadErasureCoded(
+    const FileCredentials& file_credentials,
+    const std::vector<ReadOperation>& operations) {
+  const StripingPolicy& policy =
+      file_credentials.xlocs().replicas(0).striping_policy();
+  const int object_size = policy.stripe_size() * 1024;
+
+  // An OSD which failed once is not asked again during this request, so
+  // only the first of its objects costs the timeout.
+  std::vector<bool> failed_osds(policy.width() + policy.parity_width(),
+                                false);
+  int received_data = 0;
+  for (size_t j = 0; j < operations.size(); j++) {
+    const ReadOperation& operation = operations[j];
+    const int data_index = static_cast<int>(operation.osd_offsets[0]);
+    int received = ReadFragment(file_credentials,
+                                data_index,
+                                operation.obj_number,
+                                operation.req_offset,
+                                operation.req_size,
+                                operation.data,
+                                &failed_osds);
+    if (received < 0) {
+      // Degraded read: reconstruct the object from the rest of its stripe.
+      util::ReedSolomon code(policy.width(), policy.parity_width());
+      std::vector<char> stripe(
+          static_cast<size_t>(policy.width() + policy.parity_width()) *
+          object_size);
+      std::vector<bool> needed(policy.width(), false);
+      needed[data_index] = true;
+      std::vector<int> lengths;
+      // Do not reconstruct from a stripe which is being updated.
+      FileInfo::StripeUpdateLock lock(file_info_);
+      ReadStripe(file_credentials,
+                 code,
+                 StripeTranslatorErasureCode::GetStripeNumber(
+                     policy, operation.obj_number),
+                 needed,
+                 &stripe[0],
+                 &lengths,
+                 &failed_osds);
+      received = max(0, min(static_cast<int>(operation.req_size),
+                            lengths[data_index] -
+                                static_cast<int>(operation.req_offset)));
+      memcpy(operation.data,
+             &stripe[data_index * object_size + operation.req_offset],
+             received);
+    }
+    received_data += received;
+  }
+  return received_data;
+}
+
+void FileHandleImplementation::WriteErasureCoded(
+    const FileCredentials& file_credentials,
+    const std::vector<WriteOperation>& operations) {
+  const StripingPolicy& policy =
+      file_credentials.xlocs().replicas(0).striping_policy();
+  util::ReedSolomon code(policy.width(), policy.parity_width());
+  std::vector<bool> failed_osds(policy.width() + policy.parity_width(),
+                                false);
+
+  // The operations are sorted by object number, so the ones of a stripe are
+  // consecutive.
+  std::vector<WriteOperation>::const_iterator first = operations.begin();
+  while (first != operations.end()) {
+    const size_t stripe_number =
+        StripeTranslatorErasureCode::GetStripeNumber(policy, first->obj_number);
+    std::vector<WriteOperation>::const_iterator last = first;
+    while (last != operations.end() &&
+           StripeTranslatorErasureCode::GetStripeNumber(
+               policy, last->obj_number) == stripe_number) {
+      ++last;
+    }
+    {
+      // Concurrent updates of the stripe would base the parity on outdated
+      // data.
+      FileInfo::StripeUpdateLock lock(file_info_);
+      WriteStripe(file_credentials, code, stripe_number, first, last,
+                  &failed_osds);
+    }
+    first = last;
+  }
+}
+
+void FileHandleImplementation::WriteStripe(
+    const FileCredentials& file_credentials,
+    const util::ReedSolomon& code,
+    size_t stripe_number,
+    std::vector<WriteOperation>::const_iterator first,
+    std::vector<WriteOperation>::const_iterator last,
+    std::vector<bool>* failed_osds) {
+  const XLocSet& xlocs = file_credentials.xlocs();
+  const StripingPolicy& policy = xlocs.replicas(0).striping_policy();
+  const int object_size = policy.stripe_size() * 1024;
+  const int width = code.data_fragments();
+  const int parity_width = code.parity_fragments();
+  const size_t first_object =
+      StripeTranslatorErasureCode::GetFirstObjectOfStripe(policy,
+                                                          stripe_number);
+
+  // Written range [begin, end) of every data object.
+  std::vector<int> begin(width, object_size);
+  std::vector<int> end(width, 0);
+  for (std::vector<WriteOperation>::const_iterator i = first; i != last; ++i) {
+    const int index = static_cast<int>(i->obj_number - first_object);
+    begin[index] = min(begin[index], static_cast<int>(i->req_offset));
+    end[index] = max(end[index],
+                     static_cast<int>(i->req_offset + i->req_size));
+  }
+  // The parity changes in the range [parity_begin, parity_end) only.
+  int parity_begin = object_size;
+  int parity_end = 0;
+  bool complete = true;
+  for (int i = 0; i < width; ++i) {
+    parity_begin = min(parity_begin, begin[i]);
+    parity_end = max(parity_end, end[i]);
+    complete = complete && begin[i] == 0 && end[i] == object_size;
+  }
+
+  std::vector<char> stripe(
+      static_cast<size_t>(width + parity_width) * object_size);
+  std::vector<char*> parity(parity_width);
+  for (int i = 0; i < parity_width; ++i) {
+    parity[i] = &stripe[(width + i) * object_size];
+  }
+
+  // Unless the whole stripe is overwritten, the parity is updated with the
+  // difference between the old and the new data. This needs the old content
+  // of the written ranges and the old parity, but not the other objects.
+  bool updated = complete;
+  if (!complete && first != last) {
+    updated = true;
+    for (int i = 0; i < width && updated; ++i) {
+      if (end[i] > begin[i]) {
+        updated = ReadFragment(file_credentials, i, first_object + i,
+                               begin[i], end[i] - begin[i],
+                               &stripe[i * object_size + begin[i]],
+                               failed_osds) >= 0;
+      }
+    }
+    for (int i = 0; i < parity_width && updated; ++i) {
+      updated = ReadFragment(file_credentials,
+                             StripeTranslatorErasureCode::GetParityOSDOffset(
+                                 policy, i),
+                             first_object, parity_begin,
+                             parity_end - parity_begin,
+                             parity[i] + parity_begin,
+                             failed_osds) >= 0;
+    }
+    if (updated) {
+      std::vector<char> delta(object_size);
+      std::vector<char*> parity_range(parity_width);
+      for (std::vector<WriteOperation>::const_iterator i = first;
+           i != last;
+           ++i) {
+        const int index = static_cast<int>(i->obj_number - first_object);
+        char* object_range = &stripe[index * object_size + i->req_offset];
+        for (size_t j = 0; j < i->req_size; ++j) {
+          delta[j] = object_range[j] ^ i->data[j];
+        }
+        memcpy(object_range, i->data, i->req_size);
+        for (int j = 0; j < parity_width; ++j) {
+          parity_range[j] = parity[j] + i->req_offset;
+        }
+        code.Update(index, &delta[0], &parity_range[0], i->req_size);
+      }
+    }
+  }
+
+  if (!updated) {
+    // Without the old parity, e.g. if only the parity has to be recomputed,
+    // it is encoded from all data objects. The ones which are not completely
+    // overwritten are read first.
+    std::vector<bool> needed(width);
+    for (int i = 0; i < width; ++i) {
+      needed[i] = begin[i] > 0 || end[i] < object_size;
+    }
+    std::vector<int> lengths;
+    ReadStripe(file_credentials, code, stripe_number, needed, &stripe[0],
+               &lengths, failed_osds);
+    // The parity is as long as the longest data object.
+    parity_begin = 0;
+    parity_end = 0;
+    for (int i = 0; i < width; ++i) {
+      parity_end = max(parity_end, max(lengths[i], end[i]));
+    }
+  }
+  if (!updated || complete) {
+    for (std::vector<WriteOperation>::const_iterator i = first;
+         i != last;
+         ++i) {
+      const int index = static_cast<int>(i->obj_number - first_object);
+      memcpy(&stripe[index * object_size + i->req_offset],
+             i->data,
+             i->req_size);
+    }
+    std::vector<const char*> data(width);
+    for (int i = 0; i < width; ++i) {
+      data[i] = &stripe[i * object_size];
+    }
+    code.Encode(&data[0], &parity[0], parity_end);
+  }
+
+  // Write the data before the parity. A failure in between leaves a stripe
+  // with outdated parity behind, which is only noticed by a degraded read.
+  for (int i = 0; i < width; ++i) {
+    if (end[i] <= begin[i]) {
+      continue;
+    }
+    SimpleUUIDIterator uuid_iterator;
+    uuid_iterator.AddUUID(GetOSDUUIDFromXlocSet(xlocs, 0, i));
+    WriteToOSD(&uuid_iterator,
+               file_credentials,
+               first_object + i,
+               begin[i],
+               &stripe[i * object_size + begin[i]],
+               end[i] - begin[i]);
+  }
+  // The parity objects do not change the size of the file.
+  for (int i = 0; i < parity_width && parity_end > parity_begin; ++i) {
+    SimpleUUIDIterator uuid_iterator;
+    uuid_iterator.AddUUID(GetOSDUUIDFromXlocSet(
+        xlocs,
+        0,
+        StripeTranslatorErasureCode::GetParityOSDOffset(policy, i)));
+    delete ExecuteWriteRequest(&uuid_iterator,
+                               file_credentials,
+                               first_object,
+                               parity_begin,
+                               parity[i] + parity_begin,
+                               parity_end - parity_begin);
+  }
+}
+
+void FileHandleImplementation::ReadStripe(
+    const FileCredentials& file_credentials,
+    const util::ReedSolomon& code,
+    size_t stripe_number,
+    const std::vector<bool>& needed,
+    char* stripe,
+    std::vector<int>* lengths,
+    std::vector<bool>* failed_osds) {
+  const StripingPolicy& policy =
+      file_credentials.xlocs().replicas(0).striping_policy();
+  const int object_size = policy.stripe_size() * 1024;
+  const int width = code.data_fragments();
+  const int total = width + code.parity_fragments();
+  const size_t first_object =
+      StripeTranslatorErasureCode::GetFirstObjectOfStripe(policy,
+                                                          stripe_number);
+
+  memset(stripe, 0, static_cast<size_t>(total) * object_size);
+  lengths->assign(width, -1);
+  std::vector<bool> available(total, false);
+  bool reconstruct = false;
+  for (int i = 0; i < width; ++i) {
+    if (!needed[i]) {
+      continue;
+    }
+    (*lengths)[i] = ReadFragment(file_credentials, i, first_object + i, 0,
+                                 object_size, stripe + i * object_size,
+                                 failed_osds);
+    available[i] = (*lengths)[i] >= 0;
+    reconstruct = reconstruct || !available[i];
+  }
+  if (!reconstruct) {
+    return;
+  }
+
+  // Any "width" objects of the stripe suffice. Read the remaining data
+  // objects first, then the parity objects.
+  int available_objects = 0;
+  for (int i = 0; i < width; ++i) {
+    available_objects += available[i] ? 1 : 0;
+  }
+  for (int i = 0; i < total && available_objects < width; ++i) {
+    if (available[i] || (i < width && needed[i])) {
+      continue;
+    }
+    const int length = i < width
+        ? ReadFragment(file_credentials, i, first_object + i, 0, object_size,
+                       stripe + i * object_size, failed_osds)
+        : ReadFragment(file_credentials,
+                       StripeTranslatorErasureCode::GetParityOSDOffset(
+                           policy, i - width),
+                       first_object, 0, object_size, stripe + i * object_size,
+                       failed_osds);
+    if (i < width) {
+      (*lengths)[i] = length;
+    }
+    if (length >= 0) {
+      available[i] = true;
+      available_objects++;
+    }
+  }
+
+  std::vector<char*> fragments(total);
+  for (int i = 0; i < total; ++i) {
+    fragments[i] = stripe + i * object_size;
+  }
+  if (!code.Reconstruct(&fragments[0], available, object_size)) {
+    string error = "Only " + boost::lexical_cast<string>(available_objects) +
+        " of the " + boost::lexical_cast<string>(total) + " objects of stripe " +
+        boost::lexical_cast<string>(stripe_number) + " of file " +
+        file_credentials.xcap().file_id() + " are available, " +
+        boost::lexical_cast<string>(width) + " are required.";
+    Logging::log->getLog(LEVEL_ERROR) << error << endl;
+    ErrorLog::error_log->AppendError(error);
+    throw IOException(error);
+  }
+
+  // The length of a reconstructed object follows from the other objects of
+  // the stripe: objects before one with data are complete, objects behind a
+  // short one are empty.
+  for (int i = 0; i < width; ++i) {
+    if (!needed[i] || available[i]) {
+      continue;
+    }
+    int length = -1;
+    for (int j = i + 1; j < width && length < 0; ++j) {
+      if ((*lengths)[j] > 0) {
+        length = object_size;
+      }
+    }
+    for (int j = 0; j < i && length < 0; ++j) {
+      if ((*lengths)[j] >= 0 && (*lengths)[j] < object_size) {
+        length = 0;
+      }
+    }
+    if (length < 0) {
+      // The object may be the last one of the file, so its length follows
+      // from the file size. It is not requested from the MRC, as the
+      // reconstruction shall only depend on the OSDs.
+      uint64_t file_size = 0;
+      if (file_info_->GetKnownFileSize(&file_size)) {
+        const int64_t object_end = static_cast<int64_t>(file_size) -
+            static_cast<int64_t>(first_object + i) * object_size;
+        length = static_cast<int>(
+            max<int64_t>(0, min<int64_t>(object_size, object_end)));
+      } else {
+        Logging::log->getLog(LEVEL_WARN) << "The size of file "
+            << file_credentials.xcap().file_id() << " is unknown, the"
+            " reconstructed object " << first_object + i << " is assumed"
+            " to be complete." << endl;
+        length = object_size;
+      }
+    }
+    (*lengths)[i] = length;
+  }
+}
+
+int FileHandleImplementation::ReadFragment(
+    const FileCredentials& file_credentials,
+    size_t osd_offset,
+    size_t object_no,
+    int offset,
+    int length,
+    char* buffer,
+    std::vector<bool>* failed_osds) {
+  if ((*failed_osds)[osd_offset]) {
+    return -1;
+  }
+  SimpleUUIDIterator uuid_iterator;
+  uuid_iterator.AddUUID(
+      GetOSDUUIDFromXlocSet(file_credentials.xlocs(), 0, osd_offset));
+  try {
+    return ReadFromOSD(&uuid_iterator, file_credentials, object_no, buffer,
+                       offset, length);
+  } catch (const IOException& e) {
+    Logging::log->getLog(LEVEL_WARN) << "Failed to read object " << object_no
+        << " of file " << file_credentials.xcap().file_id() << ": "
+        << e.what() << endl;
+  } catch (const InternalServerErrorException& e) {
+    Logging::log->getLog(LEVEL_WARN) << "Failed to read object " << object_no
+        << " of file " << file_credentials.xcap().file_id() << ": "
+        << e.what() << endl;
+  }
+  (*failed_osds)[osd_offset] = true;
+  return -1;
+}
+
+void FileHandleImplementation::SetObjectChecksum(const char* data,
+                                                 size_t length,
+                                                 ObjectData* object_data) {
+  object_data->set_checksum(volume_options_.enable_object_checksums ?
+                            CRC32C(0, data, length) : 0);
+}
+
+bool FileHandleImplementation::VerifyObjectData(const ObjectData& object_data,
+                                                const char* data,
+                                                size_t length) {
+  return IsObjectDataValid(object_data,
+                           data,
+                           length,
+                           volume_options_.enable_object_checksums);
+}
+
+void FileHandleImplementation::ReadAsync(
+    char *buf,
+    size_t count,
+    int64_t offset,
+    const IOCompletedCallback& completed) {
+  AsyncIOOperation* operation = new AsyncIOOperation(
+      this, false, buf, count, offset, completed,
+      &client_->GetAsyncIOTaskQueue());
+  try {
+    if (!SendReadRequestsAsync(operation, buf, count, offset)) {
+      operation->ExecuteSynchronously();
+      return;
+    }
+  } catch (const XtreemFSException& e) {
+    operation->SendingFailed(e);
+    return;
+  }
+  operation->SendingFinished();
+}
+
+void FileHandleImplementation::WriteAsync(
+    const char *buf,
+    size_t count,
+    int64_t offset,
+    const IOCompletedCallback& completed) {
+  // The buffer is only read by write operations.
+  AsyncIOOperation* operation = new AsyncIOOperation(
+      this, true, const_cast<char*>(buf), count, offset, completed,
+      &client_->GetAsyncIOTaskQueue());
+  try {
+    if (!SendWriteRequestsAsync(operation, buf, count, offset)) {
+      operation->ExecuteSynchronously();
+      return;
+    }
+  } catch (const XtreemFSException& e) {
+    operation->SendingFailed(e);
+    return;
+  }
+  operation->SendingFinished();
+}
+
+bool FileHandleImplementation::SendReadRequestsAsync(
+    AsyncIOOperation* operation,
+    char* buf,
+    size_t count,
+    int64_t offset) {
+  // Pending asynchronous writes have to be waited for and cached objects
+  // must not be bypassed, so these reads are executed by DoRead().
+  if (async_writes_enabled_ || file_info_->object_cache() != NULL) {
+    return false;
+  }
+
+  FileCredentials file_credentials;
+  xcap_manager_.GetXCap(file_credentials.mutable_xcap());
+  boost::shared_ptr<UUIDContainer> osd_uuid_container =
+      file_info_->GetXLocSetAndUUIDContainer(file_credentials.mutable_xlocs());
+  const XLocSet& xlocs = file_credentials.xlocs();
+  // Reads of read-only replicas are balanced and hedged by DoRead(), which
+  // also reconstructs erasure coded objects.
+  if (xlocs.replicas_size() == 0 ||
+      xlocs.replicas(0).striping_policy().type() ==
+          STRIPING_POLICY_ERASURECODE ||
+      (file_info_->replica_selector() != NULL &&
+       ReplicaSelector::IsApplicable(xlocs))) {
+    return false;
+  }
+
+  StripeTranslator::PolicyContainer striping_policies;
+  for (int32_t i = 0; i < xlocs.replicas_size(); ++i) {
+    striping_policies.push_back(&(xlocs.replicas(i).striping_policy()));
+  }
+  const StripeTranslator* translator =
+      GetStripeTranslator((*striping_policies.begin())->type());
+  std::vector<ReadOperation> operations;
+  translator->TranslateReadRequest(buf, count, offset, striping_policies,
+                                   &operations);
+
+  UUIDScorer* striped_uuid_scorer =
+      ReplicaSelector::HasInterchangeableReplicas(xlocs)
+          ? file_info_->uuid_scorer() : NULL;
+  for (size_t j = 0; j < operations.size(); j++) {
+    string osd_uuid, osd_address;
+    if (xlocs.replicas(0).osd_uuids_size() > 1) {
+      // Replica is striped. Get a UUID iterator from OSD offsets.
+      ContainerUUIDIterator uuid_iterator(osd_uuid_container,
+                                          operations[j].osd_offsets);
+      uuid_iterator.set_scorer(striped_uuid_scorer);
+      uuid_iterator.GetUUID(&osd_uuid);
     } else {
-      response->DeleteBuffers();
+      osd_uuid_iterator_->GetUUID(&osd_uuid);
+    }
+
+    void* context = operation->AddObject(operations[j].data,
+                                         operations[j].req_size);
+    try {
+      uuid_resolver_->UUIDToAddressWithOptions(
+          osd_uuid,
+          &osd_address,
+          RPCOptions(volume_options_.max_read_tries,
+                     volume_options_.retry_delay_s,
+                     false,
+                     volume_options_.was_interrupted_function));
+    } catch (const XtreemFSException&) {
+      // Read() will try again and report the error.
+      operation->ObjectNotSent(context);
+      continue;
+    }
+
+    readRequest rq;
+    rq.set_file_id(file_credentials.xcap().file_id());
+    rq.mutable_file_credentials()->CopyFrom(file_credentials);
+    rq.set_object_number(operations[j].obj_number);
+    rq.set_object_version(0);
+    rq.set_offset(operations[j].req_offset);
+    rq.set_length(operations[j].req_size);
+    SendReadRequestToBuffer(osd_address, &rq, operations[j].data,
+                            operation, context);
+  }
+  return true;
+}
+
+bool FileHandleImplementation::SendWriteRequestsAsync(
+    AsyncIOOperation* operation,
+    const char* buf,
+    size_t count,
+    int64_t offset) {
+  // Asynchronous writes and the object cache keep their own order of writes,
+  // so these writes are executed by DoWrite().
+  if (async_writes_enabled_ || file_info_->object_cache() != NULL) {
+    return false;
+  }
+
+  FileCredentials file_credentials;
+  xcap_manager_.GetXCap(file_credentials.mutable_xcap());
+  file_info_->GetXLocSet(file_credentials.mutable_xlocs());
+  const XLocSet& xlocs = file_credentials.xlocs();
+  // The parity of erasure coded files is updated by DoWrite().
+  if (xlocs.replicas_size() == 0 ||
+      xlocs.replicas(0).striping_policy().type() ==
+          STRIPING_POLICY_ERASURECODE) {
+    return false;
+  }
+
+  StripeTranslator::PolicyContainer striping_policies;
+  for (int32_t i = 0; i < xlocs.replicas_size(); ++i) {
+    striping_policies.push_back(&(xlocs.replicas(i).striping_policy()));
+  }
+  const StripeTranslator* translator =
+      GetStripeTranslator((*striping_policies.begin())->type());
+  std::vector<WriteOperation> operations;
+  translator->TranslateWriteRequest(buf, count, offset, striping_policies,
+                                    &operations);
+
+  for (size_t j = 0; j < operations.size(); j++) {
+    string osd_uuid, osd_address;
+    if (xlocs.replicas(0).osd_uuids_size() > 1) {
+      // Replica is striped. Pick UUID from xlocset.
+      osd_uuid = GetOSDUUIDFromXlocSet(xlocs,
+                                       0,  // Use first and only replica.
+                                       operations[j].osd_offsets[0]);
+    } else {
+      osd_uuid_iterator_->GetUUID(&osd_uuid);
+    }
+
+    void* context = operation->AddObject(
+        const_cast<char*>(operations[j].data), operations[j].req_size);
+    try {
+      uuid_resolver_->UUIDToAddressWithOptions(
+          osd_uuid,
+          &osd_address,
+          RPCOptions(volume_options_.max_write_tries,
+                     volume_options_.retry_delay_s,
+                     false,
+                     volume_options_.was_interrupted_function));
+    } catch (const XtreemFSException&) {
+      // Write() will try again and report the error.
+      operation->ObjectNotSent(context);
+      continue;
     }
+
+    writeRequest rq;
+    rq.mutable_file_credentials()->CopyFrom(file_credentials);
+    rq.set_file_id(file_credentials.xcap().file_id());
+    rq.set_object_number(operations[j].obj_number);
+    rq.set_object_version(0);
+    rq.set_offset(operations[j].req_offset);
+    rq.set_lease_timeout(0);
+
+    ObjectData* data = rq.mutable_object_data();
+    SetObjectChecksum(operations[j].data, operations[j].req_size, data);
+    data->set_invalid_checksum_on_osd(false);
+    data->set_zero_padding(0);
+
+    // The request is serialized when sent, so "rq" may go out of scope.
+    osd_service_client_->write(osd_address,
+                               auth_bogus_,
+                               user_credentials_bogus_,
+                               &rq,
+                               operations[j].data,
+                               operations[j].req_size,
+                               operation,
+                               context);
+  }
+  return true;
+}
+
+int FileHandleImplementation::ReadObjectFromOSD(int object_no, char* buffer) {
+  FileCredentials file_credentials;
+  xcap_manager_.GetXCap(file_credentials.mutable_xcap());
+  boost::shared_ptr<UUIDContainer> osd_uuid_container =
+      file_info_->GetXLocSetAndUUIDContainer(file_credentials.mutable_xlocs());
+  const XLocSet& xlocs = file_credentials.xlocs();
+  const int object_size = file_info_->object_cache()->object_size();
+
+  if (xlocs.replicas(0).osd_uuids_size() > 1) {
+    // Replica is striped. Get a UUID iterator from OSD offsets.
+    ContainerUUIDIterator uuid_iterator(
+        osd_uuid_container,
+        GetOSDOffsetsOfObject(xlocs, object_no, object_size));
+    return ReadFromOSD(&uuid_iterator, file_credentials,
+                       object_no, buffer, 0, object_size);
   } else {
-    response->DeleteBuffers();
+    return ReadFromOSD(osd_uuid_iterator_, file_credentials,
+                       object_no, buffer, 0, object_size);
+  }
+}
+
+void FileHandleImplementation::WriteObjectToOSD(int object_no,
+                                                const char* buffer,
+                                                int bytes_to_write) {
+  FileCredentials file_credentials;
+  xcap_manager_.GetXCap(file_credentials.mutable_xcap());
+  file_info_->GetXLocSet(file_credentials.mutable_xlocs());
+  const XLocSet& xlocs = file_credentials.xlocs();
+
+  if (xlocs.replicas(0).osd_uuids_size() > 1) {
+    // Replica is striped. Pick UUID from xlocset.
+    SimpleUUIDIterator uuid_iterator;
+    uuid_iterator.AddUUID(GetOSDUUIDFromXlocSet(
+        xlocs,
+        0,  // Use first and only replica.
+        GetOSDOffsetsOfObject(xlocs,
+                              object_no,
+                              file_info_->object_cache()->object_size())[0]));
+    WriteToOSD(&uuid_iterator, file_credentials,
+               object_no, 0, buffer, bytes_to_write);
+  } else {
+    WriteToOSD(osd_uuid_iterator_, file_credentials,
+               object_no, 0, buffer, bytes_to_write);
+  }
+}
+
+OSDOffsets FileHandleImplementation::GetOSDOffsetsOfObject(
+    const xtreemfs::pbrpc::XLocSet& xlocs,
+    int object_no,
+    int object_size) {
+  StripeTranslator::PolicyContainer striping_policies;
+  for (int32_t i = 0; i < xlocs.replicas_size(); ++i) {
+    striping_policies.push_back(&(xlocs.replicas(i).striping_policy()));
   }
+
+  std::vector<ReadOperation> operations;
+  GetStripeTranslator((*striping_policies.begin())->type())->
+      TranslateReadRequest(NULL,
+                           object_size,
+                           static_cast<int64_t>(object_no) * object_size,
+                           striping_policies,
+                           &operations);
+  assert(operations.size() == 1);
+  return operations[0].osd_offsets;
 }
 
 void FileHandleImplementation::Flush() {
@@ -454,6 +1747,12 @@ void FileHandleImplementation::Flush(bool close_file) {
 }
 
 void FileHandleImplementation::DoFlush(bool close_file) {
+  ObjectCache* object_cache = file_info_->object_cache();
+  if (object_cache != NULL) {
+    object_cache->Flush(boost::bind(
+        &FileHandleImplementation::WriteObjectToOSD, this, _1, _2, _3));
+  }
+
   file_info_->Flush(this, close_file);
 
   if (DidAsyncWritesFail()) {
@@ -557,10 +1856,95 @@ void FileHandleImplementation::DoTruncatePhaseTwoAndThree(
     response->DeleteBuffers();
   }
 
+  // Drop cached data beyond the new file size.
+  ObjectCache* object_cache = file_info_->object_cache();
+  if (object_cache != NULL) {
+    object_cache->Truncate(new_file_size);
+  }
+  ReadAheadHandler* read_ahead_handler = file_info_->read_ahead_handler();
+  if (read_ahead_handler != NULL) {
+    read_ahead_handler->Clear();
+  }
+
+  // The parity of removed stripes has to go as well, and the truncated data
+  // of the new last stripe is part of its parity.
+  const FileCredentials& file_credentials = truncate_rq.file_credentials();
+  if (file_credentials.xlocs().replicas_size() > 0 &&
+      file_credentials.xlocs().replicas(0).striping_policy().type() ==
+          STRIPING_POLICY_ERASURECODE) {
+    const StripingPolicy& policy =
+        file_credentials.xlocs().replicas(0).striping_policy();
+    const int64_t stripe_length =
+        static_cast<int64_t>(policy.stripe_size()) * 1024 * policy.width();
+    FileInfo::StripeUpdateLock lock(file_info_);
+    TruncateParity(file_credentials, new_file_size);
+    if (new_file_size % stripe_length != 0) {
+      std::vector<WriteOperation> no_operations;
+      std::vector<bool> failed_osds(policy.width() + policy.parity_width(),
+                                    false);
+      WriteStripe(file_credentials,
+                  util::ReedSolomon(policy.width(), policy.parity_width()),
+                  new_file_size / stripe_length,
+                  no_operations.begin(),
+                  no_operations.end(),
+                  &failed_osds);
+    }
+  }
+
   // 3. Update the file size at the MRC.
   file_info_->FlushPendingFileSizeUpdate(this);
 }
 
+void FileHandleImplementation::TruncateParity(
+    const FileCredentials& file_credentials,
+    int64_t new_file_size) {
+  const StripingPolicy& policy =
+      file_credentials.xlocs().replicas(0).striping_policy();
+  const int64_t object_size = static_cast<int64_t>(policy.stripe_size()) * 1024;
+  const int64_t stripe_length = object_size * policy.width();
+
+  // The parity OSDs store the parity of a stripe as the first object of the
+  // stripe, as long as the longest data object, i.e. the first one. So their
+  // size ends with the parity of the new last stripe.
+  truncateRequest truncate_rq;
+  truncate_rq.mutable_file_credentials()->CopyFrom(file_credentials);
+  truncate_rq.set_file_id(file_credentials.xcap().file_id());
+  truncate_rq.set_new_file_size(0);
+  if (new_file_size > 0) {
+    const int64_t last_stripe = (new_file_size - 1) / stripe_length;
+    truncate_rq.set_new_file_size(
+        static_cast<int64_t>(
+            StripeTranslatorErasureCode::GetFirstObjectOfStripe(
+                policy, static_cast<size_t>(last_stripe))) * object_size +
+        min(object_size, new_file_size - last_stripe * stripe_length));
+  }
+
+  for (int i = 0; i < policy.parity_width(); ++i) {
+    SimpleUUIDIterator uuid_iterator;
+    uuid_iterator.AddUUID(GetOSDUUIDFromXlocSet(
+        file_credentials.xlocs(),
+        0,
+        StripeTranslatorErasureCode::GetParityOSDOffset(policy, i)));
+    boost::scoped_ptr<rpc::SyncCallbackBase> response(
+        ExecuteSyncRequest(
+            boost::bind(
+                &xtreemfs::pbrpc::OSDServiceClient::truncate_sync,
+                osd_service_client_,
+                _1,
+                boost::cref(auth_bogus_),
+                boost::cref(user_credentials_bogus_),
+                &truncate_rq),
+            &uuid_iterator,
+            uuid_resolver_,
+            RPCOptionsFromOptions(volume_options_),
+            false,
+            &xcap_manager_,
+            truncate_rq.mutable_file_credentials()->mutable_xcap()));
+    // The parity objects do not change the size of the file.
+    response->DeleteBuffers();
+  }
+}
+
 void FileHandleImplementation::GetAttr(
      const xtreemfs::pbrpc::UserCredentials& user_credentials,
      xtreemfs::pbrpc::Stat* stat) {
@@ -992,23 +2376,8 @@ void FileHandleImplementation::WriteBackFileSizeAsync(const RPCOptions& options)
     if (!osd_write_response_for_async_write_back_.get()) {
       return;
     }
-
-    if (Logging::log->loggingActive(LEVEL_DEBUG)) {
-      string path;
-      file_info_->GetPath(&path);
-      Logging::log->getLog(LEVEL_DEBUG)
-          << "update_file_size: " << path << " # bytes: "
-          << osd_write_response_for_async_write_back_->size_in_bytes()
-          << endl;
-    }
-    rq.mutable_osd_write_response()
-        ->CopyFrom(*osd_write_response_for_async_write_back_);
   }
-  xcap_manager_.GetXCap(rq.mutable_xcap());
-  // Set to false because a close would use a sync writeback.
-  rq.set_close_file(false);
-
-  // NOTE: no vivaldi coordinates needed since close_file is set false.
+  GetFileSizeUpdateRequest(&rq);
 
   try {
     string mrc_uuid;
@@ -1026,6 +2395,30 @@ void FileHandleImplementation::WriteBackFileSizeAsync(const RPCOptions& options)
   }
 }
 
+void FileHandleImplementation::GetFileSizeUpdateRequest(
+    xtreemfs::pbrpc::xtreemfs_update_file_sizeRequest* rq) {
+  {
+    boost::mutex::scoped_lock lock(mutex_);
+    assert(osd_write_response_for_async_write_back_.get());
+
+    if (Logging::log->loggingActive(LEVEL_DEBUG)) {
+      string path;
+      file_info_->GetPath(&path);
+      Logging::log->getLog(LEVEL_DEBUG)
+          << "update_file_size: " << path << " # bytes: "
+          << osd_write_response_for_async_write_back_->size_in_bytes()
+          << endl;
+    }
+    rq->mutable_osd_write_response()
+        ->CopyFrom(*osd_write_response_for_async_write_back_);
+  }
+  xcap_manager_.GetXCap(rq->mutable_xcap());
+  // Set to false because a close would use a sync writeback.
+  rq->set_close_file(false);
+
+  // NOTE: no vivaldi coordinates needed since close_file is set false.
+}
+
 void FileHandleImplementation::CallFinished(
     xtreemfs::pbrpc::timestampResponse* response_message,
     char* data,
@@ -1052,10 +2445,14 @@ void FileHandleImplementation::CallFinished(
     }
   }
 
+  FileSizeUpdateFinished(error == NULL);
+}
+
+void FileHandleImplementation::FileSizeUpdateFinished(bool success) {
   file_info_->AsyncFileSizeUpdateResponseHandler(
       *(osd_write_response_for_async_write_back_.get()),
       this,
-      error == NULL);
+      success);
 }
 
 void FileHandleImplementation::set_osd_write_response_for_async_write_back(
@@ -1251,6 +2648,28 @@ void XCapManager::CallFinished(
   boost::scoped_ptr<XCap> autodelete_xcap(new_xcap);
   boost::scoped_ptr<RPCHeader::ErrorResponse> autodelete_error(error);
   boost::scoped_array<char> autodelete_data(data);
+
+  XCapRenewalFinished(new_xcap, error);
+}
+
+bool XCapManager::StartXCapRenewal(xtreemfs::pbrpc::XCap* xcap) {
+  boost::mutex::scoped_lock lock(mutex_);
+  if (xcap_renewal_pending_) {
+    return false;
+  }
+  xcap_renewal_pending_ = true;
+
+  acquireOldExpireTimesMutex();
+  old_expire_times_.push_back(xcap_.expire_time_ms());
+  releaseOldExpireTimesMutex();
+
+  xcap->CopyFrom(xcap_);
+  return true;
+}
+
+void XCapManager::XCapRenewalFinished(
+    const xtreemfs::pbrpc::XCap* new_xcap,
+    const xtreemfs::pbrpc::RPCHeader::ErrorResponse* error) {
   boost::mutex::scoped_lock xcap_renewal_error_writebacks_lock(xcap_renewal_error_writebacks_mutex_);
 
   if (error != NULL) {
@@ -1289,7 +2708,7 @@ void XCapManager::CallFinished(
         *(*it) = PosixErrorException(POSIX_ERROR_ENOSPC, error_msg);
       }
     }
-  } else {
+  } else if (new_xcap != NULL) {
     // Overwrite current XCap only by a newer one (i.e. later expire time).
     if (new_xcap->expire_time_ms() > xcap_.expire_time_ms() ||
         (new_xcap->expire_time_ms() == xcap_.expire_time_ms() && new_xcap->voucher_size() > xcap_.voucher_size())) {
@@ -8,7 +8,9 @@
 #include "libxtreemfs/file_info.h"
 
 #include <boost/make_shared.hpp>
+#include <algorithm>
 
+#include "libxtreemfs/async_write_combiner.h"
 #include "libxtreemfs/file_handle_implementation.h"
 #include "libxtreemfs/helper.h"
 #include "libxtreemfs/options.h"
@@ -57,13 +59,42 @@ FileInfo::FileInfo(
                            volume->auth_bogus(),
                            volume->user_credentials_bogus(),
                            volume->volume_options(),
-                           client->GetAsyncWriteCallbackQueue()) {
+                           client->GetAsyncWriteCallbackQueue()),
+      replica_selector_(volume->replica_selector()) {
 #ifdef _MSC_VER
 #pragma warning(pop)
 #endif  // _MSC_VER
 
   // Make an UUID container managed by a smart pointer.
   osd_uuid_container_ = boost::make_shared<UUIDContainer>(xlocset);
+  UpdateOSDUUIDIteratorScorer(xlocset);
+
+  const Options& options = volume->volume_options();
+  if (xlocset.replicas_size() > 0) {
+    // The objects of a file are cached with the stripe size of its replicas.
+    const int object_size =
+        xlocset.replicas(0).striping_policy().stripe_size() * 1024;
+    ObjectCacheBudget* budget = volume->object_cache_budget();
+    if (budget->max_bytes() > 0) {
+      object_cache_.reset(new ObjectCache(budget->max_bytes() / object_size,
+                                          object_size,
+                                          budget));
+    } else if (options.max_read_ahead_objects > 0) {
+      read_ahead_handler_.reset(new ReadAheadHandler(
+          object_size,
+          options.max_read_ahead_objects,
+          options.enable_object_checksums));
+    }
+  }
+
+  // Writes to the ObjectCache are already combined per object.
+  if (options.enable_async_writes &&
+      options.async_writes_combine_timeout_ms > 0 &&
+      object_cache_.get() == NULL) {
+    async_write_combiner_.reset(new AsyncWriteCombiner(
+        &async_write_handler_,
+        options.async_writes_max_request_size_kb * 1024));
+  }
 }
 
 FileInfo::~FileInfo() {
@@ -90,6 +121,7 @@ FileHandleImplementation* FileInfo::CreateFileHandle(
       volume_->uuid_resolver(),
       volume_->mrc_service_client(),
       volume_->osd_service_client(),
+      volume_->network_client(),
       volume_->stripe_translators(),
       async_writes_enabled,
       volume_->volume_options(),
@@ -138,6 +170,16 @@ int FileInfo::DecreaseReferenceCount() {
 }
 
 void FileInfo::MergeStatAndOSDWriteResponse(xtreemfs::pbrpc::Stat* stat) {
+  // Dirty objects may extend the file beyond the size known so far. Query them
+  // before locking osd_write_response_mutex_ as writing back objects of the
+  // ObjectCache acquires it while the cache is locked.
+  int64_t dirty_file_size =
+      object_cache_.get() ? object_cache_->GetDirtyFileSize() : 0;
+  if (async_write_combiner_.get()) {
+    dirty_file_size = max(dirty_file_size,
+                          async_write_combiner_->GetPendingFileSize());
+  }
+
   boost::mutex::scoped_lock lock(osd_write_response_mutex_);
 
   if (osd_write_response_.get()) {
@@ -156,6 +198,10 @@ void FileInfo::MergeStatAndOSDWriteResponse(xtreemfs::pbrpc::Stat* stat) {
       }
     }
   }
+
+  if (stat->size() < static_cast<uint64_t>(dirty_file_size)) {
+    stat->set_size(dirty_file_size);
+  }
 }
 
 bool FileInfo::TryToUpdateOSDWriteResponse(
@@ -203,6 +249,56 @@ void FileInfo::RenewXCapsAsync(const RPCOptions& options) {
   }
 }
 
+void FileInfo::AddFileSizeUpdate(MRCRequestBatcher::FileSizeUpdates* updates) {
+  boost::mutex::scoped_lock lock(osd_write_response_mutex_);
+
+  // Only update pending file size updates.
+  if (osd_write_response_.get() && osd_write_response_status_ == kDirty) {
+    FileHandleImplementation* file_handle =
+        CreateFileHandle(osd_write_response_xcap_, false, true);
+    pending_filesize_updates_.push_back(file_handle);
+    osd_write_response_status_ = kDirtyAndAsyncPending;
+    file_handle->set_osd_write_response_for_async_write_back(
+        *(osd_write_response_.get()));
+    file_handle->GetFileSizeUpdateRequest(updates->request.add_updates());
+    updates->file_handles.push_back(file_handle);
+  }
+}
+
+void FileInfo::AddXCapRenewals(MRCRequestBatcher::XCapRenewals* renewals) {
+  boost::mutex::scoped_lock lock(open_file_handles_mutex_);
+
+  for (list<FileHandleImplementation*>::iterator it =
+           open_file_handles_.begin();
+       it != open_file_handles_.end();
+       ++it) {
+    XCapManager* xcap_manager = (*it)->xcap_manager();
+    if (xcap_manager->StartXCapRenewal(renewals->request.add_xcaps())) {
+      renewals->xcap_managers.push_back(xcap_manager);
+    } else {
+      renewals->request.mutable_xcaps()->RemoveLast();
+    }
+  }
+}
+
+bool FileInfo::GetKnownFileSize(uint64_t* size) {
+  string path;
+  GetPath(&path);
+  Stat stat;
+  if (volume_->GetCachedStat(path, &stat)) {
+    MergeStatAndOSDWriteResponse(&stat);
+    *size = stat.size();
+    return true;
+  }
+
+  boost::mutex::scoped_lock lock(osd_write_response_mutex_);
+  if (osd_write_response_.get()) {
+    *size = osd_write_response_->size_in_bytes();
+    return true;
+  }
+  return false;
+}
+
 void FileInfo::GetOSDWriteResponse(
     xtreemfs::pbrpc::OSDWriteResponse* response) {
   boost::mutex::scoped_lock lock(osd_write_response_mutex_);
@@ -445,7 +541,17 @@ void FileInfo::AsyncWrite(AsyncWriteBuffer* write_buffer) {
   async_write_handler_.Write(write_buffer);
 }
 
+void FileInfo::FlushCombinedAsyncWrites(
+    const boost::posix_time::ptime& deadline) {
+  if (async_write_combiner_.get()) {
+    async_write_combiner_->FlushIfOlderThan(deadline);
+  }
+}
+
 void FileInfo::WaitForPendingAsyncWrites() {
+  if (async_write_combiner_.get()) {
+    async_write_combiner_->Flush();
+  }
   async_write_handler_.WaitForPendingWrites();
 }
 
@@ -453,6 +559,9 @@ bool FileInfo::WaitForPendingAsyncWritesNonBlocking(
     boost::condition* condition_variable,
     bool* wait_completed,
     boost::mutex* wait_completed_mutex) {
+  if (async_write_combiner_.get()) {
+    async_write_combiner_->Flush();
+  }
   return async_write_handler_.
       WaitForPendingWritesNonBlocking(condition_variable,
                                       wait_completed,
@@ -466,6 +575,7 @@ void FileInfo::UpdateXLocSetAndRest(const xtreemfs::pbrpc::XLocSet& new_xlocset,
   xlocset_.CopyFrom(new_xlocset);
   osd_uuid_iterator_.ClearAndGetOSDUUIDsFromXlocSet(new_xlocset);
   osd_uuid_container_ = boost::make_shared<UUIDContainer>(new_xlocset);
+  UpdateOSDUUIDIteratorScorer(new_xlocset);
 
   replicate_on_close_ = replicate_on_close;
 }
@@ -477,6 +587,19 @@ void FileInfo::UpdateXLocSetAndRest(
   xlocset_.CopyFrom(new_xlocset);
   osd_uuid_iterator_.ClearAndGetOSDUUIDsFromXlocSet(new_xlocset);
   osd_uuid_container_ = boost::make_shared<UUIDContainer>(new_xlocset);
+  UpdateOSDUUIDIteratorScorer(new_xlocset);
+}
+
+UUIDScorer* FileInfo::uuid_scorer() {
+  return volume_->uuid_scorer();
+}
+
+void FileInfo::UpdateOSDUUIDIteratorScorer(
+    const xtreemfs::pbrpc::XLocSet& xlocset) {
+  // Other OSDs than the current one would redirect the client back.
+  osd_uuid_iterator_.set_scorer(
+      ReplicaSelector::HasInterchangeableReplicas(xlocset)
+          ? uuid_scorer() : NULL);
 }
 
 void FileInfo::GetXLocSet(xtreemfs::pbrpc::XLocSet* new_xlocset) {
@@ -0,0 +1,154 @@
+/*
+ * Copyright (c) 2015 by Zuse Institute Berlin
+ *
+ * Licensed under the BSD License, see LICENSE file for details.
+ *
+ */
+
+#include "libxtreemfs/hedged_read.h"
+
+#include <cassert>
+#include <cstring>
+
+#include "libxtreemfs/helper.h"
+#include "rpc/client.h"
+#include "rpc/client_request.h"
+#include "util/monotonic_clock.h"
+#include "xtreemfs/OSD.pb.h"
+#include "xtreemfs/OSDServiceConstants.h"
+
+using namespace std;
+using namespace xtreemfs::pbrpc;
+
+namespace xtreemfs {
+
+const int HedgedRead::kMaxTargets;
+
+HedgedRead::HedgedRead()
+    : sent_(0), failed_(0), winner_(NULL), references_(1) {}
+
+HedgedRead::~HedgedRead() {
+  if (winner_ != NULL) {
+    DeleteRequest(winner_);
+  }
+}
+
+void HedgedRead::Send(rpc::Client* network_client,
+                      const std::string& osd_uuid,
+                      const std::string& osd_address,
+                      const pbrpc::readRequest& request,
+                      const pbrpc::Auth& auth,
+                      const pbrpc::UserCredentials& user_credentials) {
+  void* context;
+  {
+    boost::mutex::scoped_lock lock(mutex_);
+    assert(sent_ < kMaxTargets);
+    targets_[sent_] = osd_uuid;
+    context = &targets_[sent_];
+    ++sent_;
+    ++references_;
+  }
+
+  // The callback may be executed before sendRequest() returns.
+  network_client->sendRequest(osd_address,
+                              INTERFACE_ID_OSD,
+                              PROC_ID_READ,
+                              user_credentials,
+                              auth,
+                              &request,
+                              NULL,
+                              0,
+                              new ObjectData(),
+                              context,
+                              this);
+}
+
+void HedgedRead::RequestCompleted(rpc::ClientRequest* request) {
+  bool delete_this = false;
+  {
+    boost::mutex::scoped_lock lock(mutex_);
+    if (request->error() == NULL && winner_ == NULL) {
+      winner_ = request;
+      winner_uuid_ = *static_cast<string*>(request->context());
+      request = NULL;
+    } else if (request->error() != NULL) {
+      ++failed_;
+    }
+    finished_.notify_all();
+    delete_this = --references_ == 0;
+  }
+
+  if (request != NULL) {
+    DeleteRequest(request);
+  }
+  if (delete_this) {
+    delete this;
+  }
+}
+
+bool HedgedRead::IsFinished() {
+  return winner_ != NULL || failed_ == sent_;
+}
+
+bool HedgedRead::WaitUntil(const boost::posix_time::ptime& deadline) {
+  boost::mutex::scoped_lock lock(mutex_);
+  while (!IsFinished()) {
+    // The absolute timed_wait() uses the system time, so wait relative.
+    const boost::posix_time::ptime now = util::MonotonicTime();
+    if (now >= deadline || !finished_.timed_wait(lock, deadline - now)) {
+      return IsFinished();
+    }
+  }
+  return true;
+}
+
+void HedgedRead::Wait() {
+  boost::mutex::scoped_lock lock(mutex_);
+  while (!IsFinished()) {
+    finished_.wait(lock);
+  }
+}
+
+int HedgedRead::CopyResponse(char* buffer, bool verify_checksum) {
+  boost::mutex::scoped_lock lock(mutex_);
+  if (winner_ == NULL) {
+    return -1;
+  }
+  ObjectData* data = static_cast<ObjectData*>(winner_->resp_message());
+  const int data_length = winner_->resp_data_len();
+  if (!IsObjectDataValid(*data, winner_->resp_data(), data_length,
+                         verify_checksum)) {
+    return -1;
+  }
+  if (data_length > 0) {
+    memcpy(buffer, winner_->resp_data(), data_length);
+  }
+  // If zero_padding() > 0, the gap has to be filled with zeroes.
+  memset(buffer + data_length, 0, data->zero_padding());
+  return data_length + data->zero_padding();
+}
+
+std::string HedgedRead::winner_uuid() {
+  boost::mutex::scoped_lock lock(mutex_);
+  return winner_uuid_;
+}
+
+void HedgedRead::Release() {
+  bool delete_this;
+  {
+    boost::mutex::scoped_lock lock(mutex_);
+    delete_this = --references_ == 0;
+  }
+  if (delete_this) {
+    delete this;
+  }
+}
+
+void HedgedRead::DeleteRequest(rpc::ClientRequest* request) {
+  request->clear_error();
+  request->clear_resp_message();
+  request->clear_resp_data();
+  delete request;
+}
+
+}  // namespace xtreemfs
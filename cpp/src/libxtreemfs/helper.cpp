@@ -20,7 +20,9 @@
 #include "libxtreemfs/xtreemfs_exception.h"
 #include <boost/algorithm/string.hpp>
 #include "rpc/sync_callback.h"
+#include "util/crc32c.h"
 #include "util/logging.h"
+#include "util/metrics.h"
 #include "xtreemfs/GlobalTypes.pb.h"
 #include "xtreemfs/MRC.pb.h"
 #include "xtreemfs/OSD.pb.h"
@@ -48,6 +50,14 @@ using namespace xtreemfs::util;
 
 namespace xtreemfs {
 
+namespace {
+
+/** Reads of object data which was corrupted. */
+Counter* const checksum_errors_counter =
+    MetricsRegistry::instance()->GetCounter("object_checksum_errors");
+
+}  // anonymous namespace
+
 int CompareOSDWriteResponses(
     const xtreemfs::pbrpc::OSDWriteResponse* new_response,
     const xtreemfs::pbrpc::OSDWriteResponse* current_response) {
@@ -77,6 +87,19 @@ int CompareOSDWriteResponses(
   }
 }
 
+bool IsObjectDataValid(const xtreemfs::pbrpc::ObjectData& object_data,
+                       const char* data,
+                       size_t data_length,
+                       bool verify_checksum) {
+  if (object_data.invalid_checksum_on_osd() ||
+      (verify_checksum && object_data.checksum() != 0 &&
+       object_data.checksum() != CRC32C(0, data, data_length))) {
+    checksum_errors_counter->Increment();
+    return false;
+  }
+  return true;
+}
+
 /** The global file id  contains the Volume UUID and File ID concatenated by a ":". */
 uint64_t ExtractFileIdFromGlobalFileId(std::string global_file_id) {
   int start = global_file_id.find(":") + 1;
@@ -160,7 +183,8 @@ std::string GetOSDUUIDFromXlocSet(
 }
 
 std::string StripePolicyTypeToString(xtreemfs::pbrpc::StripingPolicyType policy) {
-  std::string policyMap[] = { "STRIPING_POLICY_RAID0" };
+  std::string policyMap[] = { "STRIPING_POLICY_RAID0",
+                              "STRIPING_POLICY_ERASURECODE" };
   return policyMap[policy];
 }
 
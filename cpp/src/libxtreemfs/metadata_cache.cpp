@@ -7,6 +7,12 @@
 
 #include "libxtreemfs/metadata_cache.h"
 
+#include <boost/functional/hash.hpp>
+#include <boost/scoped_array.hpp>
+#include <algorithm>
+#include <cassert>
+#include <vector>
+
 #include "libxtreemfs/helper.h"
 #include "util/logging.h"
 #include "xtreemfs/OSD.pb.h"
@@ -34,6 +40,16 @@ using namespace xtreemfs::util;
  * InvalidatePrefix:  Complexity: O(log n) (searches for the first occurrence of
  *                    the prefix and deletes all following affected entries).
  *
+ * The entries are distributed by the hash of their path over several shards.
+ * Every shard has its own container, lock and LRU order, so concurrent
+ * accesses to different paths rarely wait for each other. The prefix
+ * operations InvalidatePrefix() and RenamePrefix() visit all shards.
+ *
+ * GetStat() also answers lookups of paths which do not exist: either from a
+ * negative entry (a stat-less entry whose nonexistent_timeout_s is not
+ * expired) or from the sorted names of the completely listed parent
+ * directory. Both have to be invalidated when this client creates the path.
+ *
  * @note index.replace() cannot get used in the Update* functions to update an
  * existing entry because the timestamp order in the list-like index will not be
  * updated. The list-like index is used to determine the oldest element (at the
@@ -55,31 +71,66 @@ using namespace xtreemfs::util;
 
 namespace xtreemfs {
 
-MetadataCache::MetadataCache(uint64_t size, uint64_t ttl_s)
-    : size_(size), ttl_s_(ttl_s) {
+const int MetadataCache::kMaxShards;
+const int MetadataCache::kMinEntriesPerShard;
+
+MetadataCache::MetadataCache(uint64_t size,
+                             uint64_t ttl_s,
+                             uint64_t negative_ttl_s)
+    : size_(size), ttl_s_(ttl_s), negative_ttl_s_(negative_ttl_s) {
+  enabled = size > 0 ? true : false;
+  // Small caches keep a single LRU order, larger ones are split into up to
+  // kMaxShards shards.
+  Initialize(static_cast<int>(std::min(
+      static_cast<uint64_t>(kMaxShards),
+      std::max(static_cast<uint64_t>(1), size / kMinEntriesPerShard))));
+}
+
+MetadataCache::MetadataCache(uint64_t size,
+                             uint64_t ttl_s,
+                             uint64_t negative_ttl_s,
+                             int shards)
+    : size_(size), ttl_s_(ttl_s), negative_ttl_s_(negative_ttl_s) {
   enabled = size > 0 ? true : false;
+  Initialize(shards);
+}
+
+void MetadataCache::Initialize(int shards) {
+  assert(shards > 0);
+  shard_count_ = shards;
+  shards_.reset(new Shard[shard_count_]);
+  // Round up, so the total capacity is at least size_.
+  shard_size_ = (size_ + shard_count_ - 1) / shard_count_;
 }
 
 MetadataCache::~MetadataCache() {
   // Free all objects.
-  boost::mutex::scoped_lock lock(mutex_);
-
-  by_list& index = cache_.get<IndexList>();
-  for (by_list::iterator it_list = index.begin();
-       it_list != index.end(); ++it_list) {
-    delete *it_list;
+  for (int i = 0; i < shard_count_; ++i) {
+    Shard& shard = shards_[i];
+    boost::mutex::scoped_lock lock(shard.mutex);
+
+    by_list& index = shard.cache.get<IndexList>();
+    for (by_list::iterator it_list = index.begin();
+         it_list != index.end(); ++it_list) {
+      delete *it_list;
+    }
   }
 }
 
+MetadataCache::Shard& MetadataCache::GetShard(const std::string& path) {
+  return shards_[boost::hash<std::string>()(path) % shard_count_];
+}
+
 
 void MetadataCache::Invalidate(const std::string& path) {
   if (path.empty() || !enabled) {
     return;
   }
 
-  boost::mutex::scoped_lock lock(mutex_);
+  Shard& shard = GetShard(path);
+  boost::mutex::scoped_lock lock(shard.mutex);
 
-  by_hash& index = cache_.get<IndexHash>();
+  by_hash& index = shard.cache.get<IndexHash>();
   by_hash::iterator it_hash = index.find(path);
   if (it_hash != index.end()) {
     // Free MetadataCacheEntry object.
@@ -94,28 +145,32 @@ void MetadataCache::InvalidatePrefix(const std::string& path) {
     return;
   }
 
-  boost::mutex::scoped_lock lock(mutex_);
-
-  by_map& index = cache_.get<IndexMap>();
-  by_map::iterator it_map = index.find(path);
-  if (it_map != index.end()) {
-    // Free MetadataCacheEntry object.
-    delete *it_map;
-    it_map = index.erase(it_map);
-  }
-
-  // Clean any possible cached contents of the directory "path".
+  // Entries below "path" may be stored in any shard.
   const std::string prefix = path + "/";
-  // Here it's not possible to reuse it_map as there may be additional entries
-  // between path and path+"/" (for instance path+".").
-  it_map = index.lower_bound(prefix);
-  while (it_map != index.end()) {
-    MetadataCacheEntry* cached_entry = *it_map;
-    if (cached_entry->path.find(prefix) != 0) {
-      break;
+  for (int i = 0; i < shard_count_; ++i) {
+    Shard& shard = shards_[i];
+    boost::mutex::scoped_lock lock(shard.mutex);
+
+    by_map& index = shard.cache.get<IndexMap>();
+    by_map::iterator it_map = index.find(path);
+    if (it_map != index.end()) {
+      // Free MetadataCacheEntry object.
+      delete *it_map;
+      it_map = index.erase(it_map);
+    }
+
+    // Clean any possible cached contents of the directory "path".
+    // Here it's not possible to reuse it_map as there may be additional
+    // entries between path and path+"/" (for instance path+".").
+    it_map = index.lower_bound(prefix);
+    while (it_map != index.end()) {
+      MetadataCacheEntry* cached_entry = *it_map;
+      if (cached_entry->path.find(prefix) != 0) {
+        break;
+      }
+      delete *it_map;
+      it_map = index.erase(it_map);
     }
-    delete *it_map;
-    it_map = index.erase(it_map);
   }
 }
 
@@ -125,29 +180,52 @@ void MetadataCache::RenamePrefix(const std::string& path,
     return;
   }
 
-  boost::mutex::scoped_lock lock(mutex_);
-
-  by_map& index = cache_.get<IndexMap>();
-  by_map::iterator it_map = index.find(path);
-  if (it_map != index.end()) {
-    MetadataCacheEntry* cached_entry = *it_map;
-    cached_entry->path = new_path;
-    it_map = index.erase(it_map);
-    index.insert(cached_entry);
+  // Renamed entries move to other shards. Lock all shards (always in the same
+  // order) to let the rename appear atomic.
+  boost::scoped_array<boost::mutex::scoped_lock> locks(
+      new boost::mutex::scoped_lock[shard_count_]);
+  for (int i = 0; i < shard_count_; ++i) {
+    boost::mutex::scoped_lock lock(shards_[i].mutex);
+    locks[i].swap(lock);
   }
 
-  // Clean any possible cached contents of the directory "path".
+  // Remove all affected entries first.
+  vector<MetadataCacheEntry*> renamed_entries;
   const std::string prefix = path + "/";
-  const std::string prefix_new = new_path + "/";
-  it_map = index.lower_bound(prefix);
-  while (it_map != index.end()) {
-    MetadataCacheEntry* cached_entry = *it_map;
-    if (cached_entry->path.find(prefix) != 0) {
-      break;
+  for (int i = 0; i < shard_count_; ++i) {
+    by_map& index = shards_[i].cache.get<IndexMap>();
+    by_map::iterator it_map = index.find(path);
+    if (it_map != index.end()) {
+      renamed_entries.push_back(*it_map);
+      it_map = index.erase(it_map);
     }
-    // Change prefix.
-    cached_entry->path.replace(0, prefix.length(), prefix_new);
-    it_map = index.erase(it_map);
+
+    // Also rename any possible cached contents of the directory "path".
+    it_map = index.lower_bound(prefix);
+    while (it_map != index.end()) {
+      MetadataCacheEntry* cached_entry = *it_map;
+      if (cached_entry->path.find(prefix) != 0) {
+        break;
+      }
+      renamed_entries.push_back(cached_entry);
+      it_map = index.erase(it_map);
+    }
+  }
+
+  // Change the prefix and insert them into their new shards.
+  for (size_t i = 0; i < renamed_entries.size(); ++i) {
+    MetadataCacheEntry* cached_entry = renamed_entries[i];
+    cached_entry->path.replace(0, path.length(), new_path);
+
+    Shard& shard = GetShard(cached_entry->path);
+    by_map& index = shard.cache.get<IndexMap>();
+    by_map::iterator it_map = index.find(cached_entry->path);
+    if (it_map != index.end()) {
+      // The renamed entry replaces the one of the overwritten target.
+      delete *it_map;
+      index.erase(it_map);
+    }
+    EvictUnmutexed(&shard, 1);
     index.insert(cached_entry);
   }
 }
@@ -160,9 +238,10 @@ MetadataCache::GetStatResult MetadataCache::GetStat(
     return kStatNotCached;
   }
 
-  boost::mutex::scoped_lock lock(mutex_);
+  Shard& shard = GetShard(path);
+  boost::mutex::scoped_lock lock(shard.mutex);
 
-  by_hash& index = cache_.get<IndexHash>();
+  by_hash& index = shard.cache.get<IndexHash>();
   by_hash::iterator it_hash = index.find(path);
   if (it_hash != index.end()) {
     MetadataCacheEntry* cache_entry = *it_hash;
@@ -170,6 +249,14 @@ MetadataCache::GetStatResult MetadataCache::GetStat(
     assert(cache_entry->stat == NULL || cache_entry->stat->nlink() == 1);
     // Entry found for path, check timeout of Stat value.
     uint64_t current_time_s = time(NULL);
+    if (cache_entry->stat == NULL &&
+        cache_entry->nonexistent_timeout_s >= current_time_s) {
+      if (Logging::log->loggingActive(LEVEL_DEBUG)) {
+        Logging::log->getLog(LEVEL_DEBUG) << "MetadataCache GetStat hit"
+            " negative entry: " << path << endl;
+      }
+      return kPathDoesntExist;
+    }
     if (cache_entry->stat_timeout_s >= current_time_s) {
       if (cache_entry->stat != NULL) {
         stat->CopyFrom(*(cache_entry->stat));
@@ -201,29 +288,30 @@ MetadataCache::GetStatResult MetadataCache::GetStat(
       string parent_dir = ResolveParentDirectory(path);
       string basename = GetBasename(path);
 
+      // The parent directory may be stored in another shard.
+      lock.unlock();
+      Shard& parent_shard = GetShard(parent_dir);
+      boost::mutex::scoped_lock parent_lock(parent_shard.mutex);
+
+      by_hash& index = parent_shard.cache.get<IndexHash>();
       by_hash::iterator it_hash = index.find(parent_dir);
       if (it_hash != index.end()) {
         MetadataCacheEntry* cache_entry = *it_hash;
 
-        if (cache_entry->dir_entries != NULL) {
+        if (cache_entry->dir_names != NULL) {
           uint64_t current_time_s = time(NULL);
-          if (cache_entry->dir_entries_timeout_s >= current_time_s) {
-            // The parent directory is cached - we can find out if path exists.
-            path_probably_exists = false;
-            const DirectoryEntries& cached_dentries =
-                *(cache_entry->dir_entries);
-            for (int i = 0; i < cached_dentries.entries_size(); i++) {
-              const DirectoryEntry& dentry = cached_dentries.entries(i);
-              if (dentry.name() == basename) {
-                path_probably_exists = true;
-                break;
-              }
-            }
+          if (cache_entry->dir_names_timeout_s >= current_time_s) {
+            // The parent directory was listed completely - we can find out if
+            // path exists.
+            path_probably_exists = binary_search(
+                cache_entry->dir_names->begin(),
+                cache_entry->dir_names->end(),
+                basename);
           } else {
             // Expired => remove from cache.
             if (Logging::log->loggingActive(LEVEL_DEBUG)) {
               Logging::log->getLog(LEVEL_DEBUG)
-                  << "MetadataCache GetDirEntries expired: " << path << endl;
+                  << "MetadataCache GetDirNames expired: " << path << endl;
             }
             // Only delete object, if the maximum timeout is reached.
             if (cache_entry->timeout_s < current_time_s) {
@@ -238,8 +326,7 @@ MetadataCache::GetStatResult MetadataCache::GetStat(
     if (path_probably_exists) {
       if (Logging::log->loggingActive(LEVEL_DEBUG)) {
         Logging::log->getLog(LEVEL_DEBUG)
-          << "MetadataCache GetStat miss: " << path << " ["
-          << cache_.size() << "]" << endl;
+          << "MetadataCache GetStat miss: " << path << endl;
       }
       return kStatNotCached;
     } else {
@@ -258,11 +345,12 @@ void MetadataCache::UpdateStat(const std::string& path,
     return;
   }
 
-  boost::mutex::scoped_lock lock(mutex_);
+  Shard& shard = GetShard(path);
+  boost::mutex::scoped_lock lock(shard.mutex);
 
   MetadataCacheEntry* cache_entry = NULL;
   // Check if there's already an Entry for path.
-  by_map& index = cache_.get<IndexMap>();
+  by_map& index = shard.cache.get<IndexMap>();
   by_map::iterator it_map = index.find(path);
   if (it_map != index.end()) {
     cache_entry = *it_map;
@@ -282,6 +370,7 @@ void MetadataCache::UpdateStat(const std::string& path,
   }
   cache_entry->stat->CopyFrom(stat);
   cache_entry->stat_timeout_s = time(NULL) + ttl_s_;
+  cache_entry->nonexistent_timeout_s = 0;
   cache_entry->timeout_s = cache_entry->stat_timeout_s;
 
   if (it_map != index.end()) {
@@ -289,11 +378,40 @@ void MetadataCache::UpdateStat(const std::string& path,
     it_map = index.erase(it_map);
     index.insert(it_map, cache_entry);
   } else {
-    EvictUnmutexed(1);
+    EvictUnmutexed(&shard, 1);
     index.insert(cache_entry);
   }
 }
 
+void MetadataCache::UpdateNegativeEntry(const std::string& path) {
+  if (path.empty() || !enabled || negative_ttl_s_ == 0) {
+    return;
+  }
+
+  Shard& shard = GetShard(path);
+  boost::mutex::scoped_lock lock(shard.mutex);
+
+  // Anything cached for a path which does not exist is outdated.
+  by_map& index = shard.cache.get<IndexMap>();
+  by_map::iterator it_map = index.find(path);
+  if (it_map != index.end()) {
+    delete *it_map;
+    index.erase(it_map);
+  }
+
+  if (Logging::log->loggingActive(LEVEL_DEBUG)) {
+    Logging::log->getLog(LEVEL_DEBUG)
+        << "MetadataCache UpdateNegativeEntry: " << path << endl;
+  }
+  MetadataCacheEntry* cache_entry = new MetadataCacheEntry();
+  cache_entry->path = path;
+  cache_entry->nonexistent_timeout_s = time(NULL) + negative_ttl_s_;
+  cache_entry->timeout_s = cache_entry->nonexistent_timeout_s;
+
+  EvictUnmutexed(&shard, 1);
+  index.insert(cache_entry);
+}
+
 // TODO(mberlin): Also update the stat entry in the direntry of the parent dir.
 void MetadataCache::UpdateStatTime(const std::string& path,
                                    uint64_t timestamp_s,
@@ -302,9 +420,10 @@ void MetadataCache::UpdateStatTime(const std::string& path,
     return;
   }
 
-  boost::mutex::scoped_lock lock(mutex_);
+  Shard& shard = GetShard(path);
+  boost::mutex::scoped_lock lock(shard.mutex);
 
-  by_map& index = cache_.get<IndexMap>();
+  by_map& index = shard.cache.get<IndexMap>();
   by_map::iterator it_map = index.find(path);
   if (it_map != index.end()) {
     MetadataCacheEntry* cache_entry = *it_map;
@@ -340,9 +459,10 @@ void MetadataCache::UpdateStatAttributes(const std::string& path,
     return;
   }
 
-  boost::mutex::scoped_lock lock(mutex_);
+  Shard& shard = GetShard(path);
+  boost::mutex::scoped_lock lock(shard.mutex);
 
-  by_map& index = cache_.get<IndexMap>();
+  by_map& index = shard.cache.get<IndexMap>();
   by_map::iterator it_map = index.find(path);
   if (it_map != index.end()) {
     MetadataCacheEntry* cache_entry = *it_map;
@@ -415,9 +535,10 @@ xtreemfs::pbrpc::Setattrs MetadataCache::SimulateSetStatAttributes(
   }
 
   int actual_to_set = to_set;  // Will be casted to enum Setattrs at the end.
-  boost::mutex::scoped_lock lock(mutex_);
+  Shard& shard = GetShard(path);
+  boost::mutex::scoped_lock lock(shard.mutex);
 
-  by_map& index = cache_.get<IndexMap>();
+  by_map& index = shard.cache.get<IndexMap>();
   by_map::iterator it_map = index.find(path);
   if (it_map != index.end()) {
     MetadataCacheEntry* cache_entry = *it_map;
@@ -489,9 +610,10 @@ void MetadataCache::UpdateStatFromOSDWriteResponse(
     return;
   }
 
-  boost::mutex::scoped_lock lock(mutex_);
+  Shard& shard = GetShard(path);
+  boost::mutex::scoped_lock lock(shard.mutex);
 
-  by_map& index = cache_.get<IndexMap>();
+  by_map& index = shard.cache.get<IndexMap>();
   by_map::iterator it_map = index.find(path);
   if (it_map != index.end()) {
     MetadataCacheEntry* cache_entry = *it_map;
@@ -512,9 +634,10 @@ void MetadataCache::InvalidateStat(const std::string& path) {
     return;
   }
 
-  boost::mutex::scoped_lock lock(mutex_);
+  Shard& shard = GetShard(path);
+  boost::mutex::scoped_lock lock(shard.mutex);
 
-  by_hash& index = cache_.get<IndexHash>();
+  by_hash& index = shard.cache.get<IndexHash>();
   by_hash::iterator it_hash = index.find(path);
   if (it_hash != index.end()) {
     delete (*it_hash)->stat;
@@ -526,9 +649,10 @@ xtreemfs::pbrpc::DirectoryEntries* MetadataCache::GetDirEntries(
     const std::string& path,
     uint64_t offset,
     uint32_t count) {
-  boost::mutex::scoped_lock lock(mutex_);
+  Shard& shard = GetShard(path);
+  boost::mutex::scoped_lock lock(shard.mutex);
 
-  by_hash& index = cache_.get<IndexHash>();
+  by_hash& index = shard.cache.get<IndexHash>();
   by_hash::iterator it_hash = index.find(path);
   if (it_hash != index.end()) {
     // Entry found for path, check timeout of DirectoryEntries value.
@@ -545,7 +669,7 @@ xtreemfs::pbrpc::DirectoryEntries* MetadataCache::GetDirEntries(
           if (Logging::log->loggingActive(LEVEL_DEBUG)) {
             Logging::log->getLog(LEVEL_DEBUG)
               << "MetadataCache GetDirEntries hit: " << path << " ["
-              << cache_.size() << "]" << endl;
+              << shard.cache.size() << "]" << endl;
           }
           result->CopyFrom(*cached_dentries);
         } else {
@@ -553,7 +677,7 @@ xtreemfs::pbrpc::DirectoryEntries* MetadataCache::GetDirEntries(
           if (Logging::log->loggingActive(LEVEL_DEBUG)) {
             Logging::log->getLog(LEVEL_DEBUG)
               << "MetadataCache GetDirEntries hit (partial copy): " << path
-              << " [" << cache_.size() << "] offset: " << offset
+              << " [" << shard.cache.size() << "] offset: " << offset
               << " count: " << count << endl;
           }
           // TODO(mberlin): Clearly, this is wrong. The current specification
@@ -586,7 +710,7 @@ xtreemfs::pbrpc::DirectoryEntries* MetadataCache::GetDirEntries(
   if (Logging::log->loggingActive(LEVEL_DEBUG)) {
     Logging::log->getLog(LEVEL_DEBUG)
       << "MetadataCache GetDirEntries miss: " << path << " ["
-      << cache_.size() << "]" << endl;
+      << shard.cache.size() << "]" << endl;
   }
 
   return NULL;
@@ -599,11 +723,12 @@ void MetadataCache::UpdateDirEntries(
     return;
   }
 
-  boost::mutex::scoped_lock lock(mutex_);
+  Shard& shard = GetShard(path);
+  boost::mutex::scoped_lock lock(shard.mutex);
 
   MetadataCacheEntry* cache_entry = NULL;
   // Check if there's already an Entry for path.
-  by_map& index = cache_.get<IndexMap>();
+  by_map& index = shard.cache.get<IndexMap>();
   by_map::iterator it_map = index.find(path);
   if (it_map != index.end()) {
     cache_entry = *it_map;
@@ -623,6 +748,7 @@ void MetadataCache::UpdateDirEntries(
   }
   cache_entry->dir_entries->CopyFrom(dir_entries);
   cache_entry->dir_entries_timeout_s = time(NULL) + ttl_s_;
+  UpdateDirNamesUnmutexed(cache_entry, dir_entries);
   cache_entry->timeout_s = cache_entry->dir_entries_timeout_s;
 
   if (it_map != index.end()) {
@@ -630,22 +756,88 @@ void MetadataCache::UpdateDirEntries(
     it_map = index.erase(it_map);
     index.insert(it_map, cache_entry);
   } else {
-    EvictUnmutexed(1);
+    EvictUnmutexed(&shard, 1);
     index.insert(cache_entry);
   }
 }
 
+void MetadataCache::UpdateDirNames(
+    const std::string& path,
+    const xtreemfs::pbrpc::DirectoryEntries& dir_entries) {
+  if (path.empty() || !enabled) {
+    return;
+  }
+
+  Shard& shard = GetShard(path);
+  boost::mutex::scoped_lock lock(shard.mutex);
+
+  MetadataCacheEntry* cache_entry = NULL;
+  // Check if there's already an Entry for path.
+  by_map& index = shard.cache.get<IndexMap>();
+  by_map::iterator it_map = index.find(path);
+  if (it_map != index.end()) {
+    cache_entry = *it_map;
+  } else {
+    if (Logging::log->loggingActive(LEVEL_DEBUG)) {
+      Logging::log->getLog(LEVEL_DEBUG)
+         << "MetadataCache UpdateDirNames: new CacheEntry " << path << endl;
+    }
+
+    cache_entry = new MetadataCacheEntry();
+    cache_entry->path = path;
+  }
+
+  UpdateDirNamesUnmutexed(cache_entry, dir_entries);
+  cache_entry->timeout_s = cache_entry->dir_names_timeout_s;
+
+  if (it_map != index.end()) {
+    // Replace existing entry.
+    it_map = index.erase(it_map);
+    index.insert(it_map, cache_entry);
+  } else {
+    EvictUnmutexed(&shard, 1);
+    index.insert(cache_entry);
+  }
+}
+
+void MetadataCache::UpdateDirNamesUnmutexed(
+    MetadataCacheEntry* cache_entry,
+    const xtreemfs::pbrpc::DirectoryEntries& dir_entries) {
+  if (cache_entry->dir_names == NULL) {
+    cache_entry->dir_names = new vector<string>;
+  }
+  vector<string>* names = cache_entry->dir_names;
+  names->clear();
+  names->reserve(dir_entries.entries_size());
+  for (int i = 0; i < dir_entries.entries_size(); i++) {
+    names->push_back(dir_entries.entries(i).name());
+  }
+  // Sorted for the binary search in GetStat().
+  sort(names->begin(), names->end());
+  cache_entry->dir_names_timeout_s = time(NULL) + ttl_s_;
+}
+
 void MetadataCache::InvalidateDirEntry(const std::string& path_to_directory,
                                        const std::string& entry_name) {
   if (path_to_directory.empty() || entry_name.empty() || !enabled) {
     return;
   }
 
-  boost::mutex::scoped_lock lock(mutex_);
+  Shard& shard = GetShard(path_to_directory);
+  boost::mutex::scoped_lock lock(shard.mutex);
 
-  by_hash& index = cache_.get<IndexHash>();
+  by_hash& index = shard.cache.get<IndexHash>();
   by_hash::iterator it_hash = index.find(path_to_directory);
   if (it_hash != index.end()) {
+    vector<string>* cached_names = (*it_hash)->dir_names;
+    if (cached_names != NULL) {
+      vector<string>::iterator name = lower_bound(
+          cached_names->begin(), cached_names->end(), entry_name);
+      if (name != cached_names->end() && *name == entry_name) {
+        cached_names->erase(name);
+      }
+    }
+
     DirectoryEntries* cached_dentries = (*it_hash)->dir_entries;
     if (cached_dentries == NULL) {
       return;
@@ -668,23 +860,27 @@ void MetadataCache::InvalidateDirEntries(const std::string& path) {
     return;
   }
 
-  boost::mutex::scoped_lock lock(mutex_);
+  Shard& shard = GetShard(path);
+  boost::mutex::scoped_lock lock(shard.mutex);
 
-  by_hash& index = cache_.get<IndexHash>();
+  by_hash& index = shard.cache.get<IndexHash>();
   by_hash::iterator it_hash = index.find(path);
   if (it_hash != index.end()) {
     delete (*it_hash)->dir_entries;
     (*it_hash)->dir_entries = NULL;
+    delete (*it_hash)->dir_names;
+    (*it_hash)->dir_names = NULL;
   }
 }
 
 bool MetadataCache::GetXAttr(const std::string& path, const std::string& name,
                              std::string* value, bool* xattrs_cached) {
   assert(xattrs_cached != NULL);
-  boost::mutex::scoped_lock lock(mutex_);
+  Shard& shard = GetShard(path);
+  boost::mutex::scoped_lock lock(shard.mutex);
 
   *xattrs_cached = false;
-  by_hash& index = cache_.get<IndexHash>();
+  by_hash& index = shard.cache.get<IndexHash>();
   by_hash::iterator it_hash = index.find(path);
   if (it_hash != index.end()) {
     // Entry found for path, check timeout of listxattrResponse value.
@@ -700,7 +896,7 @@ bool MetadataCache::GetXAttr(const std::string& path, const std::string& name,
             if (Logging::log->loggingActive(LEVEL_DEBUG)) {
               Logging::log->getLog(LEVEL_DEBUG)
                 << "MetadataCache GetXAttr hit: " << path << " ["
-                << cache_.size() << "]" << endl;
+                << shard.cache.size() << "]" << endl;
             }
             *value = cached_xattrs->xattrs(i).value();
             break;
@@ -726,7 +922,7 @@ bool MetadataCache::GetXAttr(const std::string& path, const std::string& name,
   if (Logging::log->loggingActive(LEVEL_DEBUG)) {
     Logging::log->getLog(LEVEL_DEBUG)
       << "MetadataCache GetXAttr miss: " << path << " ["
-      << cache_.size() << "]" << endl;
+      << shard.cache.size() << "]" << endl;
   }
 
   return false;
@@ -737,10 +933,11 @@ bool MetadataCache::GetXAttrSize(const std::string& path,
                                  int* size,
                                  bool* xattrs_cached) {
   assert(xattrs_cached != NULL);
-  boost::mutex::scoped_lock lock(mutex_);
+  Shard& shard = GetShard(path);
+  boost::mutex::scoped_lock lock(shard.mutex);
 
   *xattrs_cached = false;
-  by_hash& index = cache_.get<IndexHash>();
+  by_hash& index = shard.cache.get<IndexHash>();
   by_hash::iterator it_hash = index.find(path);
   if (it_hash != index.end()) {
     // Entry found for path, check timeout of listxattrResponse value.
@@ -756,7 +953,7 @@ bool MetadataCache::GetXAttrSize(const std::string& path,
             if (Logging::log->loggingActive(LEVEL_DEBUG)) {
               Logging::log->getLog(LEVEL_DEBUG)
                 << "MetadataCache GetXAttrSize hit: " << path << " ["
-                << cache_.size() << "]" << endl;
+                << shard.cache.size() << "]" << endl;
             }
             *size = cached_xattrs->xattrs(i).value().size();
             return true;
@@ -782,7 +979,7 @@ bool MetadataCache::GetXAttrSize(const std::string& path,
   if (Logging::log->loggingActive(LEVEL_DEBUG)) {
     Logging::log->getLog(LEVEL_DEBUG)
       << "MetadataCache GetXAttrSize miss: " << path << " ["
-      << cache_.size() << "]" << endl;
+      << shard.cache.size() << "]" << endl;
   }
 
   return false;
@@ -790,9 +987,10 @@ bool MetadataCache::GetXAttrSize(const std::string& path,
 
 xtreemfs::pbrpc::listxattrResponse* MetadataCache::GetXAttrs(
     const std::string& path) {
-  boost::mutex::scoped_lock lock(mutex_);
+  Shard& shard = GetShard(path);
+  boost::mutex::scoped_lock lock(shard.mutex);
 
-  by_hash& index = cache_.get<IndexHash>();
+  by_hash& index = shard.cache.get<IndexHash>();
   by_hash::iterator it_hash = index.find(path);
   if (it_hash != index.end()) {
     // Entry found for path, check timeout of listxattrResponse value.
@@ -804,7 +1002,7 @@ xtreemfs::pbrpc::listxattrResponse* MetadataCache::GetXAttrs(
         if (Logging::log->loggingActive(LEVEL_DEBUG)) {
           Logging::log->getLog(LEVEL_DEBUG)
             << "MetadataCache GetXAttrs hit: " << path << " ["
-            << cache_.size() << "]" << endl;
+            << shard.cache.size() << "]" << endl;
         }
 
         listxattrResponse* result = new listxattrResponse(*cache_entry->xattrs);
@@ -828,7 +1026,7 @@ xtreemfs::pbrpc::listxattrResponse* MetadataCache::GetXAttrs(
   if (Logging::log->loggingActive(LEVEL_DEBUG)) {
     Logging::log->getLog(LEVEL_DEBUG)
       << "MetadataCache GetXAttrs miss: " << path << " ["
-      << cache_.size() << "]" << endl;
+      << shard.cache.size() << "]" << endl;
   }
 
   return NULL;
@@ -842,11 +1040,12 @@ void MetadataCache::UpdateXAttr(
     return;
   }
 
-  boost::mutex::scoped_lock lock(mutex_);
+  Shard& shard = GetShard(path);
+  boost::mutex::scoped_lock lock(shard.mutex);
 
   MetadataCacheEntry* cache_entry = NULL;
   // Check if there's already an Entry for path.
-  by_map& index = cache_.get<IndexMap>();
+  by_map& index = shard.cache.get<IndexMap>();
   by_map::iterator it_map = index.find(path);
   if (it_map != index.end()) {
     cache_entry = *it_map;
@@ -894,11 +1093,12 @@ void MetadataCache::UpdateXAttrs(
     return;
   }
 
-  boost::mutex::scoped_lock lock(mutex_);
+  Shard& shard = GetShard(path);
+  boost::mutex::scoped_lock lock(shard.mutex);
 
   MetadataCacheEntry* cache_entry = NULL;
   // Check if there's already an Entry for path.
-  by_map& index = cache_.get<IndexMap>();
+  by_map& index = shard.cache.get<IndexMap>();
   by_map::iterator it_map = index.find(path);
   if (it_map != index.end()) {
     cache_entry = *it_map;
@@ -925,7 +1125,7 @@ void MetadataCache::UpdateXAttrs(
     it_map = index.erase(it_map);
     index.insert(it_map, cache_entry);
   } else {
-    EvictUnmutexed(1);
+    EvictUnmutexed(&shard, 1);
     index.insert(cache_entry);
   }
 }
@@ -936,11 +1136,12 @@ void MetadataCache::InvalidateXAttr(const std::string& path,
     return;
   }
 
-  boost::mutex::scoped_lock lock(mutex_);
+  Shard& shard = GetShard(path);
+  boost::mutex::scoped_lock lock(shard.mutex);
 
   MetadataCacheEntry* cache_entry = NULL;
   // Check if there's already an Entry for path.
-  by_map& index = cache_.get<IndexMap>();
+  by_map& index = shard.cache.get<IndexMap>();
   by_map::iterator it_map = index.find(path);
   if (it_map != index.end()) {
     cache_entry = *it_map;
@@ -974,9 +1175,10 @@ void MetadataCache::InvalidateXAttrs(const std::string& path) {
     return;
   }
 
-  boost::mutex::scoped_lock lock(mutex_);
+  Shard& shard = GetShard(path);
+  boost::mutex::scoped_lock lock(shard.mutex);
 
-  by_hash& index = cache_.get<IndexHash>();
+  by_hash& index = shard.cache.get<IndexHash>();
   by_hash::iterator it_hash = index.find(path);
   if (it_hash != index.end()) {
     delete (*it_hash)->xattrs;
@@ -985,23 +1187,28 @@ void MetadataCache::InvalidateXAttrs(const std::string& path) {
 }
 
 uint64_t MetadataCache::Size() {
-  boost::mutex::scoped_lock lock(mutex_);
-  return cache_.size();
+  uint64_t size = 0;
+  for (int i = 0; i < shard_count_; ++i) {
+    boost::mutex::scoped_lock lock(shards_[i].mutex);
+    size += shards_[i].cache.size();
+  }
+  return size;
 }
 
-void MetadataCache::EvictUnmutexed(int n) {
-  // Evict one entry from cache if it's full.
-  while (cache_.size() > size_ - n) {
+void MetadataCache::EvictUnmutexed(Shard* shard, int n) {
+  // Evict one entry from the shard if it's full.
+  while (shard->cache.size() > shard_size_ - n) {
     // remove cache entry
     if (Logging::log->loggingActive(LEVEL_DEBUG)) {
       Logging::log->getLog(LEVEL_DEBUG)
           << "MetadataCache EvictUnmutexed: Deleting at least " << n
-          << " entries from " << cache_.size() << " entries in total." << endl;
+          << " entries from " << shard->cache.size() << " entries in the shard."
+          << endl;
     }
-    by_list& index = cache_.get<IndexList>();
+    by_list& index = shard->cache.get<IndexList>();
     by_list::iterator it_list = index.begin();
     delete *it_list;
-    cache_.erase(it_list);
+    shard->cache.erase(it_list);
   }
 }
 
@@ -11,10 +11,20 @@
 namespace xtreemfs {
 
 MetadataCacheEntry::MetadataCacheEntry()
-    : dir_entries(NULL), stat(NULL), xattrs(NULL) {}
+    : dir_entries(NULL),
+      dir_entries_timeout_s(0),
+      dir_names(NULL),
+      dir_names_timeout_s(0),
+      stat(NULL),
+      stat_timeout_s(0),
+      xattrs(NULL),
+      xattrs_timeout_s(0),
+      nonexistent_timeout_s(0),
+      timeout_s(0) {}
 
 MetadataCacheEntry::~MetadataCacheEntry() {
   delete dir_entries;
+  delete dir_names;
   delete stat;
   delete xattrs;
 }
@@ -0,0 +1,256 @@
+/*
+ * Copyright (c) 2015 by Zuse Institute Berlin
+ *
+ * Licensed under the BSD License, see LICENSE file for details.
+ *
+ */
+
+#include "libxtreemfs/mrc_request_batcher.h"
+
+#include <boost/lexical_cast.hpp>
+#include <boost/scoped_array.hpp>
+#include <boost/scoped_ptr.hpp>
+#include <algorithm>
+#include <cassert>
+#include <string>
+
+#include "libxtreemfs/file_handle_implementation.h"
+#include "libxtreemfs/uuid_iterator.h"
+#include "libxtreemfs/uuid_resolver.h"
+#include "libxtreemfs/xtreemfs_exception.h"
+#include "util/error_log.h"
+#include "util/logging.h"
+#include "xtreemfs/MRCServiceClient.h"
+
+using namespace std;
+using namespace xtreemfs::pbrpc;
+using namespace xtreemfs::util;
+
+namespace xtreemfs {
+
+MRCRequestBatcher::MRCRequestBatcher(
+    pbrpc::MRCServiceClient* mrc_service_client,
+    UUIDResolver* uuid_resolver,
+    UUIDIterator* mrc_uuid_iterator,
+    const pbrpc::Auth& auth_bogus,
+    const pbrpc::UserCredentials& user_credentials_bogus,
+    int max_batch_size)
+    : mrc_service_client_(mrc_service_client),
+      uuid_resolver_(uuid_resolver),
+      mrc_uuid_iterator_(mrc_uuid_iterator),
+      auth_bogus_(auth_bogus),
+      user_credentials_bogus_(user_credentials_bogus),
+      max_batch_size_(max_batch_size),
+      batching_supported_(max_batch_size > 0) {}
+
+bool MRCRequestBatcher::batching_supported() {
+  boost::mutex::scoped_lock lock(mutex_);
+  return batching_supported_;
+}
+
+void MRCRequestBatcher::GetMRCAddress(const RPCOptions& options,
+                                      std::string* mrc_address) {
+  string mrc_uuid;
+  mrc_uuid_iterator_->GetUUID(&mrc_uuid);
+  uuid_resolver_->UUIDToAddressWithOptions(mrc_uuid, mrc_address, options);
+}
+
+void MRCRequestBatcher::SendXCapRenewals(const XCapRenewals& renewals,
+                                         const RPCOptions& options) {
+  const int count = static_cast<int>(renewals.xcap_managers.size());
+  assert(count == renewals.request.xcaps_size());
+  if (count == 0) {
+    return;
+  }
+
+  string mrc_address;
+  try {
+    GetMRCAddress(options, &mrc_address);
+  } catch (const XtreemFSException& e) {
+    Logging::log->getLog(LEVEL_WARN)
+        << "Failed to renew the XCaps of " << count << " files: " << e.what()
+        << endl;
+    RPCHeader::ErrorResponse error;
+    error.set_error_type(IO_ERROR);
+    error.set_posix_errno(POSIX_ERROR_EIO);
+    error.set_error_message(e.what());
+    for (int i = 0; i < count; ++i) {
+      renewals.xcap_managers[i]->XCapRenewalFinished(NULL, &error);
+    }
+    return;
+  }
+
+  for (int first = 0; first < count; first += max_batch_size_) {
+    const int last = min(count, first + max_batch_size_);
+    xtreemfs_renew_capabilitiesRequest rq;
+    for (int i = first; i < last; ++i) {
+      rq.add_xcaps()->CopyFrom(renewals.request.xcaps(i));
+    }
+    // The request is serialized immediately, only the context outlives it.
+    mrc_service_client_->xtreemfs_renew_capabilities(
+        mrc_address,
+        auth_bogus_,
+        user_credentials_bogus_,
+        &rq,
+        this,
+        new vector<XCapManager*>(renewals.xcap_managers.begin() + first,
+                                 renewals.xcap_managers.begin() + last));
+  }
+}
+
+void MRCRequestBatcher::SendFileSizeUpdates(const FileSizeUpdates& updates,
+                                            const RPCOptions& options) {
+  const int count = static_cast<int>(updates.file_handles.size());
+  assert(count == updates.request.updates_size());
+  if (count == 0) {
+    return;
+  }
+
+  string mrc_address;
+  try {
+    GetMRCAddress(options, &mrc_address);
+  } catch (const XtreemFSException& e) {
+    Logging::log->getLog(LEVEL_WARN)
+        << "Failed to update the file sizes of " << count << " files: "
+        << e.what() << endl;
+    for (int i = 0; i < count; ++i) {
+      updates.file_handles[i]->FileSizeUpdateFinished(false);
+    }
+    return;
+  }
+
+  for (int first = 0; first < count; first += max_batch_size_) {
+    const int last = min(count, first + max_batch_size_);
+    xtreemfs_update_file_sizesRequest rq;
+    for (int i = first; i < last; ++i) {
+      rq.add_updates()->CopyFrom(updates.request.updates(i));
+    }
+    mrc_service_client_->xtreemfs_update_file_sizes(
+        mrc_address,
+        auth_bogus_,
+        user_credentials_bogus_,
+        &rq,
+        this,
+        new vector<FileHandleImplementation*>(
+            updates.file_handles.begin() + first,
+            updates.file_handles.begin() + last));
+  }
+}
+
+void MRCRequestBatcher::CallFinished(
+    xtreemfs::pbrpc::xtreemfs_renew_capabilitiesResponse* response_message,
+    char* data,
+    uint32_t data_length,
+    xtreemfs::pbrpc::RPCHeader::ErrorResponse* error,
+    void* context) {
+  boost::scoped_ptr<xtreemfs_renew_capabilitiesResponse> response(
+      response_message);
+  boost::scoped_ptr<RPCHeader::ErrorResponse> autodelete_error(error);
+  boost::scoped_array<char> autodelete_data(data);
+  boost::scoped_ptr<vector<XCapManager*> > xcap_managers(
+      static_cast<vector<XCapManager*>*>(context));
+
+  const RPCHeader::ErrorResponse* batch_error = NULL;
+  if (error != NULL) {
+    HandleBatchError("xtreemfs_renew_capabilities", *error);
+    // An unknown operation is renewed with one request per file next time.
+    if (error->error_type() != INVALID_PROC_ID) {
+      batch_error = error;
+    }
+  }
+
+  // The errors of the XCaps which the MRC did not renew, by position.
+  const int count = static_cast<int>(xcap_managers->size());
+  boost::scoped_array<RPCHeader::ErrorResponse> xcap_errors(
+      new RPCHeader::ErrorResponse[count]);
+  vector<bool> failed(count, false);
+  if (error == NULL) {
+    for (int k = 0; k < response->errors_size(); ++k) {
+      const xtreemfs_renew_capabilitiesError& xcap_error = response->errors(k);
+      const int i = static_cast<int>(xcap_error.index());
+      if (i < 0 || i >= count) {
+        continue;
+      }
+      failed[i] = true;
+      xcap_errors[i].set_error_type(
+          ErrorType_IsValid(xcap_error.error_type())
+              ? static_cast<ErrorType>(xcap_error.error_type())
+              : INTERNAL_SERVER_ERROR);
+      if (POSIXErrno_IsValid(xcap_error.posix_errno())) {
+        xcap_errors[i].set_posix_errno(
+            static_cast<POSIXErrno>(xcap_error.posix_errno()));
+      }
+      xcap_errors[i].set_error_message(xcap_error.error_message());
+    }
+  }
+
+  for (int i = 0; i < count; ++i) {
+    const XCap* new_xcap = NULL;
+    const RPCHeader::ErrorResponse* xcap_error = batch_error;
+    if (failed[i]) {
+      xcap_error = &xcap_errors[i];
+    } else if (error == NULL && i < response->xcaps_size()) {
+      new_xcap = &response->xcaps(i);
+    }
+    (*xcap_managers)[i]->XCapRenewalFinished(new_xcap, xcap_error);
+  }
+}
+
+void MRCRequestBatcher::CallFinished(
+    xtreemfs::pbrpc::xtreemfs_update_file_sizesResponse* response_message,
+    char* data,
+    uint32_t data_length,
+    xtreemfs::pbrpc::RPCHeader::ErrorResponse* error,
+    void* context) {
+  boost::scoped_ptr<xtreemfs_update_file_sizesResponse> response(
+      response_message);
+  boost::scoped_ptr<RPCHeader::ErrorResponse> autodelete_error(error);
+  boost::scoped_array<char> autodelete_data(data);
+  boost::scoped_ptr<vector<FileHandleImplementation*> > file_handles(
+      static_cast<vector<FileHandleImplementation*>*>(context));
+
+  if (error != NULL) {
+    HandleBatchError("xtreemfs_update_file_sizes", *error);
+  }
+  int rejected = 0;
+  for (size_t i = 0; i < file_handles->size(); ++i) {
+    const bool accepted = error == NULL
+        && static_cast<int>(i) < response->accepted_size()
+        && response->accepted(i);
+    if (error == NULL && !accepted) {
+      ++rejected;
+    }
+    // Deletes the temporary FileHandle.
+    (*file_handles)[i]->FileSizeUpdateFinished(accepted);
+  }
+
+  if (rejected > 0) {
+    string error_msg = "The MRC rejected " + boost::lexical_cast<string>(
+        rejected) + " of " + boost::lexical_cast<string>(file_handles->size())
+        + " async filesize updates.";
+    Logging::log->getLog(LEVEL_WARN) << error_msg << endl;
+    ErrorLog::error_log->AppendError(error_msg);
+  }
+}
+
+void MRCRequestBatcher::HandleBatchError(
+    const char* operation,
+    const xtreemfs::pbrpc::RPCHeader::ErrorResponse& error) {
+  if (error.error_type() == INVALID_PROC_ID) {
+    if (Logging::log->loggingActive(LEVEL_INFO)) {
+      Logging::log->getLog(LEVEL_INFO)
+          << "The MRC does not support " << operation << ", XCaps and file"
+             " sizes are sent with one request per file." << endl;
+    }
+    boost::mutex::scoped_lock lock(mutex_);
+    batching_supported_ = false;
+    return;
+  }
+
+  string error_msg = string("Batched ") + operation + " failed. Error: "
+      + error.DebugString();
+  Logging::log->getLog(LEVEL_WARN) << error_msg << endl;
+  ErrorLog::error_log->AppendError(error_msg);
+}
+
+}  // namespace xtreemfs
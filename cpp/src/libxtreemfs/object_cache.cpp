@@ -0,0 +1,540 @@
+/*
+ * Copyright (c) 2013 by Felix Hupfeld.
+ *
+ * Licensed under the BSD License, see LICENSE file for details.
+ *
+ */
+
+#include "libxtreemfs/object_cache.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <utility>
+#include <vector>
+
+#include "util/metrics.h"
+
+namespace xtreemfs {
+
+namespace {
+
+util::Counter* const cache_hits_counter =
+    util::MetricsRegistry::instance()->GetCounter("object_cache_hits");
+util::Counter* const cache_misses_counter =
+    util::MetricsRegistry::instance()->GetCounter("object_cache_misses");
+
+}  // anonymous namespace
+
+/** Returns a strictly increasing access counter, used for the LRU policy.
+ *  Unlike a clock, it orders accesses which happen at the same time. */
+static uint64_t GetAccessTimestamp() {
+  static boost::mutex counter_mutex;
+  static uint64_t counter = 0;
+  boost::mutex::scoped_lock lock(counter_mutex);
+  return ++counter;
+}
+
+ObjectCacheBudget::ObjectCacheBudget(int64_t max_bytes)
+    : used_bytes_(0), max_bytes_(max_bytes) {}
+
+bool ObjectCacheBudget::TryReserve(int bytes) {
+  boost::mutex::scoped_lock lock(mutex_);
+  if (used_bytes_ + bytes > max_bytes_) {
+    return false;
+  }
+  used_bytes_ += bytes;
+  return true;
+}
+
+void ObjectCacheBudget::Reserve(int bytes) {
+  boost::mutex::scoped_lock lock(mutex_);
+  used_bytes_ += bytes;
+}
+
+void ObjectCacheBudget::Release(int bytes) {
+  boost::mutex::scoped_lock lock(mutex_);
+  used_bytes_ -= bytes;
+  assert(used_bytes_ >= 0);
+}
+
+int64_t ObjectCacheBudget::used_bytes() {
+  boost::mutex::scoped_lock lock(mutex_);
+  return used_bytes_;
+}
+
+int64_t ObjectCacheBudget::max_bytes() const {
+  return max_bytes_;
+}
+
+CachedObject::CachedObject(int object_no, int object_size)
+    : object_no_(object_no),
+      object_size_(object_size),
+      actual_size_(-1),
+      is_dirty_(false),
+      last_access_(GetAccessTimestamp()),
+      loading_(false),
+      flushing_(false),
+      size_after_load_(-1) {}
+
+CachedObject::~CachedObject() {}
+
+void CachedObject::Drop() {
+  boost::mutex::scoped_lock lock(mutex_);
+  DropLocked();
+}
+
+void CachedObject::DropLocked() {
+  data_.reset(NULL);
+  actual_size_ = -1;
+  is_dirty_ = false;
+}
+
+void CachedObject::Fill(const char* data, int size) {
+  assert(size >= 0 && size <= object_size_);
+  boost::mutex::scoped_lock lock(mutex_);
+  if (data_.get() != NULL || loading_) {
+    return;
+  }
+  data_.reset(new char[object_size_]);
+  memcpy(data_.get(), data, size);
+  memset(data_.get() + size, 0, object_size_ - size);
+  actual_size_ = size;
+  last_access_ = GetAccessTimestamp();
+}
+
+int CachedObject::Read(int offset_in_object,
+                       char* buffer,
+                       int bytes_to_read,
+                       const ObjectReaderFunction& reader) {
+  assert(offset_in_object >= 0);
+  assert(offset_in_object + bytes_to_read <= object_size_);
+  boost::mutex::scoped_lock lock(mutex_);
+  if (data_.get() != NULL) {
+    cache_hits_counter->Increment();
+  } else {
+    cache_misses_counter->Increment();
+  }
+  ReadInternal(reader, &lock);
+  last_access_ = GetAccessTimestamp();
+
+  const int bytes_available = std::max(0, actual_size_ - offset_in_object);
+  const int bytes_read = std::min(bytes_available, bytes_to_read);
+  memcpy(buffer, data_.get() + offset_in_object, bytes_read);
+  return bytes_read;
+}
+
+void CachedObject::Write(int offset_in_object,
+                         const char* buffer,
+                         int bytes_to_write,
+                         const ObjectReaderFunction& reader) {
+  assert(offset_in_object >= 0);
+  assert(offset_in_object + bytes_to_write <= object_size_);
+  boost::mutex::scoped_lock lock(mutex_);
+  if (offset_in_object == 0 && bytes_to_write == object_size_) {
+    // The object is overwritten completely, there is no need to fetch it.
+    // A load in progress does not replace the data once it finishes.
+    if (data_.get() == NULL) {
+      data_.reset(new char[object_size_]);
+    }
+    actual_size_ = object_size_;
+  } else {
+    ReadInternal(reader, &lock);
+  }
+  last_access_ = GetAccessTimestamp();
+
+  memcpy(data_.get() + offset_in_object, buffer, bytes_to_write);
+  // A gap between actual_size_ and offset_in_object is already zeroed.
+  actual_size_ = std::max(actual_size_, offset_in_object + bytes_to_write);
+  is_dirty_ = true;
+}
+
+void CachedObject::Flush(const ObjectWriterFunction& writer) {
+  boost::mutex::scoped_lock lock(mutex_);
+  // Flushes of the same object must not overtake each other.
+  while (flushing_) {
+    io_finished_.wait(lock);
+  }
+  if (!is_dirty_) {
+    return;
+  }
+  assert(data_.get() != NULL);
+  is_dirty_ = false;
+  if (actual_size_ <= 0) {
+    return;
+  }
+
+  // Writes during the flush modify data_ and mark the object dirty again.
+  const int size = actual_size_;
+  boost::scoped_array<char> data(new char[size]);
+  memcpy(data.get(), data_.get(), size);
+  flushing_ = true;
+  lock.unlock();
+  try {
+    writer(object_no_, data.get(), size);
+  } catch (...) {
+    lock.lock();
+    // The object remains dirty unless it was dropped meanwhile.
+    is_dirty_ = data_.get() != NULL;
+    flushing_ = false;
+    io_finished_.notify_all();
+    throw;
+  }
+  lock.lock();
+  flushing_ = false;
+  io_finished_.notify_all();
+}
+
+void CachedObject::Truncate(int new_object_size) {
+  assert(new_object_size >= 0 && new_object_size <= object_size_);
+  boost::mutex::scoped_lock lock(mutex_);
+  if (loading_ && data_.get() == NULL) {
+    // The data being loaded has the old size.
+    size_after_load_ = new_object_size;
+    return;
+  }
+  TruncateLocked(new_object_size);
+}
+
+void CachedObject::TruncateLocked(int new_object_size) {
+  if (data_.get() == NULL) {
+    return;
+  }
+  if (new_object_size < actual_size_) {
+    // Keep the bytes behind actual_size_ zeroed.
+    memset(data_.get() + new_object_size, 0, actual_size_ - new_object_size);
+  }
+  actual_size_ = new_object_size;
+}
+
+uint64_t CachedObject::last_access() {
+  boost::mutex::scoped_lock lock(mutex_);
+  return last_access_;
+}
+
+bool CachedObject::is_dirty() {
+  boost::mutex::scoped_lock lock(mutex_);
+  return is_dirty_;
+}
+
+bool CachedObject::has_data() {
+  boost::mutex::scoped_lock lock(mutex_);
+  return data_.get() != NULL;
+}
+
+bool CachedObject::is_complete() {
+  boost::mutex::scoped_lock lock(mutex_);
+  return actual_size_ == object_size_;
+}
+
+int CachedObject::actual_size() {
+  boost::mutex::scoped_lock lock(mutex_);
+  return actual_size_;
+}
+
+void CachedObject::ReadInternal(const ObjectReaderFunction& reader,
+                                boost::mutex::scoped_lock* lock) {
+  while (data_.get() == NULL) {
+    if (loading_) {
+      // Wait for the other load, or load the object if it failed.
+      io_finished_.wait(*lock);
+      continue;
+    }
+
+    boost::scoped_array<char> data(new char[object_size_]);
+    loading_ = true;
+    size_after_load_ = -1;
+    lock->unlock();
+    int received = 0;
+    try {
+      received = reader(object_no_, data.get());
+    } catch (...) {
+      // The object remains without data.
+      lock->lock();
+      loading_ = false;
+      io_finished_.notify_all();
+      throw;
+    }
+    lock->lock();
+    loading_ = false;
+    io_finished_.notify_all();
+
+    assert(received >= 0 && received <= object_size_);
+    // A complete overwrite during the load takes precedence.
+    if (data_.get() == NULL) {
+      memset(data.get() + received, 0, object_size_ - received);
+      data_.swap(data);
+      actual_size_ = received;
+      if (size_after_load_ >= 0) {
+        TruncateLocked(size_after_load_);
+      }
+    }
+  }
+}
+
+ObjectCache::ObjectCache(size_t max_objects,
+                         int object_size,
+                         ObjectCacheBudget* budget)
+    : reserved_objects_(0),
+      max_objects_(std::max(max_objects, static_cast<size_t>(1))),
+      object_size_(object_size),
+      budget_(budget) {}
+
+ObjectCache::~ObjectCache() {
+  // Dirty objects have to be flushed before, e.g. by closing the file.
+  while (!cache_.empty()) {
+    cache_.begin()->second.object->Drop();
+    EraseObject(cache_.begin());
+  }
+}
+
+int ObjectCache::Read(int object_no, int offset_in_object,
+                      char* buffer, int bytes_to_read,
+                      const ObjectReaderFunction& reader,
+                      const ObjectWriterFunction& writer) {
+  boost::shared_ptr<CachedObject> object = AcquireObject(object_no, writer);
+  const int bytes_read =
+      object->Read(offset_in_object, buffer, bytes_to_read, reader);
+  FinishOperation(object_no, object, writer);
+  return bytes_read;
+}
+
+void ObjectCache::Write(int object_no, int offset_in_object,
+                        const char* buffer, int bytes_to_write,
+                        const ObjectReaderFunction& reader,
+                        const ObjectWriterFunction& writer) {
+  boost::shared_ptr<CachedObject> object = AcquireObject(object_no, writer);
+  object->Write(offset_in_object, buffer, bytes_to_write, reader);
+
+  // Cached objects in front of the written one are no longer the last object
+  // of the file, i.e. they are complete now. Stop at the first complete one as
+  // all objects in front of it were completed before.
+  std::vector<boost::shared_ptr<CachedObject> > incomplete_objects;
+  {
+    boost::mutex::scoped_lock lock(mutex_);
+    for (Cache::reverse_iterator it(cache_.find(object_no));
+         it != cache_.rend();
+         ++it) {
+      if (it->second.object->is_complete()) {
+        break;
+      }
+      incomplete_objects.push_back(it->second.object);
+    }
+  }
+  for (size_t i = 0; i < incomplete_objects.size(); ++i) {
+    incomplete_objects[i]->Truncate(object_size_);
+  }
+
+  FinishOperation(object_no, object, writer);
+}
+
+void ObjectCache::Insert(int object_no, const char* data, int size,
+                         const ObjectWriterFunction& writer) {
+  boost::shared_ptr<CachedObject> object = AcquireObject(object_no, writer);
+  object->Fill(data, size);
+  FinishOperation(object_no, object, writer);
+}
+
+bool ObjectCache::Contains(int object_no) {
+  boost::mutex::scoped_lock lock(mutex_);
+  return cache_.find(object_no) != cache_.end();
+}
+
+void ObjectCache::Flush(const ObjectWriterFunction& writer) {
+  std::vector<boost::shared_ptr<CachedObject> > objects;
+  {
+    boost::mutex::scoped_lock lock(mutex_);
+    for (Cache::iterator it = cache_.begin(); it != cache_.end(); ++it) {
+      objects.push_back(it->second.object);
+    }
+  }
+  for (size_t i = 0; i < objects.size(); ++i) {
+    objects[i]->Flush(writer);
+  }
+}
+
+void ObjectCache::Truncate(int64_t new_size) {
+  std::vector<boost::shared_ptr<CachedObject> > dropped_objects;
+  std::vector<std::pair<boost::shared_ptr<CachedObject>, int> >
+      truncated_objects;
+  {
+    boost::mutex::scoped_lock lock(mutex_);
+    Cache::iterator it = cache_.begin();
+    while (it != cache_.end()) {
+      const int64_t object_offset = it->first * object_size_;
+      if (object_offset >= new_size) {
+        dropped_objects.push_back(it->second.object);
+        EraseObject(it++);
+      } else {
+        truncated_objects.push_back(std::make_pair(
+            it->second.object,
+            static_cast<int>(std::min(new_size - object_offset,
+                                      static_cast<int64_t>(object_size_)))));
+        ++it;
+      }
+    }
+  }
+  for (size_t i = 0; i < dropped_objects.size(); ++i) {
+    dropped_objects[i]->Drop();
+  }
+  for (size_t i = 0; i < truncated_objects.size(); ++i) {
+    truncated_objects[i].first->Truncate(truncated_objects[i].second);
+  }
+}
+
+int64_t ObjectCache::GetDirtyFileSize() {
+  boost::mutex::scoped_lock lock(mutex_);
+  for (Cache::reverse_iterator it = cache_.rbegin();
+       it != cache_.rend();
+       ++it) {
+    if (it->second.object->is_dirty()) {
+      return it->first * object_size_ + it->second.object->actual_size();
+    }
+  }
+  return 0;
+}
+
+int ObjectCache::object_size() const {
+  return object_size_;
+}
+
+boost::shared_ptr<CachedObject> ObjectCache::AcquireObject(
+    int object_no,
+    const ObjectWriterFunction& writer) {
+  {
+    boost::mutex::scoped_lock lock(mutex_);
+    Cache::iterator it = cache_.find(object_no);
+    if (it != cache_.end()) {
+      return it->second.object;
+    }
+  }
+
+  const bool reserved = MakeRoom(writer);
+
+  boost::mutex::scoped_lock lock(mutex_);
+  Cache::iterator it = cache_.find(object_no);
+  if (it != cache_.end()) {
+    // Another operation inserted the object meanwhile.
+    if (reserved) {
+      --reserved_objects_;
+      if (budget_ != NULL) {
+        budget_->Release(object_size_);
+      }
+    }
+    return it->second.object;
+  }
+  CacheEntry& entry = cache_[object_no];
+  entry.object.reset(new CachedObject(object_no, object_size_));
+  entry.transient = !reserved;
+  return entry.object;
+}
+
+void ObjectCache::FinishOperation(
+    int object_no,
+    const boost::shared_ptr<CachedObject>& object,
+    const ObjectWriterFunction& writer) {
+  {
+    boost::mutex::scoped_lock lock(mutex_);
+    Cache::iterator it = cache_.find(object_no);
+    if (it == cache_.end() || it->second.object != object ||
+        !it->second.transient) {
+      return;
+    }
+    if (TryReserve()) {
+      it->second.transient = false;
+      return;
+    }
+    if (!IsUnused(it, object)) {
+      // The last operation which uses the object removes it.
+      return;
+    }
+  }
+
+  object->Flush(writer);
+
+  boost::mutex::scoped_lock lock(mutex_);
+  Cache::iterator it = cache_.find(object_no);
+  if (IsUnused(it, object) && !object->is_dirty()) {
+    EraseObject(it);
+  }
+}
+
+bool ObjectCache::MakeRoom(const ObjectWriterFunction& writer) {
+  for (;;) {
+    int64_t victim_no;
+    boost::shared_ptr<CachedObject> victim;
+    {
+      boost::mutex::scoped_lock lock(mutex_);
+      if (TryReserve()) {
+        return true;
+      }
+      Cache::iterator lru = FindEvictableObject();
+      if (lru == cache_.end()) {
+        return false;
+      }
+      if (!lru->second.object->is_dirty()) {
+        EraseObject(lru);
+        continue;
+      }
+      victim_no = lru->first;
+      victim = lru->second.object;
+    }
+
+    // Write back the object without blocking other operations. It is only
+    // removed if it was not used meanwhile.
+    victim->Flush(writer);
+
+    boost::mutex::scoped_lock lock(mutex_);
+    Cache::iterator it = cache_.find(victim_no);
+    if (IsUnused(it, victim) && !victim->is_dirty()) {
+      EraseObject(it);
+    }
+  }
+}
+
+bool ObjectCache::TryReserve() {
+  if (reserved_objects_ >= max_objects_) {
+    return false;
+  }
+  if (budget_ != NULL && !budget_->TryReserve(object_size_)) {
+    return false;
+  }
+  ++reserved_objects_;
+  return true;
+}
+
+ObjectCache::Cache::iterator ObjectCache::FindEvictableObject() {
+  Cache::iterator lru = cache_.end();
+  uint64_t lru_access = 0;
+  for (Cache::iterator it = cache_.begin(); it != cache_.end(); ++it) {
+    // Only the map holds unused objects.
+    if (it->second.object.use_count() > 1) {
+      continue;
+    }
+    const uint64_t last_access = it->second.object->last_access();
+    if (lru == cache_.end() || last_access < lru_access) {
+      lru = it;
+      lru_access = last_access;
+    }
+  }
+  return lru;
+}
+
+bool ObjectCache::IsUnused(Cache::iterator it,
+                           const boost::shared_ptr<CachedObject>& object) {
+  // The map and the caller hold the only references.
+  return it != cache_.end() && it->second.object == object &&
+         object.use_count() == 2;
+}
+
+void ObjectCache::EraseObject(Cache::iterator it) {
+  if (!it->second.transient) {
+    --reserved_objects_;
+    if (budget_ != NULL) {
+      budget_->Release(object_size_);
+    }
+  }
+  cache_.erase(it);
+}
+
+}  // namespace xtreemfs
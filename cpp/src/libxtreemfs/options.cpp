@@ -66,6 +66,8 @@ Options::Options()
   // General options.
   log_level_string = "WARN";
   log_file_path = "";
+  metrics_dump_file = "";
+  metrics_dump_interval_s = 60;
   show_help = false;
   empty_arguments_list = false;
   show_version = false;
@@ -73,10 +75,18 @@ Options::Options()
   // Optimizations.
   metadata_cache_size = 100000;
   metadata_cache_ttl_s = 10;
+  metadata_cache_negative_ttl_s = 5;
   enable_async_writes = false;
   async_writes_max_request_size_kb = 128;  // default object size in kB.
   async_writes_max_requests = 10;  // Only 10 pending requests allowed by default.
+  async_writes_combine_timeout_ms = 50;
   readdir_chunk_size = 1024;
+  readdir_prefetch_depth = 2;
+  max_parallel_reads = 16;
+  object_cache_size_mb = 0;
+  max_read_ahead_objects = 8;
+  read_replica_balancing = false;
+  hedged_read_percentile = 0;
   enable_atime = false;
 
   // Error Handling options.
@@ -103,6 +113,10 @@ Options::Options()
   connect_timeout_s = 15;
   request_timeout_s = 15;
   linger_timeout_s = 600;  // 10 Minutes.
+  rpc_io_threads = 1;
+  max_connections_per_server = 1;
+  shared_rpc_runtime = false;
+  enable_object_checksums = false;
 
 #ifdef HAS_OPENSSL
   // SSL options.
@@ -162,6 +176,7 @@ Options::Options()
   // Advanced XtreemFS options.
   periodic_file_size_updates_interval_s = 60;  // Default: 1 Minute.
   periodic_xcap_renewal_interval_s = 60;  // Default: 1 Minute.
+  periodic_mrc_batch_size = 1024;
   vivaldi_zipf_generator_skew = 0.5;
   xLoc_install_poll_interval_s = 5; // Default: 5 Seconds.
 
@@ -189,6 +204,14 @@ void Options::GenerateProgramOptionsDescriptions() {
     ("log-file-path,l",
         po::value(&log_file_path)->default_value(log_file_path),
         "Path to log file.")
+    ("metrics-dump-file",
+        po::value(&metrics_dump_file)->default_value(metrics_dump_file),
+        "Periodically write the client metrics (latencies, cache hits, ...)"
+        " to this file in the Prometheus text format.")
+    ("metrics-dump-interval",
+        po::value(&metrics_dump_interval_s)
+            ->default_value(metrics_dump_interval_s),
+        "Interval between two writes of the metrics-dump-file (in seconds).")
     ("help,h",
         po::value(&show_help)->zero_tokens(),
         "Display this text.")
@@ -204,6 +227,11 @@ void Options::GenerateProgramOptionsDescriptions() {
     ("metadata-cache-ttl-s",
         po::value(&metadata_cache_ttl_s)->default_value(metadata_cache_ttl_s),
         "Time to live after which cached entries will expire.")
+    ("metadata-cache-negative-ttl-s",
+        po::value(&metadata_cache_negative_ttl_s)
+          ->default_value(metadata_cache_negative_ttl_s),
+        "Time to live after which cached lookups of paths which did not exist"
+        " will expire.\n(Set to 0 to disable them.)")
     ("enable-async-writes",
         po::value(&enable_async_writes)
           ->default_value(enable_async_writes)->zero_tokens(),
@@ -213,9 +241,48 @@ void Options::GenerateProgramOptionsDescriptions() {
             ->implicit_value(async_writes_max_requests),
         "Maximum number of pending write requests per file. Asynchronous writes"
         " will block if this limit is reached first.")
+    ("async-writes-combine-timeout-ms",
+        po::value(&async_writes_combine_timeout_ms)
+            ->implicit_value(async_writes_combine_timeout_ms),
+        "Time (in ms) for which a small asynchronous write is held back to "
+        "merge following adjacent writes to the same object into it."
+        "\n(Set to 0 to disable combining.)")
     ("readdir-chunk-size",
         po::value(&readdir_chunk_size)->default_value(readdir_chunk_size),
-        "Number of entries requested per readdir.");
+        "Number of entries requested per readdir.")
+    ("readdir-prefetch-depth",
+        po::value(&readdir_prefetch_depth)
+            ->default_value(readdir_prefetch_depth),
+        "Number of readdir chunks requested in advance while a directory"
+        " with more than readdir-chunk-size entries is listed."
+        "\n(Set to 0 to disable prefetching.)")
+    ("max-parallel-reads",
+        po::value(&max_parallel_reads)->default_value(max_parallel_reads),
+        "Maximum number of objects which are read in parallel if a read spans"
+        " multiple objects.\n(Set to 1 to read one object after another.)")
+    ("object-cache-size",
+        po::value(&object_cache_size_mb)->default_value(object_cache_size_mb),
+        "Memory in MB which may be used to cache the objects of open files."
+        " Writes are collected in the cache and written back on flush, close"
+        " or eviction.\n(Set to 0 to disable the object cache.)")
+    ("max-read-ahead-objects",
+        po::value(&max_read_ahead_objects)
+            ->default_value(max_read_ahead_objects),
+        "Maximum number of objects which are read ahead if a file is read"
+        " sequentially. The read-ahead window adapts to the throughput of the"
+        " OSDs up to this limit.\n(Set to 0 to disable read-ahead.)")
+    ("read-replica-balancing",
+        po::value(&read_replica_balancing)
+          ->default_value(read_replica_balancing)->zero_tokens(),
+        "Spreads the reads of read-only replicated files across all replicas"
+        " whose measured read latency is similar to the fastest one.")
+    ("hedged-read-percentile",
+        po::value(&hedged_read_percentile)
+            ->default_value(hedged_read_percentile),
+        "If a read of a read-only replicated file takes longer than this"
+        " percentile of the recent read latencies, it is also sent to a second"
+        " replica and the first response is used.\n(Set to 0 to disable"
+        " hedged reads.)");
 
   error_handling_.add_options()
     ("max-tries",
@@ -255,7 +322,28 @@ void Options::GenerateProgramOptionsDescriptions() {
         "Timeout after which a request will be retried (in seconds).")
     ("linger-timeout",
         po::value(&linger_timeout_s)->default_value(linger_timeout_s),
-        "Time after which idle connections will be closed (in seconds).");
+        "Time after which idle connections will be closed (in seconds).")
+    ("rpc-io-threads",
+        po::value(&rpc_io_threads)->default_value(rpc_io_threads),
+        "Number of threads which send requests and receive responses.")
+    ("max-connections-per-server",
+        po::value(&max_connections_per_server)
+            ->default_value(max_connections_per_server),
+        "Maximum number of connections to the same server. Requests are sent"
+        " over the connection with the fewest pending requests.")
+    ("shared-rpc-runtime",
+        po::value(&shared_rpc_runtime)
+            ->default_value(shared_rpc_runtime)->zero_tokens(),
+        "All volumes of the client share its RPC client, its connections and"
+        " one thread for periodic tasks.")
+    ("enable-object-checksums",
+        po::value(&enable_object_checksums)
+            ->default_value(enable_object_checksums)->zero_tokens(),
+        "Sends a CRC32C checksum of the data of every write and verifies the"
+        " checksum of read data if the OSD sends one. Data which the OSD"
+        " reports as corrupted or which does not match its checksum is read"
+        " from the next replica. Disabled by default, as computing the"
+        " checksums takes about a third of a core per 10 GB/s of data.");
 
 #ifdef HAS_OPENSSL
   ssl_options_.add_options()
@@ -375,6 +463,12 @@ void Options::GenerateProgramOptionsDescriptions() {
         po::value(&periodic_xcap_renewal_interval_s),
         "Pause time (in seconds) between two invocations of the thread which "
         "renews the XCap of all open file handles.")
+    ("periodic-mrc-batch-size",
+        po::value(&periodic_mrc_batch_size)
+            ->default_value(periodic_mrc_batch_size),
+        "Maximum number of XCap renewals or file size updates which are sent "
+        "to the MRC with one request in the background (0 = one request per "
+        "file).")
     ("async-writes-max-reqsize-kb",
         po::value(&async_writes_max_request_size_kb)
             ->implicit_value(async_writes_max_request_size_kb),
@@ -546,8 +640,31 @@ std::vector<std::string> Options::ParseCommandLine(int argc, char** argv) {
         " asynchronous writes (async-writes-max-reqs) must be greater 0.");
   }
 
+  if (periodic_mrc_batch_size < 0) {
+    throw InvalidCommandLineParametersException("The batch size of periodic"
+        " MRC requests (periodic-mrc-batch-size) must not be negative.");
+  }
+
+  if (hedged_read_percentile < 0 || hedged_read_percentile > 99) {
+    throw InvalidCommandLineParametersException("The percentile for hedged"
+        " reads (hedged-read-percentile) must be between 0 and 99.");
+  }
+
+  if (async_writes_combine_timeout_ms < 0) {
+    throw InvalidCommandLineParametersException("The timeout for combining"
+        " asynchronous writes (async-writes-combine-timeout-ms) must not be"
+        " negative.");
+  }
+
+  if (rpc_io_threads < 1 || max_connections_per_server < 1) {
+    throw InvalidCommandLineParametersException("The number of RPC io threads"
+        " (rpc-io-threads) and connections per server"
+        " (max-connections-per-server) must be greater 0.");
+  }
+
   if (!enable_async_writes && (vm.count("async-writes-max-reqsize-kb") ||
-      vm.count("async-writes-max-reqs"))) {
+      vm.count("async-writes-max-reqs") ||
+      vm.count("async-writes-combine-timeout-ms"))) {
     throw InvalidCommandLineParametersException("You specified async-writes-*"
         " options but did not set enable-async-writes.");
   }
@@ -0,0 +1,113 @@
+/*
+ * Copyright (c) 2015 by Zuse Institute Berlin
+ *
+ * Licensed under the BSD License, see LICENSE file for details.
+ *
+ */
+
+#include "libxtreemfs/periodic_task_scheduler.h"
+
+#include <boost/bind.hpp>
+#include <boost/date_time/posix_time/posix_time.hpp>
+#include <exception>
+
+#include "util/logging.h"
+#include "util/monotonic_clock.h"
+
+using namespace std;
+using namespace xtreemfs::util;
+
+namespace xtreemfs {
+
+PeriodicTaskScheduler::PeriodicTaskScheduler()
+    : next_id_(1), running_task_(0), stopped_(false) {}
+
+PeriodicTaskScheduler::~PeriodicTaskScheduler() {
+  Stop();
+}
+
+void PeriodicTaskScheduler::Start() {
+  boost::mutex::scoped_lock lock(mutex_);
+  if (thread_.get() || stopped_) {
+    return;
+  }
+  thread_.reset(new boost::thread(boost::bind(&PeriodicTaskScheduler::Run,
+                                              this)));
+}
+
+void PeriodicTaskScheduler::Stop() {
+  {
+    boost::mutex::scoped_lock lock(mutex_);
+    stopped_ = true;
+    changed_.notify_all();
+  }
+  if (thread_.get() && thread_->joinable()) {
+    thread_->join();
+  }
+}
+
+uint64_t PeriodicTaskScheduler::Schedule(
+    const Task& task,
+    const boost::posix_time::time_duration& interval) {
+  boost::mutex::scoped_lock lock(mutex_);
+  const uint64_t id = next_id_++;
+  ScheduledTask& scheduled_task = tasks_[id];
+  scheduled_task.task = task;
+  scheduled_task.interval = interval;
+  scheduled_task.next_run = MonotonicTime() + interval;
+  changed_.notify_all();
+  return id;
+}
+
+void PeriodicTaskScheduler::Cancel(uint64_t id) {
+  boost::mutex::scoped_lock lock(mutex_);
+  tasks_.erase(id);
+  while (running_task_ == id) {
+    changed_.wait(lock);
+  }
+}
+
+void PeriodicTaskScheduler::Run() {
+  boost::mutex::scoped_lock lock(mutex_);
+  while (!stopped_) {
+    // Find the task which is due next.
+    TaskMap::iterator next = tasks_.end();
+    for (TaskMap::iterator it = tasks_.begin(); it != tasks_.end(); ++it) {
+      if (next == tasks_.end() || it->second.next_run < next->second.next_run) {
+        next = it;
+      }
+    }
+    if (next == tasks_.end()) {
+      changed_.wait(lock);
+      continue;
+    }
+    const boost::posix_time::ptime now = MonotonicTime();
+    if (now < next->second.next_run) {
+      // The absolute timed_wait() uses the system time, so wait relative.
+      changed_.timed_wait(lock, next->second.next_run - now);
+      continue;
+    }
+
+    const uint64_t id = next->first;
+    Task task = next->second.task;
+    running_task_ = id;
+    lock.unlock();
+    try {
+      task();
+    } catch (const std::exception& e) {
+      Logging::log->getLog(LEVEL_ERROR)
+          << "A periodic task failed: " << e.what() << endl;
+    }
+    lock.lock();
+    running_task_ = 0;
+
+    // The task may have been cancelled meanwhile.
+    next = tasks_.find(id);
+    if (next != tasks_.end()) {
+      next->second.next_run = MonotonicTime() + next->second.interval;
+    }
+    changed_.notify_all();
+  }
+}
+
+}  // namespace xtreemfs
@@ -0,0 +1,189 @@
+/*
+ * Copyright (c) 2015 by Zuse Institute Berlin
+ *
+ * Licensed under the BSD License, see LICENSE file for details.
+ *
+ */
+
+#include "libxtreemfs/read_ahead_handler.h"
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
+
+#include "libxtreemfs/helper.h"
+#include "rpc/sync_callback.h"
+#include "xtreemfs/OSD.pb.h"
+
+using namespace std;
+
+namespace xtreemfs {
+
+/** Frees the buffers of a finished "response" and deletes it. */
+static void DeleteFinishedResponse(rpc::SyncCallbackBase* response) {
+  response->DeleteBuffers();
+  delete response;
+}
+
+ReadAheadHandler::ReadAheadHandler(int object_size,
+                                   int max_window,
+                                   bool verify_checksums)
+    : object_size_(object_size),
+      max_window_(max_window),
+      verify_checksums_(verify_checksums),
+      window_(min(kInitialWindow, max_window)),
+      last_read_object_(-1),
+      next_prefetch_object_(0),
+      last_object_of_file_(-1) {}
+
+ReadAheadHandler::~ReadAheadHandler() {
+  // Wait for the requests in flight - otherwise accesses to deleted memory
+  // may occur - and free them.
+  DiscardObjectsBefore(numeric_limits<int>::max());
+  for (list<rpc::SyncCallbackBase*>::iterator it = discarded_.begin();
+       it != discarded_.end();
+       ++it) {
+    (*it)->HasFailed();
+    DeleteFinishedResponse(*it);
+  }
+}
+
+void ReadAheadHandler::NotifyRead(int first_object,
+                                  int last_object,
+                                  const ReadAheadSendFunction& send) {
+  boost::mutex::scoped_lock lock(mutex_);
+  FreeFinishedDiscardedRequests();
+
+  const bool sequential =
+      first_object == last_read_object_ ||
+      first_object == last_read_object_ + 1 ||
+      prefetched_.find(first_object) != prefetched_.end();
+  last_read_object_ = last_object;
+
+  if (!sequential) {
+    if (DiscardObjectsBefore(numeric_limits<int>::max())) {
+      window_ = max(min(kInitialWindow, max_window_), window_ / 2);
+    }
+    next_prefetch_object_ = last_object + 1;
+    return;
+  }
+
+  DiscardObjectsBefore(first_object);
+
+  // Keep "window_" objects behind the current read in flight.
+  next_prefetch_object_ = max(next_prefetch_object_, last_object + 1);
+  while (next_prefetch_object_ <= last_object + window_ &&
+         (last_object_of_file_ == -1 ||
+          next_prefetch_object_ <= last_object_of_file_)) {
+    PrefetchedObject prefetched;
+    prefetched.response = send(next_prefetch_object_);
+    if (prefetched.response == NULL) {
+      break;
+    }
+    prefetched_[next_prefetch_object_] = prefetched;
+    next_prefetch_object_++;
+  }
+}
+
+int ReadAheadHandler::Read(int object_no,
+                           int offset_in_object,
+                           char* buffer,
+                           int bytes_to_read) {
+  boost::mutex::scoped_lock lock(mutex_);
+  PrefetchedObjects::iterator it = prefetched_.find(object_no);
+  if (it == prefetched_.end()) {
+    return -1;
+  }
+
+  rpc::SyncCallbackBase* response = it->second.response;
+  if (!response->HasFinished()) {
+    if (!it->second.was_read) {
+      // The reader caught up with the read-ahead, enlarge the window.
+      window_ = min(window_ * 2, max_window_);
+    }
+    // Wait without blocking the other users of the file. The response is not
+    // freed meanwhile, but may be discarded.
+    waited_for_.insert(response);
+    lock.unlock();
+    response->HasFailed();
+    lock.lock();
+    waited_for_.erase(waited_for_.find(response));
+    it = prefetched_.find(object_no);
+    if (it == prefetched_.end() || it->second.response != response) {
+      FreeFinishedDiscardedRequests();
+      return -1;
+    }
+  }
+  if (response->HasFailed() ||
+      !IsObjectDataValid(
+          *static_cast<pbrpc::ObjectData*>(response->response()),
+          response->data(),
+          response->data_length(),
+          verify_checksums_)) {
+    // Let the caller read the object again and handle the error. Other
+    // readers may still be returning from their wait for the response.
+    discarded_.push_back(response);
+    prefetched_.erase(it);
+    FreeFinishedDiscardedRequests();
+    return -1;
+  }
+  it->second.was_read = true;
+
+  const int data_length = response->data_length();
+  const int object_length = data_length + static_cast<pbrpc::ObjectData*>(
+      response->response())->zero_padding();
+  if (object_length < object_size_ &&
+      (last_object_of_file_ == -1 || object_no < last_object_of_file_)) {
+    // Do not read ahead behind the end of the file.
+    last_object_of_file_ = object_no;
+  }
+
+  const int bytes_read = max(0, min(bytes_to_read,
+                                    object_length - offset_in_object));
+  const int bytes_copied = max(0, min(bytes_read,
+                                      data_length - offset_in_object));
+  if (bytes_copied > 0) {
+    memcpy(buffer, response->data() + offset_in_object, bytes_copied);
+  }
+  // The gap behind the transferred data is filled with zeros.
+  memset(buffer + bytes_copied, 0, bytes_read - bytes_copied);
+  return bytes_read;
+}
+
+void ReadAheadHandler::Clear() {
+  boost::mutex::scoped_lock lock(mutex_);
+  DiscardObjectsBefore(numeric_limits<int>::max());
+  FreeFinishedDiscardedRequests();
+  next_prefetch_object_ = last_read_object_ + 1;
+  last_object_of_file_ = -1;
+}
+
+int ReadAheadHandler::window() {
+  boost::mutex::scoped_lock lock(mutex_);
+  return window_;
+}
+
+bool ReadAheadHandler::DiscardObjectsBefore(int object_no) {
+  bool discarded_unread_object = false;
+  PrefetchedObjects::iterator it = prefetched_.begin();
+  while (it != prefetched_.end() && it->first < object_no) {
+    discarded_unread_object |= !it->second.was_read;
+    discarded_.push_back(it->second.response);
+    prefetched_.erase(it++);
+  }
+  return discarded_unread_object;
+}
+
+void ReadAheadHandler::FreeFinishedDiscardedRequests() {
+  list<rpc::SyncCallbackBase*>::iterator it = discarded_.begin();
+  while (it != discarded_.end()) {
+    if ((*it)->HasFinished() && waited_for_.count(*it) == 0) {
+      DeleteFinishedResponse(*it);
+      it = discarded_.erase(it);
+    } else {
+      ++it;
+    }
+  }
+}
+
+}  // namespace xtreemfs
@@ -0,0 +1,160 @@
+/*
+ * Copyright (c) 2015 by Zuse Institute Berlin
+ *
+ * Licensed under the BSD License, see LICENSE file for details.
+ *
+ */
+
+#include "libxtreemfs/readdir_prefetcher.h"
+
+#include "rpc/sync_callback.h"
+#include "xtreemfs/MRC.pb.h"
+
+using namespace std;
+
+namespace xtreemfs {
+
+const size_t ReadDirPrefetcher::kMaxListings;
+
+ReadDirPrefetcher::ReadDirPrefetcher(int depth)
+    : depth_(depth), use_counter_(0) {}
+
+ReadDirPrefetcher::~ReadDirPrefetcher() {
+  Clear();
+}
+
+void ReadDirPrefetcher::CollectCallbacks(
+    const ChunkMap& chunks,
+    std::vector<rpc::SyncCallbackBase*>* callbacks) {
+  for (ChunkMap::const_iterator it = chunks.begin(); it != chunks.end(); ++it) {
+    callbacks->push_back(it->second.callback);
+  }
+}
+
+void ReadDirPrefetcher::Discard(
+    const std::vector<rpc::SyncCallbackBase*>& callbacks) {
+  for (size_t i = 0; i < callbacks.size(); ++i) {
+    // A callback must not be deleted before its request completed.
+    callbacks[i]->HasFailed();
+    callbacks[i]->DeleteBuffers();
+    delete callbacks[i];
+  }
+}
+
+void ReadDirPrefetcher::Reset(const std::string& key) {
+  vector<rpc::SyncCallbackBase*> discarded;
+  {
+    boost::mutex::scoped_lock lock(mutex_);
+    ListingMap::iterator it = listings_.find(key);
+    if (it == listings_.end()) {
+      return;
+    }
+    CollectCallbacks(it->second.chunks, &discarded);
+    listings_.erase(it);
+  }
+  Discard(discarded);
+}
+
+pbrpc::DirectoryEntries* ReadDirPrefetcher::Take(const std::string& key,
+                                                 uint64_t offset,
+                                                 uint32_t limit) {
+  vector<rpc::SyncCallbackBase*> discarded;
+  rpc::SyncCallbackBase* callback = NULL;
+  {
+    boost::mutex::scoped_lock lock(mutex_);
+    ListingMap::iterator listing = listings_.find(key);
+    if (listing == listings_.end()) {
+      return NULL;
+    }
+    ChunkMap& chunks = listing->second.chunks;
+    ChunkMap::iterator chunk = chunks.find(offset);
+    if (chunk == chunks.end() || chunk->second.limit != limit) {
+      // The listing does not continue where the prefetching expected it.
+      CollectCallbacks(chunks, &discarded);
+      listings_.erase(listing);
+    } else {
+      callback = chunk->second.callback;
+      for (ChunkMap::iterator it = chunks.begin(); it != chunk; ++it) {
+        discarded.push_back(it->second.callback);
+      }
+      chunks.erase(chunks.begin(), ++chunk);
+      if (chunks.empty()) {
+        listings_.erase(listing);
+      } else {
+        listing->second.last_use = ++use_counter_;
+      }
+    }
+  }
+  Discard(discarded);
+
+  if (callback == NULL) {
+    return NULL;
+  }
+  if (callback->HasFailed()) {
+    callback->DeleteBuffers();
+    delete callback;
+    return NULL;
+  }
+  pbrpc::DirectoryEntries* entries =
+      static_cast<pbrpc::DirectoryEntries*>(callback->response());
+  // Delete everything except the response.
+  delete[] callback->data();
+  delete callback;
+  return entries;
+}
+
+void ReadDirPrefetcher::Prefetch(const std::string& key,
+                                 uint64_t offset,
+                                 uint32_t chunk_size,
+                                 const SendFunction& send) {
+  if (depth_ <= 0 || chunk_size == 0) {
+    return;
+  }
+
+  vector<rpc::SyncCallbackBase*> discarded;
+  {
+    boost::mutex::scoped_lock lock(mutex_);
+    Listing& listing = listings_[key];
+    listing.last_use = ++use_counter_;
+
+    ChunkMap& chunks = listing.chunks;
+    uint64_t next_offset = chunks.empty()
+        ? offset : chunks.rbegin()->first + chunks.rbegin()->second.limit;
+    while (chunks.size() < static_cast<size_t>(depth_)) {
+      // Sending does not block, the response is waited for in Take().
+      Chunk chunk;
+      chunk.limit = chunk_size;
+      chunk.callback = send(next_offset, chunk_size);
+      chunks[next_offset] = chunk;
+      next_offset += chunk_size;
+    }
+
+    if (listings_.size() > kMaxListings) {
+      ListingMap::iterator oldest = listings_.begin();
+      for (ListingMap::iterator it = listings_.begin(); it != listings_.end();
+           ++it) {
+        if (it->second.last_use < oldest->second.last_use) {
+          oldest = it;
+        }
+      }
+      CollectCallbacks(oldest->second.chunks, &discarded);
+      listings_.erase(oldest);
+    }
+  }
+  Discard(discarded);
+}
+
+void ReadDirPrefetcher::Clear() {
+  vector<rpc::SyncCallbackBase*> discarded;
+  {
+    boost::mutex::scoped_lock lock(mutex_);
+    for (ListingMap::iterator it = listings_.begin(); it != listings_.end();
+         ++it) {
+      CollectCallbacks(it->second.chunks, &discarded);
+    }
+    listings_.clear();
+  }
+  Discard(discarded);
+}
+
+}  // namespace xtreemfs
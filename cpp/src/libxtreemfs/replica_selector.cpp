@@ -0,0 +1,225 @@
+/*
+ * Copyright (c) 2015 by Zuse Institute Berlin
+ *
+ * Licensed under the BSD License, see LICENSE file for details.
+ *
+ */
+
+#include "libxtreemfs/replica_selector.h"
+
+#include <boost/date_time/posix_time/posix_time.hpp>
+#include <algorithm>
+#include <set>
+
+#include "libxtreemfs/uuid_scorer.h"
+#include "util/monotonic_clock.h"
+#include "xtreemfs/GlobalTypes.pb.h"
+
+using namespace std;
+using namespace xtreemfs::pbrpc;
+
+namespace xtreemfs {
+
+namespace {
+
+/** Orders OSD UUIDs by their average latency. */
+class ByAverageLatency {
+ public:
+  explicit ByAverageLatency(const map<string, double>* latencies)
+      : latencies_(latencies) {}
+
+  bool operator()(const string& a, const string& b) const {
+    return latencies_->find(a)->second < latencies_->find(b)->second;
+  }
+
+ private:
+  const map<string, double>* latencies_;
+};
+
+/** True for OSD UUIDs which are not in the given set. */
+class NotIn {
+ public:
+  explicit NotIn(const set<string>* uuids) : uuids_(uuids) {}
+
+  bool operator()(const string& uuid) const {
+    return uuids_->count(uuid) == 0;
+  }
+
+ private:
+  const set<string>* uuids_;
+};
+
+}  // anonymous namespace
+
+const double ReplicaSelector::kBalancingTolerance = 1.5;
+const double ReplicaSelector::kSmoothingFactor = 0.2;
+const int ReplicaSelector::kMeasurementMaxAgeS;
+const int ReplicaSelector::kRecentLatencies;
+const int ReplicaSelector::kMinHedgeSamples;
+
+ReplicaSelector::ReplicaSelector(bool balance_reads,
+                                 int hedge_percentile,
+                                 UUIDScorer* scorer)
+    : balance_reads_(balance_reads),
+      hedge_percentile_(hedge_percentile),
+      scorer_(scorer),
+      next_recent_latency_(0),
+      next_choice_(0) {
+  recent_latencies_us_.reserve(kRecentLatencies);
+}
+
+bool ReplicaSelector::HasInterchangeableReplicas(const XLocSet& xlocs) {
+  return xlocs.replicas_size() > 1
+      && xlocs.replica_update_policy() == "ronly";
+}
+
+bool ReplicaSelector::IsApplicable(const XLocSet& xlocs) {
+  return HasInterchangeableReplicas(xlocs)
+      && xlocs.replicas(0).osd_uuids_size() == 1;
+}
+
+double ReplicaSelector::GetAverageLatency(
+    const std::string& osd_uuid,
+    const boost::posix_time::ptime& now) {
+  OSDLatencies::const_iterator it = osd_latencies_.find(osd_uuid);
+  if (it == osd_latencies_.end() ||
+      now - it->second.last_update
+          > boost::posix_time::seconds(kMeasurementMaxAgeS)) {
+    return -1;
+  }
+  return it->second.average_us;
+}
+
+void ReplicaSelector::OrderReplicas(const XLocSet& xlocs,
+                                    std::vector<std::string>* osd_uuids) {
+  osd_uuids->clear();
+  for (int i = 0; i < xlocs.replicas_size(); ++i) {
+    osd_uuids->push_back(xlocs.replicas(i).osd_uuids(0));
+  }
+  if (osd_uuids->size() < 2) {
+    return;
+  }
+
+  set<string> degraded;
+  if (scorer_ != NULL) {
+    for (size_t i = 0; i < osd_uuids->size(); ++i) {
+      rpc::ServerScore score;
+      if (scorer_->GetScore((*osd_uuids)[i], &score) && score.degraded) {
+        degraded.insert((*osd_uuids)[i]);
+      }
+    }
+    if (degraded.size() == osd_uuids->size()) {
+      degraded.clear();
+    }
+  }
+  if (!balance_reads_) {
+    stable_partition(osd_uuids->begin(), osd_uuids->end(), NotIn(&degraded));
+    return;
+  }
+
+  const boost::posix_time::ptime now = util::MonotonicTime();
+  boost::mutex::scoped_lock lock(mutex_);
+
+  map<string, double> latencies;
+  double fastest = -1;
+  for (size_t i = 0; i < osd_uuids->size(); ++i) {
+    const double latency = GetAverageLatency((*osd_uuids)[i], now);
+    latencies[(*osd_uuids)[i]] = latency;
+    if (latency >= 0 && (fastest < 0 || latency < fastest)) {
+      fastest = latency;
+    }
+  }
+
+  // Unmeasured replicas are probed, the others share the reads if they are
+  // not much slower than the fastest one.
+  vector<size_t> candidates;
+  for (size_t i = 0; i < osd_uuids->size(); ++i) {
+    const double latency = latencies[(*osd_uuids)[i]];
+    if (degraded.count((*osd_uuids)[i]) == 0 &&
+        (latency < 0 || latency <= fastest * kBalancingTolerance)) {
+      candidates.push_back(i);
+    }
+  }
+  if (candidates.empty()) {
+    // The fastest replicas are degraded, fall back to the others.
+    for (size_t i = 0; i < osd_uuids->size(); ++i) {
+      if (degraded.count((*osd_uuids)[i]) == 0) {
+        candidates.push_back(i);
+      }
+    }
+  }
+  const size_t chosen = candidates[next_choice_++ % candidates.size()];
+  lock.unlock();
+
+  // Fall back to the remaining replicas in the order of their latency, with
+  // unmeasured replicas in the order of the XLocSet after the fastest.
+  for (map<string, double>::iterator it = latencies.begin();
+       it != latencies.end();
+       ++it) {
+    if (it->second < 0) {
+      it->second = fastest;
+    }
+  }
+  const string first = (*osd_uuids)[chosen];
+  osd_uuids->erase(osd_uuids->begin() + chosen);
+  stable_sort(osd_uuids->begin(),
+              osd_uuids->end(),
+              ByAverageLatency(&latencies));
+  stable_partition(osd_uuids->begin(), osd_uuids->end(), NotIn(&degraded));
+  osd_uuids->insert(osd_uuids->begin(), first);
+}
+
+void ReplicaSelector::RecordLatency(
+    const std::string& osd_uuid,
+    const boost::posix_time::time_duration& latency) {
+  const int64_t latency_us = latency.total_microseconds();
+  const boost::posix_time::ptime now = util::MonotonicTime();
+  boost::mutex::scoped_lock lock(mutex_);
+
+  const double average = GetAverageLatency(osd_uuid, now);
+  OSDLatency& entry = osd_latencies_[osd_uuid];
+  entry.average_us = average < 0 ? latency_us
+      : (1 - kSmoothingFactor) * average + kSmoothingFactor * latency_us;
+  entry.last_update = now;
+
+  if (recent_latencies_us_.size() < static_cast<size_t>(kRecentLatencies)) {
+    recent_latencies_us_.push_back(latency_us);
+  } else {
+    recent_latencies_us_[next_recent_latency_] = latency_us;
+    next_recent_latency_ = (next_recent_latency_ + 1) % kRecentLatencies;
+  }
+}
+
+void ReplicaSelector::RecordFailure(const std::string& osd_uuid) {
+  const boost::posix_time::ptime now = util::MonotonicTime();
+  boost::mutex::scoped_lock lock(mutex_);
+
+  // Treat the failure like a very slow read: the OSD is only used again if
+  // all others are slow, too, or after the measurement became outdated.
+  const double average = GetAverageLatency(osd_uuid, now);
+  OSDLatency& entry = osd_latencies_[osd_uuid];
+  entry.average_us = max(2 * average, 1000.0 * 1000.0);
+  entry.last_update = now;
+}
+
+bool ReplicaSelector::GetHedgeDelay(boost::posix_time::time_duration* delay) {
+  if (hedge_percentile_ <= 0) {
+    return false;
+  }
+
+  vector<int64_t> latencies;
+  {
+    boost::mutex::scoped_lock lock(mutex_);
+    if (recent_latencies_us_.size() < static_cast<size_t>(kMinHedgeSamples)) {
+      return false;
+    }
+    latencies = recent_latencies_us_;
+  }
+  vector<int64_t>::iterator nth =
+      latencies.begin() + (latencies.size() - 1) * hedge_percentile_ / 100;
+  nth_element(latencies.begin(), nth, latencies.end());
+  *delay = boost::posix_time::microseconds(*nth);
+  return true;
+}
+
+}  // namespace xtreemfs
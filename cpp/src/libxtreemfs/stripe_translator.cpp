@@ -9,69 +9,148 @@
 #include <algorithm>
 #include <vector>
 
+#include "libxtreemfs/osd_offsets.h"
+
 using namespace std;
 using namespace xtreemfs::pbrpc;
 
 namespace xtreemfs {
 
-void StripeTranslatorRaid0::TranslateWriteRequest(
-    const char *buf,
+namespace {
+
+/** Appends one operation per object accessed by the request of "size" bytes
+ *  at "offset" to "operations". The objects are distributed round-robin over
+ *  the "width" (data) OSDs of every replica.
+ *
+ *  The operations are constructed in place of the (reused) vector and their
+ *  OSD offsets are stored inline, so nothing is allocated per object. */
+template <class Operation, typename Buffer>
+void TranslateToObjects(
+    Buffer buf,
     size_t size,
     int64_t offset,
-    PolicyContainer policies,
-    std::vector<WriteOperation>* operations) const {
+    const StripeTranslator::PolicyContainer& policies,
+    std::vector<Operation>* operations) {
+  if (size == 0) {
+    return;
+  }
   // stripe size is stored in kB
-  unsigned int stripe_size = (*policies.begin())->stripe_size() * 1024;
+  const size_t stripe_size = policies.front()->stripe_size() * 1024;
+
+  const size_t first_object = static_cast<size_t>(offset) / stripe_size;
+  const size_t last_object =
+      (static_cast<size_t>(offset) + size - 1) / stripe_size;
+  const size_t required = operations->size() + last_object - first_object + 1;
+  if (operations->capacity() < required) {
+    // Grow geometrically as vectored requests append several times.
+    operations->reserve(max(required, 2 * operations->capacity()));
+  }
 
   size_t start = 0;
-  while (start < size) {
-    size_t obj_number = static_cast<size_t>(start + offset) / stripe_size;
-    size_t req_offset = (start + offset) % stripe_size;
-    size_t req_size
-      = min(size - start, static_cast<size_t>(stripe_size - req_offset));
-
-    std::vector<size_t> osd_offsets;
-    for (PolicyContainer::iterator i = policies.begin();
-         i != policies.end();
-         ++i) {
-      osd_offsets.push_back(obj_number % (*i)->width());
-    }
+  size_t req_offset = static_cast<size_t>(offset) % stripe_size;
+  for (size_t obj_number = first_object;
+       obj_number <= last_object;
+       ++obj_number) {
+    const size_t req_size = min(size - start, stripe_size - req_offset);
 
-    operations->push_back(WriteOperation(
-        obj_number, osd_offsets, req_size, req_offset, buf + start));
+    operations->push_back(Operation(
+        obj_number, OSDOffsets(), req_size, req_offset, buf + start));
+    OSDOffsets& osd_offsets = operations->back().osd_offsets;
+    for (size_t i = 0; i < policies.size(); ++i) {
+      osd_offsets.push_back(obj_number % policies[i]->width());
+    }
 
     start += req_size;
+    req_offset = 0;
   }
 }
 
+}  // anonymous namespace
+
+void StripeTranslator::TranslateWriteRequestV(
+    const struct iovec* iov,
+    int iovcnt,
+    int64_t offset,
+    const PolicyContainer& policies,
+    std::vector<WriteOperation>* operations) const {
+  for (int i = 0; i < iovcnt; i++) {
+    TranslateWriteRequest(static_cast<const char*>(iov[i].iov_base),
+                          iov[i].iov_len,
+                          offset,
+                          policies,
+                          operations);
+    offset += iov[i].iov_len;
+  }
+}
+
+void StripeTranslator::TranslateReadRequestV(
+    const struct iovec* iov,
+    int iovcnt,
+    int64_t offset,
+    const PolicyContainer& policies,
+    std::vector<ReadOperation>* operations) const {
+  for (int i = 0; i < iovcnt; i++) {
+    TranslateReadRequest(static_cast<char*>(iov[i].iov_base),
+                         iov[i].iov_len,
+                         offset,
+                         policies,
+                         operations);
+    offset += iov[i].iov_len;
+  }
+}
+
+void StripeTranslatorRaid0::TranslateWriteRequest(
+    const char *buf,
+    size_t size,
+    int64_t offset,
+    const PolicyContainer& policies,
+    std::vector<WriteOperation>* operations) const {
+  TranslateToObjects(buf, size, offset, policies, operations);
+}
+
 void StripeTranslatorRaid0::TranslateReadRequest(
     char *buf,
     size_t size,
     int64_t offset,
-    PolicyContainer policies,
+    const PolicyContainer& policies,
     std::vector<ReadOperation>* operations) const {
-  // stripe size is stored in kB
-  unsigned int stripe_size = (*policies.begin())->stripe_size() * 1024;
+  TranslateToObjects(buf, size, offset, policies, operations);
+}
 
-  size_t start = 0;
-  while (start < size) {
-    size_t obj_number = static_cast<size_t>(start + offset) / stripe_size;
-    size_t req_offset = (start + offset) % stripe_size;
-    size_t req_size
-      = min(size - start, static_cast<size_t>(stripe_size - req_offset));
-
-    std::vector<size_t> osd_offsets;
-    for (PolicyContainer::iterator i = policies.begin();
-         i != policies.end();
-         ++i) {
-      osd_offsets.push_back(obj_number % (*i)->width());
-    }
+void StripeTranslatorErasureCode::TranslateWriteRequest(
+    const char *buf,
+    size_t size,
+    int64_t offset,
+    const PolicyContainer& policies,
+    std::vector<WriteOperation>* operations) const {
+  TranslateToObjects(buf, size, offset, policies, operations);
+}
+
+void StripeTranslatorErasureCode::TranslateReadRequest(
+    char *buf,
+    size_t size,
+    int64_t offset,
+    const PolicyContainer& policies,
+    std::vector<ReadOperation>* operations) const {
+  TranslateToObjects(buf, size, offset, policies, operations);
+}
 
-    operations->push_back(ReadOperation(
-        obj_number, osd_offsets, req_size, req_offset, buf + start));
+size_t StripeTranslatorErasureCode::GetStripeNumber(
+    const xtreemfs::pbrpc::StripingPolicy& policy,
+    size_t obj_number) {
+  return obj_number / policy.width();
+}
 
-    start += req_size;
-  }
+size_t StripeTranslatorErasureCode::GetFirstObjectOfStripe(
+    const xtreemfs::pbrpc::StripingPolicy& policy,
+    size_t stripe_number) {
+  return stripe_number * policy.width();
+}
+
+size_t StripeTranslatorErasureCode::GetParityOSDOffset(
+    const xtreemfs::pbrpc::StripingPolicy& policy,
+    int parity_index) {
+  return policy.width() + parity_index;
 }
 
 }  // namespace xtreemfs
@@ -0,0 +1,133 @@
+/*
+ * Copyright (c) 2015 by Zuse Institute Berlin
+ *
+ * Licensed under the BSD License, see LICENSE file for details.
+ *
+ */
+
+#ifndef WIN32
+#include "libxtreemfs/user_credentials_cache.h"
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+using namespace std;
+using namespace xtreemfs::pbrpc;
+
+namespace xtreemfs {
+
+bool UserCredentialsCache::Key::operator<(const Key& other) const {
+  if (uid != other.uid) {
+    return uid < other.uid;
+  }
+  if (gid != other.gid) {
+    return gid < other.gid;
+  }
+  if (pid != other.pid) {
+    return pid < other.pid;
+  }
+  return start_time < other.start_time;
+}
+
+UserCredentialsCache::UserCredentialsCache(size_t max_entries, uint64_t ttl_s)
+    : max_entries_(max_entries), ttl_s_(ttl_s) {
+}
+
+bool UserCredentialsCache::Get(uid_t uid,
+                               gid_t gid,
+                               pid_t pid,
+                               uint64_t start_time,
+                               UserCredentials* user_credentials) {
+  if (!enabled()) {
+    return false;
+  }
+  Key key;
+  key.uid = uid;
+  key.gid = gid;
+  key.pid = pid;
+  key.start_time = start_time;
+
+  boost::mutex::scoped_lock lock(mutex_);
+  EntryMap::const_iterator it = entries_.find(key);
+  if (it == entries_.end() || it->second.timeout_s < time(NULL)) {
+    return false;
+  }
+  user_credentials->CopyFrom(it->second.user_credentials);
+  return true;
+}
+
+void UserCredentialsCache::Put(uid_t uid,
+                               gid_t gid,
+                               pid_t pid,
+                               uint64_t start_time,
+                               const UserCredentials& user_credentials) {
+  if (!enabled()) {
+    return;
+  }
+  Key key;
+  key.uid = uid;
+  key.gid = gid;
+  key.pid = pid;
+  key.start_time = start_time;
+
+  boost::mutex::scoped_lock lock(mutex_);
+  EntryMap::iterator it = entries_.find(key);
+  if (it == entries_.end()) {
+    while (entries_.size() >= max_entries_) {
+      // All entries have the same TTL, so the oldest one expires first.
+      entries_.erase(eviction_order_.front());
+      eviction_order_.pop_front();
+    }
+    it = entries_.insert(make_pair(key, Entry())).first;
+    it->second.age = eviction_order_.insert(eviction_order_.end(), key);
+  } else {
+    eviction_order_.splice(eviction_order_.end(),
+                           eviction_order_,
+                           it->second.age);
+  }
+  it->second.user_credentials.CopyFrom(user_credentials);
+  it->second.timeout_s = time(NULL) + ttl_s_;
+}
+
+size_t UserCredentialsCache::Size() {
+  boost::mutex::scoped_lock lock(mutex_);
+  return entries_.size();
+}
+
+uint64_t UserCredentialsCache::GetProcessStartTime(pid_t pid) {
+#ifdef __linux__
+  // The 22nd field of /proc/<pid>/stat. The 2nd field is the command name in
+  // parentheses which may contain spaces, so counting starts after it.
+  char path[32];
+  snprintf(path, sizeof(path), "/proc/%d/stat", static_cast<int>(pid));
+  int fd = open(path, O_RDONLY);
+  if (fd == -1) {
+    return 0;
+  }
+  char buffer[512];
+  ssize_t length = read(fd, buffer, sizeof(buffer) - 1);
+  close(fd);
+  if (length <= 0) {
+    return 0;
+  }
+  buffer[length] = '\0';
+
+  const char* field = strrchr(buffer, ')');
+  for (int i = 2; i < 22 && field != NULL; i++) {
+    field = strchr(field + 1, ' ');
+  }
+  if (field == NULL) {
+    return 0;
+  }
+  return strtoull(field + 1, NULL, 10);
+#else
+  return 0;
+#endif  // __linux__
+}
+
+}  // namespace xtreemfs
+#endif  // !WIN32
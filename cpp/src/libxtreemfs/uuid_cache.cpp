@@ -8,7 +8,9 @@
 
 #include <time.h>
 
+#include <algorithm>
 #include <map>
+#include <sstream>
 #include <string>
 #include <vector>
 
@@ -19,6 +21,8 @@ using namespace xtreemfs::util;
 
 namespace xtreemfs {
 
+const int UUIDCache::kRefreshRetryDelayS;
+
 void UUIDCache::update(
     const std::string& uuid,
     const std::string& address,
@@ -38,9 +42,15 @@ void UUIDCache::update(
   uuidMapping.uuid = uuid;
   uuidMapping.port = port;
   uuidMapping.timeout = time(NULL) + ttls;  // calc timeout in seconds
+  // Refresh once three quarters of the TTL have passed.
+  uuidMapping.refresh_time = uuidMapping.timeout - (ttls + 3) / 4;
 
   // address contains update-time to evict old entries
   cache_[uuid] = uuidMapping;
+
+  if (resolving_.erase(uuid) > 0) {
+    resolution_finished_.notify_all();
+  }
 }
 
 /**
@@ -75,4 +85,56 @@ std::string UUIDCache::get(const std::string& uuid) {
   return "";
 }
 
+UUIDCache::LookupResult UUIDCache::Lookup(const std::string& uuid,
+                                          bool wait,
+                                          std::string* address) {
+  boost::mutex::scoped_lock lock(mutex_);
+
+  while (true) {
+    std::map<string, UUIDMapping >::const_iterator it = cache_.find(uuid);
+    const time_t now = time(NULL);
+    if (it != cache_.end() && now < it->second.timeout) {
+      ostringstream s;
+      s << it->second.address << ":" << it->second.port;
+      *address = s.str();
+
+      // Only the first caller after the refresh time refreshes the entry.
+      if (now >= it->second.refresh_time && resolving_.insert(uuid).second) {
+        if (Logging::log->loggingActive(LEVEL_DEBUG)) {
+          Logging::log->getLog(LEVEL_DEBUG)  << "UUID refresh:" << uuid << endl;
+        }
+        return kRefresh;
+      }
+      return kHit;
+    }
+
+    if (resolving_.insert(uuid).second) {
+      if (Logging::log->loggingActive(LEVEL_DEBUG)) {
+        Logging::log->getLog(LEVEL_DEBUG)  << "UUID cache miss:" << uuid << endl;
+      }
+      return kResolve;
+    }
+    if (!wait) {
+      return kPending;
+    }
+    // Another thread resolves the UUID, wait for its result.
+    resolution_finished_.wait(lock);
+  }
+}
+
+void UUIDCache::AbortResolution(const std::string& uuid) {
+  boost::mutex::scoped_lock lock(mutex_);
+  std::map<string, UUIDMapping >::iterator it = cache_.find(uuid);
+  if (it != cache_.end()) {
+    // A refresh failed. Back off instead of letting every later Lookup()
+    // refresh again; once the entry expired, it is resolved regularly.
+    it->second.refresh_time = min(
+        static_cast<time_t>(time(NULL) + kRefreshRetryDelayS),
+        it->second.timeout);
+  }
+  if (resolving_.erase(uuid) > 0) {
+    resolution_finished_.notify_all();
+  }
+}
+
 }  // namespace xtreemfs
@@ -62,7 +62,7 @@ void UUIDContainer::GetOSDUUIDsFromXlocSet(
 }
 
 void UUIDContainer::FillUUIDIterator(ContainerUUIDIterator* uuid_iterator,
-                                     std::vector<size_t> offsets) {
+                                     const OSDOffsets& offsets) {
   assert(offsets.size() == uuids_.size());
   boost::mutex::scoped_lock lock(mutex_);
 
@@ -70,12 +70,11 @@ void UUIDContainer::FillUUIDIterator(ContainerUUIDIterator* uuid_iterator,
   //       of ContainerUUIDIterator, the following line would be needed:
   //       uuid_iterator->Clear();
 
-  Iterator replica_iterator = uuids_.begin();
-  std::vector<size_t>::iterator offset_iterator = offsets.begin();
-
-  for (; replica_iterator != uuids_.end();
-       ++replica_iterator, ++offset_iterator) {
-    uuid_iterator->AddUUIDItem((*replica_iterator)[*offset_iterator]);
+  size_t replica = 0;
+  for (Iterator replica_iterator = uuids_.begin();
+       replica_iterator != uuids_.end();
+       ++replica_iterator, ++replica) {
+    uuid_iterator->AddUUIDItem((*replica_iterator)[offsets[replica]]);
   }
 }
 
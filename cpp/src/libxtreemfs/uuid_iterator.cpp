@@ -9,8 +9,10 @@
 #include "libxtreemfs/uuid_iterator.h"
 
 #include <sstream>
+#include <vector>
 
 #include "libxtreemfs/uuid_container.h"
+#include "libxtreemfs/uuid_scorer.h"
 #include "libxtreemfs/xtreemfs_exception.h"
 #include "util/logging.h"
 
@@ -19,7 +21,16 @@ using namespace xtreemfs::util;
 
 namespace xtreemfs {
 
-UUIDIterator::UUIDIterator() {
+namespace {
+
+bool IsDegraded(UUIDScorer* scorer, const std::string& uuid) {
+  rpc::ServerScore score;
+  return scorer->GetScore(uuid, &score) && score.degraded;
+}
+
+}  // anonymous namespace
+
+UUIDIterator::UUIDIterator() : scorer_(NULL) {
   // Point to the past-the-end element in case of an empty list.
   current_uuid_ = uuids_.end();
 }
@@ -28,15 +39,61 @@ UUIDIterator::~UUIDIterator() {}
 
 void UUIDIterator::GetUUID(std::string* result) {
   assert(result);
-  boost::mutex::scoped_lock lock(mutex_);
+  UUIDScorer* scorer;
+  vector<string> alternatives;
+  {
+    boost::mutex::scoped_lock lock(mutex_);
 
-  if (current_uuid_ == uuids_.end()) {
-    throw UUIDIteratorListIsEmpyException("GetUUID() failed because the list of"
-        " UUIDs is empty.");
-  } else {
+    if (current_uuid_ == uuids_.end()) {
+      throw UUIDIteratorListIsEmpyException("GetUUID() failed because the list"
+          " of UUIDs is empty.");
+    }
     assert(!(*current_uuid_)->IsFailed());
     *result = (*current_uuid_)->uuid;
+
+    scorer = scorer_;
+    if (scorer == NULL) {
+      return;
+    }
+    for (list<UUIDItem*>::iterator it = uuids_.begin();
+         it != uuids_.end();
+         ++it) {
+      if (it != current_uuid_ && !(*it)->IsFailed()) {
+        alternatives.push_back((*it)->uuid);
+      }
+    }
   }
+
+  // Resolving the scores may require to resolve UUIDs, so the lock is not held.
+  if (alternatives.empty() || !IsDegraded(scorer, *result)) {
+    return;
+  }
+  for (size_t i = 0; i < alternatives.size(); ++i) {
+    if (IsDegraded(scorer, alternatives[i])) {
+      continue;
+    }
+
+    boost::mutex::scoped_lock lock(mutex_);
+    if (current_uuid_ == uuids_.end() || (*current_uuid_)->uuid != *result) {
+      // Another thread changed the current UUID meanwhile.
+      return;
+    }
+    for (list<UUIDItem*>::iterator it = uuids_.begin();
+         it != uuids_.end();
+         ++it) {
+      if ((*it)->uuid == alternatives[i] && !(*it)->IsFailed()) {
+        if (Logging::log->loggingActive(LEVEL_DEBUG)) {
+          Logging::log->getLog(LEVEL_DEBUG) << "Skipping the degraded UUID: "
+              << *result << " in favor of: " << alternatives[i] << endl;
+        }
+        current_uuid_ = it;
+        *result = alternatives[i];
+        return;
+      }
+    }
+    return;
+  }
+  // All UUIDs are degraded, stick to the current one.
 }
 
 std::string UUIDIterator::DebugString() {
@@ -59,6 +116,11 @@ std::string UUIDIterator::DebugString() {
   return stream.str();
 }
 
+void UUIDIterator::set_scorer(UUIDScorer* scorer) {
+  boost::mutex::scoped_lock lock(mutex_);
+  scorer_ = scorer;
+}
+
 void UUIDIterator::MarkUUIDAsFailed(const std::string& uuid) {
   boost::mutex::scoped_lock lock(mutex_);
 
@@ -0,0 +1,35 @@
+/*
+ * Copyright (c) 2015 by Zuse Institute Berlin
+ *
+ * Licensed under the BSD License, see LICENSE file for details.
+ *
+ */
+
+#include "libxtreemfs/uuid_scorer.h"
+
+#include "libxtreemfs/uuid_resolver.h"
+#include "libxtreemfs/xtreemfs_exception.h"
+
+using namespace std;
+
+namespace xtreemfs {
+
+ServerStatisticsUUIDScorer::ServerStatisticsUUIDScorer(
+    UUIDResolver* uuid_resolver,
+    rpc::ServerStatistics* server_statistics)
+    : uuid_resolver_(uuid_resolver),
+      server_statistics_(server_statistics) {}
+
+bool ServerStatisticsUUIDScorer::GetScore(const std::string& uuid,
+                                          rpc::ServerScore* score) {
+  string address;
+  try {
+    // The UUIDs of open files are usually cached, see PrefetchUUIDs().
+    uuid_resolver_->UUIDToAddress(uuid, &address);
+  } catch (const XtreemFSException&) {
+    return false;
+  }
+  return server_statistics_->GetScore(address, score);
+}
+
+}  // namespace xtreemfs
@@ -13,18 +13,23 @@
 #include <limits>
 #include <map>
 #include <string>
+#include <vector>
 
 #include "libxtreemfs/client_implementation.h"
 #include "libxtreemfs/execute_sync_request.h"
 #include "libxtreemfs/file_handle_implementation.h"
 #include "libxtreemfs/file_info.h"
 #include "libxtreemfs/helper.h"
+#include "libxtreemfs/mrc_request_batcher.h"
+#include "libxtreemfs/periodic_task_scheduler.h"
 #include "libxtreemfs/stripe_translator.h"
 #include "libxtreemfs/uuid_iterator.h"
 #include "libxtreemfs/xtreemfs_exception.h"
 #include "rpc/client.h"
 #include "util/error_log.h"
 #include "util/logging.h"
+#include "util/metrics.h"
+#include "util/monotonic_clock.h"
 #include "xtreemfs/MRC.pb.h"
 #include "xtreemfs/MRCServiceClient.h"
 #include "xtreemfs/OSDServiceClient.h"
@@ -39,6 +44,20 @@ using std::map;
 
 namespace xtreemfs {
 
+namespace {
+
+Counter* const stat_cache_hits_counter =
+    MetricsRegistry::instance()->GetCounter("metadata_cache_stat_hits");
+Counter* const stat_cache_misses_counter =
+    MetricsRegistry::instance()->GetCounter("metadata_cache_stat_misses");
+Counter* const dir_cache_hits_counter =
+    MetricsRegistry::instance()->GetCounter("metadata_cache_dir_entries_hits");
+Counter* const dir_cache_misses_counter =
+    MetricsRegistry::instance()->GetCounter(
+        "metadata_cache_dir_entries_misses");
+
+}  // anonymous namespace
+
 VolumeImplementation::VolumeImplementation(
     ClientImplementation* client,
     const std::string& client_uuid,
@@ -54,8 +73,17 @@ VolumeImplementation::VolumeImplementation(
       volume_options_(options),
       // Disable retries and interrupted querying for periodic threads.
       periodic_threads_options_(1, 40, false, NULL),
+      network_client_(NULL),
       metadata_cache_(options.metadata_cache_size,
-                      options.metadata_cache_ttl_s) {
+                      options.metadata_cache_ttl_s,
+                      options.metadata_cache_negative_ttl_s),
+      readdir_prefetcher_(options.readdir_prefetch_depth),
+      object_cache_budget_(
+          static_cast<int64_t>(options.object_cache_size_mb) * 1024 * 1024),
+      replica_selector_(options.read_replica_balancing,
+                        options.hedged_read_percentile,
+                        client->uuid_scorer()),
+      periodic_task_scheduler_(NULL) {
   // Set AuthType to AUTH_NONE as it's currently not used.
   auth_bogus_.set_auth_type(AUTH_NONE);
   // Set username "xtreemfs" as it does not get checked at server side.
@@ -80,24 +108,68 @@ VolumeImplementation::~VolumeImplementation() {
   }
 }
 
+UUIDScorer* VolumeImplementation::uuid_scorer() {
+  return client_->uuid_scorer();
+}
+
 void VolumeImplementation::Start() {
-  // start network (rpc) client
-  network_client_.reset(new xtreemfs::rpc::Client(
-      volume_options_.connect_timeout_s,  // Connect timeout.
-      volume_options_.request_timeout_s,  // Request timeout.
-      volume_options_.linger_timeout_s,  // Linger timeout.
-      volume_ssl_options_));
-
-  // Create thread which runs the network client.
-  network_client_thread_.reset(
-      new boost::thread(boost::bind(&xtreemfs::rpc::Client::run,
-                                    network_client_.get())));
+  network_client_ = client_->shared_network_client();
+  if (network_client_ == NULL) {
+    // start network (rpc) client
+    own_network_client_.reset(new xtreemfs::rpc::Client(
+        volume_options_.connect_timeout_s,  // Connect timeout.
+        volume_options_.request_timeout_s,  // Request timeout.
+        volume_options_.linger_timeout_s,  // Linger timeout.
+        volume_ssl_options_,
+        volume_options_.rpc_io_threads,
+        volume_options_.max_connections_per_server));
+    own_network_client_->set_server_statistics(client_->server_statistics());
+    network_client_ = own_network_client_.get();
+
+    // Create thread which runs the network client.
+    network_client_thread_.reset(
+        new boost::thread(boost::bind(&xtreemfs::rpc::Client::run,
+                                      network_client_)));
+  }
   // Create MRC and OSDServiceClient wrapper.
-  mrc_service_client_.reset(new MRCServiceClient(network_client_.get()));
-  osd_service_client_.reset(new OSDServiceClient(network_client_.get()));
+  mrc_service_client_.reset(new MRCServiceClient(network_client_));
+  osd_service_client_.reset(new OSDServiceClient(network_client_));
+  mrc_request_batcher_.reset(new MRCRequestBatcher(
+      mrc_service_client_.get(),
+      uuid_resolver_,
+      mrc_uuid_iterator_.get(),
+      auth_bogus_,
+      user_credentials_bogus_,
+      volume_options_.periodic_mrc_batch_size));
 
   // Register StripingPolicies.
   stripe_translators_[STRIPING_POLICY_RAID0] = new StripeTranslatorRaid0();
+  stripe_translators_[STRIPING_POLICY_ERASURECODE] =
+      new StripeTranslatorErasureCode();
+
+  const bool combine_async_writes =
+      volume_options_.enable_async_writes &&
+      volume_options_.async_writes_combine_timeout_ms > 0;
+  periodic_task_scheduler_ = client_->periodic_task_scheduler();
+  if (periodic_task_scheduler_) {
+    // Let the thread of the Client run the periodic tasks.
+    periodic_task_ids_.push_back(periodic_task_scheduler_->Schedule(
+        boost::bind(&xtreemfs::VolumeImplementation::RenewXCaps, this),
+        boost::posix_time::seconds(
+            volume_options_.periodic_xcap_renewal_interval_s)));
+    periodic_task_ids_.push_back(periodic_task_scheduler_->Schedule(
+        boost::bind(&xtreemfs::VolumeImplementation::WriteBackFileSizes, this),
+        boost::posix_time::seconds(
+            volume_options_.periodic_file_size_updates_interval_s)));
+    if (combine_async_writes) {
+      periodic_task_ids_.push_back(periodic_task_scheduler_->Schedule(
+          boost::bind(&xtreemfs::VolumeImplementation::FlushCombinedAsyncWrites,
+                      this),
+          boost::posix_time::milliseconds(
+              volume_options_.async_writes_combine_timeout_ms)));
+    }
+    return;
+  }
 
   // Start periodic threads.
   xcap_renewal_thread_.reset(new boost::thread(boost::bind(
@@ -106,17 +178,39 @@ void VolumeImplementation::Start() {
   filesize_writeback_thread_.reset(new boost::thread(boost::bind(
       &xtreemfs::VolumeImplementation::PeriodicFileSizeUpdate,
       this)));
+  if (combine_async_writes) {
+    async_write_combiner_flush_thread_.reset(new boost::thread(boost::bind(
+        &xtreemfs::VolumeImplementation::PeriodicAsyncWriteCombinerFlush,
+        this)));
+  }
 }
 
 /**
  * @throws OpenFileHandlesLeftException
  */
 void VolumeImplementation::CloseInternal() {
-  // Stop periodic threads.
-  filesize_writeback_thread_->interrupt();
-  xcap_renewal_thread_->interrupt();
-  filesize_writeback_thread_->join();
-  xcap_renewal_thread_->join();
+  // Stop periodic tasks.
+  for (size_t i = 0; i < periodic_task_ids_.size(); ++i) {
+    periodic_task_scheduler_->Cancel(periodic_task_ids_[i]);
+  }
+  periodic_task_ids_.clear();
+  if (filesize_writeback_thread_.get()) {
+    filesize_writeback_thread_->interrupt();
+    xcap_renewal_thread_->interrupt();
+  }
+  if (async_write_combiner_flush_thread_.get()) {
+    async_write_combiner_flush_thread_->interrupt();
+  }
+  if (filesize_writeback_thread_.get()) {
+    filesize_writeback_thread_->join();
+    xcap_renewal_thread_->join();
+  }
+  if (async_write_combiner_flush_thread_.get()) {
+    async_write_combiner_flush_thread_->join();
+  }
+
+  // Wait for prefetched readdir chunks before the network client is stopped.
+  readdir_prefetcher_.Clear();
 
   boost::mutex::scoped_lock lock_oft(open_file_table_mutex_);
 
@@ -129,9 +223,11 @@ void VolumeImplementation::CloseInternal() {
     ErrorLog::error_log->AppendError(error);
   }
 
-  // Shutdown network client.
-  network_client_->shutdown();
-  network_client_thread_->join();
+  // Shutdown network client. A shared one is shut down by the Client.
+  if (own_network_client_.get()) {
+    own_network_client_->shutdown();
+    network_client_thread_->join();
+  }
 }
 
 void VolumeImplementation::Close() {
@@ -225,6 +321,8 @@ void VolumeImplementation::Symlink(
   // TODO(mberlin): Retrieve stat as optional member of the response instead
   //                and update cached DirectoryEntries accordingly.
   metadata_cache_.InvalidateDirEntries(parent_dir);
+  // Remove a negative entry of the created link.
+  metadata_cache_.Invalidate(link_path);
 
   response->DeleteBuffers();
 }
@@ -375,6 +473,16 @@ FileHandle* VolumeImplementation::OpenFileWithTruncateSize(
     throw PosixErrorException(POSIX_ERROR_EIO, error);
   }
 
+  // Resolve the OSDs of the file before the first read or write needs them.
+  const XLocSet& xlocs = open_response->creds().xlocs();
+  vector<string> osd_uuids;
+  for (int i = 0; i < xlocs.replicas_size(); ++i) {
+    for (int j = 0; j < xlocs.replicas(i).osd_uuids_size(); ++j) {
+      osd_uuids.push_back(xlocs.replicas(i).osd_uuids(j));
+    }
+  }
+  uuid_resolver_->PrefetchUUIDs(osd_uuids);
+
   FileHandleImplementation* file_handle = NULL;
   // Create a FileInfo object if it does not exist yet.
   {
@@ -406,6 +514,8 @@ FileHandle* VolumeImplementation::OpenFileWithTruncateSize(
     // TODO(mberlin): Retrieve stat as optional member of openResponse instead
     //                and update cached DirectoryEntries accordingly.
     metadata_cache_.InvalidateDirEntries(parent_dir);
+    // Remove a negative entry of the created file.
+    metadata_cache_.Invalidate(path);
   }
 
   // If O_TRUNC was set, go on processing the truncate request.
@@ -505,6 +615,11 @@ void VolumeImplementation::GetAttr(
   GetAttr(user_credentials, path, ignore_metadata_cache, stat_buffer, NULL);
 }
 
+bool VolumeImplementation::GetCachedStat(const std::string& path,
+                                         xtreemfs::pbrpc::Stat* stat) {
+  return metadata_cache_.GetStat(path, stat) == MetadataCache::kStatCached;
+}
+
 void VolumeImplementation::GetAttrHelper(
     const xtreemfs::pbrpc::UserCredentials& user_credentials,
     const std::string& path,
@@ -517,6 +632,7 @@ void VolumeImplementation::GetAttrHelper(
 
     if (stat_cached == MetadataCache::kStatCached) {
       // Found in StatCache.
+      stat_cache_hits_counter->Increment();
       if (Logging::log->loggingActive(LEVEL_DEBUG)) {
         Logging::log->getLog(LEVEL_DEBUG)
             << "getattr: serving from stat-cache " << path
@@ -524,10 +640,12 @@ void VolumeImplementation::GetAttrHelper(
       }
       return;
     } else if (stat_cached == MetadataCache::kPathDoesntExist) {
+      stat_cache_hits_counter->Increment();
       throw PosixErrorException(
           POSIX_ERROR_ENOENT,
           "Path was not found in the cached parent directory. Path: " + path);
     }
+    stat_cache_misses_counter->Increment();
   }
 
   // Not found in StatCache, retrieve from MRC.
@@ -536,18 +654,26 @@ void VolumeImplementation::GetAttrHelper(
   rq.set_path(path);
   rq.set_known_etag(0);
 
-  boost::scoped_ptr<rpc::SyncCallbackBase> response(
-      ExecuteSyncRequest(
-          boost::bind(
-              &xtreemfs::pbrpc::MRCServiceClient::getattr_sync,
-              mrc_service_client_.get(),
-              _1,
-              boost::cref(auth_bogus_),
-              boost::cref(user_credentials),
-              &rq),
-          mrc_uuid_iterator_.get(),
-          uuid_resolver_,
-          RPCOptionsFromOptions(volume_options_)));
+  boost::scoped_ptr<rpc::SyncCallbackBase> response;
+  try {
+    response.reset(ExecuteSyncRequest(
+        boost::bind(
+            &xtreemfs::pbrpc::MRCServiceClient::getattr_sync,
+            mrc_service_client_.get(),
+            _1,
+            boost::cref(auth_bogus_),
+            boost::cref(user_credentials),
+            &rq),
+        mrc_uuid_iterator_.get(),
+        uuid_resolver_,
+        RPCOptionsFromOptions(volume_options_)));
+  } catch (const PosixErrorException& e) {
+    if (e.posix_errno() == POSIX_ERROR_ENOENT) {
+      // Save the next lookups of the missing path, e.g. by include searches.
+      metadata_cache_.UpdateNegativeEntry(path);
+    }
+    throw;
+  }
   getattrResponse* getattr = static_cast<getattrResponse*>(
       response->response());
 
@@ -819,11 +945,12 @@ void VolumeImplementation::Rename(
   metadata_cache_.InvalidateDirEntry(parent_path, GetBasename(path));
   // TODO(mberlin): Add DirEntry instead to parent_new_path if stat available.
   metadata_cache_.InvalidateDirEntries(parent_new_path);
-  // Overwrite an existing entry; no Prefix() operation needed because:
+  // Overwrite an existing entry. An existing directory "new_path" has to be
+  // empty, but negative entries of paths below it have to be removed, too:
   //    "If new names an existing directory, it shall be required to be an empty
   //     directory."
   //    see http://pubs.opengroup.org/onlinepubs/009695399/functions/rename.html
-  metadata_cache_.Invalidate(new_path);
+  metadata_cache_.InvalidatePrefix(new_path);
   // Rename all affected entries.
   metadata_cache_.RenamePrefix(path, new_path);
   // http://pubs.opengroup.org/onlinepubs/009695399/functions/rename.html:
@@ -879,6 +1006,8 @@ void VolumeImplementation::MakeDirectory(
   // TODO(mberlin): Retrieve stat as optional member of openResponse instead
   //                and update cached DirectoryEntries accordingly.
   metadata_cache_.InvalidateDirEntries(parent_dir);
+  // Remove a negative entry of the created directory.
+  metadata_cache_.Invalidate(path);
 
   response->DeleteBuffers();
 }
@@ -954,8 +1083,24 @@ xtreemfs::pbrpc::DirectoryEntries* VolumeImplementation::ReadDir(
 
   result = metadata_cache_.GetDirEntries(path, offset, count);
   if (result != NULL) {
+    dir_cache_hits_counter->Increment();
     return result;
   }
+  dir_cache_misses_counter->Increment();
+
+  // Chunks of the same directory are only reused by the same user.
+  string listing_key = path + '\0' + user_credentials.username();
+  for (int i = 0; i < user_credentials.groups_size(); ++i) {
+    listing_key += '\0' + user_credentials.groups(i);
+  }
+  if (names_only) {
+    listing_key += '\0';
+    listing_key += "names_only";
+  }
+  if (offset == 0) {
+    // A new listing must see the current directory contents.
+    readdir_prefetcher_.Reset(listing_key);
+  }
 
   // Process large requests in multiples of readdir_chunk_size.
   readdirRequest rq;
@@ -963,50 +1108,72 @@ xtreemfs::pbrpc::DirectoryEntries* VolumeImplementation::ReadDir(
   rq.set_known_etag(0);
   rq.set_path(path);
   rq.set_names_only(names_only);
-  for (uint64_t current_offset = offset;
-       current_offset < offset + count;
-       current_offset += volume_options_.readdir_chunk_size) {
-    rq.set_seen_directory_entries_count(current_offset);
+  const uint32_t chunk_size =
+      static_cast<uint32_t>(volume_options_.readdir_chunk_size);
+  const uint64_t end = offset + count;
+  uint64_t current_offset = offset;
+  bool last_chunk = false;
+  while (current_offset < end && !last_chunk) {
     // Read complete chunk or only remaining rest.
-    rq.set_limit_directory_entries_count(static_cast<uint32_t>(
-        current_offset > offset + count ?
-        current_offset - offset - count : volume_options_.readdir_chunk_size));
-
-    boost::scoped_ptr<rpc::SyncCallbackBase> response(
-        ExecuteSyncRequest(
-            boost::bind(
-                &xtreemfs::pbrpc::MRCServiceClient::readdir_sync,
-                mrc_service_client_.get(),
-                _1,
-                boost::cref(auth_bogus_),
-                boost::cref(user_credentials),
-                &rq),
-            mrc_uuid_iterator_.get(),
-            uuid_resolver_,
-            RPCOptionsFromOptions(volume_options_)));
-    DirectoryEntries* dentries = static_cast<DirectoryEntries*>(
-        response->response());
-
-    // Process request and free memory.
-    if (current_offset == offset) {
-      // First chunk
-      result = dentries;
-
+    const uint32_t limit =
+        static_cast<uint32_t>(min<uint64_t>(chunk_size, end - current_offset));
+    DirectoryEntries* dentries =
+        readdir_prefetcher_.Take(listing_key, current_offset, limit);
+    if (dentries == NULL) {
+      rq.set_seen_directory_entries_count(current_offset);
+      rq.set_limit_directory_entries_count(limit);
+      boost::scoped_ptr<rpc::SyncCallbackBase> response(
+          ExecuteSyncRequest(
+              boost::bind(
+                  &xtreemfs::pbrpc::MRCServiceClient::readdir_sync,
+                  mrc_service_client_.get(),
+                  _1,
+                  boost::cref(auth_bogus_),
+                  boost::cref(user_credentials),
+                  &rq),
+              mrc_uuid_iterator_.get(),
+              uuid_resolver_,
+              RPCOptionsFromOptions(volume_options_)));
+      dentries = static_cast<DirectoryEntries*>(response->response());
       // Delete everything except the response.
       delete[] response->data();
       delete response->error();
+    }
+
+    last_chunk = static_cast<uint32_t>(dentries->entries_size()) < limit;
+    current_offset += limit;
+    if (!last_chunk && readdir_prefetcher_.enabled()) {
+      // Request the next chunks while this one is processed, also beyond
+      // "end" as the listing is usually continued by the next ReadDir().
+      try {
+        string mrc_uuid;
+        string mrc_address;
+        mrc_uuid_iterator_->GetUUID(&mrc_uuid);
+        uuid_resolver_->UUIDToAddress(mrc_uuid, &mrc_address);
+        readdir_prefetcher_.Prefetch(
+            listing_key,
+            current_offset,
+            chunk_size,
+            boost::bind(&VolumeImplementation::SendReadDirRequest,
+                        this,
+                        mrc_address,
+                        boost::cref(user_credentials),
+                        boost::cref(rq),
+                        _1,
+                        _2));
+      } catch (const XtreemFSException&) {
+        // Without prefetching, the chunks are requested when they are read.
+      }
+    }
+
+    if (result == NULL) {
+      result = dentries;
     } else {
       // Further chunks. Merge them into first chunk.
       for (int i = 0; i < dentries->entries_size(); i++) {
         result->add_entries()->CopyFrom(dentries->entries(i));
       }
-      response->DeleteBuffers();
-    }
-
-    // Break if this is the last chunk.
-    if (result->entries_size() <
-        (current_offset + volume_options_.readdir_chunk_size)) {
-      break;
+      delete dentries;
     }
   }
 
@@ -1026,7 +1193,7 @@ xtreemfs::pbrpc::DirectoryEntries* VolumeImplementation::ReadDir(
         string parent_dir = ResolveParentDirectory(path);
         metadata_cache_.UpdateStat(parent_dir, dentry.stbuf());
       } else if (dentry.stbuf().nlink() > 1) {  // Do not cache hard links.
-        metadata_cache_.Invalidate(path);
+        metadata_cache_.Invalidate(ConcatenatePath(path, dentry.name()));
       } else {
         metadata_cache_.UpdateStat(
             ConcatenatePath(path, dentry.name()),
@@ -1041,15 +1208,34 @@ xtreemfs::pbrpc::DirectoryEntries* VolumeImplementation::ReadDir(
   // TODO(mberlin): Cache only names and no stat entries and remove names_only
   //                condition.
   // TODO(mberlin): Set an upper bound of dentries, otherwise don't cache it.
-  if (offset == 0 &&
-      static_cast<uint32_t>(result->entries_size()) < count &&
-      !names_only) {
-    metadata_cache_.UpdateDirEntries(path, *result);
+  if (offset == 0 && static_cast<uint32_t>(result->entries_size()) < count) {
+    if (names_only) {
+      // Still, lookups of missing names can be answered from the names.
+      metadata_cache_.UpdateDirNames(path, *result);
+    } else {
+      metadata_cache_.UpdateDirEntries(path, *result);
+    }
   }
 
   return result;
 }
 
+/** Sends a readdir request for the chunk of "limit" entries from "offset" on
+ *  directly to "mrc_address", used by the ReadDirPrefetcher. */
+rpc::SyncCallbackBase* VolumeImplementation::SendReadDirRequest(
+    const std::string& mrc_address,
+    const xtreemfs::pbrpc::UserCredentials& user_credentials,
+    const xtreemfs::pbrpc::readdirRequest& request,
+    uint64_t offset,
+    uint32_t limit) {
+  readdirRequest rq(request);
+  rq.set_seen_directory_entries_count(offset);
+  rq.set_limit_directory_entries_count(limit);
+  // The request is serialized immediately, "rq" may go out of scope.
+  return mrc_service_client_->readdir_sync(
+      mrc_address, auth_bogus_, user_credentials, &rq);
+}
+
 /**
  * @warning This implementation does return cached values for "xtreemfs.*"
  *          attributes. Use ListXAttrs(user_credentials, path, false) to make
@@ -1466,7 +1652,7 @@ void VolumeImplementation::RemoveReplica(
   creds->mutable_xlocs()->CopyFrom(replica_removeResponse->unlink_xloc());
   creds->mutable_xcap()->CopyFrom(replica_removeResponse->unlink_xcap());
 
-  OSDServiceClient osd_service_client(network_client_.get());
+  OSDServiceClient osd_service_client(network_client_);
   boost::scoped_ptr<rpc::SyncCallbackBase> response_osd(
       ExecuteSyncRequest(
           boost::bind(
@@ -1652,30 +1838,7 @@ void VolumeImplementation::PeriodicXCapRenewal() {
         volume_options_.periodic_xcap_renewal_interval_s);
     boost::this_thread::sleep(interval);
 
-    {
-      boost::mutex::scoped_lock lock(open_file_table_mutex_);
-
-      if (Logging::log->loggingActive(LEVEL_DEBUG)) {
-        Logging::log->getLog(LEVEL_DEBUG)
-            << "START open_file_table: Periodic XCap renewal for "
-            << open_file_table_.size()
-            << " open files." << endl;
-      }
-
-      // Iterate over the open_file_table_.
-      map<uint64_t, FileInfo*>::iterator it;
-      for (it = open_file_table_.begin();
-           it != open_file_table_.end(); ++it) {
-        it->second->RenewXCapsAsync(periodic_threads_options_);
-      }
-
-      if (Logging::log->loggingActive(LEVEL_DEBUG)) {
-        Logging::log->getLog(LEVEL_DEBUG)
-            << "END open_file_table: Periodic XCap renewal for "
-            << open_file_table_.size()
-            << " open files." << std::endl;
-      }
-    }
+    RenewXCaps();
   }
 }
 
@@ -1686,29 +1849,104 @@ void VolumeImplementation::PeriodicFileSizeUpdate() {
         volume_options_.periodic_file_size_updates_interval_s);
     boost::this_thread::sleep(interval);
 
-    {
-      boost::mutex::scoped_lock lock(open_file_table_mutex_);
+    WriteBackFileSizes();
+  }
+}
 
-      if (Logging::log->loggingActive(LEVEL_DEBUG)) {
-        Logging::log->getLog(LEVEL_DEBUG)
-            << "START open_file_table: Periodic filesize update for "
-            << open_file_table_.size()
-            << " open files." << std::endl;
-      }
+void VolumeImplementation::PeriodicAsyncWriteCombinerFlush() {
+  const boost::posix_time::milliseconds timeout(
+      volume_options_.async_writes_combine_timeout_ms);
+  while (true) {
+    boost::this_thread::sleep(timeout);
 
-      // Iterate over the open_file_table_.
-      map<uint64_t, FileInfo*>::iterator it;
-      for (it = open_file_table_.begin();
-           it != open_file_table_.end(); ++it) {
-        it->second->WriteBackFileSizeAsync(periodic_threads_options_);
-      }
+    FlushCombinedAsyncWrites();
+  }
+}
 
-      if (Logging::log->loggingActive(LEVEL_DEBUG)) {
-        Logging::log->getLog(LEVEL_DEBUG)
-            << "END open_file_table: Periodic filesize update for "
-            << open_file_table_.size()
-            << " open files." << std::endl;
-      }
+void VolumeImplementation::RenewXCaps() {
+  boost::mutex::scoped_lock lock(open_file_table_mutex_);
+
+  if (Logging::log->loggingActive(LEVEL_DEBUG)) {
+    Logging::log->getLog(LEVEL_DEBUG)
+        << "START open_file_table: Periodic XCap renewal for "
+        << open_file_table_.size()
+        << " open files." << endl;
+  }
+
+  // Iterate over the open_file_table_.
+  map<uint64_t, FileInfo*>::iterator it;
+  if (mrc_request_batcher_->batching_supported()) {
+    MRCRequestBatcher::XCapRenewals renewals;
+    for (it = open_file_table_.begin();
+         it != open_file_table_.end(); ++it) {
+      it->second->AddXCapRenewals(&renewals);
+    }
+    mrc_request_batcher_->SendXCapRenewals(renewals,
+                                           periodic_threads_options_);
+  } else {
+    for (it = open_file_table_.begin();
+         it != open_file_table_.end(); ++it) {
+      it->second->RenewXCapsAsync(periodic_threads_options_);
+    }
+  }
+
+  if (Logging::log->loggingActive(LEVEL_DEBUG)) {
+    Logging::log->getLog(LEVEL_DEBUG)
+        << "END open_file_table: Periodic XCap renewal for "
+        << open_file_table_.size()
+        << " open files." << std::endl;
+  }
+}
+
+void VolumeImplementation::WriteBackFileSizes() {
+  boost::mutex::scoped_lock lock(open_file_table_mutex_);
+
+  if (Logging::log->loggingActive(LEVEL_DEBUG)) {
+    Logging::log->getLog(LEVEL_DEBUG)
+        << "START open_file_table: Periodic filesize update for "
+        << open_file_table_.size()
+        << " open files." << std::endl;
+  }
+
+  // Iterate over the open_file_table_.
+  map<uint64_t, FileInfo*>::iterator it;
+  if (mrc_request_batcher_->batching_supported()) {
+    MRCRequestBatcher::FileSizeUpdates updates;
+    for (it = open_file_table_.begin();
+         it != open_file_table_.end(); ++it) {
+      it->second->AddFileSizeUpdate(&updates);
+    }
+    mrc_request_batcher_->SendFileSizeUpdates(updates,
+                                              periodic_threads_options_);
+  } else {
+    for (it = open_file_table_.begin();
+         it != open_file_table_.end(); ++it) {
+      it->second->WriteBackFileSizeAsync(periodic_threads_options_);
+    }
+  }
+
+  if (Logging::log->loggingActive(LEVEL_DEBUG)) {
+    Logging::log->getLog(LEVEL_DEBUG)
+        << "END open_file_table: Periodic filesize update for "
+        << open_file_table_.size()
+        << " open files." << std::endl;
+  }
+}
+
+void VolumeImplementation::FlushCombinedAsyncWrites() {
+  boost::mutex::scoped_lock lock(open_file_table_mutex_);
+
+  // Send combined writes which were held back for longer than the timeout.
+  const boost::posix_time::ptime deadline =
+      util::MonotonicTime() - boost::posix_time::milliseconds(
+          volume_options_.async_writes_combine_timeout_ms);
+  map<uint64_t, FileInfo*>::iterator it;
+  for (it = open_file_table_.begin();
+       it != open_file_table_.end(); ++it) {
+    try {
+      it->second->FlushCombinedAsyncWrites(deadline);
+    } catch (const XtreemFSException&) {
+      // Already logged, the FileHandle reports the error to the user.
     }
   }
 }
@@ -0,0 +1,98 @@
+/*
+ * Copyright (c) 2015 by Zuse Institute Berlin
+ *
+ * Licensed under the BSD License, see LICENSE file for details.
+ *
+ */
+
+#include "rpc/buffer_pool.h"
+
+#include <cassert>
+
+using namespace std;
+
+namespace xtreemfs {
+namespace rpc {
+
+BufferPool::BufferPool(size_t min_buffer_size,
+                       size_t max_buffer_size,
+                       size_t max_free_buffers)
+    : min_buffer_size_(1),
+      max_buffer_size_(1),
+      max_free_buffers_(max_free_buffers) {
+  // Round the limits up to powers of two.
+  while (min_buffer_size_ < min_buffer_size) {
+    min_buffer_size_ <<= 1;
+  }
+  while (max_buffer_size_ < max_buffer_size) {
+    max_buffer_size_ <<= 1;
+  }
+  assert(min_buffer_size_ <= max_buffer_size_);
+
+  size_t classes = 1;
+  for (size_t size = min_buffer_size_; size < max_buffer_size_; size <<= 1) {
+    ++classes;
+  }
+  free_buffers_.resize(classes);
+}
+
+BufferPool::~BufferPool() {
+  for (size_t i = 0; i < free_buffers_.size(); ++i) {
+    for (size_t j = 0; j < free_buffers_[i].size(); ++j) {
+      delete[] free_buffers_[i][j];
+    }
+  }
+}
+
+char* BufferPool::Acquire(size_t size) {
+  const int size_class = SizeClass(size);
+  if (size_class == -1) {
+    return new char[size];
+  }
+
+  vector<char*>& free_list = free_buffers_[size_class];
+  if (free_list.empty()) {
+    return new char[min_buffer_size_ << size_class];
+  }
+  char* buffer = free_list.back();
+  free_list.pop_back();
+  return buffer;
+}
+
+void BufferPool::Release(char* buffer, size_t size) {
+  if (buffer == NULL) {
+    return;
+  }
+
+  const int size_class = SizeClass(size);
+  if (size_class == -1 ||
+      free_buffers_[size_class].size() >= max_free_buffers_) {
+    delete[] buffer;
+  } else {
+    free_buffers_[size_class].push_back(buffer);
+  }
+}
+
+size_t BufferPool::free_buffers() const {
+  size_t free_buffers = 0;
+  for (size_t i = 0; i < free_buffers_.size(); ++i) {
+    free_buffers += free_buffers_[i].size();
+  }
+  return free_buffers;
+}
+
+int BufferPool::SizeClass(size_t size) const {
+  if (size > max_buffer_size_) {
+    return -1;
+  }
+  int size_class = 0;
+  for (size_t class_size = min_buffer_size_;
+       class_size < size;
+       class_size <<= 1) {
+    ++size_class;
+  }
+  return size_class;
+}
+
+}  // namespace rpc
+}  // namespace xtreemfs
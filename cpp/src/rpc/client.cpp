@@ -13,8 +13,10 @@
 
 #include <boost/algorithm/string/predicate.hpp>
 #include <boost/algorithm/string/trim.hpp>
+#include <boost/functional/hash.hpp>
 #include <boost/lexical_cast.hpp>
 #include <boost/interprocess/detail/atomic.hpp>
+#include <boost/thread/thread.hpp>
 #include <fstream>
 #include <iostream>
 #include <utility>
@@ -22,6 +24,7 @@
 #include <string>
 
 #include "util/logging.h"
+#include "util/monotonic_clock.h"
 
 #ifdef HAS_OPENSSL
 #include <boost/asio/ssl.hpp>
@@ -45,8 +48,10 @@ using namespace google::protobuf;
 
 #if (BOOST_VERSION < 104800)
 using boost::interprocess::detail::atomic_inc32;
+using boost::interprocess::detail::atomic_read32;
 #else
 using boost::interprocess::ipcdetail::atomic_inc32;
+using boost::interprocess::ipcdetail::atomic_read32;
 #endif  // BOOST_VERSION < 104800
 
 #ifdef _MSC_VER
@@ -58,30 +63,42 @@ using boost::interprocess::ipcdetail::atomic_inc32;
 namespace xtreemfs {
 namespace rpc {
 
+const int Client::kTimeoutTickMs;
+const int Client::kTimeoutWheelSlots;
+const int Client::kMinReceiveBufferSize;
+const int Client::kMaxReceiveBufferSize;
+const int Client::kMaxFreeReceiveBuffers;
+
 Client::Client(int32_t connect_timeout_s,
                int32_t request_timeout_s,
                int32_t max_con_linger,
-               const SSLOptions* options)
-    : service_(),
+               const SSLOptions* options,
+               int io_threads,
+               int max_connections_per_server)
+    : max_connections_per_server_(max(max_connections_per_server, 1)),
       stopped_(false),
-      stopped_ioservice_only_(false),
       callid_counter_(1),
-      rq_timeout_timer_(service_),
       rq_timeout_s_(request_timeout_s),
+      server_statistics_(NULL),
       connect_timeout_s_(connect_timeout_s),
       max_con_linger_(max_con_linger)
-#ifndef HAS_OPENSSL
-{
-  // Delete SSL options because they are not used when not compiled with SSL.
-  delete options;
-}
-#else
+#ifdef HAS_OPENSSL
       ,use_gridssl_(false),
       ssl_options(options),
       pemFileName(NULL),
       certFileName(NULL),
       trustedCAsFileName(NULL),
-      ssl_context_(NULL) {
+      ssl_context_(NULL)
+#endif  // HAS_OPENSSL
+{
+  for (int i = 0; i < max(io_threads, 1); ++i) {
+    io_threads_.push_back(new IOThread());
+  }
+#ifndef HAS_OPENSSL
+  // Delete SSL options because they are not used when not compiled with SSL.
+  delete options;
+}
+#else
   // Check if ssl options were passed.
   if (options != NULL) {
     if (Logging::log->loggingActive(LEVEL_INFO)) {
@@ -90,7 +107,7 @@ Client::Client(int32_t connect_timeout_s,
 
     use_gridssl_ = options->use_grid_ssl();
     ssl_context_ = new boost::asio::ssl::context(
-        service_,
+        io_threads_[0]->service,
         string_to_ssl_method(
             options->ssl_method_string(),
             boost::asio::ssl::context_base::sslv23_client));
@@ -402,7 +419,10 @@ void Client::sendRequest(const string& address,
                          int data_length,
                          Message* response_message,
                          void* context,
-                         ClientRequestCallbackInterface *callback) {
+                         ClientRequestCallbackInterface *callback,
+                         int32_t timeout_s,
+                         char* response_data_buffer,
+                         uint32_t response_data_buffer_size) {
   uint32_t call_id = atomic_inc32(&callid_counter_);
   ClientRequest* request = new ClientRequest(address,
                                         call_id,
@@ -416,43 +436,80 @@ void Client::sendRequest(const string& address,
                                         response_message,
                                         context,
                                         callback);
-
-  boost::mutex::scoped_lock lock(requests_mutex_);
-  if (stopped_) {
+  request->set_timeout_s(timeout_s);
+  request->set_resp_data_buffer(response_data_buffer,
+                                response_data_buffer_size);
+
+  // Use the connection to the server with the fewest requests in flight.
+  const size_t address_hash = boost::hash<string>()(address);
+  vector<uint32_t>& loads = *GetServerLoads(address, address_hash);
+  int connection_number = 0;
+  uint32_t min_load = atomic_read32(&loads[0]);
+  for (int i = 1; i < max_connections_per_server_ && min_load > 0; ++i) {
+    uint32_t load = atomic_read32(&loads[i]);
+    if (load < min_load) {
+      connection_number = i;
+      min_load = load;
+    }
+  }
+  atomic_inc32(&loads[connection_number]);
+  request->set_connection(connection_number, &loads[connection_number]);
+  request->set_server_statistics(server_statistics_);
+
+  // Spread the connections of all servers across the io threads.
+  IOThread* io_thread =
+      io_threads_[(address_hash + connection_number) % io_threads_.size()];
+  boost::mutex::scoped_lock lock(io_thread->requests_mutex);
+  if (io_thread->stopped) {
     lock.unlock();
 
     AbortClientRequest(request,
                        "Request aborted since RPC client was stopped.");
   } else {
-    bool wasEmpty = requests_.empty();
-    requests_.push(request);
+    bool wasEmpty = io_thread->requests.empty();
+    io_thread->requests.push(request);
     if (wasEmpty) {
-      service_.post(boost::bind(&Client::sendInternalRequest, this));
+      io_thread->service.post(boost::bind(&Client::sendInternalRequest,
+                                          this,
+                                          io_thread));
     }
   }
 }
 
-void Client::sendInternalRequest() {
-  if (stopped_ioservice_only_) {
+vector<uint32_t>* Client::GetServerLoads(const string& address,
+                                         size_t address_hash) {
+  IOThread* io_thread = io_threads_[address_hash % io_threads_.size()];
+  boost::mutex::scoped_lock lock(io_thread->requests_mutex);
+  server_load_map::iterator loads = io_thread->server_loads.find(address);
+  if (loads == io_thread->server_loads.end()) {
+    loads = io_thread->server_loads.insert(make_pair(
+        address, vector<uint32_t>(max_connections_per_server_, 0))).first;
+  }
+  return &loads->second;
+}
+
+void Client::sendInternalRequest(IOThread* io_thread) {
+  if (io_thread->stopped_ioservice_only) {
     return;
   }
   // Process requests.
   do {
     ClientRequest *rq = NULL;
     {
-      boost::mutex::scoped_lock lock(requests_mutex_);
-      if (requests_.empty())
+      boost::mutex::scoped_lock lock(io_thread->requests_mutex);
+      if (io_thread->requests.empty())
         break;
-      rq = requests_.front();
-      requests_.pop();
+      rq = io_thread->requests.front();
+      io_thread->requests.pop();
     }
     assert(rq != NULL);
 
-    rq->RequestSent();
+    rq->RequestSent(rq_timeout_s_);
 
+    const connection_key key(rq->address(), rq->connection_number());
     ClientConnection *con = NULL;
-    connection_map::iterator iter = connections_.find(rq->address());
-    if (iter != connections_.end())
+    connection_map::iterator iter = io_thread->connections.find(key);
+    if (iter != io_thread->connections.end())
       con = iter->second;
     if (con) {
       con->AddRequest(rq);
@@ -476,8 +533,10 @@ void Client::sendInternalRequest() {
 
           con = new ClientConnection(server,
                                      port,
-                                     service_,
-                                     &request_table_,
+                                     io_thread->service,
+                                     &io_thread->request_table,
+                                     &io_thread->timeouts,
+                                     &io_thread->receive_buffers,
                                      connect_timeout_s_,
                                      connect_timeout_s_
 #ifdef HAS_OPENSSL
@@ -491,7 +550,7 @@ void Client::sendInternalRequest() {
                 << addr << endl;
           }
 
-          connections_[addr] = con;
+          io_thread->connections[key] = con;
           con->AddRequest(rq);
           con->DoProcess();
         } catch(std::out_of_range &exception) {
@@ -508,48 +567,44 @@ void Client::sendInternalRequest() {
   } while (true);
 }
 
-void Client::handleTimeout(const boost::system::error_code& error) {
+void Client::handleTimeout(IOThread* io_thread,
+                           const boost::system::error_code& error) {
   // Do nothing when the timer was canceled.
   if (error == boost::asio::error::operation_aborted
-      || stopped_ioservice_only_) {
+      || io_thread->stopped_ioservice_only) {
     return;
   }
 
   try {
-    posix_time::ptime deadline = posix_time::microsec_clock::local_time()
-        - posix_time::seconds(rq_timeout_s_);
-
     // Connections which have timed out requests have to be reset later.
     set<ClientConnection*> to_be_reset_cons;
 
     // Remove all timed out requests.
-    request_map::iterator iter = request_table_.begin();
-    while (iter != request_table_.end()) {
-      ClientRequest* rq = iter->second;
-      if (rq->time_sent() < deadline) {
-        ClientConnection* respective_con = rq->client_connection();
-        assert(respective_con);
-        to_be_reset_cons.insert(respective_con);
-
-        string error = "Request timed out (call id = "
-            + boost::lexical_cast<string>(rq->call_id())
-            + ", interface id = "
-            + boost::lexical_cast<string>(rq->interface_id())
-            + ", proc id = " + boost::lexical_cast<string>(rq->proc_id())
-            + ", server = " + respective_con->GetServerAddress()
-            + ").";
-        RPCHeader::ErrorResponse* err = new RPCHeader::ErrorResponse();
-        err->set_error_message(error);
-        err->set_error_type(IO_ERROR);
-        err->set_posix_errno(POSIX_ERROR_EINVAL);
-        rq->set_error(err);
-        rq->ExecuteCallback();
-        request_table_.erase(iter++);
-        if (Logging::log->loggingActive(LEVEL_INFO)) {
-          Logging::log->getLog(LEVEL_INFO) << error << endl;
-        }
-      } else {
-        ++iter;
+    vector<ClientRequest*> timed_out_requests;
+    io_thread->timeouts.Expire(util::MonotonicTime(),
+                               &timed_out_requests);
+    for (size_t i = 0; i < timed_out_requests.size(); ++i) {
+      ClientRequest* rq = timed_out_requests[i];
+      ClientConnection* respective_con = rq->client_connection();
+      assert(respective_con);
+      to_be_reset_cons.insert(respective_con);
+
+      string error = "Request timed out (call id = "
+          + boost::lexical_cast<string>(rq->call_id())
+          + ", interface id = "
+          + boost::lexical_cast<string>(rq->interface_id())
+          + ", proc id = " + boost::lexical_cast<string>(rq->proc_id())
+          + ", server = " + respective_con->GetServerAddress()
+          + ").";
+      RPCHeader::ErrorResponse* err = new RPCHeader::ErrorResponse();
+      err->set_error_message(error);
+      err->set_error_type(IO_ERROR);
+      err->set_posix_errno(POSIX_ERROR_EINVAL);
+      rq->set_error(err);
+      io_thread->request_table.erase(rq->call_id());
+      rq->ExecuteCallback();
+      if (Logging::log->loggingActive(LEVEL_INFO)) {
+        Logging::log->getLog(LEVEL_INFO) << error << endl;
       }
     }
 
@@ -576,11 +631,12 @@ void Client::handleTimeout(const boost::system::error_code& error) {
     }
 
     // Close inactive connections.
-    posix_time::ptime linger_deadline = posix_time::microsec_clock::local_time()
+    posix_time::ptime linger_deadline = util::MonotonicTime()
         - posix_time::seconds(max_con_linger_);
 
-    connection_map::iterator iter2 = connections_.begin();
-    while (iter2 != connections_.end()) {
+    connection_map& connections = io_thread->connections;
+    connection_map::iterator iter2 = connections.begin();
+    while (iter2 != connections.end()) {
       ClientConnection* con = iter2->second;
       assert(con != NULL);
       if (con->last_used() < linger_deadline) {
@@ -589,11 +645,12 @@ void Client::handleTimeout(const boost::system::error_code& error) {
             + " seconds.";
         if (Logging::log->loggingActive(LEVEL_INFO)) {
           Logging::log->getLog(LEVEL_INFO) << "Closing connection to '"
-              << iter2->first << "' since it " << error.substr(11) << endl;
+              << iter2->first.first << "' since it " << error.substr(11)
+              << endl;
         }
         con->Close(error);
         delete con;
-        connections_.erase(iter2++);
+        connections.erase(iter2++);
       } else {
         ++iter2;
       }
@@ -602,10 +659,13 @@ void Client::handleTimeout(const boost::system::error_code& error) {
     Logging::log->getLog(LEVEL_ERROR) << "An exception occurred while checking"
         " for timed out requests and connections: " << e.what() << endl;
   }
-  rq_timeout_timer_.expires_from_now(posix_time::seconds(rq_timeout_s_));
-  rq_timeout_timer_.async_wait(boost::bind(&Client::handleTimeout,
-                                           this,
-                                           asio::placeholders::error));
+  io_thread->rq_timeout_timer.expires_from_now(
+      posix_time::milliseconds(kTimeoutTickMs));
+  io_thread->rq_timeout_timer.async_wait(
+      boost::bind(&Client::handleTimeout,
+                  this,
+                  io_thread,
+                  asio::placeholders::error));
 }
 
 void Client::AbortClientRequest(ClientRequest* request,
@@ -627,11 +687,6 @@ void Client::AbortClientRequest(ClientRequest* request,
 }
 
 void Client::run() {
-  rq_timeout_timer_.expires_from_now(posix_time::seconds(rq_timeout_s_));
-  rq_timeout_timer_.async_wait(boost::bind(&Client::handleTimeout,
-                                           this,
-                                           asio::placeholders::error));
-
   if (Logging::log->loggingActive(LEVEL_DEBUG)) {
     Logging::log->getLog(LEVEL_DEBUG) << "Starting RPC client." << endl;
 #ifndef HAS_OPENSSL
@@ -647,27 +702,49 @@ void Client::run() {
       Logging::log->getLog(LEVEL_DEBUG) << "Running in plain TCP mode."<< endl;
     }
 #endif  // !HAS_OPENSSL
+    Logging::log->getLog(LEVEL_DEBUG) << "Using " << io_threads_.size()
+        << " io thread(s) and up to " << max_connections_per_server_
+        << " connection(s) per server." << endl;
   }
 
+  boost::thread_group threads;
+  for (size_t i = 1; i < io_threads_.size(); ++i) {
+    threads.create_thread(boost::bind(&Client::RunIOThread,
+                                      this,
+                                      io_threads_[i]));
+  }
+  RunIOThread(io_threads_[0]);
+  threads.join_all();
+}
+
+void Client::RunIOThread(IOThread* io_thread) {
+  io_thread->rq_timeout_timer.expires_from_now(
+      posix_time::milliseconds(kTimeoutTickMs));
+  io_thread->rq_timeout_timer.async_wait(
+      boost::bind(&Client::handleTimeout,
+                  this,
+                  io_thread,
+                  asio::placeholders::error));
+
   // Does not return as long as there are running timers (e.g.,
-  // rq_timeout_timer_) or pending boost::asio callbacks.
-  service_.run();
+  // rq_timeout_timer) or pending boost::asio callbacks.
+  io_thread->service.run();
 
   // Delete the ClientConnection object of all open connections.
-  for (connection_map::iterator iter = connections_.begin();
-       iter != connections_.end();
+  for (connection_map::iterator iter = io_thread->connections.begin();
+       iter != io_thread->connections.end();
        ++iter) {
     delete iter->second;
   }
-  connections_.clear();
+  io_thread->connections.clear();
 
-  // A request may not have made it from requests_ to request_table_. Cancel
+  // A request may not have made it from requests to request_table. Cancel
   // those, too.
   {
-    boost::mutex::scoped_lock lock(requests_mutex_);
-    while (requests_.size()) {
-      ClientRequest* request = requests_.front();
-      requests_.pop();
+    boost::mutex::scoped_lock lock(io_thread->requests_mutex);
+    while (io_thread->requests.size()) {
+      ClientRequest* request = io_thread->requests.front();
+      io_thread->requests.pop();
 
       AbortClientRequest(request,
                          "Request aborted since RPC client was stopped.");
@@ -676,13 +753,14 @@ void Client::run() {
 
   // Delete requests which were successfully sent, but not response was received
   // for them.
-  for (request_map::iterator iter = request_table_.begin();
-       iter != request_table_.end();
+  io_thread->timeouts.Clear();
+  for (request_map::iterator iter = io_thread->request_table.begin();
+       iter != io_thread->request_table.end();
        ++iter) {
     AbortClientRequest(iter->second,
                        "Request aborted since RPC client was stopped.");
   }
-  request_table_.clear();
+  io_thread->request_table.clear();
 
 #ifdef HAS_OPENSSL
   // Cleanup thread-local OpenSSL state.
@@ -693,16 +771,24 @@ void Client::run() {
 void Client::shutdown() {
   bool already_stopped = false;
   {
-    boost::mutex::scoped_lock lock(requests_mutex_);
+    boost::mutex::scoped_lock lock(stopped_mutex_);
     already_stopped = stopped_;
     stopped_ = true;
   }
 
   if (!already_stopped) {
+    for (size_t i = 0; i < io_threads_.size(); ++i) {
+      boost::mutex::scoped_lock lock(io_threads_[i]->requests_mutex);
+      io_threads_[i]->stopped = true;
+    }
     if (Logging::log->loggingActive(LEVEL_DEBUG)) {
       Logging::log->getLog(LEVEL_DEBUG) << "RPC client stopped." << endl;
     }
-    service_.post(boost::bind(&Client::ShutdownHandler, this));
+    for (size_t i = 0; i < io_threads_.size(); ++i) {
+      io_threads_[i]->service.post(boost::bind(&Client::ShutdownHandler,
+                                               this,
+                                               io_threads_[i]));
+    }
   } else {
     if (Logging::log->loggingActive(LEVEL_WARN)) {
       Logging::log->getLog(LEVEL_WARN)
@@ -712,12 +798,12 @@ void Client::shutdown() {
   }
 }
 
-void Client::ShutdownHandler() {
-  stopped_ioservice_only_ = true;
-  rq_timeout_timer_.cancel();
+void Client::ShutdownHandler(IOThread* io_thread) {
+  io_thread->stopped_ioservice_only = true;
+  io_thread->rq_timeout_timer.cancel();
 
-  for (connection_map::iterator iter = connections_.begin();
-       iter != connections_.end();
+  for (connection_map::iterator iter = io_thread->connections.begin();
+       iter != io_thread->connections.end();
        ++iter) {
     ClientConnection *con = iter->second;
     assert(con != NULL);
@@ -811,6 +897,10 @@ FILE* Client::create_and_open_temporary_ssl_file(std::string *filename_template,
 #endif  // HAS_OPENSSL
 
 Client::~Client() {
+  for (size_t i = 0; i < io_threads_.size(); ++i) {
+    delete io_threads_[i];
+  }
+
 #ifdef HAS_OPENSSL
   // remove temporary cert and pem files
   if (pemFileName != NULL) {
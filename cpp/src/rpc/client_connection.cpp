@@ -23,6 +23,7 @@
 #include "rpc/ssl_socket_channel.h"
 #include "rpc/tcp_socket_channel.h"
 #include "util/logging.h"
+#include "util/monotonic_clock.h"
 
 namespace xtreemfs {
 namespace rpc {
@@ -39,6 +40,8 @@ ClientConnection::ClientConnection(
     const string& port,
     asio::io_service& service,
     request_map *request_table,
+    TimeoutWheel* timeouts,
+    BufferPool* receive_buffers,
     int32_t connect_timeout_s,
     int32_t max_reconnect_interval_s
 #ifdef HAS_OPENSSL
@@ -50,6 +53,8 @@ ClientConnection::ClientConnection(
       receive_hdr_(NULL),
       receive_msg_(NULL),
       receive_data_(NULL),
+      receive_rpc_header_(NULL),
+      receive_data_into_request_buffer_(false),
       connection_state_(IDLE),
       requests_(),
       current_request_(NULL),
@@ -60,6 +65,8 @@ ClientConnection::ClientConnection(
       socket_(NULL),
       endpoint_(NULL),
       request_table_(request_table),
+      timeouts_(timeouts),
+      receive_buffers_(receive_buffers),
       timer_(service),
       connect_timeout_s_(connect_timeout_s),
       max_reconnect_interval_s_(max_reconnect_interval_s),
@@ -79,6 +86,7 @@ void ClientConnection::AddRequest(ClientRequest* request) {
   request->set_client_connection(this);
   requests_.push(PendingRequest(request->call_id(), request));
   (*request_table_)[request->call_id()] = request;
+  timeouts_->Schedule(request);
 }
 
 void ClientConnection::SendError(POSIXErrno posix_errno,
@@ -96,8 +104,9 @@ void ClientConnection::SendError(POSIXErrno posix_errno,
         // ClientRequest still exists in request_table_, it's safe to access it.
         ClientRequest *request = requests_.front().rq;
         request->set_error(new RPCHeader::ErrorResponse(err));
-        request->ExecuteCallback();
+        timeouts_->Cancel(request);
         request_table_->erase(call_id);
+        request->ExecuteCallback();
 
         Logging::log->getLog(LEVEL_ERROR)
             << "operation failed: call_id=" << call_id
@@ -110,7 +119,7 @@ void ClientConnection::SendError(POSIXErrno posix_errno,
 }
 
 void ClientConnection::DoProcess() {
-  last_used_ = posix_time::second_clock::local_time();
+  last_used_ = util::MonotonicTime();
 
   if (connection_state_ == IDLE) {
     if (endpoint_ == NULL) {
@@ -120,7 +129,7 @@ void ClientConnection::DoProcess() {
       SendRequest();
     }
   } else if (connection_state_ == WAIT_FOR_RECONNECT) {
-    posix_time::ptime now = posix_time::second_clock::local_time();
+    posix_time::ptime now = util::MonotonicTime();
     if (next_reconnect_at_ <= now) {
       next_reconnect_at_ = posix_time::not_a_date_time;
 
@@ -170,7 +179,7 @@ void ClientConnection::CreateChannel() {
 
 void ClientConnection::Connect() {
   connection_state_ = CONNECTING;
-  last_connect_was_at_ = posix_time::second_clock::local_time();
+  last_connect_was_at_ = util::MonotonicTime();
 #if (BOOST_VERSION > 104200)
   asio::ip::tcp::resolver::query query(
       server_name_,
@@ -363,7 +372,7 @@ void ClientConnection::Reset() {
   endpoint_ = NULL;
   connection_state_ = WAIT_FOR_RECONNECT;
 
-  posix_time::ptime now = posix_time::second_clock::local_time();
+  posix_time::ptime now = util::MonotonicTime();
   posix_time::seconds reconnect_interval(reconnect_interval_s_);
   if (last_connect_was_at_ != boost::posix_time::not_a_date_time) {
     posix_time::time_duration elapsed_time_since_last_connect =
@@ -457,27 +466,87 @@ void ClientConnection::PostReadRecordMarker(
                                 RecordMarker::get_size());
     }
 #endif  // HAS_VALGRIND
-    // Do read.
+    // Free the buffers of a receive which was aborted by Reset().
+    DeleteInternalBuffers();
+    // Read the header first. It tells for which request the response is.
     receive_marker_ = new RecordMarker(receive_marker_buffer_);
+    receive_hdr_ = receive_buffers_->Acquire(receive_marker_->header_len());
+    socket_->async_read(asio::buffer(reinterpret_cast<void*>(receive_hdr_),
+                                     receive_marker_->header_len()),
+                        boost::bind(&ClientConnection::PostReadHeader,
+                                    this,
+                                    asio::placeholders::error));
+  }
+}
 
-    vector<boost::asio::mutable_buffer> bufs;
-    receive_hdr_ = new char[receive_marker_->header_len()];
-    bufs.push_back(asio::buffer(reinterpret_cast<void*> (receive_hdr_),
-                                receive_marker_->header_len()));
-    if (receive_marker_->message_len() > 0) {
-      receive_msg_ = new char[receive_marker_->message_len()];
-      bufs.push_back(asio::buffer(reinterpret_cast<void*> (receive_msg_),
-                                  receive_marker_->message_len()));
+void ClientConnection::PostReadHeader(const boost::system::error_code& err) {
+  if (err == asio::error::operation_aborted || err == asio::error::eof
+      || connection_state_ == CLOSED) {
+    return;
+  }
+  if (err) {
+    DeleteInternalBuffers();
+    Reset();
+    SendError(POSIX_ERROR_EIO,
+              "could not read response from '" + server_name_ + ":"
+                  + server_port_ + "': " + err.message());
+    return;
+  }
+
+#ifdef HAS_VALGRIND
+  // On some OpenSSL versions with SSLv3 connections, Valgrind reports the
+  // header buffer as not initialized.
+  if (RUNNING_ON_VALGRIND > 0) {
+    VALGRIND_MAKE_MEM_DEFINED(receive_hdr_, receive_marker_->header_len());
+  }
+#endif  // HAS_VALGRIND
+  // Parse header.
+  receive_rpc_header_ = new RPCHeader();
+  if (!receive_rpc_header_->ParseFromArray(receive_hdr_,
+                                           receive_marker_->header_len())) {
+    // Error parsing the header.
+    DeleteInternalBuffers();
+    Reset();
+    SendError(POSIX_ERROR_EINVAL,
+              "received garbage header from '" + server_name_ + ":"
+                  + server_port_ + "', closing connection");
+    return;
+  }
+  receive_buffers_->Release(receive_hdr_, receive_marker_->header_len());
+  receive_hdr_ = NULL;
+
+  vector<boost::asio::mutable_buffer> bufs;
+  if (receive_marker_->message_len() > 0) {
+    receive_msg_ = receive_buffers_->Acquire(receive_marker_->message_len());
+    bufs.push_back(asio::buffer(reinterpret_cast<void*> (receive_msg_),
+                                receive_marker_->message_len()));
+  }
+  if (receive_marker_->data_len() > 0) {
+    // Receive the data directly into the buffer of the request, if possible.
+    // If the request times out meanwhile, Client::handleTimeout() executes
+    // its callback, which may free the buffer, and resets the connection
+    // afterwards. The socket only reads in handlers of the io thread, so it
+    // does not write into the buffer before the pending read is aborted.
+    request_map::iterator iter =
+        request_table_->find(receive_rpc_header_->call_id());
+    if (iter != request_table_->end() &&
+        iter->second->resp_data_buffer() != NULL &&
+        receive_marker_->data_len() <=
+            iter->second->resp_data_buffer_size()) {
+      receive_data_into_request_buffer_ = true;
+      bufs.push_back(asio::buffer(
+          reinterpret_cast<void*>(iter->second->resp_data_buffer()),
+          receive_marker_->data_len()));
     } else {
-      receive_msg_ = NULL;
-    }
-    if (receive_marker_->data_len() > 0) {
       receive_data_ = new char[receive_marker_->data_len()];
       bufs.push_back(asio::buffer(reinterpret_cast<void*> (receive_data_),
                                   receive_marker_->data_len()));
-    } else {
-      receive_data_ = NULL;
     }
+  }
+
+  if (bufs.empty()) {
+    PostReadMessage(boost::system::error_code());
+  } else {
     socket_->async_read(bufs,
                         boost::bind(&ClientConnection::PostReadMessage,
                                     this,
@@ -497,28 +566,7 @@ void ClientConnection::PostReadMessage(const boost::system::error_code& err) {
               "could not read response from '" + server_name_ + ":"
                   + server_port_ + "': " + err.message());
   } else {
-#ifdef HAS_VALGRIND
-    // On some OpenSSL versions with SSLv3 connections, Valgrind reports the
-    // header buffer as not initialized.
-    if (RUNNING_ON_VALGRIND > 0) {
-      VALGRIND_MAKE_MEM_DEFINED(receive_hdr_, receive_marker_->header_len());
-    }
-#endif  // HAS_VALGRIND
-    // Parse header.
-    RPCHeader *respHdr = new RPCHeader();
-    if (respHdr->ParseFromArray(receive_hdr_, receive_marker_->header_len())) {
-      delete[] receive_hdr_;
-      receive_hdr_ = NULL;
-    } else {
-      // Error parsing the header.
-      DeleteInternalBuffers();
-      delete respHdr;
-      Reset();
-      SendError(POSIX_ERROR_EINVAL,
-                "received garbage header from '" + server_name_ + ":"
-                    + server_port_ + "', closing connection");
-      return;
-    }
+    RPCHeader *respHdr = receive_rpc_header_;
 
     // Get request from table.
     request_map::iterator iter = request_table_->find(respHdr->call_id());
@@ -533,13 +581,14 @@ void ClientConnection::PostReadMessage(const boost::system::error_code& err) {
                " (call id = " << respHdr->call_id() << ")." << endl;
       }
       DeleteInternalBuffers();
-      delete respHdr;
 
       // Receive next request.
       ReceiveRequest();
 
       return;
     }
+    // From here on, the request is responsible for the header.
+    receive_rpc_header_ = NULL;
 
     uint32 call_id = respHdr->call_id();
 
@@ -573,6 +622,11 @@ void ClientConnection::PostReadMessage(const boost::system::error_code& err) {
 
             // manually cleanup response header
             delete respHdr;
+            respHdr = NULL;
+          } else if (receive_data_into_request_buffer_) {
+            // Message successfully parsed, data is already in place.
+            rq->set_resp_data(rq->resp_data_buffer());
+            rq->set_resp_data_len(receive_marker_->data_len());
           } else {
             // Message successfully parsed, set data.
             // Hand over responsibility for receive_data_ to request object.
@@ -587,6 +641,7 @@ void ClientConnection::PostReadMessage(const boost::system::error_code& err) {
     }
 
     // Remove from table and clean up buffers.
+    timeouts_->Cancel(rq);
     request_table_->erase(call_id);
     DeleteInternalBuffers();
     rq->ExecuteCallback();
@@ -597,12 +652,17 @@ void ClientConnection::PostReadMessage(const boost::system::error_code& err) {
 }
 
 void ClientConnection::DeleteInternalBuffers() {
-  delete[] receive_hdr_;
+  if (receive_marker_) {
+    receive_buffers_->Release(receive_hdr_, receive_marker_->header_len());
+    receive_buffers_->Release(receive_msg_, receive_marker_->message_len());
+  }
   receive_hdr_ = NULL;
-  delete[] receive_msg_;
   receive_msg_ = NULL;
   delete[] receive_data_;
   receive_data_ = NULL;
+  delete receive_rpc_header_;
+  receive_rpc_header_ = NULL;
+  receive_data_into_request_buffer_ = false;
   delete receive_marker_;
   receive_marker_ = NULL;
 }
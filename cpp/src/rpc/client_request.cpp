@@ -8,13 +8,17 @@
 
 #include "rpc/client_request.h"
 
+#include <boost/interprocess/detail/atomic.hpp>
 #include <google/protobuf/message.h>
 #include <string>
 
 #include "pbrpc/RPC.pb.h"
 #include "rpc/client_request_callback_interface.h"
 #include "rpc/record_marker.h"
+#include "rpc/rpc_metrics.h"
+#include "rpc/server_statistics.h"
 #include "util/logging.h"
+#include "util/monotonic_clock.h"
 
 namespace xtreemfs {
 namespace rpc {
@@ -24,6 +28,12 @@ using namespace std;
 using namespace boost;
 using namespace google::protobuf;
 
+#if (BOOST_VERSION < 104800)
+using boost::interprocess::detail::atomic_dec32;
+#else
+using boost::interprocess::ipcdetail::atomic_dec32;
+#endif  // BOOST_VERSION < 104800
+
 ClientRequest::ClientRequest(const string& address,
                              const uint32_t call_id,
                              const uint32_t interface_id,
@@ -43,12 +53,19 @@ ClientRequest::ClientRequest(const string& address,
       context_(context),
       callback_(callback),
       address_(address),
+      connection_number_(0),
+      pending_requests_(NULL),
+      server_statistics_(NULL),
+      timeout_s_(0),
       callback_executed_(false),
+      timeout_slot_(-1),
       error_(NULL),
       resp_header_(NULL),
       resp_message_(response_message),
       resp_data_(NULL),
-      resp_data_len_(0) {
+      resp_data_len_(0),
+      resp_data_buffer_(NULL),
+      resp_data_buffer_size_(0) {
   RPCHeader header = RPCHeader();
   header.set_message_type(xtreemfs::pbrpc::RPC_REQUEST);
   header.set_call_id(call_id);
@@ -101,12 +118,32 @@ ClientRequest::~ClientRequest() {
 void ClientRequest::ExecuteCallback() {
   if (!callback_executed_) {
     callback_executed_ = true;
+    if (pending_requests_ != NULL) {
+      atomic_dec32(pending_requests_);
+    }
+    // Requests which were aborted before they were sent are not recorded.
+    if (!time_sent_.is_not_a_date_time()) {
+      const posix_time::time_duration latency =
+          util::MonotonicTime() - time_sent_;
+      const bool io_error = error_ != NULL && error_->error_type() == IO_ERROR;
+      RPCMetrics::instance()->RecordRequest(
+          interface_id_,
+          proc_id_,
+          latency,
+          error_ != NULL && error_->error_type() != ERRNO
+              && error_->error_type() != REDIRECT);
+      if (server_statistics_ != NULL) {
+        server_statistics_->RecordRequest(address_, latency, io_error);
+      }
+    }
     callback_->RequestCompleted(this);
   }
 }
 
-void ClientRequest::RequestSent() {
-  time_sent_ = posix_time::microsec_clock::local_time();
+void ClientRequest::RequestSent(int32_t default_timeout_s) {
+  time_sent_ = util::MonotonicTime();
+  deadline_ = time_sent_ + posix_time::seconds(
+      timeout_s_ > 0 ? timeout_s_ : default_timeout_s);
 }
 
 }  // namespace rpc
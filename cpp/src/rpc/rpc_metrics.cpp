@@ -0,0 +1,139 @@
+/*
+ * Copyright (c) 2015 by Zuse Institute Berlin
+ *
+ * Licensed under the BSD License, see LICENSE file for details.
+ *
+ */
+
+#include "rpc/rpc_metrics.h"
+
+#include <boost/algorithm/string/case_conv.hpp>
+#include <boost/lexical_cast.hpp>
+#include <boost/thread/once.hpp>
+#include <google/protobuf/descriptor.h>
+
+#include "include/PBRPC.pb.h"
+#include "xtreemfs/DIR.pb.h"
+#include "xtreemfs/MRC.pb.h"
+#include "xtreemfs/OSD.pb.h"
+
+using namespace std;
+
+namespace xtreemfs {
+namespace rpc {
+
+namespace {
+
+/** Indexed by RPCMetrics::Interface. */
+const char* kInterfaceNames[] = { "dir", "mrc", "osd", "other" };
+
+/** Returns the name of the method "proc_id" of "service" or the id if the
+ *  service or method is unknown. */
+string GetMethodName(const google::protobuf::ServiceDescriptor* service,
+                     uint32_t proc_id) {
+  if (service != NULL) {
+    for (int i = 0; i < service->method_count(); ++i) {
+      const google::protobuf::MethodDescriptor* method = service->method(i);
+      if (method->options().GetExtension(xtreemfs::pbrpc::proc_id)
+              == proc_id) {
+        return boost::to_lower_copy(method->name());
+      }
+    }
+  }
+  return "proc_" + boost::lexical_cast<string>(proc_id);
+}
+
+}  // anonymous namespace
+
+const int RPCMetrics::kMaxProcId;
+
+RPCMetrics* RPCMetrics::instance_ = NULL;
+
+void RPCMetrics::CreateInstance() {
+  // Never deleted, like the util::MetricsRegistry.
+  instance_ = new RPCMetrics();
+}
+
+RPCMetrics* RPCMetrics::instance() {
+  static boost::once_flag once = BOOST_ONCE_INIT;
+  boost::call_once(&RPCMetrics::CreateInstance, once);
+  return instance_;
+}
+
+const google::protobuf::ServiceDescriptor* RPCMetrics::GetService(
+    Interface interface) {
+  // Looked up via a message of the same .proto file which is therefore
+  // guaranteed to be linked and registered.
+  const google::protobuf::FileDescriptor* file = NULL;
+  switch (interface) {
+    case kDIR:
+      file = xtreemfs::pbrpc::serviceGetByUUIDRequest::descriptor()->file();
+      break;
+    case kMRC:
+      file = xtreemfs::pbrpc::getattrRequest::descriptor()->file();
+      break;
+    case kOSD:
+      file = xtreemfs::pbrpc::readRequest::descriptor()->file();
+      break;
+    default:
+      return NULL;
+  }
+  return file->service_count() > 0 ? file->service(0) : NULL;
+}
+
+RPCMetrics::RPCMetrics() {
+  for (int i = 0; i < kInterfaces; ++i) {
+    for (int j = 0; j < kMaxProcId + 2; ++j) {
+      latencies_[i][j].store(NULL, boost::memory_order_relaxed);
+    }
+    errors_[i] = util::MetricsRegistry::instance()->GetCounter(
+        string("rpc_") + kInterfaceNames[i] + "_errors");
+    const google::protobuf::ServiceDescriptor* service =
+        GetService(static_cast<Interface>(i));
+    interface_ids_[i] = service == NULL
+        ? 0 : service->options().GetExtension(xtreemfs::pbrpc::interface_id);
+  }
+}
+
+RPCMetrics::Interface RPCMetrics::GetInterface(uint32_t interface_id) const {
+  for (int i = 0; i < kOther; ++i) {
+    if (interface_ids_[i] == interface_id) {
+      return static_cast<Interface>(i);
+    }
+  }
+  return kOther;
+}
+
+util::Histogram* RPCMetrics::CreateLatencyHistogram(Interface interface,
+                                                    uint32_t proc_id) {
+  const string method = proc_id > static_cast<uint32_t>(kMaxProcId)
+      ? "other" : GetMethodName(GetService(interface), proc_id);
+  return util::MetricsRegistry::instance()->GetHistogram(
+      string("rpc_") + kInterfaceNames[interface] + "_" + method
+      + "_latency_us");
+}
+
+void RPCMetrics::RecordRequest(
+    uint32_t interface_id,
+    uint32_t proc_id,
+    const boost::posix_time::time_duration& latency,
+    bool failed) {
+  const Interface interface = GetInterface(interface_id);
+  const int slot = proc_id > static_cast<uint32_t>(kMaxProcId)
+      ? kMaxProcId + 1 : static_cast<int>(proc_id);
+
+  util::Histogram* histogram =
+      latencies_[interface][slot].load(boost::memory_order_acquire);
+  if (histogram == NULL) {
+    // Concurrent callers get the same histogram from the registry.
+    histogram = CreateLatencyHistogram(interface, proc_id);
+    latencies_[interface][slot].store(histogram, boost::memory_order_release);
+  }
+  histogram->Record(latency.total_microseconds());
+  if (failed) {
+    errors_[interface]->Increment();
+  }
+}
+
+}  // namespace rpc
+}  // namespace xtreemfs
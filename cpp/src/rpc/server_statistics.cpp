@@ -0,0 +1,85 @@
+/*
+ * Copyright (c) 2015 by Zuse Institute Berlin
+ *
+ * Licensed under the BSD License, see LICENSE file for details.
+ *
+ */
+
+#include "rpc/server_statistics.h"
+
+#include <boost/date_time/posix_time/posix_time.hpp>
+
+#include "util/monotonic_clock.h"
+
+using namespace std;
+
+namespace xtreemfs {
+namespace rpc {
+
+const double ServerStatistics::kSmoothingFactor = 0.1;
+const double ServerStatistics::kDegradedErrorRate = 0.5;
+const double ServerStatistics::kDegradedLatencyFraction = 0.25;
+const int ServerStatistics::kMinRequests;
+const int ServerStatistics::kProbationS;
+
+ServerStatistics::ServerStatistics(int request_timeout_s)
+    : degraded_latency_us_(
+          kDegradedLatencyFraction * request_timeout_s * 1000 * 1000) {}
+
+void ServerStatistics::RecordRequest(
+    const std::string& address,
+    const boost::posix_time::time_duration& latency,
+    bool failed) {
+  const double latency_us = static_cast<double>(latency.total_microseconds());
+  const boost::posix_time::ptime now = util::MonotonicTime();
+  boost::mutex::scoped_lock lock(mutex_);
+
+  ServerScore& score = scores_[address];
+  if (score.requests == 0) {
+    score.average_latency_us = latency_us;
+    score.error_rate = failed ? 1 : 0;
+  } else {
+    score.average_latency_us = (1 - kSmoothingFactor) * score.average_latency_us
+        + kSmoothingFactor * latency_us;
+    score.error_rate = (1 - kSmoothingFactor) * score.error_rate
+        + (failed ? kSmoothingFactor : 0);
+  }
+  ++score.requests;
+  if (failed) {
+    ++score.errors;
+  }
+  score.last_request = now;
+}
+
+void ServerStatistics::UpdateDegraded(const boost::posix_time::ptime& now,
+                                      ServerScore* score) const {
+  score->degraded = score->requests >= static_cast<uint64_t>(kMinRequests)
+      && (score->error_rate > kDegradedErrorRate
+          || score->average_latency_us > degraded_latency_us_)
+      && now - score->last_request < boost::posix_time::seconds(kProbationS);
+}
+
+bool ServerStatistics::GetScore(const std::string& address,
+                                ServerScore* score) {
+  const boost::posix_time::ptime now = util::MonotonicTime();
+  boost::mutex::scoped_lock lock(mutex_);
+  ScoreMap::const_iterator it = scores_.find(address);
+  if (it == scores_.end()) {
+    return false;
+  }
+  *score = it->second;
+  UpdateDegraded(now, score);
+  return true;
+}
+
+void ServerStatistics::GetScores(std::map<std::string, ServerScore>* scores) {
+  const boost::posix_time::ptime now = util::MonotonicTime();
+  boost::mutex::scoped_lock lock(mutex_);
+  *scores = scores_;
+  for (ScoreMap::iterator it = scores->begin(); it != scores->end(); ++it) {
+    UpdateDegraded(now, &it->second);
+  }
+}
+
+}  // namespace rpc
+}  // namespace xtreemfs
@@ -0,0 +1,100 @@
+/*
+ * Copyright (c) 2015 by Zuse Institute Berlin
+ *
+ * Licensed under the BSD License, see LICENSE file for details.
+ *
+ */
+
+#include "rpc/timeout_wheel.h"
+
+#include <algorithm>
+#include <cassert>
+
+#include "rpc/client_request.h"
+#include "util/monotonic_clock.h"
+
+using namespace std;
+using namespace boost;
+
+namespace xtreemfs {
+namespace rpc {
+
+TimeoutWheel::TimeoutWheel(const posix_time::time_duration& tick, int slots)
+    : tick_(tick),
+      epoch_(util::MonotonicTime()),
+      slots_(max(slots, 1)),
+      next_tick_(0),
+      size_(0) {
+  assert(tick_.total_microseconds() > 0);
+}
+
+void TimeoutWheel::Schedule(ClientRequest* request) {
+  assert(request->timeout_slot_ == -1);
+  // Requests whose tick was already expired, expire with the next tick.
+  const int64_t tick = max(ToTick(request->deadline()), next_tick_);
+  const int slot = static_cast<int>(tick % slots_.size());
+  request->timeout_slot_ = slot;
+  request->timeout_entry_ = slots_[slot].insert(slots_[slot].end(), request);
+  ++size_;
+}
+
+void TimeoutWheel::Cancel(ClientRequest* request) {
+  if (request->timeout_slot_ == -1) {
+    return;
+  }
+  slots_[request->timeout_slot_].erase(request->timeout_entry_);
+  request->timeout_slot_ = -1;
+  --size_;
+}
+
+void TimeoutWheel::Expire(const posix_time::ptime& now,
+                          vector<ClientRequest*>* expired) {
+  const int64_t now_tick = ToTick(now);
+  if (now_tick <= next_tick_) {
+    return;
+  }
+
+  // If more ticks passed than there are slots, every slot is visited once.
+  const int64_t last_tick = min(now_tick - 1,
+      next_tick_ + static_cast<int64_t>(slots_.size()) - 1);
+  for (int64_t tick = next_tick_; tick <= last_tick; ++tick) {
+    Slot& slot = slots_[tick % slots_.size()];
+    Slot::iterator it = slot.begin();
+    while (it != slot.end()) {
+      // The slot also contains requests of later rounds of the wheel.
+      if (ToTick((*it)->deadline()) < now_tick) {
+        (*it)->timeout_slot_ = -1;
+        expired->push_back(*it);
+        it = slot.erase(it);
+        --size_;
+      } else {
+        ++it;
+      }
+    }
+  }
+  next_tick_ = now_tick;
+}
+
+void TimeoutWheel::Clear() {
+  for (size_t i = 0; i < slots_.size(); ++i) {
+    for (Slot::iterator it = slots_[i].begin(); it != slots_[i].end(); ++it) {
+      (*it)->timeout_slot_ = -1;
+    }
+    slots_[i].clear();
+  }
+  size_ = 0;
+}
+
+size_t TimeoutWheel::size() const {
+  return size_;
+}
+
+int64_t TimeoutWheel::ToTick(const posix_time::ptime& time) const {
+  if (time <= epoch_) {
+    return 0;
+  }
+  return (time - epoch_).total_microseconds() / tick_.total_microseconds();
+}
+
+}  // namespace rpc
+}  // namespace xtreemfs
@@ -0,0 +1,213 @@
+/*
+ * Copyright (c) 2015 by Zuse Institute Berlin
+ *
+ * Licensed under the BSD License, see LICENSE file for details.
+ *
+ */
+
+#include "util/crc32c.h"
+
+#include <cstring>
+
+// The crc32 instruction is used on x86-64 with compilers which can enable
+// SSE 4.2 per function, so the client still runs on CPUs without it.
+#if defined(__x86_64__) && (defined(__clang__) || __GNUC__ > 4 || \
+    (__GNUC__ == 4 && __GNUC_MINOR__ >= 9))
+#define XTREEMFS_CRC32C_SSE42
+#include <nmmintrin.h>
+#endif
+
+namespace xtreemfs {
+namespace util {
+
+namespace {
+
+/** CRC32C polynomial 0x1EDC6F41 in reversed bit order. */
+const uint32_t kPolynomial = 0x82F63B78;
+
+/** Lookup tables of the portable slicing-by-8 implementation. */
+struct SlicingTables {
+  SlicingTables() {
+    for (uint32_t i = 0; i < 256; ++i) {
+      uint32_t crc = i;
+      for (int bit = 0; bit < 8; ++bit) {
+        crc = (crc & 1) ? (crc >> 1) ^ kPolynomial : crc >> 1;
+      }
+      table[0][i] = crc;
+    }
+    for (uint32_t i = 0; i < 256; ++i) {
+      for (int k = 1; k < 8; ++k) {
+        table[k][i] = (table[k - 1][i] >> 8) ^
+                      table[0][table[k - 1][i] & 0xff];
+      }
+    }
+  }
+
+  uint32_t table[8][256];
+};
+
+const SlicingTables kSlicingTables;
+
+#ifdef XTREEMFS_CRC32C_SSE42
+
+/** Returns a * b modulo the polynomial, both in reversed bit order. */
+uint32_t MultiplyModP(uint32_t a, uint32_t b) {
+  uint32_t m = 1u << 31;
+  uint32_t product = 0;
+  for (;;) {
+    if (a & m) {
+      product ^= b;
+      if ((a & (m - 1)) == 0) {
+        break;
+      }
+    }
+    m >>= 1;
+    b = (b & 1) ? (b >> 1) ^ kPolynomial : b >> 1;
+  }
+  return product;
+}
+
+/** Returns x^(8 * bytes) modulo the polynomial, i.e. the factor which
+ *  appends "bytes" zero bytes to a CRC register. */
+uint32_t ZeroBytesOperator(size_t bytes) {
+  uint32_t x_power_2n = 1u << 30;  // x^1, squared in every step.
+  uint32_t result = 1u << 31;  // x^0
+  size_t bits = bytes * 8;
+  while (bits > 0) {
+    if (bits & 1) {
+      result = MultiplyModP(x_power_2n, result);
+    }
+    x_power_2n = MultiplyModP(x_power_2n, x_power_2n);
+    bits >>= 1;
+  }
+  return result;
+}
+
+/** The hardware implementation checksums three lanes of these sizes at once
+ *  as the crc32 instruction can start every cycle, but takes three. */
+const size_t kLaneSizes[] = { 4096, 256 };
+const int kLaneSizeCount = sizeof(kLaneSizes) / sizeof(kLaneSizes[0]);
+
+/** Appends the zero bytes of a lane to a CRC register with four lookups. */
+struct ShiftTables {
+  ShiftTables() {
+    for (int lane = 0; lane < kLaneSizeCount; ++lane) {
+      const uint32_t op = ZeroBytesOperator(kLaneSizes[lane]);
+      for (int byte = 0; byte < 4; ++byte) {
+        for (uint32_t i = 0; i < 256; ++i) {
+          table[lane][byte][i] = MultiplyModP(op, i << (8 * byte));
+        }
+      }
+    }
+  }
+
+  uint32_t Shift(int lane, uint32_t crc) const {
+    return table[lane][0][crc & 0xff] ^
+           table[lane][1][(crc >> 8) & 0xff] ^
+           table[lane][2][(crc >> 16) & 0xff] ^
+           table[lane][3][crc >> 24];
+  }
+
+  uint32_t table[kLaneSizeCount][4][256];
+};
+
+const ShiftTables kShiftTables;
+
+bool DetectSSE42() {
+  __builtin_cpu_init();
+  return __builtin_cpu_supports("sse4.2");
+}
+
+const bool kHasSSE42 = DetectSSE42();
+
+inline uint64_t Load64(const unsigned char* p) {
+  uint64_t value;
+  memcpy(&value, p, sizeof(value));
+  return value;
+}
+
+__attribute__((target("sse4.2")))
+uint32_t CRC32CHardware(uint32_t crc, const char* data, size_t length) {
+  const unsigned char* p = reinterpret_cast<const unsigned char*>(data);
+  uint64_t crc0 = ~crc;
+  while (length > 0 && (reinterpret_cast<uintptr_t>(p) & 7) != 0) {
+    crc0 = _mm_crc32_u8(static_cast<uint32_t>(crc0), *p++);
+    --length;
+  }
+
+  // The CRC of the lanes A, B and C is the CRC of A shifted over B and C,
+  // the CRC of B shifted over C and the CRC of C.
+  for (int lane = 0; lane < kLaneSizeCount; ++lane) {
+    const size_t lane_size = kLaneSizes[lane];
+    while (length >= 3 * lane_size) {
+      uint64_t crc1 = 0;
+      uint64_t crc2 = 0;
+      const unsigned char* const end = p + lane_size;
+      for (; p < end; p += 8) {
+        crc0 = _mm_crc32_u64(crc0, Load64(p));
+        crc1 = _mm_crc32_u64(crc1, Load64(p + lane_size));
+        crc2 = _mm_crc32_u64(crc2, Load64(p + 2 * lane_size));
+      }
+      crc0 = kShiftTables.Shift(
+          lane,
+          kShiftTables.Shift(lane, static_cast<uint32_t>(crc0)) ^
+              static_cast<uint32_t>(crc1)) ^
+          static_cast<uint32_t>(crc2);
+      p += 2 * lane_size;
+      length -= 3 * lane_size;
+    }
+  }
+
+  for (; length >= 8; length -= 8, p += 8) {
+    crc0 = _mm_crc32_u64(crc0, Load64(p));
+  }
+  for (; length > 0; --length) {
+    crc0 = _mm_crc32_u8(static_cast<uint32_t>(crc0), *p++);
+  }
+  return ~static_cast<uint32_t>(crc0);
+}
+
+#endif  // XTREEMFS_CRC32C_SSE42
+
+}  // anonymous namespace
+
+uint32_t CRC32C(uint32_t crc, const char* data, size_t length) {
+#ifdef XTREEMFS_CRC32C_SSE42
+  if (kHasSSE42) {
+    return CRC32CHardware(crc, data, length);
+  }
+#endif  // XTREEMFS_CRC32C_SSE42
+  return CRC32CPortable(crc, data, length);
+}
+
+uint32_t CRC32CPortable(uint32_t crc, const char* data, size_t length) {
+  const uint32_t (&table)[8][256] = kSlicingTables.table;
+  const unsigned char* p = reinterpret_cast<const unsigned char*>(data);
+  crc = ~crc;
+  for (; length >= 8; length -= 8, p += 8) {
+    // Assembled byte by byte to work on big endian CPUs, too.
+    const uint32_t low = crc ^ (p[0] | (p[1] << 8) | (p[2] << 16) |
+                                (static_cast<uint32_t>(p[3]) << 24));
+    const uint32_t high = p[4] | (p[5] << 8) | (p[6] << 16) |
+                          (static_cast<uint32_t>(p[7]) << 24);
+    crc = table[7][low & 0xff] ^ table[6][(low >> 8) & 0xff] ^
+          table[5][(low >> 16) & 0xff] ^ table[4][low >> 24] ^
+          table[3][high & 0xff] ^ table[2][(high >> 8) & 0xff] ^
+          table[1][(high >> 16) & 0xff] ^ table[0][high >> 24];
+  }
+  for (; length > 0; --length) {
+    crc = table[0][(crc ^ *p++) & 0xff] ^ (crc >> 8);
+  }
+  return ~crc;
+}
+
+bool CRC32CIsHardwareAccelerated() {
+#ifdef XTREEMFS_CRC32C_SSE42
+  return kHasSSE42;
+#else
+  return false;
+#endif  // XTREEMFS_CRC32C_SSE42
+}
+
+}  // namespace util
+}  // namespace xtreemfs
@@ -0,0 +1,283 @@
+/*
+ * Copyright (c) 2015 by Zuse Institute Berlin
+ *
+ * Licensed under the BSD License, see LICENSE file for details.
+ *
+ */
+
+#include "util/metrics.h"
+
+#include <boost/date_time/posix_time/posix_time.hpp>
+#include <boost/thread/once.hpp>
+#include <boost/thread/tss.hpp>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+
+#include "util/monotonic_clock.h"
+
+using namespace std;
+
+namespace xtreemfs {
+namespace util {
+
+namespace {
+
+/** Counter shard of each thread, assigned round-robin on first use. */
+boost::thread_specific_ptr<int> thread_shard;
+boost::atomic<unsigned int> next_thread_shard(0);
+
+int GetThreadShard() {
+  int* shard = thread_shard.get();
+  if (shard == NULL) {
+    shard = new int(next_thread_shard.fetch_add(1, boost::memory_order_relaxed)
+                    % Counter::kShards);
+    thread_shard.reset(shard);
+  }
+  return *shard;
+}
+
+void WriteCounters(const map<string, Counter*>& counters,
+                   const char* type,
+                   ostream* out) {
+  for (map<string, Counter*>::const_iterator it = counters.begin();
+       it != counters.end(); ++it) {
+    *out << "# TYPE xtreemfs_" << it->first << " " << type << "\n"
+         << "xtreemfs_" << it->first << " " << it->second->Value() << "\n";
+  }
+}
+
+}  // anonymous namespace
+
+const int Counter::kShards;
+
+Counter::Counter() {
+  for (int i = 0; i < kShards; ++i) {
+    shards_[i].value.store(0, boost::memory_order_relaxed);
+  }
+}
+
+void Counter::Add(int64_t delta) {
+  shards_[GetThreadShard()].value.fetch_add(delta, boost::memory_order_relaxed);
+}
+
+int64_t Counter::Value() const {
+  int64_t value = 0;
+  for (int i = 0; i < kShards; ++i) {
+    value += shards_[i].value.load(boost::memory_order_relaxed);
+  }
+  return value;
+}
+
+int64_t HistogramSnapshot::ValueAtPercentile(double percentile) const {
+  if (count == 0) {
+    return 0;
+  }
+  uint64_t rank = static_cast<uint64_t>(ceil(percentile / 100 * count));
+  if (rank == 0) {
+    rank = 1;
+  } else if (rank >= count) {
+    // The largest value is known exactly.
+    return max;
+  }
+
+  uint64_t seen = 0;
+  for (size_t i = 0; i < buckets.size(); ++i) {
+    seen += buckets[i];
+    if (seen >= rank) {
+      // Report the middle of the bucket, but not more than the maximum.
+      const int bucket = static_cast<int>(i);
+      const int64_t lower = Histogram::GetBucketLowerBound(bucket);
+      const int64_t upper = i + 1 < buckets.size()
+          ? Histogram::GetBucketLowerBound(bucket + 1) : lower + 1;
+      return min(lower + (upper - 1 - lower) / 2, max);
+    }
+  }
+  return max;
+}
+
+const int Histogram::kSubBucketBits;
+const int Histogram::kSubBuckets;
+const int Histogram::kMaxValueBits;
+const int Histogram::kBuckets;
+
+Histogram::Histogram() {
+  for (int i = 0; i < kBuckets; ++i) {
+    buckets_[i].store(0, boost::memory_order_relaxed);
+  }
+  sum_.store(0, boost::memory_order_relaxed);
+  max_.store(0, boost::memory_order_relaxed);
+}
+
+int Histogram::GetBucket(int64_t value) {
+  if (value < kSubBuckets) {
+    return value < 0 ? 0 : static_cast<int>(value);
+  }
+  int msb = 0;
+  for (int64_t rest = value >> 1; rest != 0; rest >>= 1) {
+    ++msb;
+  }
+  if (msb >= kMaxValueBits) {
+    return kBuckets - 1;
+  }
+  const int shift = msb - kSubBucketBits;
+  return (shift + 1) * kSubBuckets
+      + static_cast<int>((value >> shift) & (kSubBuckets - 1));
+}
+
+int64_t Histogram::GetBucketLowerBound(int bucket) {
+  if (bucket < kSubBuckets) {
+    return bucket;
+  }
+  const int shift = bucket / kSubBuckets - 1;
+  return static_cast<int64_t>(kSubBuckets + bucket % kSubBuckets) << shift;
+}
+
+void Histogram::Record(int64_t value) {
+  if (value < 0) {
+    value = 0;
+  }
+  buckets_[GetBucket(value)].fetch_add(1, boost::memory_order_relaxed);
+  sum_.fetch_add(value, boost::memory_order_relaxed);
+
+  int64_t current_max = max_.load(boost::memory_order_relaxed);
+  while (value > current_max &&
+         !max_.compare_exchange_weak(current_max,
+                                     value,
+                                     boost::memory_order_relaxed)) {
+  }
+}
+
+void Histogram::GetSnapshot(HistogramSnapshot* snapshot) const {
+  snapshot->buckets.resize(kBuckets);
+  snapshot->count = 0;
+  for (int i = 0; i < kBuckets; ++i) {
+    snapshot->buckets[i] = buckets_[i].load(boost::memory_order_relaxed);
+    snapshot->count += snapshot->buckets[i];
+  }
+  snapshot->sum = sum_.load(boost::memory_order_relaxed);
+  snapshot->max = max_.load(boost::memory_order_relaxed);
+}
+
+ScopedLatencyTimer::ScopedLatencyTimer(Histogram* histogram)
+    : histogram_(histogram),
+      start_(MonotonicTime()) {}
+
+ScopedLatencyTimer::~ScopedLatencyTimer() {
+  histogram_->Record(
+      (MonotonicTime() - start_).total_microseconds());
+}
+
+MetricsRegistry* MetricsRegistry::instance_ = NULL;
+
+void MetricsRegistry::CreateInstance() {
+  // Never deleted: metrics may be updated until the process exits.
+  instance_ = new MetricsRegistry();
+}
+
+MetricsRegistry* MetricsRegistry::instance() {
+  static boost::once_flag once = BOOST_ONCE_INIT;
+  boost::call_once(&MetricsRegistry::CreateInstance, once);
+  return instance_;
+}
+
+Counter* MetricsRegistry::GetCounter(const std::string& name) {
+  boost::mutex::scoped_lock lock(mutex_);
+  Counter*& counter = counters_[name];
+  if (counter == NULL) {
+    counter = new Counter();
+  }
+  return counter;
+}
+
+Counter* MetricsRegistry::GetGauge(const std::string& name) {
+  boost::mutex::scoped_lock lock(mutex_);
+  Counter*& gauge = gauges_[name];
+  if (gauge == NULL) {
+    gauge = new Counter();
+  }
+  return gauge;
+}
+
+Histogram* MetricsRegistry::GetHistogram(const std::string& name) {
+  boost::mutex::scoped_lock lock(mutex_);
+  Histogram*& histogram = histograms_[name];
+  if (histogram == NULL) {
+    histogram = new Histogram();
+  }
+  return histogram;
+}
+
+void MetricsRegistry::GetCounterValues(std::map<std::string, int64_t>* values) {
+  boost::mutex::scoped_lock lock(mutex_);
+  values->clear();
+  for (map<string, Counter*>::const_iterator it = counters_.begin();
+       it != counters_.end(); ++it) {
+    (*values)[it->first] = it->second->Value();
+  }
+  for (map<string, Counter*>::const_iterator it = gauges_.begin();
+       it != gauges_.end(); ++it) {
+    (*values)[it->first] = it->second->Value();
+  }
+}
+
+void MetricsRegistry::GetHistogramSnapshots(
+    std::map<std::string, HistogramSnapshot>* snapshots) {
+  boost::mutex::scoped_lock lock(mutex_);
+  snapshots->clear();
+  for (map<string, Histogram*>::const_iterator it = histograms_.begin();
+       it != histograms_.end(); ++it) {
+    HistogramSnapshot snapshot;
+    it->second->GetSnapshot(&snapshot);
+    if (snapshot.count > 0) {
+      (*snapshots)[it->first] = snapshot;
+    }
+  }
+}
+
+void MetricsRegistry::WriteText(std::ostream* out) {
+  map<string, HistogramSnapshot> snapshots;
+  GetHistogramSnapshots(&snapshots);
+
+  boost::mutex::scoped_lock lock(mutex_);
+  WriteCounters(counters_, "counter", out);
+  WriteCounters(gauges_, "gauge", out);
+  lock.unlock();
+
+  const double kPercentiles[] = { 50, 90, 99, 99.9 };
+  for (map<string, HistogramSnapshot>::const_iterator it = snapshots.begin();
+       it != snapshots.end(); ++it) {
+    const string name = "xtreemfs_" + it->first;
+    *out << "# TYPE " << name << " summary\n";
+    for (size_t i = 0; i < sizeof(kPercentiles) / sizeof(kPercentiles[0]);
+         ++i) {
+      *out << name << "{quantile=\"" << kPercentiles[i] / 100 << "\"} "
+           << it->second.ValueAtPercentile(kPercentiles[i]) << "\n";
+    }
+    *out << name << "_sum " << it->second.sum << "\n"
+         << name << "_count " << it->second.count << "\n";
+  }
+}
+
+bool MetricsRegistry::WriteTextFile(const std::string& path) {
+  const string temp_path = path + ".tmp";
+  {
+    ofstream file(temp_path.c_str(), ios::out | ios::trunc);
+    if (!file) {
+      return false;
+    }
+    WriteText(&file);
+    file.close();
+    if (!file) {
+      return false;
+    }
+  }
+#ifdef WIN32
+  // rename() does not replace existing files on Windows.
+  remove(path.c_str());
+#endif  // WIN32
+  return rename(temp_path.c_str(), path.c_str()) == 0;
+}
+
+}  // namespace util
+}  // namespace xtreemfs
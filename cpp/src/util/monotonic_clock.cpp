@@ -0,0 +1,56 @@
+/*
+ * Copyright (c) 2015 by Zuse Institute Berlin
+ *
+ * Licensed under the BSD License, see LICENSE file for details.
+ *
+ */
+
+#include "util/monotonic_clock.h"
+
+#ifdef WIN32
+#include <windows.h>
+#elif defined(__APPLE__)
+#include <mach/mach_time.h>
+#else
+#include <time.h>
+#endif
+
+namespace xtreemfs {
+namespace util {
+
+namespace {
+
+/** Arbitrary origin of the monotonic time points. */
+const boost::posix_time::ptime kOrigin(boost::gregorian::date(1970, 1, 1));
+
+}  // anonymous namespace
+
+boost::posix_time::ptime MonotonicTime() {
+#ifdef WIN32
+  LARGE_INTEGER frequency;
+  LARGE_INTEGER counter;
+  QueryPerformanceFrequency(&frequency);
+  QueryPerformanceCounter(&counter);
+  return kOrigin + boost::posix_time::microseconds(
+      counter.QuadPart / frequency.QuadPart * 1000000 +
+      counter.QuadPart % frequency.QuadPart * 1000000 / frequency.QuadPart);
+#elif defined(__APPLE__)
+  static mach_timebase_info_data_t timebase;
+  if (timebase.denom == 0) {
+    mach_timebase_info(&timebase);
+  }
+  const uint64_t nanoseconds =
+      mach_absolute_time() * timebase.numer / timebase.denom;
+  return kOrigin + boost::posix_time::microseconds(nanoseconds / 1000);
+#elif defined(CLOCK_MONOTONIC)
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return kOrigin + boost::posix_time::seconds(now.tv_sec) +
+      boost::posix_time::microseconds(now.tv_nsec / 1000);
+#else
+  return boost::posix_time::microsec_clock::universal_time();
+#endif
+}
+
+}  // namespace util
+}  // namespace xtreemfs
@@ -0,0 +1,386 @@
+/*
+ * Copyright (c) 2015 by Zuse Institute Berlin
+ *
+ * Licensed under the BSD License, see LICENSE file for details.
+ *
+ */
+
+#include "util/reed_solomon.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+
+// The shuffle instructions are used on x86-64 with compilers which can enable
+// SSSE3 and AVX2 per function, so the client still runs on older CPUs.
+#if defined(__x86_64__) && (defined(__clang__) || __GNUC__ > 4 || \
+    (__GNUC__ == 4 && __GNUC_MINOR__ >= 9))
+#define XTREEMFS_GALOIS_SIMD
+#include <immintrin.h>
+#endif
+
+using namespace std;
+
+namespace xtreemfs {
+namespace util {
+
+namespace {
+
+/** Reduction polynomial x^8 + x^4 + x^3 + x^2 + 1 of GF(2^8). */
+const unsigned int kPolynomial = 0x11D;
+
+/** Fragments are encoded in blocks of this size, so that the blocks of all
+ *  data fragments stay in the cache while the parity blocks are computed. */
+const size_t kBlockSize = 16 * 1024;
+
+/** Logarithm, exponential and multiplication tables of GF(2^8). */
+struct GaloisTables {
+  GaloisTables() {
+    unsigned int x = 1;
+    for (int i = 0; i < 255; ++i) {
+      exp[i] = static_cast<uint8_t>(x);
+      exp[i + 255] = static_cast<uint8_t>(x);
+      log[x] = static_cast<uint8_t>(i);
+      x <<= 1;
+      if (x & 0x100) {
+        x ^= kPolynomial;
+      }
+    }
+    log[0] = 0;  // Undefined.
+
+    for (int a = 0; a < 256; ++a) {
+      for (int b = 0; b < 256; ++b) {
+        multiply[a][b] = (a == 0 || b == 0) ? 0 : exp[log[a] + log[b]];
+      }
+    }
+  }
+
+  uint8_t Multiply(uint8_t a, uint8_t b) const {
+    return multiply[a][b];
+  }
+
+  uint8_t Inverse(uint8_t a) const {
+    assert(a != 0);
+    return exp[255 - log[a]];
+  }
+
+  uint8_t exp[510];
+  uint8_t log[256];
+  uint8_t multiply[256][256];
+};
+
+const GaloisTables kTables;
+
+void MultiplyTail(uint8_t factor,
+                  const uint8_t* source,
+                  uint8_t* destination,
+                  size_t length,
+                  bool accumulate) {
+  const uint8_t* row = kTables.multiply[factor];
+  if (accumulate) {
+    for (size_t i = 0; i < length; ++i) {
+      destination[i] ^= row[source[i]];
+    }
+  } else {
+    for (size_t i = 0; i < length; ++i) {
+      destination[i] = row[source[i]];
+    }
+  }
+}
+
+#ifdef XTREEMFS_GALOIS_SIMD
+
+enum Implementation { kPortable, kSSSE3, kAVX2 };
+
+Implementation DetectImplementation() {
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx2")) {
+    return kAVX2;
+  }
+  if (__builtin_cpu_supports("ssse3")) {
+    return kSSSE3;
+  }
+  return kPortable;
+}
+
+const Implementation kImplementation = DetectImplementation();
+
+/** The product of a byte is the sum of the products of its low and its high
+ *  nibble, which are looked up in two 16 byte tables by a shuffle. Returns
+ *  the number of processed bytes. */
+__attribute__((target("ssse3")))
+size_t MultiplySSSE3(const uint8_t* low_table,
+                     const uint8_t* high_table,
+                     const uint8_t* source,
+                     uint8_t* destination,
+                     size_t length,
+                     bool accumulate) {
+  const __m128i low = _mm_loadu_si128(
+      reinterpret_cast<const __m128i*>(low_table));
+  const __m128i high = _mm_loadu_si128(
+      reinterpret_cast<const __m128i*>(high_table));
+  const __m128i mask = _mm_set1_epi8(0x0f);
+  size_t i = 0;
+  for (; i + 16 <= length; i += 16) {
+    const __m128i x = _mm_loadu_si128(
+        reinterpret_cast<const __m128i*>(source + i));
+    __m128i product = _mm_xor_si128(
+        _mm_shuffle_epi8(low, _mm_and_si128(x, mask)),
+        _mm_shuffle_epi8(high, _mm_and_si128(_mm_srli_epi64(x, 4), mask)));
+    __m128i* out = reinterpret_cast<__m128i*>(destination + i);
+    if (accumulate) {
+      product = _mm_xor_si128(product, _mm_loadu_si128(out));
+    }
+    _mm_storeu_si128(out, product);
+  }
+  return i;
+}
+
+/** Like MultiplySSSE3(), but 32 bytes at once. */
+__attribute__((target("avx2")))
+size_t MultiplyAVX2(const uint8_t* low_table,
+                    const uint8_t* high_table,
+                    const uint8_t* source,
+                    uint8_t* destination,
+                    size_t length,
+                    bool accumulate) {
+  const __m128i low128 = _mm_loadu_si128(
+      reinterpret_cast<const __m128i*>(low_table));
+  const __m128i high128 = _mm_loadu_si128(
+      reinterpret_cast<const __m128i*>(high_table));
+  // vpshufb looks up within each 128 bit lane, so both lanes get the tables.
+  const __m256i low =
+      _mm256_inserti128_si256(_mm256_castsi128_si256(low128), low128, 1);
+  const __m256i high =
+      _mm256_inserti128_si256(_mm256_castsi128_si256(high128), high128, 1);
+  const __m256i mask = _mm256_set1_epi8(0x0f);
+  size_t i = 0;
+  for (; i + 32 <= length; i += 32) {
+    const __m256i x = _mm256_loadu_si256(
+        reinterpret_cast<const __m256i*>(source + i));
+    __m256i product = _mm256_xor_si256(
+        _mm256_shuffle_epi8(low, _mm256_and_si256(x, mask)),
+        _mm256_shuffle_epi8(high,
+                            _mm256_and_si256(_mm256_srli_epi64(x, 4), mask)));
+    __m256i* out = reinterpret_cast<__m256i*>(destination + i);
+    if (accumulate) {
+      product = _mm256_xor_si256(product, _mm256_loadu_si256(out));
+    }
+    _mm256_storeu_si256(out, product);
+  }
+  return i;
+}
+
+#endif  // XTREEMFS_GALOIS_SIMD
+
+}  // anonymous namespace
+
+void GaloisMultiplyRegion(uint8_t factor,
+                          const char* source,
+                          char* destination,
+                          size_t length,
+                          bool accumulate) {
+#ifdef XTREEMFS_GALOIS_SIMD
+  if (kImplementation != kPortable && factor != 0) {
+    const uint8_t* row = kTables.multiply[factor];
+    uint8_t low_table[16];
+    uint8_t high_table[16];
+    for (int i = 0; i < 16; ++i) {
+      low_table[i] = row[i];
+      high_table[i] = row[i << 4];
+    }
+    const uint8_t* in = reinterpret_cast<const uint8_t*>(source);
+    uint8_t* out = reinterpret_cast<uint8_t*>(destination);
+    const size_t done = kImplementation == kAVX2
+        ? MultiplyAVX2(low_table, high_table, in, out, length, accumulate)
+        : MultiplySSSE3(low_table, high_table, in, out, length, accumulate);
+    MultiplyTail(factor, in + done, out + done, length - done, accumulate);
+    return;
+  }
+#endif  // XTREEMFS_GALOIS_SIMD
+  GaloisMultiplyRegionPortable(factor,
+                               source,
+                               destination,
+                               length,
+                               accumulate);
+}
+
+void GaloisMultiplyRegionPortable(uint8_t factor,
+                                  const char* source,
+                                  char* destination,
+                                  size_t length,
+                                  bool accumulate) {
+  if (factor == 0) {
+    if (!accumulate) {
+      memset(destination, 0, length);
+    }
+    return;
+  }
+  MultiplyTail(factor,
+               reinterpret_cast<const uint8_t*>(source),
+               reinterpret_cast<uint8_t*>(destination),
+               length,
+               accumulate);
+}
+
+const char* GaloisMultiplyRegionImplementation() {
+#ifdef XTREEMFS_GALOIS_SIMD
+  switch (kImplementation) {
+    case kAVX2:
+      return "AVX2";
+    case kSSSE3:
+      return "SSSE3";
+    case kPortable:
+      break;
+  }
+#endif  // XTREEMFS_GALOIS_SIMD
+  return "portable";
+}
+
+ReedSolomon::ReedSolomon(int data_fragments, int parity_fragments)
+    : data_fragments_(data_fragments),
+      parity_fragments_(parity_fragments),
+      parity_matrix_(parity_fragments * data_fragments) {
+  assert(data_fragments > 0 && parity_fragments >= 0);
+  assert(data_fragments + parity_fragments <= 256);
+  // Every square submatrix of the Cauchy matrix 1 / (x_i + y_j) with
+  // distinct x_i = data_fragments + i and y_j = j is invertible.
+  for (int i = 0; i < parity_fragments; ++i) {
+    for (int j = 0; j < data_fragments; ++j) {
+      parity_matrix_[i * data_fragments + j] =
+          kTables.Inverse(static_cast<uint8_t>((data_fragments + i) ^ j));
+    }
+  }
+}
+
+uint8_t ReedSolomon::Coefficient(int row, int column) const {
+  if (row < data_fragments_) {
+    return row == column ? 1 : 0;
+  }
+  return parity_matrix_[(row - data_fragments_) * data_fragments_ + column];
+}
+
+void ReedSolomon::Encode(const char* const* data,
+                         char* const* parity,
+                         size_t length) const {
+  for (size_t offset = 0; offset < length; offset += kBlockSize) {
+    const size_t block = min(kBlockSize, length - offset);
+    for (int i = 0; i < parity_fragments_; ++i) {
+      for (int j = 0; j < data_fragments_; ++j) {
+        GaloisMultiplyRegion(parity_matrix_[i * data_fragments_ + j],
+                             data[j] + offset,
+                             parity[i] + offset,
+                             block,
+                             j > 0);
+      }
+    }
+  }
+}
+
+void ReedSolomon::Update(int data_fragment,
+                         const char* delta,
+                         char* const* parity,
+                         size_t length) const {
+  assert(data_fragment >= 0 && data_fragment < data_fragments_);
+  // The code is linear, so the parity changes by the product of the delta.
+  for (int i = 0; i < parity_fragments_; ++i) {
+    GaloisMultiplyRegion(parity_matrix_[i * data_fragments_ + data_fragment],
+                         delta,
+                         parity[i],
+                         length,
+                         true);
+  }
+}
+
+bool ReedSolomon::Reconstruct(char* const* fragments,
+                              const std::vector<bool>& available,
+                              size_t length) const {
+  const int k = data_fragments_;
+  const int total = data_fragments_ + parity_fragments_;
+  assert(available.size() == static_cast<size_t>(total));
+
+  // Any k available fragments determine the data.
+  vector<int> rows;
+  for (int i = 0; i < total && static_cast<int>(rows.size()) < k; ++i) {
+    if (available[i]) {
+      rows.push_back(i);
+    }
+  }
+  if (static_cast<int>(rows.size()) < k) {
+    return false;
+  }
+
+  // Invert the rows of the generator matrix by Gauss-Jordan elimination.
+  vector<uint8_t> matrix(k * k);
+  vector<uint8_t> inverse(k * k, 0);
+  for (int r = 0; r < k; ++r) {
+    for (int c = 0; c < k; ++c) {
+      matrix[r * k + c] = Coefficient(rows[r], c);
+    }
+    inverse[r * k + r] = 1;
+  }
+  for (int c = 0; c < k; ++c) {
+    int pivot = c;
+    while (pivot < k && matrix[pivot * k + c] == 0) {
+      ++pivot;
+    }
+    if (pivot == k) {
+      return false;  // Cannot happen for a Cauchy matrix.
+    }
+    if (pivot != c) {
+      for (int i = 0; i < k; ++i) {
+        swap(matrix[pivot * k + i], matrix[c * k + i]);
+        swap(inverse[pivot * k + i], inverse[c * k + i]);
+      }
+    }
+    const uint8_t scale = kTables.Inverse(matrix[c * k + c]);
+    for (int i = 0; i < k; ++i) {
+      matrix[c * k + i] = kTables.Multiply(matrix[c * k + i], scale);
+      inverse[c * k + i] = kTables.Multiply(inverse[c * k + i], scale);
+    }
+    for (int r = 0; r < k; ++r) {
+      const uint8_t factor = matrix[r * k + c];
+      if (r == c || factor == 0) {
+        continue;
+      }
+      for (int i = 0; i < k; ++i) {
+        matrix[r * k + i] ^= kTables.Multiply(factor, matrix[c * k + i]);
+        inverse[r * k + i] ^= kTables.Multiply(factor, inverse[c * k + i]);
+      }
+    }
+  }
+
+  for (size_t offset = 0; offset < length; offset += kBlockSize) {
+    const size_t block = min(kBlockSize, length - offset);
+    // Missing data fragments are combinations of the available fragments.
+    for (int d = 0; d < k; ++d) {
+      if (available[d]) {
+        continue;
+      }
+      for (int t = 0; t < k; ++t) {
+        GaloisMultiplyRegion(inverse[d * k + t],
+                             fragments[rows[t]] + offset,
+                             fragments[d] + offset,
+                             block,
+                             t > 0);
+      }
+    }
+    // Missing parity fragments are encoded again from the complete data.
+    for (int p = k; p < total; ++p) {
+      if (available[p]) {
+        continue;
+      }
+      for (int j = 0; j < k; ++j) {
+        GaloisMultiplyRegion(Coefficient(p, j),
+                             fragments[j] + offset,
+                             fragments[p] + offset,
+                             block,
+                             j > 0);
+      }
+    }
+  }
+  return true;
+}
+
+}  // namespace util
+}  // namespace xtreemfs
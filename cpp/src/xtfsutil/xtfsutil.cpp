@@ -915,6 +915,95 @@ bool ShowErrors(const string& xctl_file,
   }
 }
 
+// Shows the latency and error rate which the client measured per server.
+bool ShowServerScores(const string& xctl_file,
+                      const string& path,
+                      const variables_map& vm) {
+  Json::Value request(Json::objectValue);
+  request["operation"] = "getServerScores";
+
+  Json::Value response;
+  if (executeOperation(xctl_file, request, &response)) {
+    const int setwAddress = 35;
+    const int setwValue = 12;
+    cout << setw(setwAddress) << left << "Server"
+         << right
+         << setw(setwValue) << "Latency ms"
+         << setw(setwValue) << "Error rate"
+         << setw(setwValue) << "Requests"
+         << setw(setwValue) << "Errors" << endl;
+    for (Json::ArrayIndex i = 0; i < response["result"].size(); i++) {
+      const Json::Value& server = response["result"][i];
+      cout << setw(setwAddress) << left << server["address"].asString()
+           << right << fixed << setprecision(2)
+           << setw(setwValue) << server["average_latency_ms"].asDouble()
+           << setw(setwValue) << server["error_rate"].asDouble()
+           << setw(setwValue) << server["requests"].asUInt64()
+           << setw(setwValue) << server["errors"].asUInt64();
+      if (server["degraded"].asBool()) {
+        cout << "  (degraded)";
+      }
+      cout << endl;
+    }
+    cout << endl;
+    return true;
+  } else {
+    cerr << "Showing server scores FAILED" << endl;
+    return false;
+  }
+}
+
+// Shows the counters and latency histograms of the client.
+bool ShowMetrics(const string& xctl_file,
+                 const string& path,
+                 const variables_map& vm) {
+  Json::Value request(Json::objectValue);
+  request["operation"] = "getMetrics";
+
+  Json::Value response;
+  if (executeOperation(xctl_file, request, &response)) {
+    const int setwName = 45;
+    const int setwValue = 10;
+    const Json::Value& counters = response["result"]["counters"];
+    const Json::Value::Members counter_names = counters.getMemberNames();
+    cout << setw(setwName) << left << "Counter"
+         << right << setw(setwValue) << "Value" << endl;
+    for (size_t i = 0; i < counter_names.size(); ++i) {
+      cout << setw(setwName) << left << counter_names[i]
+           << right << setw(setwValue)
+           << counters[counter_names[i]].asInt64() << endl;
+    }
+    cout << endl;
+
+    const Json::Value& histograms = response["result"]["histograms"];
+    const Json::Value::Members histogram_names = histograms.getMemberNames();
+    cout << setw(setwName) << left << "Histogram"
+         << right
+         << setw(setwValue) << "Count"
+         << setw(setwValue) << "p50"
+         << setw(setwValue) << "p90"
+         << setw(setwValue) << "p99"
+         << setw(setwValue) << "p99.9"
+         << setw(setwValue) << "Max" << endl;
+    for (size_t i = 0; i < histogram_names.size(); ++i) {
+      const Json::Value& histogram = histograms[histogram_names[i]];
+      cout << setw(setwName) << left << histogram_names[i]
+           << right
+           << setw(setwValue) << histogram["count"].asUInt64()
+           << setw(setwValue) << histogram["p50"].asInt64()
+           << setw(setwValue) << histogram["p90"].asInt64()
+           << setw(setwValue) << histogram["p99"].asInt64()
+           << setw(setwValue) << histogram["p999"].asInt64()
+           << setw(setwValue) << histogram["max"].asInt64() << endl;
+    }
+    cout << endl;
+    return true;
+  } else {
+    cerr << "Showing metrics FAILED" << endl;
+    return false;
+  }
+}
+
 // Returns a list of OSDs suitable for a new replica.
 bool GetSuitableOSDs(const string& xctl_file,
                      const string& path,
@@ -1339,6 +1428,9 @@ int main(int argc, char **argv) {
       ("help,h", "produce help message")
       ("version,V", "Show the version number.")
       ("errors", "show client errors for a volume")
+      ("server-scores",
+       "show the latency and error rate the client measured per server")
+      ("metrics", "show the counters and latency percentiles of the client")
       ("set-dsp", "set (change) the default striping policy (volume)")
       ("striping-policy,p",
        value<string>()->implicit_value("RAID0"),
@@ -1648,6 +1740,15 @@ int main(int argc, char **argv) {
     ++operationsCount;
     failedOperationsCount += ShowErrors(xctl_file, path_on_volume, vm) ? 0 : 1;
   }
+  if (vm.count("server-scores") > 0) {
+    ++operationsCount;
+    failedOperationsCount +=
+        ShowServerScores(xctl_file, path_on_volume, vm) ? 0 : 1;
+  }
+  if (vm.count("metrics") > 0) {
+    ++operationsCount;
+    failedOperationsCount += ShowMetrics(xctl_file, path_on_volume, vm) ? 0 : 1;
+  }
   if (vm.count("set-quota") > 0) {
     ++operationsCount;
     failedOperationsCount += SetQuota(xctl_file, path_on_volume, vm) ? 0 : 1;
@@ -23,8 +23,10 @@
 #include "libxtreemfs/volume.h"
 #include "libxtreemfs/xtreemfs_exception.h"
 #include "libxtreemfs/helper.h"
+#include "rpc/server_statistics.h"
 #include "util/error_log.h"
 #include "util/logging.h"
+#include "util/metrics.h"
 
 using namespace std;
 using namespace xtreemfs::util;
@@ -82,6 +84,10 @@ void XtfsUtilServer::ParseAndExecute(const xtreemfs::pbrpc::UserCredentials& uc,
   try {
     if (op_name == "getErrors") {
       OpGetErrors(uc, input, &result);
+    } else if (op_name == "getServerScores") {
+      OpGetServerScores(uc, input, &result);
+    } else if (op_name == "getMetrics") {
+      OpGetMetrics(uc, input, &result);
     } else if (op_name == "getattr") {
       OpStat(uc, input, &result);
     } else if (op_name == "setDefaultSP") {
@@ -147,6 +153,69 @@ void XtfsUtilServer::OpGetErrors(const xtreemfs::pbrpc::UserCredentials& uc,
   (*output)["result"] = result;
 }
 
+void XtfsUtilServer::OpGetServerScores(
+    const xtreemfs::pbrpc::UserCredentials& uc,
+    const Json::Value& input,
+    Json::Value* output) {
+  map<string, rpc::ServerScore> scores;
+  client_->GetServerScores(&scores);
+
+  Json::Value result = Json::Value(Json::arrayValue);
+  for (map<string, rpc::ServerScore>::const_iterator it = scores.begin();
+       it != scores.end(); ++it) {
+    Json::Value server(Json::objectValue);
+    server["address"] = Json::Value(it->first);
+    server["average_latency_ms"] =
+        Json::Value(it->second.average_latency_us / 1000);
+    server["error_rate"] = Json::Value(it->second.error_rate);
+    server["requests"] =
+        Json::Value(static_cast<Json::UInt64>(it->second.requests));
+    server["errors"] = Json::Value(static_cast<Json::UInt64>(it->second.errors));
+    server["degraded"] = Json::Value(it->second.degraded);
+    result.append(server);
+  }
+  (*output)["result"] = result;
+}
+
+void XtfsUtilServer::OpGetMetrics(const xtreemfs::pbrpc::UserCredentials& uc,
+                                  const Json::Value& input,
+                                  Json::Value* output) {
+  map<string, int64_t> values;
+  map<string, HistogramSnapshot> snapshots;
+  MetricsRegistry::instance()->GetCounterValues(&values);
+  MetricsRegistry::instance()->GetHistogramSnapshots(&snapshots);
+
+  Json::Value counters(Json::objectValue);
+  for (map<string, int64_t>::const_iterator it = values.begin();
+       it != values.end(); ++it) {
+    counters[it->first] = Json::Value(static_cast<Json::Int64>(it->second));
+  }
+
+  Json::Value histograms(Json::objectValue);
+  for (map<string, HistogramSnapshot>::const_iterator it = snapshots.begin();
+       it != snapshots.end(); ++it) {
+    const HistogramSnapshot& snapshot = it->second;
+    Json::Value histogram(Json::objectValue);
+    histogram["count"] = Json::Value(static_cast<Json::UInt64>(snapshot.count));
+    histogram["sum"] = Json::Value(static_cast<Json::Int64>(snapshot.sum));
+    histogram["max"] = Json::Value(static_cast<Json::Int64>(snapshot.max));
+    histogram["p50"] = Json::Value(
+        static_cast<Json::Int64>(snapshot.ValueAtPercentile(50)));
+    histogram["p90"] = Json::Value(
+        static_cast<Json::Int64>(snapshot.ValueAtPercentile(90)));
+    histogram["p99"] = Json::Value(
+        static_cast<Json::Int64>(snapshot.ValueAtPercentile(99)));
+    histogram["p999"] = Json::Value(
+        static_cast<Json::Int64>(snapshot.ValueAtPercentile(99.9)));
+    histograms[it->first] = histogram;
+  }
+
+  Json::Value result(Json::objectValue);
+  result["counters"] = counters;
+  result["histograms"] = histograms;
+  (*output)["result"] = result;
+}
+
 void XtfsUtilServer::OpStat(const xtreemfs::pbrpc::UserCredentials& uc,
                             const Json::Value& input,
                             Json::Value* output) {
@@ -10,6 +10,8 @@
 #include "xtreemfs/MRC.pb.h"
 #include "xtreemfs/MRCServiceConstants.h"
 
+#include <boost/lexical_cast.hpp>
+#include <cstdio>
 #include <ctime>
 
 using namespace std;
@@ -18,16 +20,30 @@ using namespace xtreemfs::pbrpc;
 namespace xtreemfs {
 namespace rpc {
 
-TestRPCServerMRC::TestRPCServerMRC() : file_size_(1024 * 1024) {
+TestRPCServerMRC::TestRPCServerMRC()
+    : file_size_(1024 * 1024),
+      directory_entries_count_(0),
+      renew_capabilities_error_(POSIX_ERROR_NONE) {
   interface_id_ = INTERFACE_ID_MRC;
+  striping_policy_.set_type(STRIPING_POLICY_RAID0);
+  striping_policy_.set_stripe_size(128);
+  striping_policy_.set_width(1);
   // Register available operations.
   operations_[PROC_ID_OPEN] = Op(this, &TestRPCServerMRC::OpenOperation);
   operations_[PROC_ID_XTREEMFS_RENEW_CAPABILITY] =
       Op(this, &TestRPCServerMRC::RenewCapabilityOperation);
+  operations_[PROC_ID_XTREEMFS_RENEW_CAPABILITY_AND_VOUCHER] =
+      Op(this, &TestRPCServerMRC::RenewCapabilityOperation);
+  operations_[PROC_ID_XTREEMFS_RENEW_CAPABILITIES] =
+      Op(this, &TestRPCServerMRC::RenewCapabilitiesOperation);
+  operations_[PROC_ID_XTREEMFS_UPDATE_FILE_SIZES] =
+      Op(this, &TestRPCServerMRC::UpdateFileSizesOperation);
   operations_[PROC_ID_XTREEMFS_UPDATE_FILE_SIZE] =
       Op(this, &TestRPCServerMRC::UpdateFileSizeOperation);
   operations_[PROC_ID_FTRUNCATE] =
       Op(this, &TestRPCServerMRC::FTruncate);
+  operations_[PROC_ID_READDIR] =
+      Op(this, &TestRPCServerMRC::ReadDirOperation);
   operations_[PROC_ID_XTREEMFS_CLEAR_VOUCHERS] =
       Op(this, &TestRPCServerMRC::ClearVoucherOperation);
 }
@@ -42,6 +58,13 @@ google::protobuf::Message* TestRPCServerMRC::OpenOperation(
     uint32_t* response_data_len) {
   const openRequest* rq = reinterpret_cast<const openRequest*>(&request);
 
+  boost::mutex::scoped_lock lock(mutex_);
+  ++request_counts_[PROC_ID_OPEN];
+  if (file_ids_.find(rq->path()) == file_ids_.end()) {
+    const int file_id = static_cast<int>(file_ids_.size());
+    file_ids_[rq->path()] = file_id;
+  }
+
   openResponse* response = new openResponse();
 
   XCap* xcap = response->mutable_creds()->mutable_xcap();
@@ -49,7 +72,8 @@ google::protobuf::Message* TestRPCServerMRC::OpenOperation(
   xcap->set_client_identity("client_identity");
   xcap->set_expire_time_s(3600);
   xcap->set_expire_timeout_s(static_cast<uint32_t>(time(0)) + 3600);
-  xcap->set_file_id(rq->volume_name() + ":0");
+  xcap->set_file_id(rq->volume_name() + ":"
+      + boost::lexical_cast<string>(file_ids_[rq->path()]));
   xcap->set_replicate_on_close(false);
   xcap->set_server_signature("signature");
   xcap->set_snap_config(SNAP_CONFIG_SNAPS_DISABLED);
@@ -76,9 +100,7 @@ google::protobuf::Message* TestRPCServerMRC::OpenOperation(
     replica->add_osd_uuids(*it);
   }
 
-  replica->mutable_striping_policy()->set_type(STRIPING_POLICY_RAID0);
-  replica->mutable_striping_policy()->set_stripe_size(128);
-  replica->mutable_striping_policy()->set_width(1);
+  replica->mutable_striping_policy()->CopyFrom(striping_policy_);
 
   response->set_timestamp_s(static_cast<uint32_t>(time(0)));
 
@@ -95,6 +117,11 @@ google::protobuf::Message* TestRPCServerMRC::RenewCapabilityOperation(
     uint32_t* response_data_len) {
   const xtreemfs_renew_capabilityRequest* rq = reinterpret_cast<const xtreemfs_renew_capabilityRequest*>(&request);
 
+  {
+    boost::mutex::scoped_lock lock(mutex_);
+    ++request_counts_[PROC_ID_XTREEMFS_RENEW_CAPABILITY_AND_VOUCHER];
+  }
+
   XCap* response = new XCap(rq->xcap());
 
   response->set_expire_time_s(time(0) + 3600);
@@ -118,6 +145,11 @@ google::protobuf::Message* TestRPCServerMRC::UpdateFileSizeOperation(
   //const xtreemfs_update_file_sizeRequest* rq =
   //    reinterpret_cast<const xtreemfs_update_file_sizeRequest*>(&request);
 
+  {
+    boost::mutex::scoped_lock lock(mutex_);
+    ++request_counts_[PROC_ID_XTREEMFS_UPDATE_FILE_SIZE];
+  }
+
   timestampResponse* response = new timestampResponse();
 
   response->set_timestamp_s(static_cast<uint32_t>(time(0)));
@@ -125,6 +157,73 @@ google::protobuf::Message* TestRPCServerMRC::UpdateFileSizeOperation(
   return response;
 }
 
+google::protobuf::Message* TestRPCServerMRC::RenewCapabilitiesOperation(
+    const pbrpc::Auth& auth,
+    const pbrpc::UserCredentials& user_credentials,
+    const google::protobuf::Message& request,
+    const char* data,
+    uint32_t data_len,
+    boost::scoped_array<char>* response_data,
+    uint32_t* response_data_len) {
+  const xtreemfs_renew_capabilitiesRequest* rq =
+      reinterpret_cast<const xtreemfs_renew_capabilitiesRequest*>(&request);
+
+  POSIXErrno error;
+  {
+    boost::mutex::scoped_lock lock(mutex_);
+    ++request_counts_[PROC_ID_XTREEMFS_RENEW_CAPABILITIES];
+    error = renew_capabilities_error_;
+  }
+
+  struct timeval tp;
+  gettimeofday(&tp, NULL);
+
+  xtreemfs_renew_capabilitiesResponse* response =
+      new xtreemfs_renew_capabilitiesResponse();
+  for (int i = 0; i < rq->xcaps_size(); ++i) {
+    XCap* xcap = response->add_xcaps();
+    xcap->CopyFrom(rq->xcaps(i));
+    if (error != POSIX_ERROR_NONE) {
+      xtreemfs_renew_capabilitiesError* xcap_error = response->add_errors();
+      xcap_error->set_index(i);
+      xcap_error->set_error_type(ERRNO);
+      xcap_error->set_posix_errno(error);
+      xcap_error->set_error_message("XCap not renewed by TestRPCServerMRC");
+      continue;
+    }
+    xcap->set_expire_time_s(time(0) + 3600);
+    xcap->set_expire_timeout_s(3600);
+    xcap->set_expire_time_ms(tp.tv_sec * 1000 + tp.tv_usec / 1000);
+  }
+
+  return response;
+}
+
+google::protobuf::Message* TestRPCServerMRC::UpdateFileSizesOperation(
+    const pbrpc::Auth& auth,
+    const pbrpc::UserCredentials& user_credentials,
+    const google::protobuf::Message& request,
+    const char* data,
+    uint32_t data_len,
+    boost::scoped_array<char>* response_data,
+    uint32_t* response_data_len) {
+  const xtreemfs_update_file_sizesRequest* rq =
+      reinterpret_cast<const xtreemfs_update_file_sizesRequest*>(&request);
+
+  {
+    boost::mutex::scoped_lock lock(mutex_);
+    ++request_counts_[PROC_ID_XTREEMFS_UPDATE_FILE_SIZES];
+  }
+
+  xtreemfs_update_file_sizesResponse* response =
+      new xtreemfs_update_file_sizesResponse();
+  for (int i = 0; i < rq->updates_size(); ++i) {
+    response->add_accepted(true);
+  }
+
+  return response;
+}
+
 google::protobuf::Message* TestRPCServerMRC::FTruncate(
     const pbrpc::Auth& auth,
     const pbrpc::UserCredentials& user_credentials,
@@ -142,6 +241,49 @@ google::protobuf::Message* TestRPCServerMRC::FTruncate(
   return response;
 }
 
+google::protobuf::Message* TestRPCServerMRC::ReadDirOperation(
+    const pbrpc::Auth& auth,
+    const pbrpc::UserCredentials& user_credentials,
+    const google::protobuf::Message& request,
+    const char* data,
+    uint32_t data_len,
+    boost::scoped_array<char>* response_data,
+    uint32_t* response_data_len) {
+  const readdirRequest* rq = reinterpret_cast<const readdirRequest*>(&request);
+
+  boost::mutex::scoped_lock lock(mutex_);
+  ++request_counts_[PROC_ID_READDIR];
+
+  DirectoryEntries* response = new DirectoryEntries();
+  for (uint64_t i = rq->seen_directory_entries_count();
+       i < directory_entries_count_
+           && i < rq->seen_directory_entries_count()
+               + rq->limit_directory_entries_count();
+       ++i) {
+    char name[9];
+    snprintf(name, sizeof(name), "%08d", static_cast<int>(i));
+    DirectoryEntry* entry = response->add_entries();
+    entry->set_name(name);
+    if (!rq->names_only()) {
+      Stat* stbuf = entry->mutable_stbuf();
+      stbuf->set_dev(0);
+      stbuf->set_ino(i + 1);
+      stbuf->set_mode(0100644);
+      stbuf->set_nlink(1);
+      stbuf->set_user_id("user");
+      stbuf->set_group_id("group");
+      stbuf->set_size(file_size_);
+      stbuf->set_atime_ns(0);
+      stbuf->set_mtime_ns(0);
+      stbuf->set_ctime_ns(0);
+      stbuf->set_blksize(4096);
+      stbuf->set_truncate_epoch(0);
+    }
+  }
+
+  return response;
+}
+
 google::protobuf::Message* TestRPCServerMRC::ClearVoucherOperation(
     const pbrpc::Auth& auth,
     const pbrpc::UserCredentials& user_credentials,
@@ -165,5 +307,26 @@ void TestRPCServerMRC::RegisterOSD(std::string uuid) {
   osd_uuids_.push_back(uuid);
 }
 
+void TestRPCServerMRC::SetStripingPolicy(
+    const pbrpc::StripingPolicy& striping_policy) {
+  boost::mutex::scoped_lock lock(mutex_);
+  striping_policy_.CopyFrom(striping_policy);
+}
+
+void TestRPCServerMRC::SetDirectoryEntriesCount(uint64_t count) {
+  boost::mutex::scoped_lock lock(mutex_);
+  directory_entries_count_ = count;
+}
+
+void TestRPCServerMRC::SetRenewCapabilitiesError(pbrpc::POSIXErrno error) {
+  boost::mutex::scoped_lock lock(mutex_);
+  renew_capabilities_error_ = error;
+}
+
+int TestRPCServerMRC::GetRequestCount(uint32_t proc_id) {
+  boost::mutex::scoped_lock lock(mutex_);
+  return request_counts_[proc_id];
+}
+
 } // namespace rpc
 } // namespace xtreemfs
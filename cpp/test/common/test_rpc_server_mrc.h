@@ -13,6 +13,11 @@
 #include <stdint.h>
 
 #include <boost/thread/mutex.hpp>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "xtreemfs/GlobalTypes.pb.h"
 
 namespace google {
 namespace protobuf {
@@ -30,6 +35,20 @@ class TestRPCServerMRC : public TestRPCServer<TestRPCServerMRC> {
   void SetFileSize(uint64_t size);
   void RegisterOSD(std::string uuid);
 
+  /** Sets the striping policy of every opened file, RAID0 over one OSD with
+   *  128 kB objects by default. */
+  void SetStripingPolicy(const pbrpc::StripingPolicy& striping_policy);
+
+  /** Sets the number of entries of every listed directory. */
+  void SetDirectoryEntriesCount(uint64_t count);
+
+  /** Lets xtreemfs_renew_capabilities fail for every XCap with "error", or
+   *  renew them again if "error" is POSIX_ERROR_NONE. */
+  void SetRenewCapabilitiesError(pbrpc::POSIXErrno error);
+
+  /** Returns the number of received requests with the procedure "proc_id". */
+  int GetRequestCount(uint32_t proc_id);
+
  private:
   google::protobuf::Message* OpenOperation(
       const pbrpc::Auth& auth,
@@ -58,6 +77,24 @@ class TestRPCServerMRC : public TestRPCServer<TestRPCServerMRC> {
       boost::scoped_array<char>* response_data,
       uint32_t* response_data_len);
 
+  google::protobuf::Message* RenewCapabilitiesOperation(
+      const pbrpc::Auth& auth,
+      const pbrpc::UserCredentials& user_credentials,
+      const google::protobuf::Message& request,
+      const char* data,
+      uint32_t data_len,
+      boost::scoped_array<char>* response_data,
+      uint32_t* response_data_len);
+
+  google::protobuf::Message* UpdateFileSizesOperation(
+      const pbrpc::Auth& auth,
+      const pbrpc::UserCredentials& user_credentials,
+      const google::protobuf::Message& request,
+      const char* data,
+      uint32_t data_len,
+      boost::scoped_array<char>* response_data,
+      uint32_t* response_data_len);
+
   google::protobuf::Message* FTruncate(
       const pbrpc::Auth& auth,
       const pbrpc::UserCredentials& user_credentials,
@@ -67,6 +104,15 @@ class TestRPCServerMRC : public TestRPCServer<TestRPCServerMRC> {
       boost::scoped_array<char>* response_data,
       uint32_t* response_data_len);
 
+  google::protobuf::Message* ReadDirOperation(
+      const pbrpc::Auth& auth,
+      const pbrpc::UserCredentials& user_credentials,
+      const google::protobuf::Message& request,
+      const char* data,
+      uint32_t data_len,
+      boost::scoped_array<char>* response_data,
+      uint32_t* response_data_len);
+
   google::protobuf::Message* ClearVoucherOperation(
       const pbrpc::Auth& auth,
       const pbrpc::UserCredentials& user_credentials,
@@ -83,6 +129,21 @@ class TestRPCServerMRC : public TestRPCServer<TestRPCServerMRC> {
   uint64_t file_size_;
 
   std::vector<std::string> osd_uuids_;
+
+  pbrpc::StripingPolicy striping_policy_;
+
+  /** Number of entries of every directory, named "00000000", "00000001"... */
+  uint64_t directory_entries_count_;
+
+  /** Error of every XCap of xtreemfs_renew_capabilities, POSIX_ERROR_NONE if
+   *  they are renewed. */
+  pbrpc::POSIXErrno renew_capabilities_error_;
+
+  /** File ID of every opened path, IDs are assigned in the order of opening. */
+  std::map<std::string, int> file_ids_;
+
+  /** Number of received requests per proc_id. */
+  std::map<uint32_t, int> request_counts_;
 };
 
 }  // namespace rpc
@@ -7,6 +7,9 @@
 
 #include "common/test_rpc_server_osd.h"
 
+#include <algorithm>
+#include <cstring>
+
 #include "util/logging.h"
 #include "xtreemfs/OSD.pb.h"
 #include "xtreemfs/OSDServiceConstants.h"
@@ -132,8 +135,13 @@ google::protobuf::Message* TestRPCServerOSD::WriteOperation(
           striping_policy().stripe_size() * 1024;
   const uint64_t offset = rq->object_number() * object_size + rq->offset();
 
-  file_size_ = offset + data_len;
-  assert(file_size_ <= kMaxFileSize);
+  const int64_t end = static_cast<int64_t>(offset + data_len);
+  assert(end <= kMaxFileSize);
+  if (static_cast<int64_t>(offset) > file_size_) {
+    // Data behind a previous truncate reads as zeros.
+    memset(&data_[file_size_], 0, offset - file_size_);
+  }
+  file_size_ = std::max(file_size_, end);
 
   memcpy(&data_[offset], data, data_len);
 
@@ -0,0 +1,139 @@
+/*
+ * Copyright (c) 2015 by Zuse Institute Berlin
+ *
+ * Licensed under the BSD License, see LICENSE file for details.
+ *
+ */
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "fuse/fuse_inode_table.h"
+
+using namespace std;
+
+namespace xtreemfs {
+
+class FuseInodeTableTest : public ::testing::Test {
+ protected:
+  FuseInodeTable table_;
+};
+
+/** The root is always known and never forgotten. */
+TEST_F(FuseInodeTableTest, RootInode) {
+  string path;
+  ASSERT_TRUE(table_.GetPath(FuseInodeTable::kRootInode, &path));
+  EXPECT_EQ("/", path);
+
+  table_.Forget(FuseInodeTable::kRootInode, 1);
+  EXPECT_TRUE(table_.GetPath(FuseInodeTable::kRootInode, &path));
+  EXPECT_EQ(FuseInodeTable::kRootInode, table_.Lookup("/"));
+}
+
+/** An inode is removed after all of its lookups were forgotten. */
+TEST_F(FuseInodeTableTest, LookupAndForget) {
+  const uint64_t inode = table_.Lookup("/file");
+  EXPECT_NE(FuseInodeTable::kRootInode, inode);
+  EXPECT_EQ(inode, table_.Lookup("/file"));
+  EXPECT_EQ(2u, table_.Size());
+
+  string path;
+  table_.Forget(inode, 1);
+  ASSERT_TRUE(table_.GetPath(inode, &path));
+  EXPECT_EQ("/file", path);
+
+  table_.Forget(inode, 1);
+  EXPECT_FALSE(table_.GetPath(inode, &path));
+  EXPECT_EQ(1u, table_.Size());
+
+  // Inode numbers are not reused.
+  EXPECT_NE(inode, table_.Lookup("/file"));
+}
+
+/** Renaming a directory updates the paths of all inodes below it. */
+TEST_F(FuseInodeTableTest, RenameDirectory) {
+  const uint64_t dir = table_.Lookup("/dir");
+  const uint64_t file = table_.Lookup("/dir/file");
+  const uint64_t sibling = table_.Lookup("/dir2");
+  const uint64_t target = table_.Lookup("/new");
+
+  table_.Rename("/dir", "/new");
+
+  string path;
+  ASSERT_TRUE(table_.GetPath(dir, &path));
+  EXPECT_EQ("/new", path);
+  ASSERT_TRUE(table_.GetPath(file, &path));
+  EXPECT_EQ("/new/file", path);
+  ASSERT_TRUE(table_.GetPath(sibling, &path));
+  EXPECT_EQ("/dir2", path);
+  // The replaced target is detached from its path.
+  EXPECT_FALSE(table_.GetPath(target, &path));
+  EXPECT_EQ(dir, table_.Lookup("/new"));
+}
+
+/** A removed inode stays valid until forgotten, but loses its path. */
+TEST_F(FuseInodeTableTest, RemoveDetachesPath) {
+  const uint64_t inode = table_.Lookup("/file");
+  table_.Remove("/file");
+
+  string path;
+  EXPECT_FALSE(table_.GetPath(inode, &path));
+  EXPECT_EQ("/file", path);
+
+  const uint64_t new_inode = table_.Lookup("/file");
+  EXPECT_NE(inode, new_inode);
+
+  // Forgetting the old inode does not affect the new file.
+  table_.Forget(inode, 1);
+  ASSERT_TRUE(table_.GetPath(new_inode, &path));
+  EXPECT_EQ("/file", path);
+  EXPECT_EQ(2u, table_.Size());
+}
+
+/** Inodes with the same file id are hard links of each other until they are
+ *  forgotten. */
+TEST_F(FuseInodeTableTest, HardLinks) {
+  const uint64_t link1 = table_.Lookup("/link1");
+  const uint64_t link2 = table_.Lookup("/link2");
+  const uint64_t link3 = table_.Lookup("/dir/link3");
+  const uint64_t other = table_.Lookup("/other");
+  table_.SetFileId(link1, 42);
+  table_.SetFileId(link2, 42);
+  table_.SetFileId(link3, 42);
+  table_.SetFileId(link3, 42);
+  table_.SetFileId(other, 43);
+
+  vector<uint64_t> links;
+  table_.GetHardLinks(link1, &links);
+  sort(links.begin(), links.end());
+  ASSERT_EQ(2u, links.size());
+  EXPECT_EQ(link2, links[0]);
+  EXPECT_EQ(link3, links[1]);
+
+  uint64_t inode = 0;
+  ASSERT_TRUE(table_.GetInode("/dir/link3", &inode));
+  EXPECT_EQ(link3, inode);
+  EXPECT_FALSE(table_.GetInode("/missing", &inode));
+
+  // Removed inodes are still links, forgotten ones are not.
+  table_.Remove("/link2");
+  table_.Forget(link3, 1);
+  links.clear();
+  table_.GetHardLinks(link1, &links);
+  ASSERT_EQ(1u, links.size());
+  EXPECT_EQ(link2, links[0]);
+
+  links.clear();
+  table_.GetHardLinks(other, &links);
+  EXPECT_TRUE(links.empty());
+
+  // Inodes without file id have no known links.
+  links.clear();
+  table_.GetHardLinks(table_.Lookup("/file"), &links);
+  EXPECT_TRUE(links.empty());
+}
+
+}  // namespace xtreemfs
@@ -0,0 +1,795 @@
+/*
+ * Copyright (c) 2015 by Zuse Institute Berlin
+ *
+ * Licensed under the BSD License, see LICENSE file for details.
+ *
+ */
+
+#include <gtest/gtest.h>
+
+#include <boost/bind.hpp>
+#include <boost/scoped_array.hpp>
+#include <boost/thread/condition.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/thread.hpp>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "common/test_environment.h"
+#include "common/test_rpc_server_dir.h"
+#include "common/test_rpc_server_mrc.h"
+#include "common/test_rpc_server_osd.h"
+#include "libxtreemfs/client.h"
+#include "libxtreemfs/file_handle.h"
+#include "libxtreemfs/options.h"
+#include "libxtreemfs/volume.h"
+#include "libxtreemfs/xtreemfs_exception.h"
+#include "xtreemfs/OSDServiceConstants.h"
+
+using namespace std;
+using namespace xtreemfs::pbrpc;
+using namespace xtreemfs::util;
+
+namespace xtreemfs {
+namespace rpc {
+
+class FileHandleImplementationTest : public ::testing::Test {
+ protected:
+  static const int kObjectSize = 1024 * 128;
+  static const int kObjects = 5;
+
+  virtual void SetUp() {
+    initialize_logger(LEVEL_WARN);
+    test_env.options.connect_timeout_s = 1;
+    test_env.options.request_timeout_s = 1;
+    test_env.options.retry_delay_s = 1;
+    test_env.options.max_parallel_reads = 2;
+    test_env.options.max_read_ahead_objects = 0;
+    ASSERT_TRUE(test_env.Start());
+
+    // Open a volume
+    volume = test_env.client->OpenVolume(
+        test_env.volume_name_,
+        NULL,  // No SSL options.
+        test_env.options);
+
+    // Open a file.
+    file = volume->OpenFile(
+        test_env.user_credentials,
+        "/test_file",
+        static_cast<xtreemfs::pbrpc::SYSTEM_V_FCNTL>(
+            xtreemfs::pbrpc::SYSTEM_V_FCNTL_H_O_CREAT |
+            xtreemfs::pbrpc::SYSTEM_V_FCNTL_H_O_TRUNC |
+            xtreemfs::pbrpc::SYSTEM_V_FCNTL_H_O_RDWR));
+
+    // Fill the file with a pattern which differs for every object.
+    write_buf.reset(new char[kObjectSize * kObjects]);
+    for (int i = 0; i < kObjectSize * kObjects; i++) {
+      write_buf[i] = static_cast<char>(i % 251);
+    }
+    ASSERT_NO_THROW(file->Write(write_buf.get(), kObjectSize * kObjects, 0));
+  }
+
+  virtual void TearDown() {
+    test_env.Stop();
+  }
+
+  TestEnvironment test_env;
+  Volume* volume;
+  FileHandle* file;
+  boost::scoped_array<char> write_buf;
+};
+
+const int FileHandleImplementationTest::kObjectSize;
+const int FileHandleImplementationTest::kObjects;
+
+/** A read spanning several objects returns the data in the right order. */
+TEST_F(FileHandleImplementationTest, ReadMultipleObjects) {
+  const int offset = kObjectSize / 2;
+  const int count = kObjectSize * (kObjects - 1);
+  boost::scoped_array<char> read_buf(new char[count]);
+
+  int received = 0;
+  ASSERT_NO_THROW(received = file->Read(read_buf.get(), count, offset));
+  EXPECT_EQ(count, received);
+  EXPECT_EQ(0, memcmp(write_buf.get() + offset, read_buf.get(), count));
+
+  ASSERT_NO_THROW(file->Close());
+}
+
+/** Let an intermediate read request of a parallel read fail. The object should
+ *  be read again and the read finally succeed. */
+TEST_F(FileHandleImplementationTest, IntermediateReadFail) {
+  const int count = kObjectSize * kObjects;
+  boost::scoped_array<char> read_buf(new char[count]);
+
+  test_env.osds[0]->AddDropRule(
+      new ProcIDFilterRule(xtreemfs::pbrpc::PROC_ID_READ,
+                           new SkipMDropNRule(kObjects / 2, 1)));
+
+  int received = 0;
+  ASSERT_NO_THROW(received = file->Read(read_buf.get(), count, 0));
+  EXPECT_EQ(count, received);
+  EXPECT_EQ(0, memcmp(write_buf.get(), read_buf.get(), count));
+
+  ASSERT_NO_THROW(file->Close());
+}
+
+/** A scatter list whose buffers cross object boundaries is filled in order. */
+TEST_F(FileHandleImplementationTest, ReadV) {
+  const int sizes[] = { 100, kObjectSize, 3 * kObjectSize / 2, 7 };
+  const int kBuffers = sizeof(sizes) / sizeof(sizes[0]);
+  const int offset = kObjectSize / 3;
+  int count = 0;
+  for (int i = 0; i < kBuffers; i++) {
+    count += sizes[i];
+  }
+  boost::scoped_array<char> read_buf(new char[count]);
+  struct iovec iov[kBuffers];
+  char* next = read_buf.get();
+  for (int i = 0; i < kBuffers; i++) {
+    iov[i].iov_base = next;
+    iov[i].iov_len = sizes[i];
+    next += sizes[i];
+  }
+
+  int received = 0;
+  ASSERT_NO_THROW(received = file->ReadV(iov, kBuffers, offset));
+  EXPECT_EQ(count, received);
+  EXPECT_EQ(0, memcmp(write_buf.get() + offset, read_buf.get(), count));
+
+  ASSERT_NO_THROW(file->Close());
+}
+
+/** Many small buffers of a scatter list are written and read back. */
+TEST_F(FileHandleImplementationTest, WriteV) {
+  const int kBufferSize = 4096;
+  const int kBuffers = 2 * kObjectSize / kBufferSize + 3;
+  const int offset = kObjectSize - kBufferSize;
+  const int count = kBuffers * kBufferSize;
+  // The buffers do not lie next to each other.
+  std::vector<std::vector<char> > buffers(kBuffers,
+                                          std::vector<char>(kBufferSize));
+  std::vector<struct iovec> iov(kBuffers);
+  for (int i = 0; i < kBuffers; i++) {
+    for (int j = 0; j < kBufferSize; j++) {
+      buffers[i][j] = static_cast<char>((i * kBufferSize + j) % 13);
+    }
+    iov[i].iov_base = &buffers[i][0];
+    iov[i].iov_len = kBufferSize;
+  }
+
+  int written = 0;
+  ASSERT_NO_THROW(written = file->WriteV(&iov[0], kBuffers, offset));
+  EXPECT_EQ(count, written);
+
+  boost::scoped_array<char> read_buf(new char[count]);
+  ASSERT_EQ(count, file->Read(read_buf.get(), count, offset));
+  for (int i = 0; i < kBuffers; i++) {
+    EXPECT_EQ(0, memcmp(&buffers[i][0],
+                        read_buf.get() + i * kBufferSize,
+                        kBufferSize));
+  }
+
+  ASSERT_NO_THROW(file->Close());
+}
+
+/** Counts the completed ReadAsync() and WriteAsync() calls. */
+class IOCompletionCounter {
+ public:
+  IOCompletionCounter() : completed_(0), bytes_(0), errors_(0) {}
+
+  void Completed(int bytes, const XtreemFSException* error) {
+    boost::mutex::scoped_lock lock(mutex_);
+    ++completed_;
+    bytes_ += bytes;
+    if (error != NULL) {
+      ++errors_;
+    }
+    completed_changed_.notify_all();
+  }
+
+  FileHandle::IOCompletedCallback callback() {
+    return boost::bind(&IOCompletionCounter::Completed, this, _1, _2);
+  }
+
+  /** Waits up to ten seconds until "count" calls completed. */
+  bool WaitFor(int count) {
+    boost::mutex::scoped_lock lock(mutex_);
+    const boost::system_time deadline =
+        boost::get_system_time() + boost::posix_time::seconds(10);
+    while (completed_ < count) {
+      if (!completed_changed_.timed_wait(lock, deadline)) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  int bytes() {
+    boost::mutex::scoped_lock lock(mutex_);
+    return bytes_;
+  }
+
+  int errors() {
+    boost::mutex::scoped_lock lock(mutex_);
+    return errors_;
+  }
+
+ private:
+  boost::mutex mutex_;
+  boost::condition completed_changed_;
+  int completed_;
+  int bytes_;
+  int errors_;
+};
+
+/** Many reads are in flight at once and their data ends up in the right
+ *  buffers. */
+TEST_F(FileHandleImplementationTest, ReadAsync) {
+  const int kReads = kObjects * 2;
+  const int count = kObjectSize / 2;
+  boost::scoped_array<char> read_buf(new char[kReads * count]);
+  IOCompletionCounter counter;
+
+  for (int i = 0; i < kReads; i++) {
+    file->ReadAsync(read_buf.get() + i * count, count, i * count,
+                    counter.callback());
+  }
+  ASSERT_TRUE(counter.WaitFor(kReads));
+  EXPECT_EQ(0, counter.errors());
+  EXPECT_EQ(kReads * count, counter.bytes());
+  EXPECT_EQ(0, memcmp(write_buf.get(), read_buf.get(), kReads * count));
+
+  ASSERT_NO_THROW(file->Close());
+}
+
+/** Reads beyond the end of the file complete with the bytes read. */
+TEST_F(FileHandleImplementationTest, ReadAsyncBeyondEndOfFile) {
+  const int count = kObjectSize * 2;
+  boost::scoped_array<char> read_buf(new char[count]);
+  IOCompletionCounter counter;
+
+  file->ReadAsync(read_buf.get(), count, kObjectSize * (kObjects - 1),
+                  counter.callback());
+  ASSERT_TRUE(counter.WaitFor(1));
+  EXPECT_EQ(0, counter.errors());
+  EXPECT_EQ(kObjectSize, counter.bytes());
+
+  ASSERT_NO_THROW(file->Close());
+}
+
+/** A dropped object request of an asynchronous read is retried. */
+TEST_F(FileHandleImplementationTest, ReadAsyncObjectFails) {
+  const int count = kObjectSize * kObjects;
+  boost::scoped_array<char> read_buf(new char[count]);
+  IOCompletionCounter counter;
+
+  test_env.osds[0]->AddDropRule(
+      new ProcIDFilterRule(xtreemfs::pbrpc::PROC_ID_READ,
+                           new SkipMDropNRule(kObjects / 2, 1)));
+
+  file->ReadAsync(read_buf.get(), count, 0, counter.callback());
+  ASSERT_TRUE(counter.WaitFor(1));
+  EXPECT_EQ(0, counter.errors());
+  EXPECT_EQ(count, counter.bytes());
+  EXPECT_EQ(0, memcmp(write_buf.get(), read_buf.get(), count));
+
+  ASSERT_NO_THROW(file->Close());
+}
+
+/** Asynchronous writes of several objects are sent at once, also beyond the
+ *  end of the file. */
+TEST_F(FileHandleImplementationTest, WriteAsync) {
+  const int count = kObjectSize * (kObjects + 1);
+  boost::scoped_array<char> new_data(new char[count]);
+  for (int i = 0; i < count; i++) {
+    new_data[i] = static_cast<char>(i % 13);
+  }
+  IOCompletionCounter counter;
+
+  file->WriteAsync(new_data.get(), kObjectSize, 0, counter.callback());
+  file->WriteAsync(new_data.get() + kObjectSize, count - kObjectSize,
+                   kObjectSize, counter.callback());
+  ASSERT_TRUE(counter.WaitFor(2));
+  EXPECT_EQ(0, counter.errors());
+  EXPECT_EQ(count, counter.bytes());
+
+  boost::scoped_array<char> read_buf(new char[count]);
+  ASSERT_EQ(count, file->Read(read_buf.get(), count, 0));
+  EXPECT_EQ(0, memcmp(new_data.get(), read_buf.get(), count));
+
+  ASSERT_NO_THROW(file->Close());
+}
+
+class FileHandleImplementationAsyncWriteTest
+    : public FileHandleImplementationTest {
+ public:
+  void BufferReleased() {
+    boost::mutex::scoped_lock lock(mutex_);
+    ++buffers_released_;
+  }
+
+ protected:
+  FileHandleImplementationAsyncWriteTest() : buffers_released_(0) {}
+
+  virtual void SetUp() {
+    test_env.options.enable_async_writes = true;
+    FileHandleImplementationTest::SetUp();
+  }
+
+  int buffers_released() {
+    boost::mutex::scoped_lock lock(mutex_);
+    return buffers_released_;
+  }
+
+  boost::mutex mutex_;
+  int buffers_released_;
+};
+
+/** The buffer of a zero copy write is released once after all objects were
+ *  written, and the written data is correct. */
+TEST_F(FileHandleImplementationAsyncWriteTest, WriteZeroCopy) {
+  const int count = kObjectSize * kObjects;
+  boost::scoped_array<char> zero_copy_buf(new char[count]);
+  for (int i = 0; i < count; i++) {
+    zero_copy_buf[i] = static_cast<char>(i % 241);
+  }
+
+  int written = 0;
+  ASSERT_NO_THROW(written = file->WriteZeroCopy(
+      zero_copy_buf.get(), count, 0,
+      boost::bind(&FileHandleImplementationAsyncWriteTest::BufferReleased,
+                  this)));
+  EXPECT_EQ(count, written);
+  ASSERT_NO_THROW(file->Flush());
+  EXPECT_EQ(1, buffers_released());
+
+  boost::scoped_array<char> read_buf(new char[count]);
+  int received = 0;
+  ASSERT_NO_THROW(received = file->Read(read_buf.get(), count, 0));
+  EXPECT_EQ(count, received);
+  EXPECT_EQ(0, memcmp(zero_copy_buf.get(), read_buf.get(), count));
+
+  ASSERT_NO_THROW(file->Close());
+}
+
+/** With asynchronous writes, WriteAsync() is executed by Write(). */
+TEST_F(FileHandleImplementationAsyncWriteTest, WriteAsyncFallsBackToWrite) {
+  IOCompletionCounter counter;
+  file->WriteAsync(write_buf.get(), kObjectSize * 2, 0, counter.callback());
+  ASSERT_TRUE(counter.WaitFor(1));
+  EXPECT_EQ(0, counter.errors());
+  EXPECT_EQ(kObjectSize * 2, counter.bytes());
+
+  ASSERT_NO_THROW(file->Close());
+}
+
+class FileHandleImplementationWriteCombinerTest
+    : public FileHandleImplementationTest {
+ protected:
+  virtual void SetUp() {
+    test_env.options.enable_async_writes = true;
+    // Do not let the periodic thread send combined writes during the test.
+    test_env.options.async_writes_combine_timeout_ms = 60 * 1000;
+    FileHandleImplementationTest::SetUp();
+  }
+};
+
+/** Small sequential writes to one object are sent as one write request. */
+TEST_F(FileHandleImplementationWriteCombinerTest, CombineSequentialWrites) {
+  ASSERT_NO_THROW(file->Flush());
+  const size_t writes_before = test_env.osds[0]->GetReceivedWrites().size();
+
+  // Rewrite the beginning of the last object. (The test OSD truncates the file
+  // to the end of the last write.)
+  const int object_offset = kObjectSize * (kObjects - 1);
+  const int chunk_size = 4096;
+  const int chunks = 16;
+  for (int i = 0; i < chunks; i++) {
+    const int offset = object_offset + i * chunk_size;
+    memset(write_buf.get() + offset, 'a' + i, chunk_size);
+    ASSERT_NO_THROW(file->Write(write_buf.get() + offset, chunk_size, offset));
+  }
+  // An overlapping write is merged, too.
+  const int offset = object_offset + chunk_size / 2;
+  memset(write_buf.get() + offset, 'x', chunk_size);
+  ASSERT_NO_THROW(file->Write(write_buf.get() + offset, chunk_size, offset));
+  EXPECT_EQ(writes_before, test_env.osds[0]->GetReceivedWrites().size());
+
+  ASSERT_NO_THROW(file->Flush());
+  ASSERT_EQ(writes_before + 1, test_env.osds[0]->GetReceivedWrites().size());
+  EXPECT_TRUE(WriteEntry(kObjects - 1, 0, chunks * chunk_size) ==
+              test_env.osds[0]->GetReceivedWrites().back());
+
+  const int count = object_offset + chunks * chunk_size;
+  boost::scoped_array<char> read_buf(new char[count]);
+  int received = 0;
+  ASSERT_NO_THROW(received = file->Read(read_buf.get(), count, 0));
+  EXPECT_EQ(count, received);
+  EXPECT_EQ(0, memcmp(write_buf.get(), read_buf.get(), count));
+
+  ASSERT_NO_THROW(file->Close());
+}
+
+class FileHandleImplementationObjectCacheTest
+    : public FileHandleImplementationTest {
+ protected:
+  virtual void SetUp() {
+    // Large enough for all objects of the file.
+    test_env.options.object_cache_size_mb = 1;
+    FileHandleImplementationTest::SetUp();
+  }
+};
+
+/** Small writes are collected in the object cache and every dirty object is
+ *  written back once on Flush(). */
+TEST_F(FileHandleImplementationObjectCacheTest, WriteBackOnFlush) {
+  const int count = kObjectSize * kObjects;
+  for (int i = 0; i < 10; i++) {
+    const int offset = kObjectSize / 3 + i * 7;
+    ASSERT_NO_THROW(file->Write("abc", 3, offset));
+    memcpy(write_buf.get() + offset, "abc", 3);
+  }
+  EXPECT_EQ(0u, test_env.osds[0]->GetReceivedWrites().size());
+
+  ASSERT_NO_THROW(file->Flush());
+  EXPECT_EQ(static_cast<size_t>(kObjects),
+            test_env.osds[0]->GetReceivedWrites().size());
+
+  boost::scoped_array<char> read_buf(new char[count]);
+  int received = 0;
+  ASSERT_NO_THROW(received = file->Read(read_buf.get(), count, 0));
+  EXPECT_EQ(count, received);
+  EXPECT_EQ(0, memcmp(write_buf.get(), read_buf.get(), count));
+
+  ASSERT_NO_THROW(file->Close());
+  EXPECT_EQ(static_cast<size_t>(kObjects),
+            test_env.osds[0]->GetReceivedWrites().size());
+}
+
+/** Truncate drops cached objects behind the new file size. */
+TEST_F(FileHandleImplementationObjectCacheTest, Truncate) {
+  const int new_size = kObjectSize + kObjectSize / 2;
+  ASSERT_NO_THROW(file->Truncate(test_env.user_credentials, new_size));
+
+  boost::scoped_array<char> read_buf(new char[kObjectSize * kObjects]);
+  int received = 0;
+  ASSERT_NO_THROW(
+      received = file->Read(read_buf.get(), kObjectSize * kObjects, 0));
+  EXPECT_EQ(new_size, received);
+  EXPECT_EQ(0, memcmp(write_buf.get(), read_buf.get(), new_size));
+
+  ASSERT_NO_THROW(file->Close());
+  EXPECT_EQ(2u, test_env.osds[0]->GetReceivedWrites().size());
+}
+
+class FileHandleImplementationReadAheadTest
+    : public FileHandleImplementationTest {
+ protected:
+  virtual void SetUp() {
+    FileHandleImplementationTest::SetUp();
+    test_env.options.max_read_ahead_objects = 4;
+    // Reopen the file as the read-ahead is set up when a file is opened.
+    ASSERT_NO_THROW(file->Close());
+    file = volume->OpenFile(
+        test_env.user_credentials,
+        "/test_file",
+        static_cast<xtreemfs::pbrpc::SYSTEM_V_FCNTL>(
+            xtreemfs::pbrpc::SYSTEM_V_FCNTL_H_O_RDWR));
+  }
+
+  /** Reads the file sequentially in chunks of half an object, starting at
+   *  "offset", and compares it with write_buf. */
+  void ReadSequentially(int offset) {
+    const int chunk_size = kObjectSize / 2;
+    char read_buf[chunk_size];
+    for (; offset < kObjectSize * kObjects; offset += chunk_size) {
+      int received = 0;
+      ASSERT_NO_THROW(received = file->Read(read_buf, chunk_size, offset));
+      ASSERT_EQ(chunk_size, received);
+      ASSERT_EQ(0, memcmp(write_buf.get() + offset, read_buf, chunk_size));
+    }
+  }
+};
+
+/** Sequential reads are served from the read-ahead and return the same data
+ *  including the end of the file. */
+TEST_F(FileHandleImplementationReadAheadTest, SequentialRead) {
+  ReadSequentially(0);
+
+  char read_buf[16];
+  EXPECT_EQ(0, file->Read(read_buf, sizeof(read_buf), kObjectSize * kObjects));
+
+  ASSERT_NO_THROW(file->Close());
+}
+
+/** A read of several objects of which only some were read ahead returns the
+ *  prefetched and the fetched objects. */
+TEST_F(FileHandleImplementationReadAheadTest, ReadPartlyServedByReadAhead) {
+  const int chunk_size = kObjectSize / 2;
+  char first_chunk[chunk_size];
+  ASSERT_NO_THROW(file->Read(first_chunk, chunk_size, 0));
+
+  // Objects 1 and 2 were read ahead, objects 0, 3 and 4 are read in parallel.
+  const int count = kObjectSize * kObjects - chunk_size;
+  boost::scoped_array<char> read_buf(new char[count]);
+  int received = 0;
+  ASSERT_NO_THROW(received = file->Read(read_buf.get(), count, chunk_size));
+  EXPECT_EQ(count, received);
+  EXPECT_EQ(0, memcmp(write_buf.get() + chunk_size, read_buf.get(), count));
+
+  ASSERT_NO_THROW(file->Close());
+}
+
+/** A write discards objects which were read ahead before. */
+TEST_F(FileHandleImplementationReadAheadTest, WriteDiscardsReadAhead) {
+  char read_buf[kObjectSize];
+  for (int i = 0; i < 3; i++) {
+    ASSERT_NO_THROW(file->Read(read_buf, kObjectSize, i * kObjectSize));
+  }
+
+  // The last object was read ahead, overwrite the end of the file.
+  const int offset = kObjectSize * kObjects - 8;
+  ASSERT_NO_THROW(file->Write("new data", 8, offset));
+  memcpy(write_buf.get() + offset, "new data", 8);
+
+  ReadSequentially(3 * kObjectSize);
+  ASSERT_NO_THROW(file->Close());
+}
+
+/** A failed read-ahead request is read again. */
+TEST_F(FileHandleImplementationReadAheadTest, ReadAheadRequestFails) {
+  // Drop the second read request which is the first read-ahead request.
+  test_env.osds[0]->AddDropRule(
+      new ProcIDFilterRule(xtreemfs::pbrpc::PROC_ID_READ,
+                           new SkipMDropNRule(1, 1)));
+
+  ReadSequentially(0);
+  ASSERT_NO_THROW(file->Close());
+}
+
+/** Drops all requests with a certain proc_id and counts them. */
+class CountingDropByProcIDRule : public DropRule {
+ public:
+  explicit CountingDropByProcIDRule(uint32_t proc_id)
+      : proc_id_(proc_id), count_(0) {}
+
+  virtual bool DropRequest(uint32_t proc_id) {
+    boost::mutex::scoped_lock lock(mutex_);
+    if (proc_id != proc_id_) {
+      return false;
+    }
+    ++count_;
+    return true;
+  }
+
+  virtual bool IsPointless() const {
+    return false;
+  }
+
+  int count() {
+    boost::mutex::scoped_lock lock(mutex_);
+    return count_;
+  }
+
+ private:
+  const uint32_t proc_id_;
+  boost::mutex mutex_;
+  int count_;
+};
+
+/** Overwrites "length" bytes at "offset" of "file" "writes" times with the
+ *  number of the write. */
+void WriteRepeatedly(FileHandle* file, int offset, int length, int writes) {
+  vector<char> buf(length);
+  for (int i = 0; i < writes; i++) {
+    memset(&buf[0], i, length);
+    ASSERT_NO_THROW(file->Write(&buf[0], length, offset));
+  }
+}
+
+class FileHandleImplementationErasureCodeTest
+    : public FileHandleImplementationTest {
+ protected:
+  static const int kWidth = 4;
+  static const int kParityWidth = 2;
+
+  virtual void SetUp() {
+    test_env.AddOSDs(kWidth + kParityWidth);
+    StripingPolicy striping_policy;
+    striping_policy.set_type(STRIPING_POLICY_ERASURECODE);
+    striping_policy.set_stripe_size(kObjectSize / 1024);
+    striping_policy.set_width(kWidth);
+    striping_policy.set_parity_width(kParityWidth);
+    test_env.mrc->SetStripingPolicy(striping_policy);
+    // Do not retry reads of failed OSDs before reconstructing their objects.
+    test_env.options.max_read_tries = 1;
+    FileHandleImplementationTest::SetUp();
+  }
+
+  /** Reads the whole file and compares it with write_buf. */
+  void ExpectFileContent() {
+    const int count = kObjectSize * kObjects;
+    boost::scoped_array<char> read_buf(new char[count]);
+    int received = 0;
+    ASSERT_NO_THROW(received = file->Read(read_buf.get(), count, 0));
+    EXPECT_EQ(count, received);
+    EXPECT_EQ(0, memcmp(write_buf.get(), read_buf.get(), count));
+  }
+
+  /** Truncates the file to "new_size", which removes the second stripe, and
+   *  writes to its second object again. Its first object must be
+   *  reconstructed as zeros then, i.e. no parity of the removed data is
+   *  left. */
+  void TruncateAndExpectNoStaleParity(int64_t new_size) {
+    ASSERT_NO_THROW(file->Truncate(test_env.user_credentials, new_size));
+    const string data(1000, 'y');
+    ASSERT_NO_THROW(file->Write(data.data(), data.size(),
+                                (kWidth + 1) * kObjectSize));
+
+    // Object kWidth is stored on OSD 0.
+    test_env.osds[0]->AddDropRule(new DropByProcIDRule(PROC_ID_READ));
+    boost::scoped_array<char> read_buf(new char[kObjectSize]);
+    int received = 0;
+    ASSERT_NO_THROW(received = file->Read(read_buf.get(), kObjectSize,
+                                          kWidth * kObjectSize));
+    EXPECT_EQ(kObjectSize, received);
+    EXPECT_EQ(string(kObjectSize, '\0'), string(read_buf.get(), received));
+  }
+};
+
+const int FileHandleImplementationErasureCodeTest::kWidth;
+const int FileHandleImplementationErasureCodeTest::kParityWidth;
+
+/** The objects are distributed over the data OSDs and every stripe has a
+ *  complete parity object on every parity OSD. */
+TEST_F(FileHandleImplementationErasureCodeTest, WriteStoresParity) {
+  ExpectFileContent();
+
+  // The 5 objects fill the first stripe and the first object of the second.
+  ASSERT_EQ(2u, test_env.osds[0]->GetReceivedWrites().size());
+  EXPECT_TRUE(WriteEntry(kWidth, 0, kObjectSize) ==
+              test_env.osds[0]->GetReceivedWrites().back());
+  EXPECT_EQ(1u, test_env.osds[kWidth - 1]->GetReceivedWrites().size());
+  for (int i = kWidth; i < kWidth + kParityWidth; i++) {
+    ASSERT_EQ(2u, test_env.osds[i]->GetReceivedWrites().size());
+    EXPECT_TRUE(WriteEntry(0, 0, kObjectSize) ==
+                test_env.osds[i]->GetReceivedWrites()[0]);
+    EXPECT_TRUE(WriteEntry(kWidth, 0, kObjectSize) ==
+                test_env.osds[i]->GetReceivedWrites()[1]);
+  }
+
+  ASSERT_NO_THROW(file->Close());
+}
+
+/** The objects of a failed OSD are reconstructed from the other objects of
+ *  their stripe, also if the OSD of a parity object failed as well. */
+TEST_F(FileHandleImplementationErasureCodeTest, DegradedRead) {
+  test_env.osds[1]->AddDropRule(new DropByProcIDRule(PROC_ID_READ));
+  test_env.osds[kWidth]->AddDropRule(new DropByProcIDRule(PROC_ID_READ));
+  ExpectFileContent();
+
+  ASSERT_NO_THROW(file->Close());
+}
+
+/** An OSD which failed is not asked again for the other objects of the
+ *  request. */
+TEST_F(FileHandleImplementationErasureCodeTest, FailedOSDIsRemembered) {
+  // Fill the second stripe, so OSD 1 stores the objects 1 and kWidth + 1.
+  const int count = kObjectSize * 2 * kWidth;
+  boost::scoped_array<char> buf(new char[count]);
+  memcpy(buf.get(), write_buf.get(), kObjectSize * kObjects);
+  for (int i = kObjectSize * kObjects; i < count; i++) {
+    buf[i] = static_cast<char>(i % 13);
+  }
+  ASSERT_NO_THROW(file->Write(buf.get() + kObjectSize * kObjects,
+                              count - kObjectSize * kObjects,
+                              kObjectSize * kObjects));
+
+  // Ownership is transferred to the OSD.
+  CountingDropByProcIDRule* rule = new CountingDropByProcIDRule(PROC_ID_READ);
+  test_env.osds[1]->AddDropRule(rule);
+  boost::scoped_array<char> read_buf(new char[count]);
+  int received = 0;
+  ASSERT_NO_THROW(received = file->Read(read_buf.get(), count, 0));
+  EXPECT_EQ(count, received);
+  EXPECT_EQ(0, memcmp(buf.get(), read_buf.get(), count));
+  EXPECT_EQ(1, rule->count());
+
+  ASSERT_NO_THROW(file->Close());
+}
+
+/** A partial write of an object updates the parity of its stripe. */
+TEST_F(FileHandleImplementationErasureCodeTest, PartialWriteUpdatesParity) {
+  const int offset = 2 * kObjectSize + 1000;
+  ASSERT_NO_THROW(file->Write("new data", 8, offset));
+  memcpy(write_buf.get() + offset, "new data", 8);
+  // Only the written range is sent to the data and parity OSDs.
+  EXPECT_TRUE(WriteEntry(2, 1000, 8) ==
+              test_env.osds[2]->GetReceivedWrites().back());
+  for (int i = kWidth; i < kWidth + kParityWidth; i++) {
+    EXPECT_TRUE(WriteEntry(0, 1000, 8) ==
+                test_env.osds[i]->GetReceivedWrites().back());
+  }
+
+  test_env.osds[2]->AddDropRule(new DropByProcIDRule(PROC_ID_READ));
+  ExpectFileContent();
+
+  ASSERT_NO_THROW(file->Close());
+}
+
+/** Writes of different objects of a stripe by several threads keep the
+ *  parity consistent. */
+TEST_F(FileHandleImplementationErasureCodeTest, ConcurrentWritesOfAStripe) {
+  const int kWrites = 20;
+  const int kLength = 100;
+  boost::thread_group writers;
+  for (int i = 0; i < kWidth; i++) {
+    writers.create_thread(boost::bind(
+        &WriteRepeatedly,
+        file,
+        i * kObjectSize,
+        kLength,
+        kWrites));
+  }
+  writers.join_all();
+  for (int i = 0; i < kWidth; i++) {
+    for (int j = 0; j < kLength; j++) {
+      write_buf[i * kObjectSize + j] = static_cast<char>(kWrites - 1);
+    }
+  }
+
+  test_env.osds[0]->AddDropRule(new DropByProcIDRule(PROC_ID_READ));
+  ExpectFileContent();
+
+  ASSERT_NO_THROW(file->Close());
+}
+
+/** A reconstructed last object of the file is as long as written, also if
+ *  it ends with zeros. */
+TEST_F(FileHandleImplementationErasureCodeTest, DegradedReadOfLastObject) {
+  const int length = 1000;
+  const string data = string(length - 100, 'x') + string(100, '\0');
+  ASSERT_NO_THROW(file->Write(data.data(), length, kObjectSize * kObjects));
+
+  // Object kObjects is stored on OSD 1.
+  test_env.osds[1]->AddDropRule(new DropByProcIDRule(PROC_ID_READ));
+  char read_buf[4 * 1024];
+  int received = 0;
+  ASSERT_NO_THROW(received = file->Read(read_buf, sizeof(read_buf),
+                                        kObjectSize * kObjects));
+  EXPECT_EQ(length, received);
+  EXPECT_EQ(data, string(read_buf, received));
+
+  ASSERT_NO_THROW(file->Close());
+}
+
+/** Truncating onto a stripe boundary removes the parity behind it. */
+TEST_F(FileHandleImplementationErasureCodeTest, TruncateOntoStripeBoundary) {
+  TruncateAndExpectNoStaleParity(kWidth * kObjectSize);
+
+  ASSERT_NO_THROW(file->Close());
+}
+
+/** Shrinking the file by whole stripes removes their parity. */
+TEST_F(FileHandleImplementationErasureCodeTest, TruncateRemovesStripes) {
+  TruncateAndExpectNoStaleParity(1000);
+
+  ASSERT_NO_THROW(file->Close());
+}
+
+/** Without enough objects of a stripe, the read fails. */
+TEST_F(FileHandleImplementationErasureCodeTest, TooManyFailedOSDs) {
+  for (int i = 0; i <= kParityWidth; i++) {
+    test_env.osds[i]->AddDropRule(new DropByProcIDRule(PROC_ID_READ));
+  }
+  char read_buf[16];
+  EXPECT_THROW(file->Read(read_buf, sizeof(read_buf), 0), IOException);
+
+  ASSERT_NO_THROW(file->Close());
+}
+
+}  // namespace rpc
+}  // namespace xtreemfs
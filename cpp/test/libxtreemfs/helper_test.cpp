@@ -15,9 +15,12 @@
 #include <google/protobuf/stubs/common.h>
 
 #include "libxtreemfs/helper.h"
+#include "util/crc32c.h"
 #include "util/logging.h"
+#include "xtreemfs/OSD.pb.h"
 
 using namespace std;
+using namespace xtreemfs::pbrpc;
 using namespace xtreemfs::util;
 
 namespace xtreemfs {
@@ -89,4 +92,35 @@ TEST_F(HelperTest, GetNetworkStringUnixIPv6) {
 }
 #endif  // __linux__
 
+TEST_F(HelperTest, IsObjectDataValid) {
+  const string data = "object data";
+  ObjectData object_data;
+  object_data.set_zero_padding(0);
+  object_data.set_invalid_checksum_on_osd(false);
+  object_data.set_checksum(CRC32C(0, data.data(), data.size()));
+  EXPECT_TRUE(IsObjectDataValid(object_data, data.data(), data.size(), true));
+
+  // Corrupted data is only detected if checksums are verified.
+  const string corrupted = "object dat4";
+  EXPECT_FALSE(IsObjectDataValid(object_data,
+                                 corrupted.data(),
+                                 corrupted.size(),
+                                 true));
+  EXPECT_TRUE(IsObjectDataValid(object_data,
+                                corrupted.data(),
+                                corrupted.size(),
+                                false));
+
+  // OSDs without checksums send 0.
+  object_data.set_checksum(0);
+  EXPECT_TRUE(IsObjectDataValid(object_data,
+                                corrupted.data(),
+                                corrupted.size(),
+                                true));
+
+  // Data which the OSD found to be corrupted is always rejected.
+  object_data.set_invalid_checksum_on_osd(true);
+  EXPECT_FALSE(IsObjectDataValid(object_data, data.data(), data.size(), false));
+}
+
 }  // namespace xtreemfs
@@ -9,9 +9,15 @@
 
 #include <stdint.h>
 
+#include <boost/bind.hpp>
+#include <boost/date_time/posix_time/posix_time_types.hpp>
 #include <boost/lexical_cast.hpp>
 #include <boost/scoped_ptr.hpp>
+#include <boost/thread/thread.hpp>
+#include <iostream>
+#include <set>
 #include <string>
+#include <vector>
 
 #include "libxtreemfs/metadata_cache.h"
 #include "libxtreemfs/helper.h"
@@ -28,7 +34,8 @@ class MetadataCacheTestSize2 : public ::testing::Test {
   virtual void SetUp() {
     initialize_logger(LEVEL_WARN);
 
-    metadata_cache_ = new MetadataCache(2, 3600);  // Max 2 entries, 1 hour.
+    // Max 2 entries, 1 hour.
+    metadata_cache_ = new MetadataCache(2, 3600, 3600);
   }
 
   virtual void TearDown() {
@@ -47,7 +54,28 @@ class MetadataCacheTestSize1024 : public ::testing::Test {
   virtual void SetUp() {
     initialize_logger(LEVEL_WARN);
 
-    metadata_cache_ = new MetadataCache(1024, 3600);  // Max 1k entries, 1 hour.
+    // Max 1k entries, 1 hour.
+    metadata_cache_ = new MetadataCache(1024, 3600, 3600);
+  }
+
+  virtual void TearDown() {
+    delete metadata_cache_;
+
+    google::protobuf::ShutdownProtobufLibrary();
+
+    shutdown_logger();
+  }
+
+  MetadataCache* metadata_cache_;
+};
+
+class MetadataCacheTestSharded : public ::testing::Test {
+ protected:
+  virtual void SetUp() {
+    initialize_logger(LEVEL_WARN);
+
+    // Max 1k entries, 1 hour, 8 shards.
+    metadata_cache_ = new MetadataCache(1024, 3600, 3600, 8);
   }
 
   virtual void TearDown() {
@@ -325,6 +353,315 @@ TEST_F(MetadataCacheTestSize1024, UpdateStatAttributesPreservesModeBits) {
   EXPECT_EQ(262655, cached_stat.mode());  // Octal: 1000777.
 }
 
+/** Entries below a directory are spread over all shards and are all renamed
+ *  or invalidated. */
+TEST_F(MetadataCacheTestSharded, PrefixOperationsSpanAllShards) {
+  const int kFiles = 64;
+  Stat stat;
+  InitializeStat(&stat);
+  metadata_cache_->UpdateStat("/dir", stat);
+  for (int i = 0; i < kFiles; i++) {
+    stat.set_ino(i);
+    metadata_cache_->UpdateStat(
+        "/dir/file" + boost::lexical_cast<string>(i), stat);
+  }
+  metadata_cache_->UpdateStat("/dir.file", stat);
+  EXPECT_EQ(kFiles + 2, metadata_cache_->Size());
+
+  metadata_cache_->RenamePrefix("/dir", "/newdir");
+  EXPECT_EQ(kFiles + 2, metadata_cache_->Size());
+  EXPECT_EQ(MetadataCache::kStatCached,
+            metadata_cache_->GetStat("/newdir", &stat));
+  for (int i = 0; i < kFiles; i++) {
+    const string file = "/file" + boost::lexical_cast<string>(i);
+    EXPECT_EQ(MetadataCache::kStatNotCached,
+              metadata_cache_->GetStat("/dir" + file, &stat));
+    ASSERT_EQ(MetadataCache::kStatCached,
+              metadata_cache_->GetStat("/newdir" + file, &stat));
+    EXPECT_EQ(i, stat.ino());
+  }
+
+  metadata_cache_->InvalidatePrefix("/newdir");
+  EXPECT_EQ(1, metadata_cache_->Size());
+  EXPECT_EQ(MetadataCache::kStatCached,
+            metadata_cache_->GetStat("/dir.file", &stat));
+}
+
+/** A path which is missing in its cached parent directory does not exist,
+ *  even if the parent directory is stored in another shard. */
+TEST_F(MetadataCacheTestSharded, GetStatChecksParentDirectoryInOtherShard) {
+  DirectoryEntries dir_entries;
+  dir_entries.add_entries()->set_name("a");
+  metadata_cache_->UpdateDirEntries("/dir", dir_entries);
+
+  Stat stat;
+  EXPECT_EQ(MetadataCache::kStatNotCached,
+            metadata_cache_->GetStat("/dir/a", &stat));
+  for (int i = 0; i < 16; i++) {
+    EXPECT_EQ(MetadataCache::kPathDoesntExist,
+              metadata_cache_->GetStat(
+                  "/dir/b" + boost::lexical_cast<string>(i), &stat));
+  }
+}
+
+/** A negative entry answers lookups until the path is created or updated. */
+TEST_F(MetadataCacheTestSize1024, NegativeEntry) {
+  Stat stat;
+  InitializeStat(&stat);
+  metadata_cache_->UpdateNegativeEntry("/a");
+  EXPECT_EQ(MetadataCache::kPathDoesntExist,
+            metadata_cache_->GetStat("/a", &stat));
+  EXPECT_EQ(MetadataCache::kStatNotCached,
+            metadata_cache_->GetStat("/b", &stat));
+
+  // The path was created by this client.
+  metadata_cache_->Invalidate("/a");
+  EXPECT_EQ(MetadataCache::kStatNotCached,
+            metadata_cache_->GetStat("/a", &stat));
+
+  metadata_cache_->UpdateNegativeEntry("/a");
+  stat.set_ino(1);
+  metadata_cache_->UpdateStat("/a", stat);
+  EXPECT_EQ(MetadataCache::kStatCached, metadata_cache_->GetStat("/a", &stat));
+  EXPECT_EQ(1, stat.ino());
+
+  // A negative entry replaces everything cached for the path.
+  metadata_cache_->UpdateNegativeEntry("/a");
+  EXPECT_EQ(MetadataCache::kPathDoesntExist,
+            metadata_cache_->GetStat("/a", &stat));
+  EXPECT_EQ(1, metadata_cache_->Size());
+}
+
+/** Renaming a directory over a path below which negative entries are cached
+ *  removes them. */
+TEST_F(MetadataCacheTestSize1024, RenamePrefixOverNegativeEntries) {
+  Stat stat;
+  InitializeStat(&stat);
+  metadata_cache_->UpdateNegativeEntry("/new/a.h");
+  metadata_cache_->UpdateStat("/old/a.h", stat);
+
+  metadata_cache_->InvalidatePrefix("/new");
+  metadata_cache_->RenamePrefix("/old", "/new");
+  EXPECT_EQ(MetadataCache::kStatCached,
+            metadata_cache_->GetStat("/new/a.h", &stat));
+}
+
+TEST(MetadataCacheTest, NegativeEntriesCanBeDisabled) {
+  initialize_logger(LEVEL_WARN);
+  {
+    MetadataCache metadata_cache(1024, 3600, 0);
+    Stat stat;
+    metadata_cache.UpdateNegativeEntry("/a");
+    EXPECT_EQ(MetadataCache::kStatNotCached,
+              metadata_cache.GetStat("/a", &stat));
+    EXPECT_EQ(0, metadata_cache.Size());
+  }
+  shutdown_logger();
+}
+
+/** Lookups of names missing in a completely listed directory are answered
+ *  until an entry is added to the directory. */
+TEST_F(MetadataCacheTestSize1024, UpdateDirNames) {
+  DirectoryEntries dir_entries;
+  dir_entries.add_entries()->set_name("b");
+  dir_entries.add_entries()->set_name("a");
+  metadata_cache_->UpdateDirNames("/dir", dir_entries);
+
+  Stat stat;
+  EXPECT_EQ(MetadataCache::kStatNotCached,
+            metadata_cache_->GetStat("/dir/a", &stat));
+  EXPECT_EQ(MetadataCache::kStatNotCached,
+            metadata_cache_->GetStat("/dir/b", &stat));
+  EXPECT_EQ(MetadataCache::kPathDoesntExist,
+            metadata_cache_->GetStat("/dir/c", &stat));
+  // Only the names are cached, not the entries.
+  EXPECT_TRUE(metadata_cache_->GetDirEntries("/dir", 0, 2) == NULL);
+
+  // "a" was deleted.
+  metadata_cache_->InvalidateDirEntry("/dir", "a");
+  EXPECT_EQ(MetadataCache::kPathDoesntExist,
+            metadata_cache_->GetStat("/dir/a", &stat));
+
+  // "c" was created.
+  metadata_cache_->InvalidateDirEntries("/dir");
+  EXPECT_EQ(MetadataCache::kStatNotCached,
+            metadata_cache_->GetStat("/dir/c", &stat));
+}
+
+namespace {
+
+/** Looks up random paths of "paths" and updates every tenth one. */
+void StatWorkload(MetadataCache* metadata_cache,
+                  const vector<string>* paths,
+                  int operations,
+                  unsigned int seed) {
+  Stat stat;
+  InitializeStat(&stat);
+  for (int i = 0; i < operations; i++) {
+    seed = seed * 1103515245 + 12345;
+    const string& path = (*paths)[(seed >> 8) % paths->size()];
+    if (i % 10 == 0) {
+      metadata_cache->UpdateStat(path, stat);
+    } else {
+      metadata_cache->GetStat(path, &stat);
+    }
+  }
+}
+
+/** Runs StatWorkload() in "threads" threads and returns the run time in ms. */
+int64_t RunStatWorkload(MetadataCache* metadata_cache,
+                        const vector<string>& paths,
+                        int threads,
+                        int operations_per_thread) {
+  boost::posix_time::ptime start =
+      boost::posix_time::microsec_clock::local_time();
+  boost::thread_group workers;
+  for (int i = 0; i < threads; i++) {
+    workers.create_thread(boost::bind(&StatWorkload,
+                                      metadata_cache,
+                                      &paths,
+                                      operations_per_thread,
+                                      i + 1));
+  }
+  workers.join_all();
+  return (boost::posix_time::microsec_clock::local_time() - start)
+      .total_milliseconds();
+}
+
+}  // anonymous namespace
+
+/** Benchmark of concurrent GetStat() and UpdateStat() calls with a single
+ *  shard and with the default sharding. */
+TEST(MetadataCacheBenchmark, ConcurrentStat) {
+  initialize_logger(LEVEL_WARN);
+  const uint64_t kSize = 16 * 1024;
+  const int kThreads = 16;
+  const int kOperationsPerThread = 50000;
+
+  vector<string> paths;
+  for (uint64_t i = 0; i < kSize; i++) {
+    paths.push_back("/dir" + boost::lexical_cast<string>(i % 64) + "/file"
+                    + boost::lexical_cast<string>(i));
+  }
+
+  MetadataCache single_shard(kSize, 3600, 0, 1);
+  MetadataCache sharded(kSize, 3600, 0);
+  const int64_t single_shard_ms = RunStatWorkload(
+      &single_shard, paths, kThreads, kOperationsPerThread);
+  const int64_t sharded_ms = RunStatWorkload(
+      &sharded, paths, kThreads, kOperationsPerThread);
+
+  cout << kThreads << " threads, " << kThreads * kOperationsPerThread
+       << " operations: 1 shard: " << single_shard_ms << " ms, "
+       << MetadataCache::kMaxShards << " shards: " << sharded_ms << " ms"
+       << endl;
+
+  EXPECT_LE(single_shard.Size(), kSize);
+  EXPECT_LE(sharded.Size(), kSize);
+
+  google::protobuf::ShutdownProtobufLibrary();
+  shutdown_logger();
+}
+
+namespace {
+
+/** Looks up "path" like Volume::GetAttr() and asks "existing_paths" (the MRC)
+ *  if it was not cached. Returns true if the MRC was asked. */
+bool ProbePath(MetadataCache* metadata_cache,
+               const set<string>& existing_paths,
+               const string& path) {
+  Stat stat;
+  if (metadata_cache->GetStat(path, &stat) != MetadataCache::kStatNotCached) {
+    return false;
+  }
+  if (existing_paths.count(path) > 0) {
+    InitializeStat(&stat);
+    metadata_cache->UpdateStat(path, stat);
+  } else {
+    metadata_cache->UpdateNegativeEntry(path);
+  }
+  return true;
+}
+
+}  // anonymous namespace
+
+/** Benchmark of the lookups of a compiler which searches every included
+ *  header along the include path, once without negative entries, once with
+ *  negative entries and once with additionally completely listed include
+ *  directories. */
+TEST(MetadataCacheBenchmark, IncludePathProbeStorm) {
+  initialize_logger(LEVEL_WARN);
+  const int kIncludeDirs = 16;
+  const int kHeaders = 256;
+  const int kCompilations = 100;
+
+  // Header i is located in include directory i % kIncludeDirs.
+  vector<string> include_dirs;
+  vector<DirectoryEntries> include_dir_entries(kIncludeDirs);
+  set<string> existing_paths;
+  for (int dir = 0; dir < kIncludeDirs; dir++) {
+    include_dirs.push_back("/include" + boost::lexical_cast<string>(dir));
+  }
+  for (int header = 0; header < kHeaders; header++) {
+    const string name = "header" + boost::lexical_cast<string>(header) + ".h";
+    const int dir = header % kIncludeDirs;
+    include_dir_entries[dir].add_entries()->set_name(name);
+    existing_paths.insert(include_dirs[dir] + "/" + name);
+  }
+
+  const char* kVariants[] = { "no negative entries",
+                              "negative entries",
+                              "listed directories" };
+  int mrc_requests[3];
+  for (int variant = 0; variant < 3; variant++) {
+    MetadataCache metadata_cache(64 * 1024, 3600, variant == 0 ? 0 : 3600);
+    if (variant == 2) {
+      for (int dir = 0; dir < kIncludeDirs; dir++) {
+        metadata_cache.UpdateDirNames(include_dirs[dir],
+                                      include_dir_entries[dir]);
+      }
+    }
+
+    mrc_requests[variant] = 0;
+    boost::posix_time::ptime start =
+        boost::posix_time::microsec_clock::local_time();
+    for (int compilation = 0; compilation < kCompilations; compilation++) {
+      for (int header = 0; header < kHeaders; header++) {
+        const string name =
+            "/header" + boost::lexical_cast<string>(header) + ".h";
+        for (int dir = 0; dir < kIncludeDirs; dir++) {
+          const string path = include_dirs[dir] + name;
+          if (ProbePath(&metadata_cache, existing_paths, path)) {
+            mrc_requests[variant]++;
+          }
+          if (existing_paths.count(path) > 0) {
+            break;
+          }
+        }
+      }
+    }
+    const int64_t duration_ms =
+        (boost::posix_time::microsec_clock::local_time() - start)
+            .total_milliseconds();
+
+    cout << kCompilations << " compilations with " << kHeaders
+         << " headers in " << kIncludeDirs << " include directories, "
+         << kVariants[variant] << ": " << mrc_requests[variant]
+         << " MRC requests, " << duration_ms << " ms" << endl;
+  }
+
+  // Without negative entries, every probe of a missing header is a request.
+  const int kMissingProbes = kHeaders * (kIncludeDirs - 1) / 2;
+  EXPECT_EQ(kHeaders + kCompilations * kMissingProbes, mrc_requests[0]);
+  // With negative entries, every path is requested once.
+  EXPECT_EQ(kHeaders + kMissingProbes, mrc_requests[1]);
+  // Missing headers are found in the listed directories.
+  EXPECT_EQ(kHeaders, mrc_requests[2]);
+
+  google::protobuf::ShutdownProtobufLibrary();
+  shutdown_logger();
+}
+
 /** Ideas:
  *
  * test TTL expiration.
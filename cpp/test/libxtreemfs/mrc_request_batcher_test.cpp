@@ -0,0 +1,152 @@
+/*
+ * Copyright (c) 2015 by Zuse Institute Berlin
+ *
+ * Licensed under the BSD License, see LICENSE file for details.
+ *
+ */
+
+#include <gtest/gtest.h>
+
+#include <boost/lexical_cast.hpp>
+#include <boost/thread/thread.hpp>
+#include <list>
+#include <string>
+#include <vector>
+
+#include "common/test_environment.h"
+#include "common/test_rpc_server_mrc.h"
+#include "libxtreemfs/client.h"
+#include "libxtreemfs/file_handle.h"
+#include "libxtreemfs/options.h"
+#include "libxtreemfs/volume.h"
+#include "util/error_log.h"
+#include "xtreemfs/MRCServiceConstants.h"
+
+using namespace std;
+using namespace xtreemfs::pbrpc;
+using namespace xtreemfs::util;
+
+namespace xtreemfs {
+namespace rpc {
+
+/** Opens kFiles files with small periodic intervals and counts the XCap
+ *  renewals and file size updates received by the TestRPCServerMRC. */
+class MRCRequestBatcherTest : public ::testing::Test {
+ protected:
+  static const int kFiles = 20;
+
+  virtual void SetUp() {
+    initialize_logger(LEVEL_WARN);
+    test_env.options.connect_timeout_s = 1;
+    test_env.options.request_timeout_s = 1;
+    test_env.options.retry_delay_s = 1;
+    test_env.options.periodic_xcap_renewal_interval_s = 1;
+    test_env.options.periodic_file_size_updates_interval_s = 1;
+  }
+
+  virtual void TearDown() {
+    for (size_t i = 0; i < files.size(); ++i) {
+      files[i]->Close();
+    }
+    test_env.Stop();
+  }
+
+  /** Opens kFiles files and writes to each of them. */
+  void OpenAndWriteFiles() {
+    ASSERT_TRUE(test_env.Start());
+    volume = test_env.client->OpenVolume(test_env.volume_name_,
+                                         NULL,  // No SSL options.
+                                         test_env.options);
+    char buf[] = "data";
+    for (int i = 0; i < kFiles; ++i) {
+      files.push_back(volume->OpenFile(
+          test_env.user_credentials,
+          "/file" + boost::lexical_cast<string>(i),
+          static_cast<xtreemfs::pbrpc::SYSTEM_V_FCNTL>(
+              xtreemfs::pbrpc::SYSTEM_V_FCNTL_H_O_CREAT |
+              xtreemfs::pbrpc::SYSTEM_V_FCNTL_H_O_RDWR)));
+      ASSERT_NO_THROW(files.back()->Write(buf, sizeof(buf), 0));
+    }
+  }
+
+  /** Waits until the MRC received at least "count" requests of "proc_id". */
+  int WaitForRequests(uint32_t proc_id, int count) {
+    for (int i = 0; i < 500; ++i) {
+      if (test_env.mrc->GetRequestCount(proc_id) >= count) {
+        break;
+      }
+      boost::this_thread::sleep(boost::posix_time::milliseconds(10));
+    }
+    return test_env.mrc->GetRequestCount(proc_id);
+  }
+
+  TestEnvironment test_env;
+  Volume* volume;
+  vector<FileHandle*> files;
+};
+
+const int MRCRequestBatcherTest::kFiles;
+
+/** One request per period renews the XCaps and updates the sizes of all files.
+ */
+TEST_F(MRCRequestBatcherTest, OneRequestPerPeriod) {
+  OpenAndWriteFiles();
+
+  EXPECT_GE(WaitForRequests(PROC_ID_XTREEMFS_RENEW_CAPABILITIES, 1), 1);
+  EXPECT_GE(WaitForRequests(PROC_ID_XTREEMFS_UPDATE_FILE_SIZES, 1), 1);
+  EXPECT_EQ(0, test_env.mrc->GetRequestCount(
+      PROC_ID_XTREEMFS_RENEW_CAPABILITY_AND_VOUCHER));
+  EXPECT_EQ(0, test_env.mrc->GetRequestCount(PROC_ID_XTREEMFS_UPDATE_FILE_SIZE));
+}
+
+/** Without batching, every file sends its own requests. */
+TEST_F(MRCRequestBatcherTest, OneRequestPerFileWithoutBatching) {
+  test_env.options.periodic_mrc_batch_size = 0;
+  OpenAndWriteFiles();
+
+  EXPECT_GE(WaitForRequests(PROC_ID_XTREEMFS_RENEW_CAPABILITY_AND_VOUCHER,
+                            kFiles),
+            kFiles);
+  EXPECT_GE(WaitForRequests(PROC_ID_XTREEMFS_UPDATE_FILE_SIZE, kFiles), kFiles);
+  EXPECT_EQ(0, test_env.mrc->GetRequestCount(
+      PROC_ID_XTREEMFS_RENEW_CAPABILITIES));
+  EXPECT_EQ(0, test_env.mrc->GetRequestCount(
+      PROC_ID_XTREEMFS_UPDATE_FILE_SIZES));
+}
+
+/** The error which the MRC returned for an XCap reaches its XCapManager. */
+TEST_F(MRCRequestBatcherTest, ReportsErrorsOfSingleXCaps) {
+  OpenAndWriteFiles();
+  test_env.mrc->SetRenewCapabilitiesError(POSIX_ERROR_ENOSPC);
+  const int renewals =
+      test_env.mrc->GetRequestCount(PROC_ID_XTREEMFS_RENEW_CAPABILITIES);
+  EXPECT_GE(WaitForRequests(PROC_ID_XTREEMFS_RENEW_CAPABILITIES,
+                            renewals + 2),
+            renewals + 2);
+
+  // Every XCapManager logged the error of its XCap.
+  int errors = 0;
+  list<string> messages = ErrorLog::error_log->error_messages();
+  for (list<string>::iterator it = messages.begin(); it != messages.end();
+       ++it) {
+    if (it->find("Renewing XCap failed") != string::npos &&
+        it->find("POSIX_ERROR_ENOSPC") != string::npos &&
+        it->find("XCap not renewed by TestRPCServerMRC") != string::npos) {
+      ++errors;
+    }
+  }
+  EXPECT_GE(errors, kFiles / 2);
+}
+
+/** Batches are split at periodic_mrc_batch_size. */
+TEST_F(MRCRequestBatcherTest, SplitsLargeBatches) {
+  test_env.options.periodic_mrc_batch_size = kFiles / 2;
+  OpenAndWriteFiles();
+
+  EXPECT_GE(WaitForRequests(PROC_ID_XTREEMFS_RENEW_CAPABILITIES, 2), 2);
+  EXPECT_EQ(0, test_env.mrc->GetRequestCount(
+      PROC_ID_XTREEMFS_RENEW_CAPABILITY_AND_VOUCHER));
+}
+
+}  // namespace rpc
+}  // namespace xtreemfs
@@ -0,0 +1,287 @@
+/*
+ * Copyright (c) 2015 by Zuse Institute Berlin
+ *
+ * Licensed under the BSD License, see LICENSE file for details.
+ *
+ */
+
+#include <gtest/gtest.h>
+
+#include <boost/bind.hpp>
+#include <boost/scoped_ptr.hpp>
+#include <boost/thread/condition_variable.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/thread.hpp>
+#include <cstring>
+#include <string>
+
+#include "libxtreemfs/object_cache.h"
+
+using namespace std;
+using namespace xtreemfs;
+
+/** Keeps the content of a file in memory and counts the object accesses. */
+class FakeOSDFile {
+ public:
+  explicit FakeOSDFile(int object_size)
+      : object_size_(object_size), reads_(0), writes_(0) {}
+
+  int Read(int object_no, char* data) {
+    ++reads_;
+    const size_t offset = static_cast<size_t>(object_no) * object_size_;
+    if (offset >= data_.size()) {
+      return 0;
+    }
+    const int bytes = min(static_cast<size_t>(object_size_),
+                          data_.size() - offset);
+    memcpy(data, data_.data() + offset, bytes);
+    return bytes;
+  }
+
+  void Write(int object_no, const char* data, int size) {
+    ++writes_;
+    const size_t offset = static_cast<size_t>(object_no) * object_size_;
+    if (data_.size() < offset + size) {
+      data_.resize(offset + size, '\0');
+    }
+    data_.replace(offset, size, data, size);
+  }
+
+  const int object_size_;
+  string data_;
+  int reads_;
+  int writes_;
+};
+
+class ObjectCacheTest : public ::testing::Test {
+ protected:
+  static const int kObjectSize = 16;
+
+  ObjectCacheTest()
+      : file_(kObjectSize),
+        reader_(boost::bind(&FakeOSDFile::Read, &file_, _1, _2)),
+        writer_(boost::bind(&FakeOSDFile::Write, &file_, _1, _2, _3)) {}
+
+  virtual void SetUp() {
+    cache_.reset(new ObjectCache(2, kObjectSize, NULL));
+  }
+
+  int Read(int object_no, int offset, char* buffer, int count) {
+    return cache_->Read(object_no, offset, buffer, count, reader_, writer_);
+  }
+
+  void Write(int object_no, int offset, const char* buffer, int count) {
+    cache_->Write(object_no, offset, buffer, count, reader_, writer_);
+  }
+
+  FakeOSDFile file_;
+  ObjectReaderFunction reader_;
+  ObjectWriterFunction writer_;
+  boost::scoped_ptr<ObjectCache> cache_;
+};
+
+const int ObjectCacheTest::kObjectSize;
+
+/** Small writes and reads within an object are served from the cache and
+ *  written back once on Flush(). */
+TEST_F(ObjectCacheTest, WritesAreCollectedUntilFlush) {
+  file_.data_ = "0123456789abcdef01234";
+
+  Write(0, 2, "xy", 2);
+  Write(0, 7, "z", 1);
+  Write(1, 5, "END", 3);
+  EXPECT_EQ(0, file_.writes_);
+
+  char buffer[kObjectSize];
+  ASSERT_EQ(10, Read(0, 0, buffer, 10));
+  EXPECT_EQ("01xy456z89", string(buffer, 10));
+  ASSERT_EQ(8, Read(1, 0, buffer, kObjectSize));
+  EXPECT_EQ(string("01234END", 8), string(buffer, 8));
+  EXPECT_EQ(2, file_.reads_);
+
+  cache_->Flush(writer_);
+  EXPECT_EQ(2, file_.writes_);
+  EXPECT_EQ("01xy456z89abcdef01234END", file_.data_);
+
+  // Clean objects are not written again.
+  cache_->Flush(writer_);
+  EXPECT_EQ(2, file_.writes_);
+}
+
+/** A complete object is not fetched before it gets overwritten. */
+TEST_F(ObjectCacheTest, FullObjectWriteDoesNotRead) {
+  const string data(kObjectSize, 'a');
+  Write(0, 0, data.data(), kObjectSize);
+  cache_->Flush(writer_);
+
+  EXPECT_EQ(0, file_.reads_);
+  EXPECT_EQ(data, file_.data_);
+}
+
+/** The least recently used object is written back if the cache is full. */
+TEST_F(ObjectCacheTest, EvictLeastRecentlyUsed) {
+  char buffer[kObjectSize];
+  Write(0, 0, "a", 1);
+  Write(1, 0, "b", 1);
+  ASSERT_EQ(1, Read(0, 0, buffer, 1));
+
+  // Object 1 was not used for the longest time.
+  Write(2, 0, "c", 1);
+  EXPECT_EQ(1, file_.writes_);
+  EXPECT_EQ('b', file_.data_[kObjectSize]);
+
+  // Object 1 has to be fetched again.
+  const int reads = file_.reads_;
+  ASSERT_EQ(1, Read(1, 0, buffer, kObjectSize));
+  EXPECT_EQ('b', buffer[0]);
+  EXPECT_EQ(reads + 1, file_.reads_);
+}
+
+/** Writing behind the last object completes the objects in front of it. */
+TEST_F(ObjectCacheTest, WriteBehindLastObjectFillsGap) {
+  file_.data_ = "abc";
+  char buffer[kObjectSize];
+  ASSERT_EQ(3, Read(0, 0, buffer, kObjectSize));
+
+  Write(1, 4, "x", 1);
+  ASSERT_EQ(kObjectSize, Read(0, 0, buffer, kObjectSize));
+  EXPECT_EQ(string("abc") + string(kObjectSize - 3, '\0'),
+            string(buffer, kObjectSize));
+  EXPECT_EQ(kObjectSize + 5, cache_->GetDirtyFileSize());
+}
+
+/** Truncate drops dirty data behind the new file size. */
+TEST_F(ObjectCacheTest, TruncateDropsObjects) {
+  const string data(kObjectSize, 'a');
+  Write(0, 0, data.data(), kObjectSize);
+  Write(1, 0, data.data(), kObjectSize);
+
+  cache_->Truncate(kObjectSize / 2);
+  EXPECT_EQ(kObjectSize / 2, cache_->GetDirtyFileSize());
+
+  char buffer[kObjectSize];
+  EXPECT_EQ(kObjectSize / 2, Read(0, 0, buffer, kObjectSize));
+  cache_->Flush(writer_);
+  EXPECT_EQ(1, file_.writes_);
+  EXPECT_EQ(string(kObjectSize / 2, 'a'), file_.data_);
+}
+
+/** Caches which share a budget evict their objects if it is exhausted. */
+TEST_F(ObjectCacheTest, SharedBudget) {
+  ObjectCacheBudget budget(2 * kObjectSize);
+  cache_.reset(new ObjectCache(10, kObjectSize, &budget));
+  FakeOSDFile other_file(kObjectSize);
+  ObjectCache other_cache(10, kObjectSize, &budget);
+  ObjectReaderFunction other_reader(
+      boost::bind(&FakeOSDFile::Read, &other_file, _1, _2));
+  ObjectWriterFunction other_writer(
+      boost::bind(&FakeOSDFile::Write, &other_file, _1, _2, _3));
+
+  Write(0, 0, "a", 1);
+  Write(1, 0, "b", 1);
+  EXPECT_EQ(2 * kObjectSize, budget.used_bytes());
+
+  // The budget is exhausted and the other cache has nothing to evict, so the
+  // write is written through and not cached.
+  other_cache.Write(0, 0, "c", 1, other_reader, other_writer);
+  EXPECT_EQ(2 * kObjectSize, budget.used_bytes());
+  EXPECT_EQ(1, other_file.writes_);
+  EXPECT_FALSE(other_cache.Contains(0));
+
+  // The first cache evicts its least recently used object to make room.
+  Write(2, 0, "d", 1);
+  EXPECT_EQ(1, file_.writes_);
+  EXPECT_FALSE(cache_->Contains(0));
+  EXPECT_EQ(2 * kObjectSize, budget.used_bytes());
+
+  cache_.reset(NULL);
+  EXPECT_EQ(0, budget.used_bytes());
+}
+
+/** Inserted objects are served without reading them again. */
+TEST_F(ObjectCacheTest, InsertFetchedObject) {
+  file_.data_ = "abc";
+  cache_->Insert(0, "abc", 3, writer_);
+  EXPECT_TRUE(cache_->Contains(0));
+
+  char buffer[kObjectSize];
+  ASSERT_EQ(3, Read(0, 0, buffer, kObjectSize));
+  EXPECT_EQ("abc", string(buffer, 3));
+  EXPECT_EQ(0, file_.reads_);
+}
+
+/** Blocks the reads of one object until they are released. */
+class BlockingReader {
+ public:
+  BlockingReader(FakeOSDFile* file, int blocked_object)
+      : file_(file),
+        blocked_object_(blocked_object),
+        blocked_(false),
+        released_(false) {}
+
+  int Read(int object_no, char* data) {
+    if (object_no == blocked_object_) {
+      boost::mutex::scoped_lock lock(mutex_);
+      blocked_ = true;
+      changed_.notify_all();
+      while (!released_) {
+        changed_.wait(lock);
+      }
+    }
+    return file_->Read(object_no, data);
+  }
+
+  void WaitUntilBlocked() {
+    boost::mutex::scoped_lock lock(mutex_);
+    while (!blocked_) {
+      changed_.wait(lock);
+    }
+  }
+
+  void Release() {
+    boost::mutex::scoped_lock lock(mutex_);
+    released_ = true;
+    changed_.notify_all();
+  }
+
+ private:
+  FakeOSDFile* file_;
+  const int blocked_object_;
+  boost::mutex mutex_;
+  boost::condition_variable changed_;
+  bool blocked_;
+  bool released_;
+};
+
+/** A slow read of one object does not block the accesses to other objects,
+ *  and concurrent reads of the object load it once. */
+TEST_F(ObjectCacheTest, SlowReadDoesNotBlockOtherObjects) {
+  file_.data_ = string(kObjectSize, 'a') + string(kObjectSize, 'b');
+  BlockingReader blocking_reader(&file_, 0);
+  ObjectReaderFunction reader(
+      boost::bind(&BlockingReader::Read, &blocking_reader, _1, _2));
+
+  char slow_buffers[2][kObjectSize];
+  boost::thread slow_read1(boost::bind(
+      &ObjectCache::Read, cache_.get(), 0, 0, slow_buffers[0], kObjectSize,
+      reader, writer_));
+  blocking_reader.WaitUntilBlocked();
+  boost::thread slow_read2(boost::bind(
+      &ObjectCache::Read, cache_.get(), 0, 0, slow_buffers[1], kObjectSize,
+      reader, writer_));
+
+  char buffer[kObjectSize];
+  ASSERT_EQ(kObjectSize, cache_->Read(1, 0, buffer, kObjectSize, reader,
+                                      writer_));
+  EXPECT_EQ('b', buffer[0]);
+  Write(1, 0, "c", 1);
+  cache_->Flush(writer_);
+  EXPECT_EQ(1, file_.writes_);
+
+  blocking_reader.Release();
+  slow_read1.join();
+  slow_read2.join();
+  EXPECT_EQ('a', slow_buffers[0][0]);
+  EXPECT_EQ('a', slow_buffers[1][0]);
+  EXPECT_EQ(2, file_.reads_);
+}
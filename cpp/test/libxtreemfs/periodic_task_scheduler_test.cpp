@@ -0,0 +1,87 @@
+/*
+ * Copyright (c) 2015 by Zuse Institute Berlin
+ *
+ * Licensed under the BSD License, see LICENSE file for details.
+ *
+ */
+
+#include <gtest/gtest.h>
+
+#include <boost/bind.hpp>
+#include <boost/thread/thread.hpp>
+
+#include "libxtreemfs/periodic_task_scheduler.h"
+#include "util/logging.h"
+
+using namespace std;
+using namespace xtreemfs;
+using namespace xtreemfs::util;
+
+class PeriodicTaskSchedulerTest : public ::testing::Test {
+ protected:
+  virtual void SetUp() {
+    initialize_logger(LEVEL_WARN);
+  }
+
+  virtual void TearDown() {
+    scheduler_.Stop();
+    shutdown_logger();
+  }
+
+ public:
+  void CountRun(int* runs) {
+    boost::mutex::scoped_lock lock(mutex_);
+    ++(*runs);
+  }
+
+  void SlowRun(int* runs) {
+    boost::this_thread::sleep(boost::posix_time::milliseconds(100));
+    CountRun(runs);
+  }
+
+  int GetRuns(int* runs) {
+    boost::mutex::scoped_lock lock(mutex_);
+    return *runs;
+  }
+
+ protected:
+  boost::mutex mutex_;
+  PeriodicTaskScheduler scheduler_;
+};
+
+/** Tasks with different intervals are run by the same thread. */
+TEST_F(PeriodicTaskSchedulerTest, RunsTasksPeriodically) {
+  int fast_runs = 0;
+  int slow_runs = 0;
+  scheduler_.Start();
+  scheduler_.Schedule(
+      boost::bind(&PeriodicTaskSchedulerTest::CountRun, this, &fast_runs),
+      boost::posix_time::milliseconds(10));
+  scheduler_.Schedule(
+      boost::bind(&PeriodicTaskSchedulerTest::CountRun, this, &slow_runs),
+      boost::posix_time::hours(1));
+
+  for (int i = 0; i < 500 && GetRuns(&fast_runs) < 3; ++i) {
+    boost::this_thread::sleep(boost::posix_time::milliseconds(10));
+  }
+  EXPECT_GE(GetRuns(&fast_runs), 3);
+  EXPECT_EQ(0, GetRuns(&slow_runs));
+}
+
+/** Cancel() waits for a running task, which is never run again. */
+TEST_F(PeriodicTaskSchedulerTest, CancelWaitsForRunningTask) {
+  int runs = 0;
+  scheduler_.Start();
+  uint64_t id = scheduler_.Schedule(
+      boost::bind(&PeriodicTaskSchedulerTest::SlowRun, this, &runs),
+      boost::posix_time::milliseconds(1));
+
+  // Cancel while the first run most likely sleeps.
+  boost::this_thread::sleep(boost::posix_time::milliseconds(50));
+  scheduler_.Cancel(id);
+  const int runs_after_cancel = GetRuns(&runs);
+  EXPECT_LE(runs_after_cancel, 1);
+
+  boost::this_thread::sleep(boost::posix_time::milliseconds(150));
+  EXPECT_EQ(runs_after_cancel, GetRuns(&runs));
+}
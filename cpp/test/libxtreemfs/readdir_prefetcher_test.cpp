@@ -0,0 +1,191 @@
+/*
+ * Copyright (c) 2015 by Zuse Institute Berlin
+ *
+ * Licensed under the BSD License, see LICENSE file for details.
+ *
+ */
+
+#include <gtest/gtest.h>
+
+#include <boost/scoped_ptr.hpp>
+#include <boost/thread/thread.hpp>
+#include <cstdio>
+#include <string>
+
+#include "common/test_environment.h"
+#include "common/test_rpc_server_mrc.h"
+#include "libxtreemfs/client.h"
+#include "libxtreemfs/options.h"
+#include "libxtreemfs/volume.h"
+#include "util/logging.h"
+#include "xtreemfs/MRC.pb.h"
+#include "xtreemfs/MRCServiceConstants.h"
+
+using namespace std;
+using namespace xtreemfs::pbrpc;
+using namespace xtreemfs::util;
+
+namespace xtreemfs {
+namespace rpc {
+
+class ReadDirPrefetcherTest : public ::testing::Test {
+ protected:
+  static const int kChunkSize = 100;
+  static const int kEntries = 250;
+
+  virtual void SetUp() {
+    initialize_logger(LEVEL_WARN);
+    test_env.options.connect_timeout_s = 1;
+    test_env.options.request_timeout_s = 1;
+    test_env.options.retry_delay_s = 1;
+    test_env.options.readdir_chunk_size = kChunkSize;
+    test_env.options.readdir_prefetch_depth = GetPrefetchDepth();
+    ASSERT_TRUE(test_env.Start());
+    test_env.mrc->SetDirectoryEntriesCount(kEntries);
+
+    volume = test_env.client->OpenVolume(
+        test_env.volume_name_,
+        NULL,  // No SSL options.
+        test_env.options);
+  }
+
+  virtual void TearDown() {
+    test_env.Stop();
+  }
+
+  virtual int GetPrefetchDepth() {
+    return 2;
+  }
+
+  /** Lists "/" in chunks like the Fuse adapter and checks the names. */
+  void ListInChunks() {
+    for (int offset = 0; offset < kEntries; offset += kChunkSize) {
+      boost::scoped_ptr<DirectoryEntries> entries(volume->ReadDir(
+          test_env.user_credentials, "/", offset, kChunkSize, false));
+      ASSERT_EQ(min(kChunkSize, kEntries - offset), entries->entries_size());
+      for (int i = 0; i < entries->entries_size(); ++i) {
+        char name[9];
+        snprintf(name, sizeof(name), "%08d", offset + i);
+        EXPECT_EQ(string(name), entries->entries(i).name());
+      }
+    }
+  }
+
+  /** Returns the number of readdir requests the MRC received, after waiting
+   *  up to one second until there are "expected" ones. */
+  int WaitForReadDirRequests(int expected) {
+    for (int i = 0; i < 100; ++i) {
+      if (test_env.mrc->GetRequestCount(PROC_ID_READDIR) >= expected) {
+        break;
+      }
+      boost::this_thread::sleep(boost::posix_time::milliseconds(10));
+    }
+    return test_env.mrc->GetRequestCount(PROC_ID_READDIR);
+  }
+
+  TestEnvironment test_env;
+  Volume* volume;
+};
+
+const int ReadDirPrefetcherTest::kChunkSize;
+const int ReadDirPrefetcherTest::kEntries;
+
+class ReadDirPrefetcherDisabledTest : public ReadDirPrefetcherTest {
+ protected:
+  virtual int GetPrefetchDepth() {
+    return 0;
+  }
+};
+
+TEST_F(ReadDirPrefetcherDisabledTest, RequestsChunksWhenRead) {
+  ListInChunks();
+  EXPECT_EQ(3, test_env.mrc->GetRequestCount(PROC_ID_READDIR));
+}
+
+TEST_F(ReadDirPrefetcherTest, ContinuationIsServedFromPrefetchedChunks) {
+  boost::scoped_ptr<DirectoryEntries> entries(volume->ReadDir(
+      test_env.user_credentials, "/", 0, kChunkSize, false));
+  ASSERT_EQ(kChunkSize, entries->entries_size());
+  // The first chunk was complete, so the next two were requested as well.
+  EXPECT_EQ(3, WaitForReadDirRequests(3));
+
+  entries.reset(volume->ReadDir(
+      test_env.user_credentials, "/", kChunkSize, kChunkSize, false));
+  EXPECT_EQ(kChunkSize, entries->entries_size());
+  EXPECT_EQ("00000100", entries->entries(0).name());
+  entries.reset(volume->ReadDir(
+      test_env.user_credentials, "/", 2 * kChunkSize, kChunkSize, false));
+  EXPECT_EQ(kEntries - 2 * kChunkSize, entries->entries_size());
+  EXPECT_EQ("00000200", entries->entries(0).name());
+
+  // After the second chunk, one more chunk was requested which was empty.
+  EXPECT_EQ(4, WaitForReadDirRequests(4));
+}
+
+TEST_F(ReadDirPrefetcherTest, ListingFromStartIsNotServedFromPrefetchedChunks) {
+  ListInChunks();
+  const int requests = test_env.mrc->GetRequestCount(PROC_ID_READDIR);
+
+  test_env.mrc->SetDirectoryEntriesCount(kEntries - 1);
+  boost::scoped_ptr<DirectoryEntries> entries(volume->ReadDir(
+      test_env.user_credentials, "/", 0, kChunkSize, false));
+  EXPECT_EQ(kChunkSize, entries->entries_size());
+  EXPECT_LT(requests, test_env.mrc->GetRequestCount(PROC_ID_READDIR));
+}
+
+TEST_F(ReadDirPrefetcherTest, CompleteListingIsPipelined) {
+  boost::scoped_ptr<DirectoryEntries> entries(volume->ReadDir(
+      test_env.user_credentials, "/", 0, 0, false));
+  ASSERT_EQ(kEntries, entries->entries_size());
+  for (int i = 0; i < kEntries; ++i) {
+    char name[9];
+    snprintf(name, sizeof(name), "%08d", i);
+    EXPECT_EQ(string(name), entries->entries(i).name());
+  }
+}
+
+TEST_F(ReadDirPrefetcherTest, NamesOnlyListingsAreKeptApart) {
+  // Start a complete and a names only listing of the same directory.
+  boost::scoped_ptr<DirectoryEntries> entries(volume->ReadDir(
+      test_env.user_credentials, "/", 0, kChunkSize, false));
+  ASSERT_EQ(kChunkSize, entries->entries_size());
+  EXPECT_TRUE(entries->entries(0).has_stbuf());
+  entries.reset(volume->ReadDir(
+      test_env.user_credentials, "/", 0, kChunkSize, true));
+  ASSERT_EQ(kChunkSize, entries->entries_size());
+  EXPECT_FALSE(entries->entries(0).has_stbuf());
+
+  // Continue both alternately, each must get its own kind of chunks.
+  for (int offset = kChunkSize; offset < kEntries; offset += kChunkSize) {
+    entries.reset(volume->ReadDir(
+        test_env.user_credentials, "/", offset, kChunkSize, false));
+    ASSERT_EQ(min(kChunkSize, kEntries - offset), entries->entries_size());
+    for (int i = 0; i < entries->entries_size(); ++i) {
+      EXPECT_TRUE(entries->entries(i).has_stbuf());
+    }
+    entries.reset(volume->ReadDir(
+        test_env.user_credentials, "/", offset, kChunkSize, true));
+    ASSERT_EQ(min(kChunkSize, kEntries - offset), entries->entries_size());
+    for (int i = 0; i < entries->entries_size(); ++i) {
+      EXPECT_FALSE(entries->entries(i).has_stbuf());
+    }
+  }
+}
+
+TEST_F(ReadDirPrefetcherTest, ListedStatsAreCached) {
+  ListInChunks();
+  const int requests = test_env.mrc->GetRequestCount(PROC_ID_READDIR);
+
+  // The test MRC does not implement getattr, so the stats must be cached.
+  for (int i = 0; i < kEntries; i += 37) {
+    char name[10];
+    snprintf(name, sizeof(name), "/%08d", i);
+    Stat stat;
+    ASSERT_NO_THROW(volume->GetAttr(test_env.user_credentials, name, &stat));
+    EXPECT_EQ(static_cast<uint64_t>(i + 1), stat.ino());
+  }
+  EXPECT_EQ(requests, test_env.mrc->GetRequestCount(PROC_ID_READDIR));
+}
+
+}  // namespace rpc
+}  // namespace xtreemfs
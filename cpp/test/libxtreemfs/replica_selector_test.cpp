@@ -0,0 +1,174 @@
+/*
+ * Copyright (c) 2015 by Zuse Institute Berlin
+ *
+ * Licensed under the BSD License, see LICENSE file for details.
+ *
+ */
+
+#include <gtest/gtest.h>
+
+#include <boost/date_time/posix_time/posix_time.hpp>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "libxtreemfs/replica_selector.h"
+#include "libxtreemfs/uuid_scorer.h"
+#include "xtreemfs/GlobalTypes.pb.h"
+
+using namespace std;
+using namespace xtreemfs;
+using namespace xtreemfs::pbrpc;
+
+/** Reports the UUIDs in "degraded" as degraded. */
+class FakeUUIDScorer : public UUIDScorer {
+ public:
+  virtual bool GetScore(const std::string& uuid, rpc::ServerScore* score) {
+    score->degraded = degraded.count(uuid) > 0;
+    return true;
+  }
+
+  set<string> degraded;
+};
+
+class ReplicaSelectorTest : public ::testing::Test {
+ protected:
+  virtual void SetUp() {
+    xlocs_.set_replica_update_policy("ronly");
+    xlocs_.set_read_only_file_size(0);
+    xlocs_.set_version(1);
+    const char* osds[] = { "osd-a", "osd-b", "osd-c" };
+    for (int i = 0; i < 3; ++i) {
+      Replica* replica = xlocs_.add_replicas();
+      replica->set_replication_flags(0);
+      replica->add_osd_uuids(osds[i]);
+      replica->mutable_striping_policy()->set_type(STRIPING_POLICY_RAID0);
+      replica->mutable_striping_policy()->set_stripe_size(128);
+      replica->mutable_striping_policy()->set_width(1);
+    }
+  }
+
+  /** Returns the replica chosen first by "selector". */
+  string Choose(ReplicaSelector* selector) {
+    vector<string> osd_uuids;
+    selector->OrderReplicas(xlocs_, &osd_uuids);
+    EXPECT_EQ(3u, osd_uuids.size());
+    return osd_uuids[0];
+  }
+
+  XLocSet xlocs_;
+};
+
+TEST_F(ReplicaSelectorTest, IsApplicableToReadOnlyReplicas) {
+  EXPECT_TRUE(ReplicaSelector::IsApplicable(xlocs_));
+
+  XLocSet read_write(xlocs_);
+  read_write.set_replica_update_policy("WqRq");
+  EXPECT_FALSE(ReplicaSelector::IsApplicable(read_write));
+
+  XLocSet single_replica(xlocs_);
+  single_replica.mutable_replicas()->RemoveLast();
+  single_replica.mutable_replicas()->RemoveLast();
+  EXPECT_FALSE(ReplicaSelector::IsApplicable(single_replica));
+}
+
+/** Without balancing, the order of the XLocSet is kept. */
+TEST_F(ReplicaSelectorTest, KeepsOrderWithoutBalancing) {
+  ReplicaSelector selector(false, 95, NULL);
+  selector.RecordLatency("osd-a", boost::posix_time::milliseconds(100));
+  selector.RecordLatency("osd-b", boost::posix_time::milliseconds(1));
+
+  vector<string> osd_uuids;
+  selector.OrderReplicas(xlocs_, &osd_uuids);
+  ASSERT_EQ(3u, osd_uuids.size());
+  EXPECT_EQ("osd-a", osd_uuids[0]);
+  EXPECT_EQ("osd-b", osd_uuids[1]);
+  EXPECT_EQ("osd-c", osd_uuids[2]);
+}
+
+/** Similarly fast replicas share the reads, slow ones are left out. */
+TEST_F(ReplicaSelectorTest, BalancesAmongFastReplicas) {
+  ReplicaSelector selector(true, 0, NULL);
+  selector.RecordLatency("osd-a", boost::posix_time::milliseconds(10));
+  selector.RecordLatency("osd-b", boost::posix_time::milliseconds(12));
+  selector.RecordLatency("osd-c", boost::posix_time::milliseconds(100));
+
+  int chosen_a = 0;
+  int chosen_b = 0;
+  for (int i = 0; i < 10; ++i) {
+    const string osd_uuid = Choose(&selector);
+    EXPECT_NE("osd-c", osd_uuid);
+    chosen_a += osd_uuid == "osd-a";
+    chosen_b += osd_uuid == "osd-b";
+  }
+  EXPECT_EQ(5, chosen_a);
+  EXPECT_EQ(5, chosen_b);
+
+  // The slow replica is the last fallback.
+  vector<string> osd_uuids;
+  selector.OrderReplicas(xlocs_, &osd_uuids);
+  EXPECT_EQ("osd-c", osd_uuids[2]);
+}
+
+/** A failed replica is not chosen while others are available. */
+TEST_F(ReplicaSelectorTest, DemotesFailedReplica) {
+  ReplicaSelector selector(true, 0, NULL);
+  selector.RecordLatency("osd-a", boost::posix_time::milliseconds(10));
+  selector.RecordLatency("osd-b", boost::posix_time::milliseconds(10));
+  selector.RecordLatency("osd-c", boost::posix_time::milliseconds(10));
+  selector.RecordFailure("osd-b");
+
+  for (int i = 0; i < 10; ++i) {
+    EXPECT_NE("osd-b", Choose(&selector));
+  }
+}
+
+/** Degraded OSDs are tried last, with and without balancing. */
+TEST_F(ReplicaSelectorTest, DegradedReplicasAreTriedLast) {
+  FakeUUIDScorer scorer;
+  scorer.degraded.insert("osd-a");
+
+  ReplicaSelector without_balancing(false, 95, &scorer);
+  vector<string> osd_uuids;
+  without_balancing.OrderReplicas(xlocs_, &osd_uuids);
+  ASSERT_EQ(3u, osd_uuids.size());
+  EXPECT_EQ("osd-b", osd_uuids[0]);
+  EXPECT_EQ("osd-c", osd_uuids[1]);
+  EXPECT_EQ("osd-a", osd_uuids[2]);
+
+  // The degraded OSD was the fastest so far.
+  ReplicaSelector selector(true, 0, &scorer);
+  selector.RecordLatency("osd-a", boost::posix_time::milliseconds(1));
+  selector.RecordLatency("osd-b", boost::posix_time::milliseconds(10));
+  selector.RecordLatency("osd-c", boost::posix_time::milliseconds(12));
+  for (int i = 0; i < 10; ++i) {
+    selector.OrderReplicas(xlocs_, &osd_uuids);
+    EXPECT_NE("osd-a", osd_uuids[0]);
+    EXPECT_EQ("osd-a", osd_uuids[2]);
+  }
+
+  // If all OSDs are degraded, none is avoided.
+  scorer.degraded.insert("osd-b");
+  scorer.degraded.insert("osd-c");
+  without_balancing.OrderReplicas(xlocs_, &osd_uuids);
+  EXPECT_EQ("osd-a", osd_uuids[0]);
+}
+
+/** Reads are hedged after the configured percentile of recent latencies. */
+TEST_F(ReplicaSelectorTest, HedgeDelayIsPercentileOfRecentLatencies) {
+  ReplicaSelector selector(false, 90, NULL);
+  boost::posix_time::time_duration delay;
+  EXPECT_FALSE(selector.GetHedgeDelay(&delay));
+
+  for (int i = 1; i <= 100; ++i) {
+    selector.RecordLatency("osd-a", boost::posix_time::milliseconds(i));
+  }
+  ASSERT_TRUE(selector.GetHedgeDelay(&delay));
+  EXPECT_EQ(90, delay.total_milliseconds());
+
+  ReplicaSelector no_hedging(true, 0, NULL);
+  for (int i = 1; i <= 100; ++i) {
+    no_hedging.RecordLatency("osd-a", boost::posix_time::milliseconds(i));
+  }
+  EXPECT_FALSE(no_hedging.GetHedgeDelay(&delay));
+}
@@ -0,0 +1,248 @@
+/*
+ * Copyright (c) 2015 by Zuse Institute Berlin
+ *
+ * Licensed under the BSD License, see LICENSE file for details.
+ *
+ */
+
+#include <gtest/gtest.h>
+
+#include <boost/date_time/posix_time/posix_time.hpp>
+#include <iostream>
+#include <list>
+#include <vector>
+
+#include "libxtreemfs/stripe_translator.h"
+#include "xtreemfs/GlobalTypes.pb.h"
+
+using namespace std;
+using namespace xtreemfs::pbrpc;
+
+namespace xtreemfs {
+
+namespace {
+
+/** The translation of StripeTranslatorRaid0 before it became allocation
+ *  free: the policies are passed as list by value and every operation owns a
+ *  vector of OSD offsets. */
+struct LegacyReadOperation {
+  LegacyReadOperation(size_t _obj_number, std::vector<size_t> _osd_offsets,
+                      size_t _req_size, size_t _req_offset,
+                      char *_data)
+      : obj_number(_obj_number), osd_offsets(_osd_offsets),
+        req_size(_req_size), req_offset(_req_offset),
+        data(_data) {
+  };
+
+  size_t obj_number;
+  std::vector<size_t> osd_offsets;
+  size_t req_size;
+  size_t req_offset;
+  char *data;
+};
+
+typedef std::list<const StripingPolicy*> LegacyPolicyContainer;
+
+void LegacyTranslateReadRequest(
+    char *buf,
+    size_t size,
+    int64_t offset,
+    LegacyPolicyContainer policies,
+    std::vector<LegacyReadOperation>* operations) {
+  unsigned int stripe_size = (*policies.begin())->stripe_size() * 1024;
+
+  size_t start = 0;
+  while (start < size) {
+    size_t obj_number = static_cast<size_t>(start + offset) / stripe_size;
+    size_t req_offset = (start + offset) % stripe_size;
+    size_t req_size
+      = min(size - start, static_cast<size_t>(stripe_size - req_offset));
+
+    std::vector<size_t> osd_offsets;
+    for (LegacyPolicyContainer::iterator i = policies.begin();
+         i != policies.end();
+         ++i) {
+      osd_offsets.push_back(obj_number % (*i)->width());
+    }
+
+    operations->push_back(LegacyReadOperation(
+        obj_number, osd_offsets, req_size, req_offset, buf + start));
+
+    start += req_size;
+  }
+}
+
+}  // anonymous namespace
+
+class StripeTranslatorTest : public ::testing::Test {
+ protected:
+  /** Adds "count" replicas striped over "width" OSDs with 128 kB stripes. */
+  void AddReplicas(int count, int width) {
+    for (int i = 0; i < count; ++i) {
+      StripingPolicy* policy = new StripingPolicy();
+      policy->set_type(STRIPING_POLICY_RAID0);
+      policy->set_stripe_size(128);
+      policy->set_width(width + i);
+      policy_storage_.push_back(policy);
+      policies_.push_back(policy);
+      legacy_policies_.push_back(policy);
+    }
+  }
+
+  virtual void TearDown() {
+    for (size_t i = 0; i < policy_storage_.size(); ++i) {
+      delete policy_storage_[i];
+    }
+  }
+
+  /** Expects the same operations as the legacy implementation. */
+  void ExpectLegacyOperations(char* buf, size_t size, int64_t offset) {
+    std::vector<ReadOperation> operations;
+    translator_.TranslateReadRequest(buf, size, offset, policies_,
+                                     &operations);
+    std::vector<LegacyReadOperation> expected;
+    LegacyTranslateReadRequest(buf, size, offset, legacy_policies_,
+                               &expected);
+
+    ASSERT_EQ(expected.size(), operations.size());
+    for (size_t i = 0; i < expected.size(); ++i) {
+      EXPECT_EQ(expected[i].obj_number, operations[i].obj_number);
+      EXPECT_EQ(expected[i].req_size, operations[i].req_size);
+      EXPECT_EQ(expected[i].req_offset, operations[i].req_offset);
+      EXPECT_EQ(expected[i].data, operations[i].data);
+      ASSERT_EQ(expected[i].osd_offsets.size(),
+                operations[i].osd_offsets.size());
+      for (size_t j = 0; j < expected[i].osd_offsets.size(); ++j) {
+        EXPECT_EQ(expected[i].osd_offsets[j], operations[i].osd_offsets[j]);
+      }
+    }
+  }
+
+  StripeTranslatorRaid0 translator_;
+  std::vector<StripingPolicy*> policy_storage_;
+  StripeTranslator::PolicyContainer policies_;
+  LegacyPolicyContainer legacy_policies_;
+};
+
+TEST_F(StripeTranslatorTest, SplitsRequestAtObjectBoundaries) {
+  AddReplicas(1, 4);
+  char buffer[3 * 128 * 1024];
+  std::vector<ReadOperation> operations;
+  translator_.TranslateReadRequest(buffer, 2 * 128 * 1024, 100 * 1024,
+                                   policies_, &operations);
+
+  ASSERT_EQ(3, operations.size());
+  EXPECT_EQ(0, operations[0].obj_number);
+  EXPECT_EQ(100 * 1024, operations[0].req_offset);
+  EXPECT_EQ(28 * 1024, operations[0].req_size);
+  EXPECT_EQ(buffer, operations[0].data);
+  EXPECT_EQ(1, operations[1].obj_number);
+  EXPECT_EQ(0, operations[1].req_offset);
+  EXPECT_EQ(128 * 1024, operations[1].req_size);
+  EXPECT_EQ(buffer + 28 * 1024, operations[1].data);
+  EXPECT_EQ(2, operations[2].obj_number);
+  EXPECT_EQ(0, operations[2].req_offset);
+  EXPECT_EQ(100 * 1024, operations[2].req_size);
+
+  // Empty requests access no object.
+  operations.clear();
+  translator_.TranslateReadRequest(buffer, 0, 0, policies_, &operations);
+  EXPECT_TRUE(operations.empty());
+}
+
+TEST_F(StripeTranslatorTest, MatchesLegacyImplementation) {
+  // More replicas than OSDOffsets stores inline.
+  AddReplicas(OSDOffsets::kInlineCapacity + 2, 3);
+  char buffer[10 * 128 * 1024];
+  const size_t sizes[] = { 1, 4096, 128 * 1024, 128 * 1024 + 1,
+                           sizeof(buffer) };
+  const int64_t offsets[] = { 0, 1, 128 * 1024 - 1, 128 * 1024,
+                              1000 * 128 * 1024 + 77 };
+  for (size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); ++i) {
+    for (size_t j = 0; j < sizeof(offsets) / sizeof(offsets[0]); ++j) {
+      ExpectLegacyOperations(buffer, sizes[i], offsets[j]);
+    }
+  }
+}
+
+TEST_F(StripeTranslatorTest, VectoredRequestsAppendOperations) {
+  AddReplicas(2, 4);
+  char buffer1[200 * 1024];
+  char buffer2[100 * 1024];
+  struct iovec iov[2];
+  iov[0].iov_base = buffer1;
+  iov[0].iov_len = sizeof(buffer1);
+  iov[1].iov_base = buffer2;
+  iov[1].iov_len = sizeof(buffer2);
+
+  std::vector<WriteOperation> operations;
+  translator_.TranslateWriteRequestV(iov, 2, 0, policies_, &operations);
+
+  // buffer1 covers object 0 and a part of object 1, buffer2 the rest of
+  // object 1 and a part of object 2.
+  ASSERT_EQ(4, operations.size());
+  EXPECT_EQ(1, operations[1].obj_number);
+  EXPECT_EQ(72 * 1024, operations[1].req_size);
+  EXPECT_EQ(1, operations[2].obj_number);
+  EXPECT_EQ(72 * 1024, operations[2].req_offset);
+  EXPECT_EQ(56 * 1024, operations[2].req_size);
+  EXPECT_EQ(buffer2, operations[2].data);
+  EXPECT_EQ(2, operations[3].obj_number);
+  ASSERT_EQ(2, operations[3].osd_offsets.size());
+  EXPECT_EQ(2, operations[3].osd_offsets[0]);
+  EXPECT_EQ(2, operations[3].osd_offsets[1]);
+}
+
+class StripeTranslatorBenchmark : public StripeTranslatorTest {};
+
+/** Compares the time to translate large reads of a file with three replicas
+ *  with the legacy implementation. */
+TEST_F(StripeTranslatorBenchmark, TranslateReadRequest) {
+  AddReplicas(3, 8);
+  const size_t kRequestSize = 1024 * 1024 * 1024;  // 8192 objects
+  const int kRequests = 50;
+
+  std::vector<LegacyReadOperation> legacy_operations;
+  boost::posix_time::ptime start =
+      boost::posix_time::microsec_clock::local_time();
+  for (int i = 0; i < kRequests; ++i) {
+    legacy_operations.clear();
+    LegacyTranslateReadRequest(NULL, kRequestSize, i * kRequestSize,
+                               legacy_policies_, &legacy_operations);
+  }
+  const double legacy_ms =
+      (boost::posix_time::microsec_clock::local_time() - start)
+          .total_microseconds() / 1000.0;
+
+  std::vector<ReadOperation> operations;
+  start = boost::posix_time::microsec_clock::local_time();
+  for (int i = 0; i < kRequests; ++i) {
+    operations.clear();
+    translator_.TranslateReadRequest(NULL, kRequestSize, i * kRequestSize,
+                                     policies_, &operations);
+  }
+  const double reused_ms =
+      (boost::posix_time::microsec_clock::local_time() - start)
+          .total_microseconds() / 1000.0;
+
+  start = boost::posix_time::microsec_clock::local_time();
+  for (int i = 0; i < kRequests; ++i) {
+    std::vector<ReadOperation> fresh_operations;
+    translator_.TranslateReadRequest(NULL, kRequestSize, i * kRequestSize,
+                                     policies_, &fresh_operations);
+  }
+  const double fresh_ms =
+      (boost::posix_time::microsec_clock::local_time() - start)
+          .total_microseconds() / 1000.0;
+
+  ASSERT_EQ(legacy_operations.size(), operations.size());
+  const size_t objects = kRequests * operations.size();
+  cout << kRequests << " reads of " << operations.size() << " objects: "
+       << legacy_ms * 1e6 / objects << " ns per object before, "
+       << reused_ms * 1e6 / objects << " ns with a reused vector, "
+       << fresh_ms * 1e6 / objects << " ns with a new vector per read"
+       << endl;
+  EXPECT_LT(reused_ms, legacy_ms);
+}
+
+}  // namespace xtreemfs
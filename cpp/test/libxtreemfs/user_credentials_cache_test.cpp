@@ -0,0 +1,201 @@
+/*
+ * Copyright (c) 2015 by Zuse Institute Berlin
+ *
+ * Licensed under the BSD License, see LICENSE file for details.
+ *
+ */
+
+#ifndef WIN32
+
+#include <gtest/gtest.h>
+
+#include <boost/date_time/posix_time/posix_time.hpp>
+#include <boost/thread/thread.hpp>
+#include <iostream>
+#include <list>
+#include <string>
+#include <sys/types.h>
+#include <unistd.h>
+
+#include "libxtreemfs/system_user_mapping_unix.h"
+#include "libxtreemfs/user_credentials_cache.h"
+#include "pbrpc/RPC.pb.h"
+#include "util/logging.h"
+
+using namespace std;
+using namespace xtreemfs;
+using namespace xtreemfs::pbrpc;
+using namespace xtreemfs::util;
+
+namespace {
+
+UserCredentials MakeUserCredentials(const string& username,
+                                    const string& group) {
+  UserCredentials user_credentials;
+  user_credentials.set_username(username);
+  user_credentials.add_groups(group);
+  return user_credentials;
+}
+
+/** Generates the credentials of a process like
+ *  FuseAdapter::GenerateUserCredentials() without cache. */
+void GenerateUserCredentials(SystemUserMappingUnix* system_user_mapping,
+                             uid_t uid,
+                             gid_t gid,
+                             pid_t pid,
+                             UserCredentials* user_credentials) {
+  user_credentials->set_username(system_user_mapping->UIDToUsername(uid));
+  list<string> groupnames;
+  system_user_mapping->GetGroupnames(uid, gid, pid, &groupnames);
+  for (list<string>::iterator it = groupnames.begin();
+       it != groupnames.end(); ++it) {
+    user_credentials->add_groups(*it);
+  }
+}
+
+}  // anonymous namespace
+
+TEST(UserCredentialsCacheTest, CachesPerProcess) {
+  UserCredentialsCache cache(10, 3600);
+  const pid_t pid = getpid();
+  const uint64_t start_time = UserCredentialsCache::GetProcessStartTime(pid);
+  cache.Put(1000, 100, pid, start_time, MakeUserCredentials("alice", "users"));
+
+  UserCredentials user_credentials;
+  ASSERT_TRUE(cache.Get(1000, 100, pid, start_time, &user_credentials));
+  EXPECT_EQ("alice", user_credentials.username());
+  ASSERT_EQ(1, user_credentials.groups_size());
+  EXPECT_EQ("users", user_credentials.groups(0));
+
+  // Other users, groups and processes are not cached.
+  EXPECT_FALSE(cache.Get(1001, 100, pid, start_time, &user_credentials));
+  EXPECT_FALSE(cache.Get(1000, 101, pid, start_time, &user_credentials));
+  EXPECT_FALSE(cache.Get(1000, 100, getppid(),
+                         UserCredentialsCache::GetProcessStartTime(getppid()),
+                         &user_credentials));
+}
+
+TEST(UserCredentialsCacheTest, ReusedPidIsNotCached) {
+  UserCredentialsCache cache(10, 3600);
+  const pid_t pid = getpid();
+  const uint64_t start_time = UserCredentialsCache::GetProcessStartTime(pid);
+  cache.Put(1000, 100, pid, start_time, MakeUserCredentials("alice", "users"));
+
+  UserCredentials user_credentials;
+  EXPECT_FALSE(cache.Get(1000, 100, pid, start_time + 1, &user_credentials));
+}
+
+TEST(UserCredentialsCacheTest, PutReplacesEntry) {
+  UserCredentialsCache cache(10, 3600);
+  const pid_t pid = getpid();
+  const uint64_t start_time = UserCredentialsCache::GetProcessStartTime(pid);
+  cache.Put(1000, 100, pid, start_time, MakeUserCredentials("alice", "users"));
+  cache.Put(1000, 100, pid, start_time, MakeUserCredentials("alice", "staff"));
+
+  UserCredentials user_credentials;
+  ASSERT_TRUE(cache.Get(1000, 100, pid, start_time, &user_credentials));
+  ASSERT_EQ(1, user_credentials.groups_size());
+  EXPECT_EQ("staff", user_credentials.groups(0));
+  EXPECT_EQ(1, cache.Size());
+}
+
+TEST(UserCredentialsCacheTest, EntriesExpire) {
+  UserCredentialsCache cache(10, 1);
+  const pid_t pid = getpid();
+  const uint64_t start_time = UserCredentialsCache::GetProcessStartTime(pid);
+  cache.Put(1000, 100, pid, start_time, MakeUserCredentials("alice", "users"));
+
+  UserCredentials user_credentials;
+  EXPECT_TRUE(cache.Get(1000, 100, pid, start_time, &user_credentials));
+  boost::this_thread::sleep(boost::posix_time::seconds(2));
+  EXPECT_FALSE(cache.Get(1000, 100, pid, start_time, &user_credentials));
+}
+
+TEST(UserCredentialsCacheTest, OldestEntryIsEvicted) {
+  const int kMaxEntries = 3;
+  UserCredentialsCache cache(kMaxEntries, 3600);
+  const pid_t pid = getpid();
+  const uint64_t start_time = UserCredentialsCache::GetProcessStartTime(pid);
+  for (int uid = 0; uid <= kMaxEntries; uid++) {
+    cache.Put(uid, 100, pid, start_time, MakeUserCredentials("user", "users"));
+  }
+  EXPECT_EQ(kMaxEntries, cache.Size());
+
+  UserCredentials user_credentials;
+  EXPECT_FALSE(cache.Get(0, 100, pid, start_time, &user_credentials));
+  for (int uid = 1; uid <= kMaxEntries; uid++) {
+    EXPECT_TRUE(cache.Get(uid, 100, pid, start_time, &user_credentials));
+  }
+}
+
+TEST(UserCredentialsCacheTest, CanBeDisabled) {
+  UserCredentialsCache cache(0, 3600);
+  const pid_t pid = getpid();
+  const uint64_t start_time = UserCredentialsCache::GetProcessStartTime(pid);
+  cache.Put(1000, 100, pid, start_time, MakeUserCredentials("alice", "users"));
+
+  UserCredentials user_credentials;
+  EXPECT_FALSE(cache.Get(1000, 100, pid, start_time, &user_credentials));
+  EXPECT_EQ(0, cache.Size());
+}
+
+#ifdef __linux__
+TEST(UserCredentialsCacheTest, ProcessStartTime) {
+  // The test process was not started at boot.
+  EXPECT_LT(0, UserCredentialsCache::GetProcessStartTime(getpid()));
+  EXPECT_LE(UserCredentialsCache::GetProcessStartTime(getppid()),
+            UserCredentialsCache::GetProcessStartTime(getpid()));
+  // There is no process with the highest pid.
+  EXPECT_EQ(0, UserCredentialsCache::GetProcessStartTime(0x7fffffff));
+}
+#endif  // __linux__
+
+/** Compares the CPU time per Fuse operation spent on generating the
+ *  credentials of the calling process with and without cache. */
+TEST(UserCredentialsCacheBenchmark, GenerateUserCredentials) {
+  initialize_logger(LEVEL_WARN);
+  const int kOperations = 20000;
+  SystemUserMappingUnix system_user_mapping;
+  UserCredentialsCache cache(1024, 3600);
+  const uid_t uid = getuid();
+  const gid_t gid = getgid();
+  const pid_t pid = getpid();
+
+  UserCredentials expected;
+  GenerateUserCredentials(&system_user_mapping, uid, gid, pid, &expected);
+
+  double ns_per_operation[2];
+  for (int variant = 0; variant < 2; variant++) {
+    boost::posix_time::ptime start =
+        boost::posix_time::microsec_clock::local_time();
+    for (int i = 0; i < kOperations; i++) {
+      UserCredentials user_credentials;
+      if (variant == 0) {
+        GenerateUserCredentials(&system_user_mapping, uid, gid, pid,
+                                &user_credentials);
+      } else {
+        const uint64_t start_time =
+            UserCredentialsCache::GetProcessStartTime(pid);
+        if (!cache.Get(uid, gid, pid, start_time, &user_credentials)) {
+          GenerateUserCredentials(&system_user_mapping, uid, gid, pid,
+                                  &user_credentials);
+          cache.Put(uid, gid, pid, start_time, user_credentials);
+        }
+      }
+      ASSERT_EQ(expected.username(), user_credentials.username());
+      ASSERT_EQ(expected.groups_size(), user_credentials.groups_size());
+    }
+    ns_per_operation[variant] =
+        (boost::posix_time::microsec_clock::local_time() - start)
+            .total_nanoseconds() / static_cast<double>(kOperations);
+  }
+
+  cout << kOperations << " credential resolutions of a process with "
+       << expected.groups_size() << " groups: " << ns_per_operation[0]
+       << " ns per operation without cache, " << ns_per_operation[1]
+       << " ns with cache" << endl;
+  EXPECT_LT(ns_per_operation[1], ns_per_operation[0]);
+  shutdown_logger();
+}
+
+#endif  // !WIN32
@@ -0,0 +1,100 @@
+/*
+ * Copyright (c) 2015 by Zuse Institute Berlin
+ *
+ * Licensed under the BSD License, see LICENSE file for details.
+ *
+ */
+
+#include <gtest/gtest.h>
+
+#include <boost/bind.hpp>
+#include <boost/thread/thread.hpp>
+#include <string>
+
+#include "libxtreemfs/uuid_cache.h"
+#include "util/logging.h"
+
+using namespace std;
+using namespace xtreemfs;
+using namespace xtreemfs::util;
+
+class UUIDCacheTest : public ::testing::Test {
+ protected:
+  virtual void SetUp() {
+    initialize_logger(LEVEL_WARN);
+  }
+
+  virtual void TearDown() {
+    shutdown_logger();
+  }
+
+ public:
+  void WaitingLookup(UUIDCache::LookupResult* result, string* address) {
+    *result = cache_.Lookup("uuid", true, address);
+  }
+
+ protected:
+  UUIDCache cache_;
+};
+
+/** Only the first caller resolves a missing UUID, the others wait for it. */
+TEST_F(UUIDCacheTest, SingleFlightResolution) {
+  string address;
+  EXPECT_EQ(UUIDCache::kResolve, cache_.Lookup("uuid", true, &address));
+  EXPECT_EQ(UUIDCache::kPending, cache_.Lookup("uuid", false, &address));
+
+  UUIDCache::LookupResult result = UUIDCache::kPending;
+  string waiting_address;
+  boost::thread waiting_thread(boost::bind(&UUIDCacheTest::WaitingLookup,
+                                           this,
+                                           &result,
+                                           &waiting_address));
+  EXPECT_FALSE(waiting_thread.timed_join(boost::posix_time::milliseconds(50)));
+
+  cache_.update("uuid", "localhost", 32640, 3600);
+  waiting_thread.join();
+  EXPECT_EQ(UUIDCache::kHit, result);
+  EXPECT_EQ("localhost:32640", waiting_address);
+}
+
+/** A failed resolution lets the next waiting caller resolve the UUID. */
+TEST_F(UUIDCacheTest, AbortedResolutionWakesWaitingCaller) {
+  string address;
+  EXPECT_EQ(UUIDCache::kResolve, cache_.Lookup("uuid", true, &address));
+
+  UUIDCache::LookupResult result = UUIDCache::kPending;
+  boost::thread waiting_thread(boost::bind(&UUIDCacheTest::WaitingLookup,
+                                           this,
+                                           &result,
+                                           &address));
+  cache_.AbortResolution("uuid");
+  waiting_thread.join();
+  EXPECT_EQ(UUIDCache::kResolve, result);
+}
+
+/** One caller is asked to refresh an entry before it expires, all callers
+ *  still get the cached address. */
+TEST_F(UUIDCacheTest, RefreshBeforeExpiry) {
+  // With a TTL of one second, the refresh is due immediately.
+  cache_.update("uuid", "localhost", 32640, 1);
+
+  string address;
+  EXPECT_EQ(UUIDCache::kRefresh, cache_.Lookup("uuid", true, &address));
+  EXPECT_EQ("localhost:32640", address);
+  EXPECT_EQ(UUIDCache::kHit, cache_.Lookup("uuid", true, &address));
+
+  cache_.update("uuid", "otherhost", 32640, 3600);
+  EXPECT_EQ(UUIDCache::kHit, cache_.Lookup("uuid", true, &address));
+  EXPECT_EQ("otherhost:32640", address);
+}
+
+/** A failed refresh is not retried by the next caller, but after a delay. */
+TEST_F(UUIDCacheTest, FailedRefreshBacksOff) {
+  cache_.update("uuid", "localhost", 32640, 1);
+
+  string address;
+  EXPECT_EQ(UUIDCache::kRefresh, cache_.Lookup("uuid", true, &address));
+  cache_.AbortResolution("uuid");
+  // The entry may have expired meanwhile, but is not refreshed again.
+  EXPECT_NE(UUIDCache::kRefresh, cache_.Lookup("uuid", true, &address));
+}
@@ -11,6 +11,7 @@
 #include <boost/make_shared.hpp>
 #include <boost/scoped_ptr.hpp>
 #include <boost/shared_ptr.hpp>
+#include <set>
 #include <sstream>
 #include <string>
 #include <vector>
@@ -20,6 +21,7 @@
 #include "libxtreemfs/uuid_item.h"
 #include "libxtreemfs/container_uuid_iterator.h"
 #include "libxtreemfs/simple_uuid_iterator.h"
+#include "libxtreemfs/uuid_scorer.h"
 #include "libxtreemfs/xtreemfs_exception.h"
 #include "util/logging.h"
 #include "xtreemfs/GlobalTypes.pb.h"
@@ -197,6 +199,49 @@ TYPED_TEST(UUIDIteratorTest, SetCurrentUUID) {
   EXPECT_EQ(uuid1, current_uuid);
 }
 
+/** Reports the UUIDs in "degraded" as degraded. */
+class FakeUUIDScorer : public UUIDScorer {
+ public:
+  virtual bool GetScore(const std::string& uuid, rpc::ServerScore* score) {
+    score->degraded = degraded.count(uuid) > 0;
+    return true;
+  }
+
+  set<string> degraded;
+};
+
+TYPED_TEST(UUIDIteratorTest, SkipsDegradedUUID) {
+  string uuid1 = "uuid1";
+  string uuid2 = "uuid2";
+  string uuid3 = "uuid3";
+  string current_uuid;
+  FakeUUIDScorer scorer;
+
+  this->adder_(this->uuid_iterator_.get(), uuid1);
+  this->adder_(this->uuid_iterator_.get(), uuid2);
+  this->adder_(this->uuid_iterator_.get(), uuid3);
+  this->uuid_iterator_->set_scorer(&scorer);
+
+  this->uuid_iterator_->GetUUID(&current_uuid);
+  EXPECT_EQ(uuid1, current_uuid);
+
+  // The next not degraded UUID becomes the current one.
+  scorer.degraded.insert(uuid1);
+  scorer.degraded.insert(uuid2);
+  this->uuid_iterator_->GetUUID(&current_uuid);
+  EXPECT_EQ(uuid3, current_uuid);
+
+  // Degraded UUIDs are still used if there is no alternative.
+  scorer.degraded.insert(uuid3);
+  this->uuid_iterator_->GetUUID(&current_uuid);
+  EXPECT_EQ(uuid3, current_uuid);
+
+  // A recovered UUID is used again once the current one is degraded.
+  scorer.degraded.erase(uuid1);
+  this->uuid_iterator_->GetUUID(&current_uuid);
+  EXPECT_EQ(uuid1, current_uuid);
+}
+
 TYPED_TEST(UUIDIteratorTest, DebugString) {
   string uuid1 = "uuid1";
   string uuid2 = "uuid2";
@@ -0,0 +1,67 @@
+/*
+ * Copyright (c) 2015 by Zuse Institute Berlin
+ *
+ * Licensed under the BSD License, see LICENSE file for details.
+ *
+ */
+
+#include <gtest/gtest.h>
+
+#include "rpc/buffer_pool.h"
+
+namespace xtreemfs {
+namespace rpc {
+
+class BufferPoolTest : public ::testing::Test {
+ protected:
+  BufferPoolTest() : pool_(256, 4096, 2) {}
+
+  BufferPool pool_;
+};
+
+/** Released buffers are handed out again for all sizes of their class. */
+TEST_F(BufferPoolTest, ReuseBuffersOfSizeClass) {
+  char* buffer = pool_.Acquire(100);
+  // The buffer has the size of its class.
+  buffer[255] = 'x';
+  pool_.Release(buffer, 100);
+  EXPECT_EQ(1u, pool_.free_buffers());
+
+  EXPECT_EQ(buffer, pool_.Acquire(256));
+  EXPECT_EQ(0u, pool_.free_buffers());
+  pool_.Release(buffer, 256);
+
+  // The next size class does not get the buffer.
+  char* larger_buffer = pool_.Acquire(257);
+  EXPECT_NE(buffer, larger_buffer);
+  larger_buffer[511] = 'x';
+  pool_.Release(larger_buffer, 257);
+  EXPECT_EQ(2u, pool_.free_buffers());
+}
+
+/** Only up to max_free_buffers are kept per size class. */
+TEST_F(BufferPoolTest, LimitFreeBuffers) {
+  char* buffers[3];
+  for (int i = 0; i < 3; ++i) {
+    buffers[i] = pool_.Acquire(1000);
+  }
+  for (int i = 0; i < 3; ++i) {
+    pool_.Release(buffers[i], 1000);
+  }
+  EXPECT_EQ(2u, pool_.free_buffers());
+}
+
+/** Buffers larger than the largest size class are not pooled. */
+TEST_F(BufferPoolTest, LargeBuffersAreNotPooled) {
+  char* buffer = pool_.Acquire(4097);
+  buffer[4096] = 'x';
+  pool_.Release(buffer, 4097);
+  EXPECT_EQ(0u, pool_.free_buffers());
+
+  // Releasing NULL is allowed.
+  pool_.Release(NULL, 0);
+  EXPECT_EQ(0u, pool_.free_buffers());
+}
+
+}  // namespace rpc
+}  // namespace xtreemfs
@@ -7,7 +7,10 @@
 
 #include <gtest/gtest.h>
 
+#include <boost/bind.hpp>
 #include <boost/scoped_ptr.hpp>
+#include <boost/thread/thread.hpp>
+#include <vector>
 
 #include "common/test_environment.h"
 #include "common/test_rpc_server_dir.h"
@@ -20,6 +23,8 @@
 #include "libxtreemfs/volume.h"
 #include "libxtreemfs/xtreemfs_exception.h"
 #include "rpc/client.h"
+#include "rpc/sync_callback.h"
+#include "xtreemfs/DIRServiceClient.h"
 
 using namespace std;
 using namespace xtreemfs::pbrpc;
@@ -91,6 +96,52 @@ class ClientTestDropConnection : public ClientTest {
   }
 };
 
+/** Concurrent requests to the same server are spread across connections. */
+TEST_F(ClientTest, ConnectionsPerServer) {
+  const int kRequests = 20;
+  Client client(1, 5, 600, NULL, 2, 2);
+  DIRServiceClient dir_client(&client);
+
+  Auth auth;
+  auth.set_auth_type(AUTH_NONE);
+  UserCredentials user_credentials;
+  user_credentials.set_username("test");
+  user_credentials.add_groups("test");
+  serviceGetByNameRequest request;
+  request.set_name("test");
+
+  // Queue all requests before the io threads run, so none of them finishes
+  // before the next one is assigned to a connection.
+  vector<SyncCallbackBase*> responses;
+  for (int i = 0; i < kRequests; ++i) {
+    responses.push_back(dir_client.xtreemfs_service_get_by_name_sync(
+        test_env.dir->GetAddress(), auth, user_credentials, &request));
+  }
+  const string address = test_env.dir->GetAddress();
+  const vector<uint32_t>& loads =
+      *client.GetServerLoads(address, boost::hash<string>()(address));
+  ASSERT_EQ(2u, loads.size());
+  EXPECT_EQ(static_cast<uint32_t>(kRequests / 2), loads[0]);
+  EXPECT_EQ(static_cast<uint32_t>(kRequests / 2), loads[1]);
+
+  boost::thread client_thread(boost::bind(&Client::run, &client));
+  for (size_t i = 0; i < responses.size(); ++i) {
+    EXPECT_FALSE(responses[i]->HasFailed());
+    responses[i]->DeleteBuffers();
+    delete responses[i];
+  }
+
+  // The requests were spread across both connections.
+  size_t connections = 0;
+  for (size_t i = 0; i < client.io_threads_.size(); ++i) {
+    connections += client.io_threads_[i]->connections.size();
+  }
+  EXPECT_EQ(2u, connections);
+
+  client.shutdown();
+  client_thread.join();
+}
+
 /** Is a timed out request successfully aborted? */
 TEST_F(ClientTestFastTimeout, TimeoutHandling) {
   xtreemfs::ClientImplementation* impl =
@@ -137,7 +188,7 @@ TEST_F(ClientTestFastLingerTimeout, LingerTests) {
 
   boost::this_thread::sleep(boost::posix_time::seconds(2));
 
-  EXPECT_EQ(0, impl->network_client_->connections_.size());
+  EXPECT_EQ(0, impl->network_client_->io_threads_[0]->connections.size());
 }
 
 /** Connect timeout callbacks (which are executed after deleting
@@ -160,7 +211,7 @@ TEST_F(ClientTestFastLingerTimeoutConnectTimeout, LingerTests) {
 
   // At this point the connection must have been deleted
   // due to the very low linger timeout.
-  EXPECT_EQ(0, impl->network_client_->connections_.size());
+  EXPECT_EQ(0, impl->network_client_->io_threads_[0]->connections.size());
 }
 
 }  // namespace rpc
@@ -0,0 +1,85 @@
+/*
+ * Copyright (c) 2015 by Zuse Institute Berlin
+ *
+ * Licensed under the BSD License, see LICENSE file for details.
+ *
+ */
+
+#include <gtest/gtest.h>
+
+#include <boost/date_time/posix_time/posix_time.hpp>
+#include <map>
+#include <string>
+
+#include "rpc/server_statistics.h"
+
+using namespace std;
+using namespace boost::posix_time;
+
+namespace xtreemfs {
+namespace rpc {
+
+class ServerStatisticsTest : public ::testing::Test {
+ protected:
+  // Servers are degraded from an average latency of 2.5 seconds on.
+  ServerStatisticsTest() : statistics_(10) {}
+
+  ServerStatistics statistics_;
+};
+
+TEST_F(ServerStatisticsTest, UnknownServerHasNoScore) {
+  ServerScore score;
+  EXPECT_FALSE(statistics_.GetScore("localhost:32640", &score));
+}
+
+TEST_F(ServerStatisticsTest, AveragesLatencyAndCountsErrors) {
+  statistics_.RecordRequest("osd1:32640", milliseconds(10), false);
+  statistics_.RecordRequest("osd1:32640", milliseconds(20), false);
+  statistics_.RecordRequest("osd1:32640", milliseconds(30), true);
+
+  ServerScore score;
+  ASSERT_TRUE(statistics_.GetScore("osd1:32640", &score));
+  EXPECT_EQ(3u, score.requests);
+  EXPECT_EQ(1u, score.errors);
+  // 10 ms, then 0.9 * 10 + 0.1 * 20 = 11 ms, then 0.9 * 11 + 0.1 * 30 ms.
+  EXPECT_NEAR(12900, score.average_latency_us, 1);
+  EXPECT_NEAR(ServerStatistics::kSmoothingFactor, score.error_rate, 0.001);
+  EXPECT_FALSE(score.degraded);
+
+  map<string, ServerScore> scores;
+  statistics_.RecordRequest("osd2:32640", milliseconds(10), false);
+  statistics_.GetScores(&scores);
+  EXPECT_EQ(2u, scores.size());
+  EXPECT_EQ(3u, scores["osd1:32640"].requests);
+}
+
+/** Slow servers are degraded before their requests time out. */
+TEST_F(ServerStatisticsTest, SlowServerIsDegraded) {
+  ServerScore score;
+  for (int i = 0; i < ServerStatistics::kMinRequests; ++i) {
+    statistics_.RecordRequest("osd1:32640", seconds(3), false);
+    ASSERT_TRUE(statistics_.GetScore("osd1:32640", &score));
+    EXPECT_EQ(i + 1 == ServerStatistics::kMinRequests, score.degraded);
+  }
+
+  // It recovers once its responses are fast again.
+  for (int i = 0; i < 20; ++i) {
+    statistics_.RecordRequest("osd1:32640", milliseconds(1), false);
+  }
+  ASSERT_TRUE(statistics_.GetScore("osd1:32640", &score));
+  EXPECT_FALSE(score.degraded);
+}
+
+TEST_F(ServerStatisticsTest, FailingServerIsDegraded) {
+  for (int i = 0; i < ServerStatistics::kMinRequests; ++i) {
+    statistics_.RecordRequest("osd1:32640", milliseconds(1), true);
+  }
+  ServerScore score;
+  ASSERT_TRUE(statistics_.GetScore("osd1:32640", &score));
+  EXPECT_TRUE(score.degraded);
+  EXPECT_EQ(static_cast<uint64_t>(ServerStatistics::kMinRequests),
+            score.errors);
+}
+
+}  // namespace rpc
+}  // namespace xtreemfs
@@ -0,0 +1,189 @@
+/*
+ * Copyright (c) 2015 by Zuse Institute Berlin
+ *
+ * Licensed under the BSD License, see LICENSE file for details.
+ *
+ */
+
+#include <gtest/gtest.h>
+
+#include <boost/date_time/posix_time/posix_time.hpp>
+#include <iostream>
+#include <vector>
+
+#include "rpc/client_connection.h"
+#include "rpc/client_request.h"
+#include "rpc/client_request_callback_interface.h"
+#include "rpc/timeout_wheel.h"
+
+using namespace std;
+using namespace boost::posix_time;
+using namespace xtreemfs::pbrpc;
+
+namespace xtreemfs {
+namespace rpc {
+
+class NullCallback : public ClientRequestCallbackInterface {
+ public:
+  virtual void RequestCompleted(ClientRequest* request) {}
+};
+
+class TimeoutWheelTest : public ::testing::Test {
+ protected:
+  TimeoutWheelTest() : wheel_(milliseconds(100), 16) {
+    user_credentials_.set_username("test");
+    auth_.set_auth_type(AUTH_NONE);
+  }
+
+  virtual void TearDown() {
+    wheel_.Clear();
+    for (size_t i = 0; i < requests_.size(); ++i) {
+      delete requests_[i];
+    }
+  }
+
+  /** Returns a request which was sent now and times out after "timeout_s". */
+  ClientRequest* NewRequest(int32_t timeout_s) {
+    ClientRequest* request = new ClientRequest("localhost:32640",
+                                               requests_.size(),
+                                               0,
+                                               0,
+                                               user_credentials_,
+                                               auth_,
+                                               NULL,
+                                               NULL,
+                                               0,
+                                               NULL,
+                                               NULL,
+                                               &callback_);
+    request->set_timeout_s(timeout_s);
+    request->RequestSent(0);
+    requests_.push_back(request);
+    return request;
+  }
+
+  TimeoutWheel wheel_;
+  NullCallback callback_;
+  UserCredentials user_credentials_;
+  Auth auth_;
+  vector<ClientRequest*> requests_;
+};
+
+/** Requests expire once their deadline has passed. */
+TEST_F(TimeoutWheelTest, ExpireAfterDeadline) {
+  ClientRequest* short_request = NewRequest(1);
+  ClientRequest* long_request = NewRequest(5);
+  wheel_.Schedule(long_request);
+  wheel_.Schedule(short_request);
+  EXPECT_EQ(2u, wheel_.size());
+
+  vector<ClientRequest*> expired;
+  wheel_.Expire(short_request->time_sent(), &expired);
+  EXPECT_TRUE(expired.empty());
+
+  // The slot of long_request is visited, but it belongs to a later round.
+  wheel_.Expire(short_request->deadline() + seconds(1), &expired);
+  ASSERT_EQ(1u, expired.size());
+  EXPECT_EQ(short_request, expired[0]);
+  EXPECT_EQ(1u, wheel_.size());
+
+  expired.clear();
+  wheel_.Expire(long_request->deadline() + seconds(1), &expired);
+  ASSERT_EQ(1u, expired.size());
+  EXPECT_EQ(long_request, expired[0]);
+  EXPECT_EQ(0u, wheel_.size());
+}
+
+/** Canceled requests do not expire. */
+TEST_F(TimeoutWheelTest, Cancel) {
+  ClientRequest* request = NewRequest(1);
+  wheel_.Schedule(request);
+  wheel_.Cancel(request);
+  EXPECT_EQ(0u, wheel_.size());
+  // Canceling twice has no effect.
+  wheel_.Cancel(request);
+
+  vector<ClientRequest*> expired;
+  wheel_.Expire(request->deadline() + seconds(10), &expired);
+  EXPECT_TRUE(expired.empty());
+}
+
+/** Requests whose deadline already passed expire with the next call. */
+TEST_F(TimeoutWheelTest, ScheduleAfterDeadline) {
+  ClientRequest* request = NewRequest(1);
+  vector<ClientRequest*> expired;
+  wheel_.Expire(request->deadline() + seconds(1), &expired);
+
+  wheel_.Schedule(request);
+  wheel_.Expire(request->deadline() + seconds(2), &expired);
+  ASSERT_EQ(1u, expired.size());
+  EXPECT_EQ(request, expired[0]);
+}
+
+/** Compares the cost of the timeout bookkeeping of the TimeoutWheel with a scan
+ *  of the request table for 100k requests in flight. */
+TEST_F(TimeoutWheelTest, Benchmark) {
+  const int kRequests = 100000;
+  const int kTicks = 10;
+  // The configuration of the Client's wheels.
+  TimeoutWheel wheel(seconds(1), 64);
+
+  request_map request_table;
+  for (int i = 0; i < kRequests; ++i) {
+    ClientRequest* request = NewRequest(15);
+    request_table[request->call_id()] = request;
+  }
+  const ptime now = requests_.back()->time_sent();
+  vector<ClientRequest*> expired;
+
+  // Scan of the request table in every tick.
+  ptime start = microsec_clock::local_time();
+  size_t timed_out = 0;
+  for (int tick = 0; tick < kTicks; ++tick) {
+    ptime deadline = now + seconds(tick) - seconds(15);
+    for (request_map::iterator it = request_table.begin();
+         it != request_table.end();
+         ++it) {
+      if (it->second->time_sent() < deadline) {
+        ++timed_out;
+      }
+    }
+  }
+  const time_duration scan_time = microsec_clock::local_time() - start;
+  EXPECT_EQ(0u, timed_out);
+
+  // Insert, tick and cancel with the TimeoutWheel.
+  start = microsec_clock::local_time();
+  for (size_t i = 0; i < requests_.size(); ++i) {
+    wheel.Schedule(requests_[i]);
+  }
+  const time_duration schedule_time = microsec_clock::local_time() - start;
+
+  start = microsec_clock::local_time();
+  for (int tick = 0; tick < kTicks; ++tick) {
+    wheel.Expire(now + seconds(tick), &expired);
+  }
+  const time_duration tick_time = microsec_clock::local_time() - start;
+  EXPECT_TRUE(expired.empty());
+  EXPECT_EQ(static_cast<size_t>(kRequests), wheel.size());
+
+  start = microsec_clock::local_time();
+  for (size_t i = 0; i < requests_.size(); ++i) {
+    wheel.Cancel(requests_[i]);
+  }
+  const time_duration cancel_time = microsec_clock::local_time() - start;
+  EXPECT_EQ(0u, wheel.size());
+
+  cout << "Timeout bookkeeping for " << kRequests << " requests in flight:"
+       << endl
+       << "  request table scan: "
+       << scan_time.total_microseconds() / kTicks << " us per tick" << endl
+       << "  TimeoutWheel:       "
+       << tick_time.total_microseconds() / kTicks << " us per tick, "
+       << schedule_time.total_nanoseconds() / kRequests << " ns per insert, "
+       << cancel_time.total_nanoseconds() / kRequests << " ns per cancel"
+       << endl;
+}
+
+}  // namespace rpc
+}  // namespace xtreemfs
@@ -0,0 +1,143 @@
+/*
+ * Copyright (c) 2015 by Zuse Institute Berlin
+ *
+ * Licensed under the BSD License, see LICENSE file for details.
+ *
+ */
+
+#include <gtest/gtest.h>
+
+#include <boost/date_time/posix_time/posix_time.hpp>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "util/crc32c.h"
+
+using namespace std;
+
+namespace xtreemfs {
+namespace util {
+
+/** Test vectors of RFC 3720, appendix B.4. */
+TEST(CRC32CTest, KnownValues) {
+  char buffer[32];
+  memset(buffer, 0, sizeof(buffer));
+  EXPECT_EQ(0x8A9136AAu, CRC32C(0, buffer, sizeof(buffer)));
+  EXPECT_EQ(0x8A9136AAu, CRC32CPortable(0, buffer, sizeof(buffer)));
+
+  memset(buffer, 0xff, sizeof(buffer));
+  EXPECT_EQ(0x62A8AB43u, CRC32C(0, buffer, sizeof(buffer)));
+  EXPECT_EQ(0x62A8AB43u, CRC32CPortable(0, buffer, sizeof(buffer)));
+
+  for (int i = 0; i < 32; ++i) {
+    buffer[i] = static_cast<char>(i);
+  }
+  EXPECT_EQ(0x46DD794Eu, CRC32C(0, buffer, sizeof(buffer)));
+  EXPECT_EQ(0x46DD794Eu, CRC32CPortable(0, buffer, sizeof(buffer)));
+
+  const string check = "123456789";
+  EXPECT_EQ(0xE3069283u, CRC32C(0, check.data(), check.size()));
+  EXPECT_EQ(0u, CRC32C(0, NULL, 0));
+}
+
+/** All lengths and alignments around the lane sizes of the hardware
+ *  implementation yield the checksum of the portable one. */
+TEST(CRC32CTest, MatchesPortableImplementation) {
+  std::vector<char> data(3 * 4096 * 2 + 64);
+  srand(42);
+  for (size_t i = 0; i < data.size(); ++i) {
+    data[i] = static_cast<char>(rand());
+  }
+
+  const size_t lengths[] = { 0, 1, 7, 8, 9, 255, 3 * 256 - 1, 3 * 256,
+                             3 * 256 + 13, 3 * 4096 - 8, 3 * 4096,
+                             3 * 4096 + 3 * 256 + 5, 2 * 3 * 4096 };
+  for (size_t i = 0; i < sizeof(lengths) / sizeof(lengths[0]); ++i) {
+    for (size_t alignment = 0; alignment < 8; ++alignment) {
+      const char* start = &data[alignment];
+      ASSERT_EQ(CRC32CPortable(0, start, lengths[i]),
+                CRC32C(0, start, lengths[i]))
+          << "length " << lengths[i] << " alignment " << alignment;
+    }
+  }
+}
+
+/** The checksum of data which is passed in pieces is the checksum of all
+ *  data. */
+TEST(CRC32CTest, Continuation) {
+  std::vector<char> data(20000);
+  for (size_t i = 0; i < data.size(); ++i) {
+    data[i] = static_cast<char>(i * 31);
+  }
+  const uint32_t expected = CRC32C(0, &data[0], data.size());
+  const size_t splits[] = { 1, 100, 12288, 19999 };
+  for (size_t i = 0; i < sizeof(splits) / sizeof(splits[0]); ++i) {
+    const uint32_t first = CRC32C(0, &data[0], splits[i]);
+    EXPECT_EQ(expected,
+              CRC32C(first, &data[splits[i]], data.size() - splits[i]));
+    EXPECT_EQ(expected,
+              CRC32CPortable(CRC32CPortable(0, &data[0], splits[i]),
+                             &data[splits[i]],
+                             data.size() - splits[i]));
+  }
+}
+
+/** Measures the throughput of checksumming 128 kB objects and compares it
+ *  with copying them, which every write to the network does anyway. */
+TEST(CRC32CBenchmark, ObjectThroughput) {
+  const size_t kObjectSize = 128 * 1024;
+  const int kObjects = 2048;  // 256 MB
+  std::vector<char> object(kObjectSize);
+  std::vector<char> copy(kObjectSize);
+  for (size_t i = 0; i < object.size(); ++i) {
+    object[i] = static_cast<char>(i * 7);
+  }
+  const double total_gb = static_cast<double>(kObjectSize) * kObjects / 1e9;
+
+  uint32_t crc = 0;
+  boost::posix_time::ptime start =
+      boost::posix_time::microsec_clock::local_time();
+  for (int i = 0; i < kObjects; ++i) {
+    crc += CRC32C(0, &object[0], kObjectSize);
+  }
+  const double crc_s =
+      (boost::posix_time::microsec_clock::local_time() - start)
+          .total_microseconds() / 1e6;
+
+  start = boost::posix_time::microsec_clock::local_time();
+  for (int i = 0; i < kObjects / 8; ++i) {
+    crc += CRC32CPortable(0, &object[0], kObjectSize);
+  }
+  const double portable_s =
+      (boost::posix_time::microsec_clock::local_time() - start)
+          .total_microseconds() / 1e6 * 8;
+
+  start = boost::posix_time::microsec_clock::local_time();
+  for (int i = 0; i < kObjects; ++i) {
+    object[i % kObjectSize] ^= 1;
+    memcpy(&copy[0], &object[0], kObjectSize);
+  }
+  const double copy_s =
+      (boost::posix_time::microsec_clock::local_time() - start)
+          .total_microseconds() / 1e6;
+
+  const double crc_gb_per_s = total_gb / crc_s;
+  cout << "CRC32C ("
+       << (CRC32CIsHardwareAccelerated() ? "SSE 4.2" : "portable") << "): "
+       << crc_gb_per_s << " GB/s, portable: " << total_gb / portable_s
+       << " GB/s, memcpy: " << total_gb / copy_s << " GB/s" << endl;
+  cout << "At 10 GB/s of object data, checksums take "
+       << 10 / crc_gb_per_s * 100 << "% of one core, "
+       << crc_s / copy_s * 100 << "% of the time of copying the data once"
+       << " (checksum " << crc << ")" << endl;
+
+  if (CRC32CIsHardwareAccelerated()) {
+    EXPECT_LT(crc_s, portable_s);
+  }
+}
+
+}  // namespace util
+}  // namespace xtreemfs
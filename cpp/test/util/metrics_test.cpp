@@ -0,0 +1,122 @@
+/*
+ * Copyright (c) 2015 by Zuse Institute Berlin
+ *
+ * Licensed under the BSD License, see LICENSE file for details.
+ *
+ */
+
+#include <gtest/gtest.h>
+
+#include <boost/bind.hpp>
+#include <boost/thread/thread.hpp>
+#include <map>
+#include <sstream>
+#include <string>
+
+#include "util/metrics.h"
+
+using namespace std;
+
+namespace xtreemfs {
+namespace util {
+
+TEST(HistogramTest, BucketBoundsAreConsistent) {
+  for (int64_t value = 0; value < 100000; ++value) {
+    const int bucket = Histogram::GetBucket(value);
+    ASSERT_LE(Histogram::GetBucketLowerBound(bucket), value);
+    ASSERT_GT(Histogram::GetBucketLowerBound(bucket + 1), value);
+  }
+  EXPECT_EQ(Histogram::kBuckets - 1, Histogram::GetBucket(1LL << 40));
+}
+
+TEST(HistogramTest, BucketsAreAtMostOneEighthWide) {
+  for (int bucket = Histogram::kSubBuckets; bucket < Histogram::kBuckets - 1;
+       ++bucket) {
+    const int64_t lower = Histogram::GetBucketLowerBound(bucket);
+    const int64_t width = Histogram::GetBucketLowerBound(bucket + 1) - lower;
+    EXPECT_LE(width * Histogram::kSubBuckets, lower);
+  }
+}
+
+TEST(HistogramTest, Percentiles) {
+  Histogram histogram;
+  HistogramSnapshot snapshot;
+  histogram.GetSnapshot(&snapshot);
+  EXPECT_EQ(0u, snapshot.count);
+  EXPECT_EQ(0, snapshot.ValueAtPercentile(50));
+
+  for (int64_t value = 1; value <= 1000; ++value) {
+    histogram.Record(value);
+  }
+  histogram.GetSnapshot(&snapshot);
+  EXPECT_EQ(1000u, snapshot.count);
+  EXPECT_EQ(500500, snapshot.sum);
+  EXPECT_EQ(1000, snapshot.max);
+  EXPECT_NEAR(500, snapshot.ValueAtPercentile(50), 500 / 8);
+  EXPECT_NEAR(990, snapshot.ValueAtPercentile(99), 990 / 8);
+  EXPECT_EQ(1000, snapshot.ValueAtPercentile(100));
+}
+
+void AddRepeatedly(Counter* counter, int64_t delta, int times) {
+  for (int i = 0; i < times; ++i) {
+    counter->Add(delta);
+  }
+}
+
+TEST(CounterTest, SumsUpAllThreads) {
+  const int kThreads = 8;
+  const int kIncrements = 10000;
+  Counter counter;
+  boost::thread_group threads;
+  for (int i = 0; i < kThreads; ++i) {
+    threads.create_thread(
+        boost::bind(&AddRepeatedly, &counter, 2, kIncrements));
+    threads.create_thread(
+        boost::bind(&AddRepeatedly, &counter, -1, kIncrements));
+  }
+  threads.join_all();
+  EXPECT_EQ(kThreads * kIncrements, counter.Value());
+}
+
+TEST(MetricsRegistryTest, ReturnsSameMetricForSameName) {
+  MetricsRegistry* registry = MetricsRegistry::instance();
+  EXPECT_EQ(registry, MetricsRegistry::instance());
+  EXPECT_EQ(registry->GetCounter("test_counter"),
+            registry->GetCounter("test_counter"));
+  EXPECT_NE(registry->GetCounter("test_counter"),
+            registry->GetGauge("test_counter"));
+  EXPECT_EQ(registry->GetHistogram("test_latency_us"),
+            registry->GetHistogram("test_latency_us"));
+}
+
+TEST(MetricsRegistryTest, WritesTextFormat) {
+  MetricsRegistry* registry = MetricsRegistry::instance();
+  registry->GetCounter("test_text_requests")->Add(3);
+  registry->GetGauge("test_text_bytes_in_flight")->Add(-2);
+  registry->GetHistogram("test_text_unused_us");
+  registry->GetHistogram("test_text_latency_us")->Record(100);
+
+  map<string, int64_t> values;
+  registry->GetCounterValues(&values);
+  EXPECT_EQ(3, values["test_text_requests"]);
+  EXPECT_EQ(-2, values["test_text_bytes_in_flight"]);
+
+  ostringstream text;
+  registry->WriteText(&text);
+  const string output = text.str();
+  EXPECT_NE(string::npos, output.find(
+      "# TYPE xtreemfs_test_text_requests counter\n"
+      "xtreemfs_test_text_requests 3\n"));
+  EXPECT_NE(string::npos, output.find(
+      "# TYPE xtreemfs_test_text_bytes_in_flight gauge\n"
+      "xtreemfs_test_text_bytes_in_flight -2\n"));
+  EXPECT_NE(string::npos, output.find(
+      "# TYPE xtreemfs_test_text_latency_us summary\n"));
+  EXPECT_NE(string::npos, output.find(
+      "xtreemfs_test_text_latency_us_count 1\n"));
+  // Histograms without values are left out.
+  EXPECT_EQ(string::npos, output.find("test_text_unused_us"));
+}
+
+}  // namespace util
+}  // namespace xtreemfs
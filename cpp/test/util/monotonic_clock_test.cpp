@@ -0,0 +1,37 @@
+/*
+ * Copyright (c) 2015 by Zuse Institute Berlin
+ *
+ * Licensed under the BSD License, see LICENSE file for details.
+ *
+ */
+
+#include <gtest/gtest.h>
+
+#include <boost/date_time/posix_time/posix_time.hpp>
+#include <boost/thread/thread.hpp>
+
+#include "util/monotonic_clock.h"
+
+using namespace boost::posix_time;
+
+namespace xtreemfs {
+namespace util {
+
+/** The clock never goes backwards and advances while the caller sleeps. */
+TEST(MonotonicClockTest, Advances) {
+  const ptime start = MonotonicTime();
+  ptime previous = start;
+  for (int i = 0; i < 1000; ++i) {
+    const ptime now = MonotonicTime();
+    ASSERT_LE(previous, now);
+    previous = now;
+  }
+
+  boost::this_thread::sleep(milliseconds(50));
+  const time_duration elapsed = MonotonicTime() - start;
+  EXPECT_GE(elapsed, milliseconds(50));
+  EXPECT_LT(elapsed, seconds(10));
+}
+
+}  // namespace util
+}  // namespace xtreemfs
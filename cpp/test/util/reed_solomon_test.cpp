@@ -0,0 +1,236 @@
+/*
+ * Copyright (c) 2015 by Zuse Institute Berlin
+ *
+ * Licensed under the BSD License, see LICENSE file for details.
+ *
+ */
+
+#include <gtest/gtest.h>
+
+#include <boost/date_time/posix_time/posix_time.hpp>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+#include "util/reed_solomon.h"
+
+using namespace std;
+
+namespace xtreemfs {
+namespace util {
+
+namespace {
+
+/** Data and parity fragments of a ReedSolomon code filled with random
+ *  data. */
+class Fragments {
+ public:
+  Fragments(const ReedSolomon& code, size_t length)
+      : length_(length),
+        buffers_(code.data_fragments() + code.parity_fragments(),
+                 vector<char>(length)) {
+    for (int i = 0; i < code.data_fragments(); ++i) {
+      for (size_t j = 0; j < length; ++j) {
+        buffers_[i][j] = static_cast<char>(rand());
+      }
+    }
+    for (size_t i = 0; i < buffers_.size(); ++i) {
+      pointers_.push_back(length > 0 ? &buffers_[i][0] : NULL);
+    }
+    code.Encode(&pointers_[0],
+                &pointers_[code.data_fragments()],
+                length);
+  }
+
+  char* const* pointers() {
+    return &pointers_[0];
+  }
+
+  const vector<char>& fragment(int i) const {
+    return buffers_[i];
+  }
+
+  void Erase(int i) {
+    memset(&buffers_[i][0], 0xAA, length_);
+  }
+
+ private:
+  size_t length_;
+  vector<vector<char> > buffers_;
+  vector<char*> pointers_;
+};
+
+}  // anonymous namespace
+
+TEST(ReedSolomonTest, MultiplyRegionMatchesPortableImplementation) {
+  vector<char> source(1000);
+  for (size_t i = 0; i < source.size(); ++i) {
+    source[i] = static_cast<char>(i * 13);
+  }
+  const size_t lengths[] = { 0, 1, 15, 16, 17, 31, 32, 33, 1000 };
+  for (int factor = 0; factor < 256; ++factor) {
+    for (size_t i = 0; i < sizeof(lengths) / sizeof(lengths[0]); ++i) {
+      for (int accumulate = 0; accumulate < 2; ++accumulate) {
+        vector<char> expected(source.rbegin(), source.rend());
+        vector<char> actual(expected);
+        GaloisMultiplyRegionPortable(factor, &source[1], &expected[0],
+                                     lengths[i] - (lengths[i] > 0 ? 1 : 0),
+                                     accumulate);
+        GaloisMultiplyRegion(factor, &source[1], &actual[0],
+                             lengths[i] - (lengths[i] > 0 ? 1 : 0),
+                             accumulate);
+        ASSERT_TRUE(expected == actual)
+            << "factor " << factor << " length " << lengths[i];
+      }
+    }
+  }
+}
+
+TEST(ReedSolomonTest, MultiplicationIsDistributive) {
+  // (a * x) + (b * x) = (a + b) * x
+  const char x[] = { 1, 2, 3, 0x53, static_cast<char>(0xCA) };
+  for (int a = 0; a < 256; a += 7) {
+    for (int b = 0; b < 256; b += 11) {
+      char sum[sizeof(x)];
+      char expected[sizeof(x)];
+      GaloisMultiplyRegionPortable(a, x, sum, sizeof(x), false);
+      GaloisMultiplyRegionPortable(b, x, sum, sizeof(x), true);
+      GaloisMultiplyRegionPortable(a ^ b, x, expected, sizeof(x), false);
+      ASSERT_EQ(0, memcmp(expected, sum, sizeof(x)));
+    }
+  }
+}
+
+/** Every combination of up to parity_fragments lost fragments is
+ *  reconstructed. */
+TEST(ReedSolomonTest, ReconstructsAnyLostFragments) {
+  srand(42);
+  const int kData = 4;
+  const int kParity = 3;
+  const int kTotal = kData + kParity;
+  ReedSolomon code(kData, kParity);
+  const size_t kLength = 20000 + 3;  // Spans blocks, not a multiple of 32.
+
+  for (int lost = 0; lost < (1 << kTotal); ++lost) {
+    vector<bool> available(kTotal);
+    int lost_count = 0;
+    for (int i = 0; i < kTotal; ++i) {
+      available[i] = (lost & (1 << i)) == 0;
+      lost_count += available[i] ? 0 : 1;
+    }
+    if (lost_count > kParity) {
+      continue;
+    }
+
+    Fragments fragments(code, kLength);
+    Fragments original(fragments);
+    for (int i = 0; i < kTotal; ++i) {
+      if (!available[i]) {
+        fragments.Erase(i);
+      }
+    }
+    ASSERT_TRUE(code.Reconstruct(fragments.pointers(), available, kLength));
+    for (int i = 0; i < kTotal; ++i) {
+      ASSERT_TRUE(original.fragment(i) == fragments.fragment(i))
+          << "fragment " << i << " lost fragments " << lost;
+    }
+  }
+}
+
+/** Updating the parity with the delta of a changed range of a data fragment
+ *  gives the parity of the changed data. */
+TEST(ReedSolomonTest, UpdateMatchesEncode) {
+  srand(42);
+  const int kData = 4;
+  const int kParity = 2;
+  ReedSolomon code(kData, kParity);
+  const size_t kLength = 10000;
+  const size_t kOffset = 1000;
+  const size_t kChanged = 5000 + 3;
+
+  Fragments fragments(code, kLength);
+  char* const* pointers = fragments.pointers();
+  vector<char> delta(kChanged);
+  for (size_t i = 0; i < kChanged; ++i) {
+    const char new_data = static_cast<char>(rand());
+    delta[i] = pointers[2][kOffset + i] ^ new_data;
+    pointers[2][kOffset + i] = new_data;
+  }
+  vector<char*> parity;
+  for (int i = 0; i < kParity; ++i) {
+    parity.push_back(pointers[kData + i] + kOffset);
+  }
+  code.Update(2, &delta[0], &parity[0], kChanged);
+
+  vector<vector<char> > expected(kParity, vector<char>(kLength));
+  vector<char*> expected_pointers;
+  for (int i = 0; i < kParity; ++i) {
+    expected_pointers.push_back(&expected[i][0]);
+  }
+  code.Encode(pointers, &expected_pointers[0], kLength);
+  for (int i = 0; i < kParity; ++i) {
+    EXPECT_TRUE(expected[i] == fragments.fragment(kData + i))
+        << "parity fragment " << i;
+  }
+}
+
+TEST(ReedSolomonTest, TooManyLostFragments) {
+  ReedSolomon code(3, 2);
+  Fragments fragments(code, 100);
+  vector<bool> available(5, true);
+  available[0] = false;
+  available[2] = false;
+  available[4] = false;
+  EXPECT_FALSE(code.Reconstruct(fragments.pointers(), available, 100));
+}
+
+/** Measures the encoding throughput of stripes of 128 kB objects. */
+TEST(ReedSolomonBenchmark, Encode) {
+  const size_t kObjectSize = 128 * 1024;
+  const int kCodes[][2] = { { 4, 2 }, { 10, 4 } };
+  for (size_t c = 0; c < sizeof(kCodes) / sizeof(kCodes[0]); ++c) {
+    ReedSolomon code(kCodes[c][0], kCodes[c][1]);
+    Fragments fragments(code, kObjectSize);
+    const int kStripes = 200;
+    const double data_gb =
+        static_cast<double>(kObjectSize) * code.data_fragments() * kStripes /
+        1e9;
+
+    boost::posix_time::ptime start =
+        boost::posix_time::microsec_clock::local_time();
+    for (int i = 0; i < kStripes; ++i) {
+      code.Encode(fragments.pointers(),
+                  fragments.pointers() + code.data_fragments(),
+                  kObjectSize);
+    }
+    const double encode_s =
+        (boost::posix_time::microsec_clock::local_time() - start)
+            .total_microseconds() / 1e6;
+
+    // The portable implementation only computes the first parity fragment
+    // of a tenth of the stripes.
+    start = boost::posix_time::microsec_clock::local_time();
+    for (int i = 0; i < kStripes / 10; ++i) {
+      for (int j = 0; j < code.data_fragments(); ++j) {
+        GaloisMultiplyRegionPortable(j + 1,
+                                     fragments.pointers()[j],
+                                     fragments.pointers()[code.data_fragments()],
+                                     kObjectSize,
+                                     j > 0);
+      }
+    }
+    const double portable_s =
+        (boost::posix_time::microsec_clock::local_time() - start)
+            .total_microseconds() / 1e6 * 10 * code.parity_fragments();
+
+    cout << "Reed-Solomon " << code.data_fragments() << "+"
+         << code.parity_fragments() << " encoding ("
+         << GaloisMultiplyRegionImplementation() << "): "
+         << data_gb / encode_s << " GB/s of data, portable: "
+         << data_gb / portable_s << " GB/s" << endl;
+  }
+}
+
+}  // namespace util
+}  // namespace xtreemfs
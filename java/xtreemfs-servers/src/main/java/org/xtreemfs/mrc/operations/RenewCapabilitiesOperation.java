@@ -0,0 +1,97 @@
+/*
+ * Copyright (c) 2015 by Zuse Institute Berlin
+ *
+ * Licensed under the BSD License, see LICENSE file for details.
+ *
+ */
+
+package org.xtreemfs.mrc.operations;
+
+import org.xtreemfs.common.Capability;
+import org.xtreemfs.foundation.logging.Logging;
+import org.xtreemfs.foundation.logging.Logging.Category;
+import org.xtreemfs.foundation.pbrpc.generatedinterfaces.RPC.ErrorType;
+import org.xtreemfs.foundation.pbrpc.generatedinterfaces.RPC.POSIXErrno;
+import org.xtreemfs.mrc.MRCException;
+import org.xtreemfs.mrc.MRCRequest;
+import org.xtreemfs.mrc.MRCRequestDispatcher;
+import org.xtreemfs.mrc.UserException;
+import org.xtreemfs.mrc.database.DatabaseException;
+import org.xtreemfs.mrc.database.DatabaseException.ExceptionType;
+import org.xtreemfs.pbrpc.generatedinterfaces.GlobalTypes.XCap;
+import org.xtreemfs.pbrpc.generatedinterfaces.MRC.xtreemfs_renew_capabilitiesError;
+import org.xtreemfs.pbrpc.generatedinterfaces.MRC.xtreemfs_renew_capabilitiesRequest;
+import org.xtreemfs.pbrpc.generatedinterfaces.MRC.xtreemfs_renew_capabilitiesResponse;
+
+/**
+ * Renews several capabilities with one request, e.g. the capabilities of all
+ * files a client has opened. Every capability is renewed like by the
+ * {@link RenewCapabilityAndVoucherOperation} without increasing its voucher.
+ * Capabilities which cannot be renewed are returned unchanged together with
+ * an error.
+ */
+public class RenewCapabilitiesOperation extends MRCOperation {
+    
+    public final boolean renewTimedOutCaps;
+    
+    public RenewCapabilitiesOperation(MRCRequestDispatcher master) {
+        super(master);
+        renewTimedOutCaps = master.getConfig().isRenewTimedOutCaps();
+    }
+    
+    @Override
+    public void startRequest(MRCRequest rq) throws Throwable {
+        
+        final xtreemfs_renew_capabilitiesRequest rqArgs = (xtreemfs_renew_capabilitiesRequest) rq
+                .getRequestArgs();
+        
+        // perform master redirect if necessary due to DB operation
+        if (master.getReplMasterUUID() != null
+                && !master.getReplMasterUUID().equals(master.getConfig().getUUID().toString()))
+            throw new DatabaseException(ExceptionType.REDIRECT);
+        
+        xtreemfs_renew_capabilitiesResponse.Builder response = xtreemfs_renew_capabilitiesResponse.newBuilder();
+        for (int i = 0; i < rqArgs.getXcapsCount(); i++) {
+            
+            XCap xcap = rqArgs.getXcaps(i);
+            Capability cap = new Capability(xcap, master.getConfig().getCapabilitySecret());
+            
+            // renew every capability like a periodic xtreemfs_renew_capability_and_voucher
+            // request; a failure only affects its own capability
+            ErrorType errorType;
+            POSIXErrno errno;
+            String errorMessage;
+            try {
+                response.addXcaps(RenewCapabilityAndVoucherOperation.renewCapability(master, cap, false,
+                        renewTimedOutCaps).getXCap());
+                continue;
+            } catch (UserException exc) {
+                errorType = ErrorType.ERRNO;
+                errno = exc.getErrno();
+                errorMessage = exc.getMessage();
+            } catch (DatabaseException exc) {
+                errorType = exc.getType() == ExceptionType.NOT_ALLOWED ? ErrorType.ERRNO
+                        : ErrorType.INTERNAL_SERVER_ERROR;
+                errno = exc.getType() == ExceptionType.NOT_ALLOWED ? POSIXErrno.POSIX_ERROR_EPERM
+                        : POSIXErrno.POSIX_ERROR_EIO;
+                errorMessage = exc.getMessage();
+            } catch (MRCException exc) {
+                errorType = ErrorType.INTERNAL_SERVER_ERROR;
+                errno = POSIXErrno.POSIX_ERROR_EIO;
+                errorMessage = exc.getMessage();
+            }
+            
+            if (Logging.isDebug())
+                Logging.logMessage(Logging.LEVEL_DEBUG, Category.proc, this, "not renewing capability %s: %s", cap,
+                        errorMessage);
+            response.addXcaps(xcap);
+            response.addErrors(xtreemfs_renew_capabilitiesError.newBuilder().setIndex(i)
+                    .setErrorType(errorType.getNumber()).setPosixErrno(errno.getNumber())
+                    .setErrorMessage(errorMessage == null ? "" : errorMessage));
+        }
+        
+        // set the response
+        rq.setResponse(response.build());
+        finishRequest(rq);
+    }
+}
@@ -11,9 +11,9 @@ package org.xtreemfs.mrc.operations;
 import org.xtreemfs.common.Capability;
 import org.xtreemfs.foundation.TimeSync;
 import org.xtreemfs.foundation.logging.Logging;
-import org.xtreemfs.foundation.pbrpc.generatedinterfaces.RPC;
 import org.xtreemfs.foundation.pbrpc.generatedinterfaces.RPC.POSIXErrno;
 import org.xtreemfs.mrc.MRCRequest;
+import org.xtreemfs.mrc.MRCException;
 import org.xtreemfs.mrc.MRCRequestDispatcher;
 import org.xtreemfs.mrc.UserException;
 import org.xtreemfs.mrc.database.AtomicDBUpdate;
@@ -56,6 +56,27 @@ public class RenewCapabilityAndVoucherOperation extends MRCOperation {
                 "Renew capability for file: " + cap.getFileId() + " and client: " + cap.getClientIdentity() + ". "
                         + "Increase voucher on renew: " + renewCapabilityRequest.getIncreaseVoucher());
 
+        Capability newCap = renewCapability(master, cap, renewCapabilityRequest.getIncreaseVoucher(),
+                renewTimedOutCaps);
+
+        // set the response
+        rq.setResponse(newCap.getXCap());
+        finishRequest(rq);
+    }
+
+    /**
+     * Verifies the capability and returns a renewed one. The voucher manager is told about the renewal, and the
+     * voucher is increased if <code>increaseVoucher</code> is set. Also used by the
+     * {@link RenewCapabilitiesOperation} for every capability of a batch.
+     * 
+     * @throws UserException
+     *             if the capability has an invalid signature or has expired, or if the voucher cannot be renewed
+     * @throws MRCException
+     *             if the metadata of the file cannot be found
+     */
+    static Capability renewCapability(MRCRequestDispatcher master, Capability cap, boolean increaseVoucher,
+            boolean renewTimedOutCaps) throws UserException, MRCException, DatabaseException {
+
         // check whether the capability has a valid signature
         if (!cap.hasValidSignature())
             throw new UserException(POSIXErrno.POSIX_ERROR_EPERM, cap + " does not have a valid signature");
@@ -76,33 +97,29 @@ public class RenewCapabilityAndVoucherOperation extends MRCOperation {
 
             FileMetadata metadata = sMan.getMetadata(globalFileIdResolver.getLocalFileId());
 
-            if(metadata != null) {
-                QuotaFileInformation quotaFileInformation = new QuotaFileInformation(globalFileIdResolver.getVolumeId(),
-                        metadata);
-
-                if (renewCapabilityRequest.getIncreaseVoucher()) {
-                    voucherSize = master.getMrcVoucherManager().checkAndRenewVoucher(quotaFileInformation,
-                            cap.getClientIdentity(), cap.getVoucherSize(), cap.getExpireMs(), newExpireMs, update);
-                } else {
-                    voucherSize = master.getMrcVoucherManager().addRenewedTimestamp(quotaFileInformation,
-                            cap.getClientIdentity(),
-                            cap.getExpireMs(), newExpireMs, update);
-                }
-
-                update.execute();
-            } else rq.setError(RPC.ErrorType.INTERNAL_SERVER_ERROR, "Error while renewing XCap");
-        }
+            if (metadata == null)
+                throw new MRCException("Error while renewing XCap");
 
-        Capability newCap = new Capability(cap.getFileId(), cap.getAccessMode(), master.getConfig()
-                .getCapabilityTimeout(), TimeSync.getGlobalTime() / 1000 + master.getConfig().getCapabilityTimeout(),
-                cap.getClientIdentity(), cap.getEpochNo(), cap.isReplicateOnClose(), cap.getSnapConfig(),
-                cap.getSnapTimestamp(), cap.getTraceConfig().getTraceRequests(), cap.getTraceConfig().getTracingPolicy(),
-                cap.getTraceConfig().getTracingPolicyConfig(), voucherSize, newExpireMs,
-                master.getConfig().getCapabilitySecret());
+            QuotaFileInformation quotaFileInformation = new QuotaFileInformation(globalFileIdResolver.getVolumeId(),
+                    metadata);
 
-        // set the response
-        rq.setResponse(newCap.getXCap());
-        finishRequest(rq);
+            if (increaseVoucher) {
+                voucherSize = master.getMrcVoucherManager().checkAndRenewVoucher(quotaFileInformation,
+                        cap.getClientIdentity(), cap.getVoucherSize(), cap.getExpireMs(), newExpireMs, update);
+            } else {
+                voucherSize = master.getMrcVoucherManager().addRenewedTimestamp(quotaFileInformation,
+                        cap.getClientIdentity(), cap.getExpireMs(), newExpireMs, update);
+            }
+
+            update.execute();
+        }
+
+        return new Capability(cap.getFileId(), cap.getAccessMode(), master.getConfig().getCapabilityTimeout(),
+                TimeSync.getGlobalTime() / 1000 + master.getConfig().getCapabilityTimeout(), cap.getClientIdentity(),
+                cap.getEpochNo(), cap.isReplicateOnClose(), cap.getSnapConfig(), cap.getSnapTimestamp(), cap
+                        .getTraceConfig().getTraceRequests(), cap.getTraceConfig().getTracingPolicy(), cap
+                        .getTraceConfig().getTracingPolicyConfig(), voucherSize, newExpireMs, master.getConfig()
+                        .getCapabilitySecret());
     }
 
 }
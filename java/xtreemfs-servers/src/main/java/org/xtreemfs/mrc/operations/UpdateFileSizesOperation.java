@@ -0,0 +1,149 @@
+/*
+ * Copyright (c) 2015 by Zuse Institute Berlin
+ *
+ * Licensed under the BSD License, see LICENSE file for details.
+ *
+ */
+
+package org.xtreemfs.mrc.operations;
+
+import org.xtreemfs.common.Capability;
+import org.xtreemfs.foundation.TimeSync;
+import org.xtreemfs.foundation.logging.Logging;
+import org.xtreemfs.foundation.logging.Logging.Category;
+import org.xtreemfs.mrc.MRCRequest;
+import org.xtreemfs.mrc.MRCRequestDispatcher;
+import org.xtreemfs.mrc.UserException;
+import org.xtreemfs.mrc.database.AtomicDBUpdate;
+import org.xtreemfs.mrc.database.DatabaseException;
+import org.xtreemfs.mrc.database.DatabaseException.ExceptionType;
+import org.xtreemfs.mrc.database.StorageManager;
+import org.xtreemfs.mrc.metadata.FileMetadata;
+import org.xtreemfs.mrc.utils.MRCHelper.GlobalFileIdResolver;
+import org.xtreemfs.pbrpc.generatedinterfaces.GlobalTypes.OSDWriteResponse;
+import org.xtreemfs.pbrpc.generatedinterfaces.MRC.xtreemfs_update_file_sizeRequest;
+import org.xtreemfs.pbrpc.generatedinterfaces.MRC.xtreemfs_update_file_sizesRequest;
+import org.xtreemfs.pbrpc.generatedinterfaces.MRC.xtreemfs_update_file_sizesResponse;
+
+/**
+ * Applies the periodic file size updates of several open files of one volume
+ * with a single database update. Unlike UpdateFileSizeOperation, invalid
+ * updates do not fail the request but are rejected individually. Closing files
+ * (and thus on-close replication) is not supported.
+ */
+public class UpdateFileSizesOperation extends MRCOperation {
+    
+    public UpdateFileSizesOperation(MRCRequestDispatcher master) {
+        super(master);
+    }
+    
+    @Override
+    public void startRequest(MRCRequest rq) throws Throwable {
+        
+        // perform master redirect if necessary
+        if (master.getReplMasterUUID() != null
+                && !master.getReplMasterUUID().equals(master.getConfig().getUUID().toString()))
+            throw new DatabaseException(ExceptionType.REDIRECT);
+        
+        final xtreemfs_update_file_sizesRequest rqArgs = (xtreemfs_update_file_sizesRequest) rq
+                .getRequestArgs();
+        
+        xtreemfs_update_file_sizesResponse.Builder response = xtreemfs_update_file_sizesResponse.newBuilder();
+        StorageManager sMan = null;
+        String volumeId = null;
+        AtomicDBUpdate update = null;
+        
+        for (xtreemfs_update_file_sizeRequest fsUpdate : rqArgs.getUpdatesList()) {
+            
+            Capability cap = new Capability(fsUpdate.getXcap(), master.getConfig().getCapabilitySecret());
+            
+            // only accept updates with valid capabilities of open files
+            if (!cap.hasValidSignature() || cap.hasExpired() || fsUpdate.getCloseFile()) {
+                if (Logging.isDebug())
+                    Logging.logMessage(Logging.LEVEL_DEBUG, Category.proc, this,
+                        "rejected file size update with capability %s", cap);
+                response.addAccepted(false);
+                continue;
+            }
+            
+            // parse volume and file ID from global file ID
+            GlobalFileIdResolver idRes;
+            try {
+                idRes = new GlobalFileIdResolver(cap.getFileId());
+            } catch (UserException exc) {
+                response.addAccepted(false);
+                continue;
+            }
+            
+            // all updates of a request have to refer to the same volume
+            if (sMan == null) {
+                try {
+                    sMan = master.getVolumeManager().getStorageManager(idRes.getVolumeId());
+                } catch (UserException exc) {
+                    response.addAccepted(false);
+                    continue;
+                }
+                volumeId = idRes.getVolumeId();
+                update = sMan.createAtomicDBUpdate(master, rq);
+            } else if (!volumeId.equals(idRes.getVolumeId())) {
+                response.addAccepted(false);
+                continue;
+            }
+            
+            FileMetadata file = sMan.getMetadata(idRes.getLocalFileId());
+            OSDWriteResponse osdWriteResponse = fsUpdate.getOsdWriteResponse();
+            if (file == null
+                || (osdWriteResponse.hasSizeInBytes() && (file.isReadOnly() || !osdWriteResponse
+                        .hasTruncateEpoch()))) {
+                response.addAccepted(false);
+                continue;
+            }
+            
+            if (osdWriteResponse.hasSizeInBytes())
+                updateFileSize(sMan, file, osdWriteResponse, update);
+            response.addAccepted(true);
+        }
+        
+        // set the response
+        rq.setResponse(response.build());
+        
+        if (update != null)
+            update.execute();
+        else
+            finishRequest(rq);
+    }
+    
+    private void updateFileSize(StorageManager sMan, FileMetadata file, OSDWriteResponse osdWriteResponse,
+        AtomicDBUpdate update) throws DatabaseException {
+        
+        long newFileSize = osdWriteResponse.getSizeInBytes();
+        int epochNo = osdWriteResponse.getTruncateEpoch();
+        
+        // accept any file size in a new epoch but only larger file sizes in
+        // the current epoch
+        boolean epochChanged = epochNo > file.getEpoch();
+        if (epochNo < file.getEpoch() || (!epochChanged && newFileSize <= file.getSize())) {
+            if (Logging.isDebug())
+                Logging.logMessage(Logging.LEVEL_DEBUG, Category.proc, this,
+                    "received outdated file size update: size=%d, epoch=%d, current size=%d, current epoch=%d",
+                    newFileSize, epochNo, file.getSize(), file.getEpoch());
+            return;
+        }
+        
+        long oldFileSize = file.getSize();
+        int time = (int) (TimeSync.getGlobalTime() / 1000);
+        
+        file.setSize(newFileSize);
+        file.setEpoch(epochNo);
+        file.setCtime(time);
+        file.setMtime(time);
+        
+        sMan.setMetadata(file, FileMetadata.FC_METADATA, update);
+        
+        if (epochChanged)
+            sMan.setMetadata(file, FileMetadata.RC_METADATA, update);
+        
+        // update the volume size
+        sMan.getVolumeInfo().updateVolumeSize(newFileSize - oldFileSize, update);
+    }
+}
@@ -58,6 +58,7 @@ import org.xtreemfs.mrc.operations.ReadDirAndStatOperation;
 import org.xtreemfs.mrc.operations.ReadLinkOperation;
 import org.xtreemfs.mrc.operations.RemoveReplicaOperation;
 import org.xtreemfs.mrc.operations.RemoveXAttrOperation;
+import org.xtreemfs.mrc.operations.RenewCapabilitiesOperation;
 import org.xtreemfs.mrc.operations.RenewCapabilityAndVoucherOperation;
 import org.xtreemfs.mrc.operations.RenewOperation;
 import org.xtreemfs.mrc.operations.ReselectOSDsOperation;
@@ -71,6 +72,7 @@ import org.xtreemfs.mrc.operations.StatFSOperation;
 import org.xtreemfs.mrc.operations.StatOperation;
 import org.xtreemfs.mrc.operations.TruncateOperation;
 import org.xtreemfs.mrc.operations.UpdateFileSizeOperation;
+import org.xtreemfs.mrc.operations.UpdateFileSizesOperation;
 import org.xtreemfs.pbrpc.generatedinterfaces.MRCServiceConstants;
 
 import com.google.protobuf.Descriptors.FieldDescriptor;
@@ -158,6 +160,10 @@ public class ProcessingStage extends MRCStage {
         operations.put(MRCServiceConstants.PROC_ID_XTREEMFS_GET_XLOCSET, new GetXLocSetOperation(master));
         operations.put(MRCServiceConstants.PROC_ID_XTREEMFS_RESELECT_OSDS, new ReselectOSDsOperation(master));
         operations.put(MRCServiceConstants.PROC_ID_XTREEMFS_CLEAR_VOUCHERS, new ClearVouchersOperation(master));
+        operations.put(MRCServiceConstants.PROC_ID_XTREEMFS_RENEW_CAPABILITIES,
+                new RenewCapabilitiesOperation(master));
+        operations.put(MRCServiceConstants.PROC_ID_XTREEMFS_UPDATE_FILE_SIZES,
+                new UpdateFileSizesOperation(master));
     }
     
     public Map<Integer, Integer> get_opCountMap() {